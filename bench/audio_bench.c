@@ -0,0 +1,660 @@
+/*
+ * audio_bench.c - Offline throughput and golden-output check for the audio path
+ *
+ * BUILD: build.bat bench  ->  bin\lwsr_audio_bench.exe (console)
+ *
+ * Runs WAV files through the stages a replay runs live, with the same code,
+ * so resampler, mixer and encoder changes can be timed and checked without
+ * capture devices:
+ *
+ *   convert   AudioResampler_Process, source format -> 48 kHz stereo s16,
+ *             fed in 10 ms packets like a WASAPI capture thread
+ *   mix       AudioMix_Mix of the converted sources at their volumes, one
+ *             AUDIO_MIX_CHUNK_SIZE at a time (mixed track)
+ *   volume    AudioMix_Mix of each source alone at its volume (per-source
+ *             tracks)
+ *   aac       AACEncoder_Feed of the mix in 8 KB reads, then AACEncoder_Drain
+ *
+ * mix and volume run once per kernel the CPU has (scalar, SSE2, AVX2); the
+ * kernels must agree bit for bit. Per stage: median wall time over N
+ * iterations, input frames per second and the multiple of real time.
+ *
+ * With no files, four synthetic inputs in the formats seen in the field are
+ * generated (tones, a sweep and low-level noise): f32 48 kHz stereo
+ * (loopback), s16 48 kHz mono (microphone), s16 44.1 kHz stereo (headset)
+ * and s24 96 kHz stereo (audio interface). The mix takes the first
+ * MAX_AUDIO_SOURCES inputs, as the capture context does.
+ *
+ * Golden output: --write-golden DIR saves every converted source and the
+ * mix as 48 kHz s16 WAV; --golden DIR compares a run against them and fails
+ * on any sample further off than --tolerance (default 0, bit-exact). AAC is
+ * timed only: its bytes depend on the installed MFT.
+ */
+
+#include <initguid.h>        /* Media type GUIDs, as in main.c */
+#include <windows.h>
+#include <mfapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "audio_capture.h"
+#include "audio_resample.h"
+#include "audio_mix.h"
+#include "aac_encoder.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include "bench_common.h"
+
+#define MAX_ITERATIONS      32
+#define MAX_INPUTS          8
+#define SYNTHETIC_INPUTS    4
+#define AAC_READ_BYTES      8192        /* DrainAudioCapture's read size */
+#define BENCH_PI            3.14159265358979323846
+
+#define WAV_FORMAT_PCM          1
+#define WAV_FORMAT_IEEE_FLOAT   3
+#define WAV_FORMAT_EXTENSIBLE   0xFFFE
+
+typedef struct {
+    int seconds;                // Synthetic input length
+    int iterations;
+    int volumes[MAX_AUDIO_SOURCES];
+    double driftPpm;            // AudioResampler_SetRatio(1 + ppm) on every source
+    int tolerance;              // Golden: largest accepted |difference|
+    const char* goldenDir;
+    const char* writeGoldenDir;
+    const char* files[MAX_INPUTS];
+    int fileCount;
+} BenchOptions;
+
+/* One source as stored in its file, and its converted 48 kHz stereo PCM */
+typedef struct {
+    char name[64];
+    BYTE* fileData;             // Owning buffer (file contents or synthesized)
+    const BYTE* frames;         // Interleaved frames as stored
+    int frameCount;
+    int rate;
+    int channels;
+    int blockAlign;
+    AudioSampleFormat format;
+
+    short* converted;
+    int convertedFrames;
+} BenchInput;
+
+static void PrintRow(const char* stage, const char* detail, double ms, double frames, double seconds) {
+    double perSec = ms > 0 ? frames * 1000.0 / ms : 0;
+    printf("%-8s %-24s %9.2f %12.2f %11.0fx\n", stage, detail, ms, perSec / 1e6,
+           ms > 0 ? seconds * 1000.0 / ms : 0);
+}
+
+/* ============================================================================
+ * WAV FILES
+ * ============================================================================
+ */
+
+static BYTE* ReadWholeFile(const char* path, DWORD* size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    BYTE* data = NULL;
+    LARGE_INTEGER length;
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0 && length.QuadPart < MAXDWORD) {
+        data = (BYTE*)malloc((size_t)length.QuadPart);
+        DWORD read = 0;
+        if (data && (!ReadFile(file, data, (DWORD)length.QuadPart, &read, NULL) ||
+                     read != (DWORD)length.QuadPart)) {
+            SAFE_FREE(data);
+        }
+        *size = (DWORD)length.QuadPart;
+    }
+    CloseHandle(file);
+    return data;
+}
+
+static AudioSampleFormat ClassifyWav(int tag, int bits) {
+    if (tag == WAV_FORMAT_IEEE_FLOAT) return bits == 32 ? AUDIO_SAMPLE_F32 : AUDIO_SAMPLE_UNSUPPORTED;
+    if (tag != WAV_FORMAT_PCM) return AUDIO_SAMPLE_UNSUPPORTED;
+    if (bits == 16) return AUDIO_SAMPLE_S16;
+    if (bits == 24) return AUDIO_SAMPLE_S24;
+    return AUDIO_SAMPLE_UNSUPPORTED;
+}
+
+// Load a PCM / float / extensible WAV. Prints why on failure.
+static BOOL ReadWav(const char* path, BenchInput* input) {
+    DWORD size = 0;
+    BYTE* file = ReadWholeFile(path, &size);
+    if (!file) {
+        printf("%s: cannot read\n", path);
+        return FALSE;
+    }
+    if (size < 12 || memcmp(file, "RIFF", 4) != 0 || memcmp(file + 8, "WAVE", 4) != 0) {
+        printf("%s: not a RIFF/WAVE file\n", path);
+        free(file);
+        return FALSE;
+    }
+
+    int tag = 0, bits = 0;
+    const BYTE* data = NULL;
+    DWORD dataSize = 0;
+    for (DWORD pos = 12; pos + 8 <= size; ) {
+        DWORD chunkSize = *(const DWORD*)(file + pos + 4);
+        const BYTE* body = file + pos + 8;
+        if (chunkSize > size - pos - 8) chunkSize = size - pos - 8;
+        if (memcmp(file + pos, "fmt ", 4) == 0 && chunkSize >= 16) {
+            tag = *(const WORD*)body;
+            input->channels = *(const WORD*)(body + 2);
+            input->rate = (int)*(const DWORD*)(body + 4);
+            input->blockAlign = *(const WORD*)(body + 12);
+            bits = *(const WORD*)(body + 14);
+            // Extensible: the sub-format GUID starts with the plain tag
+            if (tag == WAV_FORMAT_EXTENSIBLE && chunkSize >= 40) tag = *(const WORD*)(body + 24);
+        } else if (memcmp(file + pos, "data", 4) == 0) {
+            data = body;
+            dataSize = chunkSize;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    input->format = ClassifyWav(tag, bits);
+    if (!data || input->format == AUDIO_SAMPLE_UNSUPPORTED || input->channels < 1 ||
+        input->rate <= 0 || input->blockAlign < input->channels * bits / 8) {
+        printf("%s: unsupported (tag=%d, bits=%d, channels=%d, rate=%d)\n",
+               path, tag, bits, input->channels, input->rate);
+        free(file);
+        return FALSE;
+    }
+
+    input->fileData = file;
+    input->frames = data;
+    input->frameCount = (int)(dataSize / (DWORD)input->blockAlign);
+    const char* base = strrchr(path, '\\');
+    base = base ? base + 1 : path;
+    strncpy_s(input->name, sizeof(input->name), base, _TRUNCATE);
+    char* dot = strrchr(input->name, '.');
+    if (dot) *dot = '\0';
+    return TRUE;
+}
+
+// 48 kHz stereo s16
+static BOOL WriteWav(const char* path, const short* pcm, int frames) {
+    BYTE header[44];
+    DWORD dataBytes = (DWORD)frames * AUDIO_BLOCK_ALIGN;
+    memcpy(header, "RIFF", 4);
+    *(DWORD*)(header + 4) = 36 + dataBytes;
+    memcpy(header + 8, "WAVEfmt ", 8);
+    *(DWORD*)(header + 16) = 16;
+    *(WORD*)(header + 20) = WAV_FORMAT_PCM;
+    *(WORD*)(header + 22) = AUDIO_CHANNELS;
+    *(DWORD*)(header + 24) = AUDIO_SAMPLE_RATE;
+    *(DWORD*)(header + 28) = AUDIO_BYTES_PER_SEC;
+    *(WORD*)(header + 32) = AUDIO_BLOCK_ALIGN;
+    *(WORD*)(header + 34) = AUDIO_BITS_PER_SAMPLE;
+    memcpy(header + 36, "data", 4);
+    *(DWORD*)(header + 40) = dataBytes;
+
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+    DWORD written = 0;
+    BOOL ok = WriteFile(file, header, sizeof(header), &written, NULL) && written == sizeof(header) &&
+              WriteFile(file, pcm, dataBytes, &written, NULL) && written == dataBytes;
+    CloseHandle(file);
+    return ok;
+}
+
+/* ============================================================================
+ * SYNTHETIC INPUTS
+ * ============================================================================
+ */
+
+static UINT32 g_rng = 0x9E3779B9u;
+
+static double Noise(void) {
+    g_rng = g_rng * 1664525u + 1013904223u;
+    return (double)(g_rng >> 8) / (double)(1u << 24) - 0.5;
+}
+
+// Two tones, a 50 Hz - 18 kHz log sweep over the clip and -60 dB noise,
+// peaking near -3 dBFS; channel 1 a little detuned so L != R
+static double SyntheticSample(int frame, int channel, int rate, int frames) {
+    double t = (double)frame / rate;
+    double length = (double)frames / rate;
+    double k = log(18000.0 / 50.0) / length;
+    double sweepPhase = 2.0 * BENCH_PI * 50.0 * (exp(k * t) - 1.0) / k;
+    double tone = channel ? 0.2 * sin(2.0 * BENCH_PI * 445.0 * t) : 0.2 * sin(2.0 * BENCH_PI * 440.0 * t);
+    return tone + 0.15 * sin(2.0 * BENCH_PI * 3000.0 * t) + 0.3 * sin(sweepPhase) + 0.002 * Noise();
+}
+
+static BOOL MakeSynthetic(int kind, int seconds, BenchInput* input) {
+    static const struct {
+        const char* name;
+        AudioSampleFormat format;
+        int rate;
+        int channels;
+        int bytesPerSample;
+    } KINDS[SYNTHETIC_INPUTS] = {
+        { "loopback_f32_48k",   AUDIO_SAMPLE_F32, 48000, 2, 4 },
+        { "mic_s16_48k_mono",   AUDIO_SAMPLE_S16, 48000, 1, 2 },
+        { "headset_s16_44k1",   AUDIO_SAMPLE_S16, 44100, 2, 2 },
+        { "interface_s24_96k",  AUDIO_SAMPLE_S24, 96000, 2, 3 },
+    };
+
+    strncpy_s(input->name, sizeof(input->name), KINDS[kind].name, _TRUNCATE);
+    input->format = KINDS[kind].format;
+    input->rate = KINDS[kind].rate;
+    input->channels = KINDS[kind].channels;
+    input->blockAlign = KINDS[kind].channels * KINDS[kind].bytesPerSample;
+    input->frameCount = KINDS[kind].rate * seconds;
+    input->fileData = (BYTE*)malloc((size_t)input->frameCount * input->blockAlign);
+    if (!input->fileData) return FALSE;
+    input->frames = input->fileData;
+
+    for (int i = 0; i < input->frameCount; i++) {
+        BYTE* frame = input->fileData + (size_t)i * input->blockAlign;
+        for (int c = 0; c < input->channels; c++) {
+            double v = SyntheticSample(i, c, input->rate, input->frameCount);
+            if (input->format == AUDIO_SAMPLE_F32) {
+                ((float*)frame)[c] = (float)v;
+            } else if (input->format == AUDIO_SAMPLE_S16) {
+                ((short*)frame)[c] = (short)floor(v * AUDIO_16BIT_MAX_SIGNED + 0.5);
+            } else {
+                int s = (int)floor(v * (AUDIO_24BIT_MAX - 1.0) + 0.5);
+                BYTE* p = frame + c * 3;
+                p[0] = (BYTE)s;
+                p[1] = (BYTE)(s >> 8);
+                p[2] = (BYTE)(s >> 16);
+            }
+        }
+    }
+    return TRUE;
+}
+
+/* ============================================================================
+ * STAGES
+ * ============================================================================
+ */
+
+// Resample one input as its capture thread would: 10 ms packets
+static BOOL ConvertInput(BenchInput* input, double driftPpm) {
+    int capacity = (int)((LONGLONG)input->frameCount * AUDIO_SAMPLE_RATE / input->rate) + AUDIO_SAMPLE_RATE;
+    if (!input->converted) {
+        input->converted = (short*)malloc((size_t)capacity * AUDIO_BLOCK_ALIGN);
+        if (!input->converted) return FALSE;
+    }
+
+    AudioResampler* rs = AudioResampler_Create(input->rate, AUDIO_SAMPLE_RATE);
+    if (!rs) return FALSE;
+    if (driftPpm != 0.0) AudioResampler_SetRatio(rs, 1.0 + driftPpm * 1e-6);
+
+    int packet = input->rate / 100;
+    int written = 0;
+    for (int pos = 0; pos < input->frameCount; pos += packet) {
+        int n = min(packet, input->frameCount - pos);
+        written += AudioResampler_Process(rs, input->frames + (size_t)pos * input->blockAlign, n,
+                                          input->format, input->channels, input->blockAlign,
+                                          input->converted + (size_t)written * AUDIO_CHANNELS,
+                                          capacity - written);
+    }
+    AudioResampler_Destroy(rs);
+    input->convertedFrames = written;
+    return TRUE;
+}
+
+// Mixed track: every source at its gain, one mix chunk at a time
+static void MixSources(const short* const* sources, const int* gains, int sourceCount,
+                       short* out, int frames) {
+    const int chunkFrames = AUDIO_MIX_CHUNK_SIZE / AUDIO_BLOCK_ALIGN;
+    int peak[2] = { 0, 0 };
+    for (int pos = 0; pos < frames; pos += chunkFrames) {
+        int n = min(chunkFrames, frames - pos);
+        const short* chunk[MAX_AUDIO_SOURCES];
+        for (int i = 0; i < sourceCount; i++) chunk[i] = sources[i] + (size_t)pos * AUDIO_CHANNELS;
+        AudioMix_Mix(chunk, gains, sourceCount, out + (size_t)pos * AUDIO_CHANNELS, n * AUDIO_CHANNELS, peak);
+    }
+}
+
+// Per-source tracks: each source alone at its gain
+static void VolumeSources(const short* const* sources, const int* gains, int sourceCount,
+                          short* scratch, int frames) {
+    const int chunkFrames = AUDIO_MIX_CHUNK_SIZE / AUDIO_BLOCK_ALIGN;
+    for (int i = 0; i < sourceCount; i++) {
+        for (int pos = 0; pos < frames; pos += chunkFrames) {
+            int n = min(chunkFrames, frames - pos);
+            const short* in = sources[i] + (size_t)pos * AUDIO_CHANNELS;
+            AudioMix_Mix(&in, &gains[i], 1, scratch, n * AUDIO_CHANNELS, NULL);
+        }
+    }
+}
+
+typedef struct {
+    int frames;
+    LONGLONG bytes;
+} AacTally;
+
+static void CountAacFrame(const AACSample* sample, void* userData) {
+    AacTally* tally = (AacTally*)userData;
+    tally->frames++;
+    tally->bytes += sample->size;
+}
+
+// Encode the mix; *ms covers Feed + Drain, not encoder creation
+static BOOL EncodeMix(const short* mix, int frames, double* ms, AacTally* tally) {
+    AACEncoderError err = AAC_OK;
+    AACEncoder* encoder = AACEncoder_CreateEx(&err);
+    if (!encoder) {
+        printf("aac      AACEncoder_CreateEx failed (error=%d)\n", (int)err);
+        return FALSE;
+    }
+    ZeroMemory(tally, sizeof(*tally));
+    AACEncoder_SetCallback(encoder, CountAacFrame, tally);
+
+    LARGE_INTEGER freq, start;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    const BYTE* pcm = (const BYTE*)mix;
+    int total = frames * AUDIO_BLOCK_ALIGN;
+    for (int pos = 0; pos < total; pos += AAC_READ_BYTES) {
+        LONGLONG ts = 1 + (LONGLONG)(pos / AUDIO_BLOCK_ALIGN) * MF_UNITS_PER_SECOND / AUDIO_SAMPLE_RATE;
+        AACEncoder_Feed(encoder, pcm + pos, min(AAC_READ_BYTES, total - pos), ts);
+    }
+    AACEncoder_Drain(encoder);
+    *ms = Bench_ElapsedMs(start, freq);
+
+    AACEncoder_Destroy(encoder);
+    return TRUE;
+}
+
+/* ============================================================================
+ * GOLDEN OUTPUT
+ * ============================================================================
+ */
+
+// Compare pcm against DIR\name.wav; prints the verdict
+static BOOL CheckGolden(const char* dir, const char* name, const short* pcm, int frames, int tolerance) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s\\%s.wav", dir, name);
+    BenchInput golden;
+    ZeroMemory(&golden, sizeof(golden));
+    if (!ReadWav(path, &golden)) {
+        printf("golden   %-24s MISSING\n", name);
+        return FALSE;
+    }
+
+    BOOL ok = FALSE;
+    if (golden.format != AUDIO_SAMPLE_S16 || golden.channels != AUDIO_CHANNELS ||
+        golden.rate != AUDIO_SAMPLE_RATE) {
+        printf("golden   %-24s not 48 kHz stereo s16\n", name);
+    } else {
+        const short* ref = (const short*)golden.frames;
+        int common = min(frames, golden.frameCount) * AUDIO_CHANNELS;
+        int differing = 0, worst = 0, first = -1;
+        for (int i = 0; i < common; i++) {
+            int d = abs((int)pcm[i] - (int)ref[i]);
+            if (d > tolerance) {
+                differing++;
+                if (first < 0) first = i / AUDIO_CHANNELS;
+            }
+            if (d > worst) worst = d;
+        }
+        ok = differing == 0 && frames == golden.frameCount;
+        if (ok) {
+            printf("golden   %-24s OK (max |diff| %d)\n", name, worst);
+        } else if (frames != golden.frameCount) {
+            printf("golden   %-24s DIFF: %d frames, golden has %d\n", name, frames, golden.frameCount);
+        } else {
+            printf("golden   %-24s DIFF: %d samples over %d (max %d), first at frame %d\n",
+                   name, differing, tolerance, worst, first);
+        }
+    }
+    free(golden.fileData);
+    return ok;
+}
+
+static BOOL SaveGolden(const char* dir, const char* name, const short* pcm, int frames) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s\\%s.wav", dir, name);
+    if (!WriteWav(path, pcm, frames)) {
+        printf("golden   cannot write %s\n", path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* ============================================================================
+ * COMMAND LINE
+ * ============================================================================
+ */
+
+static void Usage(void) {
+    printf("usage: lwsr_audio_bench [options] [file.wav ...]\n"
+           "  --seconds N        synthetic input length when no files are given (30)\n"
+           "  --iterations N     runs per stage, median reported (5, max %d)\n"
+           "  --volumes A,B,C    source volumes in percent, 0-%d (100,100,100)\n"
+           "  --drift PPM        run every resampler at this clock drift (0)\n"
+           "  --golden DIR       compare converted sources and the mix to DIR\\<name>.wav\n"
+           "  --write-golden DIR write them there instead\n"
+           "  --tolerance N      largest accepted sample difference for --golden (0)\n"
+           "Files: PCM s16/s24, float f32, any rate, mono or more channels; at most %d.\n",
+           MAX_ITERATIONS, AUDIO_VOLUME_MAX, MAX_INPUTS);
+}
+
+static BOOL ParseVolumes(const char* list, int* volumes) {
+    char copy[64];
+    strncpy_s(copy, sizeof(copy), list, _TRUNCATE);
+    char* context = NULL;
+    int i = 0;
+    for (char* tok = strtok_s(copy, ",", &context); tok; tok = strtok_s(NULL, ",", &context)) {
+        if (i >= MAX_AUDIO_SOURCES) return FALSE;
+        volumes[i] = atoi(tok);
+        if (volumes[i] < 0 || volumes[i] > AUDIO_VOLUME_MAX) return FALSE;
+        i++;
+    }
+    return i > 0;
+}
+
+static BOOL ParseOptions(int argc, char** argv, BenchOptions* opt) {
+    ZeroMemory(opt, sizeof(*opt));
+    opt->seconds = 30;
+    opt->iterations = 5;
+    for (int i = 0; i < MAX_AUDIO_SOURCES; i++) opt->volumes[i] = AUDIO_VOLUME_DEFAULT;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            if (opt->fileCount >= MAX_INPUTS) return FALSE;
+            opt->files[opt->fileCount++] = arg;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) return FALSE;
+        i++;
+        if (strcmp(arg, "--seconds") == 0) opt->seconds = atoi(value);
+        else if (strcmp(arg, "--iterations") == 0) opt->iterations = atoi(value);
+        else if (strcmp(arg, "--volumes") == 0) { if (!ParseVolumes(value, opt->volumes)) return FALSE; }
+        else if (strcmp(arg, "--drift") == 0) opt->driftPpm = atof(value);
+        else if (strcmp(arg, "--golden") == 0) opt->goldenDir = value;
+        else if (strcmp(arg, "--write-golden") == 0) opt->writeGoldenDir = value;
+        else if (strcmp(arg, "--tolerance") == 0) opt->tolerance = atoi(value);
+        else return FALSE;
+    }
+
+    return opt->seconds > 0 && opt->iterations > 0 && opt->iterations <= MAX_ITERATIONS &&
+           opt->tolerance >= 0 && fabs(opt->driftPpm) <= AUDIO_DRIFT_MAX_PPM &&
+           !(opt->goldenDir && opt->writeGoldenDir);
+}
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================
+ */
+
+// Time the mix or volume stage with one kernel; *out gets its last output
+static double TimeMixStage(BOOL volumeOnly, const short* const* sources, const int* gains,
+                           int sourceCount, short* out, int frames, int iterations) {
+    double ms[MAX_ITERATIONS];
+    LARGE_INTEGER freq, start;
+    QueryPerformanceFrequency(&freq);
+    for (int it = 0; it < iterations; it++) {
+        QueryPerformanceCounter(&start);
+        if (volumeOnly) VolumeSources(sources, gains, sourceCount, out, frames);
+        else MixSources(sources, gains, sourceCount, out, frames);
+        ms[it] = Bench_ElapsedMs(start, freq);
+    }
+    return Bench_Median(ms, iterations);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    if (!ParseOptions(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    /* Module logs go to a file, results to stdout */
+    Logger_Init("audio_bench.log", "w");
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    HRESULT hrMf = MFStartup(MF_VERSION, MFSTARTUP_NOSOCKET);
+    if (FAILED(hrMf)) {
+        printf("MFStartup failed (0x%08lX): the aac stage will fail\n", (unsigned long)hrMf);
+    }
+
+    int exitCode = 1;
+    BenchInput inputs[MAX_INPUTS];
+    ZeroMemory(inputs, sizeof(inputs));
+    int inputCount = opt.fileCount ? opt.fileCount : SYNTHETIC_INPUTS;
+    short* padded[MAX_AUDIO_SOURCES] = { 0 };
+    short* mixOut = NULL;
+    short* reference = NULL;
+
+    for (int i = 0; i < inputCount; i++) {
+        BOOL ok = opt.fileCount ? ReadWav(opt.files[i], &inputs[i]) : MakeSynthetic(i, opt.seconds, &inputs[i]);
+        if (!ok) goto cleanup;
+    }
+
+    printf("lwsr_audio_bench: %d input(s), %d iteration(s), volumes %d/%d/%d, drift %.1f ppm\n",
+           inputCount, opt.iterations, opt.volumes[0], opt.volumes[1], opt.volumes[2], opt.driftPpm);
+    for (int i = 0; i < inputCount; i++) {
+        static const char* const FORMAT_NAMES[] = { "?", "f32", "s16", "s24" };
+        printf("  %-24s %s %d Hz %d ch, %.1f s\n", inputs[i].name, FORMAT_NAMES[inputs[i].format],
+               inputs[i].rate, inputs[i].channels, (double)inputs[i].frameCount / inputs[i].rate);
+    }
+    printf("\n%-8s %-24s %9s %12s %12s\n", "stage", "detail", "ms", "Mframes/s", "realtime");
+
+    exitCode = 0;
+    LARGE_INTEGER freq, start;
+    QueryPerformanceFrequency(&freq);
+
+    /* convert: per input, frames/s counted at the input rate */
+    for (int i = 0; i < inputCount; i++) {
+        double ms[MAX_ITERATIONS];
+        for (int it = 0; it < opt.iterations; it++) {
+            QueryPerformanceCounter(&start);
+            if (!ConvertInput(&inputs[i], opt.driftPpm)) {
+                printf("convert  %-24s out of memory\n", inputs[i].name);
+                exitCode = 1;
+                goto cleanup;
+            }
+            ms[it] = Bench_ElapsedMs(start, freq);
+        }
+        PrintRow("convert", inputs[i].name, Bench_Median(ms, opt.iterations), inputs[i].frameCount,
+                 (double)inputs[i].frameCount / inputs[i].rate);
+    }
+
+    /* Mix sources padded to the longest with silence, as the mix thread pads */
+    int sourceCount = min(inputCount, MAX_AUDIO_SOURCES);
+    int mixFrames = 0;
+    for (int i = 0; i < sourceCount; i++) mixFrames = max(mixFrames, inputs[i].convertedFrames);
+    int gains[MAX_AUDIO_SOURCES];
+    const short* sources[MAX_AUDIO_SOURCES];
+    for (int i = 0; i < sourceCount; i++) {
+        padded[i] = (short*)calloc((size_t)mixFrames, AUDIO_BLOCK_ALIGN);
+        if (!padded[i]) goto cleanup;
+        memcpy(padded[i], inputs[i].converted, (size_t)inputs[i].convertedFrames * AUDIO_BLOCK_ALIGN);
+        sources[i] = padded[i];
+        gains[i] = AudioMix_Gain(opt.volumes[i]);
+    }
+    mixOut = (short*)malloc((size_t)mixFrames * AUDIO_BLOCK_ALIGN + 1);
+    reference = (short*)malloc((size_t)mixFrames * AUDIO_BLOCK_ALIGN + 1);
+    if (!mixOut || !reference) goto cleanup;
+    double mixSeconds = (double)mixFrames / AUDIO_SAMPLE_RATE;
+
+    /* mix and volume, every kernel the CPU has; outputs must be identical */
+    AudioMixKernel original = AudioMix_GetKernel();
+    for (int stage = 0; stage < 2; stage++) {
+        BOOL volumeOnly = stage == 1;
+        BOOL haveReference = FALSE;
+        for (int k = AUDIO_MIX_SCALAR; k <= AUDIO_MIX_AVX2; k++) {
+            if (AudioMix_SetKernel((AudioMixKernel)k) != (AudioMixKernel)k) continue;
+            double ms = TimeMixStage(volumeOnly, sources, gains, sourceCount, mixOut, mixFrames, opt.iterations);
+            char detail[40];
+            snprintf(detail, sizeof(detail), "%d source(s), %s", sourceCount, AudioMix_KernelName((AudioMixKernel)k));
+            PrintRow(volumeOnly ? "volume" : "mix", detail, ms, (double)mixFrames * (volumeOnly ? sourceCount : 1),
+                     mixSeconds * (volumeOnly ? sourceCount : 1));
+
+            /* Volume output is the last source's last chunk; the mix is all of it */
+            size_t compareBytes = volumeOnly
+                ? (size_t)min(mixFrames, AUDIO_MIX_CHUNK_SIZE / AUDIO_BLOCK_ALIGN) * AUDIO_BLOCK_ALIGN
+                : (size_t)mixFrames * AUDIO_BLOCK_ALIGN;
+            if (!haveReference) {
+                memcpy(reference, mixOut, compareBytes);
+                haveReference = TRUE;
+            } else if (memcmp(reference, mixOut, compareBytes) != 0) {
+                printf("%-8s %-24s MISMATCH against %s\n", volumeOnly ? "volume" : "mix",
+                       AudioMix_KernelName((AudioMixKernel)k), AudioMix_KernelName(AUDIO_MIX_SCALAR));
+                exitCode = 1;
+            }
+        }
+    }
+    AudioMix_SetKernel(original);
+    MixSources(sources, gains, sourceCount, mixOut, mixFrames);
+
+    /* aac */
+    {
+        double ms[MAX_ITERATIONS];
+        AacTally tally = { 0 };
+        int runs = 0;
+        for (int it = 0; it < opt.iterations; it++) {
+            if (!EncodeMix(mixOut, mixFrames, &ms[runs], &tally)) break;
+            runs++;
+        }
+        if (runs == opt.iterations) {
+            char detail[40];
+            snprintf(detail, sizeof(detail), "%d frames, %.0f kbit/s", tally.frames,
+                     mixSeconds > 0 ? (double)tally.bytes * 8.0 / mixSeconds / 1000.0 : 0);
+            PrintRow("aac", detail, Bench_Median(ms, runs), mixFrames, mixSeconds);
+        } else {
+            exitCode = 1;
+        }
+    }
+
+    /* Golden files */
+    if (opt.goldenDir || opt.writeGoldenDir) printf("\n");
+    for (int i = 0; i < inputCount; i++) {
+        if (opt.writeGoldenDir && !SaveGolden(opt.writeGoldenDir, inputs[i].name, inputs[i].converted, inputs[i].convertedFrames)) exitCode = 1;
+        if (opt.goldenDir && !CheckGolden(opt.goldenDir, inputs[i].name, inputs[i].converted, inputs[i].convertedFrames, opt.tolerance)) exitCode = 1;
+    }
+    if (opt.writeGoldenDir) {
+        if (SaveGolden(opt.writeGoldenDir, "mix", mixOut, mixFrames)) {
+            printf("golden   written to %s\n", opt.writeGoldenDir);
+        } else {
+            exitCode = 1;
+        }
+    }
+    if (opt.goldenDir && !CheckGolden(opt.goldenDir, "mix", mixOut, mixFrames, opt.tolerance)) exitCode = 1;
+
+cleanup:
+    for (int i = 0; i < MAX_AUDIO_SOURCES; i++) SAFE_FREE(padded[i]);
+    SAFE_FREE(mixOut);
+    SAFE_FREE(reference);
+    for (int i = 0; i < inputCount; i++) {
+        SAFE_FREE(inputs[i].fileData);
+        SAFE_FREE(inputs[i].converted);
+    }
+    if (SUCCEEDED(hrMf)) MFShutdown();
+    if (hrCom == S_OK || hrCom == S_FALSE) CoUninitialize();
+    Logger_Shutdown();
+    return exitCode;
+}
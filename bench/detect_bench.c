@@ -0,0 +1,808 @@
+/*
+ * detect_bench.c - Offline speed and accuracy check for kill-feed detection
+ *
+ * BUILD: build.bat bench  ->  bin\lwsr_detect_bench.exe (console)
+ *
+ * Runs the matcher the kill-feed sampler uses over saved detection-region
+ * frames, so a threshold, a scale list or a matcher change can be judged
+ * on real captures instead of by watching for clips:
+ *
+ *   templates   a game profile's PNGs (games\<id>.ini and static\<dir>\
+ *               beside the exe, as KillFeedSampler_Init loads them) or
+ *               every PNG of --templates DIR, at every --scales entry
+ *   frames      BMP or PNG detection regions: --pos DIR holds frames that
+ *               should trigger (the <clip>_region.bmp files debug mode
+ *               saves next to triggered clips), --neg DIR frames that
+ *               should not (calm HUD, other banners, menus)
+ *
+ * Each frame is scanned like a sampler scan: one MatchImagePyramid, then
+ * TemplateMatch_SearchPyramid for every template x scale, best score wins.
+ * Reported:
+ *
+ *   speed       scans/s on one thread and fanned out over the sampler's
+ *               thread count, and each template x scale's share of a scan
+ *               (median over N iterations)
+ *   accuracy    precision and recall of "best >= threshold" from 0.50 to
+ *               0.95 and at the profile threshold, the best-score spread of
+ *               each class, and the positives / negatives closest to the
+ *               threshold with the template that scored them
+ *
+ * --exhaustive also scans every frame with plain TemplateMatch_Search and
+ * counts the frames where the coarse-to-fine search lost score or flipped
+ * a decision. --min-recall / --min-precision make the run fail below
+ * those values at the profile threshold, so a frame set can serve as a
+ * regression suite for matcher changes.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "template_match.h"
+#include "game_profile.h"
+#include "gdiplus_api.h"
+#include "parallel.h"
+#include "logger.h"
+#include "mem_utils.h"
+#include "bench_common.h"
+
+#define MAX_ITERATIONS      32
+#define MAX_DIRS            8
+#define MAX_SCALES          8
+#define MAX_TEMPLATES       16
+#define MAX_ITEMS           (MAX_TEMPLATES * MAX_SCALES)
+#define MAX_THREADS         4           /* kill_feed_sampler.c SCAN_MAX_THREADS */
+#define MAX_TEMPLATE_SIZE   1024        /* LoadTemplatePNG's limit */
+#define MAX_FRAME_SIZE      4096
+#define SCORE_EPSILON       0.005f      /* Pyramid vs exhaustive: same score */
+
+/* Kill-feed sampler defaults (TEMPLATE_SCALES) */
+static const float DEFAULT_SCALES[] = { 1.0f, 1.5f, 2.0f, 0.75f };
+
+typedef struct {
+    const char* profileId;
+    const char* templatesDir;   // Overrides the profile's templates
+    const char* posDirs[MAX_DIRS];
+    int posDirCount;
+    const char* negDirs[MAX_DIRS];
+    int negDirCount;
+    float scales[MAX_SCALES];
+    int scaleCount;
+    float threshold;            // < 0: the profile's
+    int iterations;
+    int kernel;                 // < 0: the best the CPU has
+    BOOL exhaustive;
+    float minRecall;            // < 0: no gate
+    float minPrecision;
+    int listCount;              // Frames listed per class nearest the threshold
+} BenchOptions;
+
+typedef struct {
+    char name[32];
+    int w, h;                   // Scale 1.0
+    MatchTemplatePyramid scaled[MAX_SCALES];    // w == 0: scale rounds to nothing
+} BenchTemplate;
+
+/* One template at one scale, as a ScanItem of the sampler */
+typedef struct {
+    int tmpl;
+    int scale;
+    double ms[MAX_ITERATIONS];  // Summed over all frames, per iteration
+    int wins;                   // Positives it scored best on
+    float bestPositive;
+} BenchItem;
+
+typedef struct {
+    char name[64];
+    BOOL positive;
+    BYTE* gray;
+    int w, h;
+    float best;                 // Pyramid search
+    int bestItem;               // -1 if no template fits
+    int x, y;
+    float exhaustiveBest;
+} BenchFrame;
+
+typedef struct {
+    BenchTemplate templates[MAX_TEMPLATES];
+    int templateCount;
+    BenchItem items[MAX_ITEMS];
+    int itemCount;
+    BenchFrame* frames;
+    int frameCount;
+    int frameCap;
+    float threshold;
+    float scales[MAX_SCALES];
+    int scaleCount;
+} BenchState;
+
+/* Shared by the items of one fanned-out scan */
+typedef struct {
+    BenchState* state;
+    MatchImagePyramid* img;
+    MatchScratch* scratch;
+    volatile LONG scratchBusy[MAX_THREADS];
+    MatchResult results[MAX_ITEMS];
+} ParallelScan;
+
+static const MatchTemplatePyramid* ItemTemplate(const BenchState* st, int item) {
+    return &st->templates[st->items[item].tmpl].scaled[st->items[item].scale];
+}
+
+/* ============================================================================
+ * IMAGES
+ * ============================================================================
+ */
+
+typedef void* GpBitmap;
+
+typedef struct {
+    INT X, Y, Width, Height;
+} GpRect;
+
+typedef struct {
+    UINT Width;
+    UINT Height;
+    INT Stride;
+    INT PixelFormat;
+    void* Scan0;
+    UINT_PTR Reserved;
+} BitmapData;
+
+#define PixelFormat32bppARGB  0x26200A
+#define ImageLockModeRead     1
+
+typedef GpStatus (WINAPI *fn_GdipCreateBitmapFromFile)(const WCHAR*, GpBitmap**);
+typedef GpStatus (WINAPI *fn_GdipGetImageWidth)(void*, UINT*);
+typedef GpStatus (WINAPI *fn_GdipGetImageHeight)(void*, UINT*);
+typedef GpStatus (WINAPI *fn_GdipBitmapLockBits)(GpBitmap*, const GpRect*, UINT, INT, BitmapData*);
+typedef GpStatus (WINAPI *fn_GdipBitmapUnlockBits)(GpBitmap*, BitmapData*);
+typedef GpStatus (WINAPI *fn_GdipDisposeImage)(void*);
+
+static struct {
+    fn_GdipCreateBitmapFromFile create;
+    fn_GdipGetImageWidth getWidth;
+    fn_GdipGetImageHeight getHeight;
+    fn_GdipBitmapLockBits lock;
+    fn_GdipBitmapUnlockBits unlock;
+    fn_GdipDisposeImage dispose;
+} g_image;
+
+static BOOL ImageLoaderInit(void) {
+    if (!GdiplusAPI_Init()) return FALSE;
+    HMODULE mod = g_gdip.module;
+    g_image.create = (fn_GdipCreateBitmapFromFile)GetProcAddress(mod, "GdipCreateBitmapFromFile");
+    g_image.getWidth = (fn_GdipGetImageWidth)GetProcAddress(mod, "GdipGetImageWidth");
+    g_image.getHeight = (fn_GdipGetImageHeight)GetProcAddress(mod, "GdipGetImageHeight");
+    g_image.lock = (fn_GdipBitmapLockBits)GetProcAddress(mod, "GdipBitmapLockBits");
+    g_image.unlock = (fn_GdipBitmapUnlockBits)GetProcAddress(mod, "GdipBitmapUnlockBits");
+    g_image.dispose = (fn_GdipDisposeImage)GetProcAddress(mod, "GdipDisposeImage");
+    return g_image.create && g_image.getWidth && g_image.getHeight &&
+           g_image.lock && g_image.unlock && g_image.dispose;
+}
+
+// BMP or PNG to tightly packed gray, converted exactly as the sampler
+// converts both templates and regions. NULL if unreadable or over maxSize.
+static BYTE* LoadGray(const char* path, int maxSize, int* outW, int* outH) {
+    wchar_t wPath[MAX_PATH];
+    if (MultiByteToWideChar(CP_ACP, 0, path, -1, wPath, MAX_PATH) <= 0) return NULL;
+
+    GpBitmap* bitmap = NULL;
+    if (g_image.create(wPath, &bitmap) != GdipOk || !bitmap) return NULL;
+
+    BYTE* gray = NULL;
+    UINT w = 0, h = 0;
+    if (g_image.getWidth(bitmap, &w) != GdipOk || g_image.getHeight(bitmap, &h) != GdipOk ||
+        w == 0 || h == 0 || w > (UINT)maxSize || h > (UINT)maxSize) {
+        g_image.dispose(bitmap);
+        return NULL;
+    }
+
+    GpRect rect = { 0, 0, (INT)w, (INT)h };
+    BitmapData data = { 0 };
+    if (g_image.lock(bitmap, &rect, ImageLockModeRead, PixelFormat32bppARGB, &data) == GdipOk) {
+        gray = (BYTE*)malloc((size_t)w * h);
+        if (gray) {
+            for (UINT y = 0; y < h; y++) {
+                const BYTE* row = (const BYTE*)data.Scan0 + (size_t)y * data.Stride;
+                for (UINT x = 0; x < w; x++) {
+                    BYTE b = row[x * 4 + 0];
+                    BYTE g = row[x * 4 + 1];
+                    BYTE r = row[x * 4 + 2];
+                    gray[(size_t)y * w + x] = (BYTE)((r * 299 + g * 587 + b * 114) / 1000);
+                }
+            }
+        }
+        g_image.unlock(bitmap, &data);
+    }
+    g_image.dispose(bitmap);
+
+    *outW = (int)w;
+    *outH = (int)h;
+    return gray;
+}
+
+// Nearest neighbour, as the sampler scales its templates
+static BYTE* ScaleGray(const BYTE* src, int srcW, int srcH, float scale, int* outW, int* outH) {
+    *outW = (int)(srcW * scale + 0.5f);
+    *outH = (int)(srcH * scale + 0.5f);
+    if (*outW <= 0 || *outH <= 0) return NULL;
+
+    BYTE* dst = (BYTE*)malloc((size_t)(*outW) * (*outH));
+    if (!dst) return NULL;
+    for (int y = 0; y < *outH; y++) {
+        int srcY = min((int)(y / scale), srcH - 1);
+        for (int x = 0; x < *outW; x++) {
+            int srcX = min((int)(x / scale), srcW - 1);
+            dst[y * (*outW) + x] = src[srcY * srcW + srcX];
+        }
+    }
+    return dst;
+}
+
+static void BaseName(const char* path, char* out, size_t outSize) {
+    const char* base = strrchr(path, '\\');
+    base = base ? base + 1 : path;
+    strncpy_s(out, outSize, base, _TRUNCATE);
+    char* dot = strrchr(out, '.');
+    if (dot) *dot = '\0';
+}
+
+/* ============================================================================
+ * TEMPLATES
+ * ============================================================================
+ */
+
+static BOOL AddTemplate(BenchState* st, const char* path) {
+    if (st->templateCount >= MAX_TEMPLATES) {
+        printf("%s: more than %d templates, ignored\n", path, MAX_TEMPLATES);
+        return FALSE;
+    }
+    int w = 0, h = 0;
+    BYTE* gray = LoadGray(path, MAX_TEMPLATE_SIZE, &w, &h);
+    if (!gray) {
+        printf("%s: cannot load template\n", path);
+        return FALSE;
+    }
+
+    BenchTemplate* t = &st->templates[st->templateCount];
+    ZeroMemory(t, sizeof(*t));
+    BaseName(path, t->name, sizeof(t->name));
+    t->w = w;
+    t->h = h;
+    int built = 0;
+    for (int s = 0; s < st->scaleCount; s++) {
+        if (st->scales[s] == 1.0f) {
+            if (MatchTemplatePyramid_Init(&t->scaled[s], gray, w, h)) built++;
+            continue;
+        }
+        int scaledW, scaledH;
+        BYTE* scaled = ScaleGray(gray, w, h, st->scales[s], &scaledW, &scaledH);
+        if (!scaled) continue;
+        if (MatchTemplatePyramid_Init(&t->scaled[s], scaled, scaledW, scaledH)) built++;
+        free(scaled);
+    }
+    free(gray);
+    if (built == 0) {
+        printf("%s: no usable scale\n", path);
+        return FALSE;
+    }
+    st->templateCount++;
+    return TRUE;
+}
+
+// Every *.png in dir
+static BOOL LoadTemplateDir(BenchState* st, const char* dir) {
+    char glob[MAX_PATH];
+    snprintf(glob, sizeof(glob), "%s\\*.png", dir);
+    WIN32_FIND_DATAA fd;
+    HANDLE find = FindFirstFileA(glob, &fd);
+    if (find == INVALID_HANDLE_VALUE) {
+        printf("%s: no PNG templates\n", dir);
+        return FALSE;
+    }
+    do {
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%s\\%s", dir, fd.cFileName);
+        AddTemplate(st, path);
+    } while (FindNextFileA(find, &fd));
+    FindClose(find);
+    return st->templateCount > 0;
+}
+
+// The profile's templates from <exeDir>\static\<templatesDir>\<name>.png
+static BOOL LoadProfileTemplates(BenchState* st, const GameProfile* profile) {
+    char exeDir[MAX_PATH];
+    DWORD n = GetModuleFileNameA(NULL, exeDir, MAX_PATH);
+    if (n == 0 || n >= MAX_PATH) return FALSE;
+    char* slash = strrchr(exeDir, '\\');
+    if (slash) *(slash + 1) = '\0';
+
+    const char* subdir = profile->templatesDir[0] ? profile->templatesDir : profile->id;
+    for (int i = 0; i < profile->templateCount; i++) {
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%sstatic\\%s\\%s.png", exeDir, subdir, profile->templates[i]);
+        AddTemplate(st, path);
+    }
+    return st->templateCount > 0;
+}
+
+// Every template x scale that fits somewhere, largest area first (the
+// order the sampler hands items to its threads)
+static void BuildItems(BenchState* st) {
+    st->itemCount = 0;
+    for (int i = 0; i < st->templateCount; i++) {
+        for (int s = 0; s < st->scaleCount; s++) {
+            const MatchTemplate* t = &st->templates[i].scaled[s].fine;
+            if (t->w <= 0) continue;
+            int area = t->w * t->h;
+            int k = st->itemCount++;
+            while (k > 0 && ItemTemplate(st, k - 1)->fine.w * ItemTemplate(st, k - 1)->fine.h < area) {
+                st->items[k] = st->items[k - 1];
+                k--;
+            }
+            ZeroMemory(&st->items[k], sizeof(st->items[k]));
+            st->items[k].tmpl = i;
+            st->items[k].scale = s;
+            st->items[k].bestPositive = -1.0f;
+        }
+    }
+}
+
+/* ============================================================================
+ * FRAMES
+ * ============================================================================
+ */
+
+static int LoadFrameDir(BenchState* st, const char* dir, BOOL positive) {
+    char glob[MAX_PATH];
+    snprintf(glob, sizeof(glob), "%s\\*", dir);
+    WIN32_FIND_DATAA fd;
+    HANDLE find = FindFirstFileA(glob, &fd);
+    if (find == INVALID_HANDLE_VALUE) {
+        printf("%s: cannot list\n", dir);
+        return 0;
+    }
+
+    int loaded = 0;
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        const char* ext = strrchr(fd.cFileName, '.');
+        if (!ext || (_stricmp(ext, ".bmp") != 0 && _stricmp(ext, ".png") != 0)) continue;
+
+        if (st->frameCount == st->frameCap) {
+            int cap = st->frameCap ? st->frameCap * 2 : 64;
+            BenchFrame* grown = (BenchFrame*)realloc(st->frames, (size_t)cap * sizeof(BenchFrame));
+            if (!grown) break;
+            st->frames = grown;
+            st->frameCap = cap;
+        }
+
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%s\\%s", dir, fd.cFileName);
+        BenchFrame* f = &st->frames[st->frameCount];
+        ZeroMemory(f, sizeof(*f));
+        f->gray = LoadGray(path, MAX_FRAME_SIZE, &f->w, &f->h);
+        if (!f->gray) {
+            printf("%s: cannot load frame\n", path);
+            continue;
+        }
+        BaseName(path, f->name, sizeof(f->name));
+        f->positive = positive;
+        st->frameCount++;
+        loaded++;
+    } while (FindNextFileA(find, &fd));
+    FindClose(find);
+    return loaded;
+}
+
+/* ============================================================================
+ * SCANS
+ * ============================================================================
+ */
+
+// One thread, every item in turn; per-item time added to itemMs
+static void ScanFrame(BenchState* st, BenchFrame* f, MatchImagePyramid* img, MatchScratch* scratch,
+                      int iteration, LARGE_INTEGER freq) {
+    f->best = -1.0f;
+    f->bestItem = -1;
+    if (!MatchImagePyramid_Set(img, f->gray, f->w, f->h)) return;
+    MatchImagePyramid_PrepareSpectrum(img);
+
+    for (int i = 0; i < st->itemCount; i++) {
+        LARGE_INTEGER start;
+        MatchResult r;
+        QueryPerformanceCounter(&start);
+        TemplateMatch_SearchPyramid(img, ItemTemplate(st, i), scratch, &r);
+        st->items[i].ms[iteration] += Bench_ElapsedMs(start, freq);
+        if (r.score > f->best) {
+            f->best = r.score;
+            f->bestItem = i;
+            f->x = r.x;
+            f->y = r.y;
+        }
+    }
+}
+
+// ParallelBody: one item of a fanned-out scan (SearchScanItem without the
+// early exit, so every scan does the same work)
+static void SearchParallelItem(void* context, int index) {
+    ParallelScan* job = (ParallelScan*)context;
+    int slot = 0;
+    for (;;) {
+        if (InterlockedCompareExchange(&job->scratchBusy[slot], 1, 0) == 0) break;
+        slot = (slot + 1) % MAX_THREADS;
+        if (slot == 0) YieldProcessor();
+    }
+    TemplateMatch_SearchPyramid(job->img, ItemTemplate(job->state, index), &job->scratch[slot],
+                                &job->results[index]);
+    InterlockedExchange(&job->scratchBusy[slot], 0);
+}
+
+// Plain TemplateMatch_Search of every item at full resolution
+static float ScanFrameExhaustive(BenchState* st, const BenchFrame* f, MatchImagePyramid* img,
+                                 MatchScratch* scratch) {
+    float best = -1.0f;
+    if (!MatchImagePyramid_Set(img, f->gray, f->w, f->h)) return best;
+    MatchImage_PrepareSpectrum(&img->fine);
+    for (int i = 0; i < st->itemCount; i++) {
+        MatchResult r;
+        TemplateMatch_Search(&img->fine, &ItemTemplate(st, i)->fine, scratch, &r);
+        if (r.score > best) best = r.score;
+    }
+    return best;
+}
+
+/* ============================================================================
+ * REPORT
+ * ============================================================================
+ */
+
+static void PrintAccuracyRow(const BenchState* st, float threshold, BOOL operating,
+                             float* outPrecision, float* outRecall) {
+    int tp = 0, fp = 0, positives = 0;
+    for (int i = 0; i < st->frameCount; i++) {
+        const BenchFrame* f = &st->frames[i];
+        if (f->positive) positives++;
+        if (f->best >= threshold) {
+            if (f->positive) tp++;
+            else fp++;
+        }
+    }
+    float precision = tp + fp ? (float)tp / (float)(tp + fp) : 1.0f;
+    float recall = positives ? (float)tp / (float)positives : 1.0f;
+    printf("%c %9.2f %6d %6d %6d %10.3f %8.3f\n", operating ? '*' : ' ', threshold,
+           tp, fp, positives - tp, precision, recall);
+    if (outPrecision) *outPrecision = precision;
+    if (outRecall) *outRecall = recall;
+}
+
+static void PrintScoreSpread(const BenchState* st, BOOL positive) {
+    double* scores = (double*)malloc((size_t)st->frameCount * sizeof(double));
+    if (!scores) return;
+    int count = 0;
+    for (int i = 0; i < st->frameCount; i++)
+        if (st->frames[i].positive == positive) scores[count++] = st->frames[i].best;
+    if (count > 0) {
+        double median = Bench_Median(scores, count);
+        printf("%-10s %6d %8.3f %8.3f %8.3f\n", positive ? "positive" : "negative", count,
+               scores[0], median, scores[count - 1]);
+    }
+    free(scores);
+}
+
+/* qsort context for PrintHardest */
+static const BenchFrame* g_sortFrames;
+static BOOL g_sortAscending;
+
+static int CompareFrameScore(const void* a, const void* b) {
+    float x = g_sortFrames[*(const int*)a].best, y = g_sortFrames[*(const int*)b].best;
+    return g_sortAscending ? (x > y) - (x < y) : (x < y) - (x > y);
+}
+
+// Positives lowest first, negatives highest first: nearest the threshold
+static void PrintHardest(const BenchState* st, BOOL positive, int listCount) {
+    int* order = (int*)malloc((size_t)st->frameCount * sizeof(int));
+    if (!order) return;
+    int count = 0;
+    for (int i = 0; i < st->frameCount; i++)
+        if (st->frames[i].positive == positive) order[count++] = i;
+    g_sortFrames = st->frames;
+    g_sortAscending = positive;
+    qsort(order, (size_t)count, sizeof(int), CompareFrameScore);
+
+    for (int k = 0; k < count && k < listCount; k++) {
+        const BenchFrame* f = &st->frames[order[k]];
+        if (f->bestItem < 0) {
+            printf("%-8s %-32s  no template fits %dx%d\n", positive ? "pos" : "neg", f->name, f->w, f->h);
+            continue;
+        }
+        const BenchItem* item = &st->items[f->bestItem];
+        printf("%-8s %-32s %6.3f  %s x%.2f at %d,%d\n", positive ? "pos" : "neg", f->name, f->best,
+               st->templates[item->tmpl].name, st->scales[item->scale], f->x, f->y);
+    }
+    free(order);
+}
+
+/* ============================================================================
+ * COMMAND LINE
+ * ============================================================================
+ */
+
+static void Usage(void) {
+    printf("usage: lwsr_detect_bench [options] --pos DIR [--neg DIR]\n"
+           "  --pos DIR          frames that should trigger (BMP/PNG regions); repeatable\n"
+           "  --neg DIR          frames that should not; repeatable\n"
+           "  --profile ID       game profile for templates and threshold (marathon)\n"
+           "  --templates DIR    every PNG in DIR instead of the profile's templates\n"
+           "  --scales A,B,...   template scales (1,1.5,2,0.75, as the sampler)\n"
+           "  --threshold T      operating threshold (the profile's, else 0.80)\n"
+           "  --iterations N     timed passes over the frames, median reported (3, max %d)\n"
+           "  --kernel NAME      scalar, sse2 or avx2 (best the CPU has)\n"
+           "  --exhaustive       also compare against full-resolution search\n"
+           "  --min-recall R     fail if recall at the threshold is below R\n"
+           "  --min-precision P  fail if precision at the threshold is below P\n"
+           "  --list N           frames listed per class nearest the threshold (5)\n"
+           "Templates and profiles are found beside the exe (games\\, static\\) as the app finds them.\n",
+           MAX_ITERATIONS);
+}
+
+static BOOL ParseScales(const char* list, float* scales, int* count) {
+    char copy[128];
+    strncpy_s(copy, sizeof(copy), list, _TRUNCATE);
+    char* context = NULL;
+    *count = 0;
+    for (char* tok = strtok_s(copy, ",", &context); tok; tok = strtok_s(NULL, ",", &context)) {
+        if (*count >= MAX_SCALES) return FALSE;
+        float s = (float)atof(tok);
+        if (s <= 0.0f || s > 8.0f) return FALSE;
+        scales[(*count)++] = s;
+    }
+    return *count > 0;
+}
+
+static BOOL ParseOptions(int argc, char** argv, BenchOptions* opt) {
+    ZeroMemory(opt, sizeof(*opt));
+    opt->profileId = "marathon";
+    opt->threshold = -1.0f;
+    opt->iterations = 3;
+    opt->kernel = -1;
+    opt->minRecall = -1.0f;
+    opt->minPrecision = -1.0f;
+    opt->listCount = 5;
+    opt->scaleCount = (int)(sizeof(DEFAULT_SCALES) / sizeof(DEFAULT_SCALES[0]));
+    memcpy(opt->scales, DEFAULT_SCALES, sizeof(DEFAULT_SCALES));
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--exhaustive") == 0) {
+            opt->exhaustive = TRUE;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) return FALSE;
+        i++;
+        if (strcmp(arg, "--pos") == 0) {
+            if (opt->posDirCount >= MAX_DIRS) return FALSE;
+            opt->posDirs[opt->posDirCount++] = value;
+        } else if (strcmp(arg, "--neg") == 0) {
+            if (opt->negDirCount >= MAX_DIRS) return FALSE;
+            opt->negDirs[opt->negDirCount++] = value;
+        }
+        else if (strcmp(arg, "--profile") == 0) opt->profileId = value;
+        else if (strcmp(arg, "--templates") == 0) opt->templatesDir = value;
+        else if (strcmp(arg, "--scales") == 0) { if (!ParseScales(value, opt->scales, &opt->scaleCount)) return FALSE; }
+        else if (strcmp(arg, "--threshold") == 0) opt->threshold = (float)atof(value);
+        else if (strcmp(arg, "--iterations") == 0) opt->iterations = atoi(value);
+        else if (strcmp(arg, "--min-recall") == 0) opt->minRecall = (float)atof(value);
+        else if (strcmp(arg, "--min-precision") == 0) opt->minPrecision = (float)atof(value);
+        else if (strcmp(arg, "--list") == 0) opt->listCount = atoi(value);
+        else if (strcmp(arg, "--kernel") == 0) {
+            if (_stricmp(value, "scalar") == 0) opt->kernel = TEMPLATE_MATCH_SCALAR;
+            else if (_stricmp(value, "sse2") == 0) opt->kernel = TEMPLATE_MATCH_SSE2;
+            else if (_stricmp(value, "avx2") == 0) opt->kernel = TEMPLATE_MATCH_AVX2;
+            else return FALSE;
+        }
+        else return FALSE;
+    }
+
+    return opt->posDirCount + opt->negDirCount > 0 && opt->iterations > 0 &&
+           opt->iterations <= MAX_ITERATIONS && opt->threshold <= 1.0f && opt->listCount >= 0;
+}
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================
+ */
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    if (!ParseOptions(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    /* Module logs go to a file, results to stdout */
+    Logger_Init("detect_bench.log", "w");
+
+    int exitCode = 1;
+    BenchState* st = (BenchState*)calloc(1, sizeof(BenchState));
+    MatchImagePyramid img;
+    MatchScratch scratch[MAX_THREADS];
+    ZeroMemory(&img, sizeof(img));
+    ZeroMemory(scratch, sizeof(scratch));
+    if (!st) goto cleanup;
+
+    if (!ImageLoaderInit()) {
+        printf("GDI+ unavailable: cannot load images\n");
+        goto cleanup;
+    }
+
+    st->scaleCount = opt.scaleCount;
+    memcpy(st->scales, opt.scales, sizeof(opt.scales));
+    st->threshold = opt.threshold;
+
+    const char* source = opt.templatesDir;
+    if (opt.templatesDir) {
+        if (!LoadTemplateDir(st, opt.templatesDir)) goto cleanup;
+    } else {
+        GameProfile_LoadCatalog();
+        const GameProfile* profile = GameProfile_FindById(opt.profileId);
+        if (!profile) {
+            printf("profile '%s' not found in games\\*.ini beside the exe (use --templates DIR)\n",
+                   opt.profileId);
+            goto cleanup;
+        }
+        if (!LoadProfileTemplates(st, profile)) goto cleanup;
+        if (st->threshold < 0) st->threshold = profile->templateThreshold;
+        source = profile->id;
+    }
+    if (st->threshold < 0) st->threshold = 0.80f;
+    BuildItems(st);
+
+    for (int i = 0; i < opt.posDirCount; i++) LoadFrameDir(st, opt.posDirs[i], TRUE);
+    for (int i = 0; i < opt.negDirCount; i++) LoadFrameDir(st, opt.negDirs[i], FALSE);
+    if (st->frameCount == 0) {
+        printf("no frames loaded\n");
+        goto cleanup;
+    }
+
+    if (opt.kernel >= 0) TemplateMatch_SetKernel((TemplateMatchKernel)opt.kernel);
+    int threads = min(max(Parallel_WorkerCount() / 2, 1), MAX_THREADS);
+    int positives = 0;
+    for (int i = 0; i < st->frameCount; i++) positives += st->frames[i].positive;
+
+    printf("lwsr_detect_bench: %s, %d template(s) x %d scale(s) = %d searches/scan, kernel %s\n",
+           source, st->templateCount, st->scaleCount, st->itemCount,
+           TemplateMatch_KernelName(TemplateMatch_GetKernel()));
+    printf("  %d frame(s): %d positive, %d negative; %d iteration(s); threshold %.2f\n",
+           st->frameCount, positives, st->frameCount - positives, opt.iterations, st->threshold);
+
+    exitCode = 0;
+    LARGE_INTEGER freq, start;
+    QueryPerformanceFrequency(&freq);
+
+    /* Speed: one thread, then the sampler's fan-out */
+    double seqMs[MAX_ITERATIONS], parMs[MAX_ITERATIONS];
+    for (int it = 0; it < opt.iterations; it++) {
+        QueryPerformanceCounter(&start);
+        for (int f = 0; f < st->frameCount; f++) ScanFrame(st, &st->frames[f], &img, &scratch[0], it, freq);
+        seqMs[it] = Bench_ElapsedMs(start, freq);
+    }
+
+    ParallelScan* job = (ParallelScan*)calloc(1, sizeof(ParallelScan));
+    if (!job) {
+        exitCode = 1;
+        goto cleanup;
+    }
+    job->state = st;
+    job->img = &img;
+    job->scratch = scratch;
+    int parallelMismatch = 0;
+    for (int it = 0; it < opt.iterations; it++) {
+        QueryPerformanceCounter(&start);
+        for (int f = 0; f < st->frameCount; f++) {
+            const BenchFrame* frame = &st->frames[f];
+            if (!MatchImagePyramid_Set(&img, frame->gray, frame->w, frame->h)) continue;
+            MatchImagePyramid_PrepareSpectrum(&img);
+            Parallel_ForLimited(st->itemCount, threads, SearchParallelItem, job);
+
+            float best = -1.0f;
+            for (int i = 0; i < st->itemCount; i++) best = max(best, job->results[i].score);
+            if (it == 0 && best != frame->best) parallelMismatch++;
+        }
+        parMs[it] = Bench_ElapsedMs(start, freq);
+    }
+    free(job);
+
+    double seq = Bench_Median(seqMs, opt.iterations), par = Bench_Median(parMs, opt.iterations);
+    printf("\n%-28s %10s %10s\n", "scan", "ms/scan", "scans/s");
+    printf("%-28s %10.3f %10.1f\n", "1 thread", seq / st->frameCount,
+           seq > 0 ? st->frameCount * 1000.0 / seq : 0);
+    char label[40];
+    snprintf(label, sizeof(label), "%d thread(s)", threads);
+    printf("%-28s %10.3f %10.1f\n", label, par / st->frameCount,
+           par > 0 ? st->frameCount * 1000.0 / par : 0);
+    if (parallelMismatch) {
+        printf("MISMATCH: %d frame(s) scored differently when fanned out\n", parallelMismatch);
+        exitCode = 1;
+    }
+
+    /* Per template x scale, attributed from the last pass */
+    for (int f = 0; f < st->frameCount; f++) {
+        const BenchFrame* frame = &st->frames[f];
+        if (!frame->positive || frame->bestItem < 0) continue;
+        BenchItem* item = &st->items[frame->bestItem];
+        item->wins++;
+        item->bestPositive = max(item->bestPositive, frame->best);
+    }
+    printf("\n%-24s %6s %9s %10s %6s %9s\n", "template", "scale", "size", "ms/scan", "wins", "best pos");
+    for (int i = 0; i < st->itemCount; i++) {
+        BenchItem* item = &st->items[i];
+        const MatchTemplate* t = &ItemTemplate(st, i)->fine;
+        char size[16];
+        snprintf(size, sizeof(size), "%dx%d", t->w, t->h);
+        double ms = Bench_Median(item->ms, opt.iterations) / st->frameCount;
+        printf("%-24s %6.2f %9s %10.3f %6d %9.3f\n", st->templates[item->tmpl].name,
+               st->scales[item->scale], size, ms, item->wins, item->bestPositive);
+    }
+
+    /* Accuracy */
+    printf("\n  %9s %6s %6s %6s %10s %8s\n", "threshold", "TP", "FP", "FN", "precision", "recall");
+    for (int k = 10; k <= 19; k++) PrintAccuracyRow(st, k * 0.05f, FALSE, NULL, NULL);
+    float precision = 0, recall = 0;
+    PrintAccuracyRow(st, st->threshold, TRUE, &precision, &recall);
+
+    printf("\n%-10s %6s %8s %8s %8s\n", "best", "frames", "min", "median", "max");
+    PrintScoreSpread(st, TRUE);
+    PrintScoreSpread(st, FALSE);
+
+    if (opt.listCount > 0) {
+        printf("\nnearest the threshold:\n");
+        PrintHardest(st, TRUE, opt.listCount);
+        PrintHardest(st, FALSE, opt.listCount);
+    }
+
+    /* Coarse-to-fine against the full-resolution search */
+    if (opt.exhaustive) {
+        int lower = 0, flipped = 0;
+        float worst = 0;
+        QueryPerformanceCounter(&start);
+        for (int f = 0; f < st->frameCount; f++) {
+            BenchFrame* frame = &st->frames[f];
+            frame->exhaustiveBest = ScanFrameExhaustive(st, frame, &img, &scratch[0]);
+            float loss = frame->exhaustiveBest - frame->best;
+            if (loss > SCORE_EPSILON) lower++;
+            if (loss > worst) worst = loss;
+            if ((frame->best >= st->threshold) != (frame->exhaustiveBest >= st->threshold)) flipped++;
+        }
+        double ms = Bench_ElapsedMs(start, freq);
+        printf("\nexhaustive %10.3f ms/scan; pyramid lower on %d frame(s) (worst -%.3f), "
+               "%d decision(s) flipped\n", ms / st->frameCount, lower, worst, flipped);
+    }
+
+    /* Regression gates */
+    if (opt.minRecall >= 0 && recall < opt.minRecall) {
+        printf("\nFAIL: recall %.3f < %.3f at %.2f\n", recall, opt.minRecall, st->threshold);
+        exitCode = 1;
+    }
+    if (opt.minPrecision >= 0 && precision < opt.minPrecision) {
+        printf("\nFAIL: precision %.3f < %.3f at %.2f\n", precision, opt.minPrecision, st->threshold);
+        exitCode = 1;
+    }
+
+cleanup:
+    MatchImagePyramid_Free(&img);
+    for (int i = 0; i < MAX_THREADS; i++) MatchScratch_Free(&scratch[i]);
+    if (st) {
+        for (int i = 0; i < st->templateCount; i++)
+            for (int s = 0; s < st->scaleCount; s++) MatchTemplatePyramid_Free(&st->templates[i].scaled[s]);
+        for (int i = 0; i < st->frameCount; i++) SAFE_FREE(st->frames[i].gray);
+        SAFE_FREE(st->frames);
+        free(st);
+    }
+    GameProfile_Shutdown();
+    GdiplusAPI_Shutdown();
+    Logger_Shutdown();
+    return exitCode;
+}
@@ -0,0 +1,484 @@
+/*
+ * mux_bench.c - Save throughput benchmark for the muxer layer
+ *
+ * BUILD: build.bat bench  ->  bin\lwsr_mux_bench.exe (console)
+ *
+ * Feeds a synthetic HEVC + AAC stream through each muxer path and reports
+ * what a save costs there, so a muxer change can be compared against the
+ * previous build on the same machine instead of by "F5 feels slow":
+ *
+ *   mf          MP4Muxer_WriteFileWithMultiAudio (Media Foundation batch)
+ *   native      MP4Writer_WriteFile (replay saves)
+ *   stream      StreamingMuxer, sink writer (recordings, FragmentedRecording=0)
+ *   fragmented  StreamingMuxer, fragmented MP4 (recordings, default)
+ *
+ * The streaming paths take one audio track (their API has one); the batch
+ * paths take all of them.
+ *
+ * Per path, over N iterations: wall time (median), MB/s of output file,
+ * samples/s, time to first byte (median; from the call until the output
+ * file is non-empty) and peak working set above the pre-run baseline (max).
+ * A monitor thread samples the working set and file size every
+ * millisecond, so peaks shorter than that can be missed.
+ *
+ * The stream is not decodable video: frames are Annex-B with real NAL
+ * headers and a fixed 1280x720 VPS/SPS/PPS on every IDR (what the muxers
+ * look at), GOP_LENGTH_FRAMES_AT(fps) frames per GOP, IDRs 4x the average
+ * frame size; the payload bytes are pseudo-random with the high bit set so
+ * they never form a start code. Output goes to --out (default %TEMP%) and
+ * is deleted after each run unless --keep.
+ */
+
+#include <initguid.h>        /* Media type GUIDs, as in main.c */
+#include <windows.h>
+#include <psapi.h>
+#include <mfapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mp4_muxer.h"
+#include "mp4_writer.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include "bench_common.h"
+
+#define MAX_ITERATIONS      32
+#define AAC_SAMPLE_RATE     48000
+#define AAC_BITRATE         192000
+
+typedef enum {
+    PATH_MF = 0,
+    PATH_NATIVE,
+    PATH_STREAM,
+    PATH_FRAGMENTED,
+    PATH_COUNT
+} BenchPath;
+
+static const char* const PATH_NAMES[PATH_COUNT] = { "mf", "native", "stream", "fragmented" };
+
+typedef struct {
+    int width;
+    int height;
+    int fps;
+    double mbps;                // Video bitrate
+    int seconds;
+    int audioTracks;
+    int iterations;
+    BOOL paths[PATH_COUNT];
+    BOOL keep;
+    char outDir[MAX_PATH];
+} BenchOptions;
+
+/* The synthetic clip, generated once and shared by every run */
+typedef struct {
+    MuxerConfig video;
+    MuxerSample* videoSamples;
+    int videoCount;
+    MuxerAudioSample* audioSamples[MAX_AUDIO_TRACKS];
+    MuxerAudioConfig audioConfig;
+    int audioCount;
+    int audioTracks;
+    UINT64 payloadBytes;
+} BenchClip;
+
+typedef struct {
+    BOOL ok;
+    double ms;
+    double ttfbMs;              // < 0: never saw a byte
+    SIZE_T peakBytes;           // Working set above baseline
+    UINT64 fileBytes;
+} BenchRun;
+
+/* ============================================================================
+ * SYNTHETIC STREAM
+ * ============================================================================
+ */
+
+/* 1280x720 Main profile VPS/SPS/PPS (Annex-B) */
+static const BYTE SEQ_HEADER[] = {
+    0, 0, 0, 1, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0, 0, 3, 0, 0x90, 0, 0, 3,
+    0, 0, 3, 0, 0x5d, 0x95, 0x98, 0x09,
+    0, 0, 0, 1, 0x42, 0x01, 0x01, 0x01, 0x60, 0, 0, 3, 0, 0x90, 0, 0, 3, 0, 0, 3, 0, 0x5d,
+    0xa0, 0x02, 0x80, 0x80, 0x2d, 0x16, 0x59, 0x59, 0xa4, 0x93, 0x2b, 0xc0, 0x5a, 0x70, 0x80,
+    0, 1, 0xf4, 0x80, 0, 0x3a, 0x98, 0x04,
+    0, 0, 0, 1, 0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40
+};
+
+/* AAC-LC, 48 kHz, stereo */
+static BYTE g_audioSpecificConfig[2] = { 0x11, 0x90 };
+
+static UINT32 g_rng = 0x9E3779B9u;
+
+static void FillPayload(BYTE* p, DWORD n) {
+    for (DWORD i = 0; i < n; i++) {
+        g_rng ^= g_rng << 13;
+        g_rng ^= g_rng >> 17;
+        g_rng ^= g_rng << 5;
+        p[i] = (BYTE)(0x80 | (g_rng & 0x7F));
+    }
+}
+
+static BYTE* MakeFrame(BOOL keyframe, DWORD payloadSize, DWORD* size) {
+    DWORD total = (keyframe ? (DWORD)sizeof(SEQ_HEADER) : 0) + 6 + payloadSize;
+    BYTE* d = (BYTE*)malloc(total);
+    if (!d) return NULL;
+
+    DWORD o = 0;
+    if (keyframe) {
+        memcpy(d, SEQ_HEADER, sizeof(SEQ_HEADER));
+        o = sizeof(SEQ_HEADER);
+    }
+    d[o++] = 0; d[o++] = 0; d[o++] = 0; d[o++] = 1;
+    d[o++] = keyframe ? (19 << 1) : (1 << 1);       /* IDR_W_RADL / TRAIL_R */
+    d[o++] = 1;
+    FillPayload(d + o, payloadSize);
+    *size = total;
+    return d;
+}
+
+static void FreeClip(BenchClip* clip) {
+    if (clip->videoSamples) {
+        for (int i = 0; i < clip->videoCount; i++) SAFE_FREE(clip->videoSamples[i].data);
+    }
+    SAFE_FREE(clip->videoSamples);
+    for (int t = 0; t < MAX_AUDIO_TRACKS; t++) {
+        if (clip->audioSamples[t]) {
+            for (int i = 0; i < clip->audioCount; i++) SAFE_FREE(clip->audioSamples[t][i].data);
+        }
+        SAFE_FREE(clip->audioSamples[t]);
+    }
+}
+
+static BOOL MakeClip(const BenchOptions* opt, BenchClip* clip) {
+    ZeroMemory(clip, sizeof(*clip));
+
+    int gop = GOP_LENGTH_FRAMES_AT(opt->fps);
+    if (gop < 1) gop = 1;
+    double average = opt->mbps * 1000000.0 / 8.0 / opt->fps;
+    DWORD keySize = (DWORD)(average * 4);
+    DWORD deltaSize = gop > 1 ? (DWORD)((average * gop - keySize) / (gop - 1)) : keySize;
+    if (deltaSize < 64) deltaSize = 64;
+
+    clip->video.width = opt->width;
+    clip->video.height = opt->height;
+    clip->video.fps = opt->fps;
+    clip->video.quality = QUALITY_HIGH;
+    clip->video.seqHeader = (BYTE*)SEQ_HEADER;
+    clip->video.seqHeaderSize = sizeof(SEQ_HEADER);
+
+    clip->videoCount = opt->seconds * opt->fps;
+    clip->videoSamples = (MuxerSample*)calloc((size_t)clip->videoCount, sizeof(MuxerSample));
+    if (!clip->videoSamples) return FALSE;
+
+    LONGLONG frameDuration = MF_UNITS_PER_SECOND / opt->fps;
+    for (int i = 0; i < clip->videoCount; i++) {
+        MuxerSample* s = &clip->videoSamples[i];
+        s->isKeyframe = (i % gop) == 0;
+        s->data = MakeFrame(s->isKeyframe, s->isKeyframe ? keySize : deltaSize, &s->size);
+        if (!s->data) return FALSE;
+        s->timestamp = (LONGLONG)i * MF_UNITS_PER_SECOND / opt->fps;
+        s->duration = frameDuration;
+        clip->payloadBytes += s->size;
+    }
+
+    clip->audioTracks = opt->audioTracks;
+    clip->audioCount = (int)((LONGLONG)opt->seconds * AAC_SAMPLE_RATE / AAC_SAMPLES_PER_FRAME);
+    clip->audioConfig.sampleRate = AAC_SAMPLE_RATE;
+    clip->audioConfig.channels = 2;
+    clip->audioConfig.bitrate = AAC_BITRATE;
+    clip->audioConfig.configData = g_audioSpecificConfig;
+    clip->audioConfig.configSize = sizeof(g_audioSpecificConfig);
+
+    DWORD aacAverage = AAC_BITRATE / 8 * AAC_SAMPLES_PER_FRAME / AAC_SAMPLE_RATE;
+    for (int t = 0; t < clip->audioTracks; t++) {
+        clip->audioSamples[t] = (MuxerAudioSample*)calloc((size_t)clip->audioCount, sizeof(MuxerAudioSample));
+        if (!clip->audioSamples[t]) return FALSE;
+        for (int i = 0; i < clip->audioCount; i++) {
+            MuxerAudioSample* s = &clip->audioSamples[t][i];
+            s->size = aacAverage - aacAverage / 10 + (DWORD)(i * 7919 % (aacAverage / 5 + 1));
+            s->data = (BYTE*)malloc(s->size);
+            if (!s->data) return FALSE;
+            FillPayload(s->data, s->size);
+            s->timestamp = (LONGLONG)i * AAC_SAMPLES_PER_FRAME * MF_UNITS_PER_SECOND / AAC_SAMPLE_RATE;
+            s->duration = (LONGLONG)(i + 1) * AAC_SAMPLES_PER_FRAME * MF_UNITS_PER_SECOND / AAC_SAMPLE_RATE -
+                          s->timestamp;
+            clip->payloadBytes += s->size;
+        }
+    }
+    return TRUE;
+}
+
+/* ============================================================================
+ * MONITOR
+ * ============================================================================
+ * Samples the working set and the output file size while a run is going.
+ */
+
+typedef struct {
+    HANDLE thread;
+    volatile LONG stop;
+    const char* path;
+    LARGE_INTEGER start;
+    LARGE_INTEGER freq;
+    SIZE_T peak;
+    double ttfbMs;
+} Monitor;
+
+static SIZE_T WorkingSet(void) {
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return pmc.WorkingSetSize;
+}
+
+static UINT64 FileBytes(const char* path) {
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &fad)) return 0;
+    return ((UINT64)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+}
+
+static DWORD WINAPI MonitorProc(LPVOID param) {
+    Monitor* m = (Monitor*)param;
+    while (!InterlockedCompareExchange(&m->stop, 0, 0)) {
+        SIZE_T ws = WorkingSet();
+        if (ws > m->peak) m->peak = ws;
+        if (m->ttfbMs < 0 && FileBytes(m->path) > 0) m->ttfbMs = Bench_ElapsedMs(m->start, m->freq);
+        Sleep(1);
+    }
+    return 0;
+}
+
+/* ============================================================================
+ * RUNS
+ * ============================================================================
+ */
+
+static BOOL WriteStreaming(const BenchClip* clip, const char* path, BOOL fragmented) {
+    MuxerConfig video = clip->video;
+    video.fragmented = fragmented;
+    StreamingMuxer* muxer = StreamingMuxer_CreateWithAudio(path, &video,
+                                                           clip->audioTracks > 0 ? &clip->audioConfig : NULL);
+    if (!muxer) return FALSE;
+
+    /* Interleaved by timestamp, as the recorder delivers them */
+    BOOL ok = TRUE;
+    int a = 0;
+    int audioCount = clip->audioTracks > 0 ? clip->audioCount : 0;
+    for (int v = 0; v < clip->videoCount && ok; v++) {
+        while (a < audioCount && clip->audioSamples[0][a].timestamp <= clip->videoSamples[v].timestamp) {
+            ok = StreamingMuxer_WriteAudio(muxer, &clip->audioSamples[0][a++]) && ok;
+        }
+        ok = StreamingMuxer_WriteVideo(muxer, &clip->videoSamples[v]) && ok;
+    }
+    while (ok && a < audioCount) ok = StreamingMuxer_WriteAudio(muxer, &clip->audioSamples[0][a++]);
+
+    if (!ok) {
+        StreamingMuxer_Abort(muxer);
+        return FALSE;
+    }
+    return StreamingMuxer_Close(muxer);
+}
+
+static BOOL RunPath(BenchPath path, const BenchClip* clip, const char* file) {
+    MuxerAudioTrack tracks[MAX_AUDIO_TRACKS];
+    for (int t = 0; t < clip->audioTracks; t++) {
+        tracks[t].samples = clip->audioSamples[t];
+        tracks[t].sampleCount = clip->audioCount;
+        tracks[t].config = clip->audioConfig;
+    }
+
+    switch (path) {
+        case PATH_MF:
+            return MP4Muxer_WriteFileWithMultiAudio(file, clip->videoSamples, clip->videoCount,
+                                                    &clip->video, tracks, clip->audioTracks);
+        case PATH_NATIVE:
+            return MP4Writer_WriteFile(file, clip->videoSamples, clip->videoCount,
+                                       &clip->video, tracks, clip->audioTracks);
+        case PATH_STREAM:
+            return WriteStreaming(clip, file, FALSE);
+        case PATH_FRAGMENTED:
+            return WriteStreaming(clip, file, TRUE);
+        default:
+            return FALSE;
+    }
+}
+
+static void RunOnce(BenchPath path, const BenchClip* clip, const BenchOptions* opt, int iteration, BenchRun* run) {
+    char file[MAX_PATH];
+    snprintf(file, sizeof(file), "%s\\lwsr_bench_%s_%d.mp4", opt->outDir, PATH_NAMES[path], iteration);
+    DeleteFileA(file);
+
+    Monitor m;
+    ZeroMemory(&m, sizeof(m));
+    m.path = file;
+    m.ttfbMs = -1;
+    QueryPerformanceFrequency(&m.freq);
+    SIZE_T baseline = WorkingSet();
+    m.peak = baseline;
+
+    QueryPerformanceCounter(&m.start);
+    m.thread = CreateThread(NULL, 0, MonitorProc, &m, 0, NULL);
+    run->ok = RunPath(path, clip, file);
+    run->ms = Bench_ElapsedMs(m.start, m.freq);
+    InterlockedExchange(&m.stop, 1);
+    if (m.thread) {
+        WaitForSingleObject(m.thread, INFINITE);
+        CloseHandle(m.thread);
+    }
+
+    SIZE_T ws = WorkingSet();
+    if (ws > m.peak) m.peak = ws;
+    run->peakBytes = m.peak - baseline;
+    run->fileBytes = FileBytes(file);
+    run->ttfbMs = m.ttfbMs;
+    if (run->ttfbMs < 0 && run->fileBytes > 0) run->ttfbMs = run->ms;   /* Landed in the last sample */
+    if (!opt->keep) DeleteFileA(file);
+}
+
+static BOOL BenchOnePath(BenchPath path, const BenchClip* clip, const BenchOptions* opt) {
+    double ms[MAX_ITERATIONS], ttfb[MAX_ITERATIONS];
+    int ttfbCount = 0;
+    SIZE_T peak = 0;
+    UINT64 fileBytes = 0;
+
+    for (int i = 0; i < opt->iterations; i++) {
+        BenchRun run;
+        RunOnce(path, clip, opt, i, &run);
+        if (!run.ok) {
+            printf("%-11s FAILED (iteration %d; see mux_bench.log)\n", PATH_NAMES[path], i + 1);
+            return FALSE;
+        }
+        ms[i] = run.ms;
+        if (run.ttfbMs >= 0) ttfb[ttfbCount++] = run.ttfbMs;
+        if (run.peakBytes > peak) peak = run.peakBytes;
+        fileBytes = run.fileBytes;
+    }
+
+    int tracks = (path == PATH_STREAM || path == PATH_FRAGMENTED) ? (clip->audioTracks > 0) : clip->audioTracks;
+    double samples = (double)clip->videoCount + (double)clip->audioCount * tracks;
+    double median = Bench_Median(ms, opt->iterations);
+    double seconds = median / 1000.0;
+    double fileMb = (double)fileBytes / (1024.0 * 1024.0);
+    printf("%-11s %9.1f %9.1f %11.0f %9.1f %12.1f %9.1f\n", PATH_NAMES[path], median,
+           seconds > 0 ? fileMb / seconds : 0, seconds > 0 ? samples / seconds : 0,
+           ttfbCount ? Bench_Median(ttfb, ttfbCount) : -1.0, (double)peak / (1024.0 * 1024.0), fileMb);
+    return TRUE;
+}
+
+/* ============================================================================
+ * COMMAND LINE
+ * ============================================================================
+ */
+
+static void Usage(void) {
+    printf("usage: lwsr_mux_bench [options]\n"
+           "  --width N        video width (1920)\n"
+           "  --height N       video height (1080)\n"
+           "  --fps N          frame rate (60)\n"
+           "  --mbps X         video bitrate in Mbit/s (40)\n"
+           "  --seconds N      clip length (30)\n"
+           "  --tracks N       audio tracks, 0-%d (2)\n"
+           "  --iterations N   runs per path, median reported (3, max %d)\n"
+           "  --paths LIST     comma list of mf,native,stream,fragmented (all)\n"
+           "  --out DIR        output folder (%%TEMP%%)\n"
+           "  --keep           keep the output files\n",
+           MAX_AUDIO_TRACKS, MAX_ITERATIONS);
+}
+
+static BOOL ParsePaths(const char* list, BOOL* paths) {
+    ZeroMemory(paths, sizeof(BOOL) * PATH_COUNT);
+    char copy[128];
+    strncpy_s(copy, sizeof(copy), list, _TRUNCATE);
+    char* context = NULL;
+    for (char* tok = strtok_s(copy, ",", &context); tok; tok = strtok_s(NULL, ",", &context)) {
+        int p = 0;
+        while (p < PATH_COUNT && _stricmp(tok, PATH_NAMES[p]) != 0) p++;
+        if (p == PATH_COUNT) return FALSE;
+        paths[p] = TRUE;
+    }
+    return TRUE;
+}
+
+static BOOL ParseOptions(int argc, char** argv, BenchOptions* opt) {
+    opt->width = 1920;
+    opt->height = 1080;
+    opt->fps = 60;
+    opt->mbps = 40.0;
+    opt->seconds = 30;
+    opt->audioTracks = 2;
+    opt->iterations = 3;
+    for (int p = 0; p < PATH_COUNT; p++) opt->paths[p] = TRUE;
+    opt->keep = FALSE;
+    if (!GetTempPathA(sizeof(opt->outDir), opt->outDir)) strcpy_s(opt->outDir, sizeof(opt->outDir), ".");
+    size_t len = strlen(opt->outDir);
+    if (len > 0 && opt->outDir[len - 1] == '\\') opt->outDir[len - 1] = '\0';
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--keep") == 0) { opt->keep = TRUE; continue; }
+        if (!value) return FALSE;
+        i++;
+        if (strcmp(arg, "--width") == 0) opt->width = atoi(value);
+        else if (strcmp(arg, "--height") == 0) opt->height = atoi(value);
+        else if (strcmp(arg, "--fps") == 0) opt->fps = atoi(value);
+        else if (strcmp(arg, "--mbps") == 0) opt->mbps = atof(value);
+        else if (strcmp(arg, "--seconds") == 0) opt->seconds = atoi(value);
+        else if (strcmp(arg, "--tracks") == 0) opt->audioTracks = atoi(value);
+        else if (strcmp(arg, "--iterations") == 0) opt->iterations = atoi(value);
+        else if (strcmp(arg, "--out") == 0) strcpy_s(opt->outDir, sizeof(opt->outDir), value);
+        else if (strcmp(arg, "--paths") == 0) { if (!ParsePaths(value, opt->paths)) return FALSE; }
+        else return FALSE;
+    }
+
+    return opt->width > 0 && opt->height > 0 && opt->fps > 0 && opt->mbps > 0 &&
+           opt->seconds > 0 && opt->audioTracks >= 0 && opt->audioTracks <= MAX_AUDIO_TRACKS &&
+           opt->iterations > 0 && opt->iterations <= MAX_ITERATIONS;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    if (!ParseOptions(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    /* Module logs (writer stats, failures) go to a file, results to stdout */
+    Logger_Init("mux_bench.log", "w");
+    timeBeginPeriod(1);
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    HRESULT hrMf = MFStartup(MF_VERSION, MFSTARTUP_NOSOCKET);
+    if (FAILED(hrMf)) {
+        printf("MFStartup failed (0x%08lX): mf and stream paths will fail\n", (unsigned long)hrMf);
+    }
+
+    int exitCode = 1;
+    BenchClip clip;
+    LARGE_INTEGER freq, start;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    if (!MakeClip(&opt, &clip)) {
+        printf("Out of memory generating the clip\n");
+        goto cleanup;
+    }
+
+    printf("lwsr_mux_bench: %dx%d @ %d fps, %.1f Mbit/s, %d s, %d audio track(s), %d iteration(s)\n",
+           opt.width, opt.height, opt.fps, opt.mbps, opt.seconds, opt.audioTracks, opt.iterations);
+    printf("clip: %d video + %d x %d audio samples, %.1f MB, generated in %.0f ms; output in %s\n\n",
+           clip.videoCount, clip.audioTracks, clip.audioCount,
+           (double)clip.payloadBytes / (1024.0 * 1024.0), Bench_ElapsedMs(start, freq), opt.outDir);
+    printf("%-11s %9s %9s %11s %9s %12s %9s\n", "path", "ms", "MB/s", "samples/s", "ttfb ms", "peak RSS MB", "file MB");
+
+    exitCode = 0;
+    for (int p = 0; p < PATH_COUNT; p++) {
+        if (opt.paths[p] && !BenchOnePath((BenchPath)p, &clip, &opt)) exitCode = 1;
+    }
+
+cleanup:
+    FreeClip(&clip);
+    if (SUCCEEDED(hrMf)) MFShutdown();
+    if (hrCom == S_OK || hrCom == S_FALSE) CoUninitialize();
+    timeEndPeriod(1);
+    Logger_Shutdown();
+    return exitCode;
+}
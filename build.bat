@@ -1,10 +1,14 @@
 @echo off
 REM Ultra Lightweight Screen Recorder - Build Script
-REM Usage: build.bat [debug|release|analyze]
+REM Usage: build.bat [debug|release|analyze|bench]
 REM   build.bat         - Release build (optimized)
 REM   build.bat debug   - Debug build (symbols, no optimization)
 REM   build.bat release - Release build (explicit)
 REM   build.bat analyze - Static analysis build (requires VS Enterprise or additional tools)
+REM   build.bat bench   - Muxer save, audio pipeline and kill-feed detection benchmarks
+REM                       (bin\lwsr_mux_bench.exe, bin\lwsr_audio_bench.exe,
+REM                       bin\lwsr_detect_bench.exe, console)
+REM   build.bat tools   - Binary debug log decoder (bin\lwsr_logdecode.exe, console)
 
 setlocal enabledelayedexpansion
 
@@ -12,6 +16,8 @@ REM Check for build type flag
 set BUILD_TYPE=release
 if /i "%1"=="debug" set BUILD_TYPE=debug
 if /i "%1"=="analyze" set BUILD_TYPE=analyze
+if /i "%1"=="bench" set BUILD_TYPE=bench
+if /i "%1"=="tools" set BUILD_TYPE=tools
 
 REM Check if MSVC is already in PATH (e.g., from GitHub Actions ilammy/msvc-dev-cmd)
 where cl.exe >nul 2>&1
@@ -66,13 +72,28 @@ REM Compile resource file (icon)
 rc.exe /nologo /fo "bin\lwsr.res" "src\lwsr.rc"
 
 REM Source files (single source of truth)
-set SOURCES=src\main.c src\config.c src\capture.c src\recording.c src\overlay.c src\settings_dialog.c src\action_toolbar.c src\border.c src\replay_buffer.c src\nvenc_encoder.c src\frame_buffer.c src\mp4_muxer.c src\util.c src\logger.c src\audio_device.c src\audio_capture.c src\aac_encoder.c src\gpu_converter.c src\crash_handler.c src\gdiplus_api.c src\leak_tracker.c src\ui_draw.c src\tray_icon.c src\layered_window.c src\markers.c src\kill_feed_sampler.c src\debug_console.c src\game_profile.c
+set SOURCES=src\main.c src\config.c src\capture.c src\recording.c src\overlay.c src\settings_dialog.c src\action_toolbar.c src\border.c src\replay_buffer.c src\nvenc_encoder.c src\frame_buffer.c src\mp4_muxer.c src\util.c src\logger.c src\audio_device.c src\audio_capture.c src\aac_encoder.c src\gpu_converter.c src\preview_tap.c src\frame_scheduler.c src\pipeline_stats.c src\metrics.c src\trace.c src\startup.c src\crash_handler.c src\gdiplus_api.c src\leak_tracker.c src\ui_draw.c src\tray_icon.c src\layered_window.c src\markers.c src\kill_feed_sampler.c src\debug_console.c src\game_profile.c src\frame_spill.c src\audio_ring.c src\mp4_writer.c src\save_io.c src\mux_queue.c src\mp4_reader.c src\clip_edit.c src\soak_bench.c src\bench_common.c src\parallel.c src\clip_index.c src\audio_mix.c src\audio_resample.c src\spsc_ring.c src\template_match.c src\gpu_template_match.c
 
 REM Resource file
 set RESOURCES=bin\lwsr.res
 
 REM Libraries
-set LIBS=user32.lib gdi32.lib d3d11.lib dxgi.lib mfplat.lib mfreadwrite.lib mfuuid.lib ole32.lib shell32.lib comdlg32.lib comctl32.lib dwmapi.lib winmm.lib propsys.lib oleaut32.lib strmiids.lib
+set LIBS=user32.lib gdi32.lib d3d11.lib dxgi.lib mfplat.lib mfreadwrite.lib mfuuid.lib ole32.lib shell32.lib comdlg32.lib comctl32.lib dwmapi.lib winmm.lib propsys.lib oleaut32.lib strmiids.lib advapi32.lib avrt.lib
+
+REM Muxer benchmark: the muxer layer and what it links against, nothing else
+set BENCH_MUX_SOURCES=bench\mux_bench.c src\bench_common.c src\mp4_muxer.c src\mp4_writer.c src\save_io.c src\logger.c src\util.c src\config.c src\parallel.c
+
+REM Audio benchmark: resampler, mixer and AAC encoder
+set BENCH_AUDIO_SOURCES=bench\audio_bench.c src\bench_common.c src\audio_resample.c src\audio_mix.c src\aac_encoder.c src\trace.c src\logger.c src\util.c src\config.c
+
+REM Detection benchmark: template matcher, game profiles and GDI+ image loading
+set BENCH_DETECT_SOURCES=bench\detect_bench.c src\bench_common.c src\template_match.c src\game_profile.c src\gdiplus_api.c src\parallel.c src\logger.c src\util.c src\config.c
+
+REM Log decoder: the logger's record formatter and nothing else
+set TOOLS_LOGDECODE_SOURCES=tools\log_decode.c src\logger.c
+
+if "%BUILD_TYPE%"=="bench" goto :bench
+if "%BUILD_TYPE%"=="tools" goto :tools
 
 REM ============================================================================
 REM WARNING FLAGS DOCUMENTATION
@@ -150,3 +171,115 @@ echo   - ESC to cancel selection
 echo.
 
 endlocal
+exit /b 0
+
+REM ============================================================================
+REM BENCHMARKS
+REM ============================================================================
+REM   Release flags without /GL so results match the shipped code paths but
+REM   link quickly. Run from any folder; logs go to mux_bench.log /
+REM   audio_bench.log / detect_bench.log there.
+REM ============================================================================
+:bench
+echo Building muxer benchmark [RELEASE]...
+cl.exe /nologo /O2 /MD ^
+    /W4 /WX /wd4201 ^
+    /D "NDEBUG" /D "WIN32" /D "_CONSOLE" /D "_CRT_SECURE_NO_WARNINGS" ^
+    /I"src" ^
+    /Fe"bin\lwsr_mux_bench.exe" ^
+    /Fo"bin\\" ^
+    %BENCH_MUX_SOURCES% ^
+    /link /SUBSYSTEM:CONSOLE ^
+    %LIBS% psapi.lib
+
+if %ERRORLEVEL% neq 0 (
+    echo Build failed!
+    exit /b 1
+)
+
+del bin\*.obj >nul 2>&1
+
+echo Building audio benchmark [RELEASE]...
+cl.exe /nologo /O2 /MD ^
+    /W4 /WX /wd4201 ^
+    /D "NDEBUG" /D "WIN32" /D "_CONSOLE" /D "_CRT_SECURE_NO_WARNINGS" ^
+    /I"src" ^
+    /Fe"bin\lwsr_audio_bench.exe" ^
+    /Fo"bin\\" ^
+    %BENCH_AUDIO_SOURCES% ^
+    /link /SUBSYSTEM:CONSOLE ^
+    %LIBS%
+
+if %ERRORLEVEL% neq 0 (
+    echo Build failed!
+    exit /b 1
+)
+
+del bin\*.obj >nul 2>&1
+
+echo Building detection benchmark [RELEASE]...
+cl.exe /nologo /O2 /MD ^
+    /W4 /WX /wd4201 ^
+    /D "NDEBUG" /D "WIN32" /D "_CONSOLE" /D "_CRT_SECURE_NO_WARNINGS" ^
+    /I"src" ^
+    /Fe"bin\lwsr_detect_bench.exe" ^
+    /Fo"bin\\" ^
+    %BENCH_DETECT_SOURCES% ^
+    /link /SUBSYSTEM:CONSOLE ^
+    %LIBS% psapi.lib
+
+if %ERRORLEVEL% neq 0 (
+    echo Build failed!
+    exit /b 1
+)
+
+del bin\*.obj >nul 2>&1
+del bin\lwsr.res >nul 2>&1
+
+echo.
+echo Build successful! Output: bin\lwsr_mux_bench.exe, bin\lwsr_audio_bench.exe, bin\lwsr_detect_bench.exe
+echo.
+echo Usage:
+echo   - bin\lwsr_mux_bench.exe                  all muxer paths, 1080p60 40 Mbit/s, 30 s, 2 audio tracks
+echo   - bin\lwsr_mux_bench.exe --help           options (resolution, bitrate, duration, tracks, paths)
+echo   - bin\lwsr_audio_bench.exe                synthetic sources through convert, mix, volume, AAC
+echo   - bin\lwsr_audio_bench.exe a.wav b.wav    your captures; --write-golden / --golden DIR to check output
+echo   - bin\lwsr_detect_bench.exe --pos DIR --neg DIR   saved regions through the kill-feed matcher
+echo   - bin\lwsr_detect_bench.exe --help       options (profile, templates, scales, threshold, gates)
+echo.
+
+endlocal
+exit /b 0
+
+REM ============================================================================
+REM TOOLS
+REM ============================================================================
+REM   Console utilities for working with LWSR output, release flags.
+REM ============================================================================
+:tools
+echo Building log decoder [RELEASE]...
+cl.exe /nologo /O2 /MD ^
+    /W4 /WX /wd4201 ^
+    /D "NDEBUG" /D "WIN32" /D "_CONSOLE" /D "_CRT_SECURE_NO_WARNINGS" ^
+    /I"src" ^
+    /Fe"bin\lwsr_logdecode.exe" ^
+    /Fo"bin\\" ^
+    %TOOLS_LOGDECODE_SOURCES% ^
+    /link /SUBSYSTEM:CONSOLE
+
+if %ERRORLEVEL% neq 0 (
+    echo Build failed!
+    exit /b 1
+)
+
+del bin\*.obj >nul 2>&1
+del bin\lwsr.res >nul 2>&1
+
+echo.
+echo Build successful! Output: bin\lwsr_logdecode.exe
+echo.
+echo Usage:
+echo   - bin\lwsr_logdecode.exe Debug\lwsr_log_*.lwlog [out.txt]   binary debug log to text
+echo.
+
+endlocal
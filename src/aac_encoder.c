@@ -6,6 +6,7 @@
 #include "constants.h"
 #include "mem_utils.h"
 #include "logger.h"
+#include "trace.h"
 #include <mfapi.h>
 #include <mftransform.h>
 #include <mferror.h>
@@ -39,6 +40,15 @@ struct AACEncoder {
     LONGLONG nextTimestamp;
     LONGLONG frameDuration;  // Duration of one AAC frame in 100ns
 
+    // Reused Media Foundation objects, so steady-state encoding allocates
+    // nothing: the output sample we hand the MFT (unless it provides its
+    // own), and input samples the MFT may still hold after ProcessInput
+    IMFSample* outputSample;
+    IMFMediaBuffer* outputBuffer;
+    IMFSample* inputSamples[AAC_INPUT_POOL_SIZE];
+    IMFMediaBuffer* inputBuffers[AAC_INPUT_POOL_SIZE];
+    LONGLONG inputPoolMisses;      // Frames fed through a one-off sample
+
     // Diagnostic counters (monotonic, never reset)
     LONGLONG pcmBytesIngested;     // Total PCM bytes fed via AACEncoder_Feed
     LONGLONG aacFramesEmitted;     // Total AAC output frames produced
@@ -106,6 +116,54 @@ fail:
     return NULL;
 }
 
+// Create a sample holding one memory buffer of size bytes (both referenced once by the caller)
+static BOOL CreateBufferedSample(DWORD size, IMFSample** outSample, IMFMediaBuffer** outBuffer) {
+    *outSample = NULL;
+    *outBuffer = NULL;
+    
+    if (FAILED(MFCreateSample(outSample))) return FALSE;
+    if (FAILED(MFCreateMemoryBuffer(size, outBuffer)) ||
+        FAILED((*outSample)->lpVtbl->AddBuffer(*outSample, *outBuffer))) {
+        SAFE_RELEASE(*outBuffer);
+        SAFE_RELEASE(*outSample);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Input sample for one PCM frame, with a reference for the caller. A pool
+// slot the MFT has let go of is reused (we hold the only references to the
+// sample and its buffer); if all are still in flight, a one-off is created.
+static BOOL AcquireInputSample(AACEncoder* encoder, IMFSample** outSample, IMFMediaBuffer** outBuffer) {
+    for (int i = 0; i < AAC_INPUT_POOL_SIZE; i++) {
+        if (!encoder->inputSamples[i]) {
+            if (!CreateBufferedSample((DWORD)encoder->bytesPerFrame, &encoder->inputSamples[i],
+                                      &encoder->inputBuffers[i])) {
+                break;
+            }
+        } else {
+            // Free once the pool holds the sample's only reference and the
+            // pool and sample the buffer's only two
+            IMFSample* pooled = encoder->inputSamples[i];
+            IMFMediaBuffer* pooledBuffer = encoder->inputBuffers[i];
+            ULONG sampleRefs = pooled->lpVtbl->AddRef(pooled);
+            ULONG bufferRefs = pooledBuffer->lpVtbl->AddRef(pooledBuffer);
+            pooledBuffer->lpVtbl->Release(pooledBuffer);
+            pooled->lpVtbl->Release(pooled);
+            if (sampleRefs != 2 || bufferRefs != 3) continue;
+        }
+        
+        *outSample = encoder->inputSamples[i];
+        *outBuffer = encoder->inputBuffers[i];
+        (*outSample)->lpVtbl->AddRef(*outSample);
+        (*outBuffer)->lpVtbl->AddRef(*outBuffer);
+        return TRUE;
+    }
+    
+    encoder->inputPoolMisses++;
+    return CreateBufferedSample((DWORD)encoder->bytesPerFrame, outSample, outBuffer);
+}
+
 // Process output from encoder
 static void ProcessOutput(AACEncoder* encoder) {
     if (!encoder || !encoder->transform) return;
@@ -113,44 +171,37 @@ static void ProcessOutput(AACEncoder* encoder) {
     MFT_OUTPUT_DATA_BUFFER outputBuffer = {0};
     DWORD status = 0;
     
+    // Stream info only changes with the media types; ask once per drain
+    MFT_OUTPUT_STREAM_INFO streamInfo = {0};
+    encoder->transform->lpVtbl->GetOutputStreamInfo(encoder->transform, 0, &streamInfo);
+    BOOL mftProvidesSamples = (streamInfo.dwFlags & MFT_OUTPUT_STREAM_PROVIDES_SAMPLES) != 0;
+    
+    // We provide the output sample: one, reused for every frame
+    if (!mftProvidesSamples && !encoder->outputSample) {
+        DWORD size = streamInfo.cbSize > 0 ? streamInfo.cbSize : AAC_OUTPUT_BUFFER_SIZE;
+        if (!CreateBufferedSample(size, &encoder->outputSample, &encoder->outputBuffer)) return;
+    }
+    
     while (1) {
-        // Check if we need to provide output sample
-        MFT_OUTPUT_STREAM_INFO streamInfo = {0};
-        encoder->transform->lpVtbl->GetOutputStreamInfo(encoder->transform, 0, &streamInfo);
-        
-        IMFSample* outputSample = NULL;
-        IMFMediaBuffer* outputMediaBuffer = NULL;
-        
-        if (!(streamInfo.dwFlags & MFT_OUTPUT_STREAM_PROVIDES_SAMPLES)) {
-            // We need to provide the sample
-            HRESULT hrSample = MFCreateSample(&outputSample);
-            if (FAILED(hrSample)) break;
-            
-            HRESULT hrBuffer = MFCreateMemoryBuffer(streamInfo.cbSize > 0 ? streamInfo.cbSize : AAC_OUTPUT_BUFFER_SIZE, &outputMediaBuffer);
-            if (FAILED(hrBuffer)) {
-                outputSample->lpVtbl->Release(outputSample);
-                break;
-            }
-            outputSample->lpVtbl->AddBuffer(outputSample, outputMediaBuffer);
-            outputBuffer.pSample = outputSample;
-        }
-        
         outputBuffer.dwStreamID = 0;
         outputBuffer.dwStatus = 0;
         outputBuffer.pEvents = NULL;
+        outputBuffer.pSample = NULL;
+        if (!mftProvidesSamples) {
+            encoder->outputBuffer->lpVtbl->SetCurrentLength(encoder->outputBuffer, 0);
+            outputBuffer.pSample = encoder->outputSample;
+        }
         
         HRESULT hr = encoder->transform->lpVtbl->ProcessOutput(
             encoder->transform, 0, 1, &outputBuffer, &status
         );
         
         if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT) {
-            if (outputSample) outputSample->lpVtbl->Release(outputSample);
-            if (outputMediaBuffer) outputMediaBuffer->lpVtbl->Release(outputMediaBuffer);
             break;
         }
         
         if (SUCCEEDED(hr) && outputBuffer.pSample) {
-            // Get encoded data
+            // Get encoded data (single-buffer samples hand back their own buffer)
             IMFMediaBuffer* buffer = NULL;
             outputBuffer.pSample->lpVtbl->ConvertToContiguousBuffer(outputBuffer.pSample, &buffer);
             
@@ -182,8 +233,10 @@ static void ProcessOutput(AACEncoder* encoder) {
         if (outputBuffer.pEvents) {
             outputBuffer.pEvents->lpVtbl->Release(outputBuffer.pEvents);
         }
-        if (outputSample) outputSample->lpVtbl->Release(outputSample);
-        if (outputMediaBuffer) outputMediaBuffer->lpVtbl->Release(outputMediaBuffer);
+        // A sample the MFT allocated is ours to release
+        if (mftProvidesSamples && outputBuffer.pSample) {
+            outputBuffer.pSample->lpVtbl->Release(outputBuffer.pSample);
+        }
         
         if (FAILED(hr)) break;
     }
@@ -420,6 +473,16 @@ void AACEncoder_Destroy(AACEncoder* encoder) {
     
     /* Release in reverse order of acquisition */
     SAFE_RELEASE(encoder->transform);
+    SAFE_RELEASE(encoder->outputSample);
+    SAFE_RELEASE(encoder->outputBuffer);
+    for (int i = 0; i < AAC_INPUT_POOL_SIZE; i++) {
+        SAFE_RELEASE(encoder->inputSamples[i]);
+        SAFE_RELEASE(encoder->inputBuffers[i]);
+    }
+    if (encoder->inputPoolMisses > 0) {
+        Logger_Log("AACEncoder: %lld frames used a one-off input sample (pool of %d busy)\n",
+                   encoder->inputPoolMisses, AAC_INPUT_POOL_SIZE);
+    }
     SAFE_RELEASE(encoder->inputType);
     SAFE_RELEASE(encoder->outputType);
     SAFE_FREE(encoder->inputBuffer);
@@ -444,6 +507,9 @@ BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONG
     
     if (!encoder || !encoder->transform || !pcmData || pcmSize <= 0) return FALSE;
     
+    TraceActivity trace;
+    TRACE_STAGE_START(&trace, TRACE_STAGE_AAC_FEED, encoder->aacFramesEmitted, timestamp);
+    
     // Set initial timestamp if not set
     if (encoder->nextTimestamp == 0 && timestamp > 0) {
         encoder->nextTimestamp = timestamp;
@@ -463,21 +529,13 @@ BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONG
         
         // Process complete frames
         while (encoder->inputBufferUsed >= encoder->bytesPerFrame) {
-            // Create input sample
+            // Input sample (pooled; its buffer is already attached)
             IMFSample* sample = NULL;
             IMFMediaBuffer* buffer = NULL;
-            
-            HRESULT hr = MFCreateSample(&sample);
-            if (FAILED(hr)) break;
-            
-            hr = MFCreateMemoryBuffer(encoder->bytesPerFrame, &buffer);
-            if (FAILED(hr)) {
-                sample->lpVtbl->Release(sample);
-                break;
-            }
+            if (!AcquireInputSample(encoder, &sample, &buffer)) break;
             
             BYTE* bufData = NULL;
-            hr = buffer->lpVtbl->Lock(buffer, &bufData, NULL, NULL);
+            HRESULT hr = buffer->lpVtbl->Lock(buffer, &bufData, NULL, NULL);
             if (FAILED(hr)) {
                 buffer->lpVtbl->Release(buffer);
                 sample->lpVtbl->Release(sample);
@@ -494,7 +552,6 @@ BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONG
             buffer->lpVtbl->Unlock(buffer);
             buffer->lpVtbl->SetCurrentLength(buffer, encoder->bytesPerFrame);
             
-            sample->lpVtbl->AddBuffer(sample, buffer);
             sample->lpVtbl->SetSampleTime(sample, encoder->nextTimestamp);
             sample->lpVtbl->SetSampleDuration(sample, encoder->frameDuration);
             
@@ -516,9 +573,55 @@ BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONG
         }
     }
     
+    TRACE_STAGE_STOP(&trace, encoder->aacFramesEmitted, timestamp);
+    return TRUE;
+}
+
+BOOL AACEncoder_Drain(AACEncoder* encoder) {
+    LWSR_ASSERT(encoder != NULL);
+    
+    if (!encoder || !encoder->transform) return FALSE;
+    
+    encoder->transform->lpVtbl->ProcessMessage(encoder->transform, MFT_MESSAGE_NOTIFY_END_OF_STREAM, 0);
+    HRESULT hr = encoder->transform->lpVtbl->ProcessMessage(encoder->transform, MFT_MESSAGE_COMMAND_DRAIN, 0);
+    if (FAILED(hr)) return FALSE;
+    
+    /* Drained output comes out until NEED_MORE_INPUT */
+    ProcessOutput(encoder);
+    encoder->inputBufferUsed = 0;
     return TRUE;
 }
 
+BOOL AACEncoder_Suspend(AACEncoder* encoder, int* droppedBytes) {
+    LWSR_ASSERT(encoder != NULL);
+    LWSR_ASSERT(droppedBytes != NULL);
+    
+    if (droppedBytes) *droppedBytes = 0;
+    if (!encoder || !encoder->transform) return FALSE;
+    
+    /* DRAIN without END_OF_STREAM: the MFT takes input again afterwards */
+    HRESULT hr = encoder->transform->lpVtbl->ProcessMessage(encoder->transform, MFT_MESSAGE_COMMAND_DRAIN, 0);
+    if (FAILED(hr)) return FALSE;
+    
+    ProcessOutput(encoder);
+    if (droppedBytes) *droppedBytes = encoder->inputBufferUsed;
+    encoder->inputBufferUsed = 0;
+    encoder->transform->lpVtbl->ProcessMessage(encoder->transform, MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0);
+    return TRUE;
+}
+
+void AACEncoder_SkipFrame(AACEncoder* encoder, AACSample* gap) {
+    LWSR_ASSERT(encoder != NULL);
+    LWSR_ASSERT(gap != NULL);
+    LWSR_ASSERT(encoder == NULL || encoder->inputBufferUsed == 0);
+    
+    if (!encoder || !gap) return;
+    ZeroMemory(gap, sizeof(*gap));
+    gap->timestamp = encoder->nextTimestamp;
+    gap->duration = encoder->frameDuration;
+    encoder->nextTimestamp += encoder->frameDuration;
+}
+
 BOOL AACEncoder_GetConfig(AACEncoder* encoder, BYTE** configData, int* configSize) {
     // Preconditions
     LWSR_ASSERT(encoder != NULL);
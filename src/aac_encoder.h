@@ -54,6 +54,21 @@ void AACEncoder_SetCallback(AACEncoder* encoder, AACEncoderCallback callback, vo
 // this thread. Not thread-safe; serialize calls from a single feeder thread.
 BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONGLONG timestamp);
 
+// End a finite stream: drain the MFT and deliver the frames it still holds
+// through the callback. Input short of a whole frame is dropped. Feed
+// nothing afterwards. Same preconditions as AACEncoder_Feed.
+BOOL AACEncoder_Drain(AACEncoder* encoder);
+
+// Pause a live stream (silence gate): drain the MFT like AACEncoder_Drain
+// but keep the encoder usable. *droppedBytes gets the input short of a
+// whole frame, which is discarded. Same preconditions as AACEncoder_Feed.
+BOOL AACEncoder_Suspend(AACEncoder* encoder, int* droppedBytes);
+
+// Leave one frame's gap in the output timeline for a frame the caller
+// stores itself: gap gets its timestamp and duration (data NULL), as the
+// callback would have. Only while no input is pending (after Suspend).
+void AACEncoder_SkipFrame(AACEncoder* encoder, AACSample* gap);
+
 // Get encoder info for muxer
 BOOL AACEncoder_GetConfig(AACEncoder* encoder, BYTE** configData, int* configSize);
 
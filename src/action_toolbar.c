@@ -33,11 +33,12 @@ typedef DWORD ARGB;
  */
 
 /* Button definitions */
-#define BTN_COUNT 4
+#define BTN_COUNT 5
 #define BTN_MINIMIZE 0
 #define BTN_RECORD   1
 #define BTN_CLOSE    2
 #define BTN_SETTINGS 3
+#define BTN_TRIM     4
 
 typedef struct {
     RECT rect;
@@ -55,11 +56,16 @@ typedef struct ToolbarUIState {
     ToolbarButton buttons[BTN_COUNT];
     int hoveredButton;
     int pressedButton;
+    /* Retained surface: chrome is painted once, then only buttons whose
+     * hover/pressed look changed are repainted and presented */
+    LayeredBitmap surface;
+    ARGB paintedColor[BTN_COUNT];   /* Fill each button was last painted with */
     /* Action callbacks set by the caller */
     void (*onMinimize)(void);
     void (*onRecord)(void);
     void (*onClose)(void);
     void (*onSettings)(void);
+    void (*onTrim)(void);
 } ToolbarUIState;
 
 static ToolbarUIState g_ui = {0};
@@ -70,7 +76,7 @@ static GpFont*       g_cachedFont = NULL;
 static GpStringFormat* g_cachedFormat = NULL;
 
 /* Toolbar dimensions (constants) */
-#define TOOLBAR_WIDTH 180
+#define TOOLBAR_WIDTH 224
 #define TOOLBAR_HEIGHT 36
 #define CORNER_RADIUS 10
 #define BTN_HEIGHT 24
@@ -103,15 +109,33 @@ static GpPath* CreateRoundedRectPath(REAL x, REAL y, REAL w, REAL h, REAL r) {
     return path;
 }
 
-// Paint the toolbar to a 32-bit ARGB bitmap
-static void PaintToolbar(HDC hdc, int width, int height) {
-    GpGraphics* g = NULL;
-    if (g_gdip.CreateFromHDC(hdc, &g) != 0) return;
-    
-    // Enable anti-aliasing
-    g_gdip.SetSmoothingMode(g, 4); // SmoothingModeAntiAlias
-    g_gdip.SetTextRenderingHint(g, 5); // TextRenderingHintClearTypeGridFit
-    
+static ARGB ButtonColor(int i) {
+    if (i == g_ui.pressedButton) return COLOR_BTN_PRESS;
+    if (i == g_ui.hoveredButton) return COLOR_BTN_HOVER;
+    return COLOR_BTN;
+}
+
+// Create cached font resources on first paint. Each resource is gated
+// independently so a partial failure (e.g. family OK but font NULL) does
+// not permanently suppress retries on later paints.
+static void EnsureFontResources(void) {
+    if (!g_cachedFontFamily) {
+        g_gdip.CreateFontFamilyFromName(L"Segoe UI", NULL, &g_cachedFontFamily);
+    }
+    if (g_cachedFontFamily && !g_cachedFont) {
+        g_gdip.CreateFont(g_cachedFontFamily, 11.0f, 0, 2, &g_cachedFont);
+    }
+    if (!g_cachedFormat) {
+        g_gdip.CreateStringFormat(0, 0, &g_cachedFormat);
+        if (g_cachedFormat) {
+            g_gdip.SetStringFormatAlign(g_cachedFormat, 1); // StringAlignmentCenter
+            g_gdip.SetStringFormatLineAlign(g_cachedFormat, 1); // StringAlignmentCenter
+        }
+    }
+}
+
+// Paint the background chrome (whole surface)
+static void PaintChrome(GpGraphics* g, int width, int height) {
     // Clear to fully transparent
     g_gdip.GraphicsClear(g, 0x00000000);
     
@@ -134,78 +158,91 @@ static void PaintToolbar(HDC hdc, int width, int height) {
         }
         g_gdip.DeletePath(bgPath);
     }
-    
-    // Create cached font resources on first paint. Each resource is gated
-    // independently so a partial failure (e.g. family OK but font NULL) does
-    // not permanently suppress retries on later paints.
-    if (!g_cachedFontFamily) {
-        g_gdip.CreateFontFamilyFromName(L"Segoe UI", NULL, &g_cachedFontFamily);
-    }
-    if (g_cachedFontFamily && !g_cachedFont) {
-        g_gdip.CreateFont(g_cachedFontFamily, 11.0f, 0, 2, &g_cachedFont);
+}
+
+// Buttons sit on the flat, opaque part of the chrome, so refilling a
+// button's rect with the background colour restores what was under it
+static void RestoreButtonBackground(int i) {
+    LayeredBitmap* lb = &g_ui.surface;
+    RECT* r = &g_ui.buttons[i].rect;
+    for (int y = r->top; y < r->bottom; y++) {
+        DWORD* row = (DWORD*)lb->pixels + (size_t)y * lb->width;
+        for (int x = r->left; x < r->right; x++) row[x] = COLOR_BG;  /* Opaque: premultiplied as-is */
     }
-    if (!g_cachedFormat) {
-        g_gdip.CreateStringFormat(0, 0, &g_cachedFormat);
-        if (g_cachedFormat) {
-            g_gdip.SetStringFormatAlign(g_cachedFormat, 1); // StringAlignmentCenter
-            g_gdip.SetStringFormatLineAlign(g_cachedFormat, 1); // StringAlignmentCenter
+}
+
+// Paint one button over the chrome
+static void PaintButton(GpGraphics* g, int i) {
+    RECT* r = &g_ui.buttons[i].rect;
+    ARGB btnColor = ButtonColor(i);
+    
+    GpPath* btnPath = CreateRoundedRectPath((REAL)r->left + 0.5f, (REAL)r->top + 0.5f, 
+                                              (REAL)(r->right - r->left) - 1, 
+                                              (REAL)(r->bottom - r->top) - 1, 4.0f);
+    if (btnPath) {
+        GpSolidFill* btnBrush = NULL;
+        g_gdip.CreateSolidFill(btnColor, &btnBrush);
+        if (btnBrush) {
+            g_gdip.FillPath(g, btnBrush, btnPath);
+            g_gdip.BrushDelete(btnBrush);
         }
+        g_gdip.DeletePath(btnPath);
     }
     
-    for (int i = 0; i < BTN_COUNT; i++) {
-        ARGB btnColor = COLOR_BTN;
-        if (i == g_ui.pressedButton) btnColor = COLOR_BTN_PRESS;
-        else if (i == g_ui.hoveredButton) btnColor = COLOR_BTN_HOVER;
+    // Draw text
+    if (g_cachedFont && g_cachedFormat) {
+        typedef struct { REAL X, Y, Width, Height; } RectF;
+        RectF textRect = { (REAL)r->left, (REAL)r->top, (REAL)(r->right - r->left), (REAL)(r->bottom - r->top) };
         
-        RECT* r = &g_ui.buttons[i].rect;
-        GpPath* btnPath = CreateRoundedRectPath((REAL)r->left + 0.5f, (REAL)r->top + 0.5f, 
-                                                  (REAL)(r->right - r->left) - 1, 
-                                                  (REAL)(r->bottom - r->top) - 1, 4.0f);
-        if (btnPath) {
-            GpSolidFill* btnBrush = NULL;
-            g_gdip.CreateSolidFill(btnColor, &btnBrush);
-            if (btnBrush) {
-                g_gdip.FillPath(g, btnBrush, btnPath);
-                g_gdip.BrushDelete(btnBrush);
-            }
-            g_gdip.DeletePath(btnPath);
-        }
-        
-        // Draw text
-        if (g_cachedFont && g_cachedFormat) {
-            typedef struct { REAL X, Y, Width, Height; } RectF;
-            RectF textRect = { (REAL)r->left, (REAL)r->top, (REAL)(r->right - r->left), (REAL)(r->bottom - r->top) };
-            
-            GpSolidFill* textBrush = NULL;
-            g_gdip.CreateSolidFill(COLOR_TEXT, &textBrush);
-            if (textBrush) {
-                g_gdip.DrawString(g, g_ui.buttons[i].text, -1, g_cachedFont, &textRect, g_cachedFormat, textBrush);
-                g_gdip.BrushDelete(textBrush);
-            }
+        GpSolidFill* textBrush = NULL;
+        g_gdip.CreateSolidFill(COLOR_TEXT, &textBrush);
+        if (textBrush) {
+            g_gdip.DrawString(g, g_ui.buttons[i].text, -1, g_cachedFont, &textRect, g_cachedFormat, textBrush);
+            g_gdip.BrushDelete(textBrush);
         }
     }
     
-    g_gdip.DeleteGraphics(g);
+    g_ui.paintedColor[i] = btnColor;
 }
 
-// Update the layered window
+// Bring the layered window up to date, repainting only what changed
 static void UpdateToolbarBitmap(void) {
     if (!g_ui.wnd) return;
     
-    int width = TOOLBAR_WIDTH;
-    int height = TOOLBAR_HEIGHT;
+    LayeredBitmap* lb = &g_ui.surface;
+    BOOL fresh = !lb->hBitmap;
+    if (!LayeredBitmap_Ensure(lb, TOOLBAR_WIDTH, TOOLBAR_HEIGHT)) return;
     
-    LayeredBitmap lb = {0};
-    if (!LayeredBitmap_Create(&lb, width, height)) return;
+    BOOL changed[BTN_COUNT];
+    BOOL anyChanged = fresh;
+    for (int i = 0; i < BTN_COUNT; i++) {
+        changed[i] = fresh || g_ui.paintedColor[i] != ButtonColor(i);
+        if (changed[i] && !fresh) RestoreButtonBackground(i);
+        anyChanged |= changed[i];
+    }
     
-    // Paint using GDI+
-    PaintToolbar(lb.memDC, width, height);
+    if (anyChanged) {
+        GpGraphics* g = NULL;
+        if (g_gdip.CreateFromHDC(lb->memDC, &g) != 0) return;
+        
+        // Enable anti-aliasing
+        g_gdip.SetSmoothingMode(g, 4); // SmoothingModeAntiAlias
+        g_gdip.SetTextRenderingHint(g, 5); // TextRenderingHintClearTypeGridFit
+        EnsureFontResources();
+        
+        if (fresh) PaintChrome(g, TOOLBAR_WIDTH, TOOLBAR_HEIGHT);
+        for (int i = 0; i < BTN_COUNT; i++) {
+            if (!changed[i]) continue;
+            PaintButton(g, i);
+            LayeredBitmap_Invalidate(lb, &g_ui.buttons[i].rect);
+        }
+        
+        g_gdip.DeleteGraphics(g);
+    }
     
-    // Apply and cleanup
     RECT wr;
     GetWindowRect(g_ui.wnd, &wr);
-    LayeredBitmap_Apply(&lb, g_ui.wnd, wr.left, wr.top);
-    LayeredBitmap_Destroy(&lb);
+    LayeredBitmap_Present(lb, g_ui.wnd, wr.left, wr.top);
 }
 
 // Hit test to find which button is under the cursor
@@ -224,16 +261,18 @@ static LRESULT CALLBACK ToolbarWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
     switch (msg) {
         case WM_CREATE: {
             // Setup button rectangles
-            // Buttons: [-] [●] [✕] [Settings]
+            // Buttons: [-] [●] [✕] [Settings] [Trim]
             int x = BTN_MARGIN;
             int smallBtnWidth = 32;    // For symbol buttons
             int settingsBtnWidth = 60; // For "Settings" text
+            int trimBtnWidth = 40;     // For "Trim" text
             int btnGap = BTN_GAP;
             
             g_ui.buttons[BTN_MINIMIZE].text = L"\u2014";  // Em dash (horizontal line)
             g_ui.buttons[BTN_RECORD].text = L"\u25CF";   // Filled circle
             g_ui.buttons[BTN_CLOSE].text = L"\u2715";    // Multiplication X
             g_ui.buttons[BTN_SETTINGS].text = L"Settings";
+            g_ui.buttons[BTN_TRIM].text = L"Trim";
             
             // Layout symbol buttons
             for (int i = 0; i <= BTN_CLOSE; i++) {
@@ -248,6 +287,12 @@ static LRESULT CALLBACK ToolbarWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
             g_ui.buttons[BTN_SETTINGS].rect.top = (TOOLBAR_HEIGHT - BTN_HEIGHT) / 2;
             g_ui.buttons[BTN_SETTINGS].rect.right = x + settingsBtnWidth;
             g_ui.buttons[BTN_SETTINGS].rect.bottom = g_ui.buttons[BTN_SETTINGS].rect.top + BTN_HEIGHT;
+            x += settingsBtnWidth + btnGap;
+            // Clip editor (trim / join saved clips)
+            g_ui.buttons[BTN_TRIM].rect.left = x;
+            g_ui.buttons[BTN_TRIM].rect.top = (TOOLBAR_HEIGHT - BTN_HEIGHT) / 2;
+            g_ui.buttons[BTN_TRIM].rect.right = x + trimBtnWidth;
+            g_ui.buttons[BTN_TRIM].rect.bottom = g_ui.buttons[BTN_TRIM].rect.top + BTN_HEIGHT;
             return 0;
         }
         
@@ -299,6 +344,7 @@ static LRESULT CALLBACK ToolbarWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     case BTN_RECORD:   if (g_ui.onRecord) g_ui.onRecord(); break;
                     case BTN_CLOSE:    if (g_ui.onClose) g_ui.onClose(); break;
                     case BTN_SETTINGS: if (g_ui.onSettings) g_ui.onSettings(); break;
+                    case BTN_TRIM:     if (g_ui.onTrim) g_ui.onTrim(); break;
                 }
             }
             
@@ -361,6 +407,7 @@ void ActionToolbar_Shutdown(void) {
         DestroyWindow(g_ui.wnd);
         g_ui.wnd = NULL;
     }
+    LayeredBitmap_Destroy(&g_ui.surface);
     
     // Release cached GDI+ font resources
     if (g_cachedFormat)     { g_gdip.DeleteStringFormat(g_cachedFormat); g_cachedFormat = NULL; }
@@ -395,3 +442,7 @@ void ActionToolbar_SetCallbacks(void (*onMinimize)(void), void (*onRecord)(void)
     g_ui.onClose = onClose;
     g_ui.onSettings = onSettings;
 }
+
+void ActionToolbar_SetTrimCallback(void (*onTrim)(void)) {
+    g_ui.onTrim = onTrim;
+}
@@ -27,4 +27,7 @@ void ActionToolbar_Hide(void);
 void ActionToolbar_SetCallbacks(void (*onMinimize)(void), void (*onRecord)(void), 
                                  void (*onClose)(void), void (*onSettings)(void));
 
+// onTrim: called when "Trim" button clicked (clip trim / join)
+void ActionToolbar_SetTrimCallback(void (*onTrim)(void));
+
 #endif // ACTION_TOOLBAR_H
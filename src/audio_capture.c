@@ -7,6 +7,30 @@
  * - Device invalidation errors (AUDCLNT_E_*) trigger graceful shutdown
  * - All WASAPI errors are logged with HRESULT values
  * - Returns BOOL/NULL to propagate errors; callers must check
+ *
+ * WAKEUPS:
+ * - Sources initialized with AUDCLNT_STREAMFLAGS_EVENTCALLBACK (ctx->eventDriven)
+ *   wait on their buffer event; a source whose client refuses it polls every
+ *   AUDIO_POLL_INTERVAL_MS as before. Loopback waits are bounded by the poll
+ *   interval because loopback events are unreliable (see constants.h).
+ * - Source threads signal ctx->dataReady after each write; the mix thread
+ *   waits on it until the first PCM and sleeps to the wall-clock deadline
+ *   after that. The mix thread signals ctx->outputReady after each chunk
+ *   for whoever reads the output rings.
+ * - Source and mix threads run in the MMCSS "Pro Audio" class.
+ *
+ * TONE SOURCES:
+ * - A device id of AUDIO_TONE_SOURCE_PREFIX + frequency creates a source
+ *   with no WASAPI client: its thread writes a sine wave already in the
+ *   target format, paced by QPC, into the same ring a device would. The
+ *   mix thread cannot tell the difference.
+ *
+ * CLOCK DRIFT:
+ * - Each capture thread measures its device clock against the GetBuffer QPC
+ *   positions (DriftTracker) and, with ctx->driftCorrection, steers its
+ *   resampler so the source delivers AUDIO_SAMPLE_RATE frames per QPC
+ *   second, matching the mix thread's pacing. See AUDIO CLOCK DRIFT in
+ *   constants.h.
  */
 
 #define COBJMACROS
@@ -14,6 +38,8 @@
 
 #include "audio_capture.h"
 #include "audio_device.h"
+#include "audio_mix.h"
+#include "audio_resample.h"
 #include "audio_guids.h"
 #include "util.h"
 #include "logger.h"
@@ -21,6 +47,27 @@
 #include "mem_utils.h"
 #include <mmdeviceapi.h>
 #include <audioclient.h>
+#include <avrt.h>
+#include <math.h>
+
+/*
+ * Clock drift of one source against QPC. Rate: device frames delivered per
+ * QPC second since a sliding anchor. Offset: resampled frames produced
+ * minus those QPC says are due since the base (both restarted on a gap or
+ * device-position jump). Capture thread only.
+ */
+typedef struct {
+    BOOL anchored;
+    UINT64 anchorDevicePos;     // GetBuffer device position at the rate anchor
+    LONGLONG anchorQpc;         // ...its QPC position (100ns)
+    UINT64 anchorConsumed;      // ...and consumed at that point
+    LONGLONG baseQpc;           // Offset base
+    LONGLONG baseProduced;
+    LONGLONG lastQpc;
+    LONGLONG lastUpdateQpc;
+    UINT64 consumed;            // Device frames fed to the resampler
+    LONGLONG produced;          // Frames the resampler produced
+} DriftTracker;
 
 /* Individual audio source capture */
 struct AudioCaptureSource {
@@ -35,20 +82,17 @@ struct AudioCaptureSource {
     WAVEFORMATEX* deviceFormat;
     WAVEFORMATEX targetFormat;
     
-    /* Per-source buffer */
-    BYTE* buffer;
-    int bufferSize;
-    int bufferWritePos;
-    int bufferAvailable;
-    CRITICAL_SECTION lock;
+    /* Converted PCM: capture thread -> mix thread */
+    SpscRing ring;
     
     HANDLE captureThread;  /* Thread handle for proper cleanup */
     volatile LONG active;  /* Thread-safe: use InterlockedExchange */
     
-    /* Timing for event-driven sources */
-    LARGE_INTEGER lastPacketTime;
+    /* Timing for event-driven sources. Written by the capture thread, read
+     * by the mix thread: use Interlocked* */
+    volatile LONG64 lastPacketTime;
     LARGE_INTEGER perfFreq;
-    BOOL hasReceivedPacket;
+    volatile LONG hasReceivedPacket;
     
     /* Device invalidation tracking */
     volatile LONG deviceInvalidated;
@@ -56,6 +100,22 @@ struct AudioCaptureSource {
     
     /* Recovery tracking */
     LARGE_INTEGER lastRecoveryAttempt;
+    
+    /* Event-driven capture: useEvents is requested, eventMode is what the
+     * current IAudioClient was initialized with. sampleEvent is owned and
+     * survives recovery; mixWake is the context's dataReady (borrowed). */
+    BOOL useEvents;
+    BOOL eventMode;
+    HANDLE sampleEvent;
+    HANDLE mixWake;
+
+    /* Drift correction requested (ctx->driftCorrection at start); the
+     * measured drift in ppm x 100, published for AudioCapture_GetSourceDriftPpm */
+    BOOL driftCorrection;
+    volatile LONG driftPpmCenti;
+
+    /* Tone source (AUDIO_TONE_SOURCE_PREFIX): frequency in Hz, 0 = device */
+    int toneHz;
 
     /* IAudioClient::Initialize succeeds at most once; reused across Stop/Start */
     BOOL initialized;
@@ -81,25 +141,54 @@ void AudioCapture_Shutdown(void) {
     // Enumerator is owned by AudioDevice, nothing to release here
 }
 
+// Tone source: only the ring; no device, client or format negotiation
+static AudioCaptureSource* CreateToneSource(const char* deviceId) {
+    int hz = atoi(deviceId + strlen(AUDIO_TONE_SOURCE_PREFIX));
+    if (hz <= 0 || hz >= AUDIO_SAMPLE_RATE / 2) {
+        Logger_Log("CreateToneSource: bad frequency in '%s'\n", deviceId);
+        return NULL;
+    }
+    
+    AudioCaptureSource* src = (AudioCaptureSource*)calloc(1, sizeof(AudioCaptureSource));
+    if (!src) return NULL;
+    
+    strncpy(src->deviceId, deviceId, sizeof(src->deviceId) - 1);
+    src->toneHz = hz;
+    src->type = AUDIO_DEVICE_INPUT;
+    src->targetFormat.wFormatTag = WAVE_FORMAT_PCM;
+    src->targetFormat.nChannels = AUDIO_CHANNELS;
+    src->targetFormat.nSamplesPerSec = AUDIO_SAMPLE_RATE;
+    src->targetFormat.wBitsPerSample = AUDIO_BITS_PER_SAMPLE;
+    src->targetFormat.nBlockAlign = AUDIO_BLOCK_ALIGN;
+    src->targetFormat.nAvgBytesPerSec = AUDIO_BYTES_PER_SEC;
+    
+    if (!SpscRing_Init(&src->ring, SOURCE_BUFFER_SIZE)) {
+        free(src);
+        return NULL;
+    }
+    Logger_Log("CreateSource: synthetic %d Hz tone\n", hz);
+    return src;
+}
+
 // Create a single capture source
 // Uses goto-cleanup pattern for consistent resource cleanup on all error paths
 static AudioCaptureSource* CreateSource(const char* deviceId) {
     IMMDeviceEnumerator* enumerator = AudioDevice_GetEnumerator();
+    if (deviceId && strncmp(deviceId, AUDIO_TONE_SOURCE_PREFIX, strlen(AUDIO_TONE_SOURCE_PREFIX)) == 0) {
+        return CreateToneSource(deviceId);
+    }
     if (!deviceId || deviceId[0] == '\0' || !enumerator) {
         return NULL;
     }
     
     // Initialize all resources to NULL for safe cleanup
     AudioCaptureSource* src = NULL;
-    BOOL csInitialized = FALSE;
     HRESULT hr;
     
     src = (AudioCaptureSource*)calloc(1, sizeof(AudioCaptureSource));
     if (!src) goto cleanup;
     
     strncpy(src->deviceId, deviceId, sizeof(src->deviceId) - 1);
-    InitializeCriticalSection(&src->lock);
-    csInitialized = TRUE;
     
     // Get device info to determine if loopback
     AudioDeviceInfo info;
@@ -150,10 +239,8 @@ static AudioCaptureSource* CreateSource(const char* deviceId) {
     src->targetFormat.nAvgBytesPerSec = AUDIO_BYTES_PER_SEC;
     src->targetFormat.cbSize = 0;
     
-    // Allocate buffer
-    src->bufferSize = SOURCE_BUFFER_SIZE;
-    src->buffer = (BYTE*)malloc(src->bufferSize);
-    if (!src->buffer) goto cleanup;
+    // Allocate ring
+    if (!SpscRing_Init(&src->ring, SOURCE_BUFFER_SIZE)) goto cleanup;
     
     // Success - return the source
     return src;
@@ -162,11 +249,10 @@ cleanup:
     /* Clean up in reverse order of acquisition using SAFE_* macros */
     /* All pointers were initialized to NULL by calloc, so SAFE_* macros are safe */
     if (src) {
-        SAFE_FREE(src->buffer);
+        SpscRing_Free(&src->ring);
         SAFE_COTASKMEM_FREE(src->deviceFormat);
         SAFE_RELEASE(src->audioClient);
         SAFE_RELEASE(src->device);
-        if (csInitialized) DeleteCriticalSection(&src->lock);
         free(src);
     }
     return NULL;
@@ -180,9 +266,9 @@ static void DestroySource(AudioCaptureSource* src) {
     SAFE_COTASKMEM_FREE(src->deviceFormat);
     SAFE_RELEASE(src->audioClient);
     SAFE_RELEASE(src->device);
-    SAFE_FREE(src->buffer);
+    SpscRing_Free(&src->ring);
+    SAFE_CLOSE_HANDLE(src->sampleEvent);
     
-    DeleteCriticalSection(&src->lock);
     free(src);
 }
 
@@ -268,13 +354,11 @@ static BOOL TryRecoverSource(AudioCaptureSource* src) {
     // Clear invalidation flag and error count (use Interlocked for thread safety)
     InterlockedExchange(&src->deviceInvalidated, FALSE);
     src->consecutiveErrors = 0;
-    src->hasReceivedPacket = FALSE;
+    InterlockedExchange(&src->hasReceivedPacket, FALSE);
     
-    // Clear buffer (protected by critical section)
-    EnterCriticalSection(&src->lock);
-    src->bufferAvailable = 0;
-    src->bufferWritePos = 0;
-    LeaveCriticalSection(&src->lock);
+    // Drop stale PCM. Runs on the mix thread, the ring's consumer, while
+    // the capture thread (the producer) is stopped.
+    SpscRing_Clear(&src->ring);
     
     // Restart capture thread (use Interlocked for thread safety)
     InterlockedExchange(&src->active, TRUE);
@@ -308,6 +392,22 @@ cleanup:
 // Recovery interval: try every 5 seconds
 #define AUDIO_RECOVERY_INTERVAL_MS 5000
 
+/* Join the MMCSS "Pro Audio" class so capture and mixing keep their
+ * schedule under CPU load (games, encodes). Returns the handle to pass to
+ * EndProAudioThread; NULL (logged) if the service refused. */
+static HANDLE BeginProAudioThread(const char* name) {
+    DWORD taskIndex = 0;
+    HANDLE task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+    if (!task) {
+        Logger_Log("%s: AvSetMmThreadCharacteristics failed (%u)\n", name, GetLastError());
+    }
+    return task;
+}
+
+static void EndProAudioThread(HANDLE task) {
+    if (task) AvRevertMmThreadCharacteristics(task);
+}
+
 // Initialize a source for capture
 static BOOL InitSourceCapture(AudioCaptureSource* src) {
     if (!src || !src->audioClient) return FALSE;
@@ -321,27 +421,51 @@ static BOOL InitSourceCapture(AudioCaptureSource* src) {
     // Buffer duration in 100ns units (100ms)
     REFERENCE_TIME bufferDuration = WASAPI_BUFFER_DURATION_100NS;
     
-    // NOTE: Don't use AUDCLNT_STREAMFLAGS_EVENTCALLBACK - we poll instead
-    // Using event callback requires SetEventHandle which adds complexity
     DWORD streamFlags = 0;
     if (src->isLoopback) {
         streamFlags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
     }
     
-    Logger_Log("InitSourceCapture: device='%s', isLoopback=%d, flags=0x%X\n", 
-        src->deviceId, src->isLoopback, streamFlags);
+    // Event callback needs an event to hand to SetEventHandle
+    src->eventMode = FALSE;
+    if (src->useEvents && !src->sampleEvent) {
+        src->sampleEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (!src->sampleEvent) {
+            Logger_Log("InitSourceCapture: CreateEvent failed (%u) for '%s' - polling\n",
+                GetLastError(), src->deviceId);
+        }
+    }
+    BOOL tryEvents = src->useEvents && src->sampleEvent;
+    
+    Logger_Log("InitSourceCapture: device='%s', isLoopback=%d, flags=0x%X, events=%d\n", 
+        src->deviceId, src->isLoopback, streamFlags, tryEvents);
     
     // Initialize audio client
     // Use device's native format - we'll convert later
     HRESULT hr = src->audioClient->lpVtbl->Initialize(
         src->audioClient,
         AUDCLNT_SHAREMODE_SHARED,
-        streamFlags,
+        streamFlags | (tryEvents ? AUDCLNT_STREAMFLAGS_EVENTCALLBACK : 0),
         bufferDuration,
         0,
         src->deviceFormat,
         NULL
     );
+    if (FAILED(hr) && tryEvents) {
+        // Some virtual and older loopback endpoints refuse the event flag
+        Logger_Log("InitSourceCapture: event Initialize failed (0x%08X) for '%s' - polling\n",
+            hr, src->deviceId);
+        tryEvents = FALSE;
+        hr = src->audioClient->lpVtbl->Initialize(
+            src->audioClient,
+            AUDCLNT_SHAREMODE_SHARED,
+            streamFlags,
+            bufferDuration,
+            0,
+            src->deviceFormat,
+            NULL
+        );
+    }
     
     if (FAILED(hr)) {
         Logger_Log("InitSourceCapture: Initialize failed (0x%08X) for '%s'\n", hr, src->deviceId);
@@ -350,6 +474,16 @@ static BOOL InitSourceCapture(AudioCaptureSource* src) {
     
     Logger_Log("InitSourceCapture: Initialize succeeded for '%s'\n", src->deviceId);
     
+    if (tryEvents) {
+        // Without a handle the event-flagged client cannot Start
+        hr = src->audioClient->lpVtbl->SetEventHandle(src->audioClient, src->sampleEvent);
+        if (FAILED(hr)) {
+            Logger_Log("InitSourceCapture: SetEventHandle failed (0x%08X) for '%s'\n", hr, src->deviceId);
+            return FALSE;
+        }
+        src->eventMode = TRUE;
+    }
+    
     // Get capture client
     hr = src->audioClient->lpVtbl->GetService(
         src->audioClient,
@@ -371,27 +505,13 @@ static BOOL InitSourceCapture(AudioCaptureSource* src) {
 static const GUID KSDATAFORMAT_SUBTYPE_IEEE_FLOAT_Local = 
     {0x00000003, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71}};
 
-// Convert audio samples to target format WITH RESAMPLING
-// Uses linear interpolation for sample rate conversion
-// outUnsupported (optional): set to TRUE if srcFmt is not 16-bit PCM, 24-bit PCM,
-//   or 32-bit IEEE float. Output bytes are still produced (as silence) so the
-//   caller can keep the timeline paced.
-static int ConvertSamples(
-    const BYTE* srcData, int srcSamples, const WAVEFORMATEX* srcFmt,
-    BYTE* dstData, int dstMaxBytes, const WAVEFORMATEX* dstFmt,
-    BOOL* outUnsupported
-) {
-    if (outUnsupported) *outUnsupported = FALSE;
-    if (!srcData || !dstData || srcSamples == 0) return 0;
+// Sample layout of a device mix format, for AudioResampler_Process.
+// Float is recognized from the plain tag or the extensible SubFormat.
+static AudioSampleFormat ClassifyFormat(const WAVEFORMATEX* fmt) {
+    if (!fmt) return AUDIO_SAMPLE_UNSUPPORTED;
     
-    // Get source format details
-    int srcChannels = srcFmt->nChannels;
-    int srcBits = srcFmt->wBitsPerSample;
-    int srcRate = srcFmt->nSamplesPerSec;
-    
-    // Detect float format - check both plain tag and extensible SubFormat
-    BOOL srcFloat = (srcFmt->wFormatTag == WAVE_FORMAT_IEEE_FLOAT);
-    if (srcFmt->wFormatTag == WAVE_FORMAT_EXTENSIBLE && srcFmt->cbSize >= 22) {
+    BOOL isFloat = (fmt->wFormatTag == WAVE_FORMAT_IEEE_FLOAT);
+    if (fmt->wFormatTag == WAVE_FORMAT_EXTENSIBLE && fmt->cbSize >= 22) {
         // WAVEFORMATEXTENSIBLE - check SubFormat GUID
         typedef struct {
             WAVEFORMATEX Format;
@@ -404,98 +524,74 @@ static int ConvertSamples(
             GUID SubFormat;
         } WAVEFORMATEXTENSIBLE_LOCAL;
         
-        const WAVEFORMATEXTENSIBLE_LOCAL* extFmt = (const WAVEFORMATEXTENSIBLE_LOCAL*)srcFmt;
+        const WAVEFORMATEXTENSIBLE_LOCAL* extFmt = (const WAVEFORMATEXTENSIBLE_LOCAL*)fmt;
         if (memcmp(&extFmt->SubFormat, &KSDATAFORMAT_SUBTYPE_IEEE_FLOAT_Local, sizeof(GUID)) == 0) {
-            srcFloat = TRUE;
+            isFloat = TRUE;
         }
     }
     
-    // Get dest format details
-    int dstChannels = dstFmt->nChannels;
-    int dstRate = dstFmt->nSamplesPerSec;
+    if (isFloat) return fmt->wBitsPerSample == 32 ? AUDIO_SAMPLE_F32 : AUDIO_SAMPLE_UNSUPPORTED;
+    if (fmt->wBitsPerSample == 16) return AUDIO_SAMPLE_S16;
+    if (fmt->wBitsPerSample == 24) return AUDIO_SAMPLE_S24;
+    return AUDIO_SAMPLE_UNSUPPORTED;
+}
+
+static void Drift_Anchor(DriftTracker* d, UINT64 devicePos, LONGLONG qpc) {
+    d->anchored = TRUE;
+    d->anchorDevicePos = devicePos;
+    d->anchorQpc = qpc;
+    d->anchorConsumed = d->consumed;
+    d->baseQpc = qpc;
+    d->baseProduced = d->produced;
+    d->lastUpdateQpc = qpc;
+}
+
+/*
+ * Account one packet before it is resampled. Returns the resampler ratio
+ * to apply now, or 0 to leave it. *measured gets the device clock rate
+ * over its nominal rate whenever a new estimate is made.
+ */
+static double Drift_OnPacket(DriftTracker* d, UINT64 devicePos, LONGLONG qpc, DWORD flags,
+                             int srcRate, int dstRate, double* measured) {
+    const LONGLONG msToQpc = 10000;  // GetBuffer QPC positions are 100ns
     
-    // Calculate output sample count based on sample rate ratio
-    int dstSamples = (int)((double)srcSamples * dstRate / srcRate);
-    if (dstSamples * dstFmt->nBlockAlign > dstMaxBytes) {
-        dstSamples = dstMaxBytes / dstFmt->nBlockAlign;
+    if (flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) {
+        d->anchored = FALSE;
+        return 0.0;
     }
-    if (dstSamples <= 0) return 0;
-
-    /* Validate that we actually support this source format. If not, still emit
-     * silence so the timeline stays paced and let the caller log + recover. */
-    BOOL supported = (srcFloat && srcBits == 32) || srcBits == 16 || srcBits == 24;
-    if (!supported && outUnsupported) *outUnsupported = TRUE;
-    if (!supported) {
-        int totalBytes = dstSamples * dstFmt->nBlockAlign;
-        if (totalBytes > dstMaxBytes) totalBytes = dstMaxBytes;
-        memset(dstData, 0, totalBytes);
-        return totalBytes;
+    BOOL broken = !d->anchored ||
+                  (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) ||
+                  qpc - d->lastQpc > AUDIO_DRIFT_GAP_MS * msToQpc ||
+                  devicePos - d->anchorDevicePos != d->consumed - d->anchorConsumed;
+    d->lastQpc = qpc;
+    if (broken) {
+        Drift_Anchor(d, devicePos, qpc);
+        return 0.0;
     }
-
-    // Helper function to read a source sample as float stereo
-    #define READ_SRC_SAMPLE(idx, pLeft, pRight) do { \
-        int _i = (idx); \
-        if (_i >= srcSamples) _i = srcSamples - 1; \
-        if (_i < 0) _i = 0; \
-        float _l = 0, _r = 0; \
-        if (srcFloat && srcBits == 32) { \
-            const float* sf = (const float*)(srcData + _i * srcFmt->nBlockAlign); \
-            _l = sf[0]; \
-            _r = (srcChannels >= 2) ? sf[1] : _l; \
-        } else if (srcBits == 16) { \
-            const short* ss = (const short*)(srcData + _i * srcFmt->nBlockAlign); \
-            _l = ss[0] / AUDIO_16BIT_MAX; \
-            _r = (srcChannels >= 2) ? ss[1] / AUDIO_16BIT_MAX : _l; \
-        } else if (srcBits == 24) { \
-            const BYTE* p = srcData + _i * srcFmt->nBlockAlign; \
-            int s1 = (p[0] | (p[1] << 8) | (p[2] << 16)); \
-            if (s1 & AUDIO_24BIT_SIGN_MASK) s1 |= AUDIO_24BIT_SIGN_EXTEND; \
-            _l = s1 / AUDIO_24BIT_MAX; \
-            if (srcChannels >= 2) { \
-                int s2 = (p[3] | (p[4] << 8) | (p[5] << 16)); \
-                if (s2 & AUDIO_24BIT_SIGN_MASK) s2 |= AUDIO_24BIT_SIGN_EXTEND; \
-                _r = s2 / AUDIO_24BIT_MAX; \
-            } else { _r = _l; } \
-        } \
-        *(pLeft) = _l; *(pRight) = _r; \
-    } while(0)
-    
-    // Resample using linear interpolation
-    double srcPos = 0.0;
-    double srcStep = (double)srcRate / dstRate;
-    
-    for (int i = 0; i < dstSamples; i++) {
-        int srcIdx = (int)srcPos;
-        double frac = srcPos - srcIdx;
-        
-        // Read two adjacent source samples
-        float left0, right0, left1, right1;
-        READ_SRC_SAMPLE(srcIdx, &left0, &right0);
-        READ_SRC_SAMPLE(srcIdx + 1, &left1, &right1);
-        
-        // Linear interpolation
-        float left = left0 + (float)(frac * (left1 - left0));
-        float right = right0 + (float)(frac * (right1 - right0));
-        
-        // Clamp
-        if (left > 1.0f) left = 1.0f;
-        if (left < -1.0f) left = -1.0f;
-        if (right > 1.0f) right = 1.0f;
-        if (right < -1.0f) right = -1.0f;
-        
-        // Write to destination as 16-bit
-        short* dstShorts = (short*)(dstData + i * dstFmt->nBlockAlign);
-        dstShorts[0] = (short)(left * AUDIO_16BIT_MAX_SIGNED);
-        if (dstChannels >= 2) {
-            dstShorts[1] = (short)(right * AUDIO_16BIT_MAX_SIGNED);
-        }
-        
-        srcPos += srcStep;
+    
+    LONGLONG span = qpc - d->anchorQpc;
+    if (span < AUDIO_DRIFT_SETTLE_MS * msToQpc || qpc - d->lastUpdateQpc < AUDIO_DRIFT_UPDATE_MS * msToQpc) {
+        return 0.0;
     }
+    d->lastUpdateQpc = qpc;
     
-    #undef READ_SRC_SAMPLE
+    double rate = (double)(d->consumed - d->anchorConsumed) * MF_UNITS_PER_SECOND / ((double)span * srcRate);
+    if (fabs(rate - 1.0) > AUDIO_DRIFT_MAX_PPM * 1e-6) {
+        // Not a clock error a crystal makes: bad timestamps, start over
+        Drift_Anchor(d, devicePos, qpc);
+        return 0.0;
+    }
+    *measured = rate;
+    if (span > AUDIO_DRIFT_WINDOW_MS * msToQpc) {
+        d->anchorDevicePos = devicePos;
+        d->anchorQpc = qpc;
+        d->anchorConsumed = d->consumed;
+    }
     
-    return dstSamples * dstFmt->nBlockAlign;
+    // Too many frames out so far -> consume input a little faster
+    double due = (double)(qpc - d->baseQpc) * dstRate / MF_UNITS_PER_SECOND;
+    double offset = (double)(d->produced - d->baseProduced) - due;
+    return rate * (1.0 + offset / (dstRate * AUDIO_DRIFT_SLEW_SEC));
 }
 
 // Capture thread for a single source
@@ -517,6 +613,40 @@ static DWORD WINAPI SourceCaptureThread(LPVOID param) {
         return 0;
     }
     
+    /* One resampler per capture session: filter state runs across packets.
+     * Created here because recovery may come back with a different format. */
+    const WAVEFORMATEX* devFmt = src->deviceFormat;
+    AudioSampleFormat sampleFormat = ClassifyFormat(devFmt);
+    AudioResampler* resampler = AudioResampler_Create(devFmt->nSamplesPerSec,
+                                                      src->targetFormat.nSamplesPerSec);
+    if (!resampler) {
+        Logger_Log("SourceCaptureThread: AudioResampler_Create failed for '%s'\n", src->deviceId);
+        free(convBuffer);
+        InterlockedExchange(&src->active, FALSE);
+        if (coOwned) CoUninitialize();
+        return 0;
+    }
+    if (sampleFormat == AUDIO_SAMPLE_UNSUPPORTED && !src->formatWarned) {
+        src->formatWarned = TRUE;
+        Logger_Log("SourceCaptureThread: unsupported wave format for '%s' "
+            "(tag=%u, bits=%u, channels=%u, rate=%u) - emitting silence\n",
+            src->deviceId,
+            (unsigned)devFmt->wFormatTag,
+            (unsigned)devFmt->wBitsPerSample,
+            (unsigned)devFmt->nChannels,
+            (unsigned)devFmt->nSamplesPerSec);
+    }
+    const int maxFrames = SOURCE_BUFFER_SIZE / src->targetFormat.nBlockAlign;
+    
+    DriftTracker drift;
+    ZeroMemory(&drift, sizeof(drift));
+    InterlockedExchange(&src->driftPpmCenti, 0);
+    
+    HANDLE mmTask = BeginProAudioThread("SourceCaptureThread");
+    
+    // Loopback events can stay unsignaled, so never wait longer than a poll
+    DWORD eventTimeout = src->isLoopback ? AUDIO_POLL_INTERVAL_MS : AUDIO_EVENT_TIMEOUT_MS;
+    
     while (InterlockedCompareExchange(&src->active, 0, 0)) {
         // Heartbeat (use AUDIO_SRC1 - we could differentiate but keep it simple)
         Logger_Heartbeat(THREAD_AUDIO_SRC);
@@ -548,14 +678,16 @@ static DWORD WINAPI SourceCaptureThread(LPVOID param) {
             BYTE* data = NULL;
             UINT32 numFrames = 0;
             DWORD flags = 0;
+            UINT64 devicePos = 0;
+            UINT64 qpcPos = 0;
             
             hr = src->captureClient->lpVtbl->GetBuffer(
                 src->captureClient,
                 &data,
                 &numFrames,
                 &flags,
-                NULL,
-                NULL
+                &devicePos,
+                &qpcPos
             );
             
             if (FAILED(hr)) {
@@ -566,69 +698,41 @@ static DWORD WINAPI SourceCaptureThread(LPVOID param) {
             }
             
             if (numFrames > 0 && data) {
-                int convertedBytes = 0;
-                
-                if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {
-                    // Silent - write zeros with proper resampling
-                    // numFrames is in source sample rate, convert to target rate
-                    int srcRate = src->deviceFormat->nSamplesPerSec;
-                    int dstRate = src->targetFormat.nSamplesPerSec;
-                    int dstFrames = (int)((double)numFrames * dstRate / srcRate);
-                    convertedBytes = dstFrames * src->targetFormat.nBlockAlign;
-                    if (convertedBytes > SOURCE_BUFFER_SIZE) {
-                        convertedBytes = SOURCE_BUFFER_SIZE;
-                    }
-                    memset(convBuffer, 0, convertedBytes);
-                } else {
-                    // Convert to target format
-                    BOOL unsupported = FALSE;
-                    convertedBytes = ConvertSamples(
-                        data, numFrames, src->deviceFormat,
-                        convBuffer, SOURCE_BUFFER_SIZE, &src->targetFormat,
-                        &unsupported
-                    );
-                    if (unsupported && !src->formatWarned) {
-                        src->formatWarned = TRUE;
-                        Logger_Log("SourceCaptureThread: unsupported wave format for '%s' "
-                            "(tag=%u, bits=%u, channels=%u, rate=%u) - emitting silence\n",
-                            src->deviceId,
-                            (unsigned)src->deviceFormat->wFormatTag,
-                            (unsigned)src->deviceFormat->wBitsPerSample,
-                            (unsigned)src->deviceFormat->nChannels,
-                            (unsigned)src->deviceFormat->nSamplesPerSec);
-                    }
+                double measured = 0.0;
+                double ratio = Drift_OnPacket(&drift, devicePos, (LONGLONG)qpcPos, flags,
+                                              (int)devFmt->nSamplesPerSec,
+                                              (int)src->targetFormat.nSamplesPerSec, &measured);
+                if (measured > 0.0) {
+                    InterlockedExchange(&src->driftPpmCenti, (LONG)floor((measured - 1.0) * 1e8 + 0.5));
+                }
+                if (ratio > 0.0 && src->driftCorrection) {
+                    AudioResampler_SetRatio(resampler, ratio);
                 }
                 
-                // Write to source ring buffer
+                // Silent packets go through the resampler as zeros so its
+                // history and phase stay continuous
+                const BYTE* pcm = (flags & AUDCLNT_BUFFERFLAGS_SILENT) ? NULL : data;
+                int frames = AudioResampler_Process(
+                    resampler, pcm, (int)numFrames, sampleFormat,
+                    devFmt->nChannels, devFmt->nBlockAlign,
+                    (short*)convBuffer, maxFrames
+                );
+                drift.consumed += numFrames;
+                drift.produced += frames;
+                int convertedBytes = frames * src->targetFormat.nBlockAlign;
+                
+                // Write to source ring (a full ring drops the excess;
+                // only the mix thread may discard the oldest bytes)
                 if (convertedBytes > 0) {
-                    EnterCriticalSection(&src->lock);
-                    
-                    int spaceAvailable = src->bufferSize - src->bufferAvailable;
-                    if (convertedBytes > spaceAvailable) {
-                        // Buffer full - drop oldest data
-                        int toDrop = convertedBytes - spaceAvailable;
-                        src->bufferAvailable -= toDrop;
-                    }
-                    
-                    // Write in possibly two parts (ring buffer wrap)
-                    int writePos = src->bufferWritePos;
-                    int toEnd = src->bufferSize - writePos;
-                    
-                    if (convertedBytes <= toEnd) {
-                        memcpy(src->buffer + writePos, convBuffer, convertedBytes);
-                    } else {
-                        memcpy(src->buffer + writePos, convBuffer, toEnd);
-                        memcpy(src->buffer, convBuffer + toEnd, convertedBytes - toEnd);
-                    }
-                    
-                    src->bufferWritePos = (writePos + convertedBytes) % src->bufferSize;
-                    src->bufferAvailable += convertedBytes;
+                    SpscRing_Write(&src->ring, convBuffer, convertedBytes);
                     
                     // Record that we received a packet (for event-driven source detection)
-                    QueryPerformanceCounter(&src->lastPacketTime);
-                    src->hasReceivedPacket = TRUE;
+                    LARGE_INTEGER packetTime;
+                    QueryPerformanceCounter(&packetTime);
+                    InterlockedExchange64(&src->lastPacketTime, packetTime.QuadPart);
+                    InterlockedExchange(&src->hasReceivedPacket, TRUE);
                     
-                    LeaveCriticalSection(&src->lock);
+                    if (src->mixWake) SetEvent(src->mixWake);
                 }
             }
 
@@ -648,18 +752,80 @@ static DWORD WINAPI SourceCaptureThread(LPVOID param) {
             if (FAILED(hr)) break;
         }
 
-        Sleep(AUDIO_POLL_INTERVAL_MS);  // Poll interval between checks
+        if (src->eventMode) {
+            WaitForSingleObject(src->sampleEvent, eventTimeout);
+        } else {
+            Sleep(AUDIO_POLL_INTERVAL_MS);  // Poll interval between checks
+        }
     }
     
+    EndProAudioThread(mmTask);
+    AudioResampler_Destroy(resampler);
     free(convBuffer);
     if (coOwned) CoUninitialize();
     return 0;
 }
 
+/*
+ * Tone source thread: every AUDIO_POLL_INTERVAL_MS, write the frames QPC
+ * says are due since start, so the source runs at exactly
+ * AUDIO_SAMPLE_RATE frames per QPC second (no drift to correct).
+ */
+static DWORD WINAPI ToneSourceThread(LPVOID param) {
+    AudioCaptureSource* src = (AudioCaptureSource*)param;
+    if (!src) return 0;
+    
+    const int maxFrames = SOURCE_BUFFER_SIZE / AUDIO_BLOCK_ALIGN / 4;
+    short* block = (short*)malloc((size_t)maxFrames * AUDIO_BLOCK_ALIGN);
+    if (!block) {
+        Logger_Log("ToneSourceThread: malloc failed\n");
+        InterlockedExchange(&src->active, FALSE);
+        return 0;
+    }
+    
+    HANDLE mmTask = BeginProAudioThread("ToneSourceThread");
+    const double step = 2.0 * 3.14159265358979323846 * (double)src->toneHz / (double)AUDIO_SAMPLE_RATE;
+    const double amplitude = 32767.0 * 0.25;  /* -12 dBFS */
+    double phase = 0.0;
+    LONGLONG written = 0;
+    LARGE_INTEGER start, now;
+    QueryPerformanceCounter(&start);
+    
+    while (InterlockedCompareExchange(&src->active, 0, 0)) {
+        Logger_Heartbeat(THREAD_AUDIO_SRC);
+        
+        QueryPerformanceCounter(&now);
+        LONGLONG ticks = now.QuadPart - start.QuadPart;
+        LONGLONG due = (ticks / src->perfFreq.QuadPart) * AUDIO_SAMPLE_RATE +
+                       (ticks % src->perfFreq.QuadPart) * AUDIO_SAMPLE_RATE / src->perfFreq.QuadPart;
+        int frames = (int)min(due - written, (LONGLONG)maxFrames);
+        
+        if (frames > 0) {
+            for (int i = 0; i < frames; i++) {
+                short v = (short)(sin(phase) * amplitude);
+                for (int c = 0; c < AUDIO_CHANNELS; c++) block[i * AUDIO_CHANNELS + c] = v;
+                phase += step;
+                if (phase >= 2.0 * 3.14159265358979323846) phase -= 2.0 * 3.14159265358979323846;
+            }
+            SpscRing_Write(&src->ring, (const BYTE*)block, frames * AUDIO_BLOCK_ALIGN);
+            written += frames;
+            
+            InterlockedExchange64(&src->lastPacketTime, now.QuadPart);
+            InterlockedExchange(&src->hasReceivedPacket, TRUE);
+            if (src->mixWake) SetEvent(src->mixWake);
+        }
+        Sleep(AUDIO_POLL_INTERVAL_MS);
+    }
+    
+    EndProAudioThread(mmTask);
+    free(block);
+    return 0;
+}
+
 /*
  * MULTI-RESOURCE FUNCTION: AudioCapture_Create
- * Resources: 4 - ctx (calloc), mixLock (CS), mixBuffer (malloc), sources[3]
- * Pattern: goto-cleanup with SAFE_FREE
+ * Resources: 5 - ctx (calloc), mixRing, sourceOutRings[3], dataReady + outputReady (events)
+ * Pattern: goto-cleanup with SpscRing_Free / SAFE_CLOSE_HANDLE
  * Init: calloc ensures NULL initialization
  */
 AudioCaptureContext* AudioCapture_Create(
@@ -674,24 +840,20 @@ AudioCaptureContext* AudioCapture_Create(
     AudioCaptureContext* ctx = (AudioCaptureContext*)calloc(1, sizeof(AudioCaptureContext));
     if (!ctx) return NULL;
     
-    BOOL csInitialized = FALSE;
-    
-    InitializeCriticalSection(&ctx->mixLock);
-    csInitialized = TRUE;
     QueryPerformanceFrequency(&ctx->perfFreq);
     
-    // Allocate mix buffer
-    ctx->mixBufferSize = MIX_BUFFER_SIZE;
-    ctx->mixBuffer = (BYTE*)malloc(ctx->mixBufferSize);
-    if (!ctx->mixBuffer) goto cleanup;
+    // Allocate mix ring
+    if (!SpscRing_Init(&ctx->mixRing, MIX_BUFFER_SIZE)) goto cleanup;
+    
+    ctx->dataReady = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!ctx->dataReady) goto cleanup;
+    ctx->outputReady = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if (!ctx->outputReady) goto cleanup;
     
-    // Allocate per-source output buffers (for multi-track recording)
+    // Allocate per-source output rings (for multi-track recording)
     for (int i = 0; i < MAX_AUDIO_SOURCES; i++) {
-        ctx->sourceOutSize[i] = MIX_BUFFER_SIZE;
-        ctx->sourceOutBuffers[i] = (BYTE*)malloc(ctx->sourceOutSize[i]);
-        if (!ctx->sourceOutBuffers[i]) goto cleanup;
-        InitializeCriticalSection(&ctx->sourceOutLocks[i]);
-        ctx->sourceOutLocksInit[i] = TRUE;
+        if (!SpscRing_Init(&ctx->sourceOutRings[i], MIX_BUFFER_SIZE)) goto cleanup;
+        ctx->sourceSilentFrom[i] = -1;
     }
     
     // Create sources and assign volumes to match source index
@@ -707,6 +869,7 @@ AudioCaptureContext* AudioCapture_Create(
                 int srcIdx = ctx->sourceCount;
                 ctx->volumes[srcIdx] = (volumes[i] < 0) ? 0 : (volumes[i] > 100) ? 100 : volumes[i];
                 ctx->sources[srcIdx] = src;
+                src->mixWake = ctx->dataReady;
                 ctx->sourceCount++;
                 Logger_Log("Audio source %d: device slot %d, volume=%d%%\n", srcIdx, i, ctx->volumes[srcIdx]);
             }
@@ -717,11 +880,11 @@ AudioCaptureContext* AudioCapture_Create(
     
 cleanup:
     for (int i = 0; i < MAX_AUDIO_SOURCES; i++) {
-        SAFE_FREE(ctx->sourceOutBuffers[i]);
-        if (ctx->sourceOutLocksInit[i]) DeleteCriticalSection(&ctx->sourceOutLocks[i]);
+        SpscRing_Free(&ctx->sourceOutRings[i]);
     }
-    SAFE_FREE(ctx->mixBuffer);
-    if (csInitialized) DeleteCriticalSection(&ctx->mixLock);
+    SpscRing_Free(&ctx->mixRing);
+    SAFE_CLOSE_HANDLE(ctx->dataReady);
+    SAFE_CLOSE_HANDLE(ctx->outputReady);
     free(ctx);
     return NULL;
 }
@@ -735,14 +898,14 @@ void AudioCapture_Destroy(AudioCaptureContext* ctx) {
         DestroySource(ctx->sources[i]);
     }
     
-    SAFE_FREE(ctx->mixBuffer);
+    SpscRing_Free(&ctx->mixRing);
+    SAFE_CLOSE_HANDLE(ctx->dataReady);
+    SAFE_CLOSE_HANDLE(ctx->outputReady);
     
     for (int i = 0; i < MAX_AUDIO_SOURCES; i++) {
-        SAFE_FREE(ctx->sourceOutBuffers[i]);
-        if (ctx->sourceOutLocksInit[i]) DeleteCriticalSection(&ctx->sourceOutLocks[i]);
+        SpscRing_Free(&ctx->sourceOutRings[i]);
     }
     
-    DeleteCriticalSection(&ctx->mixLock);
     free(ctx);
 }
 
@@ -756,77 +919,43 @@ void AudioCapture_Destroy(AudioCaptureContext* ctx) {
  * Dormant sources contribute silence rather than blocking the mixer.
  */
 static BOOL IsSourceDormant(AudioCaptureSource* src, LARGE_INTEGER now, double dormantThresholdMs) {
-    if (!src->hasReceivedPacket) return FALSE;
+    if (!InterlockedCompareExchange(&src->hasReceivedPacket, 0, 0)) return FALSE;
     
-    double msSincePacket = (double)(now.QuadPart - src->lastPacketTime.QuadPart) * 1000.0 / src->perfFreq.QuadPart;
+    LONGLONG lastPacket = InterlockedCompareExchange64(&src->lastPacketTime, 0, 0);
+    double msSincePacket = (double)(now.QuadPart - lastPacket) * 1000.0 / src->perfFreq.QuadPart;
     return (msSincePacket > dormantThresholdMs);
 }
 
-/*
- * Read audio data from a source's ring buffer into the provided buffer.
- * Returns the number of bytes read.
- */
-static int ReadFromSourceBuffer(AudioCaptureSource* src, BYTE* destBuffer, int maxBytes) {
-    int toRead = src->bufferAvailable;
-    if (toRead > maxBytes) toRead = maxBytes;
-    
-    if (toRead > 0) {
-        int readPos = (src->bufferWritePos - src->bufferAvailable + src->bufferSize) % src->bufferSize;
-        int toEnd = src->bufferSize - readPos;
-        
-        if (toRead <= toEnd) {
-            memcpy(destBuffer, src->buffer + readPos, toRead);
-        } else {
-            memcpy(destBuffer, src->buffer + readPos, toEnd);
-            memcpy(destBuffer + toEnd, src->buffer, toRead - toEnd);
-        }
-        
-        src->bufferAvailable -= toRead;
-    }
-    
-    return toRead;
-}
-
 /*
  * Mix multiple audio source buffers into a single output buffer.
- * Applies per-source volume, tracks peak levels, and clamps to prevent clipping.
+ * Applies per-source volume, tracks peak levels (of the saturated mix), and
+ * saturates to prevent wraparound. Every source holds numSamples frames
+ * (silence-padded by the caller). Vector kernels in audio_mix.c.
  */
 static void MixAudioSamples(
-    BYTE** srcBuffers, int* srcBytes, int* volumes,
+    BYTE** srcBuffers, const int* volumes,
     int sourceCount, int numSamples,
     BYTE* outBuffer, int* peakLeft, int* peakRight)
 {
-    for (int s = 0; s < numSamples; s++) {
-        int leftSum = 0, rightSum = 0;
-        
-        for (int i = 0; i < sourceCount; i++) {
-            // Check if this source has data for this sample
-            if (srcBytes[i] > s * AUDIO_BLOCK_ALIGN) {
-                short* samples = (short*)(srcBuffers[i] + s * AUDIO_BLOCK_ALIGN);
-                // Apply per-source volume (0-100)
-                int vol = volumes[i];
-                leftSum += (samples[0] * vol) / 100;
-                rightSum += (samples[1] * vol) / 100;
-            }
-            // Sources without data for this sample contribute silence (0) implicitly
-        }
-        
-        // Track peaks
-        int absL = leftSum < 0 ? -leftSum : leftSum;
-        int absR = rightSum < 0 ? -rightSum : rightSum;
-        if (absL > *peakLeft) *peakLeft = absL;
-        if (absR > *peakRight) *peakRight = absR;
-        
-        // Clamp to prevent clipping
-        if (leftSum > 32767) leftSum = 32767;
-        if (leftSum < -32768) leftSum = -32768;
-        if (rightSum > 32767) rightSum = 32767;
-        if (rightSum < -32768) rightSum = -32768;
-        
-        short* outSamples = (short*)(outBuffer + s * AUDIO_BLOCK_ALIGN);
-        outSamples[0] = (short)leftSum;
-        outSamples[1] = (short)rightSum;
+    if (sourceCount <= 0) {
+        memset(outBuffer, 0, (size_t)numSamples * AUDIO_BLOCK_ALIGN);
+        return;
+    }
+    
+    const short* sources[MAX_AUDIO_SOURCES];
+    int gains[MAX_AUDIO_SOURCES];
+    for (int i = 0; i < sourceCount; i++) {
+        sources[i] = (const short*)srcBuffers[i];
+        gains[i] = AudioMix_Gain(volumes[i]);
     }
+    
+    int peak[2];
+    peak[0] = *peakLeft;
+    peak[1] = *peakRight;
+    AudioMix_Mix(sources, gains, sourceCount, (short*)outBuffer,
+                 numSamples * AUDIO_CHANNELS, peak);
+    *peakLeft = peak[0];
+    *peakRight = peak[1];
 }
 
 /*
@@ -834,72 +963,38 @@ static void MixAudioSamples(
  * Drops oldest data if buffer is full.
  */
 static void WriteMixedToBuffer(AudioCaptureContext* ctx, BYTE* mixChunk, int bytesToMix) {
-    EnterCriticalSection(&ctx->mixLock);
-    
-    int spaceAvailable = ctx->mixBufferSize - ctx->mixBufferAvailable;
-    if (bytesToMix > spaceAvailable) {
-        // Drop oldest
-        int toDrop = bytesToMix - spaceAvailable;
-        ctx->mixBufferAvailable -= toDrop;
-        ctx->mixBufferReadPos = (ctx->mixBufferReadPos + toDrop) % ctx->mixBufferSize;
-    }
-    
-    int writePos = ctx->mixBufferWritePos;
-    int toEnd = ctx->mixBufferSize - writePos;
-    
-    if (bytesToMix <= toEnd) {
-        memcpy(ctx->mixBuffer + writePos, mixChunk, bytesToMix);
-    } else {
-        memcpy(ctx->mixBuffer + writePos, mixChunk, toEnd);
-        memcpy(ctx->mixBuffer, mixChunk + toEnd, bytesToMix - toEnd);
-    }
-    
-    ctx->mixBufferWritePos = (writePos + bytesToMix) % ctx->mixBufferSize;
-    ctx->mixBufferAvailable += bytesToMix;
-    
-    LeaveCriticalSection(&ctx->mixLock);
+    // Full ring (reader stalled) drops the new chunk
+    SpscRing_Write(&ctx->mixRing, mixChunk, bytesToMix);
 }
 
 /*
  * Apply per-source volume to a chunk and write it to the source's per-track
  * ring buffer. volBuf is a scratch buffer (size >= processBytes) supplied by
  * the caller to avoid per-iteration allocation.
+ *
+ * The volume pass's peak flags silent chunks for AudioCapture_ReadSource:
+ * sound clears sourceSilentFrom before its bytes are written, a silent
+ * chunk sets it (if clear) only after, so the reader never sees a flag
+ * covering bytes with sound.
  */
 static void WriteMixedToSourceBuffer(
     AudioCaptureContext* ctx, int sourceIndex,
     const BYTE* srcChunk, int processBytes, int vol,
     BYTE* volBuf)
 {
-    int nSamp = processBytes / AUDIO_BLOCK_ALIGN;
-    for (int s = 0; s < nSamp; s++) {
-        const short* in = (const short*)(srcChunk + s * AUDIO_BLOCK_ALIGN);
-        short* out = (short*)(volBuf + s * AUDIO_BLOCK_ALIGN);
-        int l = (in[0] * vol) / 100;
-        int r = (in[1] * vol) / 100;
-        if (l > 32767) l = 32767; if (l < -32768) l = -32768;
-        if (r > 32767) r = 32767; if (r < -32768) r = -32768;
-        out[0] = (short)l;
-        out[1] = (short)r;
-    }
+    const short* in = (const short*)srcChunk;
+    int gain = AudioMix_Gain(vol);
+    int peak[2] = { 0, 0 };
+    AudioMix_Mix(&in, &gain, 1, (short*)volBuf,
+                 (processBytes / AUDIO_BLOCK_ALIGN) * AUDIO_CHANNELS, peak);
 
-    EnterCriticalSection(&ctx->sourceOutLocks[sourceIndex]);
-    int space = ctx->sourceOutSize[sourceIndex] - ctx->sourceOutAvailable[sourceIndex];
-    if (processBytes > space) {
-        int drop = processBytes - space;
-        ctx->sourceOutAvailable[sourceIndex] -= drop;
-        ctx->sourceOutReadPos[sourceIndex] = (ctx->sourceOutReadPos[sourceIndex] + drop) % ctx->sourceOutSize[sourceIndex];
-    }
-    int wp = ctx->sourceOutWritePos[sourceIndex];
-    int toEnd = ctx->sourceOutSize[sourceIndex] - wp;
-    if (processBytes <= toEnd) {
-        memcpy(ctx->sourceOutBuffers[sourceIndex] + wp, volBuf, processBytes);
-    } else {
-        memcpy(ctx->sourceOutBuffers[sourceIndex] + wp, volBuf, toEnd);
-        memcpy(ctx->sourceOutBuffers[sourceIndex], volBuf + toEnd, processBytes - toEnd);
-    }
-    ctx->sourceOutWritePos[sourceIndex] = (wp + processBytes) % ctx->sourceOutSize[sourceIndex];
-    ctx->sourceOutAvailable[sourceIndex] += processBytes;
-    LeaveCriticalSection(&ctx->sourceOutLocks[sourceIndex]);
+    BOOL silent = max(peak[0], peak[1]) <= AUDIO_SILENCE_PEAK;
+    LONG64 runStart = ctx->sourceWritten[sourceIndex];
+    if (!silent) InterlockedExchange64(&ctx->sourceSilentFrom[sourceIndex], -1);
+
+    ctx->sourceWritten[sourceIndex] += SpscRing_Write(&ctx->sourceOutRings[sourceIndex], volBuf, processBytes);
+
+    if (silent) InterlockedCompareExchange64(&ctx->sourceSilentFrom[sourceIndex], runStart, -1);
 }
 
 // Mix capture thread - reads from all sources and mixes
@@ -918,7 +1013,6 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
     
     // Temp buffers for reading from sources
     BYTE* srcBuffers[MAX_AUDIO_SOURCES] = {0};
-    int srcBytes[MAX_AUDIO_SOURCES] = {0};
     BOOL srcDormant[MAX_AUDIO_SOURCES] = {0};  // TRUE if source is event-driven and currently silent
     
     for (int i = 0; i < ctx->sourceCount; i++) {
@@ -951,6 +1045,8 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
         return 0;
     }
     
+    HANDLE mmTask = BeginProAudioThread("MixCaptureThread");
+    
     const int chunkSize = AUDIO_MIX_CHUNK_SIZE;  // Process in chunks
     const double dormantThresholdMs = DORMANT_THRESHOLD_MS;  // Consider source dormant after no packets
     
@@ -1032,8 +1128,7 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
             if (!src || !InterlockedCompareExchange(&src->active, 0, 0)) continue;
             
             activeSources++;
-            EnterCriticalSection(&src->lock);
-            availableBytes[i] = src->bufferAvailable;
+            availableBytes[i] = SpscRing_Available(&src->ring);
             
             // Check if source is dormant (uses helper function)
             srcDormant[i] = FALSE;
@@ -1041,8 +1136,6 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
                 srcDormant[i] = IsSourceDormant(src, now, dormantThresholdMs);
             }
             
-            LeaveCriticalSection(&src->lock);
-            
             if (!srcDormant[i]) {
                 nonDormantSources++;
                 if (availableBytes[i] > maxBytes) {
@@ -1055,7 +1148,8 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
         // After that, we pace silence-padded output to wall-clock unconditionally.
         if (!rateStarted) {
             if (nonDormantSources == 0 || maxBytes == 0) {
-                Sleep(2);  // Wait for first PCM
+                // Wait for first PCM (source threads signal each write)
+                WaitForSingleObject(ctx->dataReady, AUDIO_MIX_IDLE_WAIT_MS);
                 continue;
             }
             rateStartTime = now;
@@ -1068,9 +1162,12 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
         LONGLONG expectedBytes = (LONGLONG)(elapsedSec * AUDIO_BYTES_PER_SEC);
         LONGLONG bytesAllowed = expectedBytes - totalBytesOutput;
 
-        // If we're ahead of schedule (or not yet owed half a chunk), wait
+        // If we're ahead of schedule (or not yet owed half a chunk), sleep
+        // until half a chunk is owed instead of re-checking every 2 ms
         if (bytesAllowed < chunkSize / 2) {
-            Sleep(2);
+            LONGLONG owed = chunkSize / 2 - bytesAllowed;
+            DWORD waitMs = (DWORD)((owed * 1000 + AUDIO_BYTES_PER_SEC - 1) / AUDIO_BYTES_PER_SEC);
+            Sleep(waitMs ? waitMs : 1);
             continue;
         }
 
@@ -1094,15 +1191,12 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
             AudioCaptureSource* src = ctx->sources[i];
             int readBytes = 0;
             if (src && InterlockedCompareExchange(&src->active, 0, 0) && !srcDormant[i]) {
-                EnterCriticalSection(&src->lock);
-                readBytes = ReadFromSourceBuffer(src, srcBuffers[i], processBytes);
-                LeaveCriticalSection(&src->lock);
+                readBytes = SpscRing_Read(&src->ring, srcBuffers[i], processBytes);
             }
             srcReadBytes[i] = readBytes;
             if (readBytes < processBytes) {
                 memset(srcBuffers[i] + readBytes, 0, processBytes - readBytes);
             }
-            srcBytes[i] = processBytes;
 
             /* Write per-source data to per-track ring (uses hoisted volBuf). */
             WriteMixedToSourceBuffer(ctx, i, srcBuffers[i], processBytes, ctx->volumes[i], volBuf);
@@ -1114,10 +1208,9 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
 
         // Mix sources using helper function
         if (bytesToMix > 0) {
-            memset(mixChunk, 0, bytesToMix);
             int numSamples = bytesToMix / AUDIO_BLOCK_ALIGN;
             
-            MixAudioSamples(srcBuffers, srcBytes, ctx->volumes, 
+            MixAudioSamples(srcBuffers, ctx->volumes, 
                            ctx->sourceCount, numSamples, 
                            mixChunk, &peakLeft, &peakRight);
             
@@ -1132,11 +1225,14 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
                 // bytes[] reports REAL PCM read from each source this chunk (pre-silence-pad)
                 // so under-delivery still shows up as low numbers; rate is mix output rate
                 // which is now locked to AUDIO_BYTES_PER_SEC by silence padding.
-                Logger_Log("Audio: L=%.1f%% R=%.1f%% bytes=[%d,%d,%d] dormant=[%d,%d,%d] rate=%.0f/s (target=%d)\n", 
+                Logger_Log("Audio: L=%.1f%% R=%.1f%% bytes=[%d,%d,%d] dormant=[%d,%d,%d] rate=%.0f/s (target=%d) "
+                           "drift=[%.1f,%.1f,%.1f]ppm\n", 
                            peakPctL, peakPctR,
                            srcReadBytes[0], srcReadBytes[1], srcReadBytes[2],
                            srcDormant[0], srcDormant[1], srcDormant[2],
-                           actualRate, AUDIO_BYTES_PER_SEC);
+                           actualRate, AUDIO_BYTES_PER_SEC,
+                           AudioCapture_GetSourceDriftPpm(ctx, 0), AudioCapture_GetSourceDriftPpm(ctx, 1),
+                           AudioCapture_GetSourceDriftPpm(ctx, 2));
                 peakLeft = 0;
                 peakRight = 0;
             }
@@ -1146,6 +1242,8 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
             
             // Track total output for rate limiting
             totalBytesOutput += bytesToMix;
+            
+            SetEvent(ctx->outputReady);
         }
     }
     
@@ -1154,6 +1252,7 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
     }
     free(volBuf);
     free(mixChunk);
+    EndProAudioThread(mmTask);
     if (coOwned) CoUninitialize();
     
     return 0;
@@ -1179,7 +1278,9 @@ BOOL AudioCapture_StartAt(AudioCaptureContext* ctx, LARGE_INTEGER t0) {
         AudioCaptureSource* src = ctx->sources[i];
         if (!src) continue;
         
-        if (!InitSourceCapture(src)) {
+        src->useEvents = ctx->eventDriven;
+        src->driftCorrection = ctx->driftCorrection;
+        if (!src->toneHz && !InitSourceCapture(src)) {
             Logger_Log("AudioCapture_Start: InitSourceCapture failed for source %d\n", i);
             continue;
         }
@@ -1188,25 +1289,32 @@ BOOL AudioCapture_StartAt(AudioCaptureContext* ctx, LARGE_INTEGER t0) {
         
         // Initialize timing for event-driven source detection
         QueryPerformanceFrequency(&src->perfFreq);
-        QueryPerformanceCounter(&src->lastPacketTime);
-        src->hasReceivedPacket = FALSE;
+        LARGE_INTEGER startTime;
+        QueryPerformanceCounter(&startTime);
+        InterlockedExchange64(&src->lastPacketTime, startTime.QuadPart);
+        InterlockedExchange(&src->hasReceivedPacket, FALSE);
         
-        // Start audio client
-        HRESULT hr = src->audioClient->lpVtbl->Start(src->audioClient);
-        if (FAILED(hr)) {
-            Logger_Log("AudioCapture: IAudioClient::Start failed (0x%08X) for device %s\n", hr, src->deviceId);
-            InterlockedExchange(&src->active, FALSE);
-            continue;
+        // Start audio client (tone sources have none)
+        if (src->audioClient) {
+            HRESULT hr = src->audioClient->lpVtbl->Start(src->audioClient);
+            if (FAILED(hr)) {
+                Logger_Log("AudioCapture: IAudioClient::Start failed (0x%08X) for device %s\n", hr, src->deviceId);
+                InterlockedExchange(&src->active, FALSE);
+                continue;
+            }
         }
         
         // Start capture thread for this source
-        src->captureThread = CreateThread(NULL, 0, SourceCaptureThread, src, 0, NULL);
+        src->captureThread = CreateThread(NULL, 0, src->toneHz ? ToneSourceThread : SourceCaptureThread,
+                                          src, 0, NULL);
         if (!src->captureThread) {
             Logger_Log("AudioCapture: CreateThread failed for source %s\n", src->deviceId);
-            HRESULT stopHr = src->audioClient->lpVtbl->Stop(src->audioClient);
-            if (FAILED(stopHr)) {
-                Logger_Log("AudioCapture: IAudioClient::Stop failed (0x%08X) after CreateThread failure for '%s'\n",
-                    stopHr, src->deviceId);
+            if (src->audioClient) {
+                HRESULT stopHr = src->audioClient->lpVtbl->Stop(src->audioClient);
+                if (FAILED(stopHr)) {
+                    Logger_Log("AudioCapture: IAudioClient::Stop failed (0x%08X) after CreateThread failure for '%s'\n",
+                        stopHr, src->deviceId);
+                }
             }
             InterlockedExchange(&src->active, FALSE);
         }
@@ -1265,6 +1373,7 @@ void AudioCapture_Stop(AudioCaptureContext* ctx) {
         
         // Thread-safe: use atomic write
         InterlockedExchange(&src->active, FALSE);
+        if (src->sampleEvent) SetEvent(src->sampleEvent);  // Don't wait out the timeout
         
         if (src->audioClient) {
             HRESULT stopHr = src->audioClient->lpVtbl->Stop(src->audioClient);
@@ -1292,6 +1401,7 @@ void AudioCapture_Stop(AudioCaptureContext* ctx) {
     }
     
     // Wait for mix thread
+    SetEvent(ctx->dataReady);
     HANDLE mh = (HANDLE)InterlockedExchangePointer((PVOID*)&ctx->captureThread, NULL);
     if (mh) {
         DWORD waitResult = WaitForSingleObject(mh, 3000);
@@ -1311,27 +1421,8 @@ int AudioCapture_Read(AudioCaptureContext* ctx, BYTE* buffer, int maxBytes, LONG
     
     if (!ctx || !buffer) return 0;
     
-    EnterCriticalSection(&ctx->mixLock);
-    
-    int available = ctx->mixBufferAvailable;
-    if (available > maxBytes) available = maxBytes;
-    
-    if (available > 0) {
-        int readPos = ctx->mixBufferReadPos;
-        int toEnd = ctx->mixBufferSize - readPos;
-        
-        if (available <= toEnd) {
-            memcpy(buffer, ctx->mixBuffer + readPos, available);
-        } else {
-            memcpy(buffer, ctx->mixBuffer + readPos, toEnd);
-            memcpy(buffer + toEnd, ctx->mixBuffer, available - toEnd);
-        }
-        
-        ctx->mixBufferReadPos = (readPos + available) % ctx->mixBufferSize;
-        ctx->mixBufferAvailable -= available;
-    }
-    
-    LeaveCriticalSection(&ctx->mixLock);
+    // Single consumer: the buffer thread that owns this context
+    int available = SpscRing_Read(&ctx->mixRing, buffer, maxBytes);
     
     // Calculate timestamp
     if (timestamp) {
@@ -1355,31 +1446,22 @@ static LONGLONG AudioCapture_GetTimestamp(AudioCaptureContext* ctx) {
     return (elapsed * 10000000) / ctx->perfFreq.QuadPart;
 }
 
-int AudioCapture_ReadSource(AudioCaptureContext* ctx, int sourceIndex, BYTE* buffer, int maxBytes, LONGLONG* timestamp) {
+int AudioCapture_ReadSource(AudioCaptureContext* ctx, int sourceIndex, BYTE* buffer, int maxBytes,
+                            LONGLONG* timestamp, BOOL* silent) {
+    if (silent) *silent = FALSE;
     if (!ctx || !buffer || sourceIndex < 0 || sourceIndex >= ctx->sourceCount) return 0;
     
-    EnterCriticalSection(&ctx->sourceOutLocks[sourceIndex]);
+    LONG64 readFrom = ctx->sourceRead[sourceIndex];
+    int available = SpscRing_Read(&ctx->sourceOutRings[sourceIndex], buffer, maxBytes);
+    ctx->sourceRead[sourceIndex] += available;
     
-    int available = ctx->sourceOutAvailable[sourceIndex];
-    if (available > maxBytes) available = maxBytes;
-    
-    if (available > 0) {
-        int readPos = ctx->sourceOutReadPos[sourceIndex];
-        int toEnd = ctx->sourceOutSize[sourceIndex] - readPos;
-        
-        if (available <= toEnd) {
-            memcpy(buffer, ctx->sourceOutBuffers[sourceIndex] + readPos, available);
-        } else {
-            memcpy(buffer, ctx->sourceOutBuffers[sourceIndex] + readPos, toEnd);
-            memcpy(buffer + toEnd, ctx->sourceOutBuffers[sourceIndex], available - toEnd);
-        }
-        
-        ctx->sourceOutReadPos[sourceIndex] = (readPos + available) % ctx->sourceOutSize[sourceIndex];
-        ctx->sourceOutAvailable[sourceIndex] -= available;
+    // Loaded after the read: a run begun at or before readFrom and still
+    // unbroken covers every byte just read
+    if (silent && available > 0) {
+        LONG64 silentFrom = InterlockedCompareExchange64(&ctx->sourceSilentFrom[sourceIndex], -1, -1);
+        *silent = silentFrom >= 0 && silentFrom <= readFrom;
     }
     
-    LeaveCriticalSection(&ctx->sourceOutLocks[sourceIndex]);
-    
     if (timestamp) {
         *timestamp = AudioCapture_GetTimestamp(ctx);
     }
@@ -1392,3 +1474,10 @@ int AudioCapture_GetSourceCount(AudioCaptureContext* ctx) {
     return ctx->sourceCount;
 }
 
+double AudioCapture_GetSourceDriftPpm(AudioCaptureContext* ctx, int sourceIndex) {
+    if (!ctx || sourceIndex < 0 || sourceIndex >= ctx->sourceCount) return 0.0;
+    AudioCaptureSource* src = ctx->sources[sourceIndex];
+    if (!src) return 0.0;
+    return InterlockedCompareExchange(&src->driftPpmCenti, 0, 0) / 100.0;
+}
+
@@ -6,6 +6,7 @@
 #define AUDIO_CAPTURE_H
 
 #include <windows.h>
+#include "spsc_ring.h"
 
 // Audio format (fixed for simplicity - all sources resampled to this)
 #define AUDIO_SAMPLE_RATE       48000
@@ -17,6 +18,10 @@
 // Maximum capture sources
 #define MAX_AUDIO_SOURCES 3
 
+// Device id prefix of a synthetic source: "tone:440" is a 440 Hz sine at
+// -12 dBFS delivered in real time, with no device behind it (benchmarks)
+#define AUDIO_TONE_SOURCE_PREFIX "tone:"
+
 // Forward declaration
 typedef struct AudioCaptureSource AudioCaptureSource;
 
@@ -25,30 +30,41 @@ typedef struct {
     AudioCaptureSource* sources[MAX_AUDIO_SOURCES];
     int sourceCount;
     
-    // Per-source volume (0-100)
+    // Per-source volume in percent (0-AUDIO_VOLUME_MAX)
     int volumes[MAX_AUDIO_SOURCES];
     
-    // Mixed audio buffer (ring buffer)
-    BYTE* mixBuffer;
-    int mixBufferSize;
-    int mixBufferWritePos;
-    int mixBufferReadPos;
-    int mixBufferAvailable;
-    CRITICAL_SECTION mixLock;
+    // Mixed audio (mix thread -> AudioCapture_Read)
+    SpscRing mixRing;
+    
+    // Per-source output (mix thread -> AudioCapture_ReadSource, multi-track recording)
+    SpscRing sourceOutRings[MAX_AUDIO_SOURCES];
     
-    // Per-source output buffers (for multi-track recording)
-    BYTE* sourceOutBuffers[MAX_AUDIO_SOURCES];
-    int sourceOutSize[MAX_AUDIO_SOURCES];
-    int sourceOutWritePos[MAX_AUDIO_SOURCES];
-    int sourceOutReadPos[MAX_AUDIO_SOURCES];
-    int sourceOutAvailable[MAX_AUDIO_SOURCES];
-    CRITICAL_SECTION sourceOutLocks[MAX_AUDIO_SOURCES];
-    BOOL sourceOutLocksInit[MAX_AUDIO_SOURCES];
+    // Silence flags for sourceOutRings, in stream bytes: the mix thread sets
+    // sourceSilentFrom to where the current silent run began (-1 while a
+    // source has sound); each side counts the bytes it moved through the ring
+    volatile LONG64 sourceSilentFrom[MAX_AUDIO_SOURCES];
+    LONG64 sourceWritten[MAX_AUDIO_SOURCES];    // Mix thread only
+    LONG64 sourceRead[MAX_AUDIO_SOURCES];       // ReadSource caller only
     
     // Capture thread
     HANDLE captureThread;
     volatile LONG running;  // Thread-safe: use InterlockedExchange
     
+    // Auto-reset event: a source thread wrote PCM (wakes the mix thread)
+    HANDLE dataReady;
+    
+    // Auto-reset event: the mix thread wrote to mixRing / sourceOutRings
+    // (wakes the reader of AudioCapture_Read)
+    HANDLE outputReady;
+    
+    // WASAPI event callback instead of polling. Set before the first Start;
+    // sources that refuse it fall back to polling.
+    BOOL eventDriven;
+    
+    // Steer each source's resampler to its measured clock drift against QPC.
+    // Set before Start; drift is measured either way.
+    BOOL driftCorrection;
+    
     // Timing
     LARGE_INTEGER startTime;
     LARGE_INTEGER perfFreq;
@@ -85,14 +101,23 @@ void AudioCapture_Stop(AudioCaptureContext* ctx);
 
 // Read mixed audio data (returns bytes read)
 // Timestamp is in 100ns units (same as video)
+// Read and ReadSource must come from one thread: the rings are SPSC.
 int AudioCapture_Read(AudioCaptureContext* ctx, BYTE* buffer, int maxBytes, LONGLONG* timestamp);
 
 // Read per-source audio data (for multi-track recording)
 // sourceIndex: 0-based index into active sources
 // Returns bytes read (stereo 16-bit PCM at AUDIO_SAMPLE_RATE)
-int AudioCapture_ReadSource(AudioCaptureContext* ctx, int sourceIndex, BYTE* buffer, int maxBytes, LONGLONG* timestamp);
+// silent (optional): TRUE if every byte read is silence (peak at most
+// AUDIO_SILENCE_PEAK); FALSE may still be silence the mix thread had not
+// flagged yet.
+int AudioCapture_ReadSource(AudioCaptureContext* ctx, int sourceIndex, BYTE* buffer, int maxBytes,
+                            LONGLONG* timestamp, BOOL* silent);
 
 // Get the number of active sources
 int AudioCapture_GetSourceCount(AudioCaptureContext* ctx);
 
+// Measured clock drift of a source against QPC in ppm (positive = the
+// device runs fast); 0 until the first estimate. Any thread.
+double AudioCapture_GetSourceDriftPpm(AudioCaptureContext* ctx, int sourceIndex);
+
 #endif // AUDIO_CAPTURE_H
@@ -0,0 +1,218 @@
+/*
+ * audio_mix.c - Fixed-point mix and gain kernels for 16-bit PCM
+ *
+ * Every kernel computes, for each output sample,
+ *     clamp16((AUDIO_GAIN_ROUND + sum of x * gain) >> AUDIO_GAIN_FRAC_BITS)
+ * in 32-bit integers. The vector kernels build the same 32-bit products
+ * from pmullw/pmulhw pairs interleaved back into dwords, add them in dword
+ * lanes and saturate once when packing to words (packssdw), so they match
+ * the scalar kernel bit for bit. The scalar kernel also finishes their
+ * tails. Fewer than one vector of samples never leaves the scalar path.
+ *
+ * Headroom: |x * gain| <= 2^15 * 2^14 = 2^29 at AUDIO_VOLUME_MAX, so
+ * MAX_AUDIO_SOURCES products and the rounding term fit in an int32.
+ *
+ * ERROR HANDLING PATTERN:
+ * - No failure path: pure computation on caller buffers
+ */
+
+#include "audio_mix.h"
+#include "audio_capture.h"
+#include "logger.h"
+#include "constants.h"
+#include "util.h"
+#include <immintrin.h>
+
+// Alias for logging
+#define MixLog Logger_Log
+
+typedef int (*MixKernelFn)(const short* const* sources, const int* gains, int sourceCount,
+                           short* out, int count, int* peak);
+
+// -1 until the first AudioMix_GetKernel resolves it
+static volatile LONG g_kernel = -1;
+
+/* ============================================================================
+ * SCALAR
+ * ============================================================================
+ */
+
+static void MixRange(const short* const* sources, const int* gains, int sourceCount,
+                     short* out, int first, int end, int* peak) {
+    for (int i = first; i < end; i++) {
+        int acc = AUDIO_GAIN_ROUND;
+        for (int k = 0; k < sourceCount; k++) {
+            acc += sources[k][i] * gains[k];
+        }
+        acc >>= AUDIO_GAIN_FRAC_BITS;
+        if (acc > 32767) acc = 32767;
+        if (acc < -32768) acc = -32768;
+        out[i] = (short)acc;
+        if (peak) {
+            int mag = acc < 0 ? -acc : acc;
+            if (mag > peak[i & 1]) peak[i & 1] = mag;
+        }
+    }
+}
+
+static int MixScalar(const short* const* sources, const int* gains, int sourceCount,
+                     short* out, int count, int* peak) {
+    MixRange(sources, gains, sourceCount, out, 0, count, peak);
+    return count;
+}
+
+/* Lane-wise running max/min of the output words -> per-channel magnitude.
+   Even lanes are left samples: every vector starts on an even index. */
+static void FoldPeak(const short* hi, const short* lo, int lanes, int* peak) {
+    for (int j = 0; j < lanes; j++) {
+        int mag = hi[j] > -lo[j] ? hi[j] : -lo[j];
+        if (mag > peak[j & 1]) peak[j & 1] = mag;
+    }
+}
+
+/* ============================================================================
+ * SSE2 (8 samples per step)
+ * ============================================================================
+ */
+
+static int MixSse2(const short* const* sources, const int* gains, int sourceCount,
+                   short* out, int count, int* peak) {
+    int n = count & ~7;
+    __m128i g[MAX_AUDIO_SOURCES];
+    for (int k = 0; k < sourceCount; k++) g[k] = _mm_set1_epi16((short)gains[k]);
+    const __m128i round = _mm_set1_epi32(AUDIO_GAIN_ROUND);
+    __m128i vmax = _mm_setzero_si128();
+    __m128i vmin = _mm_setzero_si128();
+
+    for (int i = 0; i < n; i += 8) {
+        __m128i acc0 = round;
+        __m128i acc1 = round;
+        for (int k = 0; k < sourceCount; k++) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(sources[k] + i));
+            __m128i lo = _mm_mullo_epi16(x, g[k]);
+            __m128i hi = _mm_mulhi_epi16(x, g[k]);
+            acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(lo, hi));
+            acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(lo, hi));
+        }
+        __m128i y = _mm_packs_epi32(_mm_srai_epi32(acc0, AUDIO_GAIN_FRAC_BITS),
+                                    _mm_srai_epi32(acc1, AUDIO_GAIN_FRAC_BITS));
+        _mm_storeu_si128((__m128i*)(out + i), y);
+        vmax = _mm_max_epi16(vmax, y);
+        vmin = _mm_min_epi16(vmin, y);
+    }
+
+    if (peak && n > 0) {
+        short hi[8], lo[8];
+        _mm_storeu_si128((__m128i*)hi, vmax);
+        _mm_storeu_si128((__m128i*)lo, vmin);
+        FoldPeak(hi, lo, 8, peak);
+    }
+    return n;
+}
+
+/* ============================================================================
+ * AVX2 (16 samples per step)
+ * ============================================================================
+ * unpack and pack work within 128-bit lanes, so unpacklo/unpackhi followed
+ * by packs lands every sample back at its own index without a permute.
+ */
+
+static int MixAvx2(const short* const* sources, const int* gains, int sourceCount,
+                   short* out, int count, int* peak) {
+    int n = count & ~15;
+    __m256i g[MAX_AUDIO_SOURCES];
+    for (int k = 0; k < sourceCount; k++) g[k] = _mm256_set1_epi16((short)gains[k]);
+    const __m256i round = _mm256_set1_epi32(AUDIO_GAIN_ROUND);
+    __m256i vmax = _mm256_setzero_si256();
+    __m256i vmin = _mm256_setzero_si256();
+
+    for (int i = 0; i < n; i += 16) {
+        __m256i acc0 = round;
+        __m256i acc1 = round;
+        for (int k = 0; k < sourceCount; k++) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(sources[k] + i));
+            __m256i lo = _mm256_mullo_epi16(x, g[k]);
+            __m256i hi = _mm256_mulhi_epi16(x, g[k]);
+            acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(lo, hi));
+            acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(lo, hi));
+        }
+        __m256i y = _mm256_packs_epi32(_mm256_srai_epi32(acc0, AUDIO_GAIN_FRAC_BITS),
+                                       _mm256_srai_epi32(acc1, AUDIO_GAIN_FRAC_BITS));
+        _mm256_storeu_si256((__m256i*)(out + i), y);
+        vmax = _mm256_max_epi16(vmax, y);
+        vmin = _mm256_min_epi16(vmin, y);
+    }
+
+    if (peak && n > 0) {
+        short hi[16], lo[16];
+        _mm256_storeu_si256((__m256i*)hi, vmax);
+        _mm256_storeu_si256((__m256i*)lo, vmin);
+        FoldPeak(hi, lo, 16, peak);
+    }
+    _mm256_zeroupper();
+    return n;
+}
+
+/* ============================================================================
+ * DISPATCH
+ * ============================================================================
+ */
+
+static AudioMixKernel BestKernel(void) {
+    return Util_CpuHasAvx2() ? AUDIO_MIX_AVX2 : AUDIO_MIX_SSE2;   // SSE2 is baseline on x64
+}
+
+AudioMixKernel AudioMix_GetKernel(void) {
+    LONG kernel = g_kernel;
+    if (kernel < 0) {
+        kernel = (LONG)BestKernel();
+        if (InterlockedCompareExchange(&g_kernel, kernel, -1) == -1) {
+            MixLog("AudioMix: %s kernel\n", AudioMix_KernelName((AudioMixKernel)kernel));
+        }
+        kernel = g_kernel;
+    }
+    return (AudioMixKernel)kernel;
+}
+
+AudioMixKernel AudioMix_SetKernel(AudioMixKernel kernel) {
+    if (kernel == AUDIO_MIX_AVX2 && !Util_CpuHasAvx2()) kernel = BestKernel();
+    if (kernel < AUDIO_MIX_SCALAR || kernel > AUDIO_MIX_AVX2) kernel = BestKernel();
+    InterlockedExchange(&g_kernel, (LONG)kernel);
+    return kernel;
+}
+
+const char* AudioMix_KernelName(AudioMixKernel kernel) {
+    switch (kernel) {
+        case AUDIO_MIX_SCALAR: return "scalar";
+        case AUDIO_MIX_SSE2:   return "SSE2";
+        case AUDIO_MIX_AVX2:   return "AVX2";
+        default:               return "unknown";
+    }
+}
+
+int AudioMix_Gain(int volumePercent) {
+    if (volumePercent < 0) volumePercent = 0;
+    if (volumePercent > AUDIO_VOLUME_MAX) volumePercent = AUDIO_VOLUME_MAX;
+    return (volumePercent * (1 << AUDIO_GAIN_FRAC_BITS) + 50) / 100;
+}
+
+void AudioMix_Mix(const short* const* sources, const int* gains, int sourceCount,
+                  short* out, int count, int* peak) {
+    // Preconditions
+    LWSR_ASSERT(sources != NULL);
+    LWSR_ASSERT(gains != NULL);
+    LWSR_ASSERT(out != NULL);
+    LWSR_ASSERT(sourceCount >= 1 && sourceCount <= MAX_AUDIO_SOURCES);
+
+    if (!sources || !gains || !out || count <= 0) return;
+    if (sourceCount < 1 || sourceCount > MAX_AUDIO_SOURCES) return;
+
+    MixKernelFn kernel;
+    switch (AudioMix_GetKernel()) {
+        case AUDIO_MIX_AVX2: kernel = MixAvx2;   break;
+        case AUDIO_MIX_SSE2: kernel = MixSse2;   break;
+        default:             kernel = MixScalar; break;
+    }
+    int done = kernel(sources, gains, sourceCount, out, count, peak);
+    MixRange(sources, gains, sourceCount, out, done, count, peak);
+}
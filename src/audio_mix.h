@@ -0,0 +1,45 @@
+/*
+ * audio_mix.h - Fixed-point mix and gain kernels for 16-bit PCM
+ *
+ * USED BY: audio_capture.c (mix thread: mixed track and per-source tracks)
+ *
+ * Volumes become Q12 gains (AUDIO_GAIN_FRAC_BITS), so the whole 0-400%
+ * range (AUDIO_VOLUME_MAX) is one multiply per sample per source, with no
+ * divide and no branch. Scalar, SSE2 and AVX2 kernels give bit-identical
+ * output; the best one the CPU supports is picked on first use.
+ *
+ * Stateless apart from the kernel choice: safe on any thread.
+ */
+
+#ifndef AUDIO_MIX_H
+#define AUDIO_MIX_H
+
+#include <windows.h>
+
+typedef enum {
+    AUDIO_MIX_SCALAR = 0,
+    AUDIO_MIX_SSE2,
+    AUDIO_MIX_AVX2
+} AudioMixKernel;
+
+// Q12 gain for a volume in percent (clamped to 0..AUDIO_VOLUME_MAX)
+int AudioMix_Gain(int volumePercent);
+
+// out[i] = saturate16(round(sum over k of sources[k][i] * gains[k] / 4096))
+// for count interleaved stereo samples (frames * 2). sourceCount is
+// 1..MAX_AUDIO_SOURCES; out may be one of the sources. If peak is non-NULL,
+// peak[0] / peak[1] are raised to the largest |out| on the left (even) /
+// right (odd) samples.
+void AudioMix_Mix(const short* const* sources, const int* gains, int sourceCount,
+                  short* out, int count, int* peak);
+
+// Kernel AudioMix_Mix uses
+AudioMixKernel AudioMix_GetKernel(void);
+
+// Force a kernel (benchmarks, output checks). One the CPU lacks is replaced
+// by the best it has; returns the kernel now in use.
+AudioMixKernel AudioMix_SetKernel(AudioMixKernel kernel);
+
+const char* AudioMix_KernelName(AudioMixKernel kernel);
+
+#endif // AUDIO_MIX_H
@@ -0,0 +1,401 @@
+/*
+ * audio_resample.c - Source format conversion and polyphase resampling
+ *
+ * The rate ratio is reduced to dstRate/srcRate = L/M (44.1k -> 48k is
+ * 160/147). Output frame j sits at input position j * M / L; its phase
+ * (j * M) mod L picks one of L precomputed AUDIO_RESAMPLE_TAPS-tap
+ * kernels, so the filter is exact for every common rate with no per-sample
+ * trig or division. Kernels are Kaiser-windowed sincs cut off at
+ * AUDIO_RESAMPLE_CUTOFF of the lower Nyquist rate, each normalized to unit
+ * DC gain.
+ *
+ * Streaming: planar history holds the input frames the next output still
+ * needs (fewer than TAPS). A new stream starts with TAPS/2 - 1 zeros so
+ * output frame 0 lands on input frame 0; bypass keeps the same lead, so it
+ * can switch to filtering without a jump. Input is taken in
+ * AUDIO_RESAMPLE_BLOCK frame steps so the scratch buffers stay fixed-size.
+ *
+ * Drift adjustment (AudioResampler_SetRatio): a ratio off 1 by a few ppm
+ * has no small L/M, so the resampler switches to a 32.32 fixed-point step
+ * and a bank of 2^AUDIO_RESAMPLE_DRIFT_PHASE_BITS (+1) kernels, and
+ * interpolates linearly between the two kernels around each position.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Create returns NULL on allocation failure (goto-cleanup)
+ * - Process has no failure path: bad input is treated as silence
+ */
+
+#include "audio_resample.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include <emmintrin.h>
+#include <math.h>
+
+// Alias for logging
+#define ResampleLog Logger_Log
+
+#define RESAMPLE_PI 3.14159265358979323846
+
+struct AudioResampler {
+    int srcRate;
+    int dstRate;
+    BOOL bypass;        // Equal rates: convert only
+    int phases;         // L
+    int step;           // M
+    int phase;          // Phase of the next output, 0..L-1
+    int pos;            // First history frame of the next output's window
+    float* coeffs;      // phases * AUDIO_RESAMPLE_TAPS
+    BOOL variable;      // Drift-adjusted: fractional step, interpolated kernels
+    UINT32 frac;        // Variable: position past pos, in 2^-32 frames
+    UINT64 stepFixed;   // Variable: input frames per output frame, 32.32
+    float* bank;        // Variable: (2^DRIFT_PHASE_BITS + 1) * AUDIO_RESAMPLE_TAPS
+    float* left;        // History + one input block, planar
+    float* right;
+    int held;           // Frames in left / right
+    float* out;         // Interleaved stereo float, one block of output
+    int outCapacity;    // Frames
+};
+
+static int Gcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth-order modified Bessel function (series), for the Kaiser window
+static double BesselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    double q = x * x / 4.0;
+    for (int k = 1; k < 64 && term > sum * 1e-12; k++) {
+        term *= q / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+// count kernels, kernel p for an output p / phases of a frame past the
+// window centre; ratio = output rate / input rate
+static void BuildKernels(float* coeffs, int count, int phases, double ratio) {
+    const int taps = AUDIO_RESAMPLE_TAPS;
+    const double half = taps / 2.0;
+    // Cutoff in cycles per input frame, times two (1.0 = input Nyquist)
+    double fc = AUDIO_RESAMPLE_CUTOFF * (ratio < 1.0 ? ratio : 1.0);
+    double i0Beta = BesselI0(AUDIO_RESAMPLE_KAISER_BETA);
+
+    for (int p = 0; p < count; p++) {
+        float* c = coeffs + (size_t)p * taps;
+        double sum = 0.0;
+        double h[AUDIO_RESAMPLE_TAPS];
+        for (int k = 0; k < taps; k++) {
+            // Distance from the output position to tap k, in input frames
+            double t = (k - (half - 1.0)) - (double)p / phases;
+            double x = fc * t;
+            double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(RESAMPLE_PI * x) / (RESAMPLE_PI * x);
+            double r = t / half;
+            double w = (r * r < 1.0) ? BesselI0(AUDIO_RESAMPLE_KAISER_BETA * sqrt(1.0 - r * r)) / i0Beta : 0.0;
+            h[k] = fc * sinc * w;
+            sum += h[k];
+        }
+        for (int k = 0; k < taps; k++) {
+            c[k] = (float)(h[k] / sum);
+        }
+    }
+}
+
+AudioResampler* AudioResampler_Create(int srcRate, int dstRate) {
+    if (srcRate <= 0 || dstRate <= 0) return NULL;
+
+    AudioResampler* rs = (AudioResampler*)calloc(1, sizeof(AudioResampler));
+    if (!rs) return NULL;
+
+    rs->srcRate = srcRate;
+    rs->dstRate = dstRate;
+    rs->bypass = (srcRate == dstRate);
+
+    int g = Gcd(srcRate, dstRate);
+    rs->phases = dstRate / g;
+    rs->step = srcRate / g;
+    if (rs->phases > AUDIO_RESAMPLE_MAX_PHASES) {
+        rs->phases = AUDIO_RESAMPLE_MAX_PHASES;
+        rs->step = (int)((double)srcRate * AUDIO_RESAMPLE_MAX_PHASES / dstRate + 0.5);
+        if (rs->step < 1) rs->step = 1;
+        ResampleLog("AudioResampler: %d -> %d Hz approximated as %d/%d\n",
+            srcRate, dstRate, rs->phases, rs->step);
+    }
+
+    int historyFrames = AUDIO_RESAMPLE_TAPS + AUDIO_RESAMPLE_BLOCK;
+    rs->left = (float*)malloc(historyFrames * sizeof(float));
+    rs->right = (float*)malloc(historyFrames * sizeof(float));
+    if (!rs->left || !rs->right) goto cleanup;
+
+    if (!rs->bypass) {
+        rs->coeffs = (float*)malloc((size_t)rs->phases * AUDIO_RESAMPLE_TAPS * sizeof(float));
+        if (!rs->coeffs) goto cleanup;
+        BuildKernels(rs->coeffs, rs->phases, rs->phases, (double)rs->phases / rs->step);
+    }
+    // Room for one block at the fastest output a ratio adjustment allows
+    double outPerIn = max((double)rs->phases / rs->step, (double)dstRate / srcRate);
+    rs->outCapacity = (int)(historyFrames * outPerIn * (1.0 + AUDIO_DRIFT_MAX_PPM * 1e-6)) + 2;
+    rs->out = (float*)malloc((size_t)rs->outCapacity * 2 * sizeof(float));
+    if (!rs->out) goto cleanup;
+
+    AudioResampler_Reset(rs);
+    return rs;
+
+cleanup:
+    AudioResampler_Destroy(rs);
+    return NULL;
+}
+
+void AudioResampler_Destroy(AudioResampler* rs) {
+    if (!rs) return;
+    SAFE_FREE(rs->coeffs);
+    SAFE_FREE(rs->bank);
+    SAFE_FREE(rs->left);
+    SAFE_FREE(rs->right);
+    SAFE_FREE(rs->out);
+    free(rs);
+}
+
+void AudioResampler_Reset(AudioResampler* rs) {
+    if (!rs) return;
+    rs->phase = 0;
+    rs->pos = 0;
+    rs->frac = 0;
+    rs->held = AUDIO_RESAMPLE_TAPS / 2 - 1;
+    for (int i = 0; i < rs->held; i++) {
+        rs->left[i] = 0.0f;
+        rs->right[i] = 0.0f;
+    }
+}
+
+/* ============================================================================
+ * INPUT: one loop per format to planar float
+ * ============================================================================
+ */
+
+static void F32ToPlanar(const BYTE* src, int frames, int channels, int blockAlign,
+                        float* left, float* right) {
+    int rightOffset = channels >= 2 ? 1 : 0;
+    for (int i = 0; i < frames; i++) {
+        const float* s = (const float*)(src + (size_t)i * blockAlign);
+        left[i] = s[0];
+        right[i] = s[rightOffset];
+    }
+}
+
+static void S16ToPlanar(const BYTE* src, int frames, int channels, int blockAlign,
+                        float* left, float* right) {
+    const float scale = 1.0f / AUDIO_16BIT_MAX;
+    int rightOffset = channels >= 2 ? 1 : 0;
+    for (int i = 0; i < frames; i++) {
+        const short* s = (const short*)(src + (size_t)i * blockAlign);
+        left[i] = s[0] * scale;
+        right[i] = s[rightOffset] * scale;
+    }
+}
+
+static void S24ToPlanar(const BYTE* src, int frames, int channels, int blockAlign,
+                        float* left, float* right) {
+    const float scale = 1.0f / AUDIO_24BIT_MAX;
+    int rightOffset = channels >= 2 ? 3 : 0;
+    for (int i = 0; i < frames; i++) {
+        const BYTE* p = src + (size_t)i * blockAlign;
+        const BYTE* q = p + rightOffset;
+        // (v ^ sign) - sign sign-extends 24 bits without a branch
+        int l = ((p[0] | (p[1] << 8) | (p[2] << 16)) ^ AUDIO_24BIT_SIGN_MASK) - AUDIO_24BIT_SIGN_MASK;
+        int r = ((q[0] | (q[1] << 8) | (q[2] << 16)) ^ AUDIO_24BIT_SIGN_MASK) - AUDIO_24BIT_SIGN_MASK;
+        left[i] = l * scale;
+        right[i] = r * scale;
+    }
+}
+
+static void ToPlanar(const BYTE* src, int frames, AudioSampleFormat format,
+                     int channels, int blockAlign, float* left, float* right) {
+    if (src && channels >= 1) {
+        switch (format) {
+        case AUDIO_SAMPLE_F32: F32ToPlanar(src, frames, channels, blockAlign, left, right); return;
+        case AUDIO_SAMPLE_S16: S16ToPlanar(src, frames, channels, blockAlign, left, right); return;
+        case AUDIO_SAMPLE_S24: S24ToPlanar(src, frames, channels, blockAlign, left, right); return;
+        default: break;
+        }
+    }
+    memset(left, 0, frames * sizeof(float));
+    memset(right, 0, frames * sizeof(float));
+}
+
+/* ============================================================================
+ * FILTER AND OUTPUT
+ * ============================================================================
+ */
+
+// out[0] / out[1] = dot(c, left) / dot(c, right) over AUDIO_RESAMPLE_TAPS
+static void DotStereo(const float* c, const float* left, const float* right, float* out) {
+    __m128 l0 = _mm_setzero_ps(), l1 = _mm_setzero_ps();
+    __m128 r0 = _mm_setzero_ps(), r1 = _mm_setzero_ps();
+    for (int k = 0; k < AUDIO_RESAMPLE_TAPS; k += 8) {
+        __m128 c0 = _mm_loadu_ps(c + k);
+        __m128 c1 = _mm_loadu_ps(c + k + 4);
+        l0 = _mm_add_ps(l0, _mm_mul_ps(c0, _mm_loadu_ps(left + k)));
+        l1 = _mm_add_ps(l1, _mm_mul_ps(c1, _mm_loadu_ps(left + k + 4)));
+        r0 = _mm_add_ps(r0, _mm_mul_ps(c0, _mm_loadu_ps(right + k)));
+        r1 = _mm_add_ps(r1, _mm_mul_ps(c1, _mm_loadu_ps(right + k + 4)));
+    }
+    __m128 l = _mm_add_ps(l0, l1);
+    __m128 r = _mm_add_ps(r0, r1);
+    // [l0+l2, r0+r2, l1+l3, r1+r3] -> [L, R, ...]
+    __m128 t = _mm_add_ps(_mm_unpacklo_ps(l, r), _mm_unpackhi_ps(l, r));
+    t = _mm_add_ps(t, _mm_movehl_ps(t, t));
+    _mm_storel_pi((__m64*)out, t);
+}
+
+// Interleaved float -> s16, rounded to nearest and saturated; count samples
+static void FloatToS16(const float* src, short* dst, int count) {
+    const __m128 scale = _mm_set1_ps(AUDIO_16BIT_MAX);
+    const __m128 hi = _mm_set1_ps(AUDIO_16BIT_MAX_SIGNED);
+    const __m128 lo = _mm_set1_ps(-AUDIO_16BIT_MAX);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+        // Clamp first: cvtps2dq turns anything past 2^31 into INT_MIN
+        a = _mm_max_ps(_mm_min_ps(a, hi), lo);
+        b = _mm_max_ps(_mm_min_ps(b, hi), lo);
+        __m128i w = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128((__m128i*)(dst + i), w);
+    }
+    for (; i < count; i++) {
+        __m128 v = _mm_mul_ss(_mm_load_ss(src + i), scale);
+        v = _mm_max_ss(_mm_min_ss(v, hi), lo);
+        dst[i] = (short)_mm_cvtss_si32(v);
+    }
+}
+
+// Drop history frames no later window needs
+static void DropConsumed(AudioResampler* rs) {
+    // Downsampling can step past the held frames; the excess skips input
+    int drop = rs->pos < rs->held ? rs->pos : rs->held;
+    int keep = rs->held - drop;
+    if (drop > 0 && keep > 0) {
+        memmove(rs->left, rs->left + drop, keep * sizeof(float));
+        memmove(rs->right, rs->right + drop, keep * sizeof(float));
+    }
+    rs->held = keep;
+    rs->pos -= drop;
+}
+
+// Emit outputs of every full window in the history, then drop consumed frames
+static int Filter(AudioResampler* rs) {
+    const int taps = AUDIO_RESAMPLE_TAPS;
+    int produced = 0;
+    while (rs->pos + taps <= rs->held && produced < rs->outCapacity) {
+        const float* c = rs->coeffs + (size_t)rs->phase * taps;
+        DotStereo(c, rs->left + rs->pos, rs->right + rs->pos, rs->out + produced * 2);
+        produced++;
+        rs->phase += rs->step;
+        rs->pos += rs->phase / rs->phases;
+        rs->phase %= rs->phases;
+    }
+    DropConsumed(rs);
+    return produced;
+}
+
+// Filter with a fractional step: blend the kernels either side of each position
+static int FilterVariable(AudioResampler* rs) {
+    const int taps = AUDIO_RESAMPLE_TAPS;
+    const int shift = 32 - AUDIO_RESAMPLE_DRIFT_PHASE_BITS;
+    const UINT32 fracMask = (1u << shift) - 1;
+    const float fracScale = 1.0f / (float)(1u << shift);
+    int produced = 0;
+    while (rs->pos + taps <= rs->held && produced < rs->outCapacity) {
+        const float* c = rs->bank + (size_t)(rs->frac >> shift) * taps;
+        float a[2], b[2];
+        DotStereo(c, rs->left + rs->pos, rs->right + rs->pos, a);
+        DotStereo(c + taps, rs->left + rs->pos, rs->right + rs->pos, b);
+        float f = (float)(rs->frac & fracMask) * fracScale;
+        rs->out[produced * 2] = a[0] + (b[0] - a[0]) * f;
+        rs->out[produced * 2 + 1] = a[1] + (b[1] - a[1]) * f;
+        produced++;
+
+        UINT64 next = (UINT64)rs->frac + rs->stepFixed;
+        rs->pos += (int)(next >> 32);
+        rs->frac = (UINT32)next;
+    }
+    DropConsumed(rs);
+    return produced;
+}
+
+void AudioResampler_SetRatio(AudioResampler* rs, double ratio) {
+    if (!rs) return;
+
+    double limit = AUDIO_DRIFT_MAX_PPM * 1e-6;
+    if (ratio < 1.0 - limit) ratio = 1.0 - limit;
+    if (ratio > 1.0 + limit) ratio = 1.0 + limit;
+    if (!rs->variable && ratio == 1.0) return;
+
+    if (!rs->variable) {
+        int phases = 1 << AUDIO_RESAMPLE_DRIFT_PHASE_BITS;
+        rs->bank = (float*)malloc((size_t)(phases + 1) * AUDIO_RESAMPLE_TAPS * sizeof(float));
+        if (!rs->bank) {
+            ResampleLog("AudioResampler: drift kernel bank allocation failed, ratio stays fixed\n");
+            return;
+        }
+        BuildKernels(rs->bank, phases + 1, phases, (double)rs->dstRate / rs->srcRate);
+        // Same output position, now as a fraction (history already has the lead)
+        rs->frac = rs->bypass ? 0 : (UINT32)(((UINT64)rs->phase << 32) / (UINT64)rs->phases);
+        rs->bypass = FALSE;
+        rs->variable = TRUE;
+    }
+    rs->stepFixed = (UINT64)(ratio * rs->srcRate / rs->dstRate * 4294967296.0 + 0.5);
+}
+
+int AudioResampler_Process(AudioResampler* rs, const BYTE* src, int srcFrames,
+                           AudioSampleFormat format, int channels, int blockAlign,
+                           short* dst, int dstMaxFrames) {
+    if (!rs || !dst || srcFrames <= 0) return 0;
+
+    int written = 0;
+    while (srcFrames > 0) {
+        int n = srcFrames < AUDIO_RESAMPLE_BLOCK ? srcFrames : AUDIO_RESAMPLE_BLOCK;
+        // Frames skipped by a previous downsampling step
+        int skip = rs->pos > rs->held ? rs->pos - rs->held : 0;
+        if (skip > n) skip = n;
+
+        ToPlanar(src ? src + (size_t)skip * blockAlign : NULL, n - skip, format,
+                 channels, blockAlign, rs->left + rs->held, rs->right + rs->held);
+        rs->pos -= skip;
+        rs->held += n - skip;
+        if (src) src += (size_t)n * blockAlign;
+        srcFrames -= n;
+
+        int produced;
+        if (rs->bypass) {
+            // Pass through, keeping the lead frames for a later switch to filtering
+            const int lead = AUDIO_RESAMPLE_TAPS / 2 - 1;
+            produced = rs->held - lead;
+            for (int i = 0; i < produced; i++) {
+                rs->out[i * 2] = rs->left[lead + i];
+                rs->out[i * 2 + 1] = rs->right[lead + i];
+            }
+            memmove(rs->left, rs->left + produced, lead * sizeof(float));
+            memmove(rs->right, rs->right + produced, lead * sizeof(float));
+            rs->held = lead;
+        } else if (rs->variable) {
+            produced = FilterVariable(rs);
+        } else {
+            produced = Filter(rs);
+        }
+
+        int room = dstMaxFrames - written;
+        if (produced > room) produced = room;
+        if (produced > 0) {
+            FloatToS16(rs->out, dst + (size_t)written * 2, produced * 2);
+            written += produced;
+        }
+    }
+    return written;
+}
@@ -0,0 +1,56 @@
+/*
+ * audio_resample.h - Source format conversion and polyphase resampling
+ *
+ * USED BY: audio_capture.c (one resampler per source capture thread)
+ *
+ * Turns WASAPI packets (f32, s16 or packed s24, any channel count) into
+ * stereo 16-bit PCM at the capture rate in three passes: one specialized
+ * loop per source format to planar float, a windowed-sinc polyphase
+ * filter (AUDIO_RESAMPLE_TAPS taps, SSE), and a vectorized float -> s16
+ * pack. The filter history and phase carry across calls, so consecutive
+ * packets resample as one continuous stream: no clicks at packet edges and
+ * no frames lost to per-packet rounding. Equal rates skip the filter and
+ * s16 input then comes out bit-exact.
+ *
+ * Not thread-safe: one resampler per thread.
+ */
+
+#ifndef AUDIO_RESAMPLE_H
+#define AUDIO_RESAMPLE_H
+
+#include <windows.h>
+
+typedef enum {
+    AUDIO_SAMPLE_UNSUPPORTED = 0,
+    AUDIO_SAMPLE_F32,               // IEEE float, nominal [-1, 1]
+    AUDIO_SAMPLE_S16,
+    AUDIO_SAMPLE_S24                // 3 bytes per sample, little-endian
+} AudioSampleFormat;
+
+typedef struct AudioResampler AudioResampler;
+
+// srcRate -> dstRate (Hz). Rates whose reduced ratio needs more than
+// AUDIO_RESAMPLE_MAX_PHASES phases are approximated (logged).
+// Returns NULL on allocation failure.
+AudioResampler* AudioResampler_Create(int srcRate, int dstRate);
+
+void AudioResampler_Destroy(AudioResampler* rs);
+
+// Forget history and phase (stream discontinuity)
+void AudioResampler_Reset(AudioResampler* rs);
+
+// Scale the input rate by ratio: the source clock's measured rate over its
+// nominal rate, clamped to +-AUDIO_DRIFT_MAX_PPM. The first ratio other
+// than 1 switches to interpolated kernels for good (equal rates then stop
+// bypassing); later calls only change the step.
+void AudioResampler_SetRatio(AudioResampler* rs, double ratio);
+
+// Convert srcFrames interleaved frames (blockAlign bytes apart, channels
+// channels of format) and append stereo s16 frames to dst. src NULL or
+// format AUDIO_SAMPLE_UNSUPPORTED feeds silence, keeping the timeline.
+// Output beyond dstMaxFrames is dropped. Returns frames written.
+int AudioResampler_Process(AudioResampler* rs, const BYTE* src, int srcFrames,
+                           AudioSampleFormat format, int channels, int blockAlign,
+                           short* dst, int dstMaxFrames);
+
+#endif // AUDIO_RESAMPLE_H
@@ -0,0 +1,290 @@
+/*
+ * audio_ring.c - Fixed-capacity store of encoded AAC frames for replay
+ *
+ * USED BY: replay_buffer.c ONLY
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Init uses goto-cleanup; a failed ring stores nothing
+ * - Caller serializes every call under the track's lock
+ */
+
+#include "audio_ring.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include "audio_capture.h"
+#include "leak_tracker.h"
+
+// Alias for logging
+#define RingLog Logger_Log
+
+/*
+ * MULTI-RESOURCE FUNCTION: AudioRing_Init
+ * Resources: 2 - descriptor ring (calloc), payload arena (malloc)
+ * Pattern: goto-cleanup in reverse acquisition order
+ * Init: ZeroMemory ensures NULL initialization
+ */
+BOOL AudioRing_Init(AudioRing* ring, int seconds) {
+    LWSR_ASSERT(ring != NULL);
+
+    if (!ring) return FALSE;
+    ZeroMemory(ring, sizeof(*ring));
+    if (seconds <= 0) return FALSE;
+
+    double framesPerSec = (double)AAC_SAMPLE_RATE / AAC_SAMPLES_PER_FRAME;
+    int capacity = (int)((double)seconds * framesPerSec * AUDIO_RING_HEADROOM) + 1;
+    size_t arenaBytes = (size_t)((double)seconds * (AAC_BITRATE / 8) * AUDIO_ARENA_HEADROOM);
+    if (arenaBytes < (size_t)AUDIO_ARENA_MIN_KB * 1024) arenaBytes = (size_t)AUDIO_ARENA_MIN_KB * 1024;
+
+    ring->samples = (MuxerAudioSample*)calloc((size_t)capacity, sizeof(MuxerAudioSample));
+    if (!ring->samples) {
+        RingLog("AudioRing_Init: failed to allocate %d samples\n", capacity);
+        goto cleanup;
+    }
+
+    ring->arena = (BYTE*)malloc(arenaBytes);
+    if (!ring->arena) {
+        RingLog("AudioRing_Init: failed to allocate %zu KB arena\n", arenaBytes / 1024);
+        goto cleanup;
+    }
+
+    ring->capacity = capacity;
+    ring->arenaSize = arenaBytes;
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_AUDIO_RING, (size_t)capacity * sizeof(MuxerAudioSample) + arenaBytes);
+    return TRUE;
+
+cleanup:
+    SAFE_FREE(ring->arena);
+    SAFE_FREE(ring->samples);
+    return FALSE;
+}
+
+void AudioRing_Free(AudioRing* ring) {
+    if (!ring) return;
+    LEAK_TRACK_BYTES_FREE(LEAK_SITE_AUDIO_RING, (size_t)ring->capacity * sizeof(MuxerAudioSample) +
+                          ring->arenaSize + (ring->silentFrame ? ring->silentFrameSize : 0));
+    SAFE_FREE(ring->silentFrame);
+    SAFE_FREE(ring->arena);
+    SAFE_FREE(ring->samples);
+    ZeroMemory(ring, sizeof(*ring));
+}
+
+void AudioRing_Reset(AudioRing* ring) {
+    if (!ring) return;
+    ring->tail = 0;
+    ring->count = 0;
+    ring->arenaHead = 0;
+    ring->arenaTail = 0;
+    ring->arenaCount = 0;
+    ring->usedBytes = 0;
+}
+
+BOOL AudioRing_PopOldest(AudioRing* ring) {
+    if (!ring || ring->count == 0) return FALSE;
+    const MuxerAudioSample* oldest = &ring->samples[ring->tail];
+    if (oldest->data != ring->silentFrame) {
+        ring->usedBytes -= oldest->size;
+        ring->arenaTail = (size_t)(oldest->data - ring->arena) + oldest->size;
+        ring->arenaCount--;
+    }
+    ring->tail = (ring->tail + 1) % ring->capacity;
+    ring->count--;
+    return TRUE;
+}
+
+// Arena offset with room for size bytes, evicting the oldest samples as
+// needed. Payloads never wrap: a run too short at the end is skipped and
+// reclaimed with the samples in front of it. arenaTail is the end of the
+// last payload evicted, which is where the oldest starts unless that one
+// was placed at 0 past such a run; the run then just counts as live until
+// the payload at 0 goes too.
+static size_t Reserve(AudioRing* ring, DWORD size) {
+    for (;;) {
+        if (ring->arenaCount == 0) return 0;
+
+        size_t tailOffset = ring->arenaTail;
+        if (ring->arenaHead > tailOffset) {
+            // Live bytes are [tail, head): free space at the end, then before tail
+            if (ring->arenaSize - ring->arenaHead >= size) return ring->arenaHead;
+            if (tailOffset >= size) return 0;
+        } else if (tailOffset - ring->arenaHead >= size) {
+            // Wrapped: free is [head, tail)
+            return ring->arenaHead;
+        }
+
+        AudioRing_PopOldest(ring);
+        ring->spaceEvictions++;
+    }
+}
+
+BOOL AudioRing_Push(AudioRing* ring, const BYTE* data, DWORD size,
+                    LONGLONG timestamp, LONGLONG duration) {
+    LWSR_ASSERT(ring != NULL);
+
+    if (!ring || !ring->samples || !ring->arena || !data) return FALSE;
+    if (size == 0 || size > ring->arenaSize) return FALSE;
+
+    if (ring->count >= ring->capacity) {
+        AudioRing_PopOldest(ring);
+        ring->spaceEvictions++;
+    }
+
+    size_t offset = Reserve(ring, size);
+    memcpy(ring->arena + offset, data, size);
+    if (ring->arenaCount == 0) ring->arenaTail = offset;
+
+    MuxerAudioSample* dst = &ring->samples[(ring->tail + ring->count) % ring->capacity];
+    dst->data = ring->arena + offset;
+    dst->size = size;
+    dst->timestamp = timestamp;
+    dst->duration = duration;
+    ring->count++;
+    ring->arenaCount++;
+    ring->usedBytes += size;
+    ring->arenaHead = offset + size;
+    return TRUE;
+}
+
+BOOL AudioRing_SetSilentFrame(AudioRing* ring, const BYTE* data, DWORD size) {
+    LWSR_ASSERT(ring != NULL);
+
+    if (!ring || !data || size == 0) return FALSE;
+    if (ring->silentFrame) return TRUE;
+
+    ring->silentFrame = (BYTE*)malloc(size);
+    if (!ring->silentFrame) return FALSE;
+    memcpy(ring->silentFrame, data, size);
+    ring->silentFrameSize = size;
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_AUDIO_RING, size);
+    return TRUE;
+}
+
+BOOL AudioRing_PushSilent(AudioRing* ring, LONGLONG timestamp, LONGLONG duration) {
+    LWSR_ASSERT(ring != NULL);
+
+    if (!ring || !ring->samples || !ring->silentFrame) return FALSE;
+
+    if (ring->count >= ring->capacity) {
+        AudioRing_PopOldest(ring);
+        ring->spaceEvictions++;
+    }
+
+    MuxerAudioSample* dst = &ring->samples[(ring->tail + ring->count) % ring->capacity];
+    dst->data = ring->silentFrame;
+    dst->size = ring->silentFrameSize;
+    dst->timestamp = timestamp;
+    dst->duration = duration;
+    ring->count++;
+    return TRUE;
+}
+
+const MuxerAudioSample* AudioRing_At(const AudioRing* ring, int i) {
+    LWSR_ASSERT(ring != NULL);
+    LWSR_ASSERT(i >= 0 && i < ring->count);
+    return &ring->samples[(ring->tail + i) % ring->capacity];
+}
+
+/* ============================================================================
+ * PCM RING
+ * ============================================================================
+ * Byte n of the stream plays at originTs + (n / AUDIO_BLOCK_ALIGN) frames.
+ */
+
+#define PCM_AAC_FRAME_BYTES ((UINT64)AAC_SAMPLES_PER_FRAME * AUDIO_BLOCK_ALIGN)
+
+BOOL PcmRing_Init(PcmRing* ring, int seconds) {
+    LWSR_ASSERT(ring != NULL);
+
+    if (!ring) return FALSE;
+    ZeroMemory(ring, sizeof(*ring));
+    if (seconds <= 0) return FALSE;
+
+    size_t bytes = (size_t)(seconds + AUDIO_PCM_RING_SLACK_SEC) * AUDIO_BYTES_PER_SEC;
+    ring->data = (BYTE*)malloc(bytes);
+    if (!ring->data) {
+        RingLog("PcmRing_Init: failed to allocate %zu KB\n", bytes / 1024);
+        return FALSE;
+    }
+    ring->capacity = bytes;
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_PCM_RING, bytes);
+    return TRUE;
+}
+
+void PcmRing_Free(PcmRing* ring) {
+    if (!ring) return;
+    LEAK_TRACK_BYTES_FREE(LEAK_SITE_PCM_RING, ring->capacity);
+    SAFE_FREE(ring->data);
+    ZeroMemory(ring, sizeof(*ring));
+}
+
+void PcmRing_Write(PcmRing* ring, const BYTE* data, int size, LONGLONG timestamp) {
+    LWSR_ASSERT(ring != NULL);
+
+    if (!ring || !ring->data || !data || size <= 0) return;
+    if (ring->written == 0) ring->originTs = timestamp;
+
+    /* Only the newest capacity bytes of an oversized write survive */
+    UINT64 skip = (size_t)size > ring->capacity ? (UINT64)size - ring->capacity : 0;
+    ring->written += skip;
+    data += skip;
+    size_t remaining = (size_t)size - (size_t)skip;
+
+    while (remaining > 0) {
+        size_t offset = (size_t)(ring->written % ring->capacity);
+        size_t run = min(remaining, ring->capacity - offset);
+        memcpy(ring->data + offset, data, run);
+        ring->written += run;
+        data += run;
+        remaining -= run;
+    }
+}
+
+// Stream byte offset of PTS ts (before the origin = 0), in whole frames
+static UINT64 PcmTsToByte(const PcmRing* ring, LONGLONG ts) {
+    if (ts <= ring->originTs) return 0;
+    UINT64 frames = (UINT64)((ts - ring->originTs) * AUDIO_SAMPLE_RATE / MF_UNITS_PER_SECOND);
+    return frames * AUDIO_BLOCK_ALIGN;
+}
+
+BOOL PcmRing_CopyWindow(const PcmRing* ring, LONGLONG fromTs, LONGLONG toTs,
+                        BYTE** outData, int* outSize, LONGLONG* outStartTs) {
+    LWSR_ASSERT(ring != NULL);
+    LWSR_ASSERT(outData != NULL && outSize != NULL && outStartTs != NULL);
+
+    *outData = NULL;
+    *outSize = 0;
+    *outStartTs = 0;
+    if (!ring->data || ring->written == 0 || toTs <= fromTs) return TRUE;
+
+    /* Held bytes, trimmed inward to whole AAC frames */
+    UINT64 heldStart = ring->written > ring->capacity ? ring->written - ring->capacity : 0;
+    heldStart = (heldStart + PCM_AAC_FRAME_BYTES - 1) / PCM_AAC_FRAME_BYTES * PCM_AAC_FRAME_BYTES;
+    UINT64 heldEnd = ring->written / PCM_AAC_FRAME_BYTES * PCM_AAC_FRAME_BYTES;
+
+    /* Requested bytes, widened outward to whole AAC frames */
+    UINT64 start = PcmTsToByte(ring, fromTs) / PCM_AAC_FRAME_BYTES * PCM_AAC_FRAME_BYTES;
+    UINT64 end = (PcmTsToByte(ring, toTs) + PCM_AAC_FRAME_BYTES - 1) / PCM_AAC_FRAME_BYTES * PCM_AAC_FRAME_BYTES;
+    if (start < heldStart) start = heldStart;
+    if (end > heldEnd) end = heldEnd;
+    if (end <= start || end - start > (UINT64)INT_MAX) return TRUE;
+
+    size_t size = (size_t)(end - start);
+    BYTE* copy = (BYTE*)malloc(size);
+    if (!copy) {
+        RingLog("PcmRing_CopyWindow: failed to allocate %zu KB\n", size / 1024);
+        return FALSE;
+    }
+
+    size_t offset = (size_t)(start % ring->capacity);
+    size_t first = min(size, ring->capacity - offset);
+    memcpy(copy, ring->data + offset, first);
+    if (first < size) memcpy(copy + first, ring->data, size - first);
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_SAVE_PCM, size);
+
+    *outData = copy;
+    *outSize = (int)size;
+    *outStartTs = ring->originTs +
+        (LONGLONG)(start / AUDIO_BLOCK_ALIGN) * MF_UNITS_PER_SECOND / AUDIO_SAMPLE_RATE;
+    return TRUE;
+}
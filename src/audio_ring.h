@@ -0,0 +1,108 @@
+/*
+ * audio_ring.h - Fixed-capacity store of encoded AAC frames for replay
+ *
+ * USED BY: replay_buffer.c ONLY
+ *
+ * The audio counterpart of FrameBuffer's arena mode: sample descriptors
+ * live in a ring (oldest at tail) and their payloads in one circular byte
+ * arena, both sized once from the replay duration. Appending copies the
+ * payload in at the arena head; evicting the oldest sample just advances
+ * the tail. No per-sample heap traffic, no memmove, no realloc.
+ *
+ * Payloads are stored whole, never split across the arena end (same rule
+ * as the FrameBuffer arena), so descriptor data pointers can be handed to
+ * memcpy directly.
+ *
+ * Silent stretches of a track ([Advanced] SilenceGate) are stored as
+ * descriptors that all point at one cached silent frame outside the arena:
+ * a descriptor slot each, no payload bytes.
+ *
+ * PcmRing is the raw counterpart for tracks encoded only when saved
+ * ([Advanced] DeferredSourceAudio): one byte circle of stereo s16 at
+ * AUDIO_SAMPLE_RATE. The stream it is fed is gapless (the mix thread pads
+ * silence), so a byte's PTS is the first write's PTS plus its offset.
+ *
+ * Not thread-safe: the owner serializes calls (replay_buffer.c holds the
+ * track's critical section).
+ */
+
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <windows.h>
+#include "mp4_muxer.h"
+
+typedef struct {
+    MuxerAudioSample* samples;  // Descriptor ring; data points into arena
+    int capacity;
+    int tail;                   // Oldest sample
+    int count;
+
+    BYTE* arena;                // Payload bytes
+    size_t arenaSize;
+    size_t arenaHead;           // Next write offset
+    size_t arenaTail;           // End of the last payload evicted (start of the oldest)
+    int arenaCount;             // Samples whose payload is in the arena
+
+    BYTE* silentFrame;          // Payload shared by AudioRing_PushSilent samples
+    DWORD silentFrameSize;
+
+    size_t usedBytes;           // Sum of arena payload sizes
+    int spaceEvictions;         // Evicted for capacity or arena space
+} AudioRing;
+
+// Allocate a ring sized for `seconds` of AAC at AAC_BITRATE (with headroom).
+// Returns FALSE (ring left empty and unusable) if an allocation fails.
+BOOL AudioRing_Init(AudioRing* ring, int seconds);
+
+// Release the allocations. Safe on a zeroed or failed ring.
+void AudioRing_Free(AudioRing* ring);
+
+// Drop every sample (allocations kept)
+void AudioRing_Reset(AudioRing* ring);
+
+// Copy one AAC frame in, evicting the oldest samples if the ring or arena
+// is full. Returns FALSE if the ring is unusable or size exceeds the arena.
+BOOL AudioRing_Push(AudioRing* ring, const BYTE* data, DWORD size,
+                    LONGLONG timestamp, LONGLONG duration);
+
+// Keep a copy of an encoded silent frame for AudioRing_PushSilent. The
+// first one set stays for the ring's life (samples point at it); later
+// calls copy nothing and return TRUE. FALSE if the copy cannot be allocated.
+BOOL AudioRing_SetSilentFrame(AudioRing* ring, const BYTE* data, DWORD size);
+
+// Append a sample whose payload is the silent frame, evicting the oldest
+// sample if the ring is full. Returns FALSE if no silent frame is set.
+BOOL AudioRing_PushSilent(AudioRing* ring, LONGLONG timestamp, LONGLONG duration);
+
+// Evict the oldest sample. Returns FALSE if the ring is empty.
+BOOL AudioRing_PopOldest(AudioRing* ring);
+
+// Sample i, 0 = oldest. i must be < count.
+const MuxerAudioSample* AudioRing_At(const AudioRing* ring, int i);
+
+typedef struct {
+    BYTE* data;
+    size_t capacity;            // Bytes, whole PCM frames
+    UINT64 written;             // Bytes ever written; the last min(written, capacity) are held
+    LONGLONG originTs;          // PTS of the first byte written
+} PcmRing;
+
+// Allocate `seconds` (+ AUDIO_PCM_RING_SLACK_SEC) of PCM.
+// Returns FALSE (ring left empty and unusable) if the allocation fails.
+BOOL PcmRing_Init(PcmRing* ring, int seconds);
+
+// Release the buffer. Safe on a zeroed or failed ring.
+void PcmRing_Free(PcmRing* ring);
+
+// Append PCM, overwriting the oldest. timestamp is used only by the first write.
+void PcmRing_Write(PcmRing* ring, const BYTE* data, int size, LONGLONG timestamp);
+
+// Copy the held PCM overlapping [fromTs, toTs), widened to whole AAC frames
+// counted from the first write (the grid a live encoder would have used).
+// *outData is malloc'd, NULL if nothing overlaps; *outStartTs is its PTS.
+// Returns FALSE only if the copy cannot be allocated.
+BOOL PcmRing_CopyWindow(const PcmRing* ring, LONGLONG fromTs, LONGLONG toTs,
+                        BYTE** outData, int* outSize, LONGLONG* outStartTs);
+
+#endif // AUDIO_RING_H
@@ -0,0 +1,30 @@
+/*
+ * bench_common.c - Timing and statistics helpers shared by the benchmarks
+ */
+
+#include "bench_common.h"
+#include <stdlib.h>
+
+double Bench_ElapsedMs(LARGE_INTEGER start, LARGE_INTEGER freq) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (double)(now.QuadPart - start.QuadPart) * 1000.0 / (double)freq.QuadPart;
+}
+
+int Bench_CompareDouble(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+double Bench_Median(double* values, int count) {
+    qsort(values, (size_t)count, sizeof(double), Bench_CompareDouble);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+double Bench_Percentile(const double* sorted, int count, double pct) {
+    if (count <= 0) return 0.0;
+    int rank = (int)(pct * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
@@ -0,0 +1,28 @@
+/*
+ * bench_common.h - Timing and statistics helpers shared by the benchmarks
+ *
+ * USED BY: bench\mux_bench.c, bench\audio_bench.c, bench\detect_bench.c,
+ *          soak_bench.c
+ *
+ * Lives in src\ because the soak benchmark is built into lwsr.exe; the
+ * console benchmarks compile with /I"src" and link bench_common.c.
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <windows.h>
+
+// Milliseconds from start (QueryPerformanceCounter) until now
+double Bench_ElapsedMs(LARGE_INTEGER start, LARGE_INTEGER freq);
+
+// qsort comparator for ascending doubles
+int Bench_CompareDouble(const void* a, const void* b);
+
+// Median of count values (count > 0). Sorts values in place.
+double Bench_Median(double* values, int count);
+
+// Nearest-rank percentile (pct in 0..1) of an ascending array; 0 if empty
+double Bench_Percentile(const double* sorted, int count, double pct);
+
+#endif // BENCH_COMMON_H
@@ -31,6 +31,8 @@ typedef struct RecordingBorderState {
     HWND wnd;
     BOOL isVisible;
     RECT currentRect;
+    LayeredBitmap surface;      /* Retained: frame-sized, transparent inside the border */
+    COLORREF surfaceColor;      /* Border colour currently in surface */
 } RecordingBorderState;
 
 static RecordingBorderState g_recording = {0};
@@ -82,39 +84,42 @@ void Border_Shutdown(void) {
         DestroyWindow(g_recording.wnd);
         g_recording.wnd = NULL;
     }
+    LayeredBitmap_Destroy(&g_recording.surface);
     g_recording.isVisible = FALSE;
 }
 
-// Create and set a 32-bit ARGB bitmap for the border with a custom color
+// Set the border to a custom color. The surface is kept between calls, so
+// a flash rewrites only the border strips (never the interior, which stays
+// transparent) and reuses the DIB instead of allocating a frame-sized one.
 static void UpdateBorderBitmapColored(int width, int height, BYTE r, BYTE g, BYTE b) {
     if (!g_recording.wnd || width < 1 || height < 1) return;
     
-    LayeredBitmap lb = {0};
-    if (!LayeredBitmap_Create(&lb, width, height)) {
-        Logger_Log("UpdateBorderBitmapColored: LayeredBitmap_Create failed (%dx%d)\n", width, height);
+    LayeredBitmap* lb = &g_recording.surface;
+    BOOL fresh = !lb->hBitmap || lb->width != width || lb->height != height;
+    if (!LayeredBitmap_Ensure(lb, width, height)) {
+        Logger_Log("UpdateBorderBitmapColored: LayeredBitmap_Ensure failed (%dx%d)\n", width, height);
         return;
     }
     
-    BYTE a = 255;
-    
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            BOOL isBorder = (x < BORDER_THICKNESS || x >= width - BORDER_THICKNESS ||
-                            y < BORDER_THICKNESS || y >= height - BORDER_THICKNESS);
-            
-            if (isBorder) {
-                int idx = (y * width + x) * 4;
-                // Pre-multiplied alpha for UpdateLayeredWindow
-                lb.pixels[idx + 0] = (BYTE)(b * a / 255); // Blue
-                lb.pixels[idx + 1] = (BYTE)(g * a / 255); // Green
-                lb.pixels[idx + 2] = (BYTE)(r * a / 255); // Red
-                lb.pixels[idx + 3] = a;                    // Alpha
+    COLORREF color = RGB(r, g, b);
+    if (fresh || color != g_recording.surfaceColor) {
+        // Opaque, so premultiplied alpha is the colour itself
+        DWORD pixel = 0xFF000000u | ((DWORD)r << 16) | ((DWORD)g << 8) | (DWORD)b;
+        int t = BORDER_THICKNESS;
+        for (int y = 0; y < height; y++) {
+            DWORD* row = (DWORD*)lb->pixels + (size_t)y * width;
+            if (y < t || y >= height - t) {
+                for (int x = 0; x < width; x++) row[x] = pixel;
+            } else {
+                for (int x = 0; x < t && x < width; x++) row[x] = pixel;
+                for (int x = (width - t > t ? width - t : t); x < width; x++) row[x] = pixel;
             }
         }
+        g_recording.surfaceColor = color;
+        LayeredBitmap_Invalidate(lb, NULL);
     }
     
-    LayeredBitmap_Apply(&lb, g_recording.wnd, g_recording.currentRect.left, g_recording.currentRect.top);
-    LayeredBitmap_Destroy(&lb);
+    LayeredBitmap_Present(lb, g_recording.wnd, g_recording.currentRect.left, g_recording.currentRect.top);
 }
 
 // Create and set a 32-bit ARGB bitmap for the border with transparency
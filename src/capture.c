@@ -7,6 +7,26 @@
 #include "mem_utils.h"
 #include "logger.h"
 
+// Interfaces newer than the d3d11.lib / dxgi.lib import GUIDs
+static const GUID IID_IDXGIFactory1_Local =
+    {0x770aae78, 0xf26f, 0x4dba, {0xa8, 0x29, 0x25, 0x3c, 0x83, 0xd1, 0xb3, 0x87}};
+static const GUID IID_IDXGIResource1_Local =
+    {0x30961379, 0x4609, 0x4a41, {0x99, 0x8e, 0x54, 0xfe, 0x56, 0x7e, 0xe0, 0xc1}};
+static const GUID IID_ID3D11Device1_Local =
+    {0xa04bfb29, 0x08ef, 0x43d6, {0xa4, 0x9c, 0xa9, 0xbd, 0xbd, 0xcb, 0xe6, 0x86}};
+static const GUID IID_ID3D11Device3_Local =
+    {0xa05c8c37, 0xd2c6, 0x4732, {0xb3, 0xa0, 0x9c, 0xe0, 0xb0, 0xdc, 0x9a, 0xe6}};
+static const GUID IID_ID3D11Device5_Local =
+    {0x8ffde202, 0xa0e7, 0x45df, {0x9e, 0x01, 0xe8, 0x37, 0x80, 0x1b, 0x5e, 0xa0}};
+static const GUID IID_ID3D11DeviceContext4_Local =
+    {0x917600da, 0xf58c, 0x4c33, {0x98, 0xd8, 0x3e, 0x15, 0xb3, 0x90, 0xfa, 0x24}};
+static const GUID IID_ID3D11Fence_Local =
+    {0xaffde9d1, 0x1df7, 0x4bb7, {0x8a, 0x34, 0x0f, 0x46, 0x25, 0x1d, 0xab, 0x80}};
+static const GUID IID_ID3D11DeviceContext1_Local =
+    {0xbb2c6faa, 0xb5fb, 0x4082, {0x8e, 0x6b, 0x38, 0x8b, 0x8c, 0xfa, 0x90, 0xe1}};
+
+#define PCI_VENDOR_NVIDIA 0x10DE
+
 // Monitor enumeration data
 typedef struct {
     int targetIndex;
@@ -144,6 +164,167 @@ static void ReleaseDuplication(CaptureState* state) {
     SAFE_RELEASE(state->duplication);
 }
 
+static void ReleaseBridge(CaptureBridge* bridge) {
+    SAFE_RELEASE(bridge->encodeTexture);
+    SAFE_RELEASE(bridge->dupTexture);
+    SAFE_RELEASE(bridge->copiedFenceEncode);
+    SAFE_RELEASE(bridge->copiedFence);
+    SAFE_RELEASE(bridge->consumedFenceDup);
+    SAFE_RELEASE(bridge->consumedFence);
+    SAFE_RELEASE(bridge->encodeContext4);
+    SAFE_RELEASE(bridge->dupContext4);
+    ZeroMemory(bridge, sizeof(*bridge));
+}
+
+// Release the BGRA texture ring (recreated lazily on the next frame), and
+// the cross-adapter bridge, which is sized like it
+static void ReleaseTextureRing(CaptureState* state) {
+    for (int i = 0; i < GPU_TEXTURE_RING_MAX; i++) {
+        SAFE_RELEASE(state->syntheticViews[i]);
+        SAFE_RELEASE(state->gpuTextureRing[i]);
+    }
+    state->gpuTexture = NULL;  // Alias of a ring slot, released above
+    state->gpuRingIndex = 0;
+    ReleaseBridge(&state->bridge);
+}
+
+// Create a shareable fence on `owner` and open it on `other`
+static BOOL CreateSharedFencePair(ID3D11Device5* owner, ID3D11Device5* other,
+                                  ID3D11Fence** outFence, ID3D11Fence** outOpened) {
+    HANDLE handle = NULL;
+    HRESULT hr = owner->lpVtbl->CreateFence(owner, 0,
+                                            D3D11_FENCE_FLAG_SHARED | D3D11_FENCE_FLAG_SHARED_CROSS_ADAPTER,
+                                            &IID_ID3D11Fence_Local, (void**)outFence);
+    if (SUCCEEDED(hr)) {
+        hr = (*outFence)->lpVtbl->CreateSharedHandle(*outFence, NULL, GENERIC_ALL, NULL, &handle);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = other->lpVtbl->OpenSharedFence(other, handle, &IID_ID3D11Fence_Local, (void**)outOpened);
+    }
+    SAFE_CLOSE_HANDLE(handle);
+    return SUCCEEDED(hr);
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: CreateBridge
+ * Resources: shared texture + its encode-side view, two fence pairs, two
+ *            ID3D11DeviceContext4 references
+ * Pattern: goto-cleanup; built in a local CaptureBridge and committed to
+ *          state->bridge only when every step succeeded
+ */
+static BOOL CreateBridge(CaptureState* state, int width, int height, DXGI_FORMAT format) {
+    BOOL result = FALSE;
+    CaptureBridge bridge = {0};
+    ID3D11Device3* dup3 = NULL;
+    ID3D11Device1* encode1 = NULL;
+    ID3D11Device5* dup5 = NULL;
+    ID3D11Device5* encode5 = NULL;
+    IDXGIResource1* resource = NULL;
+    HANDLE handle = NULL;
+    
+    HRESULT hr = state->dupDevice->lpVtbl->QueryInterface(state->dupDevice, &IID_ID3D11Device3_Local, (void**)&dup3);
+    if (SUCCEEDED(hr)) hr = state->dupDevice->lpVtbl->QueryInterface(state->dupDevice, &IID_ID3D11Device5_Local, (void**)&dup5);
+    if (SUCCEEDED(hr)) hr = state->device->lpVtbl->QueryInterface(state->device, &IID_ID3D11Device1_Local, (void**)&encode1);
+    if (SUCCEEDED(hr)) hr = state->device->lpVtbl->QueryInterface(state->device, &IID_ID3D11Device5_Local, (void**)&encode5);
+    if (SUCCEEDED(hr)) {
+        hr = state->dupContext->lpVtbl->QueryInterface(state->dupContext, &IID_ID3D11DeviceContext4_Local,
+                                                       (void**)&bridge.dupContext4);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = state->context->lpVtbl->QueryInterface(state->context, &IID_ID3D11DeviceContext4_Local,
+                                                    (void**)&bridge.encodeContext4);
+    }
+    if (FAILED(hr)) {
+        Logger_Log("Capture: cross-adapter bridge needs D3D11.4 on both devices (0x%08X)\n", hr);
+        goto cleanup;
+    }
+    
+    // Copy-only: the encode side copies it into its own ring texture at once
+    D3D11_TEXTURE2D_DESC1 desc = {0};
+    desc.Width = width;
+    desc.Height = height;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = format;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+    desc.TextureLayout = D3D11_TEXTURE_LAYOUT_ROW_MAJOR;
+    hr = dup3->lpVtbl->CreateTexture2D1(dup3, &desc, NULL, (ID3D11Texture2D1**)&bridge.dupTexture);
+    if (SUCCEEDED(hr)) {
+        hr = bridge.dupTexture->lpVtbl->QueryInterface(bridge.dupTexture, &IID_IDXGIResource1_Local, (void**)&resource);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = resource->lpVtbl->CreateSharedHandle(resource, NULL,
+                                                  DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE,
+                                                  NULL, &handle);
+    }
+    if (SUCCEEDED(hr)) {
+        hr = encode1->lpVtbl->OpenSharedResource1(encode1, handle, &IID_ID3D11Texture2D,
+                                                  (void**)&bridge.encodeTexture);
+    }
+    if (FAILED(hr)) {
+        Logger_Log("Capture: cross-adapter texture %dx%d failed (0x%08X)\n", width, height, hr);
+        goto cleanup;
+    }
+    
+    if (!CreateSharedFencePair(dup5, encode5, &bridge.copiedFence, &bridge.copiedFenceEncode) ||
+        !CreateSharedFencePair(encode5, dup5, &bridge.consumedFence, &bridge.consumedFenceDup)) {
+        Logger_Log("Capture: cross-adapter fences failed\n");
+        goto cleanup;
+    }
+    
+    bridge.width = width;
+    bridge.height = height;
+    bridge.format = format;
+    ReleaseBridge(&state->bridge);
+    state->bridge = bridge;
+    ZeroMemory(&bridge, sizeof(bridge));  // ownership transferred
+    result = TRUE;
+    
+cleanup:
+    ReleaseBridge(&bridge);
+    SAFE_CLOSE_HANDLE(handle);
+    SAFE_RELEASE(resource);
+    SAFE_RELEASE(encode5);
+    SAFE_RELEASE(encode1);
+    SAFE_RELEASE(dup5);
+    SAFE_RELEASE(dup3);
+    return result;
+}
+
+// Cross-adapter mode: make sure the bridge matches the capture size and
+// the desktop format, and order the coming writes to it after the encode
+// device has read the previous image (a GPU-side wait)
+static BOOL BeginBridgeWrite(CaptureState* state, DXGI_FORMAT format) {
+    CaptureBridge* bridge = &state->bridge;
+    if (!bridge->dupTexture || bridge->width != state->captureWidth ||
+        bridge->height != state->captureHeight || bridge->format != format) {
+        if (!CreateBridge(state, state->captureWidth, state->captureHeight, format)) return FALSE;
+    }
+    if (bridge->fenceValue > 0) {
+        bridge->dupContext4->lpVtbl->Wait(bridge->dupContext4, bridge->consumedFenceDup, bridge->fenceValue);
+    }
+    return TRUE;
+}
+
+// Cross-adapter mode: hand what was just written to the bridge over to the
+// encode device, into ring texture `dest`. Both flushes are needed so each
+// GPU sees the other's signal without waiting for unrelated work.
+static void FinishBridgeWrite(CaptureState* state, ID3D11Texture2D* dest) {
+    CaptureBridge* bridge = &state->bridge;
+    UINT64 value = ++bridge->fenceValue;
+    
+    bridge->dupContext4->lpVtbl->Signal(bridge->dupContext4, bridge->copiedFence, value);
+    state->dupContext->lpVtbl->Flush(state->dupContext);
+    
+    bridge->encodeContext4->lpVtbl->Wait(bridge->encodeContext4, bridge->copiedFenceEncode, value);
+    state->context->lpVtbl->CopyResource(state->context, (ID3D11Resource*)dest,
+                                         (ID3D11Resource*)bridge->encodeTexture);
+    bridge->encodeContext4->lpVtbl->Signal(bridge->encodeContext4, bridge->consumedFence, value);
+    state->context->lpVtbl->Flush(state->context);
+}
+
 // Initialize desktop duplication for a specific DXGI output index.
 // All writes to `state` are deferred until every step has succeeded, so a
 // partial failure leaves the caller's prior state intact.
@@ -173,7 +354,7 @@ static BOOL InitDuplicationForOutput(CaptureState* state, IDXGIAdapter* adapter,
     desiredMode.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
     
     DXGI_MODE_DESC closestMode = {0};
-    hr = dxgiOutput->lpVtbl->FindClosestMatchingMode(dxgiOutput, &desiredMode, &closestMode, (IUnknown*)state->device);
+    hr = dxgiOutput->lpVtbl->FindClosestMatchingMode(dxgiOutput, &desiredMode, &closestMode, (IUnknown*)state->dupDevice);
     if (SUCCEEDED(hr) && closestMode.RefreshRate.Denominator > 0) {
         localRefreshRate = closestMode.RefreshRate.Numerator / closestMode.RefreshRate.Denominator;
     }
@@ -184,7 +365,7 @@ static BOOL InitDuplicationForOutput(CaptureState* state, IDXGIAdapter* adapter,
         goto cleanup;
     }
     
-    hr = dxgiOutput1->lpVtbl->DuplicateOutput(dxgiOutput1, (IUnknown*)state->device, &newDuplication);
+    hr = dxgiOutput1->lpVtbl->DuplicateOutput(dxgiOutput1, (IUnknown*)state->dupDevice, &newDuplication);
     if (FAILED(hr)) {
         Logger_Log("InitDuplicationForOutput: DuplicateOutput failed (0x%08X)\n", hr);
         goto cleanup;
@@ -289,66 +470,304 @@ static int FindOutputForRegion(IDXGIAdapter* adapter, RECT region) {
     return bestOutput;
 }
 
-BOOL Capture_Init(CaptureState* state) {
-    // Precondition
-    LWSR_ASSERT(state != NULL);
+// Count the outputs of this adapter that the region overlaps
+static int CountOutputsForRegion(IDXGIAdapter* adapter, RECT region) {
+    int count = 0;
+    for (int i = 0; i < LWSR_MAX_MONITORS; i++) {
+        IDXGIOutput* output = NULL;
+        if (FAILED(adapter->lpVtbl->EnumOutputs(adapter, i, &output))) break;
+        
+        DXGI_OUTPUT_DESC desc = {0};
+        HRESULT hr = output->lpVtbl->GetDesc(output, &desc);
+        output->lpVtbl->Release(output);
+        
+        RECT overlap;
+        if (SUCCEEDED(hr) && IntersectRect(&overlap, &region, &desc.DesktopCoordinates)) count++;
+    }
+    return count;
+}
+
+// Release composite-mode duplications
+static void ReleaseComposite(CaptureState* state) {
+    for (int i = 0; i < state->compositeCount; i++) {
+        SAFE_RELEASE(state->compositeSources[i].duplication);
+    }
+    state->compositeCount = 0;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: BindComposite
+ * Resources: one IDXGIOutputDuplication per output the region overlaps
+ * Pattern: goto-cleanup; duplications are built in a local array and only
+ *          committed to `state` once every output has bound
+ * Init: local sources zeroed
+ */
+static BOOL BindComposite(CaptureState* state, RECT region) {
+    BOOL result = FALSE;
+    CaptureCompositeSource sources[LWSR_MAX_MONITORS] = {0};
+    RECT partAbs[LWSR_MAX_MONITORS] = {0};      // Desktop coordinates of each part
+    POINT origin[LWSR_MAX_MONITORS] = {0};      // Desktop origin of each output
+    int count = 0;
+    RECT bounds = {0};                          // Union of the overlapped outputs
+    RECT clamped = {0};                         // Union of the parts
     
-    if (!state) return FALSE;
+    for (int i = 0; i < LWSR_MAX_MONITORS; i++) {
+        IDXGIOutput* output = NULL;
+        IDXGIOutput1* output1 = NULL;
+        if (FAILED(state->adapter->lpVtbl->EnumOutputs(state->adapter, i, &output))) break;
+        
+        DXGI_OUTPUT_DESC desc = {0};
+        HRESULT hr = output->lpVtbl->GetDesc(output, &desc);
+        RECT part;
+        if (FAILED(hr) || !IntersectRect(&part, &region, &desc.DesktopCoordinates)) {
+            output->lpVtbl->Release(output);
+            continue;
+        }
+        
+        hr = output->lpVtbl->QueryInterface(output, &IID_IDXGIOutput1, (void**)&output1);
+        if (SUCCEEDED(hr)) {
+            hr = output1->lpVtbl->DuplicateOutput(output1, (IUnknown*)state->dupDevice,
+                                                  &sources[count].duplication);
+        }
+        SAFE_RELEASE(output1);
+        output->lpVtbl->Release(output);
+        if (FAILED(hr)) {
+            Logger_Log("BindComposite: DuplicateOutput[%d] failed (0x%08X)\n", i, hr);
+            goto cleanup;
+        }
+        
+        partAbs[count] = part;
+        origin[count].x = desc.DesktopCoordinates.left;
+        origin[count].y = desc.DesktopCoordinates.top;
+        UnionRect(&bounds, &bounds, &desc.DesktopCoordinates);
+        UnionRect(&clamped, &clamped, &part);
+        count++;
+    }
     
-    BOOL result = FALSE;
-    IDXGIDevice* dxgiDevice = NULL;
+    if (count == 0) goto cleanup;
     
-    ZeroMemory(state, sizeof(CaptureState));
+    // Even dimensions (NV12), anchored at the region's top-left
+    int width = (clamped.right - clamped.left) & ~1;
+    int height = (clamped.bottom - clamped.top) & ~1;
+    RECT captureRect = { clamped.left, clamped.top, clamped.left + width, clamped.top + height };
+    
+    for (int i = 0; i < count; i++) {
+        RECT part;
+        IntersectRect(&part, &partAbs[i], &captureRect);  // drop the trimmed edge
+        sources[i].dest.x = part.left - captureRect.left;
+        sources[i].dest.y = part.top - captureRect.top;
+        OffsetRect(&part, -origin[i].x, -origin[i].y);
+        sources[i].srcRect = part;
+    }
     
-    // Create D3D11 device
+    // All outputs bound — commit to state
+    ReleaseDuplication(state);
+    ReleaseComposite(state);
+    ReleaseTextureRing(state);
+    for (int i = 0; i < count; i++) {
+        state->compositeSources[i] = sources[i];
+        sources[i].duplication = NULL;  // ownership transferred
+    }
+    state->compositeCount = count;
+    state->outputDesc.DesktopCoordinates = bounds;
+    state->monitorWidth = bounds.right - bounds.left;
+    state->monitorHeight = bounds.bottom - bounds.top;
+    state->captureRect = captureRect;
+    state->captureWidth = width;
+    state->captureHeight = height;
+    state->forceFullFrame = TRUE;
+    result = TRUE;
+    
+    Logger_Log("Capture: composite region %ld,%ld %dx%d across %d outputs\n",
+               captureRect.left, captureRect.top, width, height, count);
+    
+cleanup:
+    for (int i = 0; i < count; i++) {
+        SAFE_RELEASE(sources[i].duplication);
+    }
+    return result;
+}
+
+static BOOL CreateDeviceOnAdapter(IDXGIAdapter* adapter, ID3D11Device** outDevice,
+                                  ID3D11DeviceContext** outContext) {
     D3D_FEATURE_LEVEL featureLevels[] = { D3D_FEATURE_LEVEL_11_0 };
     D3D_FEATURE_LEVEL featureLevel;
     
+    // An explicit adapter requires the UNKNOWN driver type
     HRESULT hr = D3D11CreateDevice(
-        NULL,
-        D3D_DRIVER_TYPE_HARDWARE,
+        adapter,
+        D3D_DRIVER_TYPE_UNKNOWN,
         NULL,
         0,
         featureLevels,
         1,
         D3D11_SDK_VERSION,
-        &state->device,
+        outDevice,
         &featureLevel,
-        &state->context
+        outContext
     );
     
     if (FAILED(hr)) {
         Logger_Log("Capture_Init: D3D11CreateDevice failed (0x%08X)\n", hr);
-        goto cleanup;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL SameAdapter(IDXGIAdapter* a, IDXGIAdapter* b) {
+    DXGI_ADAPTER_DESC da = {0}, db = {0};
+    if (a == b) return TRUE;
+    if (FAILED(a->lpVtbl->GetDesc(a, &da)) || FAILED(b->lpVtbl->GetDesc(b, &db))) return FALSE;
+    return da.AdapterLuid.LowPart == db.AdapterLuid.LowPart &&
+           da.AdapterLuid.HighPart == db.AdapterLuid.HighPart;
+}
+
+// The adapter and output index of the primary monitor (the output at the
+// desktop origin), or the first output found. Caller releases *outAdapter.
+static BOOL FindPrimaryOutput(IDXGIFactory1* factory, IDXGIAdapter1** outAdapter, int* outIndex) {
+    *outAdapter = NULL;
+    *outIndex = 0;
+    
+    IDXGIAdapter1* adapter = NULL;
+    for (UINT a = 0; factory->lpVtbl->EnumAdapters1(factory, a, &adapter) != DXGI_ERROR_NOT_FOUND; a++) {
+        for (int i = 0; i < LWSR_MAX_MONITORS; i++) {
+            IDXGIOutput* output = NULL;
+            if (FAILED(adapter->lpVtbl->EnumOutputs(adapter, i, &output))) break;
+            
+            DXGI_OUTPUT_DESC desc = {0};
+            HRESULT hr = output->lpVtbl->GetDesc(output, &desc);
+            output->lpVtbl->Release(output);
+            POINT origin = {0, 0};
+            BOOL primary = SUCCEEDED(hr) && PtInRect(&desc.DesktopCoordinates, origin);
+            
+            if (primary || !*outAdapter) {
+                if (*outAdapter != adapter) {
+                    SAFE_RELEASE(*outAdapter);
+                    adapter->lpVtbl->AddRef(adapter);
+                    *outAdapter = adapter;
+                }
+                *outIndex = i;
+            }
+            if (primary) {
+                adapter->lpVtbl->Release(adapter);
+                return TRUE;
+            }
+        }
+        adapter->lpVtbl->Release(adapter);
     }
+    return *outAdapter != NULL;
+}
+
+// First NVIDIA adapter (NVENC), or NULL. Caller releases.
+static IDXGIAdapter1* FindEncodeAdapter(IDXGIFactory1* factory) {
+    IDXGIAdapter1* adapter = NULL;
+    for (UINT a = 0; factory->lpVtbl->EnumAdapters1(factory, a, &adapter) != DXGI_ERROR_NOT_FOUND; a++) {
+        DXGI_ADAPTER_DESC1 desc = {0};
+        if (SUCCEEDED(adapter->lpVtbl->GetDesc1(adapter, &desc)) &&
+            desc.VendorId == PCI_VENDOR_NVIDIA && !(desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE)) {
+            return adapter;
+        }
+        adapter->lpVtbl->Release(adapter);
+    }
+    return NULL;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: Capture_Init
+ * Resources: DXGI factory and adapters (local), encode device + context,
+ *            duplication device + context (a second reference to the
+ *            encode pair unless cross-adapter), duplication adapter
+ * Pattern: goto-cleanup; on failure everything in `state` is released
+ */
+BOOL Capture_Init(CaptureState* state) {
+    // Precondition
+    LWSR_ASSERT(state != NULL);
+    
+    if (!state) return FALSE;
+    
+    BOOL result = FALSE;
+    IDXGIFactory1* factory = NULL;
+    IDXGIAdapter1* dupAdapter = NULL;
+    IDXGIAdapter1* encodeAdapter = NULL;
+    int outputIndex = 0;
+    
+    ZeroMemory(state, sizeof(CaptureState));
     
-    // Get DXGI device
-    hr = state->device->lpVtbl->QueryInterface(state->device, &IID_IDXGIDevice, (void**)&dxgiDevice);
+    HRESULT hr = CreateDXGIFactory1(&IID_IDXGIFactory1_Local, (void**)&factory);
     if (FAILED(hr)) {
-        Logger_Log("Capture_Init: QueryInterface IDXGIDevice failed (0x%08X)\n", hr);
+        Logger_Log("Capture_Init: CreateDXGIFactory1 failed (0x%08X)\n", hr);
         goto cleanup;
     }
     
-    // Get DXGI adapter and store it
-    hr = dxgiDevice->lpVtbl->GetAdapter(dxgiDevice, &state->adapter);
-    if (FAILED(hr)) {
-        Logger_Log("Capture_Init: GetAdapter failed (0x%08X)\n", hr);
+    if (!FindPrimaryOutput(factory, &dupAdapter, &outputIndex)) {
+        Logger_Log("Capture_Init: no adapter has a display output\n");
         goto cleanup;
     }
     
-    // Initialize with primary output (output 0)
-    if (!InitDuplicationForOutput(state, state->adapter, 0)) goto cleanup;
+    // Frames are consumed (converted, encoded) on the NVENC adapter; the
+    // output is duplicated on the adapter it is attached to
+    encodeAdapter = FindEncodeAdapter(factory);
+    if (!encodeAdapter) {
+        dupAdapter->lpVtbl->AddRef(dupAdapter);
+        encodeAdapter = dupAdapter;
+    }
+    
+    if (!CreateDeviceOnAdapter((IDXGIAdapter*)encodeAdapter, &state->device, &state->context)) goto cleanup;
+    
+    if (!SameAdapter((IDXGIAdapter*)encodeAdapter, (IDXGIAdapter*)dupAdapter)) {
+        if (!CreateDeviceOnAdapter((IDXGIAdapter*)dupAdapter, &state->dupDevice, &state->dupContext)) goto cleanup;
+        
+        // Check that the two adapters can share a texture before committing to it
+        if (CreateBridge(state, 64, 64, DXGI_FORMAT_B8G8R8A8_UNORM)) {
+            ReleaseBridge(&state->bridge);
+            state->crossAdapter = TRUE;
+        } else {
+            // Everything on the output's adapter, as without a second GPU
+            Logger_Log("Capture_Init: cross-adapter sharing unavailable, encoding on the display adapter\n");
+            SAFE_RELEASE(state->context);
+            SAFE_RELEASE(state->device);
+            state->device = state->dupDevice;
+            state->context = state->dupContext;
+            state->dupDevice = NULL;
+            state->dupContext = NULL;
+        }
+    }
+    if (!state->crossAdapter) {
+        state->device->lpVtbl->AddRef(state->device);
+        state->context->lpVtbl->AddRef(state->context);
+        state->dupDevice = state->device;
+        state->dupContext = state->context;
+    }
+    
+    {
+        DXGI_ADAPTER_DESC1 dupDesc = {0}, encodeDesc = {0};
+        dupAdapter->lpVtbl->GetDesc1(dupAdapter, &dupDesc);
+        encodeAdapter->lpVtbl->GetDesc1(encodeAdapter, &encodeDesc);
+        Logger_Log("Capture: duplicating output %d on %ls%s%ls\n", outputIndex, dupDesc.Description,
+                   state->crossAdapter ? ", encoding on " : "",
+                   state->crossAdapter ? encodeDesc.Description : L"");
+    }
+    
+    state->adapter = (IDXGIAdapter*)dupAdapter;
+    dupAdapter = NULL;  // ownership transferred
+    
+    if (!InitDuplicationForOutput(state, state->adapter, outputIndex)) goto cleanup;
     
     state->initialized = TRUE;
     result = TRUE;
     
 cleanup:
-    SAFE_RELEASE(dxgiDevice);
+    SAFE_RELEASE(encodeAdapter);
+    SAFE_RELEASE(dupAdapter);
+    SAFE_RELEASE(factory);
     
     if (!result) {
         SAFE_RELEASE(state->adapter);
+        SAFE_RELEASE(state->dupContext);
+        SAFE_RELEASE(state->dupDevice);
         SAFE_RELEASE(state->context);
         SAFE_RELEASE(state->device);
+        state->crossAdapter = FALSE;
     }
     
     return result;
@@ -363,9 +782,28 @@ BOOL Capture_SetRegion(CaptureState* state, RECT region) {
     if (!state) return FALSE;
     if (!state->initialized) return FALSE;
     
+    // Synthetic source: no outputs involved, the pattern keeps its size
+    if (state->syntheticWidth > 0) {
+        SetRect(&state->captureRect, region.left, region.top,
+                region.left + state->syntheticWidth, region.top + state->syntheticHeight);
+        return TRUE;
+    }
+    
+    // Region spans several outputs: one duplication per output, composited
+    if (CountOutputsForRegion(state->adapter, region) > 1) {
+        return BindComposite(state, region);
+    }
+    
+    // Leaving composite mode: always rebind a single duplication below
+    BOOL wasComposite = state->compositeCount > 0;
+    if (wasComposite) {
+        ReleaseComposite(state);
+        ReleaseTextureRing(state);
+    }
+    
     // Check if region is on a different monitor than current
     int targetOutput = FindOutputForRegion(state->adapter, region);
-    if (targetOutput != state->monitorIndex) {
+    if (wasComposite || targetOutput != state->monitorIndex) {
         // Refuse to follow the rect to a different physical monitor once we've
         // locked an identity. Without this gate, a topology change that shuffled
         // DXGI indices would let the recorder silently re-bind to whatever
@@ -400,9 +838,9 @@ BOOL Capture_SetRegion(CaptureState* state, RECT region) {
     int newWidth = (state->captureRect.right - state->captureRect.left) & ~1;
     int newHeight = (state->captureRect.bottom - state->captureRect.top) & ~1;
     
-    // Release GPU texture if dimensions changed (will be recreated on next frame)
+    // Release GPU textures if dimensions changed (will be recreated on next frame)
     if (state->gpuTexture && (newWidth != state->captureWidth || newHeight != state->captureHeight)) {
-        SAFE_RELEASE(state->gpuTexture);
+        ReleaseTextureRing(state);
     }
     
     state->captureWidth = newWidth;
@@ -410,6 +848,10 @@ BOOL Capture_SetRegion(CaptureState* state, RECT region) {
     state->captureRect.right = state->captureRect.left + state->captureWidth;
     state->captureRect.bottom = state->captureRect.top + state->captureHeight;
     
+    // Region may have moved without a size change; dirty rects from the next
+    // frame only describe desktop changes, not our new crop
+    state->forceFullFrame = TRUE;
+    
     // Reallocate frame buffer if needed
     size_t newSize = (size_t)state->captureWidth * state->captureHeight * BYTES_PER_PIXEL_BGRA;
     if (newSize > state->frameBufferSize) {
@@ -434,6 +876,7 @@ BOOL Capture_SetMonitor(CaptureState* state, int monitorIndex) {
     LWSR_ASSERT(monitorIndex >= 0);
     
     if (!state) return FALSE;
+    if (state->syntheticWidth > 0) return state->initialized;
     
     // NOTE: `monitorIndex` here is in GDI EnumDisplayMonitors order. Capture_SetRegion
     // (called below) then resolves the matching DXGI output via FindOutputForRegion,
@@ -495,8 +938,8 @@ static void CopyCaptureRegionAndRelease(CaptureState* state,
     srcBox.front = 0;
     srcBox.back = 1;
     
-    state->context->lpVtbl->CopySubresourceRegion(
-        state->context,
+    state->dupContext->lpVtbl->CopySubresourceRegion(
+        state->dupContext,
         (ID3D11Resource*)destTexture, 0, 0, 0, 0,
         (ID3D11Resource*)desktopTexture, 0, &srcBox);
     
@@ -555,7 +998,7 @@ BYTE* Capture_GetFrame(CaptureState* state, UINT64* timestamp) {
         stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
         stagingDesc.MiscFlags = 0;
         
-        hr = state->device->lpVtbl->CreateTexture2D(state->device, &stagingDesc, NULL, &state->stagingTexture);
+        hr = state->dupDevice->lpVtbl->CreateTexture2D(state->dupDevice, &stagingDesc, NULL, &state->stagingTexture);
         if (FAILED(hr)) {
             desktopTexture->lpVtbl->Release(desktopTexture);
             state->duplication->lpVtbl->ReleaseFrame(state->duplication);
@@ -567,12 +1010,12 @@ BYTE* Capture_GetFrame(CaptureState* state, UINT64* timestamp) {
     
     // Map staging texture to CPU memory
     D3D11_MAPPED_SUBRESOURCE mapped = {0};
-    hr = state->context->lpVtbl->Map(state->context, (ID3D11Resource*)state->stagingTexture,
-                                      0, D3D11_MAP_READ, 0, &mapped);
+    hr = state->dupContext->lpVtbl->Map(state->dupContext, (ID3D11Resource*)state->stagingTexture,
+                                         0, D3D11_MAP_READ, 0, &mapped);
     if (FAILED(hr)) return NULL;
     
     if (!state->frameBuffer) {
-        state->context->lpVtbl->Unmap(state->context, (ID3D11Resource*)state->stagingTexture, 0);
+        state->dupContext->lpVtbl->Unmap(state->dupContext, (ID3D11Resource*)state->stagingTexture, 0);
         return NULL;
     }
     
@@ -586,7 +1029,7 @@ BYTE* Capture_GetFrame(CaptureState* state, UINT64* timestamp) {
         dst += rowBytes;
     }
     
-    state->context->lpVtbl->Unmap(state->context, (ID3D11Resource*)state->stagingTexture, 0);
+    state->dupContext->lpVtbl->Unmap(state->dupContext, (ID3D11Resource*)state->stagingTexture, 0);
     
     state->lastFrameTime = frameInfo.LastPresentTime.QuadPart;
     if (timestamp) *timestamp = state->lastFrameTime;
@@ -594,10 +1037,312 @@ BYTE* Capture_GetFrame(CaptureState* state, UINT64* timestamp) {
     return state->frameBuffer;
 }
 
+// Grow the metadata scratch buffer to at least `size` bytes
+static BOOL EnsureMetadataBuffer(CaptureState* state, UINT size) {
+    if (size <= state->metadataBufferSize) return TRUE;
+    BYTE* newBuffer = (BYTE*)malloc(size);
+    if (!newBuffer) return FALSE;
+    free(state->metadataBuffer);
+    state->metadataBuffer = newBuffer;
+    state->metadataBufferSize = size;
+    return TRUE;
+}
+
+// Add `rect` (output-relative desktop coordinates) to the change bounds if it
+// overlaps the capture region. Returns TRUE if it did.
+static BOOL AccumulateChangeRect(const RECT* captureLocal, const RECT* rect, RECT* bounds) {
+    RECT hit;
+    if (!IntersectRect(&hit, rect, captureLocal)) return FALSE;
+    OffsetRect(&hit, -captureLocal->left, -captureLocal->top);
+    UnionRect(bounds, bounds, &hit);
+    return TRUE;
+}
+
+// Fill state->lastChange from the acquired frame's metadata. Any failure to
+// read the rects is reported as a full-frame change (never a false "static").
+static void ReadFrameChange(CaptureState* state, const DXGI_OUTDUPL_FRAME_INFO* info) {
+    CaptureFrameChange* change = &state->lastChange;
+    ZeroMemory(change, sizeof(*change));
+    change->accumulatedFrames = info->AccumulatedFrames;
+    
+    // Pointer-only update: desktop image is unchanged
+    if (info->AccumulatedFrames == 0) return;
+    
+    RECT captureLocal = state->captureRect;
+    OffsetRect(&captureLocal, -state->outputDesc.DesktopCoordinates.left,
+               -state->outputDesc.DesktopCoordinates.top);
+    
+    BOOL ok = info->TotalMetadataBufferSize > 0 &&
+              EnsureMetadataBuffer(state, info->TotalMetadataBufferSize);
+    
+    // Move rects first; dirty rects go in the remainder of the buffer
+    UINT moveBytes = 0;
+    if (ok) {
+        ok = SUCCEEDED(state->duplication->lpVtbl->GetFrameMoveRects(
+            state->duplication, state->metadataBufferSize,
+            (DXGI_OUTDUPL_MOVE_RECT*)state->metadataBuffer, &moveBytes));
+    }
+    if (ok) {
+        const DXGI_OUTDUPL_MOVE_RECT* moves = (const DXGI_OUTDUPL_MOVE_RECT*)state->metadataBuffer;
+        UINT moveCount = moveBytes / sizeof(DXGI_OUTDUPL_MOVE_RECT);
+        for (UINT i = 0; i < moveCount; i++) {
+            if (AccumulateChangeRect(&captureLocal, &moves[i].DestinationRect, &change->dirtyBounds)) {
+                change->moveRectCount++;
+            }
+        }
+    }
+    
+    UINT dirtyBytes = 0;
+    RECT* dirty = (RECT*)(state->metadataBuffer + moveBytes);
+    if (ok) {
+        ok = SUCCEEDED(state->duplication->lpVtbl->GetFrameDirtyRects(
+            state->duplication, state->metadataBufferSize - moveBytes, dirty, &dirtyBytes));
+    }
+    if (ok) {
+        UINT dirtyCount = dirtyBytes / sizeof(RECT);
+        for (UINT i = 0; i < dirtyCount; i++) {
+            if (AccumulateChangeRect(&captureLocal, &dirty[i], &change->dirtyBounds)) {
+                change->dirtyRectCount++;
+            }
+        }
+    }
+    
+    if (!ok) {
+        change->dirtyRectCount = 0;
+        change->moveRectCount = 0;
+        SetRect(&change->dirtyBounds, 0, 0, state->captureWidth, state->captureHeight);
+    }
+    change->changed = !ok || (change->dirtyRectCount + change->moveRectCount) > 0;
+}
+
+const CaptureFrameChange* Capture_GetLastChange(const CaptureState* state) {
+    LWSR_ASSERT(state != NULL);
+    return &state->lastChange;
+}
+
+// Create the ring texture for `slot` if it doesn't exist yet
+static BOOL EnsureRingTexture(CaptureState* state, int slot, DXGI_FORMAT format) {
+    if (state->gpuTextureRing[slot]) return TRUE;
+    
+    D3D11_TEXTURE2D_DESC gpuDesc = {0};
+    gpuDesc.Width = state->captureWidth;
+    gpuDesc.Height = state->captureHeight;
+    gpuDesc.MipLevels = 1;
+    gpuDesc.ArraySize = 1;
+    gpuDesc.Format = format;  // BGRA
+    gpuDesc.SampleDesc.Count = 1;
+    gpuDesc.Usage = D3D11_USAGE_DEFAULT;
+    gpuDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    gpuDesc.CPUAccessFlags = 0;
+    gpuDesc.MiscFlags = 0;
+    
+    HRESULT hr = state->device->lpVtbl->CreateTexture2D(state->device, &gpuDesc, NULL, &state->gpuTextureRing[slot]);
+    return SUCCEEDED(hr);
+}
+
+// Composite mode: poll every output with a zero timeout, so an idle monitor
+// never delays the others, and copy each updated output's part into the
+// next ring texture. Parts that did not update are carried over from the
+// previous ring texture (cross-adapter: the parts land in the bridge, which
+// still holds the previous composite, and the whole of it is handed over).
+static ID3D11Texture2D* GetCompositeFrameTexture(CaptureState* state, UINT64* timestamp) {
+    ZeroMemory(&state->lastChange, sizeof(state->lastChange));
+    
+    int slot = state->gpuRingIndex;
+    BOOL seeded = FALSE;
+    int updated = 0;
+    
+    for (int i = 0; i < state->compositeCount; i++) {
+        CaptureCompositeSource* src = &state->compositeSources[i];
+        DXGI_OUTDUPL_FRAME_INFO info = {0};
+        IDXGIResource* resource = NULL;
+        
+        HRESULT hr = src->duplication->lpVtbl->AcquireNextFrame(src->duplication, 0, &info, &resource);
+        if (hr == DXGI_ERROR_ACCESS_LOST ||
+            hr == DXGI_ERROR_DEVICE_REMOVED ||
+            hr == DXGI_ERROR_DEVICE_RESET) {
+            state->accessLost = TRUE;
+            continue;
+        }
+        if (FAILED(hr)) continue;  // WAIT_TIMEOUT: this output is idle
+        
+        ID3D11Texture2D* desktop = NULL;
+        hr = resource->lpVtbl->QueryInterface(resource, &IID_ID3D11Texture2D, (void**)&desktop);
+        resource->lpVtbl->Release(resource);
+        
+        // Pointer-only updates carry no new image once this part is seeded
+        BOOL needCopy = SUCCEEDED(hr) &&
+                        (info.AccumulatedFrames > 0 || !src->haveImage || state->forceFullFrame);
+        
+        if (needCopy) {
+            D3D11_TEXTURE2D_DESC desc = {0};
+            desktop->lpVtbl->GetDesc(desktop, &desc);
+            needCopy = EnsureRingTexture(state, slot, desc.Format);
+            if (needCopy && state->crossAdapter && !seeded) {
+                needCopy = BeginBridgeWrite(state, desc.Format);
+            }
+        }
+        
+        if (needCopy) {
+            ID3D11Texture2D* dest = state->crossAdapter ? state->bridge.dupTexture
+                                                        : state->gpuTextureRing[slot];
+            if (!seeded) {
+                // Start from the previous composite so idle outputs keep their image
+                if (!state->crossAdapter && state->gpuTexture && state->gpuTexture != dest) {
+                    state->context->lpVtbl->CopyResource(state->context, (ID3D11Resource*)dest,
+                                                         (ID3D11Resource*)state->gpuTexture);
+                }
+                seeded = TRUE;
+            }
+            
+            D3D11_BOX box = { (UINT)src->srcRect.left, (UINT)src->srcRect.top, 0,
+                              (UINT)src->srcRect.right, (UINT)src->srcRect.bottom, 1 };
+            state->dupContext->lpVtbl->CopySubresourceRegion(
+                state->dupContext, (ID3D11Resource*)dest, 0, (UINT)src->dest.x, (UINT)src->dest.y, 0,
+                (ID3D11Resource*)desktop, 0, &box);
+            src->haveImage = TRUE;
+            
+            RECT part = { src->dest.x, src->dest.y,
+                          src->dest.x + (src->srcRect.right - src->srcRect.left),
+                          src->dest.y + (src->srcRect.bottom - src->srcRect.top) };
+            UnionRect(&state->lastChange.dirtyBounds, &state->lastChange.dirtyBounds, &part);
+            state->lastChange.dirtyRectCount++;
+            state->lastChange.accumulatedFrames += info.AccumulatedFrames;
+            if ((UINT64)info.LastPresentTime.QuadPart > state->lastFrameTime) {
+                state->lastFrameTime = info.LastPresentTime.QuadPart;
+            }
+            updated++;
+        }
+        
+        SAFE_RELEASE(desktop);
+        src->duplication->lpVtbl->ReleaseFrame(src->duplication);
+    }
+    
+    if (state->accessLost) return NULL;
+    
+    if (updated > 0) {
+        if (state->crossAdapter) FinishBridgeWrite(state, state->gpuTextureRing[slot]);
+        state->forceFullFrame = FALSE;
+        state->lastChange.changed = TRUE;
+        state->gpuTexture = state->gpuTextureRing[slot];
+        state->gpuRingIndex = (slot + 1) % CAPTURE_TEXTURE_RING_DEPTH;
+    }
+    
+    if (timestamp) *timestamp = state->lastFrameTime;
+    return state->gpuTexture;
+}
+
+/* ============================================================================
+ * SYNTHETIC SOURCE
+ * ============================================================================
+ * A grid of SYNTHETIC_GRID_COLS x SYNTHETIC_GRID_ROWS cells whose colours
+ * walk one step per frame, so every frame differs everywhere and the
+ * encoder does steady motion work rather than near-empty P-frames. Drawn
+ * with ClearView (one call per colour), no shaders. Without
+ * ID3D11DeviceContext1 only the cycling background is drawn.
+ */
+
+#define SYNTHETIC_GRID_COLS     32
+#define SYNTHETIC_GRID_ROWS     18
+#define SYNTHETIC_COLOURS       8
+
+static const FLOAT g_syntheticColours[SYNTHETIC_COLOURS][4] = {
+    {0.90f, 0.10f, 0.10f, 1.0f}, {0.95f, 0.60f, 0.10f, 1.0f},
+    {0.90f, 0.90f, 0.15f, 1.0f}, {0.15f, 0.80f, 0.20f, 1.0f},
+    {0.10f, 0.70f, 0.85f, 1.0f}, {0.15f, 0.20f, 0.90f, 1.0f},
+    {0.60f, 0.15f, 0.85f, 1.0f}, {0.95f, 0.95f, 0.95f, 1.0f}
+};
+
+BOOL Capture_SetSyntheticSource(CaptureState* state, int width, int height) {
+    LWSR_ASSERT(state != NULL);
+    
+    if (!state || !state->initialized || width < 64 || height < 64) return FALSE;
+    
+    ReleaseComposite(state);
+    ReleaseTextureRing(state);
+    SAFE_RELEASE(state->syntheticContext1);
+    
+    HRESULT hr = state->context->lpVtbl->QueryInterface(state->context, &IID_ID3D11DeviceContext1_Local,
+                                                        (void**)&state->syntheticContext1);
+    if (FAILED(hr)) {
+        Logger_Log("Capture_SetSyntheticSource: no ID3D11DeviceContext1 (0x%08X), drawing background only\n", hr);
+        state->syntheticContext1 = NULL;
+    }
+    
+    state->syntheticWidth = width & ~1;
+    state->syntheticHeight = height & ~1;
+    state->syntheticFrame = 0;
+    state->captureWidth = state->syntheticWidth;
+    state->captureHeight = state->syntheticHeight;
+    SetRect(&state->captureRect, 0, 0, state->captureWidth, state->captureHeight);
+    state->accessLost = FALSE;
+    
+    Logger_Log("Capture: synthetic %dx%d test pattern replaces the desktop\n",
+               state->captureWidth, state->captureHeight);
+    return TRUE;
+}
+
+static ID3D11Texture2D* GetSyntheticFrameTexture(CaptureState* state, UINT64* timestamp) {
+    int slot = state->gpuRingIndex;
+    if (!EnsureRingTexture(state, slot, DXGI_FORMAT_B8G8R8A8_UNORM)) return NULL;
+    if (!state->syntheticViews[slot]) {
+        HRESULT hr = state->device->lpVtbl->CreateRenderTargetView(
+            state->device, (ID3D11Resource*)state->gpuTextureRing[slot], NULL, &state->syntheticViews[slot]);
+        if (FAILED(hr)) return NULL;
+    }
+    ID3D11RenderTargetView* view = state->syntheticViews[slot];
+    UINT frame = state->syntheticFrame++;
+    
+    state->context->lpVtbl->ClearRenderTargetView(state->context, view,
+                                                  g_syntheticColours[frame % SYNTHETIC_COLOURS]);
+    
+    if (state->syntheticContext1) {
+        // Colour of cell (col, row) is (col + row + frame) mod SYNTHETIC_COLOURS
+        D3D11_RECT rects[SYNTHETIC_GRID_COLS * SYNTHETIC_GRID_ROWS / SYNTHETIC_COLOURS + SYNTHETIC_GRID_ROWS];
+        for (int colour = 0; colour < SYNTHETIC_COLOURS; colour++) {
+            UINT count = 0;
+            for (int row = 0; row < SYNTHETIC_GRID_ROWS; row++) {
+                for (int col = 0; col < SYNTHETIC_GRID_COLS; col++) {
+                    if ((int)((col + row + frame) % SYNTHETIC_COLOURS) != colour) continue;
+                    if (count >= ARRAYSIZE(rects)) break;
+                    rects[count].left = col * state->captureWidth / SYNTHETIC_GRID_COLS;
+                    rects[count].right = (col + 1) * state->captureWidth / SYNTHETIC_GRID_COLS;
+                    rects[count].top = row * state->captureHeight / SYNTHETIC_GRID_ROWS;
+                    rects[count].bottom = (row + 1) * state->captureHeight / SYNTHETIC_GRID_ROWS;
+                    count++;
+                }
+            }
+            if (count > 0) {
+                state->syntheticContext1->lpVtbl->ClearView(state->syntheticContext1, (ID3D11View*)view,
+                                                            g_syntheticColours[colour], rects, count);
+            }
+        }
+    }
+    
+    state->gpuTexture = state->gpuTextureRing[slot];
+    state->gpuRingIndex = (slot + 1) % CAPTURE_TEXTURE_RING_DEPTH;
+    
+    state->lastChange.changed = TRUE;
+    SetRect(&state->lastChange.dirtyBounds, 0, 0, state->captureWidth, state->captureHeight);
+    
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    state->lastFrameTime = (UINT64)now.QuadPart;
+    if (timestamp) *timestamp = state->lastFrameTime;
+    return state->gpuTexture;
+}
+
 ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp) {
     // Precondition
     LWSR_ASSERT(state != NULL);
     
+    if (state && state->initialized && state->syntheticWidth > 0) {
+        ZeroMemory(&state->lastChange, sizeof(state->lastChange));
+        return GetSyntheticFrameTexture(state, timestamp);
+    }
+    if (state && state->initialized && state->compositeCount > 0) {
+        return GetCompositeFrameTexture(state, timestamp);
+    }
     if (!state || !state->initialized || !state->duplication) return NULL;
     
     DXGI_OUTDUPL_FRAME_INFO frameInfo = {0};
@@ -606,6 +1351,9 @@ ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp)
     // 0ms timeout - caller handles frame pacing, don't wait here
     HRESULT hr = AcquireDesktopTexture(state, 0, &frameInfo, &desktopTexture);
     
+    // Anything other than a successfully copied new image is "unchanged"
+    ZeroMemory(&state->lastChange, sizeof(state->lastChange));
+    
     if (hr == DXGI_ERROR_WAIT_TIMEOUT) {
         // No new frame available - return last texture to maintain frame rate
         if (state->gpuTexture) {
@@ -630,32 +1378,47 @@ ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp)
         return NULL;
     }
     
-    // Create or reuse GPU texture (stays on GPU, no CPU access)
-    if (!state->gpuTexture) {
-        D3D11_TEXTURE2D_DESC desc = {0};
-        desktopTexture->lpVtbl->GetDesc(desktopTexture, &desc);
-        
-        D3D11_TEXTURE2D_DESC gpuDesc = {0};
-        gpuDesc.Width = state->captureWidth;
-        gpuDesc.Height = state->captureHeight;
-        gpuDesc.MipLevels = 1;
-        gpuDesc.ArraySize = 1;
-        gpuDesc.Format = desc.Format;  // BGRA
-        gpuDesc.SampleDesc.Count = 1;
-        gpuDesc.Usage = D3D11_USAGE_DEFAULT;
-        gpuDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-        gpuDesc.CPUAccessFlags = 0;
-        gpuDesc.MiscFlags = 0;
-        
-        hr = state->device->lpVtbl->CreateTexture2D(state->device, &gpuDesc, NULL, &state->gpuTexture);
-        if (FAILED(hr)) {
-            desktopTexture->lpVtbl->Release(desktopTexture);
-            state->duplication->lpVtbl->ReleaseFrame(state->duplication);
-            return NULL;
-        }
+    ReadFrameChange(state, &frameInfo);
+    
+    // Nothing inside captureRect changed: keep the previous ring texture and
+    // skip the copy entirely (static desktop, menus, cursor-only motion)
+    if (!state->lastChange.changed && state->gpuTexture && !state->forceFullFrame) {
+        desktopTexture->lpVtbl->Release(desktopTexture);
+        state->duplication->lpVtbl->ReleaseFrame(state->duplication);
+        if (timestamp) *timestamp = state->lastFrameTime;
+        return state->gpuTexture;
+    }
+    
+    // First frame into a fresh ring / moved region: report the whole frame
+    if (!state->gpuTexture || state->forceFullFrame) {
+        state->lastChange.changed = TRUE;
+        SetRect(&state->lastChange.dirtyBounds, 0, 0, state->captureWidth, state->captureHeight);
+    }
+    state->forceFullFrame = FALSE;
+    
+    // Create or reuse the next ring texture (stays on GPU, no CPU access).
+    // Rotating means this copy never targets the texture the converter is
+    // still reading for the previous frame.
+    int slot = state->gpuRingIndex;
+    D3D11_TEXTURE2D_DESC desc = {0};
+    desktopTexture->lpVtbl->GetDesc(desktopTexture, &desc);
+    if (!EnsureRingTexture(state, slot, desc.Format) ||
+        (state->crossAdapter && !BeginBridgeWrite(state, desc.Format))) {
+        desktopTexture->lpVtbl->Release(desktopTexture);
+        state->duplication->lpVtbl->ReleaseFrame(state->duplication);
+        return NULL;
     }
     
-    CopyCaptureRegionAndRelease(state, desktopTexture, state->gpuTexture);
+    // Cross-adapter: copy into the bridge on the output's adapter, then
+    // from there into the ring texture on the encode adapter
+    if (state->crossAdapter) {
+        CopyCaptureRegionAndRelease(state, desktopTexture, state->bridge.dupTexture);
+        FinishBridgeWrite(state, state->gpuTextureRing[slot]);
+    } else {
+        CopyCaptureRegionAndRelease(state, desktopTexture, state->gpuTextureRing[slot]);
+    }
+    state->gpuTexture = state->gpuTextureRing[slot];
+    state->gpuRingIndex = (slot + 1) % CAPTURE_TEXTURE_RING_DEPTH;
     
     state->lastFrameTime = frameInfo.LastPresentTime.QuadPart;
     if (timestamp) *timestamp = state->lastFrameTime;
@@ -677,12 +1440,21 @@ void Capture_Shutdown(CaptureState* state) {
     if (!state) return;
     
     SAFE_FREE(state->frameBuffer);
-    SAFE_RELEASE(state->gpuTexture);
+    SAFE_FREE(state->metadataBuffer);
+    state->metadataBufferSize = 0;
+    ReleaseComposite(state);
+    ReleaseTextureRing(state);
+    SAFE_RELEASE(state->syntheticContext1);
+    state->syntheticWidth = 0;
+    state->syntheticHeight = 0;
     SAFE_RELEASE(state->stagingTexture);
     SAFE_RELEASE(state->duplication);
     SAFE_RELEASE(state->adapter);
+    SAFE_RELEASE(state->dupContext);
+    SAFE_RELEASE(state->dupDevice);
     SAFE_RELEASE(state->context);
     SAFE_RELEASE(state->device);
+    state->crossAdapter = FALSE;
     state->initialized = FALSE;
 }
 
@@ -692,13 +1464,26 @@ BOOL Capture_ReinitDuplication(CaptureState* state) {
     
     if (!state) return FALSE;
     if (!state->initialized || !state->adapter) return FALSE;
+    if (state->syntheticWidth > 0) {
+        state->accessLost = FALSE;
+        return TRUE;
+    }
     
     // Save capture region BEFORE InitDuplicationForOutput resets it to full monitor
     RECT savedRect = state->captureRect;
     
-    // Release old duplication and GPU texture (has stale frames)
+    // Composite mode: rebind every output the region overlaps
+    if (state->compositeCount > 0) {
+        ReleaseComposite(state);
+        ReleaseTextureRing(state);
+        if (!BindComposite(state, savedRect)) return FALSE;
+        state->accessLost = FALSE;
+        return TRUE;
+    }
+    
+    // Release old duplication and GPU textures (have stale frames)
     ReleaseDuplication(state);
-    SAFE_RELEASE(state->gpuTexture);
+    ReleaseTextureRing(state);
 
     // Prefer rebinding to the same physical monitor (PnP ID) rather than the
     // same DXGI index — indices can be reassigned after a KVM swap / hot-plug.
@@ -732,98 +1517,156 @@ BOOL Capture_ReinitDuplication(CaptureState* state) {
     return TRUE;
 }
 
-BOOL Capture_ReadbackRegion(CaptureState* state, ID3D11Texture2D* srcTexture,
-                            int srcX, int srcY, int regionW, int regionH,
-                            BYTE* outBuffer, int* outStride) {
+void CaptureReadback_Init(CaptureReadback* rb, int width, int height) {
+    LWSR_ASSERT(rb != NULL);
+    if (!rb) return;
+    
+    ZeroMemory(rb, sizeof(CaptureReadback));
+    rb->depth = CAPTURE_READBACK_RING_DEPTH < GPU_TEXTURE_RING_MAX
+              ? CAPTURE_READBACK_RING_DEPTH : GPU_TEXTURE_RING_MAX;
+    rb->width = width;
+    rb->height = height;
+}
+
+// Staging textures follow the source format, which is only known once a
+// texture is issued (and changes if capture is rebuilt in another format)
+static BOOL CaptureReadback_EnsureStaging(CaptureReadback* rb, CaptureState* state, DXGI_FORMAT format) {
+    if (rb->staging[0] && rb->format == format) return TRUE;
+    
+    for (int i = 0; i < rb->depth; i++) {
+        SAFE_RELEASE(rb->staging[i]);
+        rb->pending[i] = FALSE;
+    }
+    rb->head = rb->tail = 0;
+    
+    D3D11_TEXTURE2D_DESC desc = {0};
+    desc.Width = (UINT)rb->width;
+    desc.Height = (UINT)rb->height;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = format;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = 0;
+    
+    for (int i = 0; i < rb->depth; i++) {
+        HRESULT hr = state->device->lpVtbl->CreateTexture2D(state->device, &desc, NULL, &rb->staging[i]);
+        if (FAILED(hr)) {
+            Logger_Log("CaptureReadback: CreateTexture2D %dx%d failed (0x%08X)\n",
+                       rb->width, rb->height, hr);
+            for (int j = 0; j < i; j++) SAFE_RELEASE(rb->staging[j]);
+            return FALSE;
+        }
+    }
+    rb->format = format;
+    return TRUE;
+}
+
+BOOL CaptureReadback_IssueBatch(CaptureReadback* rb, CaptureState* state, ID3D11Texture2D* srcTexture,
+                                const CaptureReadbackRect* rects, int count, ULONGLONG tag) {
     // Preconditions
+    LWSR_ASSERT(rb != NULL);
     LWSR_ASSERT(state != NULL);
     LWSR_ASSERT(srcTexture != NULL);
-    LWSR_ASSERT(outBuffer != NULL);
-    LWSR_ASSERT(regionW > 0 && regionH > 0);
+    LWSR_ASSERT(rects != NULL && count > 0);
     
-    if (!state || !srcTexture || !outBuffer) return FALSE;
+    if (!rb || !state || !srcTexture || !rects || count <= 0) return FALSE;
     if (!state->initialized || !state->device || !state->context) return FALSE;
-    if (regionW <= 0 || regionH <= 0) return FALSE;
+    if (rb->width <= 0 || rb->height <= 0) return FALSE;
+    if (rb->pending[rb->tail]) return FALSE;  // Ring full: GPU is behind, skip this one
     
-    BOOL result = FALSE;
-    ID3D11Texture2D* staging = NULL;
-    BOOL mapped = FALSE;
-    D3D11_MAPPED_SUBRESOURCE mappedRes = {0};
-    
-    // Validate region against source texture extents
+    // Validate every rect against both textures before copying any
     D3D11_TEXTURE2D_DESC srcDesc = {0};
     srcTexture->lpVtbl->GetDesc(srcTexture, &srcDesc);
-    if (srcX < 0 || srcY < 0 ||
-        (UINT)(srcX + regionW) > srcDesc.Width ||
-        (UINT)(srcY + regionH) > srcDesc.Height) {
-        Logger_Log("Capture_ReadbackRegion: region (%d,%d %dx%d) out of bounds for %ux%u source\n",
-                   srcX, srcY, regionW, regionH, srcDesc.Width, srcDesc.Height);
-        goto cleanup;
+    for (int i = 0; i < count; i++) {
+        const CaptureReadbackRect* r = &rects[i];
+        if (r->width <= 0 || r->height <= 0 || r->srcX < 0 || r->srcY < 0 ||
+            (UINT)(r->srcX + r->width) > srcDesc.Width ||
+            (UINT)(r->srcY + r->height) > srcDesc.Height) {
+            Logger_Log("CaptureReadback: region (%d,%d %dx%d) out of bounds for %ux%u source\n",
+                       r->srcX, r->srcY, r->width, r->height, srcDesc.Width, srcDesc.Height);
+            return FALSE;
+        }
+        if (r->dstX < 0 || r->dstY < 0 ||
+            r->dstX + r->width > rb->width || r->dstY + r->height > rb->height) {
+            Logger_Log("CaptureReadback: destination (%d,%d %dx%d) outside %dx%d staging\n",
+                       r->dstX, r->dstY, r->width, r->height, rb->width, rb->height);
+            return FALSE;
+        }
     }
     
-    // Create a CPU-readable staging texture sized to the region.
-    // Allocated per-call; kill_feed_sampler only invokes this every SCAN_INTERVAL_MS
-    // (seconds), so per-call create/release overhead is negligible and keeps
-    // CaptureState free of caller-specific staging fields.
-    D3D11_TEXTURE2D_DESC stagingDesc = {0};
-    stagingDesc.Width = (UINT)regionW;
-    stagingDesc.Height = (UINT)regionH;
-    stagingDesc.MipLevels = 1;
-    stagingDesc.ArraySize = 1;
-    stagingDesc.Format = srcDesc.Format;
-    stagingDesc.SampleDesc.Count = 1;
-    stagingDesc.Usage = D3D11_USAGE_STAGING;
-    stagingDesc.BindFlags = 0;
-    stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-    stagingDesc.MiscFlags = 0;
-    
-    HRESULT hr = state->device->lpVtbl->CreateTexture2D(state->device, &stagingDesc, NULL, &staging);
-    if (FAILED(hr)) {
-        Logger_Log("Capture_ReadbackRegion: CreateTexture2D failed (0x%08X)\n", hr);
-        goto cleanup;
+    if (!CaptureReadback_EnsureStaging(rb, state, srcDesc.Format)) return FALSE;
+    
+    for (int i = 0; i < count; i++) {
+        const CaptureReadbackRect* r = &rects[i];
+        D3D11_BOX srcBox = {0};
+        srcBox.left = (UINT)r->srcX;
+        srcBox.top = (UINT)r->srcY;
+        srcBox.right = (UINT)(r->srcX + r->width);
+        srcBox.bottom = (UINT)(r->srcY + r->height);
+        srcBox.front = 0;
+        srcBox.back = 1;
+        
+        state->context->lpVtbl->CopySubresourceRegion(
+            state->context,
+            (ID3D11Resource*)rb->staging[rb->tail], 0, (UINT)r->dstX, (UINT)r->dstY, 0,
+            (ID3D11Resource*)srcTexture, 0, &srcBox);
     }
     
-    D3D11_BOX srcBox = {0};
-    srcBox.left = (UINT)srcX;
-    srcBox.top = (UINT)srcY;
-    srcBox.right = (UINT)(srcX + regionW);
-    srcBox.bottom = (UINT)(srcY + regionH);
-    srcBox.front = 0;
-    srcBox.back = 1;
+    rb->tags[rb->tail] = tag;
+    rb->pending[rb->tail] = TRUE;
+    rb->tail = (rb->tail + 1) % rb->depth;
+    return TRUE;
+}
+
+BOOL CaptureReadback_Map(CaptureReadback* rb, CaptureState* state,
+                         const BYTE** outData, int* outPitch, ULONGLONG* outTag) {
+    // Preconditions
+    LWSR_ASSERT(rb != NULL);
+    LWSR_ASSERT(state != NULL);
+    LWSR_ASSERT(outData != NULL);
     
-    state->context->lpVtbl->CopySubresourceRegion(
-        state->context,
-        (ID3D11Resource*)staging, 0, 0, 0, 0,
-        (ID3D11Resource*)srcTexture, 0, &srcBox);
+    if (!rb || !state || !outData) return FALSE;
+    if (!state->context || !rb->pending[rb->head]) return FALSE;
     
-    hr = state->context->lpVtbl->Map(state->context, (ID3D11Resource*)staging,
-                                      0, D3D11_MAP_READ, 0, &mappedRes);
+    ID3D11Texture2D* staging = rb->staging[rb->head];
+    D3D11_MAPPED_SUBRESOURCE mappedRes = {0};
+    HRESULT hr = state->context->lpVtbl->Map(state->context, (ID3D11Resource*)staging,
+                                             0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mappedRes);
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING) return FALSE;  // Not done yet; try next frame
     if (FAILED(hr)) {
-        Logger_Log("Capture_ReadbackRegion: Map failed (0x%08X)\n", hr);
-        goto cleanup;
-    }
-    mapped = TRUE;
-    
-    // Copy out compactly: outBuffer is sized regionW*regionH*BYTES_PER_PIXEL_BGRA
-    // (no padding), and outStride is reported as the compact row length so
-    // callers iterating with `outStride` stay within the allocated buffer
-    // regardless of the GPU staging row pitch.
-    size_t rowBytes = (size_t)regionW * BYTES_PER_PIXEL_BGRA;
-    BYTE* src = (BYTE*)mappedRes.pData;
-    BYTE* dst = outBuffer;
-    for (int y = 0; y < regionH; y++) {
-        memcpy(dst, src, rowBytes);
-        src += mappedRes.RowPitch;
-        dst += rowBytes;
+        // Drop the slot so one bad map cannot wedge the ring
+        Logger_Log("CaptureReadback: Map failed (0x%08X)\n", hr);
+        rb->pending[rb->head] = FALSE;
+        rb->head = (rb->head + 1) % rb->depth;
+        return FALSE;
     }
     
-    if (outStride) *outStride = (int)rowBytes;
-    result = TRUE;
+    *outData = (const BYTE*)mappedRes.pData;
+    if (outPitch) *outPitch = (int)mappedRes.RowPitch;
+    if (outTag) *outTag = rb->tags[rb->head];
+    return TRUE;
+}
+
+void CaptureReadback_Unmap(CaptureReadback* rb, CaptureState* state) {
+    if (!rb || !state || !state->context || !rb->pending[rb->head]) return;
     
-cleanup:
-    if (mapped) {
-        state->context->lpVtbl->Unmap(state->context, (ID3D11Resource*)staging, 0);
+    state->context->lpVtbl->Unmap(state->context, (ID3D11Resource*)rb->staging[rb->head], 0);
+    rb->pending[rb->head] = FALSE;
+    rb->head = (rb->head + 1) % rb->depth;
+}
+
+BOOL CaptureReadback_HasPending(const CaptureReadback* rb) {
+    return rb && rb->depth > 0 && rb->pending[rb->head];
+}
+
+void CaptureReadback_Shutdown(CaptureReadback* rb) {
+    if (!rb) return;
+    for (int i = 0; i < GPU_TEXTURE_RING_MAX; i++) {
+        SAFE_RELEASE(rb->staging[i]);
+        rb->pending[i] = FALSE;
     }
-    SAFE_RELEASE(staging);
-    return result;
+    rb->head = rb->tail = 0;
 }
@@ -6,17 +6,71 @@
 #define CAPTURE_H
 
 #include <windows.h>
-#include <d3d11.h>
+#include <d3d11_4.h>
 #include <dxgi1_2.h>
+#include "constants.h"
 
+// What changed inside captureRect between the texture returned by the
+// previous Capture_GetFrameTexture call and the one returned by the latest.
+// Built from DXGI_OUTDUPL_FRAME_INFO plus the frame's dirty/move rects.
 typedef struct {
-    // D3D11 resources
+    BOOL changed;               // FALSE: returned texture is the same image as last time
+    UINT accumulatedFrames;     // DXGI AccumulatedFrames (0 = pointer-only update or timeout)
+    int dirtyRectCount;         // Dirty rects intersecting captureRect
+    int moveRectCount;          // Move rects whose destination intersects captureRect
+    RECT dirtyBounds;           // Union of the above, capture-local coordinates (empty if !changed)
+} CaptureFrameChange;
+
+// One output's share of a region that spans several monitors. Each source
+// has its own duplication; its part of the region is copied into the
+// shared BGRA texture at `dest`.
+typedef struct {
+    IDXGIOutputDuplication* duplication;
+    RECT srcRect;               // Part of the region on this output, output-relative
+    POINT dest;                 // Top-left of srcRect in the composite texture
+    BOOL haveImage;             // At least one frame copied since bind
+} CaptureCompositeSource;
+
+// Hybrid systems: the output is duplicated on its own adapter and each new
+// image crosses to the encoder's adapter through one shared texture. The
+// texture is row-major (the layout both adapters can address) and opened
+// on both devices by NT handle; two shared fences order the copies on the
+// GPUs, so neither side waits on the CPU: the duplication device signals
+// `copied` after writing it, the encode device waits for that, copies it
+// into its own ring texture and signals `consumed`, which the duplication
+// device waits for before writing it again.
+typedef struct {
+    ID3D11Texture2D* dupTexture;          // Shared texture, duplication device side
+    ID3D11Texture2D* encodeTexture;       // Same texture opened on the encode device
+    ID3D11Fence* copiedFence;             // Created on the duplication device
+    ID3D11Fence* copiedFenceEncode;       // ...opened on the encode device
+    ID3D11Fence* consumedFence;           // Created on the encode device
+    ID3D11Fence* consumedFenceDup;        // ...opened on the duplication device
+    ID3D11DeviceContext4* dupContext4;
+    ID3D11DeviceContext4* encodeContext4;
+    UINT64 fenceValue;                    // Last value signalled on both fences
+    int width, height;
+    DXGI_FORMAT format;
+} CaptureBridge;
+
+typedef struct {
+    // D3D11 resources. device/context are where frames are consumed (the
+    // NVENC adapter when there is one): ring textures, conversion, encode
+    // and readback all live there. dupDevice/dupContext run the
+    // duplications; they are the same objects (with their own reference)
+    // unless the output belongs to another adapter.
     ID3D11Device* device;
     ID3D11DeviceContext* context;
+    ID3D11Device* dupDevice;
+    ID3D11DeviceContext* dupContext;
+    CaptureBridge bridge;                 // Cross-adapter transfer (crossAdapter only)
+    BOOL crossAdapter;                    // dupDevice is on a different adapter
     IDXGIOutputDuplication* duplication;
     ID3D11Texture2D* stagingTexture;      // CPU-accessible staging texture
-    ID3D11Texture2D* gpuTexture;          // GPU texture for zero-copy path
-    IDXGIAdapter* adapter;                // Keep adapter for switching outputs
+    ID3D11Texture2D* gpuTexture;          // Most recent GPU frame (aliases a gpuTextureRing slot)
+    ID3D11Texture2D* gpuTextureRing[GPU_TEXTURE_RING_MAX];  // BGRA ring, CAPTURE_TEXTURE_RING_DEPTH used
+    int gpuRingIndex;                     // Next ring slot to write
+    IDXGIAdapter* adapter;                // Duplication adapter, kept for switching outputs
     
     // Monitor info
     DXGI_OUTPUT_DESC outputDesc;
@@ -28,6 +82,12 @@ typedef struct {
     // PnP DeviceID of the originally-bound output; empty if unresolvable (RDP / virtual display).
     char targetMonitorId[256];
 
+    // Composite mode: region spans several outputs of this adapter. When
+    // compositeCount > 0, `duplication` is NULL and each source is polled
+    // independently (see Capture_SetRegion).
+    CaptureCompositeSource compositeSources[LWSR_MAX_MONITORS];
+    int compositeCount;
+    
     // Capture region
     RECT captureRect;
     int captureWidth;
@@ -38,16 +98,34 @@ typedef struct {
     size_t frameBufferSize;
     UINT64 lastFrameTime;
     
+    // Dirty/move-rect metadata for the most recent GetFrameTexture call
+    CaptureFrameChange lastChange;
+    BYTE* metadataBuffer;                 // Scratch for GetFrameMoveRects/GetFrameDirtyRects
+    UINT metadataBufferSize;
+    BOOL forceFullFrame;                  // Next frame must be copied (region moved, duplication reset)
+    
+    // Synthetic test pattern in place of duplication (Capture_SetSyntheticSource)
+    int syntheticWidth;                   // 0 = capture the desktop
+    int syntheticHeight;
+    UINT syntheticFrame;                  // Pattern frames drawn so far
+    ID3D11DeviceContext1* syntheticContext1;  // For ClearView; NULL = background only
+    ID3D11RenderTargetView* syntheticViews[GPU_TEXTURE_RING_MAX];  // One per ring slot
+    
     // State
     BOOL initialized;
     BOOL accessLost;  // Set when DXGI_ERROR_ACCESS_LOST occurs
     
 } CaptureState;
 
-// Initialize the capture system
+// Initialize the capture system. Duplicates the primary output on its own
+// adapter; if an NVIDIA adapter exists and is a different one, frames are
+// handed to it on the GPU (see CaptureBridge), otherwise everything runs
+// on the output's adapter.
 BOOL Capture_Init(CaptureState* state);
 
-// Set capture region (screen coordinates)
+// Set capture region (screen coordinates). A region overlapping more than
+// one output switches to composite mode: one duplication per output, each
+// polled without waiting, composited into a single BGRA texture on the GPU.
 BOOL Capture_SetRegion(CaptureState* state, RECT region);
 
 // Set to capture specific monitor
@@ -63,10 +141,18 @@ int Capture_GetRefreshRate(CaptureState* state);
 void Capture_Shutdown(CaptureState* state);
 
 // Get frame as GPU texture (stays on GPU, no CPU copy)
-// Returns a BGRA texture that can be used for GPU processing
+// Returns a BGRA texture on state->device that can be used for GPU processing
 // Caller must NOT release the texture - it's owned by capture state
+// New frames rotate through CAPTURE_TEXTURE_RING_DEPTH textures, so the
+// returned texture is not overwritten by the very next call.
 ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp);
 
+// Change metadata for the texture last returned by Capture_GetFrameTexture.
+// When nothing inside captureRect changed, the previous ring texture is
+// returned again (no copy issued) and changed is FALSE, so callers can skip
+// conversion and re-encode the previous frame cheaply.
+const CaptureFrameChange* Capture_GetLastChange(const CaptureState* state);
+
 // Helper: Get window rect for window capture mode
 BOOL Capture_GetWindowRect(HWND hwnd, RECT* rect);
 
@@ -79,16 +165,65 @@ BOOL Capture_GetAllMonitorsBounds(RECT* bounds);
 // Helper: Get monitor bounds by index
 BOOL Capture_GetMonitorBoundsByIndex(int monitorIndex, RECT* bounds);
 
+// Replace the desktop with a generated width x height BGRA test pattern
+// drawn on the GPU (a scrolling colour grid, different every frame), for
+// benchmarking without a display or game. Later SetRegion / SetMonitor
+// calls only move captureRect; the size stays width x height. Call after
+// Capture_Init while no capture loop is running; lasts until Shutdown.
+BOOL Capture_SetSyntheticSource(CaptureState* state, int width, int height);
+
 // Reinitialize desktop duplication (after access lost)
 // Returns TRUE if successful, FALSE if needs retry
 BOOL Capture_ReinitDuplication(CaptureState* state);
 
-// Read back a sub-region from a GPU BGRA texture to CPU memory
-// Creates/reuses a staging texture sized to the region
-// outBuffer must be pre-allocated: regionW * regionH * 4 bytes
-// Returns TRUE on success, outStride receives the row pitch
-BOOL Capture_ReadbackRegion(CaptureState* state, ID3D11Texture2D* srcTexture,
-                            int srcX, int srcY, int regionW, int regionH,
-                            BYTE* outBuffer, int* outStride);
+// Asynchronous readback of sub-regions of capture textures. IssueBatch
+// queues GPU copies into the next of CAPTURE_READBACK_RING_DEPTH staging
+// textures; Map maps the oldest with D3D11_MAP_FLAG_DO_NOT_WAIT a frame or
+// more later, so neither call waits on the GPU. Staging textures are created
+// on the first IssueBatch (their format comes from the source) and kept
+// until Shutdown. Capture thread only (uses the immediate context).
+typedef struct {
+    ID3D11Texture2D* staging[GPU_TEXTURE_RING_MAX];
+    ULONGLONG tags[GPU_TEXTURE_RING_MAX];  // Caller value passed to IssueBatch
+    BOOL pending[GPU_TEXTURE_RING_MAX];    // Copy issued, not yet polled
+    int depth;
+    int head;                             // Oldest pending slot
+    int tail;                             // Next slot to issue into
+    int width, height;
+    DXGI_FORMAT format;                   // Format the staging textures were made with
+} CaptureReadback;
+
+// Prepare a ring for width x height regions (no GPU resources yet)
+void CaptureReadback_Init(CaptureReadback* rb, int width, int height);
+
+// One rectangle of a batched readback: where it is read from in the source
+// and where it lands in the staging texture
+typedef struct {
+    int srcX, srcY;
+    int dstX, dstY;
+    int width, height;
+} CaptureReadbackRect;
+
+// Queue copies of several regions of srcTexture: each rect is copied into
+// its place in the same staging texture (the ring's width x height is an
+// atlas of them), so they share one slot and one Map. Returns FALSE without
+// copying anything if every slot is still waiting to be mapped, any rect is
+// out of bounds of either texture, or a staging texture cannot be created.
+BOOL CaptureReadback_IssueBatch(CaptureReadback* rb, CaptureState* state, ID3D11Texture2D* srcTexture,
+                                const CaptureReadbackRect* rects, int count, ULONGLONG tag);
+
+// Map the oldest finished copy in place (rows are outPitch bytes apart) and
+// return its tag. Returns FALSE if nothing is pending or the GPU has not
+// finished the oldest copy yet; on TRUE, call CaptureReadback_Unmap before
+// the next Map or IssueBatch.
+BOOL CaptureReadback_Map(CaptureReadback* rb, CaptureState* state,
+                         const BYTE** outData, int* outPitch, ULONGLONG* outTag);
+void CaptureReadback_Unmap(CaptureReadback* rb, CaptureState* state);
+
+// TRUE if an issued copy is waiting to be polled
+BOOL CaptureReadback_HasPending(const CaptureReadback* rb);
+
+// Release staging textures (safe on a ring that never issued)
+void CaptureReadback_Shutdown(CaptureReadback* rb);
 
 #endif // CAPTURE_H
@@ -0,0 +1,822 @@
+/*
+ * clip_edit.c - Lossless trim and concatenate for saved MP4 clips
+ *
+ * USES: mp4_reader.c (index + payload), mp4_writer.c (output)
+ *
+ * A trim indexes the source, picks the frame and audio sample ranges and
+ * rebases them to 0. A join indexes every input and lays them end to end
+ * on one timeline. Both write with MP4Writer_WriteFileStreamed, whose
+ * fetch callback loads the payload one window or chunk at a time, so an
+ * edit's memory does not grow with the clip. The samples go from reader to
+ * writer untouched; the selected bytes are read twice (sizes, then the
+ * write, mostly from the file cache) and written once.
+ *
+ * The toolbar dialog collects its inputs on the UI thread and runs the
+ * edit on a worker thread, which posts WM_CLIP_EDIT_COMPLETE back.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Goto-cleanup in the edit operations (clips, sample arrays)
+ * - Failures are logged; the UI and command line report success/failure only
+ */
+
+#include "clip_edit.h"
+#include "mp4_reader.h"
+#include "mp4_writer.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include <commdlg.h>
+#include <shellapi.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+/* Alias for logging */
+#define EditLog Logger_Log
+
+#define MAX_JOIN_INPUTS     64      /* Files one join accepts */
+
+/* ============================================================================
+ * SAMPLE SELECTION
+ * ============================================================================
+ */
+
+/* Last keyframe at or before ts; the first keyframe if none is */
+static int KeyframeAtOrBefore(const MP4Clip* clip, LONGLONG ts) {
+    int found = -1;
+    for (int i = 0; i < clip->videoCount; i++) {
+        if (!clip->videoSamples[i].isKeyframe) continue;
+        if (clip->videoSamples[i].timestamp > ts && found >= 0) break;
+        found = i;
+        if (clip->videoSamples[i].timestamp > ts) break;
+    }
+    return found;
+}
+
+/* First audio sample at or after ts (binary search; timestamps ascend) */
+static int AudioAtOrAfter(const MuxerAudioSample* samples, int count, LONGLONG ts) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (samples[mid].timestamp < ts) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Audio of [from, to) in every track */
+static void SelectAudio(const MP4Clip* clip, LONGLONG from, LONGLONG to, MP4ClipRange* range) {
+    for (int a = 0; a < clip->audioTrackCount; a++) {
+        int first = AudioAtOrAfter(clip->audioSamples[a], clip->audioCounts[a], from);
+        int end = AudioAtOrAfter(clip->audioSamples[a], clip->audioCounts[a], to);
+        range->audioFirst[a] = first;
+        range->audioCount[a] = end - first;
+    }
+}
+
+/* Writer tracks over the selected range (tracks left empty are skipped by it) */
+static int RangeTracks(const MP4Clip* clip, const MP4ClipRange* range, MuxerAudioTrack* tracks) {
+    for (int a = 0; a < clip->audioTrackCount; a++) {
+        tracks[a].samples = clip->audioSamples[a] + range->audioFirst[a];
+        tracks[a].sampleCount = range->audioCount[a];
+        tracks[a].config = clip->audioConfigs[a];
+    }
+    return clip->audioTrackCount;
+}
+
+static BOOL SamePath(const char* a, const char* b) {
+    return _stricmp(a, b) == 0;
+}
+
+/* ============================================================================
+ * STREAMED PAYLOAD
+ * ============================================================================
+ * Writer fetch callbacks: map a run of output samples back to the clip
+ * samples they came from and load just those.
+ */
+
+typedef struct {
+    MP4Clip* clip;
+    int videoFirst;                         /* Clip sample of output sample 0 */
+    int audioFirst[MAX_AUDIO_TRACKS];
+} TrimSource;
+
+static BOOL FetchTrim(void* context, int track, int first, int count) {
+    TrimSource* src = (TrimSource*)context;
+    MP4ClipRange range;
+    ZeroMemory(&range, sizeof(range));
+    if (track == 0) {
+        range.videoFirst = src->videoFirst + first;
+        range.videoCount = count;
+    } else {
+        range.audioFirst[track - 1] = src->audioFirst[track - 1] + first;
+        range.audioCount[track - 1] = count;
+    }
+    return MP4Reader_Load(src->clip, &range);
+}
+
+/* Joined tracks copy the clips' samples; base[k] is the joined index of
+ * clip k's first copied sample (base[clipCount] = total) and first[k] the
+ * clip sample it was copied from. */
+typedef struct {
+    MP4Clip* clips;
+    int clipCount;
+    MuxerSample* video;
+    MuxerAudioSample* audio[MAX_AUDIO_TRACKS];
+    int videoBase[MAX_JOIN_INPUTS + 1];
+    int videoFirst[MAX_JOIN_INPUTS];
+    int audioBase[MAX_AUDIO_TRACKS][MAX_JOIN_INPUTS + 1];
+    int audioFirst[MAX_AUDIO_TRACKS][MAX_JOIN_INPUTS];
+} JoinSource;
+
+static BOOL FetchJoin(void* context, int track, int first, int count) {
+    JoinSource* src = (JoinSource*)context;
+    int a = track - 1;
+    const int* base = track == 0 ? src->videoBase : src->audioBase[a];
+    const int* from = track == 0 ? src->videoFirst : src->audioFirst[a];
+    int end = first + count;
+
+    for (int k = 0; k < src->clipCount; k++) {
+        MP4Clip* clip = &src->clips[k];
+        int lo = max(first, base[k]);
+        int hi = min(end, base[k + 1]);
+        if (lo >= hi && !clip->payload) continue;
+
+        /* Clips outside the run get an empty range, which frees their last span */
+        MP4ClipRange range;
+        ZeroMemory(&range, sizeof(range));
+        int clipFirst = from[k] + (lo - base[k]);
+        if (lo < hi && track == 0) {
+            range.videoFirst = clipFirst;
+            range.videoCount = hi - lo;
+        } else if (lo < hi) {
+            range.audioFirst[a] = clipFirst;
+            range.audioCount[a] = hi - lo;
+        }
+        if (!MP4Reader_Load(clip, &range)) return FALSE;
+
+        for (int i = lo; i < hi; i++) {
+            if (track == 0) src->video[i].data = clip->videoSamples[clipFirst + i - lo].data;
+            else src->audio[a][i].data = clip->audioSamples[a][clipFirst + i - lo].data;
+        }
+    }
+    return TRUE;
+}
+
+/* ============================================================================
+ * TRIM
+ * ============================================================================
+ */
+
+BOOL ClipEdit_Trim(const char* inputPath, const char* outputPath, LONGLONG start, LONGLONG end) {
+    LWSR_ASSERT(inputPath != NULL);
+    LWSR_ASSERT(outputPath != NULL);
+
+    if (!inputPath || !outputPath) return FALSE;
+    if (SamePath(inputPath, outputPath)) {
+        EditLog("ClipEdit: trim output must differ from the input (%s)\n", inputPath);
+        return FALSE;
+    }
+    if (start < 0) start = 0;
+
+    DWORD startTick = GetTickCount();
+    BOOL result = FALSE;
+    MP4Clip clip;
+    if (!MP4Reader_Open(inputPath, &clip)) return FALSE;
+
+    LONGLONG origin = clip.videoSamples[0].timestamp;
+    int first = KeyframeAtOrBefore(&clip, origin + start);
+    if (first < 0) {
+        EditLog("ClipEdit: %s has no keyframe\n", inputPath);
+        goto cleanup;
+    }
+    int last = clip.videoCount;
+    if (end > 0) {
+        last = first;
+        while (last < clip.videoCount && clip.videoSamples[last].timestamp < origin + end) last++;
+    }
+    if (last <= first) {
+        EditLog("ClipEdit: trim range [%lld, %lld) of %s selects no frames\n", start, end, inputPath);
+        goto cleanup;
+    }
+
+    const MuxerSample* tail = &clip.videoSamples[last - 1];
+    LONGLONG from = clip.videoSamples[first].timestamp;
+    LONGLONG to = tail->timestamp + tail->duration;
+
+    MP4ClipRange range;
+    ZeroMemory(&range, sizeof(range));
+    range.videoFirst = first;
+    range.videoCount = last - first;
+    SelectAudio(&clip, from, to, &range);
+
+    /* The trimmed clip starts at 0 */
+    for (int i = first; i < last; i++) clip.videoSamples[i].timestamp -= from;
+    for (int a = 0; a < clip.audioTrackCount; a++) {
+        for (int i = range.audioFirst[a]; i < range.audioFirst[a] + range.audioCount[a]; i++) {
+            clip.audioSamples[a][i].timestamp -= from;
+        }
+    }
+
+    MuxerAudioTrack tracks[MAX_AUDIO_TRACKS];
+    int trackCount = RangeTracks(&clip, &range, tracks);
+    TrimSource source;
+    source.clip = &clip;
+    source.videoFirst = first;
+    memcpy(source.audioFirst, range.audioFirst, sizeof(source.audioFirst));
+    result = MP4Writer_WriteFileStreamed(outputPath, clip.videoSamples + first, last - first,
+                                         &clip.video, tracks, trackCount, FetchTrim, &source);
+
+    EditLog("ClipEdit: trim %s [%.3f, %.3f) s -> %s: %d frames, %s in %u ms\n", inputPath,
+            (double)(from - origin) / MF_UNITS_PER_SECOND, (double)(to - origin) / MF_UNITS_PER_SECOND,
+            outputPath, last - first, result ? "OK" : "FAILED", GetTickCount() - startTick);
+
+cleanup:
+    MP4Reader_Close(&clip);
+    return result;
+}
+
+/* ============================================================================
+ * CONCATENATE
+ * ============================================================================
+ */
+
+/* Same encoder setup: one hvcC / av1C and the same audio sample entries fit all */
+static BOOL Compatible(const MP4Clip* a, const MP4Clip* b) {
+    if (a->video.codec != b->video.codec) return FALSE;
+    if (a->video.width != b->video.width || a->video.height != b->video.height) return FALSE;
+    if (a->video.seqHeaderSize != b->video.seqHeaderSize ||
+        memcmp(a->video.seqHeader, b->video.seqHeader, a->video.seqHeaderSize) != 0) return FALSE;
+    if (a->audioTrackCount != b->audioTrackCount) return FALSE;
+    for (int t = 0; t < a->audioTrackCount; t++) {
+        const MuxerAudioConfig* x = &a->audioConfigs[t];
+        const MuxerAudioConfig* y = &b->audioConfigs[t];
+        if (x->sampleRate != y->sampleRate || x->channels != y->channels ||
+            x->configSize != y->configSize || memcmp(x->configData, y->configData, x->configSize) != 0) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: ClipEdit_Concat
+ * Resources: 3 + tracks - opened clips (each with its last fetched span),
+ *            fetch source, joined video array, one joined array per
+ *            audio track
+ * Pattern: goto-cleanup in reverse acquisition order
+ * Init: calloc / explicit NULL ensures NULL initialization
+ */
+BOOL ClipEdit_Concat(const char* const* inputPaths, int inputCount, const char* outputPath) {
+    LWSR_ASSERT(inputPaths != NULL);
+    LWSR_ASSERT(outputPath != NULL);
+
+    if (!inputPaths || !outputPath || inputCount < 2) return FALSE;
+    if (inputCount > MAX_JOIN_INPUTS) {
+        EditLog("ClipEdit: join takes at most %d inputs (%d given)\n", MAX_JOIN_INPUTS, inputCount);
+        return FALSE;
+    }
+    for (int k = 0; k < inputCount; k++) {
+        if (!inputPaths[k] || SamePath(inputPaths[k], outputPath)) {
+            EditLog("ClipEdit: join output must differ from every input (%s)\n", outputPath);
+            return FALSE;
+        }
+    }
+
+    DWORD startTick = GetTickCount();
+    BOOL result = FALSE;
+    int opened = 0;
+    MuxerSample* video = NULL;
+    MuxerAudioSample* audio[MAX_AUDIO_TRACKS];
+    JoinSource* source = NULL;
+    ZeroMemory(audio, sizeof(audio));
+
+    MP4Clip* clips = (MP4Clip*)calloc((size_t)inputCount, sizeof(MP4Clip));
+    if (!clips) return FALSE;
+
+    int videoTotal = 0;
+    int audioTotal[MAX_AUDIO_TRACKS] = {0};
+    for (int k = 0; k < inputCount; k++) {
+        if (!MP4Reader_Open(inputPaths[k], &clips[k])) goto cleanup;
+        opened++;
+        if (!Compatible(&clips[0], &clips[k])) {
+            EditLog("ClipEdit: %s does not match %s (resolution, parameter sets or audio)\n",
+                    inputPaths[k], inputPaths[0]);
+            goto cleanup;
+        }
+        videoTotal += clips[k].videoCount;
+        for (int a = 0; a < clips[k].audioTrackCount; a++) audioTotal[a] += clips[k].audioCounts[a];
+    }
+
+    int audioTracks = clips[0].audioTrackCount;
+    source = (JoinSource*)calloc(1, sizeof(JoinSource));
+    if (!source) goto cleanup;
+    video = (MuxerSample*)malloc((size_t)videoTotal * sizeof(MuxerSample));
+    if (!video) goto cleanup;
+    for (int a = 0; a < audioTracks; a++) {
+        audio[a] = (MuxerAudioSample*)malloc((size_t)(audioTotal[a] > 0 ? audioTotal[a] : 1) * sizeof(MuxerAudioSample));
+        if (!audio[a]) goto cleanup;
+    }
+
+    /* Each input starts where the previous one ended */
+    int videoCount = 0;
+    int audioCount[MAX_AUDIO_TRACKS] = {0};
+    LONGLONG cursor = 0;
+    for (int k = 0; k < inputCount; k++) {
+        MP4Clip* clip = &clips[k];
+        int first = KeyframeAtOrBefore(clip, LLONG_MIN);
+        if (first < 0) {
+            EditLog("ClipEdit: %s has no keyframe\n", inputPaths[k]);
+            goto cleanup;
+        }
+
+        MP4ClipRange range;
+        ZeroMemory(&range, sizeof(range));
+        range.videoFirst = first;
+        range.videoCount = clip->videoCount - first;
+        LONGLONG origin = clip->videoSamples[first].timestamp;
+        SelectAudio(clip, origin, LLONG_MAX, &range);
+
+        source->videoBase[k] = videoCount;
+        source->videoFirst[k] = first;
+        for (int a = 0; a < audioTracks; a++) {
+            source->audioBase[a][k] = audioCount[a];
+            source->audioFirst[a][k] = range.audioFirst[a];
+        }
+
+        LONGLONG shift = cursor - origin;
+        for (int i = first; i < clip->videoCount; i++) {
+            MuxerSample* s = &video[videoCount++];
+            *s = clip->videoSamples[i];
+            s->timestamp += shift;
+            if (s->timestamp + s->duration > cursor) cursor = s->timestamp + s->duration;
+        }
+        for (int a = 0; a < audioTracks; a++) {
+            for (int i = range.audioFirst[a]; i < range.audioFirst[a] + range.audioCount[a]; i++) {
+                MuxerAudioSample* s = &audio[a][audioCount[a]++];
+                *s = clip->audioSamples[a][i];
+                s->timestamp += shift;
+                if (s->timestamp + s->duration > cursor) cursor = s->timestamp + s->duration;
+            }
+        }
+    }
+
+    source->clips = clips;
+    source->clipCount = inputCount;
+    source->video = video;
+    source->videoBase[inputCount] = videoCount;
+    for (int a = 0; a < audioTracks; a++) {
+        source->audio[a] = audio[a];
+        source->audioBase[a][inputCount] = audioCount[a];
+    }
+
+    MuxerAudioTrack tracks[MAX_AUDIO_TRACKS];
+    for (int a = 0; a < audioTracks; a++) {
+        tracks[a].samples = audio[a];
+        tracks[a].sampleCount = audioCount[a];
+        tracks[a].config = clips[0].audioConfigs[a];
+    }
+    result = MP4Writer_WriteFileStreamed(outputPath, video, videoCount, &clips[0].video,
+                                         tracks, audioTracks, FetchJoin, source);
+
+    EditLog("ClipEdit: joined %d clips -> %s: %d frames, %.3f s, %s in %u ms\n", inputCount,
+            outputPath, videoCount, (double)cursor / MF_UNITS_PER_SECOND,
+            result ? "OK" : "FAILED", GetTickCount() - startTick);
+
+cleanup:
+    for (int a = 0; a < MAX_AUDIO_TRACKS; a++) SAFE_FREE(audio[a]);
+    SAFE_FREE(video);
+    SAFE_FREE(source);
+    for (int k = 0; k < opened; k++) MP4Reader_Close(&clips[k]);
+    free(clips);
+    return result;
+}
+
+/* ============================================================================
+ * TIME PARSING
+ * ============================================================================
+ */
+
+BOOL ClipEdit_ParseTime(const WCHAR* text, LONGLONG* time) {
+    if (!text || !time) return FALSE;
+
+    /* Up to three ':'-separated fields, the last one may have a fraction */
+    double fields[3];
+    int count = 0;
+    const WCHAR* p = text;
+    while (*p == L' ') p++;
+    for (;;) {
+        WCHAR* next = NULL;
+        double v = wcstod(p, &next);
+        if (next == p || v < 0 || count == 3) return FALSE;
+        fields[count++] = v;
+        p = next;
+        if (*p != L':') break;
+        p++;
+    }
+    while (*p == L' ') p++;
+    if (*p != L'\0') return FALSE;
+
+    double seconds = 0;
+    for (int i = 0; i < count; i++) {
+        /* Only the last field may carry a fraction */
+        if (i < count - 1 && fields[i] != (double)(LONGLONG)fields[i]) return FALSE;
+        seconds = seconds * 60 + fields[i];
+    }
+    *time = (LONGLONG)(seconds * MF_UNITS_PER_SECOND + 0.5);
+    return TRUE;
+}
+
+/* ============================================================================
+ * COMMAND LINE
+ * ============================================================================
+ */
+
+/* UTF-16 -> UTF-8 into buffer (MAX_PATH) */
+static BOOL ToUtf8(const WCHAR* w, char* buffer) {
+    return WideCharToMultiByte(CP_UTF8, 0, w, -1, buffer, MAX_PATH, NULL, NULL) > 0;
+}
+
+/* One line to the console that started us, if any (GUI subsystem: no stdout) */
+static void Report(const char* fmt, ...) {
+    if (!AttachConsole(ATTACH_PARENT_PROCESS) && GetLastError() != ERROR_ACCESS_DENIED) return;
+    HANDLE out = CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    if (out == INVALID_HANDLE_VALUE) return;
+
+    char line[1024];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n > 0) {
+        DWORD written;
+        WriteConsoleA(out, line, (DWORD)strlen(line), &written, NULL);
+    }
+    CloseHandle(out);
+}
+
+static BOOL RunTrim(int argc, LPWSTR* argv) {
+    char input[MAX_PATH], output[MAX_PATH];
+    LONGLONG start = 0, end = 0;
+    if (argc < 5 || argc > 6 || !ToUtf8(argv[2], input) || !ToUtf8(argv[3], output) ||
+        !ClipEdit_ParseTime(argv[4], &start) || (argc == 6 && !ClipEdit_ParseTime(argv[5], &end))) {
+        Report("usage: lwsr.exe --trim <input.mp4> <output.mp4> <start> [<end>]\n");
+        return FALSE;
+    }
+    if (end > 0 && end <= start) {
+        Report("lwsr: end must be after start\n");
+        return FALSE;
+    }
+    BOOL ok = ClipEdit_Trim(input, output, start, end);
+    Report(ok ? "lwsr: wrote %s\n" : "lwsr: trim of %s failed\n", ok ? output : input);
+    return ok;
+}
+
+static BOOL RunConcat(int argc, LPWSTR* argv) {
+    if (argc < 5 || argc - 3 > MAX_JOIN_INPUTS) {
+        Report("usage: lwsr.exe --concat <output.mp4> <input1.mp4> <input2.mp4> ... (up to %d inputs)\n",
+               MAX_JOIN_INPUTS);
+        return FALSE;
+    }
+
+    char output[MAX_PATH];
+    char inputs[MAX_JOIN_INPUTS][MAX_PATH];
+    const char* inputPtrs[MAX_JOIN_INPUTS];
+    int count = argc - 3;
+    if (!ToUtf8(argv[2], output)) return FALSE;
+    for (int i = 0; i < count; i++) {
+        if (!ToUtf8(argv[3 + i], inputs[i])) return FALSE;
+        inputPtrs[i] = inputs[i];
+    }
+    BOOL ok = ClipEdit_Concat(inputPtrs, count, output);
+    Report(ok ? "lwsr: wrote %s\n" : "lwsr: join into %s failed\n", output);
+    return ok;
+}
+
+BOOL ClipEdit_RunCommandLine(int* exitCode) {
+    LWSR_ASSERT(exitCode != NULL);
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) return FALSE;
+
+    BOOL handled = FALSE;
+    if (argc >= 2 && wcscmp(argv[1], L"--trim") == 0) {
+        handled = TRUE;
+        *exitCode = RunTrim(argc, argv) ? 0 : 1;
+    } else if (argc >= 2 && wcscmp(argv[1], L"--concat") == 0) {
+        handled = TRUE;
+        *exitCode = RunConcat(argc, argv) ? 0 : 1;
+    }
+    LocalFree(argv);
+    return handled;
+}
+
+/* ============================================================================
+ * TOOLBAR DIALOG
+ * ============================================================================
+ * The file picker chooses the operation: one clip is trimmed (a small
+ * range prompt follows), several are joined in name order, which for
+ * timestamped clip names is the order they were saved.
+ */
+
+#define PROMPT_CLASS        L"LWSRClipTrimPrompt"
+#define PROMPT_WIDTH        320
+#define PROMPT_HEIGHT       150
+#define ID_PROMPT_START     101
+#define ID_PROMPT_END       102
+
+typedef struct {
+    HWND startEdit;
+    HWND endEdit;
+    HFONT font;
+    BOOL done;
+    BOOL accepted;
+    LONGLONG start;
+    LONGLONG end;               /* 0 = end of clip */
+} TrimPrompt;
+
+static HWND PromptControl(HWND parent, const WCHAR* cls, const WCHAR* text, DWORD style,
+                          int x, int y, int w, int h, int id, HFONT font) {
+    HWND ctl = CreateWindowExW(wcscmp(cls, L"EDIT") == 0 ? WS_EX_CLIENTEDGE : 0, cls, text,
+                               WS_CHILD | WS_VISIBLE | style, x, y, w, h, parent,
+                               (HMENU)(INT_PTR)id, (HINSTANCE)GetWindowLongPtrW(parent, GWLP_HINSTANCE), NULL);
+    if (ctl) SendMessageW(ctl, WM_SETFONT, (WPARAM)font, TRUE);
+    return ctl;
+}
+
+static LRESULT CALLBACK PromptWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    TrimPrompt* p = (TrimPrompt*)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+
+    switch (msg) {
+        case WM_CREATE: {
+            p = (TrimPrompt*)((CREATESTRUCTW*)lParam)->lpCreateParams;
+            SetWindowLongPtrW(hwnd, GWLP_USERDATA, (LONG_PTR)p);
+            PromptControl(hwnd, L"STATIC", L"Start", 0, 12, 15, 60, 20, 0, p->font);
+            p->startEdit = PromptControl(hwnd, L"EDIT", L"0", WS_TABSTOP | ES_AUTOHSCROLL,
+                                         80, 12, 120, 22, ID_PROMPT_START, p->font);
+            PromptControl(hwnd, L"STATIC", L"End", 0, 12, 45, 60, 20, 0, p->font);
+            p->endEdit = PromptControl(hwnd, L"EDIT", L"", WS_TABSTOP | ES_AUTOHSCROLL,
+                                       80, 42, 120, 22, ID_PROMPT_END, p->font);
+            PromptControl(hwnd, L"STATIC",
+                          L"Seconds, mm:ss or hh:mm:ss. Empty end = end of clip.\n"
+                          L"The start moves back to the previous keyframe.",
+                          0, 12, 72, 296, 34, 0, p->font);
+            PromptControl(hwnd, L"BUTTON", L"Trim", WS_TABSTOP | BS_DEFPUSHBUTTON,
+                          146, 112, 78, 26, IDOK, p->font);
+            PromptControl(hwnd, L"BUTTON", L"Cancel", WS_TABSTOP | BS_PUSHBUTTON,
+                          230, 112, 78, 26, IDCANCEL, p->font);
+            SetFocus(p->startEdit);
+            return 0;
+        }
+
+        case DM_GETDEFID:
+            return MAKELRESULT(IDOK, DC_HASDEFID);
+
+        case WM_COMMAND:
+            if (!p) break;
+            if (LOWORD(wParam) == IDOK) {
+                WCHAR startText[64], endText[64];
+                GetWindowTextW(p->startEdit, startText, 64);
+                GetWindowTextW(p->endEdit, endText, 64);
+                LONGLONG start = 0, end = 0;
+                BOOL valid = ClipEdit_ParseTime(startText, &start) &&
+                             (endText[0] == L'\0' || ClipEdit_ParseTime(endText, &end)) &&
+                             (end == 0 || end > start);
+                if (!valid) {
+                    MessageBoxW(hwnd, L"Enter times as seconds, mm:ss or hh:mm:ss, with the end after the start.",
+                                L"Trim clip", MB_OK | MB_ICONWARNING);
+                    return 0;
+                }
+                p->start = start;
+                p->end = end;
+                p->accepted = TRUE;
+                DestroyWindow(hwnd);
+                return 0;
+            }
+            if (LOWORD(wParam) == IDCANCEL) {
+                DestroyWindow(hwnd);
+                return 0;
+            }
+            break;
+
+        case WM_CLOSE:
+            DestroyWindow(hwnd);
+            return 0;
+
+        case WM_DESTROY:
+            if (p) p->done = TRUE;
+            return 0;
+    }
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+/* Modal range prompt. FALSE if cancelled. */
+static BOOL PromptTrimRange(HWND owner, const WCHAR* clipName, LONGLONG* start, LONGLONG* end) {
+    HINSTANCE instance = GetModuleHandleW(NULL);
+    WNDCLASSEXW wc;
+    ZeroMemory(&wc, sizeof(wc));
+    wc.cbSize = sizeof(wc);
+    wc.lpfnWndProc = PromptWndProc;
+    wc.hInstance = instance;
+    wc.hCursor = LoadCursor(NULL, IDC_ARROW);
+    wc.hbrBackground = (HBRUSH)(COLOR_3DFACE + 1);
+    wc.lpszClassName = PROMPT_CLASS;
+    if (!RegisterClassExW(&wc) && GetLastError() != ERROR_CLASS_ALREADY_EXISTS) return FALSE;
+
+    TrimPrompt prompt;
+    ZeroMemory(&prompt, sizeof(prompt));
+    prompt.font = CreateFontW(14, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+                              DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+                              CLEARTYPE_QUALITY, DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
+
+    RECT rc = {0, 0, PROMPT_WIDTH, PROMPT_HEIGHT};
+    DWORD style = WS_POPUP | WS_CAPTION | WS_SYSMENU;
+    AdjustWindowRectEx(&rc, style, FALSE, WS_EX_DLGMODALFRAME);
+    int w = rc.right - rc.left;
+    int h = rc.bottom - rc.top;
+    RECT ownerRect;
+    GetWindowRect(owner, &ownerRect);
+
+    WCHAR title[MAX_PATH + 16];
+    swprintf(title, MAX_PATH + 16, L"Trim %ls", clipName);
+    HWND wnd = CreateWindowExW(WS_EX_DLGMODALFRAME | WS_EX_TOPMOST, PROMPT_CLASS, title, style,
+                               (ownerRect.left + ownerRect.right - w) / 2, ownerRect.bottom + 5, w, h,
+                               owner, NULL, instance, &prompt);
+    if (!wnd) {
+        if (prompt.font) DeleteObject(prompt.font);
+        return FALSE;
+    }
+
+    EnableWindow(owner, FALSE);
+    ShowWindow(wnd, SW_SHOW);
+    MSG msg;
+    while (!prompt.done) {
+        BOOL got = GetMessageW(&msg, NULL, 0, 0);
+        if (got <= 0) {
+            if (got == 0) PostQuitMessage((int)msg.wParam);  /* Let the main loop see it */
+            if (IsWindow(wnd)) DestroyWindow(wnd);
+            break;
+        }
+        if (!IsDialogMessageW(wnd, &msg)) {
+            TranslateMessage(&msg);
+            DispatchMessageW(&msg);
+        }
+    }
+    EnableWindow(owner, TRUE);
+    SetForegroundWindow(owner);
+    if (prompt.font) DeleteObject(prompt.font);
+
+    *start = prompt.start;
+    *end = prompt.end;
+    return prompt.accepted;
+}
+
+/* input minus ".mp4" plus suffix, numbered until it names no existing file */
+static BOOL OutputPathFor(const WCHAR* input, const WCHAR* suffix, WCHAR* output) {
+    WCHAR stem[MAX_PATH];
+    wcsncpy_s(stem, MAX_PATH, input, _TRUNCATE);
+    WCHAR* dot = wcsrchr(stem, L'.');
+    WCHAR* slash = wcsrchr(stem, L'\\');
+    if (dot && (!slash || dot > slash)) *dot = L'\0';
+
+    for (int n = 1; n < 100; n++) {
+        if (n == 1) swprintf(output, MAX_PATH, L"%ls%ls.mp4", stem, suffix);
+        else swprintf(output, MAX_PATH, L"%ls%ls (%d).mp4", stem, suffix, n);
+        if (GetFileAttributesW(output) == INVALID_FILE_ATTRIBUTES) return TRUE;
+    }
+    return FALSE;
+}
+
+static int CompareNames(const void* a, const void* b) {
+    return _wcsicmp((const WCHAR*)a, (const WCHAR*)b);
+}
+
+/* One toolbar edit, handed to the worker and posted back when it is done */
+typedef struct {
+    HWND owner;
+    int count;                              /* 1 = trim, more = join */
+    LONGLONG start;
+    LONGLONG end;
+    char inputs[MAX_JOIN_INPUTS][MAX_PATH];
+    char outputUtf8[MAX_PATH];
+    WCHAR output[MAX_PATH];
+    BOOL ok;
+    DWORD elapsed;
+} ClipEditJob;
+
+static volatile LONG g_editRunning = FALSE;     /* One edit at a time */
+
+static DWORD WINAPI ClipEditThread(LPVOID param) {
+    ClipEditJob* job = (ClipEditJob*)param;
+    const char* inputPtrs[MAX_JOIN_INPUTS];
+    for (int i = 0; i < job->count; i++) inputPtrs[i] = job->inputs[i];
+
+    DWORD startTick = GetTickCount();
+    job->ok = job->count == 1 ? ClipEdit_Trim(inputPtrs[0], job->outputUtf8, job->start, job->end)
+                              : ClipEdit_Concat(inputPtrs, job->count, job->outputUtf8);
+    job->elapsed = GetTickCount() - startTick;
+
+    if (!PostMessage(job->owner, WM_CLIP_EDIT_COMPLETE, 0, (LPARAM)job)) {
+        EditLog("ClipEdit: could not post the result (%lu)\n", GetLastError());
+        free(job);
+        InterlockedExchange(&g_editRunning, FALSE);
+    }
+    return 0;
+}
+
+void ClipEdit_ShowDialog(HWND owner, const char* folder) {
+    static WCHAR selection[MAX_JOIN_INPUTS * MAX_PATH];
+    static WCHAR paths[MAX_JOIN_INPUTS][MAX_PATH];
+    if (g_editRunning) {
+        MessageBoxW(owner, L"A trim or join is still running; its result shows when it is done.",
+                    L"Clip editor", MB_OK | MB_ICONINFORMATION);
+        return;
+    }
+
+    WCHAR initialDir[MAX_PATH] = L"";
+    if (folder) MultiByteToWideChar(CP_UTF8, 0, folder, -1, initialDir, MAX_PATH);
+
+    selection[0] = L'\0';
+    OPENFILENAMEW ofn;
+    ZeroMemory(&ofn, sizeof(ofn));
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = owner;
+    ofn.lpstrFilter = L"MP4 clips (*.mp4)\0*.mp4\0All files (*.*)\0*.*\0";
+    ofn.lpstrFile = selection;
+    ofn.nMaxFile = (DWORD)(sizeof(selection) / sizeof(selection[0]));
+    ofn.lpstrInitialDir = initialDir[0] ? initialDir : NULL;
+    ofn.lpstrTitle = L"Pick a clip to trim, or several to join";
+    ofn.Flags = OFN_EXPLORER | OFN_ALLOWMULTISELECT | OFN_FILEMUSTEXIST |
+                OFN_PATHMUSTEXIST | OFN_NOCHANGEDIR;
+    if (!GetOpenFileNameW(&ofn)) return;
+
+    /* One file: the full path. Several: the folder, then each name. */
+    int count = 0;
+    const WCHAR* name = selection + wcslen(selection) + 1;
+    if (*name == L'\0') {
+        wcsncpy_s(paths[0], MAX_PATH, selection, _TRUNCATE);
+        count = 1;
+    } else {
+        for (; *name && count < MAX_JOIN_INPUTS; name += wcslen(name) + 1) {
+            swprintf(paths[count++], MAX_PATH, L"%ls\\%ls", selection, name);
+        }
+        qsort(paths, (size_t)count, sizeof(paths[0]), CompareNames);
+    }
+
+    LONGLONG start = 0, end = 0;
+    const WCHAR* clipName = wcsrchr(paths[0], L'\\') ? wcsrchr(paths[0], L'\\') + 1 : paths[0];
+    if (count == 1 && !PromptTrimRange(owner, clipName, &start, &end)) return;
+
+    ClipEditJob* job = (ClipEditJob*)calloc(1, sizeof(ClipEditJob));
+    if (!job) return;
+    job->owner = owner;
+    job->count = count;
+    job->start = start;
+    job->end = end;
+    if (!OutputPathFor(paths[0], count == 1 ? L"_trim" : L"_joined", job->output) ||
+        !ToUtf8(job->output, job->outputUtf8)) {
+        MessageBoxW(owner, L"Could not pick an output file name.", L"Clip editor", MB_OK | MB_ICONERROR);
+        free(job);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!ToUtf8(paths[i], job->inputs[i])) {
+            free(job);
+            return;
+        }
+    }
+
+    /* The read and write take seconds for long clips: off the UI thread */
+    InterlockedExchange(&g_editRunning, TRUE);
+    HANDLE thread = CreateThread(NULL, 0, ClipEditThread, job, 0, NULL);
+    if (!thread) {
+        EditLog("ClipEdit: CreateThread failed (%lu)\n", GetLastError());
+        InterlockedExchange(&g_editRunning, FALSE);
+        free(job);
+        MessageBoxW(owner, L"Could not start the clip edit.", L"Clip editor", MB_OK | MB_ICONERROR);
+        return;
+    }
+    CloseHandle(thread);
+}
+
+void ClipEdit_OnComplete(HWND owner, LPARAM lParam) {
+    ClipEditJob* job = (ClipEditJob*)lParam;
+    InterlockedExchange(&g_editRunning, FALSE);
+    if (!job) return;
+
+    WCHAR message[MAX_PATH + 128];
+    if (job->ok) {
+        swprintf(message, MAX_PATH + 128, L"Saved %ls\n(%lu ms, no re-encode)", job->output, job->elapsed);
+    } else {
+        swprintf(message, MAX_PATH + 128, L"Could not %ls the selected clip%ls.\n"
+                 L"Only clips from this recorder with matching settings can be combined; "
+                 L"the debug log has details.", job->count == 1 ? L"trim" : L"join", job->count == 1 ? L"" : L"s");
+    }
+    BOOL ok = job->ok;
+    free(job);
+    MessageBoxW(owner, message, L"Clip editor", MB_OK | (ok ? MB_ICONINFORMATION : MB_ICONWARNING));
+}
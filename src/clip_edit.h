@@ -0,0 +1,51 @@
+/*
+ * clip_edit.h - Lossless trim and concatenate for saved MP4 clips
+ *
+ * USED BY: main.c (command line), overlay.c (action toolbar)
+ *
+ * Stream copy, no re-encode: clips are read back with mp4_reader.c into
+ * MuxerSample arrays and written again with MP4Writer_WriteFile. Every
+ * clip this app writes starts on an IDR and has an IDR every
+ * GOP_LENGTH_FRAMES_AT(fps) frames with no B-frames, so a trim starts at
+ * the last IDR at or before the requested start (at most half a second
+ * early) and can end on any frame. Only the selected span of the source is
+ * read, a bounded window at a time (MP4Writer_WriteFileStreamed).
+ *
+ * Command line (runs headless, then exits; result on the parent console):
+ *   lwsr.exe --trim <input.mp4> <output.mp4> <start> [<end>]
+ *   lwsr.exe --concat <output.mp4> <input1.mp4> <input2.mp4> ...
+ * Times are seconds, mm:ss or hh:mm:ss, fractions allowed.
+ */
+
+#ifndef CLIP_EDIT_H
+#define CLIP_EDIT_H
+
+#include <windows.h>
+
+// Copy [start, end) of input (100ns from the clip's first frame; end <= 0
+// means to the end) to output. Paths are UTF-8 and must differ.
+BOOL ClipEdit_Trim(const char* inputPath, const char* outputPath,
+                   LONGLONG start, LONGLONG end);
+
+// Join inputs in order into output. Inputs must come from the same
+// encoder setup (identical resolution, parameter sets and audio tracks).
+BOOL ClipEdit_Concat(const char* const* inputPaths, int inputCount,
+                     const char* outputPath);
+
+// Parse "90", "1:30" or "1:02:03.5" into 100ns units
+BOOL ClipEdit_ParseTime(const WCHAR* text, LONGLONG* time);
+
+// Run --trim / --concat if the process command line has one. Returns TRUE
+// if it did (*exitCode: 0 on success), FALSE to continue normal startup.
+BOOL ClipEdit_RunCommandLine(int* exitCode);
+
+// Toolbar action: pick clips in folder (UTF-8), then trim one (prompting
+// for the range) or join several. The pickers are modal on owner; the edit
+// runs on a worker thread that posts WM_CLIP_EDIT_COMPLETE to owner, and
+// until then the action only says an edit is running. UI thread only.
+void ClipEdit_ShowDialog(HWND owner, const char* folder);
+
+// WM_CLIP_EDIT_COMPLETE handler: show the result and free lParam
+void ClipEdit_OnComplete(HWND owner, LPARAM lParam);
+
+#endif // CLIP_EDIT_H
@@ -0,0 +1,133 @@
+/*
+ * clip_index.c - Seek index sidecar for saved clips
+ *
+ * USES: mp4_reader.c (sample tables of the written file)
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Goto-cleanup once the clip is open (clip, output file)
+ * - A partly written sidecar is deleted
+ */
+
+#include "clip_index.h"
+#include "mp4_reader.h"
+#include "util.h"
+#include "logger.h"
+#include "constants.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Alias for logging */
+#define IndexLog Logger_Log
+
+/* videoPath with its extension replaced by suffix */
+static BOOL SidecarPath(const char* videoPath, const char* suffix, char* out) {
+    size_t stem = strlen(videoPath);
+    for (size_t i = stem; i > 0; i--) {
+        char c = videoPath[i - 1];
+        if (c == '\\' || c == '/') break;
+        if (c == '.') {
+            stem = i - 1;
+            break;
+        }
+    }
+    if (stem + strlen(suffix) + 1 > MAX_PATH) return FALSE;
+    memcpy(out, videoPath, stem);
+    strcpy_s(out + stem, MAX_PATH - stem, suffix);
+    return TRUE;
+}
+
+static double Seconds(LONGLONG hns) {
+    return (double)hns / MF_UNITS_PER_SECOND;
+}
+
+BOOL ClipIndex_WriteSidecar(const char* videoPath, const MarkerList* markers,
+                            ULONGLONG startMs, ULONGLONG endMs) {
+    LWSR_ASSERT(videoPath != NULL);
+    if (!videoPath) return FALSE;
+
+    char indexPath[MAX_PATH];
+    WCHAR wIndexPath[MAX_PATH];
+    if (!SidecarPath(videoPath, ".index.json", indexPath) ||
+        Util_Utf8ToWide(indexPath, wIndexPath, MAX_PATH) == 0) {
+        IndexLog("ClipIndex: path too long for %s\n", videoPath);
+        return FALSE;
+    }
+
+    MP4Clip clip;
+    if (!MP4Reader_Open(videoPath, &clip)) return FALSE;
+
+    BOOL result = FALSE;
+    FILE* f = _wfopen(wIndexPath, L"w");
+    if (!f) {
+        IndexLog("ClipIndex: failed to create %s\n", indexPath);
+        goto cleanup;
+    }
+
+    const MuxerSample* v = clip.videoSamples;
+    LONGLONG origin = v[0].timestamp;
+    const MuxerSample* last = &v[clip.videoCount - 1];
+    UINT64 videoBytes = 0;
+    DWORD minSize = MAXDWORD, maxSize = 0;
+    for (int i = 0; i < clip.videoCount; i++) {
+        videoBytes += v[i].size;
+        if (v[i].size < minSize) minSize = v[i].size;
+        if (v[i].size > maxSize) maxSize = v[i].size;
+    }
+
+    const char* name = videoPath;
+    for (const char* p = videoPath; *p; p++) {
+        if (*p == '\\' || *p == '/') name = p + 1;
+    }
+
+    fprintf(f, "{\"version\":1,\"video\":\"%s\",\"width\":%d,\"height\":%d,\"fps\":%d,"
+               "\"duration\":%.3f,\"frames\":%d,\"audio_tracks\":%d,\"video_bytes\":%llu,\n",
+            name, clip.video.width, clip.video.height, clip.video.fps,
+            Seconds(last->timestamp + last->duration - origin), clip.videoCount,
+            clip.audioTrackCount, videoBytes);
+    fprintf(f, "\"frame_bytes\":{\"min\":%lu,\"max\":%lu,\"avg\":%llu},\n\"gops\":[\n",
+            minSize, maxSize, videoBytes / (UINT64)clip.videoCount);
+
+    /* One line per GOP: keyframe to the frame before the next keyframe */
+    int gops = 0;
+    for (int first = 0; first < clip.videoCount; gops++) {
+        int end = first + 1;
+        while (end < clip.videoCount && !v[end].isKeyframe) end++;
+        UINT64 gopBytes = 0;
+        for (int i = first; i < end; i++) gopBytes += v[i].size;
+
+        fprintf(f, "%s{\"t\":%.3f,\"frame\":%d,\"offset\":%llu,\"bytes\":%llu,\"sizes\":[",
+                gops ? ",\n" : "", Seconds(v[first].timestamp - origin), first,
+                clip.videoOffsets[first], gopBytes);
+        for (int i = first; i < end; i++) fprintf(f, i > first ? ",%lu" : "%lu", v[i].size);
+        fputs("]}", f);
+        first = end;
+    }
+
+    fputs("\n],\n\"markers\":[", f);
+    int markerCount = 0;
+    int total = markers ? Markers_GetCount(markers) : 0;
+    for (int i = 0; i < total; i++) {
+        ULONGLONG ts = markers->markers[i].timestampMs;
+        if (ts < startMs || ts > endMs) continue;
+        fprintf(f, markerCount++ ? ",%.3f" : "%.3f", (double)(ts - startMs) / 1000.0);
+    }
+    fputs("]}\n", f);
+
+    BOOL writeFailed = ferror(f) != 0;
+    if (fclose(f) != 0) writeFailed = TRUE;
+    f = NULL;
+    if (writeFailed) {
+        IndexLog("ClipIndex: write failed for %s\n", indexPath);
+        DeleteFileW(wIndexPath);
+        goto cleanup;
+    }
+
+    result = TRUE;
+    IndexLog("ClipIndex: %s: %d GOPs, %d frames, %d markers\n", indexPath, gops, clip.videoCount, markerCount);
+
+cleanup:
+    if (f) fclose(f);
+    MP4Reader_Close(&clip);
+    return result;
+}
@@ -0,0 +1,36 @@
+/*
+ * clip_index.h - Seek index sidecar for saved clips
+ *
+ * USED BY: overlay.c (after replay saves and recordings, [Advanced] SaveIndex)
+ *
+ * Writes <clip>.index.json next to a finished MP4 so post-processing tools
+ * can seek, thumbnail and find bitrate spikes without demuxing it. The
+ * index is read back from the file's own sample tables (mp4_reader.c, no
+ * payload reads), so it matches the file byte for byte whichever muxer
+ * path wrote it. Layout (times in seconds from the first frame):
+ *
+ *   { "version": 1, "video": "<name>.mp4",
+ *     "width": W, "height": H, "fps": F, "duration": s,
+ *     "frames": N, "audio_tracks": A, "video_bytes": B,
+ *     "frame_bytes": { "min": ., "max": ., "avg": . },
+ *     "gops": [ { "t": s, "frame": i, "offset": o, "bytes": b,
+ *                 "sizes": [ ... ] }, ... ],
+ *     "markers": [ s, ... ] }
+ *
+ * offset is the file offset of the GOP's keyframe; sizes are the GOP's
+ * frames in order.
+ */
+
+#ifndef CLIP_INDEX_H
+#define CLIP_INDEX_H
+
+#include <windows.h>
+#include "markers.h"
+
+// Write the sidecar for videoPath (UTF-8). markers may be NULL; only those
+// in [startMs, endMs] (GetTickCount64 values, startMs = first frame) are
+// listed. Returns FALSE if the clip cannot be indexed or the file written.
+BOOL ClipIndex_WriteSidecar(const char* videoPath, const MarkerList* markers,
+                            ULONGLONG startMs, ULONGLONG endMs);
+
+#endif // CLIP_INDEX_H
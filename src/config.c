@@ -67,6 +67,7 @@ void Config_Load(AppConfig* config) {
     config->replayCaptureSource = MODE_MONITOR;
     config->replayMonitorIndex = 0;  // Primary monitor
     config->replaySaveKey = VK_F9;  // F9 to save replay
+    config->continuousSaveKey = 0;  // Tray menu only
     
     // Default replay area (will be centered on screen when first used)
     config->replayAreaRect.left = 0;
@@ -74,6 +75,10 @@ void Config_Load(AppConfig* config) {
     config->replayAreaRect.right = 0;
     config->replayAreaRect.bottom = 0;
     config->replayAspectRatio = 0;  // Native (no aspect ratio cropping)
+    config->replayOutputHeight = 0; // Native (encode at capture size)
+    config->replaySpillPath[0] = '\0';  // Whole buffer in RAM
+    config->replaySpillHotSeconds = REPLAY_SPILL_HOT_DEFAULT_SECS;
+    config->replayMemoryBudgetMB = 0;  // Duration-limited only
     config->replayFPS = DEFAULT_FPS;  // 60 FPS default
     
     // Audio defaults (disabled, no sources selected)
@@ -87,15 +92,19 @@ void Config_Load(AppConfig* config) {
     
     // Marker settings
     config->markerKey = VK_F6;  // F6 to drop a marker
+    config->markerClipSec = 0;  // Markers only tag the timeline
 
     // Debug logging (disabled by default)
     config->debugLogging = FALSE;
+    config->debugLogBinary = FALSE;
+    config->debugAllocProfile = FALSE;
     
     // Auto-clip defaults (disabled, no player name, no regions)
     config->autoClipEnabled = FALSE;
     config->autoClipShowRegions = FALSE;
     config->autoClipCooldownSec = 10;
     config->autoClipDelaySec = 10;
+    config->autoClipClipSec = 0;
     
     // Default save path to Videos folder.
     // Note: SHGetFolderPathA is deprecated since Vista in favor of SHGetKnownFolderPath
@@ -114,6 +123,39 @@ void Config_Load(AppConfig* config) {
     // Advanced (INI-only). Default CFR keeps editor/player compatibility; flip to VFR
     // only if you understand the tradeoff (see [Advanced] FrameTiming in lwsr_config.ini).
     config->frameTimingMode = FRAME_TIMING_CFR;
+    // Async NVENC lets the capture thread run ahead of the encoder by up to
+    // NUM_BUFFERS frames. Set AsyncEncode=0 to force the old blocking path.
+    config->asyncEncode = TRUE;
+    // Replay FrameBuffer stores frames in one preallocated arena instead of a
+    // heap block per frame. Set FrameArena=0 for the per-frame malloc path.
+    config->frameArena = TRUE;
+    // Opt-in: with a MemoryBudgetMB set, the arena tries a budget-sized block
+    // of large pages first (needs SeLockMemoryPrivilege, falls back
+    // silently). Large pages are locked and committed whole, so off by default.
+    config->largePages = FALSE;
+    // Replay saves are written by mp4_writer.c, falling back to the Media
+    // Foundation sink writer if it fails. Set NativeMuxer=0 to always use MF.
+    config->nativeMuxer = TRUE;
+    // Streaming recordings are fragmented MP4: close is instant, sample tables
+    // never grow and a crash keeps everything up to the last GOP. Set
+    // FragmentedRecording=0 for a Media Foundation file with one moov.
+    config->fragmentedRecording = TRUE;
+    // Seek index sidecar for post-processing tools; off unless asked for.
+    config->saveIndex = FALSE;
+    // Cover art and scrub thumbnails cost a few hundred KB per clip.
+    config->clipThumbnails = TRUE;
+    // HEVC plays everywhere; AV1 buys more replay seconds per MB of RAM.
+    config->codec = CODEC_HEVC;
+    // Event-driven WASAPI capture; EventAudio=0 restores 5 ms polling.
+    config->eventAudio = TRUE;
+    // Per-source tracks live-encoded; PCM-until-save trades RAM for CPU.
+    config->deferredSourceAudio = FALSE;
+    // Long uptimes drift tens of ms per hour without it.
+    config->audioDriftCorrection = TRUE;
+    // Digital silence only, so tracks sound the same either way.
+    config->silenceGate = TRUE;
+    // CPU matcher by default; the GPU one competes with the game for shader time.
+    config->gpuKillFeed = FALSE;
 
     // Load from INI if exists
     if (GetFileAttributesA(configPath) != INVALID_FILE_ATTRIBUTES) {
@@ -141,6 +183,8 @@ void Config_Load(AppConfig* config) {
             "ReplayBuffer", "MonitorIndex", 0, configPath);
         config->replaySaveKey = GetPrivateProfileIntA(
             "ReplayBuffer", "SaveKey", VK_F9, configPath);
+        config->continuousSaveKey = GetPrivateProfileIntA(
+            "ReplayBuffer", "ContinuousSaveKey", 0, configPath);
         config->replayAreaRect.left = GetPrivateProfileIntA(
             "ReplayBuffer", "AreaLeft", 200, configPath);
         config->replayAreaRect.top = GetPrivateProfileIntA(
@@ -153,6 +197,14 @@ void Config_Load(AppConfig* config) {
             "ReplayBuffer", "AspectRatio", 0, configPath);
         config->replayFPS = GetPrivateProfileIntA(
             "ReplayBuffer", "FPS", 60, configPath);
+        config->replayOutputHeight = GetPrivateProfileIntA(
+            "ReplayBuffer", "OutputHeight", 0, configPath);
+        GetPrivateProfileStringA("ReplayBuffer", "SpillPath", "",
+            config->replaySpillPath, sizeof(config->replaySpillPath), configPath);
+        config->replaySpillHotSeconds = GetPrivateProfileIntA(
+            "ReplayBuffer", "SpillHotSeconds", REPLAY_SPILL_HOT_DEFAULT_SECS, configPath);
+        config->replayMemoryBudgetMB = GetPrivateProfileIntA(
+            "ReplayBuffer", "MemoryBudgetMB", 0, configPath);
         
         // Audio settings
         config->audioEnabled = GetPrivateProfileIntA(
@@ -170,9 +222,13 @@ void Config_Load(AppConfig* config) {
         // Marker hotkey
         config->markerKey = GetPrivateProfileIntA(
             "Markers", "Key", VK_F6, configPath);
+        config->markerClipSec = GetPrivateProfileIntA(
+            "Markers", "ClipSeconds", 0, configPath);
 
         // Debug logging
         config->debugLogging = GetPrivateProfileIntA("Debug", "Logging", 0, configPath);
+        config->debugLogBinary = GetPrivateProfileIntA("Debug", "BinaryLog", 0, configPath);
+        config->debugAllocProfile = GetPrivateProfileIntA("Debug", "AllocProfile", 0, configPath);
         
         // Auto-clip settings (global; per-game region/cooldown live in
         // [AutoClip.<id>] sections, owned by game_profile.c)
@@ -182,6 +238,8 @@ void Config_Load(AppConfig* config) {
             "AutoClip", "CooldownSec", 10, configPath);
         config->autoClipDelaySec = GetPrivateProfileIntA(
             "AutoClip", "DelaySec", 10, configPath);
+        config->autoClipClipSec = GetPrivateProfileIntA(
+            "AutoClip", "ClipSeconds", 0, configPath);
         
         GetPrivateProfileStringA("Recording", "SavePath", config->savePath,
             config->savePath, MAX_PATH, configPath);
@@ -208,6 +266,34 @@ void Config_Load(AppConfig* config) {
         } else {
             config->frameTimingMode = FRAME_TIMING_CFR;
         }
+        config->asyncEncode = GetPrivateProfileIntA(
+            "Advanced", "AsyncEncode", 1, configPath) != 0;
+        config->frameArena = GetPrivateProfileIntA(
+            "Advanced", "FrameArena", 1, configPath) != 0;
+        config->largePages = GetPrivateProfileIntA(
+            "Advanced", "LargePages", 0, configPath) != 0;
+        config->nativeMuxer = GetPrivateProfileIntA(
+            "Advanced", "NativeMuxer", 1, configPath) != 0;
+        config->fragmentedRecording = GetPrivateProfileIntA(
+            "Advanced", "FragmentedRecording", 1, configPath) != 0;
+        config->saveIndex = GetPrivateProfileIntA(
+            "Advanced", "SaveIndex", 0, configPath) != 0;
+        config->clipThumbnails = GetPrivateProfileIntA(
+            "Advanced", "ClipThumbnails", 1, configPath) != 0;
+        char codecStr[16] = "";
+        GetPrivateProfileStringA("Advanced", "Codec", "hevc",
+            codecStr, sizeof(codecStr), configPath);
+        config->codec = _stricmp(codecStr, "av1") == 0 ? CODEC_AV1 : CODEC_HEVC;
+        config->eventAudio = GetPrivateProfileIntA(
+            "Advanced", "EventAudio", 1, configPath) != 0;
+        config->deferredSourceAudio = GetPrivateProfileIntA(
+            "Advanced", "DeferredSourceAudio", 0, configPath) != 0;
+        config->audioDriftCorrection = GetPrivateProfileIntA(
+            "Advanced", "AudioDriftCorrection", 1, configPath) != 0;
+        config->silenceGate = GetPrivateProfileIntA(
+            "Advanced", "SilenceGate", 1, configPath) != 0;
+        config->gpuKillFeed = GetPrivateProfileIntA(
+            "Advanced", "GpuKillFeed", 0, configPath) != 0;
 
         // Validate/clamp loaded values to prevent corrupted INI from causing issues.
         // Defend at point of use: INI is an untrusted boundary (user-editable).
@@ -238,6 +324,10 @@ void Config_Load(AppConfig* config) {
             config->autoClipDelaySec = AUTOCLIP_DELAY_MIN_SEC;
         if (config->autoClipDelaySec > AUTOCLIP_DELAY_MAX_SEC)
             config->autoClipDelaySec = AUTOCLIP_DELAY_MAX_SEC;
+        if (config->autoClipClipSec < 0)
+            config->autoClipClipSec = 0;
+        if (config->autoClipClipSec > AUTOCLIP_CLIP_MAX_SEC)
+            config->autoClipClipSec = AUTOCLIP_CLIP_MAX_SEC;
 
         // Hotkey virtual-key codes: valid VK range is 0x01..0xFE (0 = none/disabled).
         // Out-of-range values would silently fail RegisterHotKey later; reset to defaults.
@@ -245,8 +335,14 @@ void Config_Load(AppConfig* config) {
             config->cancelKey = VK_ESCAPE;
         if (config->replaySaveKey < 0 || config->replaySaveKey > 0xFE)
             config->replaySaveKey = VK_F9;
+        if (config->continuousSaveKey < 0 || config->continuousSaveKey > 0xFE)
+            config->continuousSaveKey = 0;
         if (config->markerKey < 0 || config->markerKey > 0xFE)
             config->markerKey = VK_F6;
+        if (config->markerClipSec < 0)
+            config->markerClipSec = 0;
+        if (config->markerClipSec > REPLAY_RANGE_SAVE_MAX_AFTER_SEC)
+            config->markerClipSec = REPLAY_RANGE_SAVE_MAX_AFTER_SEC;
 
         if (config->replayMonitorIndex < 0)
             config->replayMonitorIndex = 0;
@@ -255,6 +351,22 @@ void Config_Load(AppConfig* config) {
         if (config->replayAspectRatio < 0 || config->replayAspectRatio > 8)
             config->replayAspectRatio = 0;
 
+        // Output height: 0 = native; otherwise a sane encode height.
+        if (config->replayOutputHeight != 0 &&
+            (config->replayOutputHeight < REPLAY_OUTPUT_HEIGHT_MIN ||
+             config->replayOutputHeight > REPLAY_OUTPUT_HEIGHT_MAX))
+            config->replayOutputHeight = 0;
+        if (config->replaySpillHotSeconds < REPLAY_SPILL_HOT_MIN_SECS)
+            config->replaySpillHotSeconds = REPLAY_SPILL_HOT_MIN_SECS;
+        if (config->replaySpillHotSeconds > REPLAY_DURATION_MAX_SECS)
+            config->replaySpillHotSeconds = REPLAY_DURATION_MAX_SECS;
+        if (config->replayMemoryBudgetMB < 0)
+            config->replayMemoryBudgetMB = 0;
+        if (config->replayMemoryBudgetMB > 0 && config->replayMemoryBudgetMB < REPLAY_MEMORY_BUDGET_MIN_MB)
+            config->replayMemoryBudgetMB = REPLAY_MEMORY_BUDGET_MIN_MB;
+        if (config->replayMemoryBudgetMB > REPLAY_MEMORY_BUDGET_MAX_MB)
+            config->replayMemoryBudgetMB = REPLAY_MEMORY_BUDGET_MAX_MB;
+
         // CaptureMode enum bounds (MODE_NONE..MODE_MONITOR).
         if ((int)config->replayCaptureSource < MODE_NONE ||
             (int)config->replayCaptureSource > MODE_MONITOR)
@@ -329,6 +441,8 @@ void Config_Save(const AppConfig* config) {
     
     snprintf(buffer, sizeof(buffer), "%d", config->replaySaveKey);
     WritePrivateProfileStringA("ReplayBuffer", "SaveKey", buffer, configPath);
+    snprintf(buffer, sizeof(buffer), "%d", config->continuousSaveKey);
+    WritePrivateProfileStringA("ReplayBuffer", "ContinuousSaveKey", buffer, configPath);
     
     snprintf(buffer, sizeof(buffer), "%ld", config->replayAreaRect.left);
     WritePrivateProfileStringA("ReplayBuffer", "AreaLeft", buffer, configPath);
@@ -345,6 +459,15 @@ void Config_Save(const AppConfig* config) {
     snprintf(buffer, sizeof(buffer), "%d", config->replayFPS);
     WritePrivateProfileStringA("ReplayBuffer", "FPS", buffer, configPath);
     
+    snprintf(buffer, sizeof(buffer), "%d", config->replayOutputHeight);
+    WritePrivateProfileStringA("ReplayBuffer", "OutputHeight", buffer, configPath);
+    
+    WritePrivateProfileStringA("ReplayBuffer", "SpillPath", config->replaySpillPath, configPath);
+    snprintf(buffer, sizeof(buffer), "%d", config->replaySpillHotSeconds);
+    WritePrivateProfileStringA("ReplayBuffer", "SpillHotSeconds", buffer, configPath);
+    snprintf(buffer, sizeof(buffer), "%d", config->replayMemoryBudgetMB);
+    WritePrivateProfileStringA("ReplayBuffer", "MemoryBudgetMB", buffer, configPath);
+    
     // Audio settings
     snprintf(buffer, sizeof(buffer), "%d", config->audioEnabled);
     WritePrivateProfileStringA("Audio", "Enabled", buffer, configPath);
@@ -361,10 +484,16 @@ void Config_Save(const AppConfig* config) {
     // Marker settings
     snprintf(buffer, sizeof(buffer), "%d", config->markerKey);
     WritePrivateProfileStringA("Markers", "Key", buffer, configPath);
+    snprintf(buffer, sizeof(buffer), "%d", config->markerClipSec);
+    WritePrivateProfileStringA("Markers", "ClipSeconds", buffer, configPath);
 
     // Debug logging
     snprintf(buffer, sizeof(buffer), "%d", config->debugLogging);
     WritePrivateProfileStringA("Debug", "Logging", buffer, configPath);
+    snprintf(buffer, sizeof(buffer), "%d", config->debugLogBinary);
+    WritePrivateProfileStringA("Debug", "BinaryLog", buffer, configPath);
+    snprintf(buffer, sizeof(buffer), "%d", config->debugAllocProfile);
+    WritePrivateProfileStringA("Debug", "AllocProfile", buffer, configPath);
     
     // Auto-clip settings (global; per-game region/cooldown is persisted by
     // game_profile.c into [AutoClip.<id>] sections)
@@ -374,6 +503,8 @@ void Config_Save(const AppConfig* config) {
     WritePrivateProfileStringA("AutoClip", "CooldownSec", buffer, configPath);
     snprintf(buffer, sizeof(buffer), "%d", config->autoClipDelaySec);
     WritePrivateProfileStringA("AutoClip", "DelaySec", buffer, configPath);
+    snprintf(buffer, sizeof(buffer), "%d", config->autoClipClipSec);
+    WritePrivateProfileStringA("AutoClip", "ClipSeconds", buffer, configPath);
     
     WritePrivateProfileStringA("Recording", "SavePath", config->savePath, configPath);
     
@@ -396,6 +527,32 @@ void Config_Save(const AppConfig* config) {
     // self-documenting for power users who open it in a text editor.
     WritePrivateProfileStringA("Advanced", "FrameTiming",
         config->frameTimingMode == FRAME_TIMING_VFR ? "vfr" : "cfr", configPath);
+    WritePrivateProfileStringA("Advanced", "AsyncEncode",
+        config->asyncEncode ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "FrameArena",
+        config->frameArena ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "LargePages",
+        config->largePages ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "NativeMuxer",
+        config->nativeMuxer ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "FragmentedRecording",
+        config->fragmentedRecording ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "SaveIndex",
+        config->saveIndex ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "ClipThumbnails",
+        config->clipThumbnails ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "Codec",
+        config->codec == CODEC_AV1 ? "av1" : "hevc", configPath);
+    WritePrivateProfileStringA("Advanced", "EventAudio",
+        config->eventAudio ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "DeferredSourceAudio",
+        config->deferredSourceAudio ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "AudioDriftCorrection",
+        config->audioDriftCorrection ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "SilenceGate",
+        config->silenceGate ? "1" : "0", configPath);
+    WritePrivateProfileStringA("Advanced", "GpuKillFeed",
+        config->gpuKillFeed ? "1" : "0", configPath);
 }
 
 const char* Config_GetFormatExtension(OutputFormat format) {
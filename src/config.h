@@ -35,6 +35,12 @@ typedef enum {
     FRAME_TIMING_VFR       // Honest variable frame rate; each frame carries its real capture PTS
 } FrameTimingMode;
 
+// Video codec (advanced, no UI; INI-only)
+typedef enum {
+    CODEC_HEVC = 0,        // H.265, every NVENC generation since Maxwell 2nd gen
+    CODEC_AV1              // AV1 (RTX 40 and newer); falls back to HEVC when unsupported
+} VideoCodec;
+
 typedef struct {
     // Recording settings
     OutputFormat outputFormat;
@@ -52,9 +58,14 @@ typedef struct {
     CaptureMode replayCaptureSource; // What to capture for replay
     int replayMonitorIndex;          // Which monitor (if MODE_MONITOR)
     int replaySaveKey;               // Hotkey to save replay (default: F9)
+    int continuousSaveKey;           // INI-only ContinuousSaveKey: start/stop a continuous save (0 = none)
     RECT replayAreaRect;             // Custom area for replay (if MODE_AREA)
     int replayAspectRatio;           // See Util_GetAspectRatioDimensions: 0=Native, 1=16:9, 6=4:3, 7=21:9, etc.
     int replayFPS;                   // 30, 60, 120, or 240
+    int replayOutputHeight;          // [ReplayBuffer] OutputHeight: 0 = encode at capture size, else GPU-downscale to this height (aspect kept)
+    char replaySpillPath[MAX_PATH];  // INI-only SpillPath: directory for the on-disk tier (empty = RAM only)
+    int replaySpillHotSeconds;       // INI-only SpillHotSeconds: seconds kept in RAM when spilling
+    int replayMemoryBudgetMB;        // INI-only MemoryBudgetMB: hard cap on replay RAM (frames + audio), 0 = none
     
     // Audio capture settings
     BOOL audioEnabled;               // Enable audio capture
@@ -70,9 +81,12 @@ typedef struct {
     
     // Marker settings
     int markerKey;                   // Hotkey to drop a marker (default: VK_F6)
+    int markerClipSec;               // INI-only ClipSeconds: also save +/-N seconds around a replay marker (0 = off)
 
     // Debug/logging settings
     BOOL debugLogging;               // Enable debug logging to file (includes leak tracking)
+    BOOL debugLogBinary;             // INI-only [Debug] BinaryLog: write .lwlog (decode with lwsr_logdecode.exe)
+    BOOL debugAllocProfile;          // INI-only [Debug] AllocProfile: per-subsystem byte accounting (leak_tracker.h)
     
     // Auto-clip settings (kill feed detection) — per-game profile data
     // (templates, region, cooldown) lives in game_profile.h / [AutoClip.<id>]
@@ -80,6 +94,7 @@ typedef struct {
     BOOL autoClipShowRegions;        // Draw detection region overlay (debug/calibration)
     int autoClipCooldownSec;         // Default cooldown when profile has none (5-30)
     int autoClipDelaySec;            // Seconds to wait after kill before saving (0-30)
+    int autoClipClipSec;             // INI-only ClipSeconds: save only the last N seconds (0 = whole buffer)
     
     // Last capture area (for quick re-record)
     RECT lastCaptureRect;
@@ -87,6 +102,48 @@ typedef struct {
 
     // Advanced: not exposed in any UI. Edit lwsr_config.ini [Advanced] FrameTiming.
     FrameTimingMode frameTimingMode;
+    // Advanced: [Advanced] AsyncEncode. NVENC async mode (encode overlaps capture).
+    BOOL asyncEncode;
+    // Advanced: [Advanced] FrameArena. Replay frames in one preallocated byte arena.
+    BOOL frameArena;
+    // Advanced: [Advanced] LargePages (default off). With a memory budget, back
+    // the budget-sized arena with large pages when the account holds "Lock
+    // pages in memory"; otherwise it is committed on demand.
+    BOOL largePages;
+    // Advanced: [Advanced] NativeMuxer. Replay saves use the built-in MP4
+    // writer (mp4_writer.c); Media Foundation only as fallback.
+    BOOL nativeMuxer;
+    // Advanced: [Advanced] FragmentedRecording. Recordings and continuous saves
+    // are written as fragmented MP4 (one fragment per GOP) by mp4_writer.c.
+    BOOL fragmentedRecording;
+    // Advanced: [Advanced] SaveIndex. Write a <clip>.index.json seek index
+    // (per-GOP offsets, frame sizes, markers) next to every save (clip_index.c).
+    BOOL saveIndex;
+    // Advanced: [Advanced] ClipThumbnails. Replay saves by the native writer
+    // embed a poster frame and per-GOP thumbnails from the preview tap
+    // (preview_tap.c).
+    BOOL clipThumbnails;
+    // Advanced: [Advanced] Codec. "hevc" or "av1". AV1 needs an NVENC with AV1
+    // support; encoders without it fall back to HEVC (nvenc_encoder.c).
+    VideoCodec codec;
+    // Advanced: [Advanced] EventAudio. WASAPI sources wake on buffer events
+    // instead of polling every AUDIO_POLL_INTERVAL_MS (audio_capture.c).
+    BOOL eventAudio;
+    // Advanced: [Advanced] DeferredSourceAudio. Per-source tracks are kept as
+    // raw PCM and AAC-encoded only when a save needs them (replay_buffer.c).
+    // Saves ~one AAC encoder's CPU per source; costs ~190 KB/s RAM per source.
+    BOOL deferredSourceAudio;
+    // Advanced: [Advanced] AudioDriftCorrection. Resample each source to its
+    // measured clock drift against QPC so long buffers stay in sync (audio_capture.c).
+    BOOL audioDriftCorrection;
+    // Advanced: [Advanced] SilenceGate. Silent stretches of live-encoded
+    // per-source tracks skip the encoder and share one cached silent AAC
+    // frame in the store (replay_buffer.c).
+    BOOL silenceGate;
+    // Advanced: [Advanced] GpuKillFeed. Kill-feed template matching runs in
+    // D3D11 compute shaders on the capture device and reads back one result
+    // per scan instead of the region's pixels (kill_feed_sampler.c).
+    BOOL gpuKillFeed;
 
 } AppConfig;
 
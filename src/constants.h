@@ -50,8 +50,9 @@
  *   LWSR_ASSERT(count <= capacity);
  */
 
-// Forward declaration of Logger_Log (to avoid circular include)
+// Forward declarations from logger.h (to avoid circular include)
 void Logger_Log(const char* fmt, ...);
+void Logger_LogCritical(const char* fmt, ...);
 
 #ifdef LWSR_DISABLE_ASSERTS
     #define LWSR_ASSERT(expr)          ((void)0)
@@ -60,7 +61,7 @@ void Logger_Log(const char* fmt, ...);
     #define LWSR_ASSERT(expr) \
         do { \
             if (!(expr)) { \
-                Logger_Log("ASSERTION FAILED: %s at %s:%d in %s()\n", \
+                Logger_LogCritical("ASSERTION FAILED: %s at %s:%d in %s()\n", \
                            #expr, __FILE__, __LINE__, __func__); \
                 assert(expr); \
             } \
@@ -69,7 +70,7 @@ void Logger_Log(const char* fmt, ...);
     #define LWSR_ASSERT_MSG(expr, msg) \
         do { \
             if (!(expr)) { \
-                Logger_Log("ASSERTION FAILED: %s - %s at %s:%d in %s()\n", \
+                Logger_LogCritical("ASSERTION FAILED: %s - %s at %s:%d in %s()\n", \
                            #expr, msg, __FILE__, __LINE__, __func__); \
                 assert(expr); \
             } \
@@ -105,6 +106,64 @@ void Logger_Log(const char* fmt, ...);
  */
 #define MAX_AUDIO_TRACKS            8
 
+/* ============================================================================
+ * NATIVE MP4 WRITER
+ * ============================================================================
+ * mp4_writer.c writes replay saves without Media Foundation.
+ *
+ * MP4_INTERLEAVE_MS: Tracks are interleaved in chunks of this span (each
+ *   track's samples for the window form one chunk). Half a second keeps the
+ *   chunk tables a few entries per second per track while players never
+ *   read far ahead of other tracks.
+ *
+ * MP4_VIDEO_TIMESCALE: Video media timescale (ticks per second). 90 kHz
+ *   divides every common frame rate exactly. Audio uses its sample rate.
+ *
+ * MP4_PLAN_SLICE_SAMPLES: Samples per thread pool work item when sizes
+ *   are measured (a start-code scan per video frame). 64 frames is a few
+ *   MB of payload at high bitrates: big enough to dwarf the dispatch, small
+ *   enough that a 30 s clip splits across every core.
+ *
+ * MP4_FETCH_WINDOW_MB: Stored payload a streamed write (clip trim / join)
+ *   asks the reader for at once while measuring sizes. Writing fetches one
+ *   chunk (MP4_INTERLEAVE_MS of one track) at a time, so this bounds the
+ *   edit's memory however long the clip is.
+ */
+#define MP4_INTERLEAVE_MS           500
+#define MP4_VIDEO_TIMESCALE         90000
+#define MP4_PLAN_SLICE_SAMPLES      64
+#define MP4_FETCH_WINDOW_MB         32
+
+/* ============================================================================
+ * SAVE FILE I/O
+ * ============================================================================
+ * save_io.c writes saves overlapped and FILE_FLAG_NO_BUFFERING.
+ *
+ * SAVE_IO_BUFFER_MB / SAVE_IO_BUFFERS: Ring of write buffers; each full
+ *   buffer is one WriteFile, and up to SAVE_IO_BUFFERS are in flight while
+ *   the next fills (elevated only, see save_io.h). 4 x 4 MB keeps NVMe
+ *   queues busy (large sequential requests, several outstanding) for 16 MB
+ *   of memory per save.
+ *
+ * SAVE_IO_ALIGNMENT: Unbuffered I/O must start and end on sector
+ *   boundaries. 4096 is a multiple of every sector size in use (512e and
+ *   4Kn); only the final write is padded, then the file is trimmed.
+ */
+#define SAVE_IO_BUFFER_MB           4
+#define SAVE_IO_BUFFERS             4
+#define SAVE_IO_ALIGNMENT           4096
+
+/* ============================================================================
+ * RECORDING MUX QUEUE
+ * ============================================================================
+ * RECORDING_MUX_QUEUE_SECONDS: Frames the mux queue (mux_queue.c) holds
+ *   between the encoder callback and the writer thread, in seconds of
+ *   video at the recording fps. Rides out a multi-second disk stall (AV
+ *   scan, NAS hiccup) for a few tens of MB of encoded frames; beyond that
+ *   frames are dropped to the next IDR rather than stalling capture.
+ */
+#define RECORDING_MUX_QUEUE_SECONDS 4
+
 /* ============================================================================
  * GLOBAL HOTKEY IDS
  * ============================================================================
@@ -113,6 +172,7 @@ void Logger_Log(const char* fmt, ...);
  */
 #define HOTKEY_REPLAY_SAVE          1
 #define HOTKEY_MARKER               2
+#define HOTKEY_CONTINUOUS_SAVE      3
 
 /* ============================================================================
  * PIXEL FORMAT SIZES
@@ -174,6 +234,114 @@ void Logger_Log(const char* fmt, ...);
 #define GOP_LENGTH_FRAMES_AT(fps)   ((fps) / 2)
 #define DWMWA_EXTENDED_FRAME_BOUNDS_CONST 9
 
+/* ============================================================================
+ * GPU PIPELINE DEPTH - Texture Rings Between Capture, Convert and Encode
+ * ============================================================================
+ * 
+ * Capture, colour conversion and encoding all run on one thread, but the GPU
+ * work they issue only overlaps if consecutive frames land in different
+ * textures. With a single texture per stage, frame N+1's copy or Blt has to
+ * wait for frame N to be consumed, and per-frame time becomes the sum of the
+ * three stages instead of the slowest one.
+ * 
+ * NVENC_ASYNC_DEPTH: Output-buffer slots in the NVENC encoder, i.e. the most
+ *   frames that can be encoding while the capture thread moves on (async
+ *   mode). 4 covers a 240fps loop with ~16ms of encoder latency.
+ * 
+ * CAPTURE_TEXTURE_RING_DEPTH: BGRA textures Capture_GetFrameTexture rotates
+ *   through. 2 is enough: the desktop copy for frame N+1 goes to the texture
+ *   the video processor is *not* reading for frame N.
+ * 
+ * NV12_TEXTURE_RING_DEPTH: NV12 textures GPUConverter rotates through. Kept
+ *   one deeper than NVENC_ASYNC_DEPTH so a converter texture is only rewritten
+ *   after the async encoder has retrieved and unmapped every frame that read
+ *   it. That lets NVENC encode converter output in place; with a shallower
+ *   ring the encoder falls back to a GPU copy into its own slot textures.
+ * 
+ * CAPTURE_READBACK_RING_DEPTH: Staging textures a CaptureReadback rotates
+ *   through. A region copied on one frame is mapped (without waiting) a
+ *   frame or two later; three keeps a copy in flight while the GPU is up
+ *   to two frames behind.
+ * 
+ * GPU_TEXTURE_RING_MAX: Compile-time bound on any of these rings (array sizing).
+ * 
+ * GPU_SLOT_WAIT_MS: How long GPUConverter_Convert polls a ring slot's event
+ *   query before reusing it. Bounds how far the CPU can queue ahead of the
+ *   GPU; on timeout the Blt is issued anyway (D3D11 orders it correctly),
+ *   so a slow GPU costs latency, never correctness.
+ */
+#define NVENC_ASYNC_DEPTH           4
+#define CAPTURE_TEXTURE_RING_DEPTH  2
+#define NV12_TEXTURE_RING_DEPTH     (NVENC_ASYNC_DEPTH + 1)
+#define CAPTURE_READBACK_RING_DEPTH 3
+#define GPU_TEXTURE_RING_MAX        8
+#define GPU_SLOT_WAIT_MS            4
+
+/* ============================================================================
+ * PREVIEW TAP - Live Preview and Clip Thumbnails (preview_tap.c)
+ * ============================================================================
+ * 
+ * PREVIEW_TAP_SIZE: Long edge of the BGRA preview GPUConverter scales one
+ *   frame per GOP down to (aspect kept, both sides even). Also the poster
+ *   frame size. 320 is readable in the preview window and costs ~400KB.
+ * 
+ * PREVIEW_TAP_READBACK_DEPTH: Staging textures the tap rotates through.
+ *   A tap is mapped (without waiting) on a later frame; when all are still
+ *   in flight the next tap is skipped rather than waited for.
+ * 
+ * PREVIEW_THUMB_RING: Thumbnails kept for saves, one per GOP, each half the
+ *   preview size (~58KB at 16:9). A buffer longer than the ring covers
+ *   (128 s at the 0.5 s GOP) keeps every Nth GOP instead, so memory stays
+ *   under ~15MB whatever the replay duration.
+ * 
+ * PREVIEW_JPEG_QUALITY: WIC ImageQuality for the poster and thumbnails
+ *   embedded in saved clips.
+ * 
+ * PREVIEW_WINDOW_REFRESH_MS: How often the settings preview window repaints.
+ *   The tap only produces a frame per GOP, so faster would repaint the same one.
+ */
+#define PREVIEW_TAP_SIZE            320
+#define PREVIEW_TAP_MAX_BYTES       (PREVIEW_TAP_SIZE * PREVIEW_TAP_SIZE * 4)
+#define PREVIEW_TAP_READBACK_DEPTH  3
+#define PREVIEW_THUMB_RING          256
+#define PREVIEW_JPEG_QUALITY        0.8f
+#define PREVIEW_WINDOW_REFRESH_MS   500
+
+/* ============================================================================
+ * PIPELINE LATENCY HISTOGRAMS
+ * ============================================================================
+ * 
+ * Per-stage timings are bucketed into fixed power-of-two buckets so the p99
+ * tail that drops CFR slots stays visible; a running average hides it.
+ * 
+ * LATENCY_HISTOGRAM_BUCKETS: Bucket count. Bucket 0 holds everything under
+ *   LATENCY_HISTOGRAM_MIN_US, bucket i covers [MIN << (i-1), MIN << i), and the
+ *   last bucket is open-ended. 16 buckets starting at 32us reach ~0.5s, past
+ *   which a frame is lost no matter which stage caused it.
+ */
+#define LATENCY_HISTOGRAM_BUCKETS   16
+#define LATENCY_HISTOGRAM_MIN_US    32
+
+/* ============================================================================
+ * METRICS REGISTRY (metrics.c)
+ * ============================================================================
+ * 
+ * METRICS_SLOTS: Per-thread write slots (power of two). A thread's slot is
+ *   picked from its id, so the capture, encoder, audio and sampler threads
+ *   normally each get their own cache lines; two threads that collide still
+ *   count correctly, they just share a line.
+ * 
+ * METRICS_HISTOGRAM_BUCKETS: Bucket 0 holds 0, bucket i covers
+ *   [2^(i-1), 2^i), the last is open-ended. 32 buckets reach 1 GiB, plenty
+ *   for byte sizes and microsecond timings alike.
+ * 
+ * METRICS_SNAPSHOT_INTERVAL_MS: Minimum spacing of the periodic snapshot
+ *   in the log (Metrics_LogSnapshotIfDue).
+ */
+#define METRICS_SLOTS                   16
+#define METRICS_HISTOGRAM_BUCKETS       32
+#define METRICS_SNAPSHOT_INTERVAL_MS    30000
+
 /* ============================================================================
  * NVENC QUALITY PRESETS - Quantization Parameter (QP) Values
  * ============================================================================
@@ -198,6 +366,14 @@ void Logger_Log(const char* fmt, ...);
 #define QP_HIGH                     20      // High quality, larger files
 #define QP_LOSSLESS                 16      // Near-lossless, very large files
 
+/*
+ * AV1_QP_SCALE: NVENC takes AV1 constant QP as a 0-255 quantizer index
+ *   rather than HEVC's 0-51. The presets above are multiplied by this for AV1
+ *   sessions (the mapping OBS uses), which lands near the same visual quality
+ *   at a noticeably lower bitrate on screen content.
+ */
+#define AV1_QP_SCALE                4
+
 /* ============================================================================
  * BUFFER MANAGEMENT - Sample Storage and Memory
  * ============================================================================
@@ -219,35 +395,91 @@ void Logger_Log(const char* fmt, ...);
  * MAX_SEQ_HEADER_SIZE: Maximum size for HEVC sequence headers (VPS/SPS/PPS).
  *   These headers contain codec configuration and must be stored separately
  *   for MP4 muxing. 256 bytes is generous; typical headers are 50-100 bytes.
+ * 
+ * FRAME_ARENA_HEADROOM: Arena-mode FrameBuffer size as a multiple of
+ *   ReplayBuffer_EstimateRAMUsage. QP-driven encodes of busy scenes run well
+ *   above the preset bitrate; 2x keeps the full duration in all but extreme
+ *   content. When the arena does fill, the oldest frames are evicted early
+ *   and the buffered span shrinks (logged), memory never grows.
+ * 
+ * FRAME_ARENA_MIN_MB: Floor for the arena so short/low-res buffers still
+ *   hold several GOPs of high-motion content.
+ * 
+ * FRAME_ARENA_COMMIT_CHUNK_MB: The arena is reserved up front but committed
+ *   in steps of this size as the write head first reaches them, so commit
+ *   charge tracks what the buffer has actually filled. 16 MB is a few
+ *   seconds of 4K video: one VirtualAlloc per step without committing far
+ *   ahead of the head. Not used for large-page arenas (committed whole).
+ * 
+ * FRAME_BUFFER_MAX_PINS: Snapshots (in-flight saves) that may pin frames at
+ *   the same time. Every save queued for the mux worker holds one, and a
+ *   continuous save holds one while it appends, so the replay save queue
+ *   depth (REPLAY_SAVE_QUEUE_DEPTH) is one less.
+ * 
+ * FRAME_SPILL_SEGMENT_MB: Granularity at which the spill file's mapped
+ *   pages are trimmed from the working set behind the write head. Larger
+ *   means fewer trim calls but more recently written data left resident.
+ * 
+ * REPLAY_SPILL_HOT_DEFAULT_SECS / _MIN_SECS: Seconds kept in RAM when the
+ *   spill tier is on ([ReplayBuffer] SpillHotSeconds). The rest of the
+ *   replay duration goes to disk. The hot tier also absorbs new frames
+ *   while a save reads from the spill (which freezes eviction), so it
+ *   should comfortably exceed the time a full-length save takes to mux.
  */
 #define MIN_BUFFER_CAPACITY         100
 #define MAX_BUFFER_CAPACITY         100000
 #define BUFFER_CAPACITY_HEADROOM    1.5f
 #define MAX_SEQ_HEADER_SIZE         256
+#define FRAME_ARENA_HEADROOM        2.0f
+#define FRAME_ARENA_MIN_MB          64
+#define FRAME_ARENA_COMMIT_CHUNK_MB 16
+#define FRAME_BUFFER_MAX_PINS       5
+#define FRAME_SPILL_SEGMENT_MB      64
+#define REPLAY_SPILL_HOT_DEFAULT_SECS 60
+#define REPLAY_SPILL_HOT_MIN_SECS   10
 
 /* ============================================================================
  * AUDIO BUFFER MANAGEMENT
  * ============================================================================
  * 
- * Audio uses dynamic arrays that grow as needed during recording.
+ * Replay audio tracks are fixed-size rings (audio_ring.c) allocated once per
+ * pipeline start from the replay duration: descriptors in one array, AAC
+ * payloads in one byte arena. Eviction advances the tail, nothing moves.
+ * 
+ * AUDIO_RING_HEADROOM: Descriptor slots as a multiple of the nominal AAC
+ *   frame rate (48000 / 1024 = ~47 frames/s) times the duration. Covers
+ *   jitter in encoder output timing; descriptors are 32 bytes, so 1.5x of
+ *   20 minutes is still under 2 MB per track.
  * 
- * INITIAL_AUDIO_CAPACITY: Starting size for audio sample arrays.
- *   1024 samples at 48kHz stereo = ~10ms of audio. We start small and grow.
+ * AUDIO_ARENA_HEADROOM: Payload arena as a multiple of AAC_BITRATE times the
+ *   duration. The MFT encoder is close to CBR but individual frames vary;
+ *   2x means the time limit, not the arena, decides what is evicted.
  * 
- * AUDIO_CAPACITY_GROWTH_FACTOR: When an array fills up, multiply its
- *   capacity by this factor. Doubling (2x) is the classic approach that
- *   amortizes reallocation cost - we do fewer large allocations rather
- *   than many small ones.
+ * AUDIO_ARENA_MIN_KB: Arena floor so very short buffers still hold several
+ *   maximum-size AAC frames.
  * 
  * AUDIO_MIX_CHUNK_SIZE: When mixing multiple audio sources (microphone +
  *   desktop audio), we process this many samples at a time. 4096 samples
  *   is a good balance between processing overhead (fewer chunks = less
  *   overhead) and memory locality (smaller chunks = better cache usage).
+ * 
+ * AUDIO_PCM_RING_SLACK_SEC: With [Advanced] DeferredSourceAudio the
+ *   per-source tracks are kept as raw PCM (192 KB/s per source, about 8x
+ *   the AAC rate) and encoded only when a save needs them. The PCM ring
+ *   holds the replay duration plus this much, so a save that lands just as
+ *   the oldest video ages out still finds its audio.
+ * 
+ * PCM between the capture threads moves through lock-free SPSC rings
+ * (spsc_ring.c). CACHE_LINE_SIZE is the padding that keeps the producer's
+ * and the consumer's indices on separate lines (64 bytes on every x64 part
+ * this runs on); a shared line would bounce between cores on every write.
  */
-#define INITIAL_AUDIO_CAPACITY          1024
-#define AUDIO_CAPACITY_GROWTH_FACTOR    2
+#define AUDIO_RING_HEADROOM             1.5f
+#define AUDIO_ARENA_HEADROOM            2.0f
+#define AUDIO_ARENA_MIN_KB              512
+#define AUDIO_PCM_RING_SLACK_SEC        2
 #define AUDIO_MIX_CHUNK_SIZE            4096
-#define MAX_AUDIO_SAMPLES               16384
+#define CACHE_LINE_SIZE                 64
 
 /* ============================================================================
  * AUDIO FORMAT CONSTANTS - Sample Value Normalization
@@ -270,6 +502,14 @@ void Logger_Log(const char* fmt, ...);
  * 
  * AUDIO_VOLUME_DEFAULT: Default volume level (100%).
  * AUDIO_VOLUME_MAX: Maximum volume level (400% = 4x boost for quiet sources).
+ * 
+ * AUDIO_GAIN_FRAC_BITS: Volumes are applied as fixed-point gains with this
+ *   many fraction bits (audio_mix.c). Q12 puts 400% at 16384, which still
+ *   fits the signed 16-bit multiplier the SIMD kernels use (Q15 would not
+ *   go past 100%), and a 1/4096 step is far below one 16-bit LSB at any
+ *   sample value that matters.
+ * AUDIO_GAIN_ROUND: Half an LSB of the result, added before the shift so
+ *   products round to nearest instead of toward minus infinity.
  */
 #define AUDIO_16BIT_MAX             32768.0f
 #define AUDIO_16BIT_MAX_SIGNED      32767.0f
@@ -278,6 +518,93 @@ void Logger_Log(const char* fmt, ...);
 #define AUDIO_24BIT_SIGN_EXTEND     0xFF000000
 #define AUDIO_VOLUME_DEFAULT        100
 #define AUDIO_VOLUME_MAX            400
+#define AUDIO_GAIN_FRAC_BITS        12
+#define AUDIO_GAIN_ROUND            (1 << (AUDIO_GAIN_FRAC_BITS - 1))
+
+/* ============================================================================
+ * AUDIO RESAMPLING - Polyphase Filter (audio_resample.c)
+ * ============================================================================
+ * 
+ * Devices that don't run at AUDIO_SAMPLE_RATE (44.1 kHz headsets, 96 kHz
+ * interfaces) are resampled with a Kaiser-windowed sinc, one kernel per
+ * phase of the reduced rate ratio.
+ * 
+ * AUDIO_RESAMPLE_TAPS: Kernel length in input frames (a multiple of 8 for
+ *   the SSE dot product). 64 taps with AUDIO_RESAMPLE_KAISER_BETA 7 give
+ *   about 70 dB of image rejection with a transition band of ~7% of the
+ *   input rate.
+ * AUDIO_RESAMPLE_CUTOFF: Passband edge as a fraction of the lower of the
+ *   two Nyquist rates. 0.9 keeps 44.1 kHz flat to ~18 kHz and puts the
+ *   stopband just below 22.05 kHz, so nothing folds back.
+ * AUDIO_RESAMPLE_MAX_PHASES: Largest exact ratio numerator. 11025 -> 48000
+ *   needs 640 (160 KB of kernels); stranger ratios are rounded to this many
+ *   phases, a rate error well under 0.1%.
+ * AUDIO_RESAMPLE_BLOCK: Input frames converted per step, bounding scratch.
+ * AUDIO_RESAMPLE_DRIFT_PHASE_BITS: Kernel bank of a drift-adjusted
+ *   resampler, 2^8 + 1 kernels (66 KB). Blending the two nearest kernels
+ *   keeps the interpolation error below the filter's own stopband.
+ */
+#define AUDIO_RESAMPLE_TAPS         64
+#define AUDIO_RESAMPLE_KAISER_BETA  7.0
+#define AUDIO_RESAMPLE_CUTOFF       0.9
+#define AUDIO_RESAMPLE_MAX_PHASES   1024
+#define AUDIO_RESAMPLE_BLOCK        1024
+#define AUDIO_RESAMPLE_DRIFT_PHASE_BITS 8
+
+/* ============================================================================
+ * AUDIO CLOCK DRIFT - Device Clocks vs QPC (audio_capture.c)
+ * ============================================================================
+ * 
+ * Each source's sample clock runs some tens of ppm off QPC. The mix thread
+ * is paced to QPC, so uncorrected a fast source piles up latency in its
+ * ring (until the ring overflows) and a slow one underruns into silence
+ * padding: 50 ppm is 180 ms per hour. Each capture thread compares frames
+ * delivered against the GetBuffer QPC positions since an anchor, and steers
+ * its resampler to the measured rate plus a slow pull on the accumulated
+ * offset (resampled frames vs QPC-expected frames).
+ * 
+ * AUDIO_DRIFT_MAX_PPM: Largest correction applied. Real clocks sit well
+ *   inside it; a measurement beyond it means a broken timestamp and restarts
+ *   the estimate instead.
+ * AUDIO_DRIFT_SETTLE_MS: Span the first estimate waits for. Packet QPC jitter
+ *   is microseconds, so 5 s resolves about 1 ppm.
+ * AUDIO_DRIFT_UPDATE_MS: How often the estimate and resampler are updated.
+ * AUDIO_DRIFT_WINDOW_MS: Rate anchor age before it slides forward, so slow
+ *   thermal drift is followed.
+ * AUDIO_DRIFT_GAP_MS: A packet this long after the previous one (loopback
+ *   with nothing playing, a glitch) restarts the anchor; the last ratio is
+ *   kept meanwhile.
+ * AUDIO_DRIFT_SLEW_SEC: Time constant for pulling the accumulated offset
+ *   back to zero. Long enough that the correction stays inaudible.
+ */
+#define AUDIO_DRIFT_MAX_PPM         1000
+#define AUDIO_DRIFT_SETTLE_MS       5000
+#define AUDIO_DRIFT_UPDATE_MS       1000
+#define AUDIO_DRIFT_WINDOW_MS       120000
+#define AUDIO_DRIFT_GAP_MS          200
+#define AUDIO_DRIFT_SLEW_SEC        30.0
+
+/* ============================================================================
+ * AUDIO SILENCE GATE - Silent Per-Source Tracks (replay_buffer.c)
+ * ============================================================================
+ * 
+ * A microphone or chat source is silent most of a session, yet its track
+ * was encoded and stored frame by frame all the same. The mix thread flags
+ * silent chunks from the peak its volume pass already computes; after a
+ * hangover the track's encoder is suspended and every further AAC frame of
+ * silence is stored as a reference to one cached silent frame, taking no
+ * arena space and no encoder time ([Advanced] SilenceGate).
+ * 
+ * AUDIO_SILENCE_PEAK: Largest |sample| (after volume) of a silent chunk.
+ *   0 = digital silence only (dormant, muted or padded sources), so the
+ *   gate never changes what a track sounds like.
+ * AUDIO_SILENCE_HANGOVER_FRAMES: Silent frames still encoded before the
+ *   gate closes (~340 ms). Covers the encoder's look-ahead and overlap, so
+ *   the last encoded frame decodes to pure silence and can be the cached
+ *   one, and keeps short pauses from toggling the encoder.
+ */
+#define AUDIO_SILENCE_PEAK              0
+#define AUDIO_SILENCE_HANGOVER_FRAMES   16
 
 /* ============================================================================
  * REPLAY BUFFER CONFIGURATION
@@ -295,10 +622,56 @@ void Logger_Log(const char* fmt, ...);
  * Memory usage depends heavily on video settings. At 1080p60 high quality,
  * expect roughly 100-150 MB per minute of buffer. A 20-minute buffer could
  * use 2-3 GB of RAM.
+ * 
+ * REPLAY_OUTPUT_HEIGHT_*: Bounds for the optional encode height
+ * ([ReplayBuffer] OutputHeight). GPUConverter downscales the captured frame
+ * to this height (aspect kept) in the same Video Processor blit that does
+ * BGRA→NV12, so NVENC load and buffer RAM scale with output pixels rather
+ * than capture pixels. 0 keeps the capture size. Never upscales.
+ * 
+ * REPLAY_RANGE_SAVE_MAX_AFTER_SEC: Longest a partial save
+ *   (ReplayBuffer_SaveRangeAsync / _SaveMarkerAsync) may reach past its
+ *   anchor. The save waits on the buffer thread until those frames exist,
+ *   holding one of the REPLAY_SAVE_QUEUE_DEPTH slots meanwhile. Also the
+ *   upper bound for [Markers] ClipSeconds, which reaches that far both ways.
+ * 
+ * REPLAY_RANGE_SAVE_GRACE_MS: Extra wait past secondsAfter before a partial
+ *   save gives up waiting and writes what is buffered (encoder backlog,
+ *   capture stall, duplication reinit).
+ * 
+ * REPLAY_SAVE_QUEUE_DEPTH: Saves that may be requested and not yet written.
+ *   The buffer thread only pins the clip and copies its audio; a worker
+ *   thread muxes queued saves one at a time while capture continues. Tied
+ *   to FRAME_BUFFER_MAX_PINS because each queued save holds a pin (the last
+ *   pin is kept for a continuous save).
+ * 
+ * REPLAY_CONTINUOUS_POLL_MS: How often a continuous save
+ *   (ReplayBuffer_BeginContinuousSave) pins the frames added since its last
+ *   pass and appends them to the file. The frames wait in the FrameBuffer
+ *   meanwhile, so this only sets the write granularity and how long each
+ *   pin is held: a quarter second is ~15 frames at 60 fps per pass.
+ * 
+ * REPLAY_MEMORY_BUDGET_MIN_MB / _MAX_MB: Range of [ReplayBuffer]
+ *   MemoryBudgetMB (0 = no budget). The budget caps frame bytes plus audio
+ *   track bytes; the buffered span shrinks to what fits. The minimum still
+ *   holds a few seconds of 1080p60 at the highest preset.
+ * 
+ * REPLAY_MEMORY_ACCOUNTING_MS: How often the buffer thread charges audio
+ *   bytes against the budget and publishes the live seconds/MB shown in
+ *   settings. Audio grows by a few KB per second, so 1s of lag is noise.
  */
 #define REPLAY_DURATION_MIN_SECS    1
 #define REPLAY_DURATION_MAX_SECS    1200
 #define REPLAY_DURATION_DEFAULT     15
+#define REPLAY_OUTPUT_HEIGHT_MIN    144
+#define REPLAY_OUTPUT_HEIGHT_MAX    4320
+#define REPLAY_RANGE_SAVE_MAX_AFTER_SEC 60
+#define REPLAY_RANGE_SAVE_GRACE_MS  2000
+#define REPLAY_SAVE_QUEUE_DEPTH     (FRAME_BUFFER_MAX_PINS - 1)
+#define REPLAY_CONTINUOUS_POLL_MS   250
+#define REPLAY_MEMORY_BUDGET_MIN_MB 64
+#define REPLAY_MEMORY_BUDGET_MAX_MB 65536
+#define REPLAY_MEMORY_ACCOUNTING_MS 1000
 
 /* ============================================================================
  * TIMEOUT VALUES - Thread Synchronization and Waiting
@@ -313,9 +686,34 @@ void Logger_Log(const char* fmt, ...);
  * 
  * DORMANT_THRESHOLD_MS: If no audio data arrives for this long, consider
  *   the audio device dormant (possibly muted or disconnected).
+ * 
+ * AUDIO_EVENT_TIMEOUT_MS: Longest an event-driven capture endpoint
+ *   (microphone) waits for its WASAPI buffer event before draining anyway.
+ *   Half the WASAPI_BUFFER_DURATION_100NS buffer, so a missed event can
+ *   never overrun the endpoint buffer. Loopback sources wait only
+ *   AUDIO_POLL_INTERVAL_MS: Windows before 10 1703 never signals loopback
+ *   events, and no build signals them while nothing is rendering.
+ * 
+ * AUDIO_MIX_IDLE_WAIT_MS: Longest the mix thread waits for a source to
+ *   signal new PCM before the first packet arrives. Bounds the heartbeat
+ *   and device recovery check interval while every source is silent.
+ * 
+ * REPLAY_AUDIO_DRAIN_INTERVAL_MS: Longest the replay buffer thread sleeps
+ *   between frames when it has to drain audio itself (the audio encode
+ *   thread could not start). The mix thread emits ~21 ms chunks, so the
+ *   loop must wake more often than that even at 30 fps. Otherwise the
+ *   buffer thread sleeps the whole frame interval.
+ * 
+ * REPLAY_AUDIO_ENCODE_WAIT_MS: Longest the audio encode thread waits for
+ *   the mix thread's output event. Only bounds its heartbeat: while audio
+ *   runs it is woken every chunk.
  */
 #define AUDIO_POLL_INTERVAL_MS      5
 #define DORMANT_THRESHOLD_MS        100.0
+#define AUDIO_EVENT_TIMEOUT_MS      50
+#define AUDIO_MIX_IDLE_WAIT_MS      50
+#define REPLAY_AUDIO_DRAIN_INTERVAL_MS  10
+#define REPLAY_AUDIO_ENCODE_WAIT_MS     100
 
 /* ============================================================================
  * ERROR HANDLING AND LOGGING THRESHOLDS
@@ -331,19 +729,10 @@ void Logger_Log(const char* fmt, ...);
  * EVICT_LOG_INTERVAL / AUDIO_EVICT_LOG_INTERVAL: When evicting old samples
  *   from buffers (normal operation in replay mode), only log occasionally.
  *   Buffer eviction happens constantly; we don't need to log every one.
- * 
- * MAX_REALLOC_FAIL_LOGS: How many times to log memory reallocation failures
- *   before going silent. If we're out of memory, spamming logs won't help.
- * 
- * EMERGENCY_KEEP_FRACTION: When buffer overflow forces emergency eviction,
- *   keep this fraction of samples (75%). Provides some safety margin while
- *   freeing enough space to continue operation.
  */
 #define MAX_CONSECUTIVE_ERRORS      100
 #define EVICT_LOG_INTERVAL          300
 #define AUDIO_EVICT_LOG_INTERVAL    500
-#define MAX_REALLOC_FAIL_LOGS       5
-#define EMERGENCY_KEEP_FRACTION     0.75f
 
 /* ============================================================================
  * BITRATE CALCULATION - Adaptive Quality Scaling
@@ -372,6 +761,10 @@ void Logger_Log(const char* fmt, ...);
  * BITRATE_BPS BOUNDS: Absolute limits regardless of calculation.
  *   - Minimum 10 Mbps ensures usable quality even for tiny captures
  *   - Maximum 150 Mbps prevents unreasonable file sizes
+ *
+ * AV1_BITRATE_SCALE: AV1 bitrate relative to HEVC at the same preset
+ *   (AV1_QP_SCALE). Applied to the estimate before the bounds, so AV1 replay
+ *   arenas and spill files are sized ~30% smaller for the same duration.
  */
 #define BITRATE_LOW_MBPS            60.0f
 #define BITRATE_MEDIUM_MBPS         75.0f
@@ -385,6 +778,7 @@ void Logger_Log(const char* fmt, ...);
 #define MAX_FPS_SCALE               4.0f   // Support up to 240fps (240/60 = 4.0)
 #define MIN_BITRATE_BPS             10000000.0
 #define MAX_BITRATE_BPS             150000000.0
+#define AV1_BITRATE_SCALE           0.7f
 
 /* ============================================================================
  * WASAPI AUDIO CAPTURE
@@ -422,21 +816,67 @@ void Logger_Log(const char* fmt, ...);
  * WM_AUTOCLIP_SAVE / _COMPLETE / _DELAYED: Auto-clip pipeline messages
  *   posted between kill_feed_sampler.c and overlay.c. The +7 gap on
  *   _DELAYED is preserved to avoid disturbing any historical IDs.
+ *
+ * WM_CLIP_EDIT_COMPLETE: clip_edit.c's worker thread to the control
+ *   window when a toolbar trim / join has finished.
  */
 #define WM_AUTOCLIP_SAVE            (WM_USER + 2)  /* lParam = heap-alloc'd game name or NULL (receiver frees) */
 #define WM_AUTOCLIP_SAVE_COMPLETE   (WM_USER + 3)
 #define WM_AUTOCLIP_SAVE_DELAYED    (WM_USER + 7)  /* Internal: timer-triggered deferred save */
+#define WM_CLIP_EDIT_COMPLETE       (WM_USER + 8)  /* lParam = finished edit (ClipEdit_OnComplete frees it) */
 
 /* ============================================================================
  * AUTO-CLIP (Kill Feed Detection) Constants
  * ============================================================================
  *
  * Cooldown and delay settings for template-matching-based auto-clip detection.
+ *
+ * AUTOCLIP_CLIP_MAX_SEC: Upper bound for [AutoClip] ClipSeconds, the length
+ *   of a partial auto-clip save (0 = save the whole buffer).
  */
 #define AUTOCLIP_COOLDOWN_MIN_SEC       5
 #define AUTOCLIP_COOLDOWN_MAX_SEC       30
 #define AUTOCLIP_DELAY_MIN_SEC          0
 #define AUTOCLIP_DELAY_MAX_SEC          30
+#define AUTOCLIP_CLIP_MAX_SEC           300
+
+/*
+ * TEMPLATE_MATCH_Q_BITS: Fraction bits of the int16 template the direct
+ *   SIMD kernels multiply against. Q3 keeps 1/8 of a gray level (far below
+ *   anything NCC at a 0.8 threshold can see) while a 2048-pixel row of
+ *   255 x (255 << 3) products still fits one 32-bit lane.
+ * TEMPLATE_MATCH_TOP_K: Half-resolution peaks re-scored at full resolution
+ *   in a coarse-to-fine search. Kill feeds stack several similar banners,
+ *   so more than one peak has to survive to the fine level.
+ * TEMPLATE_MATCH_REFINE_RADIUS: Full-resolution pixels searched around each
+ *   scaled-up peak. A 2x2 box average moves a peak by at most one; two
+ *   adds margin for the template's own rounding when halved.
+ * TEMPLATE_MATCH_COARSE_MIN_DIM: Smallest half-resolution template side
+ *   worth searching; below it the template is matched at full size only.
+ * TEMPLATE_MATCH_FFT_COST: Relative cost of one radix-2 butterfly stage per
+ *   point against one direct multiply-add (template_match.c). A template
+ *   search goes through the FFT when positions * template area exceeds
+ *   this times the two transforms' N log2 N. At 4 both paths take about
+ *   as long on a 16x8 template in a 480x260 region; the ~150x20 banner
+ *   templates run roughly 10x faster through the FFT.
+ */
+#define TEMPLATE_MATCH_Q_BITS           3
+#define TEMPLATE_MATCH_TOP_K            8
+#define TEMPLATE_MATCH_REFINE_RADIUS    2
+#define TEMPLATE_MATCH_COARSE_MIN_DIM   6
+#define TEMPLATE_MATCH_FFT_COST         4.0
+
+/*
+ * GPU_MATCH_RING_DEPTH: Scans the compute-shader matcher can have in
+ *   flight (gpu_template_match.c). Each slot holds one copy of the region
+ *   and one 16-byte result; three covers the usual two-frame GPU queue
+ *   without the capture thread ever waiting on a result.
+ * GPU_MATCH_SCAN_INTERVAL_MS: Scan cadence with [Advanced] GpuKillFeed.
+ *   A scan costs the capture thread one region copy and a few dispatches,
+ *   so it can run several times per CPU-matcher interval.
+ */
+#define GPU_MATCH_RING_DEPTH            3
+#define GPU_MATCH_SCAN_INTERVAL_MS      100
 
 /* ============================================================================
  * FALLBACK FILE PATHS
@@ -467,12 +907,18 @@ void Logger_Log(const char* fmt, ...);
  * 
  * AAC_OUTPUT_BUFFER_SIZE: Buffer size for encoded AAC output frames.
  *   8KB is sufficient for 192kbps AAC at any frame size.
+ * 
+ * AAC_INPUT_POOL_SIZE: PCM input samples each encoder reuses. A slot is
+ *   taken again once the MFT has dropped its reference; the Microsoft
+ *   encoder consumes input synchronously, so one is normally enough and the
+ *   rest absorb an MFT that queues a frame or two.
  */
 #define AAC_SAMPLE_RATE             48000
 #define AAC_CHANNELS                2
 #define AAC_BITRATE                 192000
 #define AAC_LC_PROFILE_LEVEL        0x29
 #define AAC_OUTPUT_BUFFER_SIZE      8192
+#define AAC_INPUT_POOL_SIZE         4
 #define AAC_SAMPLES_PER_FRAME       1024    // AAC-LC fixed frame size
 
 /* ============================================================================
@@ -518,9 +518,8 @@ static DWORD WINAPI WatchdogThread(LPVOID param) {
             missedCount++;
             if (missedCount >= (WATCHDOG_TIMEOUT_MS / WATCHDOG_CHECK_INTERVAL)) {
                 // Hang detected - log it before crash handling
-                Logger_Log("WATCHDOG: Hang detected! Main thread not responding for %dms\n", 
-                           WATCHDOG_TIMEOUT_MS);
-                Logger_Flush();
+                Logger_LogCritical("WATCHDOG: Hang detected! Main thread not responding for %dms\n",
+                                   WATCHDOG_TIMEOUT_MS);
                 
                 CONTEXT ctx;
                 RtlCaptureContext(&ctx);
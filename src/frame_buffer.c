@@ -4,7 +4,8 @@
  * USED BY: replay_buffer.c ONLY
  * 
  * Thread-safe circular buffer storing encoded HEVC frames.
- * Maintains a rolling window of the last N seconds for instant replay saves.
+ * Maintains a rolling window of the last N seconds for instant replay saves,
+ * optionally extended on disk by a spill tier (frame_spill.c).
  * Recording uses StreamingMuxer instead (no buffering needed).
  *
  * ERROR HANDLING PATTERN:
@@ -25,22 +26,151 @@
 // Alias for logging
 #define BufLog Logger_Log
 
-// Free a single frame
-static void FreeFrame(BufferedFrame* frame) {
+// Free a single frame (arena mode: the bytes are reclaimed by moving the tail)
+static void FreeFrame(FrameBuffer* buf, BufferedFrame* frame) {
     LWSR_ASSERT(frame != NULL);
-    if (frame->data) {
+    if (frame->data && !buf->arena) {
         LEAK_TRACK_FRAME_BUFFER_FREE();
+        LEAK_TRACK_BYTES_FREE(LEAK_SITE_FRAME_HEAP, frame->size);
         free(frame->data);
-        frame->data = NULL;
     }
+    frame->data = NULL;
     frame->size = 0;
     frame->timestamp = 0;
     frame->duration = 0;
     frame->isKeyframe = FALSE;
 }
 
+// TRUE if an active snapshot covers the oldest frame (frames are pinned in
+// FIFO order, so nothing behind it can be evicted either)
+static BOOL TailPinned(const FrameBuffer* buf) {
+    for (int i = 0; i < FRAME_BUFFER_MAX_PINS; i++) {
+        if (buf->pinActive[i] && buf->pinSeq[i] <= buf->tailSeq) return TRUE;
+    }
+    return FALSE;
+}
+
+// Ring slot of the frame with arrival number seq (must be buffered)
+static int SlotForSeq(const FrameBuffer* buf, UINT64 seq) {
+    return (int)((buf->tail + (seq - buf->tailSeq)) % (UINT64)buf->capacity);
+}
+
+// GOP index entry i, 0 = oldest
+static const GopIndexEntry* GopAt(const FrameBuffer* buf, int i) {
+    return &buf->gopIndex[(buf->gopTail + i) % buf->capacity];
+}
+
+// Record the frame about to be stored at the head if it is an IDR.
+// Call before count++. Entries <= frames, so the index never overflows.
+static void IndexKeyframe(FrameBuffer* buf, const EncodedFrame* frame) {
+    if (!frame->isKeyframe) return;
+    GopIndexEntry* e = &buf->gopIndex[(buf->gopTail + buf->gopCount) % buf->capacity];
+    e->seq = buf->tailSeq + (UINT64)buf->count;
+    e->timestamp = frame->timestamp;
+    buf->gopCount++;
+}
+
+// Index of the newest IDR at or before ts, or 0 (oldest IDR) if none is.
+// Binary search; timestamps are monotonic. Requires gopCount > 0.
+static int GopFindAtOrBefore(const FrameBuffer* buf, LONGLONG ts) {
+    int lo = 0, hi = buf->gopCount - 1, found = 0;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (GopAt(buf, mid)->timestamp <= ts) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+// Oldest pinned sequence number, or MAXUINT64 if nothing is pinned
+static UINT64 OldestPinSeq(const FrameBuffer* buf) {
+    UINT64 oldest = MAXUINT64;
+    for (int i = 0; i < FRAME_BUFFER_MAX_PINS; i++) {
+        if (buf->pinActive[i] && buf->pinSeq[i] < oldest) oldest = buf->pinSeq[i];
+    }
+    return oldest;
+}
+
+// Spilled frames directly in front of the RAM tail (0 if no spill tier)
+static int SpillCount(const FrameBuffer* buf) {
+    const FrameSpill* spill = &buf->spill;
+    if (!spill->active || spill->count == 0) return 0;
+    if (spill->tailSeq + (UINT64)spill->count != buf->tailSeq) return 0;
+    return spill->count;
+}
+
+// Sequence number of the oldest frame in either tier
+static UINT64 OldestSeq(const FrameBuffer* buf) {
+    return buf->tailSeq - (UINT64)SpillCount(buf);
+}
+
+// Frame seq in either tier, described as a sample (absolute timestamps).
+// seq must be in [OldestSeq, tailSeq + count).
+static MuxerSample SampleAtSeq(const FrameBuffer* buf, UINT64 seq) {
+    MuxerSample s;
+    if (seq < buf->tailSeq) {
+        const SpillEntry* e = FrameSpill_At(&buf->spill, (int)(seq - buf->spill.tailSeq));
+        s.data = buf->spill.view + e->offset;
+        s.size = e->size;
+        s.timestamp = e->timestamp;
+        s.duration = e->duration;
+        s.isKeyframe = e->isKeyframe;
+    } else {
+        const BufferedFrame* f = &buf->frames[SlotForSeq(buf, seq)];
+        s.data = f->data;
+        s.size = f->size;
+        s.timestamp = f->timestamp;
+        s.duration = f->duration;
+        s.isKeyframe = f->isKeyframe;
+    }
+    return s;
+}
+
+// Hand the oldest RAM frame to the spill tier. A frame that cannot be
+// spilled breaks sequence continuity, so the spill starts over.
+static void SpillOldest(FrameBuffer* buf) {
+    const BufferedFrame* f = &buf->frames[buf->tail];
+    if (!f->data || f->size == 0) return;
+    
+    MuxerSample s;
+    s.data = f->data;
+    s.size = f->size;
+    s.timestamp = f->timestamp;
+    s.duration = f->duration;
+    s.isKeyframe = f->isKeyframe;
+    if (FrameSpill_Append(&buf->spill, buf->tailSeq, &s, OldestPinSeq(buf))) return;
+    
+    FrameSpill_Reset(&buf->spill);
+    if ((++buf->spillFailures % EVICT_LOG_INTERVAL) == 1) {
+        BufLog("FrameBuffer: %u-byte frame could not be spilled, spill restarted (%d so far)\n",
+               f->size, buf->spillFailures);
+    }
+}
+
+// Drop the oldest frame (into the spill tier if there is one).
+// Returns FALSE if it is pinned by a snapshot.
+static BOOL EvictOldest(FrameBuffer* buf) {
+    if (buf->count == 0 || TailPinned(buf)) return FALSE;
+    if (buf->gopCount > 0 && GopAt(buf, 0)->seq == buf->tailSeq) {
+        buf->gopTail = (buf->gopTail + 1) % buf->capacity;
+        buf->gopCount--;
+    }
+    if (buf->spill.active) SpillOldest(buf);
+    buf->usedBytes -= buf->frames[buf->tail].size;
+    FreeFrame(buf, &buf->frames[buf->tail]);
+    buf->tail = (buf->tail + 1) % buf->capacity;
+    buf->tailSeq++;
+    buf->count--;
+    return TRUE;
+}
+
 // Evict oldest frames until buffer duration is under maxDuration
 // Uses real timestamps: newest_timestamp - oldest_timestamp
+// Pinned frames are kept; the span catches up once the snapshot is released.
 static void EvictOldFrames(FrameBuffer* buf, LONGLONG newTimestamp) {
     if (buf->count == 0) return;
     
@@ -58,18 +188,13 @@ static void EvictOldFrames(FrameBuffer* buf, LONGLONG newTimestamp) {
         }
         
         // Evict oldest frame
-        FreeFrame(oldest);
-        buf->tail = (buf->tail + 1) % buf->capacity;
-        buf->count--;
+        if (!EvictOldest(buf)) break;
         evicted++;
     }
     
     // Also check capacity limit
     while (buf->count >= buf->capacity) {
-        BufferedFrame* oldest = &buf->frames[buf->tail];
-        FreeFrame(oldest);
-        buf->tail = (buf->tail + 1) % buf->capacity;
-        buf->count--;
+        if (!EvictOldest(buf)) break;
         evicted++;
     }
     
@@ -82,9 +207,141 @@ static void EvictOldFrames(FrameBuffer* buf, LONGLONG newTimestamp) {
     }
 }
 
+// Byte budget: evict until `size` more bytes fit alongside the external
+// charge. Returns FALSE if they cannot (pinned frames, or size alone is over).
+static BOOL EvictForBudget(FrameBuffer* buf, DWORD size) {
+    if (buf->byteBudget == 0) return TRUE;
+    
+    LONG64 external = buf->externalBytes;
+    size_t reserved = (size_t)(external > 0 ? external : 0) + size;
+    if (reserved > buf->byteBudget) return FALSE;
+    
+    int evictionsBefore = buf->budgetEvictions;
+    while (buf->usedBytes + reserved > buf->byteBudget) {
+        if (!EvictOldest(buf)) return FALSE;
+        buf->budgetEvictions++;
+    }
+    
+    // Budget reached before maxDuration: span is what fits (throttled log)
+    if (buf->budgetEvictions != evictionsBefore && buf->count > 0 &&
+        (buf->budgetEvictions / EVICT_LOG_INTERVAL) != (evictionsBefore / EVICT_LOG_INTERVAL)) {
+        int newestIdx = (buf->head - 1 + buf->capacity) % buf->capacity;
+        double span = (double)(buf->frames[newestIdx].timestamp - buf->frames[buf->tail].timestamp) / 10000000.0;
+        BufLog("FrameBuffer: byte budget reached (%zu MB frames + %lld KB external of %zu MB), "
+               "span=%.2fs of %llds\n",
+               buf->usedBytes / (1024 * 1024), (long long)(external / 1024),
+               buf->byteBudget / (1024 * 1024), span, buf->maxDuration / 10000000LL);
+    }
+    return TRUE;
+}
+
+#define ARENA_COMMIT_CHUNK ((size_t)FRAME_ARENA_COMMIT_CHUNK_MB * 1024 * 1024)
+
+// Arena mode: make sure [0, offset + size) is committed. The reservation is
+// committed lazily, in ARENA_COMMIT_CHUNK steps, as the head first reaches
+// it. Returns the frame's address, or NULL if the commit fails (low commit
+// charge); the caller drops the frame.
+static BYTE* ArenaCommit(FrameBuffer* buf, size_t offset, DWORD size) {
+    size_t needed = offset + size;
+    if (needed <= buf->arenaCommitted) return buf->arena + offset;
+    
+    size_t target = ((needed + ARENA_COMMIT_CHUNK - 1) / ARENA_COMMIT_CHUNK) * ARENA_COMMIT_CHUNK;
+    if (target > buf->arenaSize) target = buf->arenaSize;
+    if (!VirtualAlloc(buf->arena + buf->arenaCommitted, target - buf->arenaCommitted,
+                      MEM_COMMIT, PAGE_READWRITE)) {
+        if ((++buf->arenaCommitFailures % EVICT_LOG_INTERVAL) == 1) {
+            BufLog("FrameBuffer: arena commit to %zu MB failed (error %lu, %d so far)\n",
+                   target / (1024 * 1024), GetLastError(), buf->arenaCommitFailures);
+        }
+        return NULL;
+    }
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_FRAME_ARENA, target - buf->arenaCommitted);
+    buf->arenaCommitted = target;
+    return buf->arena + offset;
+}
+
+// Arena mode: after the wrap point was lowered, decommit what lies above it
+// once no live frame does (the head is back below it and the tail follows).
+// Large-page arenas are locked as a whole and keep their commit.
+static void ArenaTrimCommit(FrameBuffer* buf) {
+    if (buf->arenaLargePages || buf->count == 0) return;
+    
+    size_t keep = ((buf->arenaLimit + ARENA_COMMIT_CHUNK - 1) / ARENA_COMMIT_CHUNK) * ARENA_COMMIT_CHUNK;
+    if (keep >= buf->arenaCommitted) return;
+    
+    size_t tailOffset = (size_t)(buf->frames[buf->tail].data - buf->arena);
+    if (tailOffset >= buf->arenaHead || buf->arenaHead > buf->arenaLimit) return;
+    
+    VirtualFree(buf->arena + keep, buf->arenaCommitted - keep, MEM_DECOMMIT);
+    LEAK_TRACK_BYTES_FREE(LEAK_SITE_FRAME_ARENA, buf->arenaCommitted - keep);
+    BufLog("FrameBuffer: arena decommitted %zu MB above the %zu MB wrap point\n",
+           (buf->arenaCommitted - keep) / (1024 * 1024), buf->arenaLimit / (1024 * 1024));
+    buf->arenaCommitted = keep;
+}
+
+// Arena mode: find room for `size` bytes, evicting the oldest frames if the
+// arena is full. Frame bytes never wrap: if the run up to the wrap point
+// (arenaLimit) is too short, the frame goes to offset 0 and the gap is
+// reclaimed with the frames in front of it. Returns NULL if size exceeds
+// the arena, the space is held by a pinned snapshot, or it can't be committed.
+static BYTE* ArenaReserve(FrameBuffer* buf, DWORD size) {
+    size_t end = buf->arenaLimit;
+    if (size == 0 || size > end) return NULL;
+    
+    for (;;) {
+        if (buf->count == 0) {
+            buf->arenaHead = 0;
+            return ArenaCommit(buf, 0, size);
+        }
+        
+        size_t head = buf->arenaHead;
+        size_t tailOffset = (size_t)(buf->frames[buf->tail].data - buf->arena);
+        if (head > tailOffset) {
+            // Live bytes are [tail, head): free space at the end, then before tail.
+            // After a shrink the head may sit past the wrap point until it wraps.
+            if (head <= end && end - head >= size) return ArenaCommit(buf, head, size);
+            if (tailOffset >= size) return ArenaCommit(buf, 0, size);
+        } else {
+            // Wrapped: live bytes are [tail, old end) + [0, head), free is
+            // [head, tail), capped at the wrap point
+            size_t freeEnd = tailOffset < end ? tailOffset : end;
+            if (freeEnd >= head && freeEnd - head >= size) return ArenaCommit(buf, head, size);
+        }
+        
+        if (!EvictOldest(buf)) return NULL;
+        buf->arenaEvictions++;
+    }
+}
+
+// Enable SeLockMemoryPrivilege in the process token, needed for
+// MEM_LARGE_PAGES. Fails unless the account holds the privilege ("Lock
+// pages in memory"). Checked once per process.
+static BOOL EnableLockMemoryPrivilege(void) {
+    static LONG s_state = 0;    // 0 = not tried, 1 = enabled, -1 = unavailable
+    if (s_state != 0) return s_state > 0;
+    
+    BOOL enabled = FALSE;
+    HANDLE token = NULL;
+    if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+        TOKEN_PRIVILEGES tp;
+        ZeroMemory(&tp, sizeof(tp));
+        tp.PrivilegeCount = 1;
+        tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if (LookupPrivilegeValueA(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) &&
+            AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL)) {
+            // Succeeds with ERROR_NOT_ALL_ASSIGNED when the account lacks it
+            enabled = (GetLastError() == ERROR_SUCCESS);
+        }
+        CloseHandle(token);
+    }
+    InterlockedExchange(&s_state, enabled ? 1 : -1);
+    return enabled;
+}
+
 /*
  * MULTI-RESOURCE FUNCTION: FrameBuffer_Init
- * Resources: 3 - frames array (calloc), critical section, initialized flag
+ * Resources: 4 - frames array (calloc), GOP index (calloc), critical section,
+ *            initialized flag
  * Pattern: goto-cleanup with SAFE_FREE
  * Init: ZeroMemory ensures NULL initialization
  */
@@ -131,6 +388,13 @@ BOOL FrameBuffer_Init(FrameBuffer* buf, int durationSeconds, int fps,
         goto cleanup;
     }
     
+    // Sized like frames[]: correct even if every frame were an IDR
+    buf->gopIndex = (GopIndexEntry*)calloc(capacity, sizeof(GopIndexEntry));
+    if (!buf->gopIndex) {
+        BufLog("Failed to allocate GOP index (%d entries)\n", capacity);
+        goto cleanup;
+    }
+    
     buf->capacity = capacity;
     buf->count = 0;
     buf->head = 0;
@@ -144,6 +408,8 @@ BOOL FrameBuffer_Init(FrameBuffer* buf, int durationSeconds, int fps,
     InitializeCriticalSection(&buf->lock);
     csInitialized = TRUE;
     buf->initialized = TRUE;
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_FRAME_INDEX,
+                           (size_t)capacity * (sizeof(BufferedFrame) + sizeof(GopIndexEntry)));
     
     BufLog("FrameBuffer_Init: capacity=%d, maxDuration=%llds\n", 
            capacity, buf->maxDuration / 10000000LL);
@@ -152,10 +418,125 @@ BOOL FrameBuffer_Init(FrameBuffer* buf, int durationSeconds, int fps,
     
 cleanup:
     SAFE_FREE(buf->frames);
+    SAFE_FREE(buf->gopIndex);
     if (csInitialized) DeleteCriticalSection(&buf->lock);
     return FALSE;
 }
 
+/*
+ * MULTI-RESOURCE FUNCTION: FrameBuffer_EnableArena
+ * Resources: 1 - arena (VirtualAlloc: large pages committed whole, else a
+ *            reservation committed lazily by ArenaCommit)
+ * Pattern: each attempt either succeeds or leaves nothing allocated
+ */
+BOOL FrameBuffer_EnableArena(FrameBuffer* buf, size_t arenaBytes, BOOL largePages) {
+    LWSR_ASSERT(buf != NULL);
+    
+    if (!buf || !buf->initialized || arenaBytes == 0) return FALSE;
+    
+    // Large pages must be committed (and are locked) up front, in multiples
+    // of the large-page size
+    size_t largePageSize = largePages ? GetLargePageMinimum() : 0;
+    BOOL tryLarge = largePageSize > 0 && EnableLockMemoryPrivilege();
+    
+    BOOL enabled = FALSE;
+    EnterCriticalSection(&buf->lock);
+    if (buf->count == 0 && !buf->arena) {
+        if (tryLarge) {
+            size_t rounded = ((arenaBytes + largePageSize - 1) / largePageSize) * largePageSize;
+            buf->arena = (BYTE*)VirtualAlloc(NULL, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                             PAGE_READWRITE);
+            if (buf->arena) {
+                buf->arenaSize = rounded;
+                buf->arenaCommitted = rounded;
+                buf->arenaLargePages = TRUE;
+                LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_FRAME_ARENA, rounded);
+            }
+        }
+        if (!buf->arena) {
+            buf->arena = (BYTE*)VirtualAlloc(NULL, arenaBytes, MEM_RESERVE, PAGE_READWRITE);
+            if (buf->arena) {
+                buf->arenaSize = arenaBytes;
+                buf->arenaCommitted = 0;
+                buf->arenaLargePages = FALSE;
+            }
+        }
+        if (buf->arena) {
+            buf->arenaLimit = buf->arenaSize;
+            buf->arenaHead = 0;
+            buf->arenaEvictions = 0;
+            enabled = TRUE;
+        }
+    }
+    LeaveCriticalSection(&buf->lock);
+    
+    if (enabled) {
+        BufLog("FrameBuffer_EnableArena: %zu MB byte arena (%s)\n", buf->arenaSize / (1024 * 1024),
+               buf->arenaLargePages ? "large pages, committed" : "reserved, committed on demand");
+    } else {
+        BufLog("FrameBuffer_EnableArena: %zu MB arena unavailable, using per-frame heap blocks\n",
+               arenaBytes / (1024 * 1024));
+    }
+    return enabled;
+}
+
+BOOL FrameBuffer_UsesArena(const FrameBuffer* buf) {
+    return buf && buf->arena != NULL;
+}
+
+void FrameBuffer_SetByteBudget(FrameBuffer* buf, size_t budgetBytes) {
+    LWSR_ASSERT(buf != NULL);
+    
+    if (!buf || !buf->initialized) return;
+    
+    EnterCriticalSection(&buf->lock);
+    buf->byteBudget = budgetBytes;
+    // The arena wraps within the budget; commit above it is released by
+    // ArenaTrimCommit once the head has wrapped below it
+    if (buf->arena) {
+        buf->arenaLimit = (budgetBytes > 0 && budgetBytes < buf->arenaSize) ? budgetBytes : buf->arenaSize;
+    }
+    BOOL pinnedCommit = buf->arena && buf->arenaLargePages && buf->arenaLimit < buf->arenaSize;
+    LeaveCriticalSection(&buf->lock);
+    
+    if (budgetBytes > 0) {
+        BufLog("FrameBuffer_SetByteBudget: %zu MB%s\n", budgetBytes / (1024 * 1024),
+               pinnedCommit ? " (large-page arena stays fully committed)" : "");
+    }
+}
+
+void FrameBuffer_SetExternalBytes(FrameBuffer* buf, size_t bytes) {
+    if (!buf) return;
+    InterlockedExchange64(&buf->externalBytes, (LONG64)bytes);
+}
+
+BOOL FrameBuffer_EnableSpill(FrameBuffer* buf, const char* dir, int spillSeconds,
+                             size_t spillBytes) {
+    LWSR_ASSERT(buf != NULL);
+    LWSR_ASSERT(dir != NULL);
+    
+    if (!buf || !buf->initialized || !dir || spillSeconds <= 0) return FALSE;
+    
+    // Same headroom/ceiling as the RAM ring
+    size_t rawCapacity = (size_t)((size_t)spillSeconds * (size_t)buf->fps * BUFFER_CAPACITY_HEADROOM);
+    int capacity = rawCapacity > MAX_BUFFER_CAPACITY ? MAX_BUFFER_CAPACITY : (int)rawCapacity;
+    if (capacity < MIN_BUFFER_CAPACITY) capacity = MIN_BUFFER_CAPACITY;
+    
+    BOOL enabled = FALSE;
+    EnterCriticalSection(&buf->lock);
+    if (buf->count == 0 && !buf->spill.active) {
+        enabled = FrameSpill_Open(&buf->spill, dir, spillBytes, capacity,
+                                  (LONGLONG)spillSeconds * MF_UNITS_PER_SECOND);
+    }
+    LeaveCriticalSection(&buf->lock);
+    
+    if (!enabled) {
+        BufLog("FrameBuffer_EnableSpill: no spill tier in %s, buffer limited to RAM (%llds)\n",
+               dir, buf->maxDuration / 10000000LL);
+    }
+    return enabled;
+}
+
 void FrameBuffer_Shutdown(FrameBuffer* buf) {
     if (!buf) return;
     
@@ -164,10 +545,24 @@ void FrameBuffer_Shutdown(FrameBuffer* buf) {
         
         // Free all frames
         for (int i = 0; i < buf->capacity; i++) {
-            FreeFrame(&buf->frames[i]);
+            FreeFrame(buf, &buf->frames[i]);
         }
         
         SAFE_FREE(buf->frames);
+        SAFE_FREE(buf->gopIndex);
+        LEAK_TRACK_BYTES_FREE(LEAK_SITE_FRAME_INDEX,
+                              (size_t)buf->capacity * (sizeof(BufferedFrame) + sizeof(GopIndexEntry)));
+        buf->gopCount = 0;
+        buf->usedBytes = 0;
+        if (buf->arena) {
+            VirtualFree(buf->arena, 0, MEM_RELEASE);
+            LEAK_TRACK_BYTES_FREE(LEAK_SITE_FRAME_ARENA, buf->arenaCommitted);
+        }
+        buf->arena = NULL;
+        buf->arenaSize = 0;
+        buf->arenaLimit = 0;
+        buf->arenaCommitted = 0;
+        FrameSpill_Close(&buf->spill);
         
         LeaveCriticalSection(&buf->lock);
         DeleteCriticalSection(&buf->lock);
@@ -201,6 +596,69 @@ BOOL FrameBuffer_Add(FrameBuffer* buf, EncodedFrame* frame) {
     // Evict old frames based on timestamp (keeps last maxDuration seconds)
     EvictOldFrames(buf, frame->timestamp);
     
+    // Over the byte budget and the oldest frames are pinned: drop this one
+    if (!EvictForBudget(buf, frame->size)) {
+        int drops = ++buf->budgetDrops;
+        LeaveCriticalSection(&buf->lock);
+        if ((drops % EVICT_LOG_INTERVAL) == 1) {
+            BufLog("FrameBuffer_Add: %u-byte frame does not fit the %zu MB byte budget, "
+                   "dropped (%d so far)\n", frame->size, buf->byteBudget / (1024 * 1024), drops);
+        }
+        return FALSE;
+    }
+    
+    // Full of frames pinned by a save in progress: drop this one
+    if (buf->count >= buf->capacity) {
+        int drops = ++buf->pinnedDrops;
+        LeaveCriticalSection(&buf->lock);
+        if ((drops % EVICT_LOG_INTERVAL) == 1) {
+            BufLog("FrameBuffer_Add: buffer full of pinned frames, dropped (%d so far)\n", drops);
+        }
+        return FALSE;
+    }
+    
+    if (buf->arena) {
+        // Arena mode: copy in, caller keeps frame->data
+        int evictionsBefore = buf->arenaEvictions;
+        BYTE* dst = ArenaReserve(buf, frame->size);
+        if (!dst) {
+            int drops = ++buf->pinnedDrops;
+            LeaveCriticalSection(&buf->lock);
+            if ((drops % EVICT_LOG_INTERVAL) == 1) {
+                BufLog("FrameBuffer_Add: no arena space for %u-byte frame (pinned by a save or "
+                       "larger than %zu-byte arena), dropped (%d so far)\n",
+                       frame->size, buf->arenaLimit, drops);
+            }
+            return FALSE;
+        }
+        memcpy(dst, frame->data, frame->size);
+        buf->arenaHead = (size_t)(dst - buf->arena) + frame->size;
+        ArenaTrimCommit(buf);
+        
+        BufferedFrame* slot = &buf->frames[buf->head];
+        slot->data = dst;
+        slot->size = frame->size;
+        slot->timestamp = frame->timestamp;
+        slot->duration = frame->duration;
+        slot->isKeyframe = frame->isKeyframe;
+        
+        IndexKeyframe(buf, frame);
+        buf->head = (buf->head + 1) % buf->capacity;
+        buf->count++;
+        buf->usedBytes += frame->size;
+        
+        // Arena full before maxDuration: span is shrinking (throttled log)
+        if (buf->arenaEvictions != evictionsBefore &&
+            (buf->arenaEvictions / EVICT_LOG_INTERVAL) != (evictionsBefore / EVICT_LOG_INTERVAL)) {
+            double span = (double)(frame->timestamp - buf->frames[buf->tail].timestamp) / 10000000.0;
+            BufLog("FrameBuffer: arena full, evicting early (span=%.2fs of %llds, %d space evictions)\n",
+                   span, buf->maxDuration / 10000000LL, buf->arenaEvictions);
+        }
+        
+        LeaveCriticalSection(&buf->lock);
+        return TRUE;
+    }
+    
     // Add to buffer (take ownership of data)
     // Note: This transfers ownership from NVENC (allocated there) to FrameBuffer
     // Track as: NVENC free (releasing) + FrameBuffer alloc (acquiring)
@@ -209,18 +667,24 @@ BOOL FrameBuffer_Add(FrameBuffer* buf, EncodedFrame* frame) {
     // Free any existing data in slot (shouldn't happen after eviction)
     if (slot->data) {
         LEAK_TRACK_FRAME_BUFFER_FREE();
+        LEAK_TRACK_BYTES_FREE(LEAK_SITE_FRAME_HEAP, slot->size);
         free(slot->data);
     }
     
     // Transfer ownership: NVENC releases, FrameBuffer acquires
     LEAK_TRACK_NVENC_FRAME_FREE();
     LEAK_TRACK_FRAME_BUFFER_ALLOC();
+    LEAK_TRACK_BYTES_FREE(LEAK_SITE_NVENC_BITSTREAM, frame->size);
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_FRAME_HEAP, frame->size);
     
     slot->data = frame->data;
     slot->size = frame->size;
     slot->timestamp = frame->timestamp;
     slot->duration = frame->duration;
     slot->isKeyframe = frame->isKeyframe;
+    buf->usedBytes += frame->size;
+    
+    IndexKeyframe(buf, frame);
     
     // Clear frame's pointer (we own it now)
     frame->data = NULL;
@@ -243,12 +707,12 @@ double FrameBuffer_GetDuration(FrameBuffer* buf) {
     
     EnterCriticalSection(&buf->lock);
     
-    // Calculate duration from timestamps: newest - oldest
+    // Calculate duration from timestamps: newest - oldest (oldest may be spilled)
     int newestIdx = (buf->head - 1 + buf->capacity) % buf->capacity;
     BufferedFrame* newest = &buf->frames[newestIdx];
-    BufferedFrame* oldest = &buf->frames[buf->tail];
+    LONGLONG oldestTs = SampleAtSeq(buf, OldestSeq(buf)).timestamp;
     
-    double duration = (double)(newest->timestamp - oldest->timestamp) / 10000000.0;
+    double duration = (double)(newest->timestamp - oldestTs) / 10000000.0;
     
     LeaveCriticalSection(&buf->lock);
     
@@ -263,7 +727,7 @@ int FrameBuffer_GetCount(FrameBuffer* buf) {
     if (!buf || !buf->initialized) return 0;
     
     EnterCriticalSection(&buf->lock);
-    int count = buf->count;
+    int count = buf->count + SpillCount(buf);
     LeaveCriticalSection(&buf->lock);
     
     return count;
@@ -277,134 +741,248 @@ size_t FrameBuffer_GetMemoryUsage(FrameBuffer* buf) {
     if (!buf || !buf->initialized) return 0;
     
     EnterCriticalSection(&buf->lock);
-    
-    size_t total = 0;
-    int idx = buf->tail;
-    for (int i = 0; i < buf->count; i++) {
-        total += buf->frames[idx].size;
-        idx = (idx + 1) % buf->capacity;
-    }
-    
+    size_t total = buf->usedBytes;
     LeaveCriticalSection(&buf->lock);
     
     return total;
 }
 
-// Get copies of frames for external muxing (caller must free)
-// Deep copies all data under lock to prevent use-after-free from eviction
-// CRITICAL: Always starts from the first keyframe to ensure valid HEVC decoding
-BOOL FrameBuffer_GetFramesForMuxing(FrameBuffer* buf, MuxerSample** outFrames, int* outCount,
-                                    LONGLONG* outOriginTimestamp) {
-    // Preconditions
+size_t FrameBuffer_GetSpillUsage(FrameBuffer* buf) {
     LWSR_ASSERT(buf != NULL);
-    LWSR_ASSERT(outFrames != NULL);
-    LWSR_ASSERT(outCount != NULL);
-    
-    // See FrameBuffer_Add: `initialized` is externally serialized, not lock-guarded.
-    if (!buf || !buf->initialized || !outFrames || !outCount) return FALSE;
     
-    *outFrames = NULL;
-    *outCount = 0;
-    if (outOriginTimestamp) *outOriginTimestamp = 0;
+    if (!buf || !buf->initialized) return 0;
     
     EnterCriticalSection(&buf->lock);
+    size_t total = FrameSpill_GetUsage(&buf->spill);
+    LeaveCriticalSection(&buf->lock);
     
-    int count = buf->count;
-    if (count == 0) {
-        LeaveCriticalSection(&buf->lock);
-        return FALSE;
+    return total;
+}
+
+// Sequence number of the IDR a range starting at ts must start at: the
+// newest one at or before ts, else the oldest one buffered. The RAM GOP
+// index answers unless ts is older than the first IDR in RAM; then the
+// spill is binary-searched and scanned back to its keyframe.
+static BOOL FindStartKeySeq(const FrameBuffer* buf, LONGLONG ts, UINT64* outSeq) {
+    int spillCount = SpillCount(buf);
+    if (buf->gopCount > 0 && (spillCount == 0 || GopAt(buf, 0)->timestamp <= ts)) {
+        *outSeq = GopAt(buf, GopFindAtOrBefore(buf, ts))->seq;
+        return TRUE;
     }
     
-    // CRITICAL FIX: Find the first keyframe (IDR) to start the clip
-    // Without this, clips extracted after long encoding sessions have invalid
-    // POC (Picture Order Count) references and decode with severe artifacts.
-    // The decoder expects the clip to start with an IDR that resets POC.
-    int startOffset = 0;
-    for (int i = 0; i < count; i++) {
-        BufferedFrame* src = &buf->frames[(buf->tail + i) % buf->capacity];
-        if (src->data && src->size > 0 && src->isKeyframe) {
-            startOffset = i;
-            BufLog("GetFramesForMuxing: Starting at keyframe offset %d (skipped %d frames)\n", 
-                   startOffset, startOffset);
-            break;
+    int lo = 0, hi = spillCount - 1, found = -1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (FrameSpill_At(&buf->spill, mid)->timestamp <= ts) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    for (int i = found; i >= 0; i--) {
+        if (FrameSpill_At(&buf->spill, i)->isKeyframe) {
+            *outSeq = buf->spill.tailSeq + (UINT64)i;
+            return TRUE;
+        }
+    }
+    for (int i = found + 1; i < spillCount; i++) {
+        if (FrameSpill_At(&buf->spill, i)->isKeyframe) {
+            *outSeq = buf->spill.tailSeq + (UINT64)i;
+            return TRUE;
         }
     }
+    if (buf->gopCount > 0) {
+        *outSeq = GopAt(buf, 0)->seq;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// Pin frames [startSeq, endSeq] (both tiers) in slot and describe them in
+// snap. Called with buf->lock held; releases it before building the
+// descriptors. Returns FALSE (unpinned) if they cannot be allocated.
+static BOOL PinSeqRangeAndUnlock(FrameBuffer* buf, int slot, UINT64 startSeq, UINT64 endSeq,
+                                 FrameBufferSnapshot* snap) {
+    buf->pinActive[slot] = TRUE;
+    buf->pinSeq[slot] = startSeq;
+    int count = (int)(endSeq - startSeq + 1);
+    int spilled = startSeq < buf->tailSeq ? (int)(buf->tailSeq - startSeq) : 0;
+    if (spilled > count) spilled = count;
+    // Ring positions, not tail-relative offsets: the tails may move once unlocked
+    int spillFirst = spilled > 0
+        ? (int)((buf->spill.tail + (startSeq - buf->spill.tailSeq)) % (UINT64)buf->spill.capacity) : 0;
+    int ramFirst = SlotForSeq(buf, startSeq + (UINT64)spilled);
+    LONGLONG firstTimestamp = SampleAtSeq(buf, startSeq).timestamp;
     
-    // Calculate actual frame count after skipping to keyframe
-    int actualCount = count - startOffset;
-    if (actualCount <= 0) {
-        LeaveCriticalSection(&buf->lock);
-        BufLog("GetFramesForMuxing: No keyframe found in buffer!\n");
+    LeaveCriticalSection(&buf->lock);
+    
+    snap->pinSlot = slot;
+    snap->samples = (MuxerSample*)calloc((size_t)count, sizeof(MuxerSample));
+    if (!snap->samples) {
+        BufLog("FrameBuffer: failed to allocate %d snapshot descriptors\n", count);
+        FrameBuffer_ReleaseSnapshot(buf, snap);
         return FALSE;
     }
+    snap->capacity = count;
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_SAVE_VIDEO_INDEX, (size_t)count * sizeof(MuxerSample));
     
-    // Allocate output array with overflow check (actualCount > 0 guaranteed above).
-    size_t allocSize = (size_t)actualCount * sizeof(MuxerSample);
-    if (allocSize / (size_t)actualCount != sizeof(MuxerSample)) {
-        LeaveCriticalSection(&buf->lock);
-        return FALSE;  // Overflow
+    // A pin in the spill tier freezes both tiers; a pin in RAM may let older
+    // RAM frames move to the spill, which never touches the slots read here
+    for (int i = 0; i < count; i++) {
+        MuxerSample* dst = &snap->samples[snap->count];
+        if (i < spilled) {
+            const SpillEntry* src = &buf->spill.entries[(spillFirst + i) % buf->spill.capacity];
+            dst->data = buf->spill.view + src->offset;
+            dst->size = src->size;
+            dst->timestamp = src->timestamp - firstTimestamp;
+            dst->duration = src->duration;
+            dst->isKeyframe = src->isKeyframe;
+        } else {
+            const BufferedFrame* src = &buf->frames[(ramFirst + (i - spilled)) % buf->capacity];
+            if (!src->data || src->size == 0) continue;
+            dst->data = src->data;
+            dst->size = src->size;
+            dst->timestamp = src->timestamp - firstTimestamp;
+            dst->duration = src->duration;
+            dst->isKeyframe = src->isKeyframe;
+        }
+        snap->count++;
     }
-    MuxerSample* frames = (MuxerSample*)malloc(allocSize);
-    if (!frames) {
+    snap->originTimestamp = firstTimestamp;
+    snap->nextSeq = endSeq + 1;
+    return TRUE;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: FrameBuffer_GetRange
+ * Resources: 2 - pin slot (under lock), samples array (malloc, outside lock)
+ * Pattern: pin released on allocation failure
+ *
+ * Under the lock: a search for the start IDR (GOP index, or the spill
+ * tier), a binary search across both tiers for the end, and a pin record at
+ * the start frame's sequence number. No allocation, no copies. Outside the
+ * lock: describe the pinned frames. Their slots and bytes are stable because
+ * eviction stops at a pinned tail, Add only writes free slots, and the
+ * spill only grows by RAM eviction (and never evicts a pinned entry).
+ */
+BOOL FrameBuffer_GetRange(FrameBuffer* buf, LONGLONG startTs, LONGLONG endTs,
+                          FrameBufferSnapshot* snap) {
+    LWSR_ASSERT(buf != NULL);
+    LWSR_ASSERT(snap != NULL);
+    
+    if (!buf || !buf->initialized || !snap) return FALSE;
+    ZeroMemory(snap, sizeof(*snap));
+    snap->pinSlot = -1;
+    
+    EnterCriticalSection(&buf->lock);
+    
+    int slot = -1;
+    for (int i = 0; i < FRAME_BUFFER_MAX_PINS; i++) {
+        if (!buf->pinActive[i]) { slot = i; break; }
+    }
+    
+    // Clips must start at an IDR: snap back to the one at or before startTs
+    UINT64 startSeq = 0;
+    if (slot < 0 || !FindStartKeySeq(buf, startTs, &startSeq)) {
         LeaveCriticalSection(&buf->lock);
+        BufLog("GetRange: %s\n", slot < 0 ? "all pin slots in use" : "no keyframe in buffer");
         return FALSE;
     }
     
-    // Find first timestamp for normalization (from the keyframe we're starting at)
-    LONGLONG firstTimestamp = 0;
-    BufferedFrame* firstFrame = &buf->frames[(buf->tail + startOffset) % buf->capacity];
-    if (firstFrame->data && firstFrame->size > 0) {
-        firstTimestamp = firstFrame->timestamp;
-    }
-    if (outOriginTimestamp) *outOriginTimestamp = firstTimestamp;
-    
-    // Zero-initialize to ensure safe cleanup on partial allocation failure
-    memset(frames, 0, allocSize);
-    
-    // Deep copy under lock prevents use-after-free vs concurrent eviction.
-    // Bound: up to MAX_BUFFER_CAPACITY (~27 min @60fps) malloc+memcpy stalls the producer;
-    // acceptable because save is a deliberate user action, not realtime.
-    int copiedCount = 0;
-    BOOL allocFailed = FALSE;
-    for (int i = startOffset; i < count && !allocFailed; i++) {
-        BufferedFrame* src = &buf->frames[(buf->tail + i) % buf->capacity];
-        if (src->data && src->size > 0) {
-            frames[copiedCount].data = (BYTE*)malloc(src->size);
-            if (frames[copiedCount].data) {
-                memcpy(frames[copiedCount].data, src->data, src->size);
-                frames[copiedCount].size = src->size;
-                frames[copiedCount].timestamp = src->timestamp - firstTimestamp;
-                frames[copiedCount].duration = src->duration;
-                frames[copiedCount].isKeyframe = src->isKeyframe;
-                copiedCount++;
-            } else {
-                // Allocation failed - will clean up after releasing lock
-                allocFailed = TRUE;
-            }
+    // Last frame at or before endTs (sequence numbers, binary search over both tiers)
+    UINT64 lo = startSeq, hi = buf->tailSeq + (UINT64)buf->count - 1, endSeq = startSeq;
+    while (lo <= hi) {
+        UINT64 mid = lo + (hi - lo) / 2;
+        if (SampleAtSeq(buf, mid).timestamp <= endTs) {
+            endSeq = mid;
+            lo = mid + 1;
+        } else {
+            if (mid == 0) break;
+            hi = mid - 1;
         }
     }
     
-    LeaveCriticalSection(&buf->lock);
+    if (!PinSeqRangeAndUnlock(buf, slot, startSeq, endSeq, snap)) return FALSE;
     
-    // Free the array if no frames were successfully copied or allocation failed
-    if (copiedCount == 0 || allocFailed) {
-        // Free any frames that were copied before failure
-        for (int i = 0; i < copiedCount; i++) {
-            if (frames[i].data) free(frames[i].data);
-        }
-        free(frames);
+    BufLog("GetRange: pinned %d frames\n", snap->count);
+    return TRUE;
+}
+
+BOOL FrameBuffer_PinFrom(FrameBuffer* buf, UINT64 fromSeq, FrameBufferSnapshot* snap,
+                         int* lostFrames) {
+    LWSR_ASSERT(buf != NULL);
+    LWSR_ASSERT(snap != NULL);
+    
+    if (lostFrames) *lostFrames = 0;
+    if (!buf || !buf->initialized || !snap) return FALSE;
+    ZeroMemory(snap, sizeof(*snap));
+    snap->pinSlot = -1;
+    
+    EnterCriticalSection(&buf->lock);
+    
+    int slot = -1;
+    for (int i = 0; i < FRAME_BUFFER_MAX_PINS; i++) {
+        if (!buf->pinActive[i]) { slot = i; break; }
+    }
+    
+    UINT64 oldestSeq = OldestSeq(buf);
+    UINT64 endSeq = buf->tailSeq + (UINT64)buf->count;   // Exclusive
+    if (fromSeq < oldestSeq) {
+        // Evicted before the caller got to them
+        if (lostFrames) *lostFrames = (int)(oldestSeq - fromSeq);
+        fromSeq = oldestSeq;
+    }
+    if (slot < 0 || fromSeq >= endSeq) {
+        LeaveCriticalSection(&buf->lock);
+        snap->nextSeq = fromSeq;
         return FALSE;
     }
     
-    *outFrames = frames;
-    *outCount = copiedCount;
-    return TRUE;
+    return PinSeqRangeAndUnlock(buf, slot, fromSeq, endSeq - 1, snap);
+}
+
+BOOL FrameBuffer_PinSnapshot(FrameBuffer* buf, FrameBufferSnapshot* snap) {
+    return FrameBuffer_GetRange(buf, MINLONGLONG, MAXLONGLONG, snap);
+}
+
+BOOL FrameBuffer_GetTimeBounds(FrameBuffer* buf, LONGLONG* oldestKeyTs, LONGLONG* newestTs) {
+    LWSR_ASSERT(buf != NULL);
+    
+    if (!buf || !buf->initialized) return FALSE;
+    
+    EnterCriticalSection(&buf->lock);
+    UINT64 oldestKeySeq = 0;
+    BOOL ok = buf->count > 0 && FindStartKeySeq(buf, MINLONGLONG, &oldestKeySeq);
+    if (ok) {
+        if (oldestKeyTs) *oldestKeyTs = SampleAtSeq(buf, oldestKeySeq).timestamp;
+        if (newestTs) *newestTs = buf->frames[(buf->head - 1 + buf->capacity) % buf->capacity].timestamp;
+    }
+    LeaveCriticalSection(&buf->lock);
+    return ok;
+}
+
+void FrameBuffer_ReleaseSnapshot(FrameBuffer* buf, FrameBufferSnapshot* snap) {
+    if (!buf || !snap) return;
+    
+    if (buf->initialized && snap->pinSlot >= 0 && snap->pinSlot < FRAME_BUFFER_MAX_PINS) {
+        EnterCriticalSection(&buf->lock);
+        buf->pinActive[snap->pinSlot] = FALSE;
+        LeaveCriticalSection(&buf->lock);
+    }
+    if (snap->samples) {
+        LEAK_TRACK_BYTES_FREE(LEAK_SITE_SAVE_VIDEO_INDEX, (size_t)snap->capacity * sizeof(MuxerSample));
+    }
+    SAFE_FREE(snap->samples);
+    snap->count = 0;
+    snap->capacity = 0;
+    snap->pinSlot = -1;
 }
 
 // Written once at startup before any consumer touches seqHeader/seqHeaderSize.
 // Lock is taken here for symmetry only; readers (replay_buffer.c HandleSaveRequest)
 // access these fields lock-free, which is safe under the write-once contract.
-void FrameBuffer_SetSequenceHeader(FrameBuffer* buf, const BYTE* header, DWORD size) {
+void FrameBuffer_SetSequenceHeader(FrameBuffer* buf, VideoCodec codec, const BYTE* header, DWORD size) {
     // Preconditions
     LWSR_ASSERT(buf != NULL);
     LWSR_ASSERT(header != NULL);
@@ -416,6 +994,7 @@ void FrameBuffer_SetSequenceHeader(FrameBuffer* buf, const BYTE* header, DWORD s
     EnterCriticalSection(&buf->lock);
     memcpy(buf->seqHeader, header, size);
     buf->seqHeaderSize = size;
+    buf->codec = codec;
     LeaveCriticalSection(&buf->lock);
-    BufLog("SetSequenceHeader: %u bytes\n", size);
+    BufLog("SetSequenceHeader: %s, %u bytes\n", codec == CODEC_AV1 ? "AV1" : "HEVC", size);
 }
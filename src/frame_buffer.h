@@ -5,6 +5,24 @@
  * 
  * Thread-safe ring buffer storing last N seconds of encoded HEVC frames.
  * Recording uses StreamingMuxer instead (writes directly to disk).
+ *
+ * Storage modes:
+ *   - Heap (default): each frame's bytes are a separate malloc block that
+ *     FrameBuffer_Add takes ownership of and eviction frees.
+ *   - Arena (FrameBuffer_EnableArena): one circular byte arena.
+ *     FrameBuffer_Add copies the bitstream in at the head offset and
+ *     eviction just advances the tail; no per-frame heap traffic. The arena
+ *     is a VirtualAlloc reservation committed in FRAME_ARENA_COMMIT_CHUNK_MB
+ *     steps as the head first reaches them, or, when large pages are
+ *     requested and SeLockMemoryPrivilege is held, one committed large-page
+ *     block (fewer TLB misses on the copy-in and mux paths). A byte budget
+ *     lowers the wrap point; pages above it are decommitted once unused.
+ *
+ * Spill tier (FrameBuffer_EnableSpill, either mode): evicted frames are
+ * appended to a memory-mapped ring file (frame_spill.c) instead of being
+ * dropped. RAM then holds only the hot newest maxDuration; the spill holds
+ * the older part of the window. Frame sequence numbers run across both
+ * tiers, so snapshots, pins and range lookups span them transparently.
  */
 
 #ifndef FRAME_BUFFER_H
@@ -15,6 +33,7 @@
 #include "config.h"
 #include "mp4_muxer.h"
 #include "constants.h"
+#include "frame_spill.h"
 
 // Stored frame in the buffer
 typedef struct {
@@ -25,10 +44,65 @@ typedef struct {
     BOOL isKeyframe;        // TRUE if IDR frame
 } BufferedFrame;
 
+// GOP index entry: one per buffered IDR, oldest first
+typedef struct {
+    UINT64 seq;             // Arrival sequence number (see tailSeq)
+    LONGLONG timestamp;     // Presentation time (100-ns units)
+} GopIndexEntry;
+
+// Pinned view of the buffer for muxing without copying frame bytes.
+// samples[i].data points into FrameBuffer storage (RAM or the spill file
+// view) and stays valid (and unmodified) until FrameBuffer_ReleaseSnapshot.
+typedef struct {
+    MuxerSample* samples;       // Starts at an IDR; timestamps rebased to 0
+    int count;
+    int capacity;               // Internal; length of the samples allocation
+    LONGLONG originTimestamp;   // Pre-rebase PTS of samples[0]; rebase audio against it
+    UINT64 nextSeq;             // Sequence number after the last pinned frame (FrameBuffer_PinFrom)
+    int pinSlot;                // Internal; -1 = not pinned
+} FrameBufferSnapshot;
+
 // Circular frame buffer
 typedef struct {
     BufferedFrame* frames;      // Array of frames
     int capacity;               // Max frames in buffer
+    
+    BYTE* arena;                // Arena mode: frame bytes live here (NULL = heap mode)
+    size_t arenaSize;           // Reserved arena bytes
+    size_t arenaLimit;          // Wrap point (<= arenaSize, lowered by a byte budget)
+    size_t arenaCommitted;      // Committed prefix of the reservation
+    size_t arenaHead;           // Next write offset; the tail is frames[tail].data
+    BOOL arenaLargePages;       // Committed whole with MEM_LARGE_PAGES
+    int arenaEvictions;         // Frames evicted for space before maxDuration
+    int arenaCommitFailures;    // Frames dropped because the commit failed
+    
+    // Snapshot pins (see FrameBuffer_PinSnapshot). Frames are numbered in
+    // arrival order; tailSeq is the number of frames[tail].
+    UINT64 tailSeq;
+    BOOL pinActive[FRAME_BUFFER_MAX_PINS];
+    UINT64 pinSeq[FRAME_BUFFER_MAX_PINS];   // First pinned frame of each snapshot
+    int pinnedDrops;            // Frames dropped because pinned frames filled the buffer
+    
+    // Keyframe index, a ring parallel to frames (capacity entries, so it can
+    // never overflow). Pushed by Add, popped when the IDR itself is evicted.
+    GopIndexEntry* gopIndex;
+    int gopTail;                // Oldest entry
+    int gopCount;               // Buffered IDRs
+    
+    // Disk tier holding the frames evicted from RAM, contiguous in sequence
+    // numbers just before tailSeq (inactive unless FrameBuffer_EnableSpill)
+    FrameSpill spill;
+    int spillFailures;          // Evicted frames that could not be spilled (spill restarted)
+    
+    // Exact RAM accounting: frame bytes, updated on every add and evict.
+    // With a byte budget, Add evicts until usedBytes + externalBytes + the
+    // new frame fit, and drops the frame if pinned frames prevent that.
+    size_t usedBytes;
+    size_t byteBudget;          // 0 = no budget (duration/capacity limits only)
+    volatile LONG64 externalBytes;  // Charged by other stores (replay audio); see SetExternalBytes
+    int budgetEvictions;        // Frames evicted to stay within byteBudget
+    int budgetDrops;            // Frames dropped because pinned frames held the budget
+    
     int count;                  // Current frame count
     int head;                   // Next write position
     int tail;                   // Oldest frame position
@@ -40,8 +114,9 @@ typedef struct {
     int fps;                    // Frame rate
     QualityPreset quality;      // Quality preset
     
-    BYTE seqHeader[MAX_SEQ_HEADER_SIZE];  // HEVC VPS/SPS/PPS sequence header
+    BYTE seqHeader[MAX_SEQ_HEADER_SIZE];  // HEVC VPS/SPS/PPS or AV1 sequence OBU
     DWORD seqHeaderSize;        // Sequence header size
+    VideoCodec codec;           // Codec of the frames and seqHeader
     
     CRITICAL_SECTION lock;      // Thread safety
     BOOL initialized;
@@ -54,37 +129,91 @@ typedef struct {
 BOOL FrameBuffer_Init(FrameBuffer* buf, int durationSeconds, int fps, 
                       int width, int height, QualityPreset quality);
 
+// Switch a freshly initialized, still empty buffer to arena storage of
+// arenaBytes. largePages tries a committed MEM_LARGE_PAGES block first (all
+// of arenaBytes locked at once, so pass it only for a budget-sized arena)
+// and falls back to a lazily committed reservation. Returns FALSE (buffer stays
+// in heap mode) if the reservation fails or frames were already added.
+BOOL FrameBuffer_EnableArena(FrameBuffer* buf, size_t arenaBytes, BOOL largePages);
+
+// TRUE if the buffer stores frames in its byte arena
+BOOL FrameBuffer_UsesArena(const FrameBuffer* buf);
+
+// Cap RAM held by frame bytes plus SetExternalBytes at budgetBytes (0 =
+// uncapped). The buffered span then shrinks to whatever fits; it never grows
+// past the Init duration.
+void FrameBuffer_SetByteBudget(FrameBuffer* buf, size_t budgetBytes);
+
+// Bytes held outside the buffer that count against the byte budget (the
+// replay audio tracks). Lock-free; takes effect on the next Add.
+void FrameBuffer_SetExternalBytes(FrameBuffer* buf, size_t bytes);
+
+// Add a spill tier to a freshly initialized, still empty buffer: a
+// spillBytes file in dir keeping up to spillSeconds of frames evicted from
+// RAM. Returns FALSE (evicted frames are dropped as before) if the file
+// cannot be created and mapped.
+BOOL FrameBuffer_EnableSpill(FrameBuffer* buf, const char* dir, int spillSeconds,
+                             size_t spillBytes);
+
 // Shutdown and free all resources
 void FrameBuffer_Shutdown(FrameBuffer* buf);
 
 // Add an encoded frame to the buffer.
-// Takes ownership of frame->data; caller should not free it.
+// Heap mode: takes ownership of frame->data; caller should not free it.
+// Arena mode: copies frame->data into the arena and leaves it untouched, so
+// frame->data may be a borrowed pointer (NVENCEncoder_SetBorrowedOutput).
 // PRECONDITION: frame->timestamp must be monotonic non-decreasing across calls.
 // Eviction compares the incoming timestamp to the tail timestamp; a backwards
 // jump (clock reset, encoder re-init reusing this buffer) breaks span math and
 // will stop evicting until the timeline catches up.
 BOOL FrameBuffer_Add(FrameBuffer* buf, EncodedFrame* frame);
 
-// Get current buffered duration in seconds
+// Get current buffered duration in seconds (both tiers)
 double FrameBuffer_GetDuration(FrameBuffer* buf);
 
-// Get current frame count
+// Get current frame count (both tiers)
 int FrameBuffer_GetCount(FrameBuffer* buf);
 
-// Get total memory usage in bytes
+// Get total memory usage in bytes (RAM tier only, exact and O(1))
 size_t FrameBuffer_GetMemoryUsage(FrameBuffer* buf);
 
-// Get copies of frames for external muxing (caller must free)
-// Used for audio+video muxing.
-// On success, *originTimestamp (if non-NULL) receives the absolute (t0-relative,
-// pre-rebase) timestamp of the first kept frame (the IDR the clip starts at).
-// Callers MUST use this value to rebase audio streams to the same origin,
-// otherwise A/V will drift by up to one GOP because the buffer skips leading
-// non-keyframes while audio retains all its samples.
-BOOL FrameBuffer_GetFramesForMuxing(FrameBuffer* buf, MuxerSample** frames, int* count,
-                                    LONGLONG* originTimestamp);
-
-// Set HEVC sequence header (VPS/SPS/PPS) for muxing
-void FrameBuffer_SetSequenceHeader(FrameBuffer* buf, const BYTE* header, DWORD size);
+// Bytes of frame data in the spill file (0 without a spill tier)
+size_t FrameBuffer_GetSpillUsage(FrameBuffer* buf);
+
+// Pin the frames covering [startTs, endTs] (absolute buffer PTS, 100-ns
+// units) and describe them in snap->samples without copying their bytes.
+// The start snaps back to the nearest IDR at or before startTs (the oldest
+// IDR if none); every frame with timestamp <= endTs is included. While
+// pinned they are not evicted; if they fill the buffer, new frames are
+// dropped (logged) rather than overwriting them, so release promptly. A range
+// starting in the spill tier also stops RAM eviction, so the hot tier's
+// capacity headroom is what a long save from disk has to finish within. Cost
+// under the lock is two binary searches (plus a scan back to the spilled IDR
+// when the start is on disk). Up to FRAME_BUFFER_MAX_PINS at once.
+BOOL FrameBuffer_GetRange(FrameBuffer* buf, LONGLONG startTs, LONGLONG endTs,
+                          FrameBufferSnapshot* snap);
+
+// FrameBuffer_GetRange over the whole buffer (first keyframe onward)
+BOOL FrameBuffer_PinSnapshot(FrameBuffer* buf, FrameBufferSnapshot* snap);
+
+// Continue after an earlier snapshot: pin every frame numbered >= fromSeq
+// (that snapshot's nextSeq) up to the newest, without snapping back to an
+// IDR. Timestamps are rebased on snap->originTimestamp as usual. Returns
+// FALSE if nothing newer is buffered or no pin slot is free. If frames
+// from fromSeq on were already evicted, *lostFrames (if non-NULL) gets how
+// many and the snapshot starts at the oldest frame left, which need not be
+// an IDR.
+BOOL FrameBuffer_PinFrom(FrameBuffer* buf, UINT64 fromSeq, FrameBufferSnapshot* snap,
+                         int* lostFrames);
+
+// Timestamp of the oldest buffered IDR and of the newest frame.
+// Returns FALSE when the buffer holds no keyframe yet.
+BOOL FrameBuffer_GetTimeBounds(FrameBuffer* buf, LONGLONG* oldestKeyTs, LONGLONG* newestTs);
+
+// Unpin and free the sample descriptors. Safe on a failed/zeroed snapshot.
+void FrameBuffer_ReleaseSnapshot(FrameBuffer* buf, FrameBufferSnapshot* snap);
+
+// Set the stream's codec and sequence header (HEVC VPS/SPS/PPS, AV1 OBU) for muxing
+void FrameBuffer_SetSequenceHeader(FrameBuffer* buf, VideoCodec codec, const BYTE* header, DWORD size);
 
 #endif // FRAME_BUFFER_H
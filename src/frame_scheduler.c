@@ -0,0 +1,142 @@
+/*
+ * frame_scheduler.c - High-resolution waitable-timer frame pacing
+ *
+ * Each wait arms the timer with a relative due time (100 ns units) computed
+ * from the QPC deadline, then waits on the caller's handles plus the timer.
+ * High-resolution timers wake within ~0.5 ms of the deadline without
+ * raising the global timer resolution, so the loop sleeps through the
+ * frame interval instead of waking every millisecond.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Init returns FALSE only if no timer at all can be created; the
+ *   scheduler is still usable (millisecond waits at a 1 ms timer period)
+ * - Without a timer, or if it can't be armed, Wait degrades to a millisecond
+ *   wait on the caller's handles so the loop never spins
+ * - Wait returns FRAME_WAIT_FAILED on a failed wait; callers treat it as due
+ */
+
+#include "frame_scheduler.h"
+#include "constants.h"
+#include "logger.h"
+#include "mem_utils.h"
+#include "util.h"
+#include <mmsystem.h>  // timeBeginPeriod/timeEndPeriod (fallback only)
+
+#pragma comment(lib, "winmm.lib")
+
+// Windows 10 1803+; older SDKs don't define it
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+BOOL FrameScheduler_Init(FrameScheduler* sched, int fps) {
+    LWSR_ASSERT(sched != NULL);
+    LWSR_ASSERT(fps > 0);
+    if (!sched) return FALSE;
+    
+    ZeroMemory(sched, sizeof(*sched));
+    if (fps < 1) fps = 1;
+    QueryPerformanceFrequency(&sched->freq);
+    sched->fps = fps;
+    sched->intervalTicks = sched->freq.QuadPart / fps;
+    
+    sched->hTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                           TIMER_ALL_ACCESS);
+    if (sched->hTimer) {
+        sched->highResolution = TRUE;
+        Logger_Log("FrameScheduler: high-resolution waitable timer (%d fps)\n", fps);
+        return TRUE;
+    }
+    
+    // Fallback: ordinary timer, needs the 1 ms system period for accuracy
+    sched->hTimer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    timeBeginPeriod(1);
+    sched->periodRaised = TRUE;
+    if (!sched->hTimer) {
+        Logger_Log("FrameScheduler: CreateWaitableTimerEx failed (error=%lu), using millisecond waits\n",
+                   GetLastError());
+        return FALSE;
+    }
+    Logger_Log("FrameScheduler: high-resolution timer unavailable, using 1 ms timer period (%d fps)\n", fps);
+    return TRUE;
+}
+
+LONGLONG FrameScheduler_FrameTime(const FrameScheduler* sched, LARGE_INTEGER start, UINT64 frameIndex) {
+    // Split so frameIndex * freq can't overflow on long sessions
+    LONGLONG fps = sched->fps;
+    LONGLONG whole = (LONGLONG)(frameIndex / (UINT64)fps);
+    LONGLONG rem = (LONGLONG)(frameIndex % (UINT64)fps);
+    return start.QuadPart + whole * sched->freq.QuadPart + rem * sched->freq.QuadPart / fps;
+}
+
+FrameWaitResult FrameScheduler_WaitUntil(FrameScheduler* sched, LONGLONG dueQpc,
+                                         const HANDLE* handles, DWORD handleCount,
+                                         DWORD maxWaitMs, DWORD* signaledIndex) {
+    LWSR_ASSERT(sched != NULL);
+    LWSR_ASSERT(handleCount < MAXIMUM_WAIT_OBJECTS);
+    
+    HANDLE waits[MAXIMUM_WAIT_OBJECTS];
+    for (DWORD i = 0; i < handleCount; i++) waits[i] = handles[i];
+    
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    
+    // Already due: still give the caller's events a chance (stop must win)
+    if (now.QuadPart >= dueQpc) {
+        DWORD wr = handleCount ? WaitForMultipleObjects(handleCount, waits, FALSE, 0) : WAIT_TIMEOUT;
+        if (wr < WAIT_OBJECT_0 + handleCount) {
+            if (signaledIndex) *signaledIndex = wr - WAIT_OBJECT_0;
+            return FRAME_WAIT_SIGNALED;
+        }
+        return FRAME_WAIT_DUE;
+    }
+    
+    LARGE_INTEGER deadline;
+    deadline.QuadPart = dueQpc;
+    LONGLONG remainingHns = Util_QpcDeltaToHns(deadline, now, sched->freq);
+    BOOL capped = FALSE;
+    if (maxWaitMs != INFINITE && remainingHns > (LONGLONG)maxWaitMs * 10000) {
+        remainingHns = (LONGLONG)maxWaitMs * 10000;
+        capped = TRUE;
+    }
+    
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -remainingHns;  // negative = relative
+    if (!sched->hTimer || !SetWaitableTimerEx(sched->hTimer, &dueTime, 0, NULL, NULL, NULL, 0)) {
+        DWORD waitMs = (DWORD)(remainingHns / 10000);
+        if (waitMs == 0) waitMs = 1;
+        DWORD fr = WAIT_TIMEOUT;
+        if (handleCount) fr = WaitForMultipleObjects(handleCount, waits, FALSE, waitMs);
+        else Sleep(waitMs);
+        if (fr < WAIT_OBJECT_0 + handleCount) {
+            if (signaledIndex) *signaledIndex = fr - WAIT_OBJECT_0;
+            return FRAME_WAIT_SIGNALED;
+        }
+        if (fr == WAIT_TIMEOUT) return capped ? FRAME_WAIT_IDLE : FRAME_WAIT_DUE;
+        return FRAME_WAIT_FAILED;
+    }
+    
+    waits[handleCount] = sched->hTimer;
+    DWORD wr = WaitForMultipleObjects(handleCount + 1, waits, FALSE, INFINITE);
+    if (wr < WAIT_OBJECT_0 + handleCount) {
+        CancelWaitableTimer(sched->hTimer);
+        if (signaledIndex) *signaledIndex = wr - WAIT_OBJECT_0;
+        return FRAME_WAIT_SIGNALED;
+    }
+    if (wr == WAIT_OBJECT_0 + handleCount) {
+        return capped ? FRAME_WAIT_IDLE : FRAME_WAIT_DUE;
+    }
+    return FRAME_WAIT_FAILED;
+}
+
+void FrameScheduler_Shutdown(FrameScheduler* sched) {
+    if (!sched) return;
+    
+    if (sched->hTimer) {
+        CancelWaitableTimer(sched->hTimer);
+        SAFE_CLOSE_HANDLE(sched->hTimer);
+    }
+    if (sched->periodRaised) timeEndPeriod(1);
+    sched->highResolution = FALSE;
+    sched->periodRaised = FALSE;
+}
@@ -0,0 +1,54 @@
+/*
+ * frame_scheduler.h - High-resolution frame pacing for the capture loops
+ *
+ * SHARED BY: replay_buffer.c, recording.c
+ *
+ * Sleeps until a QPC deadline on a CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+ * timer while still waking for the caller's stop/save events. No
+ * system-wide timeBeginPeriod is needed on that path. On systems without
+ * high-resolution timers (pre Windows 10 1803) it falls back to a 1 ms
+ * timer period and millisecond waits, i.e. the previous behaviour.
+ *
+ * Thread safety: one scheduler per thread; not shared between threads.
+ */
+
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <windows.h>
+
+typedef struct {
+    HANDLE hTimer;              // Waitable timer (high-resolution if available)
+    BOOL highResolution;        // FALSE = fallback path (ordinary timer or none)
+    BOOL periodRaised;          // timeBeginPeriod(1) taken; released by Shutdown
+    LARGE_INTEGER freq;         // QPC frequency
+    int fps;                    // Target frame rate
+    LONGLONG intervalTicks;     // QPC ticks per frame at the target fps
+} FrameScheduler;
+
+typedef enum {
+    FRAME_WAIT_DUE = 0,         // Deadline reached
+    FRAME_WAIT_IDLE,            // maxWaitMs elapsed first (caller has other polling work)
+    FRAME_WAIT_SIGNALED,        // One of the caller's handles was signaled
+    FRAME_WAIT_FAILED
+} FrameWaitResult;
+
+// Create the timer for a loop running at fps. FALSE if no timer could be
+// created; WaitUntil then paces with millisecond waits, so the scheduler
+// must still be used and shut down.
+BOOL FrameScheduler_Init(FrameScheduler* sched, int fps);
+
+// QPC time of frame `frameIndex` counted from `start`
+LONGLONG FrameScheduler_FrameTime(const FrameScheduler* sched, LARGE_INTEGER start, UINT64 frameIndex);
+
+// Block until the QPC deadline `dueQpc`, one of `handles` is signaled, or
+// maxWaitMs elapses (INFINITE = no cap). *signaledIndex receives the handle
+// index for FRAME_WAIT_SIGNALED. handleCount must be < MAXIMUM_WAIT_OBJECTS.
+FrameWaitResult FrameScheduler_WaitUntil(FrameScheduler* sched, LONGLONG dueQpc,
+                                         const HANDLE* handles, DWORD handleCount,
+                                         DWORD maxWaitMs, DWORD* signaledIndex);
+
+// Release the timer (and the 1 ms timer period on the fallback path)
+void FrameScheduler_Shutdown(FrameScheduler* sched);
+
+#endif // FRAME_SCHEDULER_H
@@ -0,0 +1,222 @@
+/*
+ * frame_spill.c - Memory-mapped disk tier for the replay FrameBuffer
+ *
+ * USED BY: frame_buffer.c ONLY
+ *
+ * Byte layout matches the FrameBuffer arena: frames are stored whole, never
+ * split across the end of the file. If the run up to the end is too short
+ * the frame goes to offset 0 and the gap is reclaimed with the entries in
+ * front of it.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Win32 failures logged with GetLastError and return FALSE
+ * - Open uses goto-cleanup; a failed spill is simply left inactive
+ * - Caller (FrameBuffer) serializes every call under its own lock
+ */
+
+#include "frame_spill.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include <stdio.h>
+
+// Alias for logging
+#define SpillLog Logger_Log
+
+#define SPILL_SEGMENT_BYTES ((size_t)FRAME_SPILL_SEGMENT_MB * 1024 * 1024)
+
+static SpillEntry* EntryAt(const FrameSpill* spill, int i) {
+    return &spill->entries[(spill->tail + i) % spill->capacity];
+}
+
+static BOOL EvictOldest(FrameSpill* spill, UINT64 keepFromSeq) {
+    if (spill->count == 0 || spill->tailSeq >= keepFromSeq) return FALSE;
+    spill->usedBytes -= spill->entries[spill->tail].size;
+    spill->tail = (spill->tail + 1) % spill->capacity;
+    spill->tailSeq++;
+    spill->count--;
+    return TRUE;
+}
+
+// Offset with room for size bytes, evicting unpinned entries as needed.
+// Returns (size_t)-1 if the space is pinned.
+static size_t Reserve(FrameSpill* spill, DWORD size, UINT64 keepFromSeq) {
+    for (;;) {
+        if (spill->count == 0) return 0;
+
+        size_t tailOffset = spill->entries[spill->tail].offset;
+        if (spill->head > tailOffset) {
+            if (spill->size - spill->head >= size) return spill->head;
+            if (tailOffset >= size) return 0;
+        } else if (tailOffset - spill->head >= size) {
+            return spill->head;
+        }
+
+        if (!EvictOldest(spill, keepFromSeq)) return (size_t)-1;
+        spill->spaceEvictions++;
+    }
+}
+
+// Release the segment the head just left from the working set. The pages
+// are not locked, so VirtualUnlock only trims them (and reports
+// ERROR_NOT_LOCKED); dirty pages go to the modified list for write-back.
+static void TrimFinishedSegments(FrameSpill* spill) {
+    size_t segment = spill->head / SPILL_SEGMENT_BYTES;
+    if (segment == spill->trimmedSegment) return;
+
+    size_t start = spill->trimmedSegment * SPILL_SEGMENT_BYTES;
+    size_t length = spill->size - start;
+    if (length > SPILL_SEGMENT_BYTES) length = SPILL_SEGMENT_BYTES;
+    VirtualUnlock(spill->view + start, length);
+    spill->trimmedSegment = segment;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: FrameSpill_Open
+ * Resources: 4 - entry ring (calloc), file handle, mapping handle, view
+ * Pattern: goto-cleanup in reverse acquisition order
+ * Init: ZeroMemory ensures NULL initialization
+ */
+BOOL FrameSpill_Open(FrameSpill* spill, const char* dir, size_t bytes, int capacity,
+                     LONGLONG maxDuration) {
+    LWSR_ASSERT(spill != NULL);
+    LWSR_ASSERT(dir != NULL);
+
+    if (!spill) return FALSE;
+    ZeroMemory(spill, sizeof(*spill));
+    spill->file = INVALID_HANDLE_VALUE;
+    if (!dir || !dir[0] || bytes < SPILL_SEGMENT_BYTES || capacity <= 0) return FALSE;
+
+    spill->entries = (SpillEntry*)calloc((size_t)capacity, sizeof(SpillEntry));
+    if (!spill->entries) {
+        SpillLog("FrameSpill_Open: failed to allocate %d entries\n", capacity);
+        goto cleanup;
+    }
+
+    if (!CreateDirectoryA(dir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+        SpillLog("FrameSpill_Open: cannot create %s (error %lu)\n", dir, GetLastError());
+        goto cleanup;
+    }
+    _snprintf_s(spill->path, sizeof(spill->path), _TRUNCATE, "%s\\lwsr_spill_%lu.bin",
+                dir, GetCurrentProcessId());
+
+    spill->file = CreateFileA(spill->path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (spill->file == INVALID_HANDLE_VALUE) {
+        SpillLog("FrameSpill_Open: CreateFile %s failed (error %lu)\n", spill->path, GetLastError());
+        goto cleanup;
+    }
+
+    // Sizing the mapping extends the file
+    spill->mapping = CreateFileMappingA(spill->file, NULL, PAGE_READWRITE,
+                                        (DWORD)((UINT64)bytes >> 32), (DWORD)bytes, NULL);
+    if (!spill->mapping) {
+        SpillLog("FrameSpill_Open: %zu MB mapping failed (error %lu)\n",
+                 bytes / (1024 * 1024), GetLastError());
+        goto cleanup;
+    }
+
+    spill->view = (BYTE*)MapViewOfFile(spill->mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, bytes);
+    if (!spill->view) {
+        SpillLog("FrameSpill_Open: MapViewOfFile failed (error %lu)\n", GetLastError());
+        goto cleanup;
+    }
+
+    spill->size = bytes;
+    spill->capacity = capacity;
+    spill->maxDuration = maxDuration;
+    spill->active = TRUE;
+
+    SpillLog("FrameSpill_Open: %zu MB at %s, %llds, %d frames\n",
+             bytes / (1024 * 1024), spill->path, maxDuration / MF_UNITS_PER_SECOND, capacity);
+    return TRUE;
+
+cleanup:
+    if (spill->mapping) CloseHandle(spill->mapping);
+    spill->mapping = NULL;
+    if (spill->file != INVALID_HANDLE_VALUE) CloseHandle(spill->file);
+    spill->file = INVALID_HANDLE_VALUE;
+    SAFE_FREE(spill->entries);
+    return FALSE;
+}
+
+void FrameSpill_Close(FrameSpill* spill) {
+    if (!spill) return;
+
+    if (spill->view) UnmapViewOfFile(spill->view);
+    spill->view = NULL;
+    if (spill->mapping) CloseHandle(spill->mapping);
+    spill->mapping = NULL;
+    // DELETE_ON_CLOSE: the file goes with the last handle
+    if (spill->file && spill->file != INVALID_HANDLE_VALUE) CloseHandle(spill->file);
+    spill->file = INVALID_HANDLE_VALUE;
+    SAFE_FREE(spill->entries);
+
+    if (spill->active) {
+        SpillLog("FrameSpill_Close: %s (%d space evictions)\n", spill->path, spill->spaceEvictions);
+    }
+    spill->count = 0;
+    spill->usedBytes = 0;
+    spill->active = FALSE;
+}
+
+void FrameSpill_Reset(FrameSpill* spill) {
+    if (!spill) return;
+    spill->tail = 0;
+    spill->count = 0;
+    spill->head = 0;
+    spill->usedBytes = 0;
+}
+
+BOOL FrameSpill_Append(FrameSpill* spill, UINT64 seq, const MuxerSample* frame,
+                       UINT64 keepFromSeq) {
+    LWSR_ASSERT(spill != NULL);
+    LWSR_ASSERT(frame != NULL);
+
+    if (!spill || !spill->active || !frame || !frame->data) return FALSE;
+    if (frame->size == 0 || frame->size > spill->size) return FALSE;
+
+    // Sequence numbers must stay contiguous with the RAM tier. After a gap
+    // (a frame that failed to spill) start over unless a snapshot holds entries.
+    if (spill->count > 0 && seq != spill->tailSeq + (UINT64)spill->count) {
+        if (spill->tailSeq + (UINT64)spill->count > keepFromSeq) return FALSE;
+        FrameSpill_Reset(spill);
+    }
+
+    // Keep the newest maxDuration on disk
+    while (spill->count > 0 &&
+           frame->timestamp - spill->entries[spill->tail].timestamp > spill->maxDuration) {
+        if (!EvictOldest(spill, keepFromSeq)) break;
+    }
+    if (spill->count >= spill->capacity && !EvictOldest(spill, keepFromSeq)) return FALSE;
+
+    size_t offset = Reserve(spill, frame->size, keepFromSeq);
+    if (offset == (size_t)-1) return FALSE;
+    if (spill->count == 0) spill->tailSeq = seq;
+
+    memcpy(spill->view + offset, frame->data, frame->size);
+
+    SpillEntry* e = EntryAt(spill, spill->count);
+    e->offset = offset;
+    e->size = frame->size;
+    e->timestamp = frame->timestamp;
+    e->duration = frame->duration;
+    e->isKeyframe = frame->isKeyframe;
+    spill->count++;
+    spill->usedBytes += frame->size;
+    spill->head = offset + frame->size;
+
+    TrimFinishedSegments(spill);
+    return TRUE;
+}
+
+const SpillEntry* FrameSpill_At(const FrameSpill* spill, int i) {
+    LWSR_ASSERT(spill != NULL);
+    LWSR_ASSERT(i >= 0 && i < spill->count);
+    return EntryAt(spill, i);
+}
+
+size_t FrameSpill_GetUsage(const FrameSpill* spill) {
+    return spill ? spill->usedBytes : 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * frame_spill.h - Disk tier for the replay FrameBuffer
+ *
+ * USED BY: frame_buffer.c ONLY
+ *
+ * A ring of encoded frames in a memory-mapped file. FrameBuffer evicts its
+ * oldest frames into the spill instead of dropping them, so the replay
+ * window is limited by disk space and only the hot last N seconds stay in
+ * RAM. Frames keep the arrival sequence numbers they had in FrameBuffer;
+ * the spill always holds the contiguous run just before the RAM tier.
+ *
+ * The file is opened FILE_FLAG_DELETE_ON_CLOSE and lives only as long as
+ * the replay pipeline. Finished FRAME_SPILL_SEGMENT_MB segments are trimmed
+ * from the working set as the write head passes them, so the mapped pages
+ * are written back and released instead of accumulating as resident memory.
+ *
+ * Not thread-safe: every call is made under the owning FrameBuffer's lock.
+ */
+
+#ifndef FRAME_SPILL_H
+#define FRAME_SPILL_H
+
+#include <windows.h>
+#include "mp4_muxer.h"
+
+// One spilled frame; the bytes are view[offset, offset + size)
+typedef struct {
+    size_t offset;
+    DWORD size;
+    LONGLONG timestamp;     // Presentation time (100-ns units)
+    LONGLONG duration;      // Frame duration (100-ns units)
+    BOOL isKeyframe;
+} SpillEntry;
+
+typedef struct {
+    HANDLE file;
+    HANDLE mapping;
+    BYTE* view;                 // Whole file mapped
+    size_t size;                // File / view bytes
+    size_t head;                // Next write offset; the tail is entries[tail].offset
+    size_t trimmedSegment;      // Segment the head was in at the last working-set trim
+
+    SpillEntry* entries;        // Ring, oldest at tail
+    int capacity;
+    int tail;
+    int count;
+    UINT64 tailSeq;             // FrameBuffer sequence number of entries[tail]
+
+    LONGLONG maxDuration;       // Span kept on disk (100-ns units)
+    size_t usedBytes;           // Sum of entries[].size
+    int spaceEvictions;         // Evicted for file space before maxDuration
+
+    char path[MAX_PATH];
+    BOOL active;
+} FrameSpill;
+
+// Create and map a bytes-sized spill file in dir holding up to capacity
+// frames spanning at most maxDuration. Returns FALSE (spill stays inactive)
+// if the directory, file, mapping or entry ring cannot be created.
+BOOL FrameSpill_Open(FrameSpill* spill, const char* dir, size_t bytes, int capacity,
+                     LONGLONG maxDuration);
+
+// Unmap and delete the spill file. Safe on an inactive spill.
+void FrameSpill_Close(FrameSpill* spill);
+
+// Append the frame numbered seq. Frames older than the span limit, and any
+// needed for room, are evicted first, but never one numbered >= keepFromSeq
+// (the oldest pinned frame). A seq that does not follow the newest entry
+// restarts the ring. Returns FALSE if the frame does not fit.
+BOOL FrameSpill_Append(FrameSpill* spill, UINT64 seq, const MuxerSample* frame,
+                       UINT64 keepFromSeq);
+
+// Drop every entry (the file stays mapped)
+void FrameSpill_Reset(FrameSpill* spill);
+
+// Entry i, 0 = oldest. i must be < count.
+const SpillEntry* FrameSpill_At(const FrameSpill* spill, int i);
+
+// Bytes held by spilled frames
+size_t FrameSpill_GetUsage(const FrameSpill* spill);
+
+#endif // FRAME_SPILL_H
@@ -5,7 +5,8 @@
  * lowercased) is the profile id and the section suffix in lwsr_config.ini.
  *
  * Foreground-match lookup is O(profiles * exes) — linear is fine at this
- * scale and we only hit it on HWND changes from the buffer thread.
+ * scale and we only hit it on foreground changes, from the WinEvent hook on
+ * the UI thread, for processes the PID cache doesn't already know.
  */
 
 #include "game_profile.h"
@@ -24,6 +25,23 @@ static GameProfile g_profiles[GAME_PROFILE_MAX_PROFILES];
 static int g_profileCount = 0;
 static BOOL g_loaded = FALSE;
 
+/* Foreground tracking. The cache and hook are UI-thread only; the
+ * published profile is the one cross-thread value. A cache entry keeps its
+ * process handle open, so a PID is only trusted while that process is
+ * still running (a PID can't be reused before then). */
+#define FOREGROUND_CACHE_SIZE 16
+
+typedef struct {
+    DWORD pid;
+    HANDLE process;                 /* SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION */
+    GameProfile* profile;           /* NULL: no profile claims its exe */
+} ForegroundCacheEntry;
+
+static ForegroundCacheEntry g_fgCache[FOREGROUND_CACHE_SIZE];
+static int g_fgCacheNext = 0;       /* Round-robin replacement slot */
+static HWINEVENTHOOK g_fgHook = NULL;
+static GameProfile* volatile g_fgProfile = NULL;
+
 /* ─── Helpers ─── */
 
 /* Resolve the directory containing the running exe (with trailing backslash).
@@ -205,6 +223,44 @@ static void MigrateLegacyMarathonRegion(const char* userConfigPath)
 
 /* ─── Profile parsing ─── */
 
+/* [Region.<name>] of a profile INI. FALSE (region skipped) without
+ * templates or a usable rect. */
+static BOOL ParseExtraRegion(const char* iniPath, const GameProfile* p, const char* name,
+                             GameProfileRegion* r)
+{
+    memset(r, 0, sizeof(*r));
+    strncpy(r->name, name, sizeof(r->name) - 1);
+
+    char section[GAME_PROFILE_REGION_NAME_LEN + 8];
+    snprintf(section, sizeof(section), "Region.%s", r->name);
+
+    char tmplsBuf[GAME_PROFILE_MAX_TEMPLATES * GAME_PROFILE_TEMPLATE_LEN];
+    GetPrivateProfileStringA(section, "Templates", "", tmplsBuf, sizeof(tmplsBuf), iniPath);
+    r->templateCount = ParseCsvList(tmplsBuf, r->templates, GAME_PROFILE_MAX_TEMPLATES);
+    for (int i = 0; i < r->templateCount; i++) StrTrim(r->templates[i]);
+
+    r->xPct = ReadFloat(section, "XPct", 0.0f, iniPath);
+    r->yPct = ReadFloat(section, "YPct", 0.0f, iniPath);
+    r->wPct = ReadFloat(section, "WPct", 0.0f, iniPath);
+    r->hPct = ReadFloat(section, "HPct", 0.0f, iniPath);
+
+    if (r->templateCount == 0 || r->wPct <= 0.0f || r->hPct <= 0.0f) {
+        Logger_Log("GameProfile: '%s' [%s] needs Templates= and a region, skipping it\n",
+                   p->id, section);
+        return FALSE;
+    }
+
+    r->templateThreshold = ReadFloat(section, "TemplateThreshold", p->templateThreshold, iniPath);
+    if (r->templateThreshold < 0.1f) r->templateThreshold = 0.1f;
+    if (r->templateThreshold > 1.0f) r->templateThreshold = 1.0f;
+
+    char defaultLabel[GAME_PROFILE_LABEL_LEN];
+    snprintf(defaultLabel, sizeof(defaultLabel), "%s_%s", p->displayName, r->name);
+    GetPrivateProfileStringA(section, "SaveLabel", defaultLabel,
+                             r->saveLabel, sizeof(r->saveLabel), iniPath);
+    return TRUE;
+}
+
 static BOOL ParseProfileFile(const char* iniPath, const char* filename, GameProfile* p)
 {
     memset(p, 0, sizeof(*p));
@@ -277,6 +333,19 @@ static BOOL ParseProfileFile(const char* iniPath, const char* filename, GameProf
     p->defaultRegionWPct = ReadFloat("DefaultRegion", "WPct", 0.0f, iniPath);
     p->defaultRegionHPct = ReadFloat("DefaultRegion", "HPct", 0.0f, iniPath);
 
+    /* [Region.<Name>] for each Regions= entry */
+    {
+        char regionsBuf[GAME_PROFILE_MAX_REGIONS * GAME_PROFILE_TEMPLATE_LEN];
+        char names[GAME_PROFILE_MAX_REGIONS - 1][GAME_PROFILE_TEMPLATE_LEN];
+        GetPrivateProfileStringA("Detection", "Regions", "", regionsBuf, sizeof(regionsBuf), iniPath);
+        int count = ParseCsvList(regionsBuf, names, GAME_PROFILE_MAX_REGIONS - 1);
+        for (int i = 0; i < count; i++) {
+            StrTrim(names[i]);
+            if (ParseExtraRegion(iniPath, p, names[i], &p->extraRegions[p->extraRegionCount]))
+                p->extraRegionCount++;
+        }
+    }
+
     return TRUE;
 }
 
@@ -352,7 +421,7 @@ GameProfile* GameProfile_FindById(const char* id)
     return NULL;
 }
 
-GameProfile* GameProfile_FindByExe(const char* exeBasename)
+static GameProfile* FindByExeEx(const char* exeBasename, BOOL includeDisabled)
 {
     if (!exeBasename || !exeBasename[0]) return NULL;
 
@@ -364,7 +433,7 @@ GameProfile* GameProfile_FindByExe(const char* exeBasename)
 
     for (int i = 0; i < g_profileCount; i++) {
         GameProfile* p = &g_profiles[i];
-        if (!p->userEnabled) continue;
+        if (!p->userEnabled && !includeDisabled) continue;
         for (int e = 0; e < p->exeCount; e++) {
             if (strcmp(needle, p->exes[e]) == 0) return p;
         }
@@ -372,38 +441,105 @@ GameProfile* GameProfile_FindByExe(const char* exeBasename)
     return NULL;
 }
 
-GameProfile* GameProfile_GetForegroundMatch(void)
+GameProfile* GameProfile_FindByExe(const char* exeBasename)
 {
-    HWND fg = GetForegroundWindow();
-    if (!fg) return NULL;
+    return FindByExeEx(exeBasename, FALSE);
+}
 
-    DWORD pid = 0;
-    GetWindowThreadProcessId(fg, &pid);
-    if (!pid) return NULL;
+/* ─── Foreground tracking ─── */
 
-    HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+static void ClearForegroundCache(void)
+{
+    for (int i = 0; i < FOREGROUND_CACHE_SIZE; i++) {
+        if (g_fgCache[i].process) CloseHandle(g_fgCache[i].process);
+    }
+    memset(g_fgCache, 0, sizeof(g_fgCache));
+    g_fgCacheNext = 0;
+}
+
+/* Profile claiming pid's exe (disabled ones included). Cache hit: one
+ * zero-timeout wait. Miss: OpenProcess + QueryFullProcessImageName. */
+static GameProfile* ResolveProcess(DWORD pid)
+{
+    for (int i = 0; i < FOREGROUND_CACHE_SIZE; i++) {
+        ForegroundCacheEntry* e = &g_fgCache[i];
+        if (!e->process || e->pid != pid) continue;
+        if (WaitForSingleObject(e->process, 0) == WAIT_TIMEOUT) return e->profile;
+        CloseHandle(e->process);    /* Exited: the pid may belong to someone else now */
+        memset(e, 0, sizeof(*e));
+        break;
+    }
+
+    HANDLE hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid);
+    BOOL cacheable = (hProc != NULL);
+    if (!hProc) hProc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
     if (!hProc) return NULL;
 
     char exePath[MAX_PATH];
     DWORD pathSize = MAX_PATH;
     BOOL ok = QueryFullProcessImageNameA(hProc, 0, exePath, &pathSize);
-    CloseHandle(hProc);
-    if (!ok) return NULL;
+    GameProfile* profile = NULL;
+    if (ok) {
+        const char* slash = strrchr(exePath, '\\');
+        profile = FindByExeEx(slash ? slash + 1 : exePath, TRUE);
+    }
+
+    if (!ok || !cacheable) {
+        CloseHandle(hProc);
+        return profile;
+    }
+
+    ForegroundCacheEntry* slot = &g_fgCache[g_fgCacheNext];
+    g_fgCacheNext = (g_fgCacheNext + 1) % FOREGROUND_CACHE_SIZE;
+    if (slot->process) CloseHandle(slot->process);
+    slot->pid = pid;
+    slot->process = hProc;
+    slot->profile = profile;
+    return profile;
+}
+
+static void PublishForeground(HWND hwnd)
+{
+    DWORD pid = 0;
+    if (hwnd) GetWindowThreadProcessId(hwnd, &pid);
+    GameProfile* profile = pid ? ResolveProcess(pid) : NULL;
 
-    const char* slash = strrchr(exePath, '\\');
-    const char* base = slash ? slash + 1 : exePath;
-    return GameProfile_FindByExe(base);
+    GameProfile* prev = (GameProfile*)InterlockedExchangePointer((PVOID volatile*)&g_fgProfile, profile);
+    if (prev != profile) {
+        Logger_Log("GameProfile: foreground is now %s\n", profile ? profile->id : "(no profile)");
+    }
+}
+
+static void CALLBACK ForegroundEventProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+                                         LONG idObject, LONG idChild,
+                                         DWORD eventThread, DWORD eventTime)
+{
+    (void)hook; (void)event; (void)idObject; (void)idChild; (void)eventThread; (void)eventTime;
+    PublishForeground(hwnd);
 }
 
-BOOL GameProfile_ForegroundChanged(HWND* lastSeen)
+BOOL GameProfile_StartForegroundTracking(void)
 {
-    if (!lastSeen) return FALSE;
-    HWND cur = GetForegroundWindow();
-    if (cur == *lastSeen) return FALSE;
-    *lastSeen = cur;
+    if (g_fgHook) return TRUE;
+
+    /* Out-of-context: delivered to this thread's message loop, no DLL injection */
+    g_fgHook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, NULL,
+                               ForegroundEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+    if (!g_fgHook) {
+        Logger_Log("GameProfile: SetWinEventHook failed (%lu), auto-clip won't follow the foreground\n",
+                   GetLastError());
+        return FALSE;
+    }
+
+    PublishForeground(GetForegroundWindow());
     return TRUE;
 }
 
+GameProfile* GameProfile_GetForegroundProfile(void)
+{
+    return (GameProfile*)InterlockedCompareExchangePointer((PVOID volatile*)&g_fgProfile, NULL, NULL);
+}
+
 void GameProfile_SaveUserOverrides(const GameProfile* p)
 {
     if (!p) return;
@@ -463,6 +599,13 @@ int GameProfile_GetActiveCooldownSec(const GameProfile* p)
 
 void GameProfile_Shutdown(void)
 {
+    if (g_fgHook) {
+        UnhookWinEvent(g_fgHook);
+        g_fgHook = NULL;
+    }
+    ClearForegroundCache();
+    InterlockedExchangePointer((PVOID volatile*)&g_fgProfile, NULL);
+
     g_profileCount = 0;
     g_loaded = FALSE;
     memset(g_profiles, 0, sizeof(g_profiles));
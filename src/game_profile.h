@@ -14,6 +14,11 @@
  * Threading: catalog is built once on the UI thread at startup, then
  * read-only. The per-profile cooldown timestamp is the only mutable field
  * and is only touched by the buffer thread (single-writer).
+ *
+ * Foreground tracking runs on the UI thread: an EVENT_SYSTEM_FOREGROUND
+ * WinEvent hook resolves the new foreground process to a profile (through
+ * a small PID cache) and publishes the pointer atomically. Any thread reads
+ * it with GameProfile_GetForegroundProfile, which makes no system calls.
  */
 
 #ifndef GAME_PROFILE_H
@@ -30,6 +35,20 @@
 #define GAME_PROFILE_LABEL_LEN        64    /* SaveLabel: clip filename prefix + save subfolder */
 #define GAME_PROFILE_DIR_LEN          64    /* TemplatesDir: subfolder under static\ */
 #define GAME_PROFILE_MAX_PROFILES     16    /* Hard cap on catalog size */
+#define GAME_PROFILE_MAX_REGIONS      4     /* Detection regions per profile, kill feed included */
+#define GAME_PROFILE_REGION_NAME_LEN  32    /* Region name: [Region.<Name>] section suffix */
+
+/* An extra detection region beyond the kill feed (round end, scoreboard...),
+ * from a [Region.<Name>] section of the profile INI. Templates come from the
+ * profile's TemplatesDir; the region is catalog-only (not user-calibrated). */
+typedef struct {
+    char name[GAME_PROFILE_REGION_NAME_LEN];
+    char templates[GAME_PROFILE_MAX_TEMPLATES][GAME_PROFILE_TEMPLATE_LEN];
+    int  templateCount;
+    float templateThreshold;                /* defaults to the profile's */
+    char saveLabel[GAME_PROFILE_LABEL_LEN]; /* defaults to "<DisplayName>_<Name>" */
+    float xPct, yPct, wPct, hPct;           /* monitor-relative */
+} GameProfileRegion;
 
 typedef struct {
     /* Identity */
@@ -48,6 +67,10 @@ typedef struct {
     int  defaultCooldownSec;                /* fallback if no user override */
     char saveLabel[GAME_PROFILE_LABEL_LEN]; /* clip filename prefix + save subfolder */
 
+    /* Extra detectors, listed by [Detection] Regions=Name,Name */
+    GameProfileRegion extraRegions[GAME_PROFILE_MAX_REGIONS - 1];
+    int  extraRegionCount;
+
     /* Catalog default region (monitor-relative percentages). User calibration
      * in lwsr_config.ini overrides these when present. */
     float defaultRegionXPct;
@@ -97,22 +120,23 @@ GameProfile* GameProfile_FindById(const char* id);
  * Skips profiles where userEnabled is FALSE. */
 GameProfile* GameProfile_FindByExe(const char* exeBasename);
 
-/* Resolve the foreground process to a profile (or NULL).
- * Calls GetForegroundWindow + QueryFullProcessImageName internally.
- * Cheap enough to call per-frame on the buffer thread. */
-GameProfile* GameProfile_GetForegroundMatch(void);
+/* Install the foreground hook and publish the current foreground window's
+ * profile. UI thread (the hook is delivered through its message loop),
+ * after LoadCatalog. Returns FALSE if the hook could not be installed. */
+BOOL GameProfile_StartForegroundTracking(void);
 
-/* Returns TRUE if hwnd has changed since the last call (per-thread state
- * intended for use by the buffer thread's foreground-change polling).
- * On first call returns TRUE so callers re-resolve. */
-BOOL GameProfile_ForegroundChanged(HWND* lastSeen);
+/* The profile claiming the foreground process's exe, or NULL. Unlike
+ * FindByExe this includes profiles the user disabled; check userEnabled.
+ * Lock-free, any thread. NULL until tracking starts. */
+GameProfile* GameProfile_GetForegroundProfile(void);
 
 /* Persist user override fields (Enabled, Region*, CooldownSec) to
  * lwsr_config.ini under [AutoClip.<id>]. Called when calibration finishes
  * or when the per-game enable checkbox toggles. */
 void GameProfile_SaveUserOverrides(const GameProfile* p);
 
-/* Free everything. Call at app shutdown. */
+/* Stop foreground tracking and free everything. Call at app shutdown,
+ * on the UI thread, after the buffer thread has stopped. */
 void GameProfile_Shutdown(void);
 
 #endif /* GAME_PROFILE_H */
@@ -4,7 +4,19 @@
  * SHARED BY: replay_buffer.c, recording.c
  * 
  * Zero-copy GPU color space conversion using D3D11 Video Processor.
- * Converts captured BGRA textures to NV12 format required by NVENC.
+ * Converts captured BGRA textures to NV12 format required by NVENC, with
+ * optional downscaling in the same blit (GPUConverter_InitScaled).
+ *
+ * Output is an N-deep ring of NV12 textures (see NV12_TEXTURE_RING_DEPTH in
+ * constants.h). Each slot has an event query ended after its Blt; before a
+ * slot is reused, Convert polls that query for up to GPU_SLOT_WAIT_MS so the
+ * CPU can't queue an unbounded number of frames ahead of the GPU.
+ *
+ * The preview tap reuses the same video processor: a tapped frame gets a
+ * second Blt with the destination rect shrunk to the preview size, into one
+ * small BGRA target, then a CopyResource to the next staging texture. The
+ * staging textures are mapped with D3D11_MAP_FLAG_DO_NOT_WAIT a frame or
+ * more later, so neither the tap nor the poll ever waits on the GPU.
  *
  * ERROR HANDLING PATTERN:
  * - Goto-cleanup (fail label) for Init with multiple resource allocations
@@ -18,13 +30,22 @@
 #include "constants.h"
 #include "mem_utils.h"
 #include <dxgi.h>
+#include <limits.h>
 
 #define GPULog Logger_Log
 
-BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int height) {
+BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int height, int ringDepth) {
+    return GPUConverter_InitScaled(conv, device, width, height, width, height, ringDepth);
+}
+
+BOOL GPUConverter_InitScaled(GPUConverter* conv, ID3D11Device* device,
+                             int inputWidth, int inputHeight,
+                             int width, int height, int ringDepth) {
     // Preconditions
     LWSR_ASSERT(conv != NULL);
     LWSR_ASSERT(device != NULL);
+    LWSR_ASSERT(inputWidth > 0);
+    LWSR_ASSERT(inputHeight > 0);
     LWSR_ASSERT(width > 0);
     LWSR_ASSERT(height > 0);
     
@@ -32,8 +53,12 @@ BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int
     
     ZeroMemory(conv, sizeof(GPUConverter));
     conv->device = device;
+    conv->inputWidth = inputWidth;
+    conv->inputHeight = inputHeight;
     conv->width = width;
     conv->height = height;
+    conv->slotCount = ringDepth < 1 ? 1
+                    : (ringDepth > GPU_TEXTURE_RING_MAX ? GPU_TEXTURE_RING_MAX : ringDepth);
     
     HRESULT hr;
     
@@ -61,8 +86,8 @@ BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int
     // Create video processor enumerator
     D3D11_VIDEO_PROCESSOR_CONTENT_DESC contentDesc = {0};
     contentDesc.InputFrameFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE;
-    contentDesc.InputWidth = width;
-    contentDesc.InputHeight = height;
+    contentDesc.InputWidth = inputWidth;
+    contentDesc.InputHeight = inputHeight;
     contentDesc.OutputWidth = width;
     contentDesc.OutputHeight = height;
     contentDesc.Usage = D3D11_VIDEO_USAGE_PLAYBACK_NORMAL;
@@ -82,7 +107,18 @@ BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int
         goto fail;
     }
     
-    // Create NV12 output texture
+    // Whole input → whole output. Set explicitly so a scaling converter
+    // never depends on driver defaults for the source/destination rects.
+    RECT srcRect = { 0, 0, inputWidth, inputHeight };
+    RECT dstRect = { 0, 0, width, height };
+    conv->videoContext->lpVtbl->VideoProcessorSetStreamSourceRect(
+        conv->videoContext, conv->videoProcessor, 0, TRUE, &srcRect);
+    conv->videoContext->lpVtbl->VideoProcessorSetStreamDestRect(
+        conv->videoContext, conv->videoProcessor, 0, TRUE, &dstRect);
+    conv->videoContext->lpVtbl->VideoProcessorSetOutputTargetRect(
+        conv->videoContext, conv->videoProcessor, TRUE, &dstRect);
+    
+    // Create NV12 output ring: texture + processor output view + event query per slot
     D3D11_TEXTURE2D_DESC texDesc = {0};
     texDesc.Width = width;
     texDesc.Height = height;
@@ -95,27 +131,43 @@ BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int
     texDesc.CPUAccessFlags = 0;
     texDesc.MiscFlags = 0;
     
-    hr = device->lpVtbl->CreateTexture2D(device, &texDesc, NULL, &conv->outputTexture);
-    if (FAILED(hr)) {
-        GPULog("GPUConverter: CreateTexture2D (NV12) failed: 0x%08X\n", hr);
-        goto fail;
-    }
-    
-    // Create output view for video processor
     D3D11_VIDEO_PROCESSOR_OUTPUT_VIEW_DESC outputViewDesc = {0};
     outputViewDesc.ViewDimension = D3D11_VPOV_DIMENSION_TEXTURE2D;
     outputViewDesc.Texture2D.MipSlice = 0;
     
-    hr = conv->videoDevice->lpVtbl->CreateVideoProcessorOutputView(
-        conv->videoDevice, (ID3D11Resource*)conv->outputTexture,
-        conv->processorEnum, &outputViewDesc, &conv->outputView);
-    if (FAILED(hr)) {
-        GPULog("GPUConverter: CreateVideoProcessorOutputView failed: 0x%08X\n", hr);
-        goto fail;
+    D3D11_QUERY_DESC queryDesc = {0};
+    queryDesc.Query = D3D11_QUERY_EVENT;
+    
+    for (int i = 0; i < conv->slotCount; i++) {
+        hr = device->lpVtbl->CreateTexture2D(device, &texDesc, NULL, &conv->slotTextures[i]);
+        if (FAILED(hr)) {
+            GPULog("GPUConverter: CreateTexture2D (NV12 slot %d) failed: 0x%08X\n", i, hr);
+            goto fail;
+        }
+        
+        hr = conv->videoDevice->lpVtbl->CreateVideoProcessorOutputView(
+            conv->videoDevice, (ID3D11Resource*)conv->slotTextures[i],
+            conv->processorEnum, &outputViewDesc, &conv->slotViews[i]);
+        if (FAILED(hr)) {
+            GPULog("GPUConverter: CreateVideoProcessorOutputView (slot %d) failed: 0x%08X\n", i, hr);
+            goto fail;
+        }
+        
+        hr = device->lpVtbl->CreateQuery(device, &queryDesc, &conv->slotQueries[i]);
+        if (FAILED(hr)) {
+            GPULog("GPUConverter: CreateQuery (slot %d) failed: 0x%08X\n", i, hr);
+            goto fail;
+        }
     }
     
     conv->initialized = TRUE;
-    GPULog("GPUConverter: Initialized %dx%d BGRA→NV12 (D3D11 Video Processor)\n", width, height);
+    if (inputWidth != width || inputHeight != height) {
+        GPULog("GPUConverter: Initialized %dx%d BGRA→%dx%d NV12 (D3D11 Video Processor, %d-slot ring)\n",
+               inputWidth, inputHeight, width, height, conv->slotCount);
+    } else {
+        GPULog("GPUConverter: Initialized %dx%d BGRA→NV12 (D3D11 Video Processor, %d-slot ring)\n",
+               width, height, conv->slotCount);
+    }
     return TRUE;
     
 fail:
@@ -123,16 +175,17 @@ fail:
     return FALSE;
 }
 
-ID3D11Texture2D* GPUConverter_Convert(GPUConverter* conv, ID3D11Texture2D* bgraTexture) {
-    // Preconditions
-    LWSR_ASSERT(conv != NULL);
-    LWSR_ASSERT(bgraTexture != NULL);
-    
-    if (!conv->initialized || !bgraTexture) return NULL;
-    
-    HRESULT hr;
+/* Find or create the cached input view for a BGRA texture. Capture rotates
+ * through a fixed ring, so after warm-up every lookup is a hit. The texture
+ * is AddRef'd so a released-and-reallocated texture can never alias a stale
+ * view. When the cache is full the oldest entry is evicted round-robin. */
+static ID3D11VideoProcessorInputView* GetInputView(GPUConverter* conv, ID3D11Texture2D* bgraTexture) {
+    for (int i = 0; i < conv->inputViewCount; i++) {
+        if (conv->inputViews[i].texture == bgraTexture) {
+            return conv->inputViews[i].view;
+        }
+    }
     
-    // Create input view for this texture (recreate each time for different textures)
     D3D11_VIDEO_PROCESSOR_INPUT_VIEW_DESC inputViewDesc = {0};
     inputViewDesc.FourCC = 0;  // Use texture format
     inputViewDesc.ViewDimension = D3D11_VPIV_DIMENSION_TEXTURE2D;
@@ -140,15 +193,57 @@ ID3D11Texture2D* GPUConverter_Convert(GPUConverter* conv, ID3D11Texture2D* bgraT
     inputViewDesc.Texture2D.ArraySlice = 0;
     
     ID3D11VideoProcessorInputView* inputView = NULL;
-    hr = conv->videoDevice->lpVtbl->CreateVideoProcessorInputView(
+    HRESULT hr = conv->videoDevice->lpVtbl->CreateVideoProcessorInputView(
         conv->videoDevice, (ID3D11Resource*)bgraTexture,
         conv->processorEnum, &inputViewDesc, &inputView);
-    
     if (FAILED(hr)) {
         GPULog("GPUConverter: CreateVideoProcessorInputView failed: 0x%08X\n", hr);
         return NULL;
     }
     
+    int idx;
+    if (conv->inputViewCount < GPU_TEXTURE_RING_MAX) {
+        idx = conv->inputViewCount++;
+    } else {
+        idx = conv->nextInputViewEvict;
+        conv->nextInputViewEvict = (conv->nextInputViewEvict + 1) % GPU_TEXTURE_RING_MAX;
+        SAFE_RELEASE(conv->inputViews[idx].view);
+        SAFE_RELEASE(conv->inputViews[idx].texture);
+    }
+    bgraTexture->lpVtbl->AddRef(bgraTexture);
+    conv->inputViews[idx].texture = bgraTexture;
+    conv->inputViews[idx].view = inputView;
+    return inputView;
+}
+
+/* Bounded wait for the GPU to finish the previous Blt into a slot. */
+static void WaitSlotIdle(GPUConverter* conv, int slot) {
+    if (!conv->slotQueryIssued[slot]) return;
+    
+    ULONGLONG startMs = GetTickCount64();
+    while (conv->context->lpVtbl->GetData(conv->context, (ID3D11Asynchronous*)conv->slotQueries[slot],
+                                          NULL, 0, 0) == S_FALSE) {
+        if (GetTickCount64() - startMs >= GPU_SLOT_WAIT_MS) break;
+        YieldProcessor();
+    }
+    conv->slotQueryIssued[slot] = FALSE;
+}
+
+ID3D11Texture2D* GPUConverter_Convert(GPUConverter* conv, ID3D11Texture2D* bgraTexture) {
+    // Preconditions
+    LWSR_ASSERT(conv != NULL);
+    LWSR_ASSERT(bgraTexture != NULL);
+    
+    if (!conv->initialized || !bgraTexture) return NULL;
+    
+    HRESULT hr;
+    
+    ID3D11VideoProcessorInputView* inputView = GetInputView(conv, bgraTexture);
+    if (!inputView) return NULL;
+    
+    int slot = conv->nextSlot;
+    WaitSlotIdle(conv, slot);
+    
     // Configure video processor stream
     D3D11_VIDEO_PROCESSOR_STREAM stream = {0};
     stream.Enable = TRUE;
@@ -166,25 +261,198 @@ ID3D11Texture2D* GPUConverter_Convert(GPUConverter* conv, ID3D11Texture2D* bgraT
     // Run the video processor (BGRA → NV12 conversion on GPU)
     hr = conv->videoContext->lpVtbl->VideoProcessorBlt(
         conv->videoContext, conv->videoProcessor,
-        conv->outputView, 0, 1, &stream);
-    
-    inputView->lpVtbl->Release(inputView);
+        conv->slotViews[slot], 0, 1, &stream);
     
     if (FAILED(hr)) {
         GPULog("GPUConverter: VideoProcessorBlt failed: 0x%08X\n", hr);
         return NULL;
     }
     
+    conv->context->lpVtbl->End(conv->context, (ID3D11Asynchronous*)conv->slotQueries[slot]);
+    conv->slotQueryIssued[slot] = TRUE;
+    
+    conv->outputTexture = conv->slotTextures[slot];
+    conv->outputView = conv->slotViews[slot];
+    conv->nextSlot = (slot + 1) % conv->slotCount;
+    
     return conv->outputTexture;
 }
 
+/*
+ * MULTI-RESOURCE FUNCTION: GPUConverter_EnablePreview
+ * Resources: BGRA target + output view, PREVIEW_TAP_READBACK_DEPTH staging textures
+ * Pattern: goto-cleanup releases whatever was created; the converter keeps
+ *          working without a tap
+ */
+BOOL GPUConverter_EnablePreview(GPUConverter* conv, int width, int height, int interval) {
+    LWSR_ASSERT(conv != NULL);
+    LWSR_ASSERT(width > 0 && height > 0);
+    
+    if (!conv || !conv->initialized || width <= 0 || height <= 0) return FALSE;
+    if (conv->previewTarget) return TRUE;
+    
+    HRESULT hr;
+    UINT support = 0;
+    hr = conv->processorEnum->lpVtbl->CheckVideoProcessorFormat(
+        conv->processorEnum, DXGI_FORMAT_B8G8R8A8_UNORM, &support);
+    if (FAILED(hr) || !(support & D3D11_VIDEO_PROCESSOR_FORMAT_SUPPORT_OUTPUT)) {
+        GPULog("GPUConverter: video processor can't output BGRA - preview tap disabled\n");
+        return FALSE;
+    }
+    
+    D3D11_TEXTURE2D_DESC texDesc = {0};
+    texDesc.Width = width;
+    texDesc.Height = height;
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.Usage = D3D11_USAGE_DEFAULT;
+    texDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+    
+    hr = conv->device->lpVtbl->CreateTexture2D(conv->device, &texDesc, NULL, &conv->previewTarget);
+    if (FAILED(hr)) {
+        GPULog("GPUConverter: CreateTexture2D (preview) failed: 0x%08X\n", hr);
+        goto fail;
+    }
+    
+    D3D11_VIDEO_PROCESSOR_OUTPUT_VIEW_DESC outputViewDesc = {0};
+    outputViewDesc.ViewDimension = D3D11_VPOV_DIMENSION_TEXTURE2D;
+    hr = conv->videoDevice->lpVtbl->CreateVideoProcessorOutputView(
+        conv->videoDevice, (ID3D11Resource*)conv->previewTarget,
+        conv->processorEnum, &outputViewDesc, &conv->previewView);
+    if (FAILED(hr)) {
+        GPULog("GPUConverter: CreateVideoProcessorOutputView (preview) failed: 0x%08X\n", hr);
+        goto fail;
+    }
+    
+    texDesc.Usage = D3D11_USAGE_STAGING;
+    texDesc.BindFlags = 0;
+    texDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    for (int i = 0; i < PREVIEW_TAP_READBACK_DEPTH; i++) {
+        hr = conv->device->lpVtbl->CreateTexture2D(conv->device, &texDesc, NULL, &conv->previewStaging[i]);
+        if (FAILED(hr)) {
+            GPULog("GPUConverter: CreateTexture2D (preview staging %d) failed: 0x%08X\n", i, hr);
+            goto fail;
+        }
+        conv->previewPending[i] = FALSE;
+    }
+    
+    conv->previewWidth = width;
+    conv->previewHeight = height;
+    conv->previewInterval = interval < 1 ? 1 : interval;
+    conv->previewCountdown = 0;         /* First frame is tapped */
+    conv->previewNext = 0;
+    conv->previewOldest = 0;
+    GPULog("GPUConverter: Preview tap %dx%d BGRA every %d frames\n",
+           width, height, conv->previewInterval);
+    return TRUE;
+    
+fail:
+    for (int i = 0; i < PREVIEW_TAP_READBACK_DEPTH; i++) {
+        SAFE_RELEASE(conv->previewStaging[i]);
+    }
+    SAFE_RELEASE(conv->previewView);
+    SAFE_RELEASE(conv->previewTarget);
+    return FALSE;
+}
+
+BOOL GPUConverter_TapPreview(GPUConverter* conv, ID3D11Texture2D* bgraTexture, LONGLONG timestamp) {
+    if (!conv || !conv->initialized || !conv->previewView || !bgraTexture) return FALSE;
+    
+    if (conv->previewCountdown > 0) {
+        conv->previewCountdown--;
+        return FALSE;
+    }
+    
+    /* Every staging slot still being read back: skip, never wait */
+    int slot = conv->previewNext;
+    if (conv->previewPending[slot]) return FALSE;
+    
+    /* Cache hit: Convert just used this texture */
+    ID3D11VideoProcessorInputView* inputView = GetInputView(conv, bgraTexture);
+    if (!inputView) return FALSE;
+    
+    D3D11_VIDEO_PROCESSOR_STREAM stream = {0};
+    stream.Enable = TRUE;
+    stream.pInputSurface = inputView;
+    
+    /* Same processor, smaller destination; restored right after so the
+     * next Convert sees the full-size rects it was set up with */
+    RECT previewRect = { 0, 0, conv->previewWidth, conv->previewHeight };
+    RECT dstRect = { 0, 0, conv->width, conv->height };
+    ID3D11VideoContext* vc = conv->videoContext;
+    vc->lpVtbl->VideoProcessorSetStreamDestRect(vc, conv->videoProcessor, 0, TRUE, &previewRect);
+    vc->lpVtbl->VideoProcessorSetOutputTargetRect(vc, conv->videoProcessor, TRUE, &previewRect);
+    HRESULT hr = vc->lpVtbl->VideoProcessorBlt(vc, conv->videoProcessor, conv->previewView, 0, 1, &stream);
+    vc->lpVtbl->VideoProcessorSetStreamDestRect(vc, conv->videoProcessor, 0, TRUE, &dstRect);
+    vc->lpVtbl->VideoProcessorSetOutputTargetRect(vc, conv->videoProcessor, TRUE, &dstRect);
+    if (FAILED(hr)) {
+        GPULog("GPUConverter: preview VideoProcessorBlt failed: 0x%08X - preview tap disabled\n", hr);
+        conv->previewInterval = INT_MAX;
+        conv->previewCountdown = INT_MAX;
+        return FALSE;
+    }
+    
+    conv->context->lpVtbl->CopyResource(conv->context,
+        (ID3D11Resource*)conv->previewStaging[slot], (ID3D11Resource*)conv->previewTarget);
+    conv->previewTimestamps[slot] = timestamp;
+    conv->previewPending[slot] = TRUE;
+    conv->previewNext = (slot + 1) % PREVIEW_TAP_READBACK_DEPTH;
+    conv->previewCountdown = conv->previewInterval - 1;
+    return TRUE;
+}
+
+int GPUConverter_PollPreview(GPUConverter* conv, GPUConverterPreviewFn callback, void* userData) {
+    if (!conv || !conv->previewView || !callback) return 0;
+    
+    int delivered = 0;
+    while (conv->previewPending[conv->previewOldest]) {
+        int slot = conv->previewOldest;
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        HRESULT hr = conv->context->lpVtbl->Map(conv->context,
+            (ID3D11Resource*)conv->previewStaging[slot], 0,
+            D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING) break;
+        
+        conv->previewPending[slot] = FALSE;
+        conv->previewOldest = (slot + 1) % PREVIEW_TAP_READBACK_DEPTH;
+        if (FAILED(hr)) {
+            GPULog("GPUConverter: preview Map failed: 0x%08X\n", hr);
+            continue;
+        }
+        
+        callback((const BYTE*)mapped.pData, (int)mapped.RowPitch,
+                 conv->previewWidth, conv->previewHeight, conv->previewTimestamps[slot], userData);
+        conv->context->lpVtbl->Unmap(conv->context, (ID3D11Resource*)conv->previewStaging[slot], 0);
+        delivered++;
+    }
+    return delivered;
+}
+
 /* Shutdown GPU converter using SAFE_RELEASE for consistent cleanup */
 void GPUConverter_Shutdown(GPUConverter* conv) {
     if (!conv) return;
     
     /* Release in reverse order of acquisition */
-    SAFE_RELEASE(conv->outputView);
-    SAFE_RELEASE(conv->outputTexture);
+    for (int i = 0; i < conv->inputViewCount; i++) {
+        SAFE_RELEASE(conv->inputViews[i].view);
+        SAFE_RELEASE(conv->inputViews[i].texture);
+    }
+    conv->inputViewCount = 0;
+    for (int i = 0; i < GPU_TEXTURE_RING_MAX; i++) {
+        SAFE_RELEASE(conv->slotQueries[i]);
+        SAFE_RELEASE(conv->slotViews[i]);
+        SAFE_RELEASE(conv->slotTextures[i]);
+    }
+    for (int i = 0; i < PREVIEW_TAP_READBACK_DEPTH; i++) {
+        SAFE_RELEASE(conv->previewStaging[i]);
+        conv->previewPending[i] = FALSE;
+    }
+    SAFE_RELEASE(conv->previewView);
+    SAFE_RELEASE(conv->previewTarget);
+    conv->outputView = NULL;     /* Aliases of ring slots, released above */
+    conv->outputTexture = NULL;
     SAFE_RELEASE(conv->videoProcessor);
     SAFE_RELEASE(conv->processorEnum);
     SAFE_RELEASE(conv->videoContext);
@@ -3,7 +3,8 @@
  * 
  * SHARED BY: replay_buffer.c, recording.c
  * 
- * Zero-copy GPU color space conversion for NVENC input.
+ * Zero-copy GPU color space conversion for NVENC input, plus an optional
+ * downscaled BGRA preview tap read back asynchronously (preview_tap.c).
  */
 
 #ifndef GPU_CONVERTER_H
@@ -11,6 +12,17 @@
 
 #include <windows.h>
 #include <d3d11.h>
+#include "constants.h"
+
+typedef struct {
+    ID3D11Texture2D* texture;                   // Input BGRA texture (AddRef'd)
+    ID3D11VideoProcessorInputView* view;
+} GPUConverterInputView;
+
+// Receives each finished preview tap (GPUConverter_PollPreview): top-down
+// BGRA, rowPitch bytes per row, only valid for the duration of the call
+typedef void (*GPUConverterPreviewFn)(const BYTE* bgra, int rowPitch, int width, int height,
+                                      LONGLONG timestamp, void* userData);
 
 typedef struct {
     ID3D11Device* device;
@@ -19,20 +31,79 @@ typedef struct {
     ID3D11VideoContext* videoContext;
     ID3D11VideoProcessor* videoProcessor;
     ID3D11VideoProcessorEnumerator* processorEnum;
+    
+    // NV12 output ring. Each Convert writes the next slot, so the encoder
+    // can still be reading frame N while frame N+1 is converted.
+    ID3D11Texture2D* slotTextures[GPU_TEXTURE_RING_MAX];
+    ID3D11VideoProcessorOutputView* slotViews[GPU_TEXTURE_RING_MAX];
+    ID3D11Query* slotQueries[GPU_TEXTURE_RING_MAX];    // D3D11_QUERY_EVENT, ended after each Blt
+    BOOL slotQueryIssued[GPU_TEXTURE_RING_MAX];
+    int slotCount;
+    int nextSlot;
+    
+    // Most recent Convert result (aliases a ring slot; not separately owned)
     ID3D11VideoProcessorOutputView* outputView;
     ID3D11Texture2D* outputTexture;  // NV12 output
-    int width;
+    
+    // Input views cached per BGRA texture (capture hands us a fixed ring)
+    GPUConverterInputView inputViews[GPU_TEXTURE_RING_MAX];
+    int inputViewCount;
+    int nextInputViewEvict;
+    
+    // Preview tap (GPUConverter_EnablePreview): a second, small Blt of every
+    // previewInterval-th frame into a BGRA target, copied to a staging ring
+    // that GPUConverter_PollPreview maps once the GPU is done with it
+    ID3D11Texture2D* previewTarget;
+    ID3D11VideoProcessorOutputView* previewView;
+    ID3D11Texture2D* previewStaging[PREVIEW_TAP_READBACK_DEPTH];
+    LONGLONG previewTimestamps[PREVIEW_TAP_READBACK_DEPTH];
+    BOOL previewPending[PREVIEW_TAP_READBACK_DEPTH];
+    int previewNext;        // Slot the next tap is copied to
+    int previewOldest;      // Next slot to poll (taps complete in order)
+    int previewWidth;
+    int previewHeight;
+    int previewInterval;
+    int previewCountdown;   // Converts until the next tap
+    
+    int inputWidth;     // BGRA input size
+    int inputHeight;
+    int width;          // NV12 output size (== input unless scaling)
     int height;
     BOOL initialized;
 } GPUConverter;
 
-// Initialize GPU converter
-BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int height);
+// Initialize GPU converter with an NV12 output ring of ringDepth textures
+// (clamped to 1..GPU_TEXTURE_RING_MAX). Output size equals input size.
+BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int height, int ringDepth);
+
+// As GPUConverter_Init, but the same Video Processor blit also scales the
+// inputWidth x inputHeight BGRA frame to an outputWidth x outputHeight NV12
+// frame (both even). Aspect ratio is the caller's responsibility.
+BOOL GPUConverter_InitScaled(GPUConverter* conv, ID3D11Device* device,
+                             int inputWidth, int inputHeight,
+                             int outputWidth, int outputHeight, int ringDepth);
 
 // Convert BGRA texture to NV12 texture (GPU-only, no CPU copy)
-// Returns the NV12 output texture (owned by converter, do not release)
+// Returns the NV12 ring texture written by this call (owned by converter, do
+// not release). It stays valid, unmodified, for the next ringDepth-1 calls.
 ID3D11Texture2D* GPUConverter_Convert(GPUConverter* conv, ID3D11Texture2D* bgraTexture);
 
+// Enable the preview tap: every interval-th frame (1 = every frame) passed
+// to GPUConverter_TapPreview is also scaled to a width x height BGRA frame
+// by the same video processor. Costs one small Blt and copy per tap, and no
+// CPU wait. FALSE if the processor can't output BGRA or allocation failed;
+// conversion is unaffected either way.
+BOOL GPUConverter_EnablePreview(GPUConverter* conv, int width, int height, int interval);
+
+// Call after each successful Convert of bgraTexture. Taps it when due,
+// unless every staging slot is still in flight (then the tap is skipped).
+// Returns TRUE if a tap was issued. No-op while the tap is disabled.
+BOOL GPUConverter_TapPreview(GPUConverter* conv, ID3D11Texture2D* bgraTexture, LONGLONG timestamp);
+
+// Non-blocking: hand every tap the GPU has finished to callback, oldest
+// first. Returns the number delivered. Same thread as Convert.
+int GPUConverter_PollPreview(GPUConverter* conv, GPUConverterPreviewFn callback, void* userData);
+
 // Shutdown and release resources  
 void GPUConverter_Shutdown(GPUConverter* conv);
 
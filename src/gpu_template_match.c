@@ -0,0 +1,613 @@
+/*
+ * gpu_template_match.c - D3D11 compute-shader NCC matcher
+ *
+ * USED BY: kill_feed_sampler.c
+ *
+ * Three passes per scan, all recorded on the capture thread's immediate
+ * context right after the region copy:
+ *
+ *   GrayCS    region texture -> gray buffer, same integer luma as the CPU path
+ *   NccCS     one dispatch per entry, one thread per window position; each
+ *             16x16 group max-reduces its scores in groupshared memory and
+ *             writes one partial
+ *   ReduceCS  a single group reduces every partial to the scan's result
+ *
+ * The result is copied into the slot's staging buffer, which Poll maps with
+ * D3D11_MAP_FLAG_DO_NOT_WAIT. Window sums are exact (uint); the cross term
+ * and the final division are float, so scores agree with template_match.c
+ * to about 1e-3.
+ *
+ * Shaders are compiled once per process (first Create) and the bytecode is
+ * kept for later samplers, so an Alt-Tab restart does not recompile on the
+ * capture thread.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Goto-cleanup (fail label) in Create
+ * - HRESULT checks use FAILED()/SUCCEEDED() macros exclusively
+ * - A device error after Create marks the matcher failed; every later call
+ *   returns FALSE and the caller is expected to fall back to the CPU
+ */
+
+#include "gpu_template_match.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include <d3dcompiler.h>
+#include <dxgi.h>
+#include <string.h>
+
+#define GROUP_DIM           16     /* NccCS / GrayCS numthreads */
+
+/* Must match Params in the HLSL below (16-byte aligned) */
+typedef struct {
+    UINT imgW, imgH, tmplOffset, tmplW;
+    UINT tmplH, entry, partialBase, groupsX;
+    float tmplNorm;
+    UINT partialCount;
+    UINT pad[2];
+} GpuMatchParams;
+
+/* Must match Partial in the HLSL below */
+typedef struct {
+    float score;
+    UINT pos;               /* y << 16 | x */
+    UINT entry;
+    UINT pad;
+} GpuMatchPartial;
+
+static const char g_shaderSource[] =
+    "cbuffer Params : register(b0) {\n"
+    "    uint imgW, imgH, tmplOffset, tmplW;\n"
+    "    uint tmplH, entry, partialBase, groupsX;\n"
+    "    float tmplNorm;\n"
+    "    uint partialCount;\n"
+    "    uint2 pad;\n"
+    "};\n"
+    "struct Partial { float score; uint pos; uint entry; uint pad; };\n"
+    "Texture2D<float4> region : register(t0);\n"
+    "StructuredBuffer<uint> grayIn : register(t1);\n"
+    "StructuredBuffer<float> tmpl : register(t2);\n"
+    "RWStructuredBuffer<uint> grayOut : register(u0);\n"
+    "RWStructuredBuffer<Partial> partials : register(u1);\n"
+    "RWStructuredBuffer<Partial> result : register(u2);\n"
+    "groupshared float gsScore[256];\n"
+    "groupshared uint gsPos[256];\n"
+    "groupshared uint gsEntry[256];\n"
+    "\n"
+    "void ReduceGroup(uint gi) {\n"
+    "    GroupMemoryBarrierWithGroupSync();\n"
+    "    [unroll] for (uint stride = 128; stride > 0; stride >>= 1) {\n"
+    "        if (gi < stride && gsScore[gi + stride] > gsScore[gi]) {\n"
+    "            gsScore[gi] = gsScore[gi + stride];\n"
+    "            gsPos[gi] = gsPos[gi + stride];\n"
+    "            gsEntry[gi] = gsEntry[gi + stride];\n"
+    "        }\n"
+    "        GroupMemoryBarrierWithGroupSync();\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "[numthreads(16, 16, 1)]\n"
+    "void GrayCS(uint3 id : SV_DispatchThreadID) {\n"
+    "    if (id.x >= imgW || id.y >= imgH) return;\n"
+    "    uint3 c = (uint3)(region.Load(int3(id.xy, 0)).rgb * 255.0 + 0.5);\n"
+    "    grayOut[id.y * imgW + id.x] = (c.r * 299 + c.g * 587 + c.b * 114) / 1000;\n"
+    "}\n"
+    "\n"
+    "[numthreads(16, 16, 1)]\n"
+    "void NccCS(uint3 id : SV_DispatchThreadID, uint3 gid : SV_GroupID, uint gi : SV_GroupIndex) {\n"
+    "    float score = -2.0;\n"
+    "    if (id.x + tmplW <= imgW && id.y + tmplH <= imgH) {\n"
+    "        uint s = 0, q = 0;\n"
+    "        float cross = 0.0;\n"
+    "        [loop] for (uint ty = 0; ty < tmplH; ty++) {\n"
+    "            uint row = (id.y + ty) * imgW + id.x;\n"
+    "            uint trow = tmplOffset + ty * tmplW;\n"
+    "            [loop] for (uint tx = 0; tx < tmplW; tx++) {\n"
+    "                uint p = grayIn[row + tx];\n"
+    "                s += p;\n"
+    "                q += p * p;\n"
+    "                cross += (float)p * tmpl[trow + tx];\n"
+    "            }\n"
+    "        }\n"
+    "        float fs = (float)s;\n"
+    "        float imgNorm = sqrt(max((float)q - fs * (fs / (float)(tmplW * tmplH)), 0.0));\n"
+    "        score = imgNorm > 1.0 ? cross / (imgNorm * tmplNorm) : 0.0;\n"
+    "    }\n"
+    "    gsScore[gi] = score;\n"
+    "    gsPos[gi] = (id.y << 16) | id.x;\n"
+    "    gsEntry[gi] = entry;\n"
+    "    ReduceGroup(gi);\n"
+    "    if (gi == 0) {\n"
+    "        Partial p = { gsScore[0], gsPos[0], gsEntry[0], 0 };\n"
+    "        partials[partialBase + gid.y * groupsX + gid.x] = p;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "[numthreads(256, 1, 1)]\n"
+    "void ReduceCS(uint gi : SV_GroupIndex) {\n"
+    "    float best = -2.0;\n"
+    "    uint pos = 0, ent = 0;\n"
+    "    for (uint i = gi; i < partialCount; i += 256) {\n"
+    "        Partial p = partials[i];\n"
+    "        if (p.score > best) { best = p.score; pos = p.pos; ent = p.entry; }\n"
+    "    }\n"
+    "    gsScore[gi] = best;\n"
+    "    gsPos[gi] = pos;\n"
+    "    gsEntry[gi] = ent;\n"
+    "    ReduceGroup(gi);\n"
+    "    if (gi == 0) {\n"
+    "        Partial p = { gsScore[0], gsPos[0], gsEntry[0], 0 };\n"
+    "        result[0] = p;\n"
+    "    }\n"
+    "}\n";
+
+/* ─── Shader bytecode (compiled once per process) ─── */
+
+typedef enum { SHADER_GRAY = 0, SHADER_NCC, SHADER_REDUCE, SHADER_COUNT } ShaderId;
+
+static const char* const g_entryPoints[SHADER_COUNT] = { "GrayCS", "NccCS", "ReduceCS" };
+
+static INIT_ONCE g_compileOnce = INIT_ONCE_STATIC_INIT;
+static ID3DBlob* g_bytecode[SHADER_COUNT];     /* Process lifetime */
+
+static BOOL CALLBACK CompileShadersOnce(PINIT_ONCE once, PVOID param, PVOID* ctx)
+{
+    (void)once; (void)param; (void)ctx;
+
+    HMODULE mod = LoadLibraryA("d3dcompiler_47.dll");
+    if (!mod) {
+        Logger_Log("GpuMatcher: d3dcompiler_47.dll not available (err=%lu)\n", GetLastError());
+        return TRUE;    /* Leaves g_bytecode NULL; Create returns NULL */
+    }
+    pD3DCompile compile = (pD3DCompile)GetProcAddress(mod, "D3DCompile");
+    if (!compile) {
+        Logger_Log("GpuMatcher: D3DCompile export missing\n");
+        return TRUE;
+    }
+
+    for (int i = 0; i < SHADER_COUNT; i++) {
+        ID3DBlob* errors = NULL;
+        HRESULT hr = compile(g_shaderSource, sizeof(g_shaderSource) - 1, "gpu_template_match",
+                             NULL, NULL, g_entryPoints[i], "cs_5_0",
+                             D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &g_bytecode[i], &errors);
+        if (FAILED(hr)) {
+            Logger_Log("GpuMatcher: %s compile failed: 0x%08X %s\n", g_entryPoints[i], hr,
+                       errors ? (const char*)errors->lpVtbl->GetBufferPointer(errors) : "");
+            SAFE_RELEASE(errors);
+            for (int j = 0; j < SHADER_COUNT; j++) SAFE_RELEASE(g_bytecode[j]);
+            return TRUE;
+        }
+        SAFE_RELEASE(errors);
+    }
+    /* d3dcompiler stays loaded: the blobs' Release lives in it */
+    return TRUE;
+}
+
+/* ─── Matcher ─── */
+
+typedef struct {
+    ID3D11Texture2D* regionTex;         /* BGRA copy of the region */
+    ID3D11ShaderResourceView* regionSrv;
+    ID3D11Buffer* staging;              /* 16-byte result, CPU-readable */
+    ULONGLONG tag;
+    BOOL pending;
+} GpuMatchSlot;
+
+struct GpuMatcher {
+    ID3D11Device* device;               /* Borrowed from the capture state */
+    int regionW, regionH;
+    DXGI_FORMAT regionFormat;           /* Format slot textures were made with */
+
+    ID3D11ComputeShader* shaders[SHADER_COUNT];
+
+    ID3D11Buffer* grayBuf;
+    ID3D11ShaderResourceView* graySrv;
+    ID3D11UnorderedAccessView* grayUav;
+    ID3D11Buffer* tmplBuf;
+    ID3D11ShaderResourceView* tmplSrv;
+    ID3D11Buffer* partialBuf;
+    ID3D11UnorderedAccessView* partialUav;
+    ID3D11Buffer* resultBuf;
+    ID3D11UnorderedAccessView* resultUav;
+
+    /* One immutable constant buffer and dispatch size per kept entry */
+    int entryCount;
+    ID3D11Buffer** params;
+    UINT* groupsX;
+    UINT* groupsY;
+
+    GpuMatchSlot slots[GPU_MATCH_RING_DEPTH];
+    int head;                           /* Oldest pending slot */
+    int tail;                           /* Next slot to dispatch into */
+
+    ID3D11Texture2D* readbackTex;       /* Staging BGRA, created on first use */
+    BOOL failed;
+};
+
+static BOOL CreateStructured(ID3D11Device* device, UINT stride, UINT count, UINT bind,
+                             const void* init, ID3D11Buffer** out)
+{
+    D3D11_BUFFER_DESC desc = {0};
+    desc.ByteWidth = stride * count;
+    desc.Usage = (bind == 0) ? D3D11_USAGE_STAGING : D3D11_USAGE_DEFAULT;
+    desc.BindFlags = bind;
+    desc.CPUAccessFlags = (bind == 0) ? D3D11_CPU_ACCESS_READ : 0;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    desc.StructureByteStride = stride;
+
+    D3D11_SUBRESOURCE_DATA data = {0};
+    data.pSysMem = init;
+
+    HRESULT hr = device->lpVtbl->CreateBuffer(device, &desc, init ? &data : NULL, out);
+    if (FAILED(hr)) {
+        Logger_Log("GpuMatcher: CreateBuffer (%u x %u) failed: 0x%08X\n", count, stride, hr);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL CreateViews(ID3D11Device* device, ID3D11Buffer* buf, UINT count,
+                        ID3D11ShaderResourceView** srv, ID3D11UnorderedAccessView** uav)
+{
+    HRESULT hr;
+    if (srv) {
+        D3D11_SHADER_RESOURCE_VIEW_DESC desc = {0};
+        desc.Format = DXGI_FORMAT_UNKNOWN;
+        desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        desc.Buffer.NumElements = count;
+        hr = device->lpVtbl->CreateShaderResourceView(device, (ID3D11Resource*)buf, &desc, srv);
+        if (FAILED(hr)) {
+            Logger_Log("GpuMatcher: CreateShaderResourceView failed: 0x%08X\n", hr);
+            return FALSE;
+        }
+    }
+    if (uav) {
+        D3D11_UNORDERED_ACCESS_VIEW_DESC desc = {0};
+        desc.Format = DXGI_FORMAT_UNKNOWN;
+        desc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+        desc.Buffer.NumElements = count;
+        hr = device->lpVtbl->CreateUnorderedAccessView(device, (ID3D11Resource*)buf, &desc, uav);
+        if (FAILED(hr)) {
+            Logger_Log("GpuMatcher: CreateUnorderedAccessView failed: 0x%08X\n", hr);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+GpuMatcher* GpuMatcher_Create(ID3D11Device* device, int regionW, int regionH,
+                              const GpuMatchEntry* entries, int entryCount)
+{
+    LWSR_ASSERT(device != NULL);
+    LWSR_ASSERT(entries != NULL || entryCount == 0);
+
+    if (!device || regionW <= 0 || regionH <= 0 || regionW > 0xFFFF || regionH > 0xFFFF)
+        return NULL;
+
+    InitOnceExecuteOnce(&g_compileOnce, CompileShadersOnce, NULL, NULL);
+    for (int i = 0; i < SHADER_COUNT; i++) {
+        if (!g_bytecode[i]) return NULL;    /* Logged once by CompileShadersOnce */
+    }
+
+    GpuMatcher* m = (GpuMatcher*)calloc(1, sizeof(GpuMatcher));
+    if (!m) return NULL;
+    m->device = device;
+    m->regionW = regionW;
+    m->regionH = regionH;
+
+    HRESULT hr;
+    float* tmplData = NULL;
+    GpuMatchParams* params = NULL;
+
+    /*
+     * MULTI-RESOURCE FUNCTION: GpuMatcher_Create
+     * Resources: shaders, gray/template/partial/result buffers and views,
+     *            per-entry constant buffers, per-slot staging buffers
+     * Pattern: goto-cleanup via GpuMatcher_Destroy (every field starts NULL)
+     */
+    for (int i = 0; i < SHADER_COUNT; i++) {
+        hr = device->lpVtbl->CreateComputeShader(device,
+                 g_bytecode[i]->lpVtbl->GetBufferPointer(g_bytecode[i]),
+                 g_bytecode[i]->lpVtbl->GetBufferSize(g_bytecode[i]),
+                 NULL, &m->shaders[i]);
+        if (FAILED(hr)) {
+            Logger_Log("GpuMatcher: CreateComputeShader %s failed: 0x%08X\n", g_entryPoints[i], hr);
+            goto fail;
+        }
+    }
+
+    /* Keep the entries that fit: inside the region, and small enough that
+     * the per-window sum of squares (n * 255^2) stays in a uint */
+    size_t tmplFloats = 0;
+    UINT partialCount = 0;
+    params = (GpuMatchParams*)calloc(entryCount > 0 ? entryCount : 1, sizeof(GpuMatchParams));
+    m->params = (ID3D11Buffer**)calloc(entryCount > 0 ? entryCount : 1, sizeof(ID3D11Buffer*));
+    m->groupsX = (UINT*)calloc(entryCount > 0 ? entryCount : 1, sizeof(UINT));
+    m->groupsY = (UINT*)calloc(entryCount > 0 ? entryCount : 1, sizeof(UINT));
+    if (!params || !m->params || !m->groupsX || !m->groupsY) goto fail;
+
+    for (int i = 0; i < entryCount; i++) {
+        const MatchTemplate* t = entries[i].tmpl;
+        if (!t || !t->centered || t->w <= 0 || t->h <= 0) continue;
+        if (t->w > regionW || t->h > regionH) continue;
+        if ((UINT64)t->w * t->h * 255 * 255 > 0xFFFFFFFFull) continue;
+
+        int k = m->entryCount++;
+        GpuMatchParams* p = &params[k];
+        p->imgW = (UINT)regionW;
+        p->imgH = (UINT)regionH;
+        p->tmplOffset = (UINT)tmplFloats;
+        p->tmplW = (UINT)t->w;
+        p->tmplH = (UINT)t->h;
+        p->entry = (UINT)i;
+        p->partialBase = partialCount;
+        p->tmplNorm = t->norm;
+        m->groupsX[k] = (UINT)(regionW - t->w + GROUP_DIM) / GROUP_DIM;
+        m->groupsY[k] = (UINT)(regionH - t->h + GROUP_DIM) / GROUP_DIM;
+        p->groupsX = m->groupsX[k];
+        partialCount += m->groupsX[k] * m->groupsY[k];
+        tmplFloats += (size_t)t->w * t->h;
+    }
+    if (m->entryCount == 0) {
+        Logger_Log("GpuMatcher: no template fits a %dx%d region\n", regionW, regionH);
+        goto fail;
+    }
+
+    tmplData = (float*)malloc(tmplFloats * sizeof(float));
+    if (!tmplData) goto fail;
+    for (int k = 0; k < m->entryCount; k++) {
+        const MatchTemplate* t = entries[params[k].entry].tmpl;
+        params[k].partialCount = partialCount;
+        memcpy(tmplData + params[k].tmplOffset, t->centered, (size_t)t->w * t->h * sizeof(float));
+
+        D3D11_BUFFER_DESC desc = {0};
+        desc.ByteWidth = sizeof(GpuMatchParams);
+        desc.Usage = D3D11_USAGE_IMMUTABLE;
+        desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        D3D11_SUBRESOURCE_DATA data = {0};
+        data.pSysMem = &params[k];
+        hr = device->lpVtbl->CreateBuffer(device, &desc, &data, &m->params[k]);
+        if (FAILED(hr)) {
+            Logger_Log("GpuMatcher: CreateBuffer (params) failed: 0x%08X\n", hr);
+            goto fail;
+        }
+    }
+
+    UINT pixels = (UINT)regionW * (UINT)regionH;
+    UINT rw = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+    if (!CreateStructured(device, sizeof(UINT), pixels, rw, NULL, &m->grayBuf) ||
+        !CreateViews(device, m->grayBuf, pixels, &m->graySrv, &m->grayUav) ||
+        !CreateStructured(device, sizeof(float), (UINT)tmplFloats, D3D11_BIND_SHADER_RESOURCE,
+                          tmplData, &m->tmplBuf) ||
+        !CreateViews(device, m->tmplBuf, (UINT)tmplFloats, &m->tmplSrv, NULL) ||
+        !CreateStructured(device, sizeof(GpuMatchPartial), partialCount,
+                          D3D11_BIND_UNORDERED_ACCESS, NULL, &m->partialBuf) ||
+        !CreateViews(device, m->partialBuf, partialCount, NULL, &m->partialUav) ||
+        !CreateStructured(device, sizeof(GpuMatchPartial), 1,
+                          D3D11_BIND_UNORDERED_ACCESS, NULL, &m->resultBuf) ||
+        !CreateViews(device, m->resultBuf, 1, NULL, &m->resultUav))
+        goto fail;
+
+    for (int i = 0; i < GPU_MATCH_RING_DEPTH; i++) {
+        if (!CreateStructured(device, sizeof(GpuMatchPartial), 1, 0, NULL, &m->slots[i].staging))
+            goto fail;
+    }
+
+    Logger_Log("GpuMatcher: %dx%d region, %d/%d entries, %u partials\n",
+               regionW, regionH, m->entryCount, entryCount, partialCount);
+    free(tmplData);
+    free(params);
+    return m;
+
+fail:
+    free(tmplData);
+    free(params);
+    GpuMatcher_Destroy(m);
+    return NULL;
+}
+
+/* Slot textures take the capture texture's format, which is only known at
+ * the first Dispatch (and changes if capture is rebuilt in another format) */
+static BOOL EnsureRegionTextures(GpuMatcher* m, ID3D11Texture2D* source)
+{
+    D3D11_TEXTURE2D_DESC src;
+    source->lpVtbl->GetDesc(source, &src);
+    if (m->slots[0].regionTex && src.Format == m->regionFormat) return TRUE;
+
+    for (int i = 0; i < GPU_MATCH_RING_DEPTH; i++) {
+        SAFE_RELEASE(m->slots[i].regionSrv);
+        SAFE_RELEASE(m->slots[i].regionTex);
+    }
+    SAFE_RELEASE(m->readbackTex);
+
+    D3D11_TEXTURE2D_DESC desc = {0};
+    desc.Width = (UINT)m->regionW;
+    desc.Height = (UINT)m->regionH;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = src.Format;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    for (int i = 0; i < GPU_MATCH_RING_DEPTH; i++) {
+        HRESULT hr = m->device->lpVtbl->CreateTexture2D(m->device, &desc, NULL, &m->slots[i].regionTex);
+        if (SUCCEEDED(hr)) {
+            hr = m->device->lpVtbl->CreateShaderResourceView(m->device,
+                     (ID3D11Resource*)m->slots[i].regionTex, NULL, &m->slots[i].regionSrv);
+        }
+        if (FAILED(hr)) {
+            Logger_Log("GpuMatcher: region texture (format %d) failed: 0x%08X\n", src.Format, hr);
+            return FALSE;
+        }
+    }
+    m->regionFormat = src.Format;
+    return TRUE;
+}
+
+BOOL GpuMatcher_Dispatch(GpuMatcher* m, ID3D11DeviceContext* ctx,
+                         ID3D11Texture2D* bgraTexture, int srcX, int srcY, ULONGLONG tag)
+{
+    if (!m || !ctx || !bgraTexture || m->failed) return FALSE;
+
+    GpuMatchSlot* slot = &m->slots[m->tail];
+    if (slot->pending) return FALSE;    /* Ring full: GPU is behind, skip this scan */
+
+    if (!EnsureRegionTextures(m, bgraTexture)) {
+        m->failed = TRUE;
+        return FALSE;
+    }
+
+    D3D11_BOX box = { (UINT)srcX, (UINT)srcY, 0,
+                      (UINT)(srcX + m->regionW), (UINT)(srcY + m->regionH), 1 };
+    ctx->lpVtbl->CopySubresourceRegion(ctx, (ID3D11Resource*)slot->regionTex, 0, 0, 0, 0,
+                                       (ID3D11Resource*)bgraTexture, 0, &box);
+
+    ID3D11ShaderResourceView* nullSrv[3] = { NULL, NULL, NULL };
+    ID3D11UnorderedAccessView* nullUav[3] = { NULL, NULL, NULL };
+
+    /* Gray */
+    ctx->lpVtbl->CSSetShader(ctx, m->shaders[SHADER_GRAY], NULL, 0);
+    ctx->lpVtbl->CSSetConstantBuffers(ctx, 0, 1, &m->params[0]);
+    ctx->lpVtbl->CSSetShaderResources(ctx, 0, 1, &slot->regionSrv);
+    ctx->lpVtbl->CSSetUnorderedAccessViews(ctx, 0, 1, &m->grayUav, NULL);
+    ctx->lpVtbl->Dispatch(ctx, (UINT)(m->regionW + GROUP_DIM - 1) / GROUP_DIM,
+                          (UINT)(m->regionH + GROUP_DIM - 1) / GROUP_DIM, 1);
+    ctx->lpVtbl->CSSetUnorderedAccessViews(ctx, 0, 1, nullUav, NULL);
+
+    /* NCC, one dispatch per entry into its range of partials */
+    ID3D11ShaderResourceView* nccSrv[2] = { m->graySrv, m->tmplSrv };
+    ctx->lpVtbl->CSSetShader(ctx, m->shaders[SHADER_NCC], NULL, 0);
+    ctx->lpVtbl->CSSetShaderResources(ctx, 1, 2, nccSrv);
+    ctx->lpVtbl->CSSetUnorderedAccessViews(ctx, 1, 1, &m->partialUav, NULL);
+    for (int k = 0; k < m->entryCount; k++) {
+        ctx->lpVtbl->CSSetConstantBuffers(ctx, 0, 1, &m->params[k]);
+        ctx->lpVtbl->Dispatch(ctx, m->groupsX[k], m->groupsY[k], 1);
+    }
+
+    /* Reduce every partial to result[0] */
+    ctx->lpVtbl->CSSetShader(ctx, m->shaders[SHADER_REDUCE], NULL, 0);
+    ctx->lpVtbl->CSSetUnorderedAccessViews(ctx, 2, 1, &m->resultUav, NULL);
+    ctx->lpVtbl->Dispatch(ctx, 1, 1, 1);
+
+    /* Leave no compute state bound for the rest of the capture pipeline */
+    ctx->lpVtbl->CSSetShader(ctx, NULL, NULL, 0);
+    ctx->lpVtbl->CSSetShaderResources(ctx, 0, 3, nullSrv);
+    ctx->lpVtbl->CSSetUnorderedAccessViews(ctx, 0, 3, nullUav, NULL);
+    ID3D11Buffer* nullCb = NULL;
+    ctx->lpVtbl->CSSetConstantBuffers(ctx, 0, 1, &nullCb);
+
+    ctx->lpVtbl->CopyResource(ctx, (ID3D11Resource*)slot->staging, (ID3D11Resource*)m->resultBuf);
+
+    slot->tag = tag;
+    slot->pending = TRUE;
+    m->tail = (m->tail + 1) % GPU_MATCH_RING_DEPTH;
+    return TRUE;
+}
+
+BOOL GpuMatcher_Poll(GpuMatcher* m, ID3D11DeviceContext* ctx, GpuMatchResult* out)
+{
+    if (!m || !ctx || !out || m->failed) return FALSE;
+
+    GpuMatchSlot* slot = &m->slots[m->head];
+    if (!slot->pending) return FALSE;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    HRESULT hr = ctx->lpVtbl->Map(ctx, (ID3D11Resource*)slot->staging, 0, D3D11_MAP_READ,
+                                  D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING) return FALSE;
+    if (FAILED(hr)) {
+        Logger_Log("GpuMatcher: Map result failed: 0x%08X\n", hr);
+        m->failed = TRUE;
+        return FALSE;
+    }
+
+    GpuMatchPartial r;
+    memcpy(&r, mapped.pData, sizeof(r));
+    ctx->lpVtbl->Unmap(ctx, (ID3D11Resource*)slot->staging, 0);
+
+    out->score = r.score;
+    out->x = (int)(r.pos & 0xFFFF);
+    out->y = (int)(r.pos >> 16);
+    out->entry = (int)r.entry;
+    out->slot = m->head;
+    out->tag = slot->tag;
+
+    slot->pending = FALSE;
+    m->head = (m->head + 1) % GPU_MATCH_RING_DEPTH;
+    return TRUE;
+}
+
+BOOL GpuMatcher_ReadbackRegion(GpuMatcher* m, ID3D11DeviceContext* ctx, int slot, BYTE* out)
+{
+    if (!m || !ctx || !out || m->failed) return FALSE;
+    if (slot < 0 || slot >= GPU_MATCH_RING_DEPTH || !m->slots[slot].regionTex) return FALSE;
+
+    HRESULT hr;
+    if (!m->readbackTex) {
+        D3D11_TEXTURE2D_DESC desc;
+        m->slots[slot].regionTex->lpVtbl->GetDesc(m->slots[slot].regionTex, &desc);
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.BindFlags = 0;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        hr = m->device->lpVtbl->CreateTexture2D(m->device, &desc, NULL, &m->readbackTex);
+        if (FAILED(hr)) {
+            Logger_Log("GpuMatcher: CreateTexture2D (readback) failed: 0x%08X\n", hr);
+            return FALSE;
+        }
+    }
+
+    ctx->lpVtbl->CopyResource(ctx, (ID3D11Resource*)m->readbackTex,
+                              (ID3D11Resource*)m->slots[slot].regionTex);
+
+    /* Blocks, but the copy is queued behind a scan Poll already saw finish */
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    hr = ctx->lpVtbl->Map(ctx, (ID3D11Resource*)m->readbackTex, 0, D3D11_MAP_READ, 0, &mapped);
+    if (FAILED(hr)) {
+        Logger_Log("GpuMatcher: Map region failed: 0x%08X\n", hr);
+        return FALSE;
+    }
+    for (int y = 0; y < m->regionH; y++) {
+        memcpy(out + (size_t)y * m->regionW * 4,
+               (const BYTE*)mapped.pData + (size_t)y * mapped.RowPitch, (size_t)m->regionW * 4);
+    }
+    ctx->lpVtbl->Unmap(ctx, (ID3D11Resource*)m->readbackTex, 0);
+    return TRUE;
+}
+
+BOOL GpuMatcher_Failed(const GpuMatcher* m)
+{
+    return m ? m->failed : TRUE;
+}
+
+void GpuMatcher_Destroy(GpuMatcher* m)
+{
+    if (!m) return;
+
+    for (int i = 0; i < GPU_MATCH_RING_DEPTH; i++) {
+        SAFE_RELEASE(m->slots[i].regionSrv);
+        SAFE_RELEASE(m->slots[i].regionTex);
+        SAFE_RELEASE(m->slots[i].staging);
+    }
+    SAFE_RELEASE(m->readbackTex);
+
+    if (m->params) {
+        for (int k = 0; k < m->entryCount; k++) SAFE_RELEASE(m->params[k]);
+    }
+    SAFE_FREE(m->params);
+    SAFE_FREE(m->groupsX);
+    SAFE_FREE(m->groupsY);
+
+    SAFE_RELEASE(m->resultUav);
+    SAFE_RELEASE(m->resultBuf);
+    SAFE_RELEASE(m->partialUav);
+    SAFE_RELEASE(m->partialBuf);
+    SAFE_RELEASE(m->tmplSrv);
+    SAFE_RELEASE(m->tmplBuf);
+    SAFE_RELEASE(m->grayUav);
+    SAFE_RELEASE(m->graySrv);
+    SAFE_RELEASE(m->grayBuf);
+
+    for (int i = 0; i < SHADER_COUNT; i++) SAFE_RELEASE(m->shaders[i]);
+    free(m);
+}
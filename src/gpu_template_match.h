@@ -0,0 +1,70 @@
+/*
+ * gpu_template_match.h - D3D11 compute-shader NCC matcher
+ *
+ * USED BY: kill_feed_sampler.c ([Advanced] GpuKillFeed)
+ *
+ * Runs the kill-feed scan on the capture device: the detection region is
+ * copied out of the captured BGRA texture, converted to gray, matched
+ * against every template and scale, and max-reduced to one result, all in
+ * compute shaders. Only that result (16 bytes) comes back to the CPU, from
+ * a small ring of staging buffers polled with D3D11_MAP_FLAG_DO_NOT_WAIT,
+ * so the capture thread never waits on the GPU.
+ *
+ * Shaders are compiled at startup with D3DCompile from d3dcompiler_47.dll
+ * (loaded at runtime; present on every supported Windows). Create returns
+ * NULL when the DLL, the compile or any resource is unavailable and the
+ * caller keeps the CPU matcher.
+ *
+ * Threading: capture thread only (it owns the immediate context).
+ */
+
+#ifndef GPU_TEMPLATE_MATCH_H
+#define GPU_TEMPLATE_MATCH_H
+
+#include <windows.h>
+#include <d3d11.h>
+#include "template_match.h"
+
+typedef struct GpuMatcher GpuMatcher;
+
+/* One template at one scale. The matcher copies the pixels; tmpl need not
+ * outlive Create. */
+typedef struct {
+    const MatchTemplate* tmpl;
+} GpuMatchEntry;
+
+typedef struct {
+    float score;            /* Best NCC over all entries */
+    int x, y;               /* Top-left of the best window, region pixels */
+    int entry;              /* Index into the Create entries */
+    int slot;               /* Ring slot, for GpuMatcher_ReadbackRegion */
+    ULONGLONG tag;          /* Caller tag passed to Dispatch */
+} GpuMatchResult;
+
+/* Build shaders and buffers for a regionW x regionH region. Entries that do
+ * not fit the region (or whose sums would overflow 32 bits) are skipped;
+ * NULL if none remain or anything fails. */
+GpuMatcher* GpuMatcher_Create(ID3D11Device* device, int regionW, int regionH,
+                              const GpuMatchEntry* entries, int entryCount);
+
+/* Queue a scan of the region at (srcX, srcY) of bgraTexture. FALSE (and
+ * nothing queued) when every ring slot still awaits its Poll. */
+BOOL GpuMatcher_Dispatch(GpuMatcher* m, ID3D11DeviceContext* ctx,
+                         ID3D11Texture2D* bgraTexture, int srcX, int srcY, ULONGLONG tag);
+
+/* Non-blocking: TRUE and the oldest finished scan's result, or FALSE if
+ * none has finished yet. */
+BOOL GpuMatcher_Poll(GpuMatcher* m, ID3D11DeviceContext* ctx, GpuMatchResult* out);
+
+/* Copy the BGRA region a polled scan matched on into out (regionW * 4 bytes
+ * per row, tightly packed). Valid until the next Dispatch. Maps a staging
+ * copy, so only call it for the rare result that is worth keeping. */
+BOOL GpuMatcher_ReadbackRegion(GpuMatcher* m, ID3D11DeviceContext* ctx, int slot, BYTE* out);
+
+/* TRUE once a device call has failed; every other call then returns FALSE
+ * and the caller should destroy the matcher and match on the CPU */
+BOOL GpuMatcher_Failed(const GpuMatcher* m);
+
+void GpuMatcher_Destroy(GpuMatcher* m);
+
+#endif /* GPU_TEMPLATE_MATCH_H */
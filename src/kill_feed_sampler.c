@@ -3,31 +3,77 @@
  *
  * Scans a calibrated screen region for the active game's banner templates
  * using multi-scale NCC. Templates, threshold, region, cooldown, and the
- * posted save label all come from the GameProfile passed to Init.
+ * posted save label all come from the GameProfile passed to Init. A profile
+ * can add detectors in other regions (round end, scoreboard) with their own
+ * templates, threshold and save label; region 0 is always the kill feed.
+ *
+ * Regions are read back together: each scan copies every due region into
+ * one staging texture laid out as an atlas (CaptureReadback_IssueBatch), so
+ * another detector adds a copy, not another map or GPU sync. Templates are
+ * loaded once per process into a cache keyed by path, so rebuilding the
+ * sampler on Alt-Tab or a game switch never goes back to GDI+.
  *
  * Foreground gating happens upstream in replay_buffer.c (the sampler only
  * exists when a profile-matched game is in front). This module does not
  * inspect the foreground window.
  *
- * Scan cadence: every 2 seconds. Cooldown: profile-defined (default 10s).
+ * Scan cadence: change-gated. A scan is only taken once the capture's dirty
+ * rects have touched a region since the previous one, 125 ms after a
+ * quiet spell and backing off to every 2 s while regions keep
+ * changing; only the regions that changed are scanned, and unchanged ones
+ * are all rescanned every 5 s regardless.
+ * Cooldown: profile-defined (default 10s).
+ *
+ * Matching (template_match.c) builds integral images of the region once per
+ * scan, so window statistics cost O(1); large templates correlate through an
+ * FFT of the region shared by every template and scale. Every scale of every
+ * template is built once at load, and each is searched coarse-to-fine: half
+ * resolution first, then full resolution around the best few peaks. The
+ * template x scale searches of a scan run in parallel on the process thread
+ * pool (at most half the cores, leaving the rest to the game) and stop being
+ * started once one of them clears the threshold.
+ *
+ * With [Advanced] GpuKillFeed the capture thread instead queues each scan on
+ * the GPU (gpu_template_match.c) every GPU_MATCH_SCAN_INTERVAL_MS and hands
+ * the worker only the polled best score; the region's pixels are read back
+ * only when that score clears the threshold (for the trigger snapshot). Any
+ * GPU failure drops back to the CPU matcher for the sampler's lifetime. The
+ * GPU matcher covers one region, so profiles with extra regions match on
+ * the CPU.
  *
- * USES: gdiplus_api (PNG loading), capture (readback), game_profile
+ * USES: gdiplus_api (PNG loading), capture (readback), game_profile,
+ *       template_match, gpu_template_match, parallel
  */
 
 #include "kill_feed_sampler.h"
+#include "template_match.h"
+#include "gpu_template_match.h"
 #include "gdiplus_api.h"
 #include "capture.h"
 #include "game_profile.h"
 #include "logger.h"
 #include "debug_console.h"
 #include "constants.h"
+#include "config.h"
 #include "mem_utils.h"
+#include "parallel.h"
+#include "metrics.h"
+#include "trace.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <emmintrin.h>
 
 /* How often to scan the detection region */
 #define SCAN_INTERVAL_MS        2000
+/* First scan after the region changes following a quiet spell. Each scan
+ * the region is still changing for doubles the wait up to the path's steady
+ * interval, so an always-moving region (animated HUD behind the feed) costs
+ * no more than the fixed cadence did. */
+#define SCAN_MIN_INTERVAL_MS    125
+/* Unchanged regions are still rescanned this often, in case a change ever
+ * slips past the dirty rects; also bounds how long a published match lives */
+#define SCAN_FORCE_INTERVAL_MS  5000
 /* Diagnostic heartbeat / throttle intervals (gated on DebugConsole_IsOpen) */
 #define SAMPLER_HEARTBEAT_MS        60000
 #define SAMPLER_READBACK_LOG_MS     30000
@@ -36,8 +82,21 @@
 /* Template scale factors to try */
 static const float TEMPLATE_SCALES[] = { 1.0f, 1.5f, 2.0f, 0.75f };
 #define NUM_TEMPLATE_SCALES     (sizeof(TEMPLATE_SCALES) / sizeof(TEMPLATE_SCALES[0]))
-/* Max templates per sampler (kept in sync with GAME_PROFILE_MAX_TEMPLATES) */
+/* Max templates per region (kept in sync with GAME_PROFILE_MAX_TEMPLATES) */
 #define MAX_TEMPLATES           GAME_PROFILE_MAX_TEMPLATES
+/* Detection regions per sampler, kill feed first */
+#define MAX_REGIONS             GAME_PROFILE_MAX_REGIONS
+/* Region x template x scale searches per scan */
+#define MAX_SCAN_ITEMS          (MAX_REGIONS * MAX_TEMPLATES * NUM_TEMPLATE_SCALES)
+/* Readback tags carry the regions copied in their low bits, the capture
+ * time (GetTickCount64) above them */
+#define READBACK_TAG_MASK_BITS  8
+/* Threads a scan fans out to, caller included (also capped at half the
+ * logical processors). Four covers the Marathon profile's 16 items in
+ * about the time of the slowest few. */
+#define SCAN_MAX_THREADS        4
+
+extern AppConfig g_config;
 
 /* ─── GDI+ bitmap types (for PNG loading) ─── */
 
@@ -69,14 +128,57 @@ typedef GpStatus (WINAPI *fn_GdipDisposeImage)(void*);
 /* ─── Template data ─── */
 
 typedef struct {
-    BYTE* gray;         /* Grayscale pixel data */
-    int w, h;           /* Dimensions */
-    float mean;         /* Pre-computed mean for NCC */
-    float stdDev;       /* Pre-computed stddev for NCC */
+    int w, h;           /* Dimensions at scale 1.0 */
+    /* Zero-mean full + half resolution copies per TEMPLATE_SCALES entry,
+     * built at load. An entry whose scale rounds to nothing has w == 0. */
+    MatchTemplatePyramid scaled[NUM_TEMPLATE_SCALES];
     BOOL loaded;
     char name[32];      /* Display name for logging */
 } Template;
 
+/* One template at one scale in one region, searched as a unit of the
+ * parallel scan */
+typedef struct {
+    int region;         /* Index into regions */
+    int tmpl;           /* Index into the region's templates */
+    int scale;          /* Index into TEMPLATE_SCALES */
+    MatchResult result; /* This scan's best, -1 if skipped */
+} ScanItem;
+
+/* One detection region. regions[0] is the calibrated kill feed, the rest
+ * the profile's extra regions that fit the capture. */
+typedef struct {
+    char name[GAME_PROFILE_REGION_NAME_LEN];
+    int x, y, w, h;             /* Capture-texture coordinates */
+    int atlasY;                 /* Top row in the readback atlas (x is 0) */
+    size_t pixelOffset;         /* First pixel in the scan buffers */
+    const Template* templates[MAX_TEMPLATES];  /* Template cache entries */
+    int templateCount;
+    float threshold;
+    char saveLabel[GAME_PROFILE_LABEL_LEN];
+    /* Matcher state, worker thread only: integral images / spectrum of
+     * the current scan, reused across scans */
+    MatchImagePyramid matchImage;
+} DetectRegion;
+
+/* ─── Template cache ─── */
+
+/* Every template a sampler has loaded, kept for the process so a new
+ * sampler (Alt-Tab back, another game) finds its templates ready. Entries
+ * are read-only once added, so samplers share them without locking; the
+ * lock only guards lookups and additions. Failed loads are not cached,
+ * so a template dropped into static\ later is picked up by the next
+ * sampler. Freed by KillFeedSampler_FreeTemplateCache at exit. */
+typedef struct {
+    char path[MAX_PATH];
+    Template* tmpl;
+} TemplateCacheEntry;
+
+static SRWLOCK g_templateCacheLock = SRWLOCK_INIT;
+static TemplateCacheEntry* g_templateCache;
+static int g_templateCacheCount;
+static int g_templateCacheCap;
+
 /* ─── Module state ─── */
 
 /* Published "last best match" for the settings region-overlay timer to poll.
@@ -92,28 +194,67 @@ static struct {
     ULONGLONG timestampMs;   /* GetTickCount64() at publish */
 } g_lastMatch;
 
+/* Region pixels for one scan, every region packed one after another at its
+ * pixelOffset (rows of w pixels), allocated once per sampler. gray is only
+ * filled on the CPU path. bgra is the trigger snapshot: on a match it is
+ * handed to triggerBmp and the buffer takes triggerBmp's old memory, or
+ * allocates again the next time it is filled. */
+typedef struct {
+    BYTE* gray;
+    BYTE* bgra;
+} ScanBuffer;
+
+/* One being filled by the capture thread, one pending, one being scanned */
+#define SCAN_BUFFER_COUNT       3
+
 /* Pending work item for the worker thread */
 typedef struct {
-    BYTE* gray;         /* Grayscale image (worker owns, frees after use) */
-    BYTE* bgra;         /* BGRA copy for BMP snapshot (worker owns) */
-    int w, h;
-    int bgraStride;
+    int buffer;         /* Index into buffers; -1 for a GPU result without pixels */
     ULONGLONG timestamp; /* GetTickCount64 at capture time */
+    DWORD regionMask;   /* Regions this scan covers (bit per regions index) */
+    /* GPU path: the scan is already matched; the buffer's gray is unused and
+     * its bgra only filled when score clears the threshold */
+    BOOL hasResult;
+    float score;
+    int gpuEntry;       /* Index into gpuEntryTemplate / gpuEntryScale */
+    int x, y;           /* Top-left of the best window */
 } ScanWork;
 
 struct KillFeedSampler {
-    /* Detection region in capture-texture coordinates */
-    int kfX, kfY, kfW, kfH;
+    /* Detection regions, kill feed first */
+    DetectRegion regions[MAX_REGIONS];
+    int regionCount;
+    /* Readback atlas (regions stacked at x = 0) and scan buffer size */
+    int atlasW, atlasH;
+    size_t pixelCount;
     /* Monitor origin (capture rect top-left). Stored so per-scan match coords
      * can be republished in overlay/monitor space without re-reading CaptureState. */
     int cropX, cropY;
 
-    /* Templates */
-    Template templates[MAX_TEMPLATES];
-    int templateCount;
+    /* Every region x template x scale, largest first so the slowest
+     * searches start earliest. Built at Init; results written by the scan. */
+    ScanItem items[MAX_SCAN_ITEMS];
+    int itemCount;
+    int scanThreads;
+
+    /* FFT scratch, one per scan thread. A running item claims a free one
+     * (scratchBusy 0 -> 1), so no thread shares scratch. */
+    MatchScratch scratch[SCAN_MAX_THREADS];
+    volatile LONG scratchBusy[SCAN_MAX_THREADS];
+
+    /* Staging ring the CPU path reads the region through (capture thread only) */
+    CaptureReadback readback;
+
+    /* GPU matcher (capture thread only), NULL on the CPU path. Its entries
+     * are every kill-feed template x scale; the maps are read by the worker. */
+    GpuMatcher* gpu;
+    int gpuEntryTemplate[MAX_TEMPLATES * NUM_TEMPLATE_SCALES];
+    int gpuEntryScale[MAX_TEMPLATES * NUM_TEMPLATE_SCALES];
 
     /* Timing (capture thread only) */
     ULONGLONG lastScanMs;
+    DWORD scanIntervalMs;   /* Current adaptive wait, see SCAN_MIN_INTERVAL_MS */
+    DWORD dirtyMask;        /* Regions dirty rects touched since their last scan */
     DWORD captureThreadId;  /* Enforces FeedFrame single-thread precondition */
 
     /* Worker thread */
@@ -123,13 +264,13 @@ struct KillFeedSampler {
     CRITICAL_SECTION workLock;
     ScanWork pendingWork;   /* Protected by workLock */
     BOOL hasPendingWork;    /* Protected by workLock */
+    ScanBuffer buffers[SCAN_BUFFER_COUNT];
+    int scanningBuffer;     /* Protected by workLock: buffer the worker reads, -1 if none */
 
     /* Bound game profile (catalog-owned; outlives sampler). Profile owns
      * lastTriggerMs so cooldown persists across Alt-Tab sampler restarts. */
     GameProfile* profile;
-    float matchThreshold;
-    DWORD cooldownMs;
-    char saveLabel[GAME_PROFILE_LABEL_LEN];
+    DWORD cooldownMs;       /* Shared by all regions: one clip per event */
 
     /* Overlay window for WM_AUTOCLIP_SAVE */
     HWND overlayWnd;
@@ -137,23 +278,19 @@ struct KillFeedSampler {
     /* Last trigger context (worker writes, main reads after save) */
     CRITICAL_SECTION triggerLock;
     char triggerReason[512];
-    BYTE* triggerBmp;
+    BYTE* triggerBmp;       /* A whole scan buffer's BGRA... */
+    size_t triggerBmpOffset;/* ...of which the triggering region starts here */
     int triggerBmpW, triggerBmpH, triggerBmpStride;
     BOOL triggerPending;
 
-    /* ─── Diagnostic counters (gated on DebugConsole_IsOpen for file-log emission) ─── */
-    /* All counters guarded by workLock. Window resets each heartbeat. */
+    /* ─── Diagnostics (gated on DebugConsole_IsOpen for file-log emission) ─── */
+    /* Counts are METRIC_KILLFEED_* in the metrics registry; the heartbeat
+     * (worker thread) reports the change since the previous one from
+     * heartbeatBase. bestScoreWindow is worker-only, reset each heartbeat. */
     ULONGLONG lastHeartbeatMs;
-    ULONGLONG lastReadbackFailLogMs;
-    unsigned int scansWindow;
-    unsigned int feedFrameCallsWindow;   /* raw FeedFrame invocations (producer rate) */
-    unsigned int feedFrameQueuedWindow;  /* invocations that passed throttle + readback and queued work */
-    unsigned int readbackFails;       /* producer writes, worker reads/resets */
-    unsigned int readbackFailsTotal;  /* lifetime, never reset */
+    ULONGLONG lastReadbackFailLogMs;    /* Capture thread only */
+    LONGLONG heartbeatBase[METRIC_COUNTER_COUNT];
     float bestScoreWindow;
-    unsigned int cooldownRejects;
-    unsigned int foregroundRejects;
-    unsigned int belowThresholdCount;
 };
 
 /* ─── Helpers ─── */
@@ -196,23 +333,41 @@ static BOOL SaveBMP(const char* path, const BYTE* bgra, int width, int height, i
     return TRUE;
 }
 
-/* Convert BGRA buffer to grayscale */
-static BYTE* BgraToGray(const BYTE* bgra, int width, int height, int stride)
+/* Copy one row of BGRA out of a mapped readback and convert it to gray in
+ * the same pass. SSE2 forms r*299 + g*587 + b*114 with pmaddwd, then
+ * divides by 1000 in float: (sum + 0.5) * 0.001 truncates to exactly the
+ * integer quotient for every 8-bit colour, so the gray matches the
+ * templates' (scalar) conversion bit for bit. */
+static void ConvertRegionRow(const BYTE* src, BYTE* bgraOut, BYTE* grayOut, int width)
 {
-    BYTE* gray = (BYTE*)malloc((size_t)width * height);
-    if (!gray) return NULL;
-
-    for (int y = 0; y < height; y++) {
-        const BYTE* src = bgra + (size_t)y * stride;
-        BYTE* dst = gray + (size_t)y * width;
-        for (int x = 0; x < width; x++) {
-            BYTE b = src[x * 4 + 0];
-            BYTE g = src[x * 4 + 1];
-            BYTE r = src[x * 4 + 2];
-            dst[x] = (BYTE)((r * 299 + g * 587 + b * 114) / 1000);
-        }
+    const __m128i coeffs = _mm_setr_epi16(114, 587, 299, 0, 114, 587, 299, 0);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 inv1000 = _mm_set1_ps(0.001f);
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+        _mm_storeu_si128((__m128i*)(bgraOut + x * 4), px);
+
+        /* Per pixel: [b*114 + g*587, r*299] as 32-bit pairs */
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coeffs);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coeffs);
+        __m128 bg = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 r = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+        __m128i sum = _mm_add_epi32(_mm_castps_si128(bg), _mm_castps_si128(r));
+
+        __m128i g = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(sum), half), inv1000));
+        g = _mm_packs_epi32(g, g);
+        g = _mm_packus_epi16(g, g);
+        int packed = _mm_cvtsi128_si32(g);
+        memcpy(grayOut + x, &packed, 4);
+    }
+    for (; x < width; x++) {
+        const BYTE* p = src + x * 4;
+        memcpy(bgraOut + x * 4, p, 4);
+        grayOut[x] = (BYTE)((p[2] * 299 + p[1] * 587 + p[0] * 114) / 1000);
     }
-    return gray;
 }
 
 /* Scale a grayscale buffer by a factor (nearest neighbor) */
@@ -239,104 +394,85 @@ static BYTE* ScaleGray(const BYTE* src, int srcW, int srcH, float scale, int* ou
 
 /* ─── Template matching (NCC) ─── */
 
-static float TemplateMatchNCC(const BYTE* image, int imgW, int imgH,
-                              const BYTE* tmpl, int tmplW, int tmplH,
-                              float tmplMean, float tmplStdDev,
-                              int* bestX, int* bestY)
+/* Per-scan state shared by the parallel search items */
+typedef struct {
+    KillFeedSampler* sampler;
+    DWORD regionMask;           /* Regions this scan covers */
+    volatile LONG matched;      /* Set once any item clears its region's threshold */
+} ScanJob;
+
+static const MatchTemplatePyramid* ItemTemplate(const KillFeedSampler* s, const ScanItem* item)
 {
-    if (tmplW > imgW || tmplH > imgH) return -1.0f;
-    if (tmplStdDev < 1.0f) return -1.0f;
-
-    int tmplN = tmplW * tmplH;
-    float bestScore = -1.0f;
-    *bestX = 0;
-    *bestY = 0;
-
-    for (int y = 0; y <= imgH - tmplH; y++) {
-        for (int x = 0; x <= imgW - tmplW; x++) {
-            float imgMean = 0;
-            for (int ty = 0; ty < tmplH; ty++) {
-                const BYTE* row = image + (size_t)(y + ty) * imgW + x;
-                for (int tx = 0; tx < tmplW; tx++)
-                    imgMean += row[tx];
-            }
-            imgMean /= tmplN;
-
-            float imgVar = 0;
-            float crossCorr = 0;
-            for (int ty = 0; ty < tmplH; ty++) {
-                const BYTE* row = image + (size_t)(y + ty) * imgW + x;
-                for (int tx = 0; tx < tmplW; tx++) {
-                    float di = row[tx] - imgMean;
-                    float dt = tmpl[ty * tmplW + tx] - tmplMean;
-                    imgVar += di * di;
-                    crossCorr += di * dt;
-                }
-            }
-            float imgStd = sqrtf(imgVar);
-            float ncc = (imgStd > 1.0f) ? (crossCorr / (imgStd * tmplStdDev)) : 0.0f;
-            if (ncc > bestScore) {
-                bestScore = ncc;
-                *bestX = x;
-                *bestY = y;
-            }
+    return &s->regions[item->region].templates[item->tmpl]->scaled[item->scale];
+}
+
+static int ClaimScratch(KillFeedSampler* s)
+{
+    /* At most scanThreads items run at once, so a free slot exists */
+    for (;;) {
+        for (int i = 0; i < s->scanThreads; i++) {
+            if (InterlockedCompareExchange(&s->scratchBusy[i], 1, 0) == 0) return i;
         }
+        YieldProcessor();
     }
-    return bestScore;
 }
 
-static float TemplateMatchMultiScale(const BYTE* imageGray, int imgW, int imgH,
-                                     const Template* tmpl,
-                                     int* bestX, int* bestY,
-                                     int* bestMatchW, int* bestMatchH)
+/* ParallelBody: search one template at one scale in one region. The
+ * region's matchImage already holds the scan's pyramid and spectrum,
+ * which every item only reads. */
+static void SearchScanItem(void* context, int index)
 {
-    float overallBest = -1.0f;
-    *bestX = 0;
-    *bestY = 0;
-    *bestMatchW = 0;
-    *bestMatchH = 0;
+    ScanJob* job = (ScanJob*)context;
+    KillFeedSampler* s = job->sampler;
+    ScanItem* item = &s->items[index];
+    DetectRegion* region = &s->regions[item->region];
+
+    item->result.score = -1.0f;
+    item->result.x = item->result.y = 0;
+
+    /* Region not in this scan (unchanged since its last one) */
+    if (!(job->regionMask & (1u << item->region))) return;
+    /* Early exit: a detection is already in hand, or Shutdown is waiting */
+    if (job->matched) return;
+    if (WaitForSingleObject(s->hStopEvent, 0) == WAIT_OBJECT_0) return;
+
+    int slot = ClaimScratch(s);
+    TemplateMatch_SearchPyramid(&region->matchImage, ItemTemplate(s, item),
+                                &s->scratch[slot], &item->result);
+    InterlockedExchange(&s->scratchBusy[slot], 0);
+
+    if (item->result.score >= region->threshold) InterlockedExchange(&job->matched, 1);
+}
 
-    for (int s = 0; s < (int)NUM_TEMPLATE_SCALES; s++) {
-        float scale = TEMPLATE_SCALES[s];
-        int scaledW, scaledH;
-        BYTE* scaledTmpl = NULL;
-        const BYTE* useTmpl = tmpl->gray;
-        int useW = tmpl->w, useH = tmpl->h;
-        float useMean = tmpl->mean, useStd = tmpl->stdDev;
-
-        if (scale != 1.0f) {
-            scaledTmpl = ScaleGray(tmpl->gray, tmpl->w, tmpl->h, scale, &scaledW, &scaledH);
-            if (!scaledTmpl) continue;
-            useTmpl = scaledTmpl;
-            useW = scaledW;
-            useH = scaledH;
-
-            int n = useW * useH;
-            useMean = 0;
-            for (int i = 0; i < n; i++) useMean += useTmpl[i];
-            useMean /= n;
-            useStd = 0;
-            for (int i = 0; i < n; i++) {
-                float d = useTmpl[i] - useMean;
-                useStd += d * d;
+/* List every region's loaded template x scale, largest area first */
+static void BuildScanItems(KillFeedSampler* s)
+{
+    s->itemCount = 0;
+    for (int rg = 0; rg < s->regionCount; rg++) {
+        const DetectRegion* region = &s->regions[rg];
+        for (int i = 0; i < region->templateCount; i++) {
+            for (int sc = 0; sc < (int)NUM_TEMPLATE_SCALES; sc++) {
+                const MatchTemplate* t = &region->templates[i]->scaled[sc].fine;
+                if (t->w <= 0) continue;
+
+                /* Insertion sort: a few dozen items, once per Init */
+                int area = t->w * t->h;
+                int k = s->itemCount++;
+                while (k > 0) {
+                    const MatchTemplate* prev = &ItemTemplate(s, &s->items[k - 1])->fine;
+                    if (prev->w * prev->h >= area) break;
+                    s->items[k] = s->items[k - 1];
+                    k--;
+                }
+                s->items[k].region = rg;
+                s->items[k].tmpl = i;
+                s->items[k].scale = sc;
             }
-            useStd = sqrtf(useStd);
         }
-
-        int mx, my;
-        float score = TemplateMatchNCC(imageGray, imgW, imgH,
-                                       useTmpl, useW, useH,
-                                       useMean, useStd, &mx, &my);
-        if (score > overallBest) {
-            overallBest = score;
-            *bestX = mx + useW / 2;
-            *bestY = my + useH / 2;
-            *bestMatchW = useW;
-            *bestMatchH = useH;
-        }
-        free(scaledTmpl);
     }
-    return overallBest;
+
+    int threads = Parallel_WorkerCount() / 2;
+    s->scanThreads = threads < 1 ? 1 : (threads > SCAN_MAX_THREADS ? SCAN_MAX_THREADS : threads);
 }
 
 /* ─── PNG template loading via GDI+ ─── */
@@ -395,8 +531,8 @@ static BOOL LoadTemplatePNG(Template* t, const char* pngPath, const char* name)
 
     t->w = (int)w;
     t->h = (int)h;
-    t->gray = (BYTE*)malloc((size_t)w * h);
-    if (!t->gray) {
+    BYTE* gray = (BYTE*)malloc((size_t)w * h);
+    if (!gray) {
         pUnlock(bitmap, &data);
         pDispose(bitmap);
         return FALSE;
@@ -408,82 +544,298 @@ static BOOL LoadTemplatePNG(Template* t, const char* pngPath, const char* name)
             BYTE b = row[x * 4 + 0];
             BYTE g = row[x * 4 + 1];
             BYTE r = row[x * 4 + 2];
-            t->gray[y * (int)w + x] = (BYTE)((r * 299 + g * 587 + b * 114) / 1000);
+            gray[y * (int)w + x] = (BYTE)((r * 299 + g * 587 + b * 114) / 1000);
         }
     }
 
     pUnlock(bitmap, &data);
     pDispose(bitmap);
 
-    /* Pre-compute stats */
-    int n = t->w * t->h;
-    t->mean = 0;
-    for (int i = 0; i < n; i++) t->mean += t->gray[i];
-    t->mean /= n;
-
-    float var = 0;
-    for (int i = 0; i < n; i++) {
-        float d = t->gray[i] - t->mean;
-        var += d * d;
+    /* Pre-compute every scale's zero-mean pyramid; scans never rescale */
+    int built = 0;
+    for (int s = 0; s < (int)NUM_TEMPLATE_SCALES; s++) {
+        float scale = TEMPLATE_SCALES[s];
+        if (scale == 1.0f) {
+            if (MatchTemplatePyramid_Init(&t->scaled[s], gray, t->w, t->h)) built++;
+            continue;
+        }
+        int scaledW, scaledH;
+        BYTE* scaledGray = ScaleGray(gray, t->w, t->h, scale, &scaledW, &scaledH);
+        if (!scaledGray) continue;
+        if (MatchTemplatePyramid_Init(&t->scaled[s], scaledGray, scaledW, scaledH)) built++;
+        free(scaledGray);
     }
-    t->stdDev = sqrtf(var);
+    free(gray);
+    if (built == 0) return FALSE;
     t->loaded = TRUE;
     strncpy(t->name, name, sizeof(t->name) - 1);
     t->name[sizeof(t->name) - 1] = '\0';
 
-    Logger_Log("KillFeedSampler: Template '%s' loaded: %dx%d (mean=%.1f, std=%.1f)\n",
-               name, t->w, t->h, t->mean, t->stdDev);
+    Logger_Log("KillFeedSampler: Template '%s' loaded: %dx%d (mean=%.1f, std=%.1f), %d scales\n",
+               name, t->w, t->h, t->scaled[0].fine.mean, t->scaled[0].fine.norm, built);
     return TRUE;
 }
 
+static void FreeTemplate(Template* t)
+{
+    for (int s = 0; s < (int)NUM_TEMPLATE_SCALES; s++)
+        MatchTemplatePyramid_Free(&t->scaled[s]);
+    t->loaded = FALSE;
+}
+
+/* The cached template for pngPath, loading it on first use. NULL if it
+ * cannot be loaded. Only the buffer thread creates samplers, so holding
+ * the lock across a load blocks nobody. */
+static const Template* AcquireTemplate(const char* pngPath, const char* name)
+{
+    Template* t = NULL;
+    AcquireSRWLockExclusive(&g_templateCacheLock);
+    for (int i = 0; i < g_templateCacheCount; i++) {
+        if (_stricmp(g_templateCache[i].path, pngPath) == 0) {
+            t = g_templateCache[i].tmpl;
+            goto done;
+        }
+    }
+
+    if (g_templateCacheCount == g_templateCacheCap) {
+        int cap = g_templateCacheCap ? g_templateCacheCap * 2 : 16;
+        TemplateCacheEntry* grown =
+            (TemplateCacheEntry*)realloc(g_templateCache, (size_t)cap * sizeof(TemplateCacheEntry));
+        if (!grown) goto done;
+        g_templateCache = grown;
+        g_templateCacheCap = cap;
+    }
+
+    t = (Template*)calloc(1, sizeof(Template));
+    if (!t) goto done;
+    if (!LoadTemplatePNG(t, pngPath, name)) {
+        FreeTemplate(t);
+        SAFE_FREE(t);
+        goto done;
+    }
+    strncpy_s(g_templateCache[g_templateCacheCount].path, MAX_PATH, pngPath, _TRUNCATE);
+    g_templateCache[g_templateCacheCount].tmpl = t;
+    g_templateCacheCount++;
+
+done:
+    ReleaseSRWLockExclusive(&g_templateCacheLock);
+    return t;
+}
+
+/* ─── Work hand-off ─── */
+
+/* A scan buffer the worker is not holding, with its BGRA allocated. Capture
+ * thread only: it alone sets the pending buffer, and the worker only ever
+ * moves the pending buffer to scanning, so the one returned stays free. */
+static ScanBuffer* AcquireFillBuffer(KillFeedSampler* s, int* outIndex)
+{
+    EnterCriticalSection(&s->workLock);
+    int pending = s->hasPendingWork ? s->pendingWork.buffer : -1;
+    int scanning = s->scanningBuffer;
+    LeaveCriticalSection(&s->workLock);
+
+    for (int i = 0; i < SCAN_BUFFER_COUNT; i++) {
+        if (i == pending || i == scanning) continue;
+        ScanBuffer* buf = &s->buffers[i];
+        if (!buf->bgra) {
+            /* Given to the last trigger's snapshot */
+            buf->bgra = (BYTE*)malloc(s->pixelCount * 4);
+            if (!buf->bgra) return NULL;
+        }
+        *outIndex = i;
+        return buf;
+    }
+    return NULL;
+}
+
+/* Hand a filled scan to the worker, replacing any it has not started (whose
+ * buffer is free again) */
+static void QueueWork(KillFeedSampler* s, const ScanWork* work)
+{
+    EnterCriticalSection(&s->workLock);
+    s->pendingWork = *work;
+    s->hasPendingWork = TRUE;
+    LeaveCriticalSection(&s->workLock);
+    Metrics_Increment(METRIC_KILLFEED_FEED_QUEUED);
+
+    SetEvent(s->hWorkReady);
+}
+
+/* ─── Change gate ─── */
+
+/* Capture thread, every FeedFrame: note which regions this frame's dirty
+ * rects touched, then decide if a scan is due. steadyMs is the path's
+ * cadence for regions that keep changing. */
+static BOOL ScanDue(KillFeedSampler* s, const CaptureState* capture, ULONGLONG now, DWORD steadyMs)
+{
+    const CaptureFrameChange* change = Capture_GetLastChange(capture);
+    if (change->changed) {
+        for (int i = 0; i < s->regionCount; i++) {
+            const DetectRegion* rg = &s->regions[i];
+            RECT region = { rg->x, rg->y, rg->x + rg->w, rg->y + rg->h };
+            RECT overlap;
+            if (IntersectRect(&overlap, &change->dirtyBounds, &region)) s->dirtyMask |= 1u << i;
+        }
+    }
+
+    DWORD firstMs = SCAN_MIN_INTERVAL_MS < steadyMs ? SCAN_MIN_INTERVAL_MS : steadyMs;
+    ULONGLONG sinceMs = now - s->lastScanMs;
+    if (!s->dirtyMask) {
+        /* Quiet for a whole interval: the next change gets the fast first scan */
+        if (sinceMs >= s->scanIntervalMs) s->scanIntervalMs = firstMs;
+        return sinceMs >= SCAN_FORCE_INTERVAL_MS;
+    }
+    if (s->scanIntervalMs < firstMs) s->scanIntervalMs = firstMs;
+    return sinceMs >= s->scanIntervalMs;
+}
+
+/* A scan was taken: clear the gate and back off while changes keep coming.
+ * Returns the regions to scan: the dirty ones, or all on a forced scan. */
+static DWORD ScanTaken(KillFeedSampler* s, ULONGLONG now, DWORD steadyMs)
+{
+    DWORD mask = s->dirtyMask;
+    if (mask) {
+        DWORD next = s->scanIntervalMs * 2;
+        s->scanIntervalMs = next < steadyMs ? next : steadyMs;
+    } else {
+        mask = (1u << s->regionCount) - 1;
+    }
+    s->lastScanMs = now;
+    s->dirtyMask = 0;
+    return mask;
+}
+
+/* ─── GPU path ─── */
+
+/* Hand every kill-feed template x scale to a GPU matcher. Leaves s->gpu
+ * NULL (CPU matching) if the device cannot run it or the profile has extra
+ * regions, which the single-region GPU matcher cannot cover. */
+static void CreateGpuMatcher(KillFeedSampler* s, const CaptureState* capture)
+{
+    if (!capture->device) return;
+    if (s->regionCount > 1) {
+        Logger_Log("KillFeedSampler: GPU matching covers one region, '%s' has %d - using CPU matcher\n",
+                   s->profile->id, s->regionCount);
+        return;
+    }
+
+    const DetectRegion* region = &s->regions[0];
+    GpuMatchEntry entries[MAX_TEMPLATES * NUM_TEMPLATE_SCALES];
+    int count = 0;
+    for (int i = 0; i < region->templateCount; i++) {
+        for (int sc = 0; sc < (int)NUM_TEMPLATE_SCALES; sc++) {
+            if (region->templates[i]->scaled[sc].fine.w <= 0) continue;
+            entries[count].tmpl = &region->templates[i]->scaled[sc].fine;
+            s->gpuEntryTemplate[count] = i;
+            s->gpuEntryScale[count] = sc;
+            count++;
+        }
+    }
+
+    s->gpu = GpuMatcher_Create(capture->device, region->w, region->h, entries, count);
+    Logger_Log("KillFeedSampler: GPU matching %s\n",
+               s->gpu ? "enabled" : "unavailable - using CPU matcher");
+}
+
+/* Drop to the CPU matcher for the rest of this sampler's life */
+static void DisableGpuMatcher(KillFeedSampler* s)
+{
+    Logger_Log("KillFeedSampler: GPU matcher failed - falling back to CPU\n");
+    GpuMatcher_Destroy(s->gpu);
+    s->gpu = NULL;
+}
+
+/* Capture-thread half of a GPU scan: collect finished results, pass the best
+ * one to the worker, then queue the next scan. Returns FALSE if the GPU path
+ * has failed and the caller should scan on the CPU instead. */
+static BOOL FeedFrameGpu(KillFeedSampler* s, CaptureState* capture,
+                         ID3D11Texture2D* bgraTexture, ULONGLONG now)
+{
+    /* Usually at most one result is ready; if the GPU caught up on several,
+     * only the best can trigger (cooldown swallows the rest anyway) */
+    GpuMatchResult r, best = {0};
+    BOOL haveBest = FALSE;
+    while (GpuMatcher_Poll(s->gpu, capture->context, &r)) {
+        if (!haveBest || r.score >= best.score) best = r;
+        haveBest = TRUE;
+    }
+
+    if (haveBest) {
+        ScanWork work = {0};
+        work.buffer = -1;
+        work.timestamp = best.tag;
+        work.regionMask = 1;
+        work.hasResult = TRUE;
+        work.score = best.score;
+        work.gpuEntry = best.entry;
+        work.x = best.x;
+        work.y = best.y;
+
+        /* Pixels only for a result that can trigger; its slot is not
+         * redispatched until after this */
+        if (best.score >= s->regions[0].threshold) {
+            int index;
+            ScanBuffer* buf = AcquireFillBuffer(s, &index);
+            if (buf && GpuMatcher_ReadbackRegion(s->gpu, capture->context, best.slot, buf->bgra))
+                work.buffer = index;
+        }
+        QueueWork(s, &work);
+    }
+
+    if (ScanDue(s, capture, now, GPU_MATCH_SCAN_INTERVAL_MS)) {
+        /* A full ring just means the GPU is behind; the scan is retried next frame */
+        if (GpuMatcher_Dispatch(s->gpu, capture->context, bgraTexture,
+                                s->regions[0].x, s->regions[0].y, now))
+            ScanTaken(s, now, GPU_MATCH_SCAN_INTERVAL_MS);
+    }
+
+    return !GpuMatcher_Failed(s->gpu);
+}
+
 /* ─── Worker thread ─── */
 
+/* Change in a killfeed counter since the previous heartbeat */
+static unsigned int HeartbeatDelta(KillFeedSampler* s, MetricCounter counter)
+{
+    LONGLONG value = Metrics_GetCounter(counter);
+    LONGLONG delta = value - s->heartbeatBase[counter];
+    s->heartbeatBase[counter] = value;
+    return (unsigned int)delta;
+}
+
 /* Emit a throttled diagnostic heartbeat to the main log (gated on debug console).
- * Caller must NOT hold workLock. Resets windowed counters. */
+ * Worker thread only. Resets the window. */
 static void EmitHeartbeatIfDue(KillFeedSampler* s, ULONGLONG now)
 {
-    EnterCriticalSection(&s->workLock);
     if (s->lastHeartbeatMs == 0) s->lastHeartbeatMs = now;
-    if ((now - s->lastHeartbeatMs) < SAMPLER_HEARTBEAT_MS) {
-        LeaveCriticalSection(&s->workLock);
-        return;
-    }
+    if ((now - s->lastHeartbeatMs) < SAMPLER_HEARTBEAT_MS) return;
+
+    unsigned int scans      = HeartbeatDelta(s, METRIC_KILLFEED_SCANS);
+    unsigned int feedCalls  = HeartbeatDelta(s, METRIC_KILLFEED_FEED_CALLS);
+    unsigned int feedQueued = HeartbeatDelta(s, METRIC_KILLFEED_FEED_QUEUED);
+    unsigned int rbFail     = HeartbeatDelta(s, METRIC_KILLFEED_READBACK_FAILS);
+    unsigned int cdRej      = HeartbeatDelta(s, METRIC_KILLFEED_COOLDOWN_REJECTS);
+    unsigned int loCnt      = HeartbeatDelta(s, METRIC_KILLFEED_BELOW_THRESHOLD);
+    LONGLONG rbTotal        = Metrics_GetCounter(METRIC_KILLFEED_READBACK_FAILS);
+    float bestScore         = s->bestScoreWindow;
+    ULONGLONG lastTrig      = s->profile ? s->profile->lastTriggerMs : 0;
 
-    unsigned int scans   = s->scansWindow;
-    unsigned int feedCalls  = s->feedFrameCallsWindow;
-    unsigned int feedQueued = s->feedFrameQueuedWindow;
-    unsigned int rbFail  = s->readbackFails;
-    unsigned int rbTotal = s->readbackFailsTotal;
-    float bestScore      = s->bestScoreWindow;
-    unsigned int cdRej   = s->cooldownRejects;
-    unsigned int fgRej   = s->foregroundRejects;
-    unsigned int loCnt   = s->belowThresholdCount;
-    ULONGLONG lastTrig   = s->profile ? s->profile->lastTriggerMs : 0;
-
-    s->scansWindow = 0;
-    s->feedFrameCallsWindow = 0;
-    s->feedFrameQueuedWindow = 0;
-    s->readbackFails = 0;
     s->bestScoreWindow = -1.0f;
-    s->cooldownRejects = 0;
-    s->foregroundRejects = 0;
-    s->belowThresholdCount = 0;
     s->lastHeartbeatMs = now;
-    LeaveCriticalSection(&s->workLock);
 
     if (!DebugConsole_IsOpen()) return;
 
     long long ageMs = (lastTrig == 0) ? -1 : (long long)(now - lastTrig);
     float displayScore = (bestScore < 0.0f) ? 0.0f : bestScore;
-    Logger_Log("KillFeedSampler: heartbeat feed_calls=%u feed_queued=%u scans=%u readback_fails=%u (total=%u) best_score=%.3f "
-               "last_match_age_ms=%lld rejects[cd=%u fg=%u lo=%u]\n",
+    Logger_Log("KillFeedSampler: heartbeat feed_calls=%u feed_queued=%u scans=%u readback_fails=%u (total=%lld) best_score=%.3f "
+               "last_match_age_ms=%lld rejects[cd=%u lo=%u]\n",
                feedCalls, feedQueued, scans, rbFail, rbTotal, displayScore,
-               ageMs, cdRej, fgRej, loCnt);
-    DebugConsole_Print("HEARTBEAT: feed=%u queued=%u scans=%u/min best=%.3f rb_fails=%u (total=%u) "
-                       "last_match=%llds ago rejects[cd=%u fg=%u lo=%u]\n",
+               ageMs, cdRej, loCnt);
+    DebugConsole_Print("HEARTBEAT: feed=%u queued=%u scans=%u/min best=%.3f rb_fails=%u (total=%lld) "
+                       "last_match=%llds ago rejects[cd=%u lo=%u]\n",
                        feedCalls, feedQueued, scans, displayScore, rbFail, rbTotal,
                        (ageMs < 0) ? -1LL : (ageMs / 1000),
-                       cdRej, fgRej, loCnt);
+                       cdRej, loCnt);
 }
 
 static DWORD WINAPI ScanWorkerProc(LPVOID param)
@@ -504,98 +856,175 @@ static DWORD WINAPI ScanWorkerProc(LPVOID param)
 
         /* Grab the pending work item */
         ScanWork work = {0};
+        BOOL haveWork = FALSE;
         EnterCriticalSection(&s->workLock);
         if (s->hasPendingWork) {
             work = s->pendingWork;
-            memset(&s->pendingWork, 0, sizeof(s->pendingWork));
             s->hasPendingWork = FALSE;
+            haveWork = TRUE;
         }
-        s->scansWindow++;
+        /* The previous scan's buffer is free again from here */
+        s->scanningBuffer = haveWork ? work.buffer : -1;
         LeaveCriticalSection(&s->workLock);
+        Metrics_Increment(METRIC_KILLFEED_SCANS);
+
+        if (!haveWork) continue;
+        ScanBuffer* buf = (work.buffer >= 0) ? &s->buffers[work.buffer] : NULL;
+        if (!buf && !work.hasResult) continue;
+
+        /* Best per region: template, score and match centre / size in
+         * region pixels */
+        float bestScore[MAX_REGIONS];
+        int bestIdx[MAX_REGIONS];
+        int bestMx[MAX_REGIONS], bestMy[MAX_REGIONS];
+        int bestMxW[MAX_REGIONS], bestMxH[MAX_REGIONS];
+        for (int rg = 0; rg < s->regionCount; rg++) {
+            bestScore[rg] = -1.0f;
+            bestIdx[rg] = -1;
+            bestMx[rg] = bestMy[rg] = bestMxW[rg] = bestMxH[rg] = 0;
+        }
 
-        if (!work.gray) continue;
-
-        /* Try each template */
-        float bestScore = -1.0f;
-        int bestIdx = -1;
-        int bestMx = 0, bestMy = 0;
-        int bestMxW = 0, bestMxH = 0;
+        TraceActivity trace;
+        TRACE_STAGE_START(&trace, TRACE_STAGE_KILLFEED_SCAN, work.regionMask, (LONGLONG)work.timestamp);
+        if (work.hasResult) {
+            /* Matched on the GPU (kill feed only): translate the entry back
+             * to template + scale */
+            int ti = s->gpuEntryTemplate[work.gpuEntry];
+            const Template* tmpl = s->regions[0].templates[ti];
+            const MatchTemplate* t = &tmpl->scaled[s->gpuEntryScale[work.gpuEntry]].fine;
+            TRACE_STAGE_STOP(&trace, work.regionMask, (LONGLONG)work.timestamp);
+            bestScore[0] = work.score;
+            bestIdx[0] = ti;
+            bestMx[0] = work.x + t->w / 2;
+            bestMy[0] = work.y + t->h / 2;
+            bestMxW[0] = t->w;
+            bestMxH[0] = t->h;
+            if (work.score > 0.60f)
+                DebugConsole_Print("SCAN: %s score=%.3f (gpu)\n", tmpl->name, work.score);
+        } else {
+            /* Pyramid + integral images once per region and scan; every
+             * template and scale reads them. The spectrum is built here,
+             * before the fan-out, so items only read the image. If it
+             * cannot be built each search would try to build it itself,
+             * so they run one at a time instead. */
+            ScanJob job = { s, 0, 0 };
+            BOOL spectra = TRUE;
+            for (int rg = 0; rg < s->regionCount; rg++) {
+                DetectRegion* region = &s->regions[rg];
+                if (!(work.regionMask & (1u << rg))) continue;
+                if (!MatchImagePyramid_Set(&region->matchImage, buf->gray + region->pixelOffset,
+                                           region->w, region->h))
+                    continue;
+                if (!MatchImagePyramid_PrepareSpectrum(&region->matchImage)) spectra = FALSE;
+                job.regionMask |= 1u << rg;
+            }
+            if (!job.regionMask) {
+                TRACE_STAGE_STOP(&trace, 0, (LONGLONG)work.timestamp);
+                continue;
+            }
+            Parallel_ForLimited(s->itemCount, spectra ? s->scanThreads : 1, SearchScanItem, &job);
+            TRACE_STAGE_STOP(&trace, job.regionMask, (LONGLONG)work.timestamp);
 
-        for (int i = 0; i < s->templateCount; i++) {
-            /* Bail out mid-scan if shutdown was requested — template matching
-             * is multi-ms per template and would otherwise block Shutdown. */
-            if (WaitForSingleObject(s->hStopEvent, 0) == WAIT_OBJECT_0) {
-                free(work.gray);
-                work.gray = NULL;
+            /* Items check the stop event, but template matching is multi-ms
+             * per item, so check again before acting on a partial scan */
+            if (WaitForSingleObject(s->hStopEvent, 0) == WAIT_OBJECT_0)
                 goto worker_exit;
+
+            /* Best item per region and template (for the scan log), then per region */
+            int templateBest[MAX_REGIONS][MAX_TEMPLATES];
+            memset(templateBest, 0xFF, sizeof(templateBest));
+            for (int k = 0; k < s->itemCount; k++) {
+                int* b = &templateBest[s->items[k].region][s->items[k].tmpl];
+                if (*b < 0 || s->items[k].result.score > s->items[*b].result.score) *b = k;
             }
-            if (!s->templates[i].loaded) continue;
-            int mx, my, mxW, mxH;
-            float score = TemplateMatchMultiScale(work.gray, work.w, work.h,
-                                                  &s->templates[i], &mx, &my, &mxW, &mxH);
-            if (score > 0.60f)
-                DebugConsole_Print("SCAN: %s score=%.3f\n", s->templates[i].name, score);
-            if (score > bestScore) {
-                bestScore = score;
-                bestIdx = i;
-                bestMx = mx;
-                bestMy = my;
-                bestMxW = mxW;
-                bestMxH = mxH;
+            for (int rg = 0; rg < s->regionCount; rg++) {
+                const DetectRegion* region = &s->regions[rg];
+                if (!(job.regionMask & (1u << rg))) continue;
+                for (int i = 0; i < region->templateCount; i++) {
+                    if (templateBest[rg][i] < 0) continue;
+                    const ScanItem* item = &s->items[templateBest[rg][i]];
+                    const MatchTemplate* t = &ItemTemplate(s, item)->fine;
+                    float score = item->result.score;
+                    if (score > 0.60f) {
+                        if (rg == 0)
+                            DebugConsole_Print("SCAN: %s score=%.3f\n", region->templates[i]->name, score);
+                        else
+                            DebugConsole_Print("SCAN: [%s] %s score=%.3f\n", region->name,
+                                               region->templates[i]->name, score);
+                    }
+                    if (score > bestScore[rg]) {
+                        bestScore[rg] = score;
+                        bestIdx[rg] = i;
+                        bestMx[rg] = item->result.x + t->w / 2;
+                        bestMy[rg] = item->result.y + t->h / 2;
+                        bestMxW[rg] = t->w;
+                        bestMxH[rg] = t->h;
+                    }
+                }
             }
+            work.regionMask = job.regionMask;
         }
 
-        free(work.gray);
+        /* The triggering region: the best score among those that cleared
+         * their threshold, else the best overall (for the logs) */
+        int hit = -1, top = -1;
+        for (int rg = 0; rg < s->regionCount; rg++) {
+            if (!(work.regionMask & (1u << rg)) || bestIdx[rg] < 0) continue;
+            if (top < 0 || bestScore[rg] > bestScore[top]) top = rg;
+            if (bestScore[rg] >= s->regions[rg].threshold &&
+                (hit < 0 || bestScore[rg] > bestScore[hit]))
+                hit = rg;
+        }
 
         /* Track windowed best score for heartbeat */
         EnterCriticalSection(&s->workLock);
-        if (bestScore > s->bestScoreWindow) s->bestScoreWindow = bestScore;
+        if (top >= 0 && bestScore[top] > s->bestScoreWindow) s->bestScoreWindow = bestScore[top];
         LeaveCriticalSection(&s->workLock);
 
-        /* Publish best match for the debug region-overlay (red/orange rect).
+        /* Publish the kill feed's best match for the debug region-overlay
+         * (red/orange rect); left alone when this scan skipped the kill feed.
          * Only worth showing scores >= 0.50; lower would just be visual noise.
-         * bestMx/bestMy are CENTER coords in (kfW x kfH) sub-image space; convert
+         * bestMx/bestMy are CENTER coords in region sub-image space; convert
          * to monitor-overlay top-left by undoing crop + adding region offset. */
-        AcquireSRWLockExclusive(&g_lastMatchLock);
-        if (bestScore >= 0.50f && bestIdx >= 0 && bestMxW > 0 && bestMxH > 0) {
-            g_lastMatch.hasValue = TRUE;
-            g_lastMatch.x = s->kfX + s->cropX + bestMx - bestMxW / 2;
-            g_lastMatch.y = s->kfY + s->cropY + bestMy - bestMxH / 2;
-            g_lastMatch.w = bestMxW;
-            g_lastMatch.h = bestMxH;
-            g_lastMatch.score = bestScore;
-            g_lastMatch.timestampMs = GetTickCount64();
-        } else {
-            g_lastMatch.hasValue = FALSE;
+        if (work.regionMask & 1) {
+            const DetectRegion* kf = &s->regions[0];
+            AcquireSRWLockExclusive(&g_lastMatchLock);
+            if (bestScore[0] >= 0.50f && bestIdx[0] >= 0 && bestMxW[0] > 0 && bestMxH[0] > 0) {
+                g_lastMatch.hasValue = TRUE;
+                g_lastMatch.x = kf->x + s->cropX + bestMx[0] - bestMxW[0] / 2;
+                g_lastMatch.y = kf->y + s->cropY + bestMy[0] - bestMxH[0] / 2;
+                g_lastMatch.w = bestMxW[0];
+                g_lastMatch.h = bestMxH[0];
+                g_lastMatch.score = bestScore[0];
+                g_lastMatch.timestampMs = GetTickCount64();
+            } else {
+                g_lastMatch.hasValue = FALSE;
+            }
+            ReleaseSRWLockExclusive(&g_lastMatchLock);
         }
-        ReleaseSRWLockExclusive(&g_lastMatchLock);
-
-        /* Check threshold (profile-defined) */
-        if (bestScore < s->matchThreshold || bestIdx < 0) {
-            EnterCriticalSection(&s->workLock);
-            s->belowThresholdCount++;
-            LeaveCriticalSection(&s->workLock);
-            if (bestScore > 0.60f)
+
+        /* Check threshold (profile-defined, per region) */
+        if (hit < 0) {
+            Metrics_Increment(METRIC_KILLFEED_BELOW_THRESHOLD);
+            if (top >= 0 && bestScore[top] > 0.60f)
                 DebugConsole_Print("SCAN: no match (best=%.3f, need %.2f)\n",
-                                  bestScore, s->matchThreshold);
-            free(work.bgra);
+                                  bestScore[top], s->regions[top].threshold);
             continue;
         }
 
-        const char* matchedName = s->templates[bestIdx].name;
+        const DetectRegion* region = &s->regions[hit];
+        const char* matchedName = region->templates[bestIdx[hit]]->name;
+        float matchScore = bestScore[hit];
         DebugConsole_Print("MATCH: %s at (%d,%d) score=%.3f\n",
-                          matchedName, bestMx, bestMy, bestScore);
+                          matchedName, bestMx[hit], bestMy[hit], matchScore);
 
         /* Check cooldown (profile-defined; persists across sampler restarts) */
         ULONGLONG now = work.timestamp;
         ULONGLONG lastTrigger = s->profile ? s->profile->lastTriggerMs : 0;
         if (lastTrigger != 0 && (now - lastTrigger) < s->cooldownMs) {
-            EnterCriticalSection(&s->workLock);
-            s->cooldownRejects++;
-            LeaveCriticalSection(&s->workLock);
+            Metrics_Increment(METRIC_KILLFEED_COOLDOWN_REJECTS);
             DebugConsole_Print("MATCH: cooldown active (%llums left)\n",
                               s->cooldownMs - (now - lastTrigger));
-            free(work.bgra);
             continue;
         }
 
@@ -605,10 +1034,10 @@ static DWORD WINAPI ScanWorkerProc(LPVOID param)
         /* ─── Trigger! ─── */
         if (s->profile) s->profile->lastTriggerMs = now;
 
-        Logger_Log("KillFeedSampler: Detection (%s) for '%s' score=%.3f -> triggering save.\n",
-                   matchedName, s->saveLabel, bestScore);
+        Logger_Log("KillFeedSampler: Detection (%s, region %s) for '%s' score=%.3f -> triggering save.\n",
+                   matchedName, region->name, region->saveLabel, matchScore);
         DebugConsole_Print("TRIGGER: %s (%s, score=%.3f) -> saving replay\n",
-                          s->saveLabel, matchedName, bestScore);
+                          region->saveLabel, matchedName, matchScore);
 
         /* Store trigger context (protected by triggerLock) */
         EnterCriticalSection(&s->triggerLock);
@@ -616,40 +1045,85 @@ static DWORD WINAPI ScanWorkerProc(LPVOID param)
                  "Auto-Clip Trigger Report\n"
                  "========================\n"
                  "Game: %s\n"
+                 "Region: %s\n"
                  "Template: %s\n"
                  "Match Score: %.4f (threshold: %.2f)\n"
                  "Match Position: (%d, %d)\n"
                  "Detection Region: (%d,%d) %dx%d\n",
-                 s->saveLabel, matchedName, bestScore, s->matchThreshold,
-                 bestMx, bestMy,
-                 s->kfX, s->kfY, s->kfW, s->kfH);
-
-        free(s->triggerBmp);
-        s->triggerBmp = work.bgra;  /* Take ownership */
-        work.bgra = NULL;
-        s->triggerBmpW = work.w;
-        s->triggerBmpH = work.h;
-        s->triggerBmpStride = work.bgraStride;
+                 region->saveLabel, region->name, matchedName, matchScore, region->threshold,
+                 bestMx[hit], bestMy[hit],
+                 region->x, region->y, region->w, region->h);
+
+        /* Promote the scan's BGRA to the snapshot; the buffer takes the old
+         * snapshot's memory (same size) or reallocates when next filled */
+        if (buf) {
+            BYTE* previous = s->triggerBmp;
+            s->triggerBmp = buf->bgra;
+            buf->bgra = previous;
+        } else {
+            SAFE_FREE(s->triggerBmp);
+        }
+        s->triggerBmpOffset = region->pixelOffset * 4;
+        s->triggerBmpW = region->w;
+        s->triggerBmpH = region->h;
+        s->triggerBmpStride = region->w * 4;
         s->triggerPending = TRUE;
         LeaveCriticalSection(&s->triggerLock);
 
         /* PostMessage with heap-allocated game name (overlay frees) */
         if (s->overlayWnd) {
-            size_t len = strlen(s->saveLabel) + 1;
+            size_t len = strlen(region->saveLabel) + 1;
             char* nameCopy = (char*)malloc(len);
             if (nameCopy) {
-                memcpy(nameCopy, s->saveLabel, len);
+                memcpy(nameCopy, region->saveLabel, len);
                 PostMessage(s->overlayWnd, WM_AUTOCLIP_SAVE, 0, (LPARAM)nameCopy);
             }
         }
-
-        free(work.bgra);
     }
 
 worker_exit:
     return 0;
 }
 
+/* ─── Region setup ─── */
+
+/* Monitor-relative percentages to capture-texture coordinates, clamped to
+ * the capture. FALSE if no part of the rect is captured. */
+static BOOL ResolveRegion(const KillFeedSampler* s, int monW, int monH,
+                          int captureWidth, int captureHeight,
+                          float rx, float ry, float rw, float rh, DetectRegion* out)
+{
+    out->x = (int)(rx * monW) - s->cropX;
+    out->y = (int)(ry * monH) - s->cropY;
+    out->w = (int)(rw * monW);
+    out->h = (int)(rh * monH);
+
+    /* Clamp to capture bounds */
+    if (out->x < 0) { out->w += out->x; out->x = 0; }
+    if (out->y < 0) { out->h += out->y; out->y = 0; }
+    if (out->x + out->w > captureWidth)  out->w = captureWidth - out->x;
+    if (out->y + out->h > captureHeight) out->h = captureHeight - out->y;
+    return out->w > 0 && out->h > 0;
+}
+
+/* Look up <exeDir>static\<subdir>\<name>.png for each name in the template
+ * cache (loading on first use). Returns the number found. */
+static int LoadRegionTemplates(DetectRegion* region, const char* exeDir, const char* subdir,
+                               char (*names)[GAME_PROFILE_TEMPLATE_LEN], int count)
+{
+    int loadCap = count < MAX_TEMPLATES ? count : MAX_TEMPLATES;
+    for (int i = 0; i < loadCap; i++) {
+        char pngPath[MAX_PATH];
+        snprintf(pngPath, MAX_PATH, "%sstatic\\%s\\%s.png", exeDir, subdir, names[i]);
+        const Template* t = AcquireTemplate(pngPath, names[i]);
+        if (t)
+            region->templates[region->templateCount++] = t;
+        else
+            Logger_Log("KillFeedSampler: WARNING - template not found: %s\n", pngPath);
+    }
+    return region->templateCount;
+}
+
 /* ─── Public API ─── */
 
 KillFeedSampler* KillFeedSampler_Init(GameProfile* profile, const CaptureState* capture,
@@ -668,92 +1142,119 @@ KillFeedSampler* KillFeedSampler_Init(GameProfile* profile, const CaptureState*
     int captureHeight = capture->captureHeight;
     if (captureWidth <= 0 || captureHeight <= 0) return NULL;
 
+    char exeDir[MAX_PATH];
+    DWORD gmfn = GetModuleFileNameA(NULL, exeDir, MAX_PATH);
+    if (gmfn == 0 || gmfn >= MAX_PATH) {
+        Logger_Log("KillFeedSampler: GetModuleFileNameA failed/truncated (ret=%lu err=%lu)\n",
+                   gmfn, GetLastError());
+        return NULL;
+    }
+    char* slash = strrchr(exeDir, '\\');
+    if (slash) *(slash + 1) = '\0';
+    const char* subdir = profile->templatesDir[0] ? profile->templatesDir : profile->id;
+
     KillFeedSampler* s = (KillFeedSampler*)calloc(1, sizeof(KillFeedSampler));
     if (!s) return NULL;
 
     s->bestScoreWindow = -1.0f;
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+        s->heartbeatBase[c] = Metrics_GetCounter((MetricCounter)c);
+    }
     s->profile = profile;
-    s->matchThreshold = profile->templateThreshold;
     s->cooldownMs = (DWORD)(GameProfile_GetActiveCooldownSec(profile) * 1000);
-    strncpy(s->saveLabel, profile->saveLabel, sizeof(s->saveLabel) - 1);
-    s->saveLabel[sizeof(s->saveLabel) - 1] = '\0';
 
-    /* Resolve detection region */
+    /* Resolve detection regions */
     int monW = capture->monitorWidth;
     int monH = capture->monitorHeight;
-    int cropX = capture->captureRect.left;
-    int cropY = capture->captureRect.top;
+    s->cropX = capture->captureRect.left;
+    s->cropY = capture->captureRect.top;
 
     if (monW <= 0 || monH <= 0) {
         monW = captureWidth;
         monH = captureHeight;
-        cropX = 0;
-        cropY = 0;
+        s->cropX = 0;
+        s->cropY = 0;
     }
 
-    s->kfX = (int)(rx * monW) - cropX;
-    s->kfY = (int)(ry * monH) - cropY;
-    s->kfW = (int)(rw * monW);
-    s->kfH = (int)(rh * monH);
-    s->cropX = cropX;
-    s->cropY = cropY;
-
-    /* Clamp to capture bounds */
-    if (s->kfX < 0) { s->kfW += s->kfX; s->kfX = 0; }
-    if (s->kfY < 0) { s->kfH += s->kfY; s->kfY = 0; }
-    if (s->kfX + s->kfW > captureWidth)  s->kfW = captureWidth - s->kfX;
-    if (s->kfY + s->kfH > captureHeight) s->kfH = captureHeight - s->kfY;
-
-    if (s->kfW <= 0 || s->kfH <= 0) {
+    /* Region 0: the calibrated kill feed. Without it the sampler is off. */
+    DetectRegion* kf = &s->regions[0];
+    strncpy(kf->name, "KillFeed", sizeof(kf->name) - 1);
+    kf->threshold = profile->templateThreshold;
+    strncpy(kf->saveLabel, profile->saveLabel, sizeof(kf->saveLabel) - 1);
+    if (!ResolveRegion(s, monW, monH, captureWidth, captureHeight, rx, ry, rw, rh, kf)) {
         Logger_Log("KillFeedSampler: '%s' region outside capture area\n", profile->id);
         free(s);
         return NULL;
     }
-
-    /* Load templates from <exeDir>\static\<templatesDir>\<name>.png */
-    {
-        char exePath[MAX_PATH];
-        DWORD gmfn = GetModuleFileNameA(NULL, exePath, MAX_PATH);
-        if (gmfn == 0 || gmfn >= MAX_PATH) {
-            Logger_Log("KillFeedSampler: GetModuleFileNameA failed/truncated (ret=%lu err=%lu)\n",
-                       gmfn, GetLastError());
-            free(s);
-            return NULL;
+    if (LoadRegionTemplates(kf, exeDir, subdir, profile->templates, profile->templateCount) == 0) {
+        Logger_Log("KillFeedSampler: '%s' has no loadable templates - disabled\n", profile->id);
+        free(s);
+        return NULL;
+    }
+    s->regionCount = 1;
+
+    /* Extra detectors: skipped individually if unusable */
+    for (int i = 0; i < profile->extraRegionCount && s->regionCount < MAX_REGIONS; i++) {
+        GameProfileRegion* pr = &profile->extraRegions[i];
+        DetectRegion* region = &s->regions[s->regionCount];
+        memset(region, 0, sizeof(*region));
+        strncpy(region->name, pr->name, sizeof(region->name) - 1);
+        region->threshold = pr->templateThreshold;
+        strncpy(region->saveLabel, pr->saveLabel, sizeof(region->saveLabel) - 1);
+        if (!ResolveRegion(s, monW, monH, captureWidth, captureHeight,
+                           pr->xPct, pr->yPct, pr->wPct, pr->hPct, region)) {
+            Logger_Log("KillFeedSampler: '%s' region %s outside capture area - skipped\n",
+                       profile->id, pr->name);
+            continue;
         }
-        char* slash = strrchr(exePath, '\\');
-        if (slash) *(slash + 1) = '\0';
-
-        const char* subdir = profile->templatesDir[0] ? profile->templatesDir : profile->id;
-        int loadCap = profile->templateCount < MAX_TEMPLATES ? profile->templateCount : MAX_TEMPLATES;
-        for (int i = 0; i < loadCap; i++) {
-            char pngPath[MAX_PATH];
-            snprintf(pngPath, MAX_PATH, "%sstatic\\%s\\%s.png",
-                     exePath, subdir, profile->templates[i]);
-            if (LoadTemplatePNG(&s->templates[s->templateCount], pngPath, profile->templates[i]))
-                s->templateCount++;
-            else
-                Logger_Log("KillFeedSampler: WARNING - template not found: %s\n", pngPath);
+        if (LoadRegionTemplates(region, exeDir, subdir, pr->templates, pr->templateCount) == 0) {
+            Logger_Log("KillFeedSampler: '%s' region %s has no loadable templates - skipped\n",
+                       profile->id, pr->name);
+            continue;
         }
+        s->regionCount++;
     }
 
-    if (s->templateCount == 0) {
-        Logger_Log("KillFeedSampler: '%s' has no loadable templates - disabled\n", profile->id);
-        free(s);
-        return NULL;
+    /* Readback atlas: regions stacked top to bottom at x = 0. Scan buffers
+     * hold them packed in the same order. */
+    for (int i = 0; i < s->regionCount; i++) {
+        DetectRegion* region = &s->regions[i];
+        region->atlasY = s->atlasH;
+        region->pixelOffset = s->pixelCount;
+        s->atlasH += region->h;
+        if (region->w > s->atlasW) s->atlasW = region->w;
+        s->pixelCount += (size_t)region->w * region->h;
     }
 
+    BuildScanItems(s);
+    CaptureReadback_Init(&s->readback, s->atlasW, s->atlasH);
+    if (g_config.gpuKillFeed) CreateGpuMatcher(s, capture);
+
     s->overlayWnd = overlayWnd;
     s->lastScanMs = 0;
+    s->scanIntervalMs = SCAN_MIN_INTERVAL_MS;
+    s->dirtyMask = (1u << s->regionCount) - 1;   /* First frame always scans */
     s->captureThreadId = 0;  /* Captured on first FeedFrame call */
 
     /*
      * MULTI-RESOURCE FUNCTION: KillFeedSampler_Init (sync setup)
-     * Resources: 5 - 2 CRITICAL_SECTIONs, 2 events, 1 worker thread
+     * Resources: 5 + scan buffers - 2 CRITICAL_SECTIONs, 2 events, 1 worker thread
      * Pattern: goto-cleanup with SAFE_*
      */
     BOOL workLockInit = FALSE;
     BOOL triggerLockInit = FALSE;
 
+    /* Scans allocate nothing after this */
+    s->scanningBuffer = -1;
+    for (int i = 0; i < SCAN_BUFFER_COUNT; i++) {
+        s->buffers[i].gray = (BYTE*)malloc(s->pixelCount);
+        s->buffers[i].bgra = (BYTE*)malloc(s->pixelCount * 4);
+        if (!s->buffers[i].gray || !s->buffers[i].bgra) {
+            Logger_Log("KillFeedSampler: Failed to allocate scan buffers\n");
+            goto init_fail;
+        }
+    }
+
     InitializeCriticalSection(&s->workLock);
     workLockInit = TRUE;
     InitializeCriticalSection(&s->triggerLock);
@@ -773,8 +1274,14 @@ KillFeedSampler* KillFeedSampler_Init(GameProfile* profile, const CaptureState*
     }
 
     Logger_Log("KillFeedSampler: Initialized for '%s', region (%d,%d) %dx%d, %d templates, threshold=%.2f, cooldown=%lums\n",
-               s->profile->id, s->kfX, s->kfY, s->kfW, s->kfH,
-               s->templateCount, s->matchThreshold, s->cooldownMs);
+               s->profile->id, kf->x, kf->y, kf->w, kf->h,
+               kf->templateCount, kf->threshold, s->cooldownMs);
+    for (int i = 1; i < s->regionCount; i++) {
+        const DetectRegion* region = &s->regions[i];
+        Logger_Log("KillFeedSampler:   + region %s (%d,%d) %dx%d, %d templates, threshold=%.2f, label '%s'\n",
+                   region->name, region->x, region->y, region->w, region->h,
+                   region->templateCount, region->threshold, region->saveLabel);
+    }
 
     return s;
 
@@ -783,7 +1290,11 @@ init_fail:
     SAFE_CLOSE_HANDLE(s->hStopEvent);
     if (workLockInit) DeleteCriticalSection(&s->workLock);
     if (triggerLockInit) DeleteCriticalSection(&s->triggerLock);
-    for (int i = 0; i < MAX_TEMPLATES; i++) SAFE_FREE(s->templates[i].gray);
+    for (int i = 0; i < SCAN_BUFFER_COUNT; i++) {
+        SAFE_FREE(s->buffers[i].gray);
+        SAFE_FREE(s->buffers[i].bgra);
+    }
+    GpuMatcher_Destroy(s->gpu);
     free(s);
     return NULL;
 }
@@ -804,71 +1315,73 @@ void KillFeedSampler_FeedFrame(KillFeedSampler* s, CaptureState* capture,
 
     /* Count raw producer invocations (before throttle) so the heartbeat can
      * discriminate worker-bottleneck vs producer-starvation. */
-    EnterCriticalSection(&s->workLock);
-    s->feedFrameCallsWindow++;
-    LeaveCriticalSection(&s->workLock);
+    Metrics_Increment(METRIC_KILLFEED_FEED_CALLS);
 
-    /* Throttle: only scan every SCAN_INTERVAL_MS */
     ULONGLONG now = GetTickCount64();
-    if ((now - s->lastScanMs) < SCAN_INTERVAL_MS) return;
-    s->lastScanMs = now;
+    if (s->gpu) {
+        if (FeedFrameGpu(s, capture, bgraTexture, now)) return;
+        DisableGpuMatcher(s);
+    }
 
-    /* Read back detection region from GPU (must happen on D3D11 thread) */
-    BYTE* buf = (BYTE*)malloc((size_t)s->kfW * s->kfH * 4);
-    if (!buf) return;
+    /* Collect regions copied on an earlier frame once the GPU is done with
+     * them: one pass per region packs the BGRA and converts it to gray,
+     * straight out of the mapped staging atlas into a reused scan buffer */
+    if (CaptureReadback_HasPending(&s->readback)) {
+        int index;
+        ScanBuffer* buf = AcquireFillBuffer(s, &index);
+        const BYTE* mapped = NULL;
+        int pitch = 0;
+        ULONGLONG tag = 0;
+        if (buf && CaptureReadback_Map(&s->readback, capture, &mapped, &pitch, &tag)) {
+            DWORD mask = (DWORD)(tag & ((1u << READBACK_TAG_MASK_BITS) - 1));
+            for (int i = 0; i < s->regionCount; i++) {
+                const DetectRegion* region = &s->regions[i];
+                if (!(mask & (1u << i))) continue;
+                for (int y = 0; y < region->h; y++) {
+                    size_t px = region->pixelOffset + (size_t)y * region->w;
+                    ConvertRegionRow(mapped + (size_t)(region->atlasY + y) * pitch,
+                                     buf->bgra + px * 4, buf->gray + px, region->w);
+                }
+            }
+            CaptureReadback_Unmap(&s->readback, capture);
 
-    int stride = 0;
-    BOOL ok = Capture_ReadbackRegion(capture, bgraTexture,
-                                     s->kfX, s->kfY, s->kfW, s->kfH,
-                                     buf, &stride);
-    if (!ok) {
-        EnterCriticalSection(&s->workLock);
-        s->readbackFails++;
-        s->readbackFailsTotal++;
-        BOOL shouldLog = DebugConsole_IsOpen() &&
-                         ((now - s->lastReadbackFailLogMs) >= SAMPLER_READBACK_LOG_MS);
-        if (shouldLog) s->lastReadbackFailLogMs = now;
-        unsigned int total = s->readbackFailsTotal;
-        LeaveCriticalSection(&s->workLock);
-        if (shouldLog)
-            Logger_Log("KillFeedSampler: Capture_ReadbackRegion failed (total=%u)\n", total);
-        free(buf);
-        return;
+            ScanWork work = {0};
+            work.buffer = index;
+            work.timestamp = tag >> READBACK_TAG_MASK_BITS;
+            work.regionMask = mask;
+            QueueWork(s, &work);
+        }
     }
 
-    /* Convert to grayscale on capture thread (fast, O(n)) */
-    BYTE* grayBuf = BgraToGray(buf, s->kfW, s->kfH, stride);
-    if (!grayBuf) {
-        free(buf);
-        return;
+    /* Change gate: nothing to do while the regions are unchanged */
+    if (!ScanDue(s, capture, now, SCAN_INTERVAL_MS)) return;
+    DWORD mask = ScanTaken(s, now, SCAN_INTERVAL_MS);
+
+    /* Copy the due regions out on the GPU in one batch (must happen on the
+     * D3D11 thread); it is mapped by a later FeedFrame, so this never
+     * waits on the GPU */
+    CaptureReadbackRect rects[MAX_REGIONS];
+    int rectCount = 0;
+    for (int i = 0; i < s->regionCount; i++) {
+        const DetectRegion* region = &s->regions[i];
+        if (!(mask & (1u << i))) continue;
+        rects[rectCount].srcX = region->x;
+        rects[rectCount].srcY = region->y;
+        rects[rectCount].dstX = 0;
+        rects[rectCount].dstY = region->atlasY;
+        rects[rectCount].width = region->w;
+        rects[rectCount].height = region->h;
+        rectCount++;
     }
-
-    /* Compact BGRA copy for worker (remove stride padding) */
-    BYTE* bgraCopy = (BYTE*)malloc((size_t)s->kfW * s->kfH * 4);
-    if (bgraCopy) {
-        for (int y = 0; y < s->kfH; y++) {
-            memcpy(bgraCopy + (size_t)y * s->kfW * 4,
-                   buf + (size_t)y * stride, (size_t)s->kfW * 4);
+    ULONGLONG tag = (now << READBACK_TAG_MASK_BITS) | mask;
+    if (!CaptureReadback_IssueBatch(&s->readback, capture, bgraTexture, rects, rectCount, tag)) {
+        Metrics_Increment(METRIC_KILLFEED_READBACK_FAILS);
+        if (DebugConsole_IsOpen() && (now - s->lastReadbackFailLogMs) >= SAMPLER_READBACK_LOG_MS) {
+            s->lastReadbackFailLogMs = now;
+            Logger_Log("KillFeedSampler: CaptureReadback_IssueBatch failed (total=%lld)\n",
+                       Metrics_GetCounter(METRIC_KILLFEED_READBACK_FAILS));
         }
     }
-    free(buf);
-
-    /* Queue work for the worker thread (replaces any stale pending work) */
-    EnterCriticalSection(&s->workLock);
-    /* Free any unconsumed previous work */
-    SAFE_FREE(s->pendingWork.gray);
-    SAFE_FREE(s->pendingWork.bgra);
-    s->pendingWork.gray = grayBuf;
-    s->pendingWork.bgra = bgraCopy;
-    s->pendingWork.w = s->kfW;
-    s->pendingWork.h = s->kfH;
-    s->pendingWork.bgraStride = s->kfW * 4;
-    s->pendingWork.timestamp = now;
-    s->hasPendingWork = TRUE;
-    s->feedFrameQueuedWindow++;
-    LeaveCriticalSection(&s->workLock);
-
-    SetEvent(s->hWorkReady);
 }
 
 BOOL KillFeedSampler_GetLastMatch(int* outX, int* outY, int* outW, int* outH, float* outScore)
@@ -876,9 +1389,10 @@ BOOL KillFeedSampler_GetLastMatch(int* outX, int* outY, int* outW, int* outH, fl
     BOOL ok = FALSE;
     AcquireSRWLockShared(&g_lastMatchLock);
     if (g_lastMatch.hasValue) {
-        /* Treat anything older than 3 scan intervals as stale (sampler stopped). */
+        /* An unchanged region is not rescanned, so a match stays current
+         * until the next forced scan; older than that means the sampler stopped. */
         ULONGLONG ageMs = GetTickCount64() - g_lastMatch.timestampMs;
-        if (ageMs <= (ULONGLONG)(SCAN_INTERVAL_MS * 3)) {
+        if (ageMs <= (ULONGLONG)(SCAN_FORCE_INTERVAL_MS + SCAN_INTERVAL_MS)) {
             if (outX)     *outX = g_lastMatch.x;
             if (outY)     *outY = g_lastMatch.y;
             if (outW)     *outW = g_lastMatch.w;
@@ -904,15 +1418,18 @@ void KillFeedSampler_Shutdown(KillFeedSampler* s)
     SAFE_CLOSE_HANDLE(s->hWorkReady);
     SAFE_CLOSE_HANDLE(s->hStopEvent);
 
-    /* Free any unconsumed work */
-    SAFE_FREE(s->pendingWork.gray);
-    SAFE_FREE(s->pendingWork.bgra);
+    for (int i = 0; i < SCAN_BUFFER_COUNT; i++) {
+        SAFE_FREE(s->buffers[i].gray);
+        SAFE_FREE(s->buffers[i].bgra);
+    }
 
     DeleteCriticalSection(&s->workLock);
     DeleteCriticalSection(&s->triggerLock);
 
-    for (int i = 0; i < MAX_TEMPLATES; i++)
-        SAFE_FREE(s->templates[i].gray);
+    GpuMatcher_Destroy(s->gpu);
+    CaptureReadback_Shutdown(&s->readback);
+    for (int i = 0; i < s->regionCount; i++) MatchImagePyramid_Free(&s->regions[i].matchImage);
+    for (int i = 0; i < SCAN_MAX_THREADS; i++) MatchScratch_Free(&s->scratch[i]);
     SAFE_FREE(s->triggerBmp);
     free(s);
 
@@ -970,7 +1487,8 @@ void KillFeedSampler_WriteTriggerContext(KillFeedSampler* s, const char* clipPat
             strncat(bmpPath, "_region.bmp", MAX_PATH - strlen(bmpPath) - 1);
         }
 
-        SaveBMP(bmpPath, s->triggerBmp, s->triggerBmpW, s->triggerBmpH, s->triggerBmpStride);
+        SaveBMP(bmpPath, s->triggerBmp + s->triggerBmpOffset,
+                s->triggerBmpW, s->triggerBmpH, s->triggerBmpStride);
     }
 
     s->triggerPending = FALSE;
@@ -982,3 +1500,16 @@ const GameProfile* KillFeedSampler_GetProfile(const KillFeedSampler* s)
 {
     return s ? s->profile : NULL;
 }
+
+void KillFeedSampler_FreeTemplateCache(void)
+{
+    AcquireSRWLockExclusive(&g_templateCacheLock);
+    for (int i = 0; i < g_templateCacheCount; i++) {
+        FreeTemplate(g_templateCache[i].tmpl);
+        free(g_templateCache[i].tmpl);
+    }
+    SAFE_FREE(g_templateCache);
+    g_templateCacheCount = 0;
+    g_templateCacheCap = 0;
+    ReleaseSRWLockExclusive(&g_templateCacheLock);
+}
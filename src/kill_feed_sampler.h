@@ -7,9 +7,10 @@
  * Scans a calibrated screen region for game-specific banner templates using
  * multi-scale NCC (Normalized Cross-Correlation). The active game and its
  * templates/region/threshold/cooldown come from a GameProfile selected by
- * the buffer thread based on the current foreground exe.
+ * the buffer thread based on the current foreground exe. Profiles may add
+ * further regions with their own templates; all are read back in one batch.
  *
- * On match: posts WM_AUTOCLIP_SAVE with the profile's SaveLabel.
+ * On match: posts WM_AUTOCLIP_SAVE with the matching region's SaveLabel.
  *
  * Foreground gating happens upstream in replay_buffer.c — when a sampler
  * exists, it is for the foreground game. This module no longer makes any
@@ -24,7 +25,9 @@
 typedef struct KillFeedSampler KillFeedSampler;
 
 /* Initialize a sampler bound to a GameProfile. Returns NULL if the profile
- * has no valid region, no templates load, or any resource fails. The sampler
+ * has no valid kill-feed region, none of its templates load, or any resource
+ * fails; unusable extra regions are skipped. Templates come from a process-
+ * wide cache, so only the first sampler to use one reads its PNG. The sampler
  * holds the profile pointer (for cooldown bookkeeping); the profile must
  * outlive the sampler (catalog lives for the process). */
 KillFeedSampler* KillFeedSampler_Init(GameProfile* profile, const CaptureState* capture,
@@ -40,7 +43,8 @@ void KillFeedSampler_WriteTriggerContext(KillFeedSampler* sampler, const char* c
 
 /* Last best NCC match from the most recent scan, in monitor-overlay coordinates
  * (compatible with the settings_dialog region-overlay window at (0,0,SM_CXSCREEN,SM_CYSCREEN)).
- * Returns TRUE only if a value was published within the last ~3s and score >= 0.50.
+ * Returns TRUE only if a value was published within the last ~7s (the forced rescan interval for an
+ * unchanged region, plus one scan) and score >= 0.50.
  * Safe to call from any thread; no sampler pointer needed (single-instance assumption). */
 BOOL KillFeedSampler_GetLastMatch(int* outX, int* outY, int* outW, int* outH, float* outScore);
 
@@ -50,4 +54,7 @@ const GameProfile* KillFeedSampler_GetProfile(const KillFeedSampler* sampler);
 /* Shutdown and free resources. */
 void KillFeedSampler_Shutdown(KillFeedSampler* sampler);
 
+/* Free the template cache. Call at app shutdown, after the last sampler. */
+void KillFeedSampler_FreeTemplateCache(void);
+
 #endif /* KILL_FEED_SAMPLER_H */
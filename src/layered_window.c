@@ -4,6 +4,10 @@
 
 #include "layered_window.h"
 
+#ifndef ULW_EX_NORESIZE
+#define ULW_EX_NORESIZE 0x00000008
+#endif
+
 BOOL LayeredBitmap_Create(LayeredBitmap* lb, int width, int height) {
     if (!lb || width <= 0 || height <= 0) return FALSE;
     
@@ -60,6 +64,79 @@ void LayeredBitmap_Apply(LayeredBitmap* lb, HWND hwnd, int x, int y) {
                         lb->memDC, &ptSrc, 0, &blend, ULW_ALPHA);
 }
 
+BOOL LayeredBitmap_Ensure(LayeredBitmap* lb, int width, int height) {
+    if (!lb) return FALSE;
+    if (lb->hBitmap && lb->width == width && lb->height == height) return TRUE;
+    
+    LayeredBitmap_Destroy(lb);
+    if (!LayeredBitmap_Create(lb, width, height)) return FALSE;
+    LayeredBitmap_Invalidate(lb, NULL);
+    return TRUE;
+}
+
+void LayeredBitmap_Invalidate(LayeredBitmap* lb, const RECT* rect) {
+    if (!lb || !lb->hBitmap) return;
+    
+    RECT bounds = {0, 0, lb->width, lb->height};
+    RECT clipped;
+    if (!rect) {
+        clipped = bounds;
+    } else if (!IntersectRect(&clipped, rect, &bounds)) {
+        return;
+    }
+    UnionRect(&lb->dirty, &lb->dirty, &clipped);
+}
+
+void LayeredBitmap_Present(LayeredBitmap* lb, HWND hwnd, int x, int y) {
+    if (!lb || !lb->hBitmap || !hwnd) return;
+    if (lb->presented && IsRectEmpty(&lb->dirty)) {
+        // Pixels unchanged: a move needs no upload
+        if (lb->origin.x != x || lb->origin.y != y) {
+            SetWindowPos(hwnd, NULL, x, y, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+            lb->origin = (POINT){x, y};
+        }
+        return;
+    }
+    
+    // Finish batched GDI drawing before the window (and later direct
+    // pixel writes) read the DIB
+    GdiFlush();
+    
+    POINT ptSrc = {0, 0};
+    POINT ptDst = {x, y};
+    SIZE sizeWnd = {lb->width, lb->height};
+    BLENDFUNCTION blend = {AC_SRC_OVER, 0, 255, AC_SRC_ALPHA};
+    
+    UPDATELAYEREDWINDOWINFO info = {0};
+    info.cbSize = sizeof(info);
+    info.hdcDst = lb->screenDC;
+    info.pptDst = &ptDst;
+    info.psize = &sizeWnd;
+    info.hdcSrc = lb->memDC;
+    info.pptSrc = &ptSrc;
+    info.pblend = &blend;
+    info.dwFlags = ULW_ALPHA;
+    
+    // Partial update only once the window holds a same-sized surface;
+    // NORESIZE makes a size mismatch fail instead of resizing, and then
+    // the whole surface goes out below
+    BOOL ok = FALSE;
+    if (lb->presented) {
+        info.dwFlags = ULW_ALPHA | ULW_EX_NORESIZE;
+        info.prcDirty = &lb->dirty;
+        ok = UpdateLayeredWindowIndirect(hwnd, &info);
+    }
+    if (!ok) {
+        info.dwFlags = ULW_ALPHA;
+        info.prcDirty = NULL;
+        ok = UpdateLayeredWindowIndirect(hwnd, &info);
+    }
+    
+    lb->presented = ok;
+    lb->origin = ptDst;
+    SetRectEmpty(&lb->dirty);
+}
+
 void LayeredBitmap_Destroy(LayeredBitmap* lb) {
     if (!lb) return;
     
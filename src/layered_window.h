@@ -1,5 +1,12 @@
 /*
  * layered_window.h - DIB + UpdateLayeredWindow helper for transparent overlays
+ *
+ * Two ways to use a LayeredBitmap:
+ *  - One-shot: Create, draw, Apply, Destroy (settings region preview).
+ *  - Retained: keep it for the window's lifetime, redraw only what changed,
+ *    mark it with Invalidate and Present. Present hands the window just the
+ *    dirty rectangle (ULW_EX_NORESIZE + prcDirty) and does nothing when no
+ *    pixels changed, so an idle overlay costs no CPU.
  */
 
 #ifndef LAYERED_WINDOW_H
@@ -26,6 +33,9 @@ typedef struct {
     BYTE* pixels;       // Direct pixel access (BGRA, top-down)
     int width;
     int height;
+    RECT dirty;         // Retained use: changed since the last Present
+    BOOL presented;     // Retained use: window already holds this surface
+    POINT origin;       // Retained use: window position at the last Present
 } LayeredBitmap;
 
 /*
@@ -41,6 +51,25 @@ BOOL LayeredBitmap_Create(LayeredBitmap* lb, int width, int height);
  */
 void LayeredBitmap_Apply(LayeredBitmap* lb, HWND hwnd, int x, int y);
 
+/*
+ * Retained use: make lb a width x height surface. Keeps the existing pixels
+ * if the size is unchanged; otherwise recreates it zeroed and fully dirty.
+ * Returns TRUE if the surface is usable.
+ */
+BOOL LayeredBitmap_Ensure(LayeredBitmap* lb, int width, int height);
+
+/*
+ * Mark a rectangle (surface coordinates) as changed; NULL marks all of it.
+ */
+void LayeredBitmap_Invalidate(LayeredBitmap* lb, const RECT* rect);
+
+/*
+ * Push the dirty region to the window at (x, y). The first Present after
+ * Ensure sends the whole surface; with nothing dirty it only moves the
+ * window if (x, y) changed.
+ */
+void LayeredBitmap_Present(LayeredBitmap* lb, HWND hwnd, int x, int y);
+
 /*
  * Release all GDI resources.
  */
@@ -6,36 +6,161 @@
 
 #include "leak_tracker.h"
 #include "logger.h"
+#include "constants.h"
 
-/* Global counter instance */
-LeakCounters g_leakCounters = {0};
+/* GetTickCount of the last report (counters live in the metrics registry) */
+static DWORD g_lastReportTime;
+
+/* ---------------------------------------------------------------------------
+ * Allocation profiler
+ * ------------------------------------------------------------------------- */
+
+/* Live bytes must be exact for the high-water mark, so unlike the counts
+ * they are one shared value per subsystem, each on its own cache line */
+typedef struct {
+    volatile LONG64 liveBytes;
+    volatile LONG64 peakBytes;
+    BYTE pad[CACHE_LINE_SIZE - 2 * sizeof(LONG64)];
+} SubsystemBytes;
+
+/* Counter values at the previous report, for rates (report thread only) */
+typedef struct {
+    LONGLONG allocs, frees, allocBytes, freeBytes;
+} SubsystemBaseline;
+
+static const LeakSubsystem g_siteSubsystem[LEAK_SITE_COUNT] = {
+    LEAK_SUBSYS_ENCODER,            /* NVENC_BITSTREAM */
+    LEAK_SUBSYS_VIDEO_BUFFER,       /* FRAME_HEAP */
+    LEAK_SUBSYS_VIDEO_BUFFER,       /* FRAME_ARENA */
+    LEAK_SUBSYS_VIDEO_BUFFER,       /* FRAME_INDEX */
+    LEAK_SUBSYS_AUDIO_BUFFER,       /* AUDIO_RING */
+    LEAK_SUBSYS_AUDIO_BUFFER,       /* PCM_RING */
+    LEAK_SUBSYS_SAVE,               /* SAVE_VIDEO_INDEX */
+    LEAK_SUBSYS_SAVE,               /* SAVE_AUDIO */
+    LEAK_SUBSYS_SAVE                /* SAVE_PCM */
+};
+
+static const char* const g_subsystemNames[LEAK_SUBSYS_COUNT] = {
+    "Encoder", "VideoBuffer", "AudioBuffer", "Save"
+};
+
+static const char* const g_siteNames[LEAK_SITE_COUNT] = {
+    "nvenc_bitstream", "frame_heap", "frame_arena_commit", "frame_index",
+    "audio_ring", "pcm_ring", "save_video_index", "save_audio", "save_pcm"
+};
+
+static SubsystemBytes g_subsysBytes[LEAK_SUBSYS_COUNT];
+static SubsystemBaseline g_subsysBaseline[LEAK_SUBSYS_COUNT];
+static DWORD g_lastProfileTime;
+
+/* The metrics enums hold four counters and two gauges per subsystem and one
+ * histogram per site, in enum order */
+#define SUBSYS_COUNTER(subsys, which) ((MetricCounter)(METRIC_MEM_ENCODER_ALLOCS + (subsys) * 4 + (which)))
+#define SUBSYS_GAUGE(subsys, which)   ((MetricGauge)(METRIC_GAUGE_MEM_ENCODER_LIVE + (subsys) * 2 + (which)))
+#define SITE_HISTOGRAM(site)          ((MetricHistogram)(METRIC_HIST_ALLOC_NVENC_BITSTREAM + (site)))
+
+void LeakTracker_RecordAlloc(LeakSite site, LONGLONG bytes) {
+    if ((unsigned)site >= LEAK_SITE_COUNT || bytes <= 0) return;
+    LeakSubsystem subsys = g_siteSubsystem[site];
+    SubsystemBytes* sb = &g_subsysBytes[subsys];
+    
+    Metrics_Increment(SUBSYS_COUNTER(subsys, 0));
+    Metrics_Add(SUBSYS_COUNTER(subsys, 2), bytes);
+    Metrics_Observe(SITE_HISTOGRAM(site), bytes);
+    
+    LONG64 live = InterlockedAdd64(&sb->liveBytes, bytes);
+    LONG64 peak = sb->peakBytes;
+    while (live > peak) {
+        LONG64 seen = InterlockedCompareExchange64(&sb->peakBytes, live, peak);
+        if (seen == peak) {
+            Metrics_SetGauge(SUBSYS_GAUGE(subsys, 1), live);
+            break;
+        }
+        peak = seen;
+    }
+    Metrics_SetGauge(SUBSYS_GAUGE(subsys, 0), live);
+}
+
+void LeakTracker_RecordFree(LeakSite site, LONGLONG bytes) {
+    if ((unsigned)site >= LEAK_SITE_COUNT || bytes <= 0) return;
+    LeakSubsystem subsys = g_siteSubsystem[site];
+    
+    Metrics_Increment(SUBSYS_COUNTER(subsys, 1));
+    Metrics_Add(SUBSYS_COUNTER(subsys, 3), bytes);
+    
+    LONG64 live = InterlockedAdd64(&g_subsysBytes[subsys].liveBytes, -bytes);
+    Metrics_SetGauge(SUBSYS_GAUGE(subsys, 0), live);
+}
+
+/* Per-subsystem table with rates since the last call, then one line per
+ * site that has allocated anything */
+static void LogAllocProfile(void) {
+    DWORD now = GetTickCount();
+    double seconds = (double)(now - g_lastProfileTime) / 1000.0;
+    if (seconds < 0.001) seconds = 0.001;
+    
+    Logger_Log("  --- Allocation profile (%.0fs since last report) ---\n", seconds);
+    for (int i = 0; i < LEAK_SUBSYS_COUNT; i++) {
+        SubsystemBaseline cur = {
+            Metrics_GetCounter(SUBSYS_COUNTER(i, 0)),
+            Metrics_GetCounter(SUBSYS_COUNTER(i, 1)),
+            Metrics_GetCounter(SUBSYS_COUNTER(i, 2)),
+            Metrics_GetCounter(SUBSYS_COUNTER(i, 3))
+        };
+        SubsystemBaseline* prev = &g_subsysBaseline[i];
+        Logger_Log("  %-12s live=%.2f MB, peak=%.2f MB, allocs=%lld (%.1f/s, %.2f MB/s), "
+                   "frees=%lld (%.1f/s, %.2f MB/s)\n",
+                   g_subsystemNames[i],
+                   (double)g_subsysBytes[i].liveBytes / (1024.0 * 1024.0),
+                   (double)g_subsysBytes[i].peakBytes / (1024.0 * 1024.0),
+                   cur.allocs, (double)(cur.allocs - prev->allocs) / seconds,
+                   (double)(cur.allocBytes - prev->allocBytes) / (1024.0 * 1024.0) / seconds,
+                   cur.frees, (double)(cur.frees - prev->frees) / seconds,
+                   (double)(cur.freeBytes - prev->freeBytes) / (1024.0 * 1024.0) / seconds);
+        *prev = cur;
+    }
+    
+    for (int s = 0; s < LEAK_SITE_COUNT; s++) {
+        MetricsHistogramStats stats;
+        if (!Metrics_GetHistogram(SITE_HISTOGRAM(s), &stats)) continue;
+        Logger_Log("  %-18s n=%lld, mean=%lld, min=%lld, p50<=%lld, p90<=%lld, p99<=%lld, max=%lld bytes\n",
+                   g_siteNames[s], stats.count, stats.sum / stats.count, stats.min,
+                   stats.p50, stats.p90, stats.p99, stats.max);
+    }
+    
+    g_lastProfileTime = now;
+}
 
 void LeakTracker_Init(void) {
-    ZeroMemory(&g_leakCounters, sizeof(g_leakCounters));
-    g_leakCounters.lastReportTime = GetTickCount();
+    g_lastReportTime = GetTickCount();
+    g_lastProfileTime = g_lastReportTime;
+    if (g_config.debugAllocProfile) {
+        Logger_Log("LeakTracker: allocation profiler enabled ([Debug] AllocProfile)\n");
+    }
 }
 
 void LeakTracker_LogStatusForced(void) {
     if (!g_config.debugLogging) return;
     
-    /* Read all counters (non-atomic reads are fine for logging) */
-    LONG nvencAlloc = g_leakCounters.nvencFrameAllocs;
-    LONG nvencFree = g_leakCounters.nvencFrameFrees;
-    LONG aacAlloc = g_leakCounters.aacSampleAllocs;
-    LONG aacFree = g_leakCounters.aacSampleFrees;
-    LONG fbAlloc = g_leakCounters.frameBufferAllocs;
-    LONG fbFree = g_leakCounters.frameBufferFrees;
+    /* Read all counters (a torn snapshot is fine for logging) */
+    LONGLONG nvencAlloc = Metrics_GetCounter(METRIC_LEAK_NVENC_FRAME_ALLOC);
+    LONGLONG nvencFree = Metrics_GetCounter(METRIC_LEAK_NVENC_FRAME_FREE);
+    LONGLONG aacAlloc = Metrics_GetCounter(METRIC_LEAK_AAC_SAMPLE_ALLOC);
+    LONGLONG aacFree = Metrics_GetCounter(METRIC_LEAK_AAC_SAMPLE_FREE);
+    LONGLONG fbAlloc = Metrics_GetCounter(METRIC_LEAK_FRAME_BUFFER_ALLOC);
+    LONGLONG fbFree = Metrics_GetCounter(METRIC_LEAK_FRAME_BUFFER_FREE);
     
     Logger_Log("=== LEAK TRACKER STATUS ===\n");
-    Logger_Log("  NVENC frames:    alloc=%ld, free=%ld, delta=%ld\n",
+    Logger_Log("  NVENC frames:    alloc=%lld, free=%lld, delta=%lld\n",
                nvencAlloc, nvencFree, nvencAlloc - nvencFree);
-    Logger_Log("  AAC samples:     alloc=%ld, free=%ld, delta=%ld\n",
+    Logger_Log("  AAC samples:     alloc=%lld, free=%lld, delta=%lld\n",
                aacAlloc, aacFree, aacAlloc - aacFree);
-    Logger_Log("  FrameBuffer:     alloc=%ld, free=%ld, delta=%ld\n",
+    Logger_Log("  FrameBuffer:     alloc=%lld, free=%lld, delta=%lld\n",
                fbAlloc, fbFree, fbAlloc - fbFree);
+    if (g_config.debugAllocProfile) LogAllocProfile();
     Logger_Log("===========================\n");
     
-    g_leakCounters.lastReportTime = GetTickCount();
+    g_lastReportTime = GetTickCount();
 }
 
 void LeakTracker_LogStatus(void) {
@@ -43,7 +168,7 @@ void LeakTracker_LogStatus(void) {
     
     /* Rate limit to avoid log spam */
     DWORD now = GetTickCount();
-    if (now - g_leakCounters.lastReportTime < LEAK_REPORT_INTERVAL_MS) {
+    if (now - g_lastReportTime < LEAK_REPORT_INTERVAL_MS) {
         return;
     }
     
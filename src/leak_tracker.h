@@ -18,84 +18,106 @@
  *   - aacSample: Encoded AAC audio samples
  *   - frameBuffer: Video frames stored in replay buffer
  * 
+ * ALLOCATION PROFILER ([Debug] AllocProfile=1 in lwsr_config.ini):
+ *   Byte accounting on top of the counters. Each instrumented allocation
+ *   site (LeakSite) belongs to one subsystem (LeakSubsystem); the tracker
+ *   keeps live bytes and the high-water mark per subsystem, counts allocs,
+ *   frees and bytes each way, and records every request size in a per-site
+ *   histogram. LeakTracker_LogStatus adds a table with rates since the
+ *   previous report. The flag is INI-only and read once at startup, so
+ *   every free seen was also seen as an alloc (debugLogging can be toggled
+ *   at runtime and would unbalance the live totals).
+ * 
  * THREAD SAFETY:
- *   All counters use InterlockedIncrement for thread-safe updates.
- *   Can be called from any thread without synchronization.
+ *   The counters are METRIC_LEAK_* in the metrics registry (metrics.h):
+ *   lock-free, callable from any thread, and also listed in its dumps.
+ *   The profiler's counts and histograms are METRIC_MEM_* / METRIC_HIST_ALLOC_*;
+ *   live bytes are one shared Interlocked value per subsystem (the peak needs
+ *   an exact total), mirrored into METRIC_GAUGE_MEM_* on every change.
  */
 
 #ifndef LEAK_TRACKER_H
 #define LEAK_TRACKER_H
 
 #include "main.h"        /* For extern AppConfig g_config declaration (includes windows.h) */
-
-/* ============================================================================
- * COUNTER STRUCTURE
- * ============================================================================
- * All counters are volatile LONG for use with Interlocked* functions.
- * Grouped by subsystem for easy interpretation.
- */
-
-typedef struct LeakCounters {
-    /* NVENC Video Encoder */
-    volatile LONG nvencFrameAllocs;     /* Frames allocated in output thread */
-    volatile LONG nvencFrameFrees;      /* Frames freed (callback took ownership or explicit free) */
-    
-    /* AAC Audio Encoder */
-    volatile LONG aacSampleAllocs;      /* AAC samples allocated */
-    volatile LONG aacSampleFrees;       /* AAC samples freed during eviction */
-    
-    /* Frame Buffer (Replay) */
-    volatile LONG frameBufferAllocs;    /* Frame data allocations */
-    volatile LONG frameBufferFrees;     /* Frame data frees (eviction/shutdown) */
-    
-    /* Timing for periodic reports */
-    DWORD lastReportTime;               /* GetTickCount of last report */
-} LeakCounters;
-
-/* Global counter instance - defined in leak_tracker.c */
-extern LeakCounters g_leakCounters;
+#include "metrics.h"
 
 /* ============================================================================
  * TRACKING MACROS
  * ============================================================================
  * These macros check g_config.debugLogging at runtime.
  * When disabled, cost is just a single predictable branch (~1ns).
- * When enabled, adds InterlockedIncrement (~10ns).
+ * When enabled, adds a Metrics_Increment (~10ns).
  * 
  * Note: g_config is declared extern in config.h which is included above.
  */
 
 #define LEAK_TRACK_NVENC_FRAME_ALLOC() \
-    do { if (g_config.debugLogging) InterlockedIncrement(&g_leakCounters.nvencFrameAllocs); } while(0)
+    do { if (g_config.debugLogging) Metrics_Increment(METRIC_LEAK_NVENC_FRAME_ALLOC); } while(0)
 
 #define LEAK_TRACK_NVENC_FRAME_FREE() \
-    do { if (g_config.debugLogging) InterlockedIncrement(&g_leakCounters.nvencFrameFrees); } while(0)
+    do { if (g_config.debugLogging) Metrics_Increment(METRIC_LEAK_NVENC_FRAME_FREE); } while(0)
 
 #define LEAK_TRACK_AAC_SAMPLE_ALLOC() \
-    do { if (g_config.debugLogging) InterlockedIncrement(&g_leakCounters.aacSampleAllocs); } while(0)
+    do { if (g_config.debugLogging) Metrics_Increment(METRIC_LEAK_AAC_SAMPLE_ALLOC); } while(0)
 
 #define LEAK_TRACK_AAC_SAMPLE_FREE() \
-    do { if (g_config.debugLogging) InterlockedIncrement(&g_leakCounters.aacSampleFrees); } while(0)
+    do { if (g_config.debugLogging) Metrics_Increment(METRIC_LEAK_AAC_SAMPLE_FREE); } while(0)
 
 #define LEAK_TRACK_FRAME_BUFFER_ALLOC() \
-    do { if (g_config.debugLogging) InterlockedIncrement(&g_leakCounters.frameBufferAllocs); } while(0)
+    do { if (g_config.debugLogging) Metrics_Increment(METRIC_LEAK_FRAME_BUFFER_ALLOC); } while(0)
 
 #define LEAK_TRACK_FRAME_BUFFER_FREE() \
-    do { if (g_config.debugLogging) InterlockedIncrement(&g_leakCounters.frameBufferFrees); } while(0)
+    do { if (g_config.debugLogging) Metrics_Increment(METRIC_LEAK_FRAME_BUFFER_FREE); } while(0)
+
+/* ============================================================================
+ * ALLOCATION PROFILER
+ * ============================================================================ */
+
+typedef enum {
+    LEAK_SUBSYS_ENCODER = 0,        // NVENC output copies until the buffer or a recording takes them
+    LEAK_SUBSYS_VIDEO_BUFFER,       // FrameBuffer frames, arena commit and index arrays
+    LEAK_SUBSYS_AUDIO_BUFFER,       // AAC sample rings and PCM rings
+    LEAK_SUBSYS_SAVE,               // Copies a save job holds while it writes
+    LEAK_SUBSYS_COUNT
+} LeakSubsystem;
+
+typedef enum {
+    LEAK_SITE_NVENC_BITSTREAM = 0,  // ENCODER: per-frame bitstream copy
+    LEAK_SITE_FRAME_HEAP,           // VIDEO_BUFFER: frame owned by the heap-mode buffer
+    LEAK_SITE_FRAME_ARENA,          // VIDEO_BUFFER: arena commit / decommit
+    LEAK_SITE_FRAME_INDEX,          // VIDEO_BUFFER: frame and GOP index arrays
+    LEAK_SITE_AUDIO_RING,           // AUDIO_BUFFER: AAC ring descriptors and arena
+    LEAK_SITE_PCM_RING,             // AUDIO_BUFFER: PCM ring storage
+    LEAK_SITE_SAVE_VIDEO_INDEX,     // SAVE: snapshot sample descriptors
+    LEAK_SITE_SAVE_AUDIO,           // SAVE: AAC sample payload copies
+    LEAK_SITE_SAVE_PCM,             // SAVE: PCM window copies
+    LEAK_SITE_COUNT
+} LeakSite;
+
+// Account `bytes` (> 0; 0 is ignored) allocated or freed at a site. Any thread.
+void LeakTracker_RecordAlloc(LeakSite site, LONGLONG bytes);
+void LeakTracker_RecordFree(LeakSite site, LONGLONG bytes);
+
+#define LEAK_TRACK_BYTES_ALLOC(site, bytes) \
+    do { if (g_config.debugAllocProfile) LeakTracker_RecordAlloc((site), (LONGLONG)(bytes)); } while(0)
+
+#define LEAK_TRACK_BYTES_FREE(site, bytes) \
+    do { if (g_config.debugAllocProfile) LeakTracker_RecordFree((site), (LONGLONG)(bytes)); } while(0)
 
 /* ============================================================================
  * API FUNCTIONS
  * ============================================================================ */
 
 /**
- * Initialize leak tracking counters to zero.
- * Call once at application startup.
+ * Start the report interval (and log that the allocation profiler is on,
+ * if it is). Call once at application startup.
  */
 void LeakTracker_Init(void);
 
 /**
- * Log current counter status if tracking is enabled.
- * Rate-limited to once per LEAK_REPORT_INTERVAL_MS (default 60 seconds).
+ * Log current counter status if tracking is enabled, plus the allocation
+ * profiler table when [Debug] AllocProfile is set. Rate-limited to once per LEAK_REPORT_INTERVAL_MS (default 60 seconds).
  * Safe to call frequently - will no-op if interval hasn't elapsed.
  */
 void LeakTracker_LogStatus(void);
@@ -3,9 +3,21 @@
  *
  * Architecture:
  * - Lock-free ring buffer (power-of-two size) for producers across N threads
- * - Dedicated consumer thread drains the queue to disk
+ * - Dedicated consumer thread drains the queue to disk in batches
  * - Per-thread heartbeat slots for stall detection
  *
+ * Batching: the consumer appends drained entries to a LOG_BATCH_SIZE buffer
+ * and hands it to the OS with one WriteFile when it fills, every
+ * LOG_FLUSH_INTERVAL ms, on Logger_Flush, or right after a critical entry
+ * (which also gets FlushFileBuffers). Producers don't signal the consumer
+ * per entry; it wakes on the same interval and is only signalled early for
+ * critical entries or when the queue is half full.
+ *
+ * Binary format: producers store the format pointer and the raw arguments
+ * (EncodeArgs) instead of calling vsnprintf; the consumer writes each
+ * format string once and then records that refer to it by id.
+ * tools\log_decode.c turns the file back into text (Logger_FormatRecord).
+ *
  * ERROR HANDLING PATTERN:
  * - Early return for simple validation checks
  * - No HRESULT usage - pure Win32 APIs
@@ -21,6 +33,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <wchar.h>
 #include <assert.h>
 
 // ============================================================================
@@ -29,7 +42,11 @@
 
 #define LOG_QUEUE_SIZE      4096    // Max pending log entries (must be power of two)
 #define LOG_QUEUE_MASK      (LOG_QUEUE_SIZE - 1)
-#define LOG_ENTRY_SIZE      512     // Max chars per log entry
+#define LOG_ENTRY_SIZE      512     // Max chars (text) or argument bytes (binary) per entry
+#define LOG_BATCH_SIZE      (64 * 1024)  // Consumer's write buffer
+#define LOG_FLUSH_INTERVAL  200     // Max ms an entry waits in the batch; also the consumer's wake period
+#define LOG_WAKE_DEPTH      (LOG_QUEUE_SIZE / 2)  // Queue depth at which producers wake the consumer
+#define LOG_FORMAT_SLOTS    1024    // Distinct format strings per binary log (power of two)
 #define HEARTBEAT_INTERVAL  5000    // Log heartbeat status every 5 seconds
 #define STALL_THRESHOLD     10000   // Consider thread stalled after 10 seconds
 
@@ -38,7 +55,10 @@
 // ============================================================================
 
 typedef struct {
-    char message[LOG_ENTRY_SIZE];
+    char message[LOG_ENTRY_SIZE]; // Text, or encoded arguments in binary mode
+    const char* format;           // Binary mode: the caller's format string
+    USHORT length;                // Binary mode: bytes of message used
+    BYTE critical;                // Write and flush as soon as it is drained
     ULONGLONG timestamp;          // GetTickCount64 value (64-bit to prevent overflow)
     volatile LONG ready;  // 0 = empty, 1 = filled
 } LogEntry;
@@ -58,6 +78,7 @@ static const char* const g_threadNames[THREAD_MAX] = {
     "BUFFER",
     "AUDIO_MIX",
     "AUDIO_SRC",
+    "AUDIO_ENC",
     "WATCHDOG"
 };
 
@@ -88,23 +109,30 @@ typedef struct LoggerState {
     /* Ring buffer indices (atomic) */
     volatile LONG writeIndex;       /* Next slot for producers [Any thread] */
     volatile LONG readIndex;        /* Next slot for consumer [Logger thread] */
-    
+    volatile LONG dropped;          /* Entries dropped on a full queue [Any thread] */
+
+    /* Logger_Flush handshake: callers take a ticket, the consumer publishes
+     * the last ticket whose entries it has written [Any thread / Logger thread] */
+    volatile LONG flushRequested;
+    volatile LONG flushCompleted;
+
     /* Thread management [Main thread] */
     HANDLE thread;                  /* Logger thread handle */
-    HANDLE event;                   /* Event to signal new entries */
-    
-    /* File output [Logger thread only] */
-    FILE* file;
-    
-    /* Timing [ReadOnly after init] */
+    HANDLE event;                   /* Event to wake the consumer early */
+
+    /* File output [Logger thread only after init] */
+    HANDLE file;
+
+    /* [ReadOnly after init] */
     ULONGLONG startTime;
-    
+    LogFormat format;
+
     /* Initialization flags (atomic) */
     volatile LONG running;
     volatile LONG initialized;
 } LoggerState;
 
-static LoggerState g_log = {0};
+static LoggerState g_log = { 0, 0, 0, 0, 0, NULL, NULL, INVALID_HANDLE_VALUE };
 
 /*
  * Ring buffer of pending log entries.
@@ -120,99 +148,610 @@ static LogEntry g_logQueue[LOG_QUEUE_SIZE];
  */
 static ThreadHeartbeat g_heartbeats[THREAD_MAX] = {0};
 
+/*
+ * Write batch and binary format-id table.
+ * Thread Access: [Logger thread only; Init before the thread starts]
+ * A format's id is its slot in g_formatSlots.
+ */
+static char g_batch[LOG_BATCH_SIZE];
+static size_t g_batchLength;
+static const char* g_formatSlots[LOG_FORMAT_SLOTS];
+
+/* ============================================================================
+ * BINARY ARGUMENT ENCODING
+ * ============================================================================
+ * EncodeArgs walks a printf format and stores each argument it consumes
+ * with a type tag; Logger_FormatRecord walks the same format and feeds each
+ * conversion back to snprintf. Only sizes matter on the encode side: 32-bit
+ * ints (int, long, short, char), 64-bit ints, doubles, pointers, strings.
+ */
+
+typedef struct {
+    BYTE* out;
+    size_t capacity;
+    size_t length;
+    BOOL full;          /* An argument did not fit; store nothing after it */
+} ArgWriter;
+
+static void PutArg(ArgWriter* w, BYTE tag, const void* value, size_t size) {
+    if (w->full) return;
+    if (w->length + 1 + size > w->capacity) {
+        w->full = TRUE;
+        return;
+    }
+    w->out[w->length++] = tag;
+    memcpy(w->out + w->length, value, size);
+    w->length += size;
+}
+
+/* Strings are truncated to what fits; charSize is 1 or sizeof(WCHAR) */
+static void PutString(ArgWriter* w, BYTE tag, const void* str, size_t chars, size_t charSize) {
+    if (w->full) return;
+    if (w->length + 3 > w->capacity) {
+        w->full = TRUE;
+        return;
+    }
+    size_t room = (w->capacity - w->length - 3) / charSize;
+    if (chars > room) {
+        chars = room;
+        w->full = TRUE;
+    }
+    USHORT count = (USHORT)chars;
+    w->out[w->length++] = tag;
+    memcpy(w->out + w->length, &count, sizeof(count));
+    w->length += sizeof(count);
+    memcpy(w->out + w->length, str, chars * charSize);
+    w->length += chars * charSize;
+}
+
+/* Length modifier of a conversion: argument size in bits (32 or 64), and
+ * whether it is 'l'/'w' (wide for %c / %s) */
+static const char* ParseLengthModifier(const char* p, int* bits, BOOL* wide) {
+    *bits = 32;
+    *wide = FALSE;
+    switch (*p) {
+        case 'h':
+            p++;
+            if (*p == 'h') p++;
+            break;
+        case 'l':
+            p++;
+            if (*p == 'l') {
+                p++;
+                *bits = 64;
+            } else {
+                *wide = TRUE;  // long is 32-bit on Windows
+            }
+            break;
+        case 'w':
+            p++;
+            *wide = TRUE;
+            break;
+        case 'L':
+            p++;
+            break;
+        case 'j':
+            p++;
+            *bits = 64;
+            break;
+        case 'z':
+        case 't':
+            p++;
+            *bits = (int)(sizeof(size_t) * 8);
+            break;
+        case 'I':
+            p++;
+            if (p[0] == '6' && p[1] == '4') {
+                p += 2;
+                *bits = 64;
+            } else if (p[0] == '3' && p[1] == '2') {
+                p += 2;
+            } else {
+                *bits = (int)(sizeof(size_t) * 8);
+            }
+            break;
+        default:
+            break;
+    }
+    return p;
+}
+
+static USHORT EncodeArgs(BYTE* out, size_t capacity, const char* fmt, va_list args) {
+    ArgWriter w = { out, capacity, 0, FALSE };
+    const char* p = fmt;
+
+    while (*p) {
+        if (*p++ != '%') continue;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        while (*p && strchr("-+ #0", *p)) p++;
+        if (*p == '*') {
+            int width = va_arg(args, int);
+            PutArg(&w, LOG_ARG_INT32, &width, sizeof(width));
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') p++;
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                int precision = va_arg(args, int);
+                PutArg(&w, LOG_ARG_INT32, &precision, sizeof(precision));
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') p++;
+        }
+        int bits;
+        BOOL wide;
+        p = ParseLengthModifier(p, &bits, &wide);
+
+        switch (*p) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+                if (bits == 64) {
+                    long long v = va_arg(args, long long);
+                    PutArg(&w, LOG_ARG_INT64, &v, sizeof(v));
+                } else {
+                    int v = va_arg(args, int);
+                    PutArg(&w, LOG_ARG_INT32, &v, sizeof(v));
+                }
+                break;
+            case 'c': case 'C': {
+                int v = va_arg(args, int);  // char and wint_t both promote to int
+                PutArg(&w, LOG_ARG_INT32, &v, sizeof(v));
+                break;
+            }
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+                double v = va_arg(args, double);
+                PutArg(&w, LOG_ARG_DOUBLE, &v, sizeof(v));
+                break;
+            }
+            case 's': case 'S':
+                if (wide || *p == 'S') {
+                    const wchar_t* str = va_arg(args, const wchar_t*);
+                    if (!str) str = L"(null)";
+                    PutString(&w, LOG_ARG_WSTRING, str, wcslen(str), sizeof(wchar_t));
+                } else {
+                    const char* str = va_arg(args, const char*);
+                    if (!str) str = "(null)";
+                    PutString(&w, LOG_ARG_STRING, str, strlen(str), 1);
+                }
+                break;
+            case 'p': {
+                ULONGLONG v = (ULONGLONG)(ULONG_PTR)va_arg(args, void*);
+                PutArg(&w, LOG_ARG_POINTER, &v, sizeof(v));
+                break;
+            }
+            case 'n':
+                (void)va_arg(args, void*);  // Never written through
+                break;
+            case '\0':
+                return (USHORT)w.length;
+            default:
+                break;
+        }
+        p++;
+    }
+    return (USHORT)w.length;
+}
+
+typedef struct {
+    BYTE tag;
+    long long i;            /* LOG_ARG_INT32 / INT64 / POINTER */
+    double d;               /* LOG_ARG_DOUBLE */
+    const BYTE* chars;      /* LOG_ARG_STRING / WSTRING */
+    USHORT count;
+} LogArg;
+
+static BOOL ReadArg(const BYTE* args, size_t argLength, size_t* pos, LogArg* arg) {
+    if (*pos >= argLength) return FALSE;
+    arg->tag = args[(*pos)++];
+    size_t left = argLength - *pos;
+    switch (arg->tag) {
+        case LOG_ARG_INT32: {
+            int v;
+            if (left < sizeof(v)) return FALSE;
+            memcpy(&v, args + *pos, sizeof(v));
+            *pos += sizeof(v);
+            arg->i = v;
+            return TRUE;
+        }
+        case LOG_ARG_INT64:
+        case LOG_ARG_POINTER:
+            if (left < sizeof(arg->i)) return FALSE;
+            memcpy(&arg->i, args + *pos, sizeof(arg->i));
+            *pos += sizeof(arg->i);
+            return TRUE;
+        case LOG_ARG_DOUBLE:
+            if (left < sizeof(arg->d)) return FALSE;
+            memcpy(&arg->d, args + *pos, sizeof(arg->d));
+            *pos += sizeof(arg->d);
+            return TRUE;
+        case LOG_ARG_STRING:
+        case LOG_ARG_WSTRING: {
+            size_t charSize = (arg->tag == LOG_ARG_WSTRING) ? sizeof(wchar_t) : 1;
+            if (left < sizeof(arg->count)) return FALSE;
+            memcpy(&arg->count, args + *pos, sizeof(arg->count));
+            *pos += sizeof(arg->count);
+            if (left - sizeof(arg->count) < arg->count * charSize) return FALSE;
+            arg->chars = args + *pos;
+            *pos += arg->count * charSize;
+            return TRUE;
+        }
+        default:
+            return FALSE;
+    }
+}
+
+size_t Logger_FormatRecord(const char* fmt, const BYTE* args, size_t argLength,
+                           char* out, size_t outSize) {
+    if (!out || outSize == 0) return 0;
+    out[0] = '\0';
+    if (!fmt) return 0;
+
+    size_t o = 0;
+    size_t pos = 0;
+    BOOL missing = FALSE;   /* Ran out of stored arguments */
+    const char* p = fmt;
+
+    while (*p && o + 1 < outSize) {
+        if (*p != '%') {
+            out[o++] = *p++;
+            continue;
+        }
+        const char* specStart = p++;
+        if (*p == '%') {
+            out[o++] = '%';
+            p++;
+            continue;
+        }
+
+        /* Rebuild the conversion with '*' resolved and the length modifier
+         * matching the stored argument */
+        char spec[48];
+        int s = 0;
+        LogArg arg;
+        spec[s++] = '%';
+        while (*p && strchr("-+ #0", *p)) {
+            if (s < 8) spec[s++] = *p;
+            p++;
+        }
+        if (*p == '*') {
+            p++;
+            if (!missing && ReadArg(args, argLength, &pos, &arg) && arg.tag == LOG_ARG_INT32) {
+                int width = (int)arg.i;
+                if (width < 0) {
+                    spec[s++] = '-';
+                    width = -width;
+                }
+                s += snprintf(spec + s, sizeof(spec) - s, "%d", width);
+            } else {
+                missing = TRUE;
+            }
+        }
+        while (*p >= '0' && *p <= '9') {
+            if (s < 24) spec[s++] = *p;
+            p++;
+        }
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                p++;
+                if (!missing && ReadArg(args, argLength, &pos, &arg) && arg.tag == LOG_ARG_INT32) {
+                    if (arg.i >= 0) s += snprintf(spec + s, sizeof(spec) - s, ".%d", (int)arg.i);
+                } else {
+                    missing = TRUE;
+                }
+            } else {
+                if (s < 36) spec[s++] = '.';
+                while (*p >= '0' && *p <= '9') {
+                    if (s < 36) spec[s++] = *p;
+                    p++;
+                }
+            }
+        }
+        int bits;
+        BOOL wide;
+        p = ParseLengthModifier(p, &bits, &wide);
+        char conversion = *p;
+        if (!conversion) break;
+        p++;
+        if (conversion == 'n') continue;
+
+        BOOL known = (strchr("diuoxXcCeEfFgGaAsSp", conversion) != NULL);
+        if (!known) {
+            /* Not a conversion we store: copy it through as written */
+            size_t len = (size_t)(p - specStart);
+            if (len > outSize - 1 - o) len = outSize - 1 - o;
+            memcpy(out + o, specStart, len);
+            o += len;
+            continue;
+        }
+        if (missing || !ReadArg(args, argLength, &pos, &arg)) {
+            missing = TRUE;
+            out[o++] = '?';
+            continue;
+        }
+
+        int n = -1;
+        size_t room = outSize - o;
+        switch (conversion) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+                if (arg.tag == LOG_ARG_INT64) {
+                    spec[s++] = 'l';
+                    spec[s++] = 'l';
+                    spec[s++] = conversion;
+                    spec[s] = '\0';
+                    n = snprintf(out + o, room, spec, arg.i);
+                } else if (arg.tag == LOG_ARG_INT32) {
+                    spec[s++] = conversion;
+                    spec[s] = '\0';
+                    n = snprintf(out + o, room, spec, (int)arg.i);
+                }
+                break;
+            case 'c': case 'C':
+                if (arg.tag == LOG_ARG_INT32) {
+                    spec[s++] = 'c';
+                    spec[s] = '\0';
+                    n = snprintf(out + o, room, spec, (int)arg.i);
+                }
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                if (arg.tag == LOG_ARG_DOUBLE) {
+                    spec[s++] = conversion;
+                    spec[s] = '\0';
+                    n = snprintf(out + o, room, spec, arg.d);
+                }
+                break;
+            case 's': case 'S':
+                if (arg.tag == LOG_ARG_STRING) {
+                    char text[LOG_ENTRY_SIZE];
+                    size_t count = (arg.count < sizeof(text)) ? arg.count : sizeof(text) - 1;
+                    memcpy(text, arg.chars, count);
+                    text[count] = '\0';
+                    spec[s++] = 's';
+                    spec[s] = '\0';
+                    n = snprintf(out + o, room, spec, text);
+                } else if (arg.tag == LOG_ARG_WSTRING) {
+                    wchar_t text[LOG_ENTRY_SIZE / sizeof(wchar_t)];
+                    size_t count = (arg.count < ARRAYSIZE(text)) ? arg.count : ARRAYSIZE(text) - 1;
+                    memcpy(text, arg.chars, count * sizeof(wchar_t));
+                    text[count] = L'\0';
+                    spec[s++] = 'l';
+                    spec[s++] = 's';
+                    spec[s] = '\0';
+                    n = snprintf(out + o, room, spec, text);
+                }
+                break;
+            case 'p':
+                if (arg.tag == LOG_ARG_POINTER) {
+                    spec[s++] = 'p';
+                    spec[s] = '\0';
+                    n = snprintf(out + o, room, spec, (void*)(ULONG_PTR)arg.i);
+                }
+                break;
+            default:
+                break;
+        }
+        if (n < 0) {
+            /* Stored type doesn't match the format: the record is not for
+             * this format string, stop trusting the rest */
+            missing = TRUE;
+            out[o++] = '?';
+            continue;
+        }
+        o += ((size_t)n < room) ? (size_t)n : room - 1;
+    }
+    out[o] = '\0';
+    return o;
+}
+
 /* ============================================================================
  * LOGGER THREAD
  * ============================================================================ */
 
+static void WriteBatch(BOOL toDisk) {
+    if (g_batchLength && g_log.file != INVALID_HANDLE_VALUE) {
+        DWORD written;
+        WriteFile(g_log.file, g_batch, (DWORD)g_batchLength, &written, NULL);
+    }
+    g_batchLength = 0;
+    if (toDisk && g_log.file != INVALID_HANDLE_VALUE) FlushFileBuffers(g_log.file);
+}
+
+static void BatchPut(const void* data, size_t size) {
+    if (g_batchLength + size > LOG_BATCH_SIZE) WriteBatch(FALSE);
+    if (size > LOG_BATCH_SIZE) return;  // Entries are far smaller; never happens
+    memcpy(g_batch + g_batchLength, data, size);
+    g_batchLength += size;
+}
+
+static int FormatTimestamp(char* out, size_t size, ULONGLONG timestamp) {
+    ULONGLONG relativeMs = timestamp - g_log.startTime;
+    return snprintf(out, size, "[%02llu:%02llu:%02llu.%03llu] ",
+                    (relativeMs / 3600000) % 24,
+                    (relativeMs / 60000) % 60,
+                    (relativeMs / 1000) % 60,
+                    relativeMs % 1000);
+}
+
+/* Append already-formatted text: as is in text mode, as a 'T' record in binary */
+static void BatchPutText(const char* text, size_t length) {
+    if (g_log.format == LOG_FORMAT_BINARY) {
+        BYTE record[3];
+        USHORT len = (USHORT)((length < 0xFFFF) ? length : 0xFFFF);
+        record[0] = LOG_RECORD_TEXT;
+        memcpy(record + 1, &len, sizeof(len));
+        BatchPut(record, sizeof(record));
+        length = len;
+    }
+    BatchPut(text, length);
+}
+
+/* Logger-thread lines (heartbeat block, exit notice), printf-style */
+static void WriteLine(const char* fmt, ...) {
+    char line[LOG_ENTRY_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(line)) n = (int)sizeof(line) - 1;
+    BatchPutText(line, (size_t)n);
+}
+
+/* Id of a binary entry's format, writing its 'F' record the first time.
+ * Returns -1 when the table is full. */
+static int FormatId(const char* fmt) {
+    ULONG_PTR hash = ((ULONG_PTR)fmt >> 3) * 2654435761u;
+    for (int probe = 0; probe < LOG_FORMAT_SLOTS; probe++) {
+        int slot = (int)((hash + probe) & (LOG_FORMAT_SLOTS - 1));
+        if (g_formatSlots[slot] == fmt) return slot;
+        if (g_formatSlots[slot]) continue;
+
+        g_formatSlots[slot] = fmt;
+        size_t length = strlen(fmt);
+        BYTE record[7];
+        UINT32 id = (UINT32)slot;
+        USHORT len = (USHORT)((length < 0xFFFF) ? length : 0xFFFF);
+        record[0] = LOG_RECORD_FORMAT;
+        memcpy(record + 1, &id, sizeof(id));
+        memcpy(record + 5, &len, sizeof(len));
+        BatchPut(record, sizeof(record));
+        BatchPut(fmt, len);
+        return slot;
+    }
+    return -1;
+}
+
+static void BatchPutEntry(const LogEntry* entry) {
+    char prefix[32];
+
+    if (g_log.format == LOG_FORMAT_BINARY) {
+        int id = FormatId(entry->format);
+        if (id >= 0) {
+            BYTE record[15];
+            ULONGLONG relativeMs = entry->timestamp - g_log.startTime;
+            UINT32 formatId = (UINT32)id;
+            record[0] = LOG_RECORD_MESSAGE;
+            memcpy(record + 1, &relativeMs, sizeof(relativeMs));
+            memcpy(record + 9, &formatId, sizeof(formatId));
+            memcpy(record + 13, &entry->length, sizeof(entry->length));
+            BatchPut(record, sizeof(record));
+            BatchPut(entry->message, entry->length);
+        } else {
+            /* Format table full: format here and store the line as text */
+            char line[LOG_ENTRY_SIZE + sizeof(prefix)];
+            int n = FormatTimestamp(line, sizeof(line), entry->timestamp);
+            n += (int)Logger_FormatRecord(entry->format, (const BYTE*)entry->message, entry->length,
+                                          line + n, sizeof(line) - n);
+            BatchPutText(line, (size_t)n);
+        }
+        return;
+    }
+
+    int n = FormatTimestamp(prefix, sizeof(prefix), entry->timestamp);
+    BatchPut(prefix, (size_t)n);
+    BatchPut(entry->message, strlen(entry->message));
+}
+
+static void WriteHeartbeatStatus(ULONGLONG now, LONG* droppedReported) {
+    char prefix[32];
+    FormatTimestamp(prefix, sizeof(prefix), now);
+    WriteLine("%s=== HEARTBEAT STATUS ===\n", prefix);
+
+    for (int i = 0; i < THREAD_MAX; i++) {
+        if (g_heartbeats[i].active) {
+            DWORD lastBeat = (DWORD)g_heartbeats[i].lastHeartbeat;
+            DWORD age = (DWORD)now - lastBeat;  // Safe: relative time within session
+            LONG count = g_heartbeats[i].beatCount;
+
+            const char* status = "OK";
+            if (age > STALL_THRESHOLD) {
+                status = "STALLED!";
+            } else if (age > STALL_THRESHOLD / 2) {
+                status = "SLOW";
+            }
+
+            WriteLine("  %-12s: beats=%6ld, last=%5lums ago [%s]\n",
+                      g_threadNames[i], (long)count, (unsigned long)age, status);
+        }
+    }
+
+    // Queue-full drops since Init, and since the previous status
+    LONG dropped = InterlockedCompareExchange(&g_log.dropped, 0, 0);
+    WriteLine("  %-12s: dropped=%ld (+%ld)%s\n", "LOGGER", (long)dropped,
+              (long)(dropped - *droppedReported), (dropped != *droppedReported) ? " [QUEUE FULL]" : "");
+    *droppedReported = dropped;
+    WriteLine("=========================\n");
+}
+
 static DWORD WINAPI LoggerThreadProc(LPVOID param) {
     (void)param;
-    
+
     ULONGLONG lastHeartbeatLog = GetTickCount64();
-    
+    ULONGLONG lastWrite = lastHeartbeatLog;
+    LONG droppedReported = 0;
+
     // Thread-safe loop condition - use atomic reads for cross-thread safety
     LONG readIdx, writeIdx;
-    while (InterlockedCompareExchange(&g_log.running, 0, 0) || 
-           ((readIdx = InterlockedCompareExchange(&g_log.readIndex, 0, 0)) != 
+    while (InterlockedCompareExchange(&g_log.running, 0, 0) ||
+           ((readIdx = InterlockedCompareExchange(&g_log.readIndex, 0, 0)) !=
             (writeIdx = InterlockedCompareExchange(&g_log.writeIndex, 0, 0)))) {
-        // Wait for new entries or timeout for heartbeat check
-        WaitForSingleObject(g_log.event, 1000);
-        
+        // Producers don't signal every entry: wake on the flush interval,
+        // or early for critical entries, a filling queue, Flush or Shutdown
+        WaitForSingleObject(g_log.event, LOG_FLUSH_INTERVAL);
+
+        // Entries queued before this ticket are drained below
+        LONG flushTicket = InterlockedCompareExchange(&g_log.flushRequested, 0, 0);
+        BOOL critical = FALSE;
+
         // Process all ready entries - use atomic reads
-        while ((readIdx = InterlockedCompareExchange(&g_log.readIndex, 0, 0)) != 
+        while ((readIdx = InterlockedCompareExchange(&g_log.readIndex, 0, 0)) !=
                (writeIdx = InterlockedCompareExchange(&g_log.writeIndex, 0, 0))) {
             LONG idx = (LONG)((ULONG)readIdx & LOG_QUEUE_MASK);
             LogEntry* entry = &g_logQueue[idx];
-            
+
             // Wait for entry to be ready (producer might still be writing)
             if (InterlockedCompareExchange(&entry->ready, 0, 0) == 0) {
                 // Not ready yet, break and wait
                 break;
             }
-            
-            // Write to file with timestamp
-            if (g_log.file) {
-                ULONGLONG relativeMs = entry->timestamp - g_log.startTime;
-                fprintf(g_log.file, "[%02llu:%02llu:%02llu.%03llu] %s",
-                        (relativeMs / 3600000) % 24,
-                        (relativeMs / 60000) % 60,
-                        (relativeMs / 1000) % 60,
-                        relativeMs % 1000,
-                        entry->message);
-                fflush(g_log.file);
-            }
-            
+
+            BatchPutEntry(entry);
+            if (entry->critical) critical = TRUE;
+
             // Mark entry as consumed
             InterlockedExchange(&entry->ready, 0);
             InterlockedIncrement(&g_log.readIndex);
         }
-        
+
         // Periodic heartbeat status (every HEARTBEAT_INTERVAL)
         ULONGLONG now = GetTickCount64();
         if (now - lastHeartbeatLog >= HEARTBEAT_INTERVAL) {
             lastHeartbeatLog = now;
-            
-            if (g_log.file) {
-                ULONGLONG relativeMs = now - g_log.startTime;
-                fprintf(g_log.file, "[%02llu:%02llu:%02llu.%03llu] === HEARTBEAT STATUS ===\n",
-                        (relativeMs / 3600000) % 24,
-                        (relativeMs / 60000) % 60,
-                        (relativeMs / 1000) % 60,
-                        relativeMs % 1000);
-                
-                for (int i = 0; i < THREAD_MAX; i++) {
-                    if (g_heartbeats[i].active) {
-                        DWORD lastBeat = (DWORD)g_heartbeats[i].lastHeartbeat;
-                        DWORD age = (DWORD)now - lastBeat;  // Safe: relative time within session
-                        LONG count = g_heartbeats[i].beatCount;
-                        
-                        const char* status = "OK";
-                        if (age > STALL_THRESHOLD) {
-                            status = "STALLED!";
-                        } else if (age > STALL_THRESHOLD / 2) {
-                            status = "SLOW";
-                        }
-                        
-                        fprintf(g_log.file, "  %-12s: beats=%6ld, last=%5lums ago [%s]\n",
-                                g_threadNames[i], (long)count, (unsigned long)age, status);
-                    }
-                }
-                fprintf(g_log.file, "=========================\n");
-                fflush(g_log.file);
-            }
+            WriteHeartbeatStatus(now, &droppedReported);
+        }
+
+        // One WriteFile for everything drained, unless it is too soon and
+        // nobody is waiting on it
+        BOOL flushWanted = (flushTicket != InterlockedCompareExchange(&g_log.flushCompleted, 0, 0));
+        if (!g_batchLength) {
+            lastWrite = now;
+        } else if (critical || flushWanted || now - lastWrite >= LOG_FLUSH_INTERVAL) {
+            WriteBatch(critical);
+            lastWrite = now;
         }
+        InterlockedExchange(&g_log.flushCompleted, flushTicket);
     }
-    
+
     // Final flush
-    if (g_log.file) {
-        ULONGLONG elapsed = GetTickCount64() - g_log.startTime;
-        fprintf(g_log.file, "[%02llu:%02llu:%02llu.%03llu] Logger thread exiting normally\n",
-                (elapsed / 3600000) % 24,
-                (elapsed / 60000) % 60,
-                (elapsed / 1000) % 60,
-                elapsed % 1000);
-        fflush(g_log.file);
-    }
-    
+    char prefix[32];
+    FormatTimestamp(prefix, sizeof(prefix), GetTickCount64());
+    WriteLine("%sLogger thread exiting normally (dropped=%ld)\n", prefix,
+              (long)InterlockedCompareExchange(&g_log.dropped, 0, 0));
+    WriteBatch(TRUE);
+
     return 0;
 }
 
@@ -220,66 +759,97 @@ static DWORD WINAPI LoggerThreadProc(LPVOID param) {
 // Public API
 // ============================================================================
 
+BOOL Logger_Init(const char* filename, const char* mode) {
+    return Logger_InitEx(filename, mode, LOG_FORMAT_TEXT);
+}
+
 /*
- * MULTI-RESOURCE FUNCTION: Logger_Init
+ * MULTI-RESOURCE FUNCTION: Logger_InitEx
  * Resources: 3 - log file, signal event, logger thread
  * Pattern: goto-cleanup with SAFE_*
  */
-BOOL Logger_Init(const char* filename, const char* mode) {
+BOOL Logger_InitEx(const char* filename, const char* mode, LogFormat format) {
     // Preconditions
     assert(filename != NULL && "Logger_Init: filename cannot be NULL");
     assert(mode != NULL && "Logger_Init: mode cannot be NULL");
-    
+
     if (!filename || !mode) return FALSE;
-    
+
     // Thread-safe check
     if (InterlockedCompareExchange(&g_log.initialized, 0, 0)) return TRUE; // Already initialized
-    
+
     BOOL success = FALSE;
-    
+    BOOL append = (mode[0] == 'a');
+
     // Initialize state up-front so failure paths leave a clean slate
     g_log.startTime = GetTickCount64();
+    g_log.format = format;
     InterlockedExchange(&g_log.writeIndex, 0);
     InterlockedExchange(&g_log.readIndex, 0);
+    InterlockedExchange(&g_log.dropped, 0);
+    InterlockedExchange(&g_log.flushRequested, 0);
+    InterlockedExchange(&g_log.flushCompleted, 0);
     memset(g_logQueue, 0, sizeof(g_logQueue));
     memset(g_heartbeats, 0, sizeof(g_heartbeats));
-    
-    // Resource 1: log file
-    g_log.file = fopen(filename, mode);
-    if (!g_log.file) goto cleanup;
-    
+    memset(g_formatSlots, 0, sizeof(g_formatSlots));
+    g_batchLength = 0;
+
+    // Resource 1: log file (readable while open, so it can be tailed)
+    g_log.file = CreateFileA(filename, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                             append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (g_log.file == INVALID_HANDLE_VALUE) goto cleanup;
+    if (append) SetFilePointer(g_log.file, 0, NULL, FILE_END);
+
+    if (format == LOG_FORMAT_BINARY) {
+        // Header only at the start of the file; appended sessions redefine
+        // their format ids with fresh 'F' records
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(g_log.file, &size) || size.QuadPart == 0) {
+            BYTE header[16];
+            UINT32 version = LOG_BINARY_VERSION;
+            UINT32 pointerBits = (UINT32)(sizeof(void*) * 8);
+            DWORD written;
+            memcpy(header, LOG_BINARY_MAGIC, 8);
+            memcpy(header + 8, &version, sizeof(version));
+            memcpy(header + 12, &pointerBits, sizeof(pointerBits));
+            if (!WriteFile(g_log.file, header, sizeof(header), &written, NULL)) goto cleanup;
+        }
+    }
+
     // Resource 2: signal event
     g_log.event = CreateEvent(NULL, FALSE, FALSE, NULL);
     if (!g_log.event) goto cleanup;
-    
+
     // Resource 3: logger thread (set running BEFORE creating so the thread sees TRUE)
     InterlockedExchange(&g_log.running, TRUE);
     g_log.thread = CreateThread(NULL, 0, LoggerThreadProc, NULL, 0, NULL);
     if (!g_log.thread) goto cleanup;
-    
+
     // Set high priority so logging doesn't get starved
     SetThreadPriority(g_log.thread, THREAD_PRIORITY_ABOVE_NORMAL);
-    
+
     InterlockedExchange(&g_log.initialized, TRUE);
     success = TRUE;
-    
+
     // Write header
     SYSTEMTIME st;
     GetLocalTime(&st);
     Logger_Log("=== LWSR Log Started %04d-%02d-%02d %02d:%02d:%02d ===\n",
                st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
-    Logger_Log("Logger thread started (async, queue=%d entries)\n", LOG_QUEUE_SIZE);
-    
+    Logger_Log("Logger thread started (async, queue=%d entries, %s, batch=%d KB every %d ms)\n",
+               LOG_QUEUE_SIZE, (format == LOG_FORMAT_BINARY) ? "binary" : "text",
+               LOG_BATCH_SIZE / 1024, LOG_FLUSH_INTERVAL);
+
     return TRUE;
-    
+
 cleanup:
     // Roll back in reverse acquisition order. `success` is FALSE here.
     InterlockedExchange(&g_log.running, FALSE);
     SAFE_CLOSE_HANDLE(g_log.thread);
     SAFE_CLOSE_HANDLE(g_log.event);
-    if (g_log.file) {
-        fclose(g_log.file);
-        g_log.file = NULL;
+    if (g_log.file != INVALID_HANDLE_VALUE) {
+        CloseHandle(g_log.file);
+        g_log.file = INVALID_HANDLE_VALUE;
     }
     g_log.startTime = 0;
     return success;
@@ -288,42 +858,39 @@ cleanup:
 void Logger_Shutdown(void) {
     // Thread-safe check
     if (!InterlockedCompareExchange(&g_log.initialized, 0, 0)) return;
-    
+
     Logger_Log("Logger shutting down...\n");
-    
+
     // Clear `initialized` FIRST so any new producer calls early-return before
     // they try to read g_log.event / g_logQueue. A brief sleep gives in-flight
     // producers that already passed the check time to finish their SetEvent
     // call before we close the handle.
     InterlockedExchange(&g_log.initialized, FALSE);
     Sleep(20);
-    
+
     // Signal thread to stop - atomic write
     InterlockedExchange(&g_log.running, FALSE);
     if (g_log.event) SetEvent(g_log.event);
-    
+
     // Wait for logger thread to finish (with timeout)
     if (g_log.thread) {
         WaitForSingleObject(g_log.thread, 5000);
         SAFE_CLOSE_HANDLE(g_log.thread);
     }
-    
+
     // Cleanup
     SAFE_CLOSE_HANDLE(g_log.event);
-    
-    if (g_log.file) {
-        fclose(g_log.file);
-        g_log.file = NULL;
+
+    if (g_log.file != INVALID_HANDLE_VALUE) {
+        CloseHandle(g_log.file);
+        g_log.file = INVALID_HANDLE_VALUE;
     }
 }
 
-void Logger_Log(const char* fmt, ...) {
-    // Preconditions - fmt must be non-null
-    assert(fmt != NULL && "Logger_Log: format string cannot be NULL");
-    
+static void LogV(BOOL critical, const char* fmt, va_list args) {
     // Thread-safe check
     if (!InterlockedCompareExchange(&g_log.initialized, 0, 0)) return;
-    
+
     // Check-then-claim: only advance writeIndex once we have confirmed there
     // is room. Using CAS keeps the producer lock-free while preserving the
     // ring-buffer invariant (write - read) <= LOG_QUEUE_SIZE. The previous
@@ -335,38 +902,69 @@ void Logger_Log(const char* fmt, ...) {
         curRead  = InterlockedCompareExchange(&g_log.readIndex, 0, 0);
         // Modular distance handles signed wrap correctly.
         if ((LONG)((ULONG)curWrite - (ULONG)curRead) >= LOG_QUEUE_SIZE) {
-            return;  // Queue full, drop message (better than blocking)
+            // Queue full, drop message (better than blocking); counted for
+            // the heartbeat status
+            InterlockedIncrement(&g_log.dropped);
+            return;
         }
         if (InterlockedCompareExchange(&g_log.writeIndex, curWrite + 1, curWrite) == curWrite) {
             break;  // We own slot at curWrite
         }
         // Lost the race to another producer; retry.
     }
-    
+
     LONG idx = (LONG)((ULONG)curWrite & LOG_QUEUE_MASK);
     LogEntry* entry = &g_logQueue[idx];
-    
-    // Format message
-    va_list args;
-    va_start(args, fmt);
-    vsnprintf(entry->message, LOG_ENTRY_SIZE - 1, fmt, args);
-    va_end(args);
-    entry->message[LOG_ENTRY_SIZE - 1] = '\0';
-    
+
+    if (g_log.format == LOG_FORMAT_BINARY) {
+        // Store the arguments; formatting happens in the decoder
+        entry->format = fmt;
+        entry->length = EncodeArgs((BYTE*)entry->message, LOG_ENTRY_SIZE, fmt, args);
+    } else {
+        entry->format = NULL;
+        vsnprintf(entry->message, LOG_ENTRY_SIZE - 1, fmt, args);
+        entry->message[LOG_ENTRY_SIZE - 1] = '\0';
+    }
+    entry->critical = (BYTE)(critical != FALSE);
+
     // Set timestamp and mark ready
     entry->timestamp = GetTickCount64();
     InterlockedExchange(&entry->ready, 1);
-    
-    // Signal logger thread
-    if (g_log.event) SetEvent(g_log.event);
+
+    // The consumer wakes every LOG_FLUSH_INTERVAL on its own; only wake it
+    // early when the entry must not wait or the queue is filling up
+    LONG depth = (LONG)((ULONG)curWrite + 1 - (ULONG)curRead);
+    if ((critical || depth >= LOG_WAKE_DEPTH) && g_log.event) SetEvent(g_log.event);
+}
+
+void Logger_Log(const char* fmt, ...) {
+    // Preconditions - fmt must be non-null
+    assert(fmt != NULL && "Logger_Log: format string cannot be NULL");
+
+    va_list args;
+    va_start(args, fmt);
+    LogV(FALSE, fmt, args);
+    va_end(args);
+}
+
+void Logger_LogCritical(const char* fmt, ...) {
+    assert(fmt != NULL && "Logger_LogCritical: format string cannot be NULL");
+
+    va_list args;
+    va_start(args, fmt);
+    LogV(TRUE, fmt, args);
+    va_end(args);
+
+    // Wait for the consumer to write it (it flushes critical entries to disk)
+    Logger_Flush();
 }
 
 void Logger_Heartbeat(ThreadId thread) {
     // Precondition: valid thread ID
     assert(thread >= 0 && thread < THREAD_MAX && "Logger_Heartbeat: invalid thread ID");
-    
+
     if (thread < 0 || thread >= THREAD_MAX) return;
-    
+
     // Truncate GetTickCount64() to 32 bits; modular subtraction at read time
     // keeps age comparisons correct across the DWORD wrap (see ThreadHeartbeat).
     DWORD now = (DWORD)GetTickCount64();
@@ -381,11 +979,12 @@ BOOL Logger_IsInitialized(void) {
 
 void Logger_Flush(void) {
     if (!InterlockedCompareExchange(&g_log.initialized, 0, 0)) return;
-    
-    // Wait for queue to drain (with timeout)
-    // Use atomic reads for cross-thread safety
-    for (int i = 0; i < 100 && 
-         InterlockedCompareExchange(&g_log.readIndex, 0, 0) != InterlockedCompareExchange(&g_log.writeIndex, 0, 0); 
+
+    // Take a ticket and wait (with timeout) until the consumer has drained
+    // and written everything queued before it
+    LONG ticket = InterlockedIncrement(&g_log.flushRequested);
+    for (int i = 0; i < 100 &&
+         (LONG)((ULONG)InterlockedCompareExchange(&g_log.flushCompleted, 0, 0) - (ULONG)ticket) < 0;
          i++) {
         SetEvent(g_log.event);
         Sleep(10);
@@ -394,7 +993,7 @@ void Logger_Flush(void) {
 
 void Logger_ResetHeartbeat(ThreadId thread) {
     if (thread < 0 || thread >= THREAD_MAX) return;
-    
+
     // Mark thread as inactive - HealthMonitor will return UINT_MAX for age
     // This prevents stale heartbeat data from old thread instance triggering false stalls
     InterlockedExchange(&g_heartbeats[thread].active, 0);
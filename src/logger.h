@@ -4,6 +4,10 @@
  * Features:
  * - Dedicated logging thread (won't crash with worker threads)
  * - Lock-free queue for non-blocking log submission
+ * - Batched writes: one WriteFile per batch, flushed on a timer or at once
+ *   for critical entries
+ * - Optional binary format (format pointer + raw arguments, formatted
+ *   offline by tools\log_decode.c)
  * - Automatic timestamps on all entries
  * - Thread heartbeat tracking with stall detection
  * - Survives worker thread crashes
@@ -20,21 +24,37 @@ typedef enum {
     THREAD_BUFFER,
     THREAD_AUDIO_MIX,
     THREAD_AUDIO_SRC,   // All source capture threads share this ID
+    THREAD_AUDIO_ENC,
     THREAD_WATCHDOG,
     THREAD_MAX
 } ThreadId;
 
+// On-disk format of the log file
+typedef enum {
+    LOG_FORMAT_TEXT = 0,    // Timestamped lines, formatted by the caller
+    LOG_FORMAT_BINARY       // Records of format + raw arguments (see below)
+} LogFormat;
+
 // Initialize the async logger (starts logging thread)
 // Returns TRUE on success, FALSE on failure (file open, thread creation, etc.)
+// mode is "w" (truncate) or "a" (append). Logger_Init writes text.
 BOOL Logger_Init(const char* filename, const char* mode);
+BOOL Logger_InitEx(const char* filename, const char* mode, LogFormat format);
 
 // Shutdown the logger (flushes queue, stops thread)
 void Logger_Shutdown(void);
 
 // Log a formatted message (printf-style) - NON-BLOCKING
 // Adds timestamp automatically
+// fmt must be a string literal (or otherwise live for the whole session):
+// the binary format stores the pointer and reads the text later.
 void Logger_Log(const char* fmt, ...);
 
+// Log at critical level: the entry is written and flushed to disk before
+// this returns (up to Logger_Flush's timeout). For asserts, hangs and other
+// messages that may be followed by a crash.
+void Logger_LogCritical(const char* fmt, ...);
+
 // Register a heartbeat from a thread
 // Call this periodically from each worker thread
 void Logger_Heartbeat(ThreadId thread);
@@ -49,4 +69,35 @@ void Logger_Flush(void);
 // This prevents stale heartbeat data from triggering false stall detection
 void Logger_ResetHeartbeat(ThreadId thread);
 
+// ----------------------------------------------------------------------------
+// Binary log layout (LOG_FORMAT_BINARY)
+// ----------------------------------------------------------------------------
+// Header: LOG_BINARY_MAGIC (8 bytes), UINT32 version, UINT32 pointer bits.
+// Then records, each a type byte followed by (little-endian, unaligned):
+//   'F'  UINT32 id, UINT16 length, format text     - defines id (may redefine)
+//   'M'  UINT64 ms since Init, UINT32 format id, UINT16 length, arguments
+//   'T'  UINT16 length, text                       - already formatted lines
+// Arguments are a tag byte each, then the value: LOG_ARG_INT32 (4 bytes),
+// LOG_ARG_INT64 / LOG_ARG_POINTER (8), LOG_ARG_DOUBLE (8), LOG_ARG_STRING
+// (UINT16 length + chars), LOG_ARG_WSTRING (UINT16 length in WCHARs + WCHARs).
+// '*' widths and precisions are LOG_ARG_INT32 in order. Arguments that did
+// not fit in an entry are missing from its end and decode as '?'.
+#define LOG_BINARY_MAGIC        "LWSRBLOG"
+#define LOG_BINARY_VERSION      1
+#define LOG_RECORD_FORMAT       'F'
+#define LOG_RECORD_MESSAGE      'M'
+#define LOG_RECORD_TEXT         'T'
+#define LOG_ARG_INT32           'i'
+#define LOG_ARG_INT64           'l'
+#define LOG_ARG_DOUBLE          'd'
+#define LOG_ARG_STRING          's'
+#define LOG_ARG_WSTRING         'w'
+#define LOG_ARG_POINTER         'p'
+
+// Format one 'M' record's arguments with its format string into out
+// (always NUL-terminated). Returns the characters written. Used by the
+// logger itself and by the decoder.
+size_t Logger_FormatRecord(const char* fmt, const BYTE* args, size_t argLength,
+                           char* out, size_t outSize);
+
 #endif // LOGGER_H
@@ -74,6 +74,12 @@
 #include "mem_utils.h"
 #include "debug_console.h"
 #include "game_profile.h"
+#include "kill_feed_sampler.h"
+#include "clip_edit.h"
+#include "soak_bench.h"
+#include "trace.h"
+#include "startup.h"
+#include "nvenc_encoder.h"
 
 #include "constants.h"
 
@@ -151,6 +157,62 @@ static HANDLE g_mutex = NULL;
  */
 static const char* const MUTEX_NAME = "LightweightScreenRecorderMutex";
 
+/* ============================================================================
+ * STARTUP STEPS
+ * ============================================================================
+ * Independent startup work, run concurrently by Startup_Run. Worker steps
+ * must not create windows or COM objects the main thread will use.
+ */
+
+enum {
+    STEP_GDIPLUS = 0,
+    STEP_CAPTURE,
+    STEP_CATALOG,
+    STEP_ENCODER,
+    STEP_OVERLAY,
+    STEP_COUNT
+};
+
+static BOOL StartupGdiplus(void* context) {
+    (void)context;
+    return GdiplusAPI_Init();
+}
+
+static BOOL StartupCapture(void* context) {
+    (void)context;
+    return Capture_Init(&g_capture);
+}
+
+// Load per-game auto-clip profiles (catalog reads bin/games/*.ini and
+// applies user overrides from [AutoClip.<id>] in lwsr_config.ini)
+static BOOL StartupCatalog(void* context) {
+    (void)context;
+    GameProfile_LoadCatalog();
+    return TRUE;
+}
+
+// Loads the NVENC runtime ahead of the first session. Best effort: a
+// failure here shows up again, and is reported, when the replay starts.
+static BOOL StartupEncoder(void* context) {
+    (void)context;
+    if (!NVENCEncoder_Prewarm()) {
+        Logger_Log("NVENC runtime not available at startup\n");
+    }
+    return TRUE;
+}
+
+static BOOL StartupOverlay(void* context) {
+    if (!Overlay_Create((HINSTANCE)context)) return FALSE;
+
+    // Register the AreaSelector window class so UpdateReplayPreview() can
+    // actually show the draggable region-preview overlay. Non-fatal if it fails;
+    // the preview just won't appear.
+    if (!AreaSelector_Init()) {
+        Logger_Log("AreaSelector_Init failed (GetLastError=%lu); region preview disabled\n", GetLastError());
+    }
+    return TRUE;
+}
+
 int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
                    _In_ LPSTR lpCmdLine, _In_ int nCmdShow) {
     (void)hPrevInstance;
@@ -169,7 +231,10 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     BOOL mutexOwned = FALSE;
     BOOL hotkeyReplayRegistered = FALSE;
     BOOL hotkeyMarkerRegistered = FALSE;
+    BOOL hotkeyContinuousRegistered = FALSE;
     BOOL watchdogStarted = FALSE;
+    BOOL benchMode = FALSE;
+    SoakBenchOptions benchOptions;
     int exitCode = 0;
     MSG msg = {0};
     DWORD msgCount = 0;
@@ -180,8 +245,28 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     CrashHandler_Init();
     crashHandlerInited = TRUE;
 
+    // ETW provider for pipeline stage events (no-op until a session enables it)
+    Trace_Init();
+
+    // --trim / --concat: edit saved clips and exit. Before the single-instance
+    // check so it works while the recorder is running.
+    if (ClipEdit_RunCommandLine(&exitCode)) {
+        goto cleanup;
+    }
+
+    // --bench: headless soak benchmark of the replay pipeline. Skips the
+    // single-instance check too; a running recorder skews the numbers, but
+    // that is the operator's call.
+    if (SoakBench_ParseCommandLine(&benchOptions)) {
+        if (!benchOptions.valid) {
+            exitCode = 1;
+            goto cleanup;
+        }
+        benchMode = TRUE;
+    }
+
     // Check for existing instance - enforce single-instance and exit if running
-    g_mutex = OpenMutexA(MUTEX_ALL_ACCESS, FALSE, MUTEX_NAME);
+    g_mutex = benchMode ? NULL : OpenMutexA(MUTEX_ALL_ACCESS, FALSE, MUTEX_NAME);
     if (g_mutex) {
         SAFE_CLOSE_HANDLE(g_mutex);
         exitCode = 0;
@@ -189,14 +274,16 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     }
 
     // Create mutex for this instance
-    g_mutex = CreateMutexA(NULL, TRUE, MUTEX_NAME);
-    if (!g_mutex || GetLastError() == ERROR_ALREADY_EXISTS) {
-        // Another instance won the race between OpenMutex and CreateMutex
-        SAFE_CLOSE_HANDLE(g_mutex);
-        exitCode = 0;
-        goto cleanup;
+    if (!benchMode) {
+        g_mutex = CreateMutexA(NULL, TRUE, MUTEX_NAME);
+        if (!g_mutex || GetLastError() == ERROR_ALREADY_EXISTS) {
+            // Another instance won the race between OpenMutex and CreateMutex
+            SAFE_CLOSE_HANDLE(g_mutex);
+            exitCode = 0;
+            goto cleanup;
+        }
+        mutexOwned = TRUE;
     }
-    mutexOwned = TRUE;
 
     // Initialize COM - STA for main thread (UI message pump).
     // Buffer thread uses MTA (COINIT_MULTITHREADED) separately.
@@ -225,53 +312,13 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     Config_Load(&g_config);
     configLoaded = TRUE;
 
-    // Load per-game auto-clip profiles (catalog reads bin/games/*.ini and
-    // applies user overrides from [AutoClip.<id>] in lwsr_config.ini)
-    GameProfile_LoadCatalog();
-
-    // Initialize leak tracker (runtime-controlled via config)
-    LeakTracker_Init();
-
-    // Initialize shared GDI+ (used by overlay and action_toolbar)
-    if (!GdiplusAPI_Init()) {
-        MessageBoxA(NULL, "Failed to initialize GDI+", "Error", MB_OK | MB_ICONERROR);
-        exitCode = 1;
-        goto cleanup;
-    }
-    gdiInited = TRUE;
-
-    // Initialize capture system
-    if (!Capture_Init(&g_capture)) {
-        MessageBoxA(NULL, "Failed to initialize screen capture", "Error", MB_OK | MB_ICONERROR);
-        exitCode = 1;
-        goto cleanup;
-    }
-    captureInited = TRUE;
-
-    // Create and show overlay
-    if (!Overlay_Create(hInstance)) {
-        MessageBoxA(NULL, "Failed to create overlay", "Error", MB_OK | MB_ICONERROR);
-        exitCode = 1;
-        goto cleanup;
-    }
-    overlayCreated = TRUE;
-
-    // Register the AreaSelector window class so UpdateReplayPreview() can
-    // actually show the draggable region-preview overlay. Non-fatal if it fails;
-    // the preview just won't appear.
-    if (!AreaSelector_Init()) {
-        Logger_Log("AreaSelector_Init failed (GetLastError=%lu); region preview disabled\n", GetLastError());
-    }
-
-    // Initialize replay buffer
-    ReplayBuffer_Init(&g_replayBuffer);
-    replayInited = TRUE;
-
     // Initialize logger only if debug logging is enabled in config
     if (g_config.debugLogging) {
         char exePath[MAX_PATH];
         char debugFolder[MAX_PATH];
         char logFilename[MAX_PATH];
+        LogFormat logFormat = g_config.debugLogBinary ? LOG_FORMAT_BINARY : LOG_FORMAT_TEXT;
+        const char* logExt = g_config.debugLogBinary ? "lwlog" : "txt";
 
         // Get exe directory and create Debug subfolder
         GetModuleFileNameA(NULL, exePath, MAX_PATH);
@@ -283,17 +330,68 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
             SYSTEMTIME st;
             GetLocalTime(&st);
-            snprintf(logFilename, sizeof(logFilename), "%s\\lwsr_log_%04d%02d%02d_%02d%02d%02d.txt",
-                    debugFolder, (int)st.wYear, (int)st.wMonth, (int)st.wDay, (int)st.wHour, (int)st.wMinute, (int)st.wSecond);
-            Logger_Init(logFilename, "w");
+            snprintf(logFilename, sizeof(logFilename), "%s\\lwsr_log_%04d%02d%02d_%02d%02d%02d.%s",
+                    debugFolder, (int)st.wYear, (int)st.wMonth, (int)st.wDay, (int)st.wHour, (int)st.wMinute, (int)st.wSecond, logExt);
+            Logger_InitEx(logFilename, "w", logFormat);
         } else {
             // Fallback: use current directory
-            Logger_Init("lwsr_log.txt", "w");
+            Logger_InitEx(g_config.debugLogBinary ? "lwsr_log.lwlog" : "lwsr_log.txt", "w", logFormat);
         }
         loggerInited = TRUE;
         Logger_Log("Debug logging enabled\n");
     }
 
+    // Initialize leak tracker (runtime-controlled via config)
+    LeakTracker_Init();
+
+    // The benchmark brings up capture and the replay buffer itself, with
+    // no windows, hotkeys or tray
+    if (benchMode) {
+        exitCode = SoakBench_Run(&benchOptions) ? 0 : 1;
+        goto cleanup;
+    }
+
+    // GDI+ (used by overlay and action_toolbar), capture, the game catalog
+    // and the NVENC runtime don't depend on each other, so they load side by
+    // side; the overlay window is created on this thread once its inputs are up
+    {
+        StartupStep steps[STEP_COUNT] = {0};
+        steps[STEP_GDIPLUS] = (StartupStep){ "gdiplus", StartupGdiplus, NULL, 0, FALSE };
+        steps[STEP_CAPTURE] = (StartupStep){ "capture", StartupCapture, NULL, 0, FALSE };
+        steps[STEP_CATALOG] = (StartupStep){ "game catalog", StartupCatalog, NULL, 0, FALSE };
+        steps[STEP_ENCODER] = (StartupStep){ "nvenc runtime", StartupEncoder, NULL, 0, FALSE };
+        steps[STEP_OVERLAY] = (StartupStep){ "overlay", StartupOverlay, hInstance,
+                                             (1u << STEP_GDIPLUS) | (1u << STEP_CAPTURE), TRUE };
+        Startup_Run(steps, STEP_COUNT);
+
+        gdiInited = (steps[STEP_GDIPLUS].state == STARTUP_STEP_OK);
+        captureInited = (steps[STEP_CAPTURE].state == STARTUP_STEP_OK);
+        overlayCreated = (steps[STEP_OVERLAY].state == STARTUP_STEP_OK);
+    }
+    if (!gdiInited) {
+        MessageBoxA(NULL, "Failed to initialize GDI+", "Error", MB_OK | MB_ICONERROR);
+        exitCode = 1;
+        goto cleanup;
+    }
+    if (!captureInited) {
+        MessageBoxA(NULL, "Failed to initialize screen capture", "Error", MB_OK | MB_ICONERROR);
+        exitCode = 1;
+        goto cleanup;
+    }
+    if (!overlayCreated) {
+        MessageBoxA(NULL, "Failed to create overlay", "Error", MB_OK | MB_ICONERROR);
+        exitCode = 1;
+        goto cleanup;
+    }
+
+    // Auto-clip follows the foreground game through a WinEvent hook on this
+    // thread; the replay loop only reads the published profile
+    GameProfile_StartForegroundTracking();
+
+    // Initialize replay buffer
+    ReplayBuffer_Init(&g_replayBuffer);
+    replayInited = TRUE;
+
     // Start replay buffer if enabled in config
     if (g_config.replayEnabled) {
         Logger_Log("Starting replay buffer (enabled in config)\n");
@@ -322,6 +420,14 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         if (!hotkeyReplayRegistered) {
             Logger_Log("  GetLastError: %lu\n", GetLastError());
         }
+        
+        // Optional hotkey that starts/stops a continuous save
+        if (g_config.continuousSaveKey != 0) {
+            hotkeyContinuousRegistered = RegisterHotKey(g_controlWnd, HOTKEY_CONTINUOUS_SAVE, 0,
+                                                        g_config.continuousSaveKey);
+            Logger_Log("RegisterHotKey(HOTKEY_CONTINUOUS_SAVE, key=0x%02X): %s\n",
+                       g_config.continuousSaveKey, hotkeyContinuousRegistered ? "SUCCESS" : "FAILED");
+        }
     } else {
         Logger_Log("Replay buffer disabled in config\n");
     }
@@ -376,6 +482,9 @@ cleanup:
     if (hotkeyMarkerRegistered) {
         UnregisterHotKey(g_controlWnd, HOTKEY_MARKER);
     }
+    if (hotkeyContinuousRegistered) {
+        UnregisterHotKey(g_controlWnd, HOTKEY_CONTINUOUS_SAVE);
+    }
 
     if (overlayCreated) {
         Overlay_Destroy();  // Must be before ReplayBuffer_Shutdown (stops recording first)
@@ -389,10 +498,12 @@ cleanup:
         Logger_Shutdown();
     }
 
-    if (configLoaded) {
+    // The benchmark overrides settings in memory only
+    if (configLoaded && !benchMode) {
         Config_Save(&g_config);
     }
 
+    KillFeedSampler_FreeTemplateCache();
     GameProfile_Shutdown();
 
     if (gdiInited) {
@@ -422,6 +533,8 @@ cleanup:
         SAFE_CLOSE_HANDLE(g_mutex);
     }
 
+    Trace_Shutdown();
+
     if (crashHandlerInited) {
         CrashHandler_Shutdown();
     }
@@ -0,0 +1,278 @@
+/*
+ * metrics.c - Lock-free metrics registry
+ *
+ * Every counter and histogram lives once per write slot (MetricsSlot); a
+ * write goes to the calling thread's slot with an Interlocked op that no
+ * other thread normally touches, so it stays in that core's cache. Reads
+ * walk all METRICS_SLOTS and sum. Gauges are a single shared value.
+ *
+ * Histogram minimums are stored as value + 1 so a zeroed slot means "no
+ * samples" without an init pass.
+ */
+
+#include "metrics.h"
+#include "constants.h"
+#include "logger.h"
+#include "debug_console.h"
+#include <stdio.h>
+#include <intrin.h>
+
+typedef struct {
+    volatile LONG64 buckets[METRICS_HISTOGRAM_BUCKETS];
+    volatile LONG64 sum;
+    volatile LONG64 minPlusOne;     /* Smallest value + 1, 0 = none yet */
+    volatile LONG64 max;
+} SlotHistogram;
+
+typedef struct {
+    volatile LONG64 counters[METRIC_COUNTER_COUNT];
+    SlotHistogram histograms[METRIC_HIST_COUNT];
+    BYTE pad[CACHE_LINE_SIZE];      /* Keeps the next slot off this one's last line */
+} MetricsSlot;
+
+static MetricsSlot g_slots[METRICS_SLOTS];
+static volatile LONG64 g_gauges[METRIC_GAUGE_COUNT];
+static volatile LONG64 g_lastSnapshotMs;
+
+static const char* const g_counterNames[METRIC_COUNTER_COUNT] = {
+    "replay.capture_null",
+    "replay.convert_null",
+    "replay.encode_fail",
+    "replay.frames_encoded",
+    "replay.frames_static",
+    "replay.frames_duplicated",
+    "replay.frames_skipped",
+    "killfeed.feed_calls",
+    "killfeed.feed_queued",
+    "killfeed.scans",
+    "killfeed.readback_fails",
+    "killfeed.below_threshold",
+    "killfeed.cooldown_rejects",
+    "leak.nvenc_frame_alloc",
+    "leak.nvenc_frame_free",
+    "leak.aac_sample_alloc",
+    "leak.aac_sample_free",
+    "leak.frame_buffer_alloc",
+    "leak.frame_buffer_free",
+    "mem.encoder.allocs",
+    "mem.encoder.frees",
+    "mem.encoder.alloc_bytes",
+    "mem.encoder.free_bytes",
+    "mem.video_buffer.allocs",
+    "mem.video_buffer.frees",
+    "mem.video_buffer.alloc_bytes",
+    "mem.video_buffer.free_bytes",
+    "mem.audio_buffer.allocs",
+    "mem.audio_buffer.frees",
+    "mem.audio_buffer.alloc_bytes",
+    "mem.audio_buffer.free_bytes",
+    "mem.save.allocs",
+    "mem.save.frees",
+    "mem.save.alloc_bytes",
+    "mem.save.free_bytes"
+};
+
+static const char* const g_gaugeNames[METRIC_GAUGE_COUNT] = {
+    "nvenc.last_frame_bytes",
+    "mem.encoder.live_bytes",
+    "mem.encoder.peak_bytes",
+    "mem.video_buffer.live_bytes",
+    "mem.video_buffer.peak_bytes",
+    "mem.audio_buffer.live_bytes",
+    "mem.audio_buffer.peak_bytes",
+    "mem.save.live_bytes",
+    "mem.save.peak_bytes"
+};
+
+static const char* const g_histogramNames[METRIC_HIST_COUNT] = {
+    "nvenc.frame_bytes",
+    "alloc.nvenc_bitstream",
+    "alloc.frame_heap",
+    "alloc.frame_arena_commit",
+    "alloc.frame_index",
+    "alloc.audio_ring",
+    "alloc.pcm_ring",
+    "alloc.save_video_index",
+    "alloc.save_audio",
+    "alloc.save_pcm"
+};
+
+static MetricsSlot* ThreadSlot(void) {
+    /* Thread ids are multiples of 4 */
+    return &g_slots[(GetCurrentThreadId() >> 2) & (METRICS_SLOTS - 1)];
+}
+
+static int BucketForValue(LONGLONG value) {
+    if (value <= 0) return 0;
+    unsigned long bit;
+    _BitScanReverse64(&bit, (unsigned __int64)value);
+    int bucket = (int)bit + 1;
+    return (bucket < METRICS_HISTOGRAM_BUCKETS) ? bucket : METRICS_HISTOGRAM_BUCKETS - 1;
+}
+
+// Upper bound of bucket i (last bucket is open-ended)
+static LONGLONG BucketBound(int i) {
+    return (i == 0) ? 0 : ((LONGLONG)1 << i) - 1;
+}
+
+void Metrics_Add(MetricCounter counter, LONGLONG n) {
+    if (counter < 0 || counter >= METRIC_COUNTER_COUNT) return;
+    InterlockedAdd64(&ThreadSlot()->counters[counter], n);
+}
+
+LONGLONG Metrics_GetCounter(MetricCounter counter) {
+    if (counter < 0 || counter >= METRIC_COUNTER_COUNT) return 0;
+    LONGLONG total = 0;
+    for (int i = 0; i < METRICS_SLOTS; i++) total += g_slots[i].counters[counter];
+    return total;
+}
+
+void Metrics_SetGauge(MetricGauge gauge, LONGLONG value) {
+    if (gauge < 0 || gauge >= METRIC_GAUGE_COUNT) return;
+    InterlockedExchange64(&g_gauges[gauge], value);
+}
+
+LONGLONG Metrics_GetGauge(MetricGauge gauge) {
+    if (gauge < 0 || gauge >= METRIC_GAUGE_COUNT) return 0;
+    return g_gauges[gauge];
+}
+
+void Metrics_Observe(MetricHistogram histogram, LONGLONG value) {
+    if (histogram < 0 || histogram >= METRIC_HIST_COUNT) return;
+    if (value < 0) value = 0;
+
+    SlotHistogram* h = &ThreadSlot()->histograms[histogram];
+    InterlockedIncrement64(&h->buckets[BucketForValue(value)]);
+    InterlockedAdd64(&h->sum, value);
+
+    LONG64 prev = h->max;
+    while (value > prev) {
+        LONG64 seen = InterlockedCompareExchange64(&h->max, value, prev);
+        if (seen == prev) break;
+        prev = seen;
+    }
+    LONG64 candidate = value + 1;
+    prev = h->minPlusOne;
+    while (prev == 0 || candidate < prev) {
+        LONG64 seen = InterlockedCompareExchange64(&h->minPlusOne, candidate, prev);
+        if (seen == prev) break;
+        prev = seen;
+    }
+}
+
+void Metrics_ResetHistogram(MetricHistogram histogram) {
+    if (histogram < 0 || histogram >= METRIC_HIST_COUNT) return;
+    for (int s = 0; s < METRICS_SLOTS; s++) {
+        SlotHistogram* h = &g_slots[s].histograms[histogram];
+        for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+            InterlockedExchange64(&h->buckets[i], 0);
+        }
+        InterlockedExchange64(&h->sum, 0);
+        InterlockedExchange64(&h->minPlusOne, 0);
+        InterlockedExchange64(&h->max, 0);
+    }
+}
+
+// Upper bound of the bucket holding the pct-th percentile sample
+static LONGLONG Percentile(const LONGLONG* counts, LONGLONG total, double pct, LONGLONG max) {
+    LONGLONG target = (LONGLONG)(pct * (double)total);
+    if (target < 1) target = 1;
+    LONGLONG cumulative = 0;
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS - 1; i++) {
+        cumulative += counts[i];
+        if (cumulative >= target) {
+            LONGLONG bound = BucketBound(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+BOOL Metrics_GetHistogram(MetricHistogram histogram, MetricsHistogramStats* stats) {
+    if (!stats) return FALSE;
+    ZeroMemory(stats, sizeof(*stats));
+    if (histogram < 0 || histogram >= METRIC_HIST_COUNT) return FALSE;
+
+    LONGLONG counts[METRICS_HISTOGRAM_BUCKETS] = {0};
+    LONGLONG minPlusOne = 0;
+    for (int s = 0; s < METRICS_SLOTS; s++) {
+        const SlotHistogram* h = &g_slots[s].histograms[histogram];
+        for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+            counts[i] += h->buckets[i];
+            stats->count += h->buckets[i];
+        }
+        stats->sum += h->sum;
+        if (h->max > stats->max) stats->max = h->max;
+        if (h->minPlusOne != 0 && (minPlusOne == 0 || h->minPlusOne < minPlusOne)) {
+            minPlusOne = h->minPlusOne;
+        }
+    }
+    if (stats->count == 0) return FALSE;
+
+    stats->min = (minPlusOne > 0) ? minPlusOne - 1 : 0;
+    stats->p50 = Percentile(counts, stats->count, 0.50, stats->max);
+    stats->p90 = Percentile(counts, stats->count, 0.90, stats->max);
+    stats->p99 = Percentile(counts, stats->count, 0.99, stats->max);
+    return TRUE;
+}
+
+static void Dump(const char* reason, BOOL toLog, BOOL toConsole) {
+    if (!toLog && !toConsole) return;
+
+    // Counters and gauges on one line as name=value, zeros left out
+    char line[1024];
+    int len = 0;
+    line[0] = '\0';
+    for (int c = 0; c < METRIC_COUNTER_COUNT && len < (int)sizeof(line); c++) {
+        LONGLONG value = Metrics_GetCounter((MetricCounter)c);
+        if (value == 0) continue;
+        int n = _snprintf_s(line + len, sizeof(line) - len, _TRUNCATE,
+                            " %s=%lld", g_counterNames[c], value);
+        if (n < 0) break;
+        len += n;
+    }
+    for (int g = 0; g < METRIC_GAUGE_COUNT && len < (int)sizeof(line); g++) {
+        LONGLONG value = g_gauges[g];
+        if (value == 0) continue;
+        int n = _snprintf_s(line + len, sizeof(line) - len, _TRUNCATE,
+                            " %s=%lld", g_gaugeNames[g], value);
+        if (n < 0) break;
+        len += n;
+    }
+
+    if (toLog) Logger_Log("Metrics (%s):%s\n", reason ? reason : "", len ? line : " (none)");
+    if (toConsole) DebugConsole_Print("METRICS (%s):%s\n", reason ? reason : "", len ? line : " (none)");
+
+    for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+        MetricsHistogramStats stats;
+        if (!Metrics_GetHistogram((MetricHistogram)h, &stats)) continue;
+        LONGLONG mean = stats.sum / stats.count;
+        if (toLog) {
+            Logger_Log("  %-20s n=%lld avg=%lld min=%lld p50<=%lld p90<=%lld p99<=%lld max=%lld\n",
+                       g_histogramNames[h], stats.count, mean, stats.min,
+                       stats.p50, stats.p90, stats.p99, stats.max);
+        }
+        if (toConsole) {
+            DebugConsole_Print("  %-20s n=%lld avg=%lld min=%lld p50<=%lld p90<=%lld p99<=%lld max=%lld\n",
+                               g_histogramNames[h], stats.count, mean, stats.min,
+                               stats.p50, stats.p90, stats.p99, stats.max);
+        }
+    }
+}
+
+void Metrics_Dump(const char* reason, BOOL toLog) {
+    Dump(reason, toLog, DebugConsole_IsOpen());
+}
+
+void Metrics_LogSnapshotIfDue(void) {
+    if (!Logger_IsInitialized()) return;
+
+    // One caller per interval wins the CAS and writes the snapshot
+    LONG64 now = (LONG64)GetTickCount64();
+    LONG64 last = g_lastSnapshotMs;
+    if (last != 0 && now - last < METRICS_SNAPSHOT_INTERVAL_MS) return;
+    if (InterlockedCompareExchange64(&g_lastSnapshotMs, now, last) != last) return;
+    if (last == 0) return;  // First call only starts the clock
+
+    Dump("periodic", TRUE, FALSE);  // The console gets the callers' own dumps
+}
@@ -0,0 +1,145 @@
+/*
+ * metrics.h - Process-wide diagnostic counters, gauges and histograms
+ *
+ * SHARED BY: replay_buffer.c, kill_feed_sampler.c, nvenc_encoder.c,
+ *            leak_tracker.h, leak_tracker.c
+ *
+ * One registry instead of per-subsystem counters behind their own locks.
+ * Metrics are fixed at compile time (the enums below, names in metrics.c).
+ *
+ *   Counter    monotonic total since process start; readers that want a
+ *              rate keep their own baseline and subtract
+ *   Gauge      last value written (single slot, last writer wins)
+ *   Histogram  power-of-two value buckets plus count, sum, min and max;
+ *              the owning loop may reset it when it starts
+ *
+ * Writes are lock-free and don't share cache lines between threads: each
+ * thread lands in one of METRICS_SLOTS padded slots (by thread id) and
+ * adds there with an uncontended Interlocked op. Reads sum every slot, so
+ * they cost more than writes and see a slightly torn snapshot while
+ * writers are active, which is fine for diagnostics.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <windows.h>
+
+typedef enum {
+    /* Replay capture loop */
+    METRIC_REPLAY_CAPTURE_NULL = 0,     // Capture_GetFrameTexture returned no texture
+    METRIC_REPLAY_CONVERT_NULL,         // GPUConverter_Convert failed
+    METRIC_REPLAY_ENCODE_FAIL,          // Transient NVENC submit failure (frame dropped)
+    METRIC_REPLAY_FRAMES_ENCODED,       // Frames submitted to NVENC (new, static and duplicate)
+    METRIC_REPLAY_FRAMES_STATIC,        // ...of which repeats of an unchanged capture region
+    METRIC_REPLAY_FRAMES_DUPLICATED,    // ...of which CFR gap fill after a late frame
+    METRIC_REPLAY_FRAMES_SKIPPED,       // CFR slots left empty (gap longer than the dup cap)
+
+    /* Kill-feed sampler */
+    METRIC_KILLFEED_FEED_CALLS,         // FeedFrame invocations (producer rate)
+    METRIC_KILLFEED_FEED_QUEUED,        // Scans handed to the worker
+    METRIC_KILLFEED_SCANS,              // Worker wake-ups with work
+    METRIC_KILLFEED_READBACK_FAILS,     // CaptureReadback_IssueBatch failures
+    METRIC_KILLFEED_BELOW_THRESHOLD,    // Scans whose best score missed the threshold
+    METRIC_KILLFEED_COOLDOWN_REJECTS,   // Matches dropped by the cooldown
+
+    /* Allocation balance (leak_tracker.h, only counted with debug logging) */
+    METRIC_LEAK_NVENC_FRAME_ALLOC,
+    METRIC_LEAK_NVENC_FRAME_FREE,
+    METRIC_LEAK_AAC_SAMPLE_ALLOC,
+    METRIC_LEAK_AAC_SAMPLE_FREE,
+    METRIC_LEAK_FRAME_BUFFER_ALLOC,
+    METRIC_LEAK_FRAME_BUFFER_FREE,
+
+    /* Allocation profiler (leak_tracker.h, only counted with [Debug] AllocProfile),
+       four per LeakSubsystem in its order: allocs, frees, bytes allocated, bytes freed */
+    METRIC_MEM_ENCODER_ALLOCS,
+    METRIC_MEM_ENCODER_FREES,
+    METRIC_MEM_ENCODER_ALLOC_BYTES,
+    METRIC_MEM_ENCODER_FREE_BYTES,
+    METRIC_MEM_VIDEO_BUFFER_ALLOCS,
+    METRIC_MEM_VIDEO_BUFFER_FREES,
+    METRIC_MEM_VIDEO_BUFFER_ALLOC_BYTES,
+    METRIC_MEM_VIDEO_BUFFER_FREE_BYTES,
+    METRIC_MEM_AUDIO_BUFFER_ALLOCS,
+    METRIC_MEM_AUDIO_BUFFER_FREES,
+    METRIC_MEM_AUDIO_BUFFER_ALLOC_BYTES,
+    METRIC_MEM_AUDIO_BUFFER_FREE_BYTES,
+    METRIC_MEM_SAVE_ALLOCS,
+    METRIC_MEM_SAVE_FREES,
+    METRIC_MEM_SAVE_ALLOC_BYTES,
+    METRIC_MEM_SAVE_FREE_BYTES,
+
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    METRIC_GAUGE_NVENC_LAST_FRAME_BYTES = 0,   // Size of the newest encoded frame
+
+    /* Allocation profiler: live and high-water bytes, two per LeakSubsystem */
+    METRIC_GAUGE_MEM_ENCODER_LIVE,
+    METRIC_GAUGE_MEM_ENCODER_PEAK,
+    METRIC_GAUGE_MEM_VIDEO_BUFFER_LIVE,
+    METRIC_GAUGE_MEM_VIDEO_BUFFER_PEAK,
+    METRIC_GAUGE_MEM_AUDIO_BUFFER_LIVE,
+    METRIC_GAUGE_MEM_AUDIO_BUFFER_PEAK,
+    METRIC_GAUGE_MEM_SAVE_LIVE,
+    METRIC_GAUGE_MEM_SAVE_PEAK,
+
+    METRIC_GAUGE_COUNT
+} MetricGauge;
+
+typedef enum {
+    METRIC_HIST_NVENC_FRAME_BYTES = 0,  // Encoded frame sizes (reset per replay run)
+
+    /* Allocation profiler: request sizes, one per LeakSite in its order */
+    METRIC_HIST_ALLOC_NVENC_BITSTREAM,
+    METRIC_HIST_ALLOC_FRAME_HEAP,
+    METRIC_HIST_ALLOC_FRAME_ARENA,
+    METRIC_HIST_ALLOC_FRAME_INDEX,
+    METRIC_HIST_ALLOC_AUDIO_RING,
+    METRIC_HIST_ALLOC_PCM_RING,
+    METRIC_HIST_ALLOC_SAVE_VIDEO_INDEX,
+    METRIC_HIST_ALLOC_SAVE_AUDIO,
+    METRIC_HIST_ALLOC_SAVE_PCM,
+
+    METRIC_HIST_COUNT
+} MetricHistogram;
+
+typedef struct {
+    LONGLONG count;
+    LONGLONG sum;
+    LONGLONG min, max;          // 0 when count is 0
+    LONGLONG p50, p90, p99;     // Bucket upper bounds, capped at max
+} MetricsHistogramStats;
+
+// Add n to a counter. Lock-free; callable from any thread.
+void Metrics_Add(MetricCounter counter, LONGLONG n);
+#define Metrics_Increment(counter) Metrics_Add((counter), 1)
+
+// Total of a counter across all threads
+LONGLONG Metrics_GetCounter(MetricCounter counter);
+
+void Metrics_SetGauge(MetricGauge gauge, LONGLONG value);
+LONGLONG Metrics_GetGauge(MetricGauge gauge);
+
+// Record one value (negative values count as 0). Lock-free; any thread.
+void Metrics_Observe(MetricHistogram histogram, LONGLONG value);
+
+// Clear a histogram. Call from its owning loop before it starts; samples
+// recorded concurrently with the reset may survive it.
+void Metrics_ResetHistogram(MetricHistogram histogram);
+
+// Aggregate a histogram. Returns FALSE (stats zeroed) if it has no samples.
+BOOL Metrics_GetHistogram(MetricHistogram histogram, MetricsHistogramStats* stats);
+
+// Print every non-zero counter and gauge and every histogram with samples.
+// toLog = TRUE also writes to the log file; the debug console gets it
+// whenever it is open.
+void Metrics_Dump(const char* reason, BOOL toLog);
+
+// Metrics_Dump to the log at most once per METRICS_SNAPSHOT_INTERVAL_MS.
+// Safe to call as often as convenient.
+void Metrics_LogSnapshotIfDue(void);
+
+#endif // METRICS_H
@@ -3,10 +3,12 @@
  * 
  * SHARED BY: replay_buffer.c (batch API), recording.c (streaming API)
  * 
- * Writes HEVC-encoded samples to MP4 using IMFSinkWriter passthrough.
+ * Writes HEVC- or AV1-encoded samples to MP4 using IMFSinkWriter passthrough.
  * Two modes:
  *   - Batch: MP4Muxer_WriteFile() - write all samples at once (replay saves)
  *   - Streaming: StreamingMuxer_*() - write frames as they arrive (recording)
+ *     With MuxerConfig.fragmented, streaming hands off to mp4_writer.c's
+ *     fragmented writer and no sink writer is created.
  *
  * ERROR HANDLING PATTERN:
  * - Goto-cleanup for functions with multiple resource allocations
@@ -18,6 +20,7 @@
  */
 
 #include "mp4_muxer.h"
+#include "mp4_writer.h"
 #include "util.h"
 #include "logger.h"
 #include "constants.h"
@@ -34,6 +37,13 @@
 static const GUID MFVideoFormat_HEVC_Local = 
     {0x43564548, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71}};
 
+/*
+ * AV1 format GUID ('AV01'): {31305641-0000-0010-8000-00AA00389B71}
+ * Thread Access: [ReadOnly - constant initialized at compile time]
+ */
+static const GUID MFVideoFormat_AV1_Local = 
+    {0x31305641, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71}};
+
 /* Alias for logging */
 #define MuxLog Logger_Log
 
@@ -44,20 +54,22 @@ static const GUID MFVideoFormat_HEVC_Local =
  */
 
 /**
- * Create an MF video media type configured for HEVC passthrough.
+ * Create an MF video media type configured for HEVC or AV1 passthrough.
  * Caller must Release() the returned type.
  */
-static IMFMediaType* CreateHEVCMediaType(const MuxerConfig* config) {
+static IMFMediaType* CreateVideoMediaType(const MuxerConfig* config) {
     IMFMediaType* videoType = NULL;
     HRESULT hr = MFCreateMediaType(&videoType);
     if (FAILED(hr)) return NULL;
     
     UINT32 bitrate = Util_CalculateBitrate(config->width, config->height, 
-                                           config->fps, config->quality);
+                                           config->fps, config->quality, config->codec);
     
     hr = videoType->lpVtbl->SetGUID(videoType, &MF_MT_MAJOR_TYPE, &MFMediaType_Video);
     if (FAILED(hr)) goto fail;
-    hr = videoType->lpVtbl->SetGUID(videoType, &MF_MT_SUBTYPE, &MFVideoFormat_HEVC_Local);
+    hr = videoType->lpVtbl->SetGUID(videoType, &MF_MT_SUBTYPE,
+                                    config->codec == CODEC_AV1 ? &MFVideoFormat_AV1_Local
+                                                               : &MFVideoFormat_HEVC_Local);
     if (FAILED(hr)) goto fail;
     hr = videoType->lpVtbl->SetUINT32(videoType, &MF_MT_AVG_BITRATE, bitrate);
     if (FAILED(hr)) goto fail;
@@ -76,7 +88,7 @@ static IMFMediaType* CreateHEVCMediaType(const MuxerConfig* config) {
     hr = videoType->lpVtbl->SetUINT64(videoType, &MF_MT_PIXEL_ASPECT_RATIO, pixelAspect);
     if (FAILED(hr)) goto fail;
     
-    /* Set HEVC sequence header (VPS/SPS/PPS) if provided */
+    /* Set sequence header (HEVC VPS/SPS/PPS, AV1 OBU) if provided */
     if (config->seqHeader && config->seqHeaderSize > 0) {
         hr = videoType->lpVtbl->SetBlob(videoType, &MF_MT_MPEG_SEQUENCE_HEADER, 
                                         config->seqHeader, config->seqHeaderSize);
@@ -90,7 +102,7 @@ static IMFMediaType* CreateHEVCMediaType(const MuxerConfig* config) {
     return videoType;
 
 fail:
-    MuxLog("MP4Muxer: CreateHEVCMediaType failed 0x%08X\n", hr);
+    MuxLog("MP4Muxer: CreateVideoMediaType failed 0x%08X\n", hr);
     SAFE_RELEASE(videoType);
     return NULL;
 }
@@ -278,8 +290,8 @@ BOOL MP4Muxer_WriteFile(
     hr = MFCreateSinkWriterFromURL(wPath, NULL, attrs, &writer);
     CHECK_HR_LOG(hr, cleanup, "MP4Muxer: MFCreateSinkWriterFromURL");
     
-    // Create HEVC media type using helper
-    outputType = CreateHEVCMediaType(config);
+    // Create HEVC / AV1 media type using helper
+    outputType = CreateVideoMediaType(config);
     if (!outputType) goto cleanup;
     
     MuxLog("MP4Muxer: %dx%d @ %d fps\n", config->width, config->height, config->fps);
@@ -291,7 +303,7 @@ BOOL MP4Muxer_WriteFile(
         goto cleanup;
     }
     
-    // For HEVC passthrough, use the SAME type for input as output
+    // For passthrough, use the SAME type for input as output
     // This triggers passthrough mode - no transcoding
     hr = writer->lpVtbl->SetInputMediaType(writer, streamIndex, outputType, NULL);
     if (FAILED(hr)) {
@@ -412,7 +424,7 @@ BOOL MP4Muxer_WriteFileWithAudio(
     CHECK_HR_LOG(hr, cleanup, "MP4Muxer: MFCreateSinkWriterFromURL");
     
     // === VIDEO STREAM (using helper) ===
-    videoType = CreateHEVCMediaType(videoConfig);
+    videoType = CreateVideoMediaType(videoConfig);
     if (!videoType) goto cleanup;
     
     hr = writer->lpVtbl->AddStream(writer, videoType, &videoStreamIndex);
@@ -591,7 +603,7 @@ BOOL MP4Muxer_WriteFileWithMultiAudio(
     CHECK_HR_LOG(hr, cleanup, "MP4Muxer: MFCreateSinkWriterFromURL");
 
     /* === VIDEO STREAM === */
-    videoType = CreateHEVCMediaType(videoConfig);
+    videoType = CreateVideoMediaType(videoConfig);
     if (!videoType) goto cleanup;
 
     hr = writer->lpVtbl->AddStream(writer, videoType, &videoStreamIndex);
@@ -744,6 +756,7 @@ cleanup:
 
 struct StreamingMuxer {
     IMFSinkWriter* writer;
+    MP4FragmentWriter* fragments;   // Set instead of writer in fragmented mode
     DWORD videoStreamIndex;
     DWORD audioStreamIndex;
     BOOL hasAudio;
@@ -790,8 +803,21 @@ StreamingMuxer* StreamingMuxer_CreateWithAudio(
     
     InitializeCriticalSection(&muxer->lock);
     
-    MuxLog("StreamingMuxer: Creating %s (%dx%d @ %d fps)\n", 
-           outputPath, videoConfig->width, videoConfig->height, videoConfig->fps);
+    MuxLog("StreamingMuxer: Creating %s (%dx%d @ %d fps%s)\n", 
+           outputPath, videoConfig->width, videoConfig->height, videoConfig->fps,
+           videoConfig->fragmented ? ", fragmented" : "");
+    
+    if (videoConfig->fragmented) {
+        muxer->fragments = MP4Writer_CreateFragmented(outputPath, videoConfig, audioConfig);
+        if (muxer->fragments) {
+            muxer->hasAudio = MP4Writer_HasFragmentAudio(muxer->fragments);
+            if (audioConfig && !muxer->hasAudio) {
+                MuxLog("StreamingMuxer: WARNING - Audio config unusable, continuing without audio\n");
+            }
+            return muxer;
+        }
+        MuxLog("StreamingMuxer: Fragmented writer failed, falling back to the sink writer\n");
+    }
     
     // Convert path to wide string (UTF-8 -> UTF-16) so non-ANSI paths survive
     WCHAR wPath[MAX_PATH];
@@ -813,8 +839,8 @@ StreamingMuxer* StreamingMuxer_CreateWithAudio(
         goto cleanup;
     }
     
-    // Create video media type (HEVC passthrough)
-    videoType = CreateHEVCMediaType(videoConfig);
+    // Create video media type (HEVC / AV1 passthrough)
+    videoType = CreateVideoMediaType(videoConfig);
     if (!videoType) goto cleanup;
     
     // Add video stream
@@ -824,7 +850,7 @@ StreamingMuxer* StreamingMuxer_CreateWithAudio(
         goto cleanup;
     }
     
-    // HEVC passthrough: same type for input and output
+    // Passthrough: same type for input and output
     hr = muxer->writer->lpVtbl->SetInputMediaType(muxer->writer, muxer->videoStreamIndex, videoType, NULL);
     if (FAILED(hr)) {
         MuxLog("StreamingMuxer: SetInputMediaType (video) failed 0x%08X\n", hr);
@@ -879,14 +905,17 @@ cleanup:
 }
 
 BOOL StreamingMuxer_WriteVideo(StreamingMuxer* muxer, const MuxerSample* sample) {
-    if (!muxer || !muxer->writer || !sample) return FALSE;
+    if (!muxer || (!muxer->writer && !muxer->fragments) || !sample) return FALSE;
     if (!sample->data || sample->size == 0) return FALSE;
     
     BOOL result = FALSE;
     
     EnterCriticalSection(&muxer->lock);
     
-    if (WriteVideoSampleToWriter(muxer->writer, muxer->videoStreamIndex, sample)) {
+    BOOL written = muxer->fragments
+        ? MP4Writer_WriteFragmentVideo(muxer->fragments, sample)
+        : WriteVideoSampleToWriter(muxer->writer, muxer->videoStreamIndex, sample);
+    if (written) {
         muxer->videoSamplesWritten++;
         muxer->lastVideoTimestamp = sample->timestamp;
         if (sample->isKeyframe) muxer->keyframeCount++;
@@ -899,14 +928,17 @@ BOOL StreamingMuxer_WriteVideo(StreamingMuxer* muxer, const MuxerSample* sample)
 }
 
 BOOL StreamingMuxer_WriteAudio(StreamingMuxer* muxer, const MuxerAudioSample* sample) {
-    if (!muxer || !muxer->writer || !muxer->hasAudio || !sample) return FALSE;
+    if (!muxer || (!muxer->writer && !muxer->fragments) || !muxer->hasAudio || !sample) return FALSE;
     if (!sample->data || sample->size == 0) return FALSE;
     
     BOOL result = FALSE;
     
     EnterCriticalSection(&muxer->lock);
     
-    if (WriteAudioSampleToWriter(muxer->writer, muxer->audioStreamIndex, sample)) {
+    BOOL written = muxer->fragments
+        ? MP4Writer_WriteFragmentAudio(muxer->fragments, sample)
+        : WriteAudioSampleToWriter(muxer->writer, muxer->audioStreamIndex, sample);
+    if (written) {
         muxer->audioSamplesWritten++;
         muxer->lastAudioTimestamp = sample->timestamp;
         result = TRUE;
@@ -928,7 +960,11 @@ BOOL StreamingMuxer_Close(StreamingMuxer* muxer) {
     MuxLog("StreamingMuxer: Closing (video=%d, audio=%d, keyframes=%d)\n",
            muxer->videoSamplesWritten, muxer->audioSamplesWritten, muxer->keyframeCount);
     
-    if (muxer->writer && muxer->beginWritingCalled) {
+    if (muxer->fragments) {
+        // Only the open GOP is left to write: no moov to build
+        result = MP4Writer_CloseFragmented(muxer->fragments) && muxer->videoSamplesWritten > 0;
+        muxer->fragments = NULL;
+    } else if (muxer->writer && muxer->beginWritingCalled) {
         DWORD finalizeStart = GetTickCount();
         hr = muxer->writer->lpVtbl->Finalize(muxer->writer);
         DWORD finalizeTime = GetTickCount() - finalizeStart;
@@ -963,7 +999,12 @@ void StreamingMuxer_Abort(StreamingMuxer* muxer) {
     EnterCriticalSection(&muxer->lock);
     
     // Release without finalize - file will be corrupted but we exit fast
+    // (a fragmented file stays playable up to its last written fragment)
     SAFE_RELEASE(muxer->writer);
+    if (muxer->fragments) {
+        MP4Writer_AbortFragmented(muxer->fragments);
+        muxer->fragments = NULL;
+    }
     
     LeaveCriticalSection(&muxer->lock);
     DeleteCriticalSection(&muxer->lock);
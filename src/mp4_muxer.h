@@ -18,7 +18,7 @@
 
 // Sample data for muxing (copies data from buffer)
 typedef struct {
-    BYTE* data;             // HEVC NAL unit data
+    BYTE* data;             // HEVC NAL units (Annex-B) or AV1 OBUs
     DWORD size;             // Size in bytes
     LONGLONG timestamp;     // Sample time (100-ns units)
     LONGLONG duration;      // Sample duration (100-ns units)
@@ -33,14 +33,26 @@ typedef struct {
     LONGLONG duration;      // Sample duration (100-ns units)
 } MuxerAudioSample;
 
+// Still image for the native writer's cover art and thumbnail boxes
+typedef struct {
+    BYTE* data;             // JPEG bytes
+    DWORD size;             // Size in bytes
+    LONGLONG timestamp;     // Time from the clip's first frame (100-ns units)
+} MuxerImage;
+
 // Muxer configuration
 typedef struct {
     int width;              // Video width
     int height;             // Video height
     int fps;                // Frame rate
     QualityPreset quality;  // For bitrate calculation
-    BYTE* seqHeader;        // HEVC VPS/SPS/PPS sequence header
+    BYTE* seqHeader;        // HEVC VPS/SPS/PPS (Annex-B) or AV1 sequence header OBU
     DWORD seqHeaderSize;    // Size of sequence header
+    VideoCodec codec;       // HEVC: Annex-B samples, hvc1. AV1: OBU samples, av01
+    BOOL fragmented;        // Streaming API only: fragmented MP4 (mp4_writer.c)
+    const MuxerImage* poster;       // Native batch writer only: cover art, NULL = none
+    const MuxerImage* thumbnails;   // Native batch writer only: per-GOP thumbnails
+    int thumbnailCount;
 } MuxerConfig;
 
 // Audio configuration
@@ -96,6 +108,12 @@ BOOL MP4Muxer_WriteFileWithMultiAudio(
  * ============================================================================
  * For real-time recording where frames are written as they arrive.
  * Unlike batch API above, this keeps the file open and writes incrementally.
+ *
+ * With MuxerConfig.fragmented the file is written by mp4_writer.c as
+ * fragmented MP4 instead (one moof/mdat per GOP, no Media Foundation):
+ * Close only flushes the last GOP and a file cut short by a crash plays up
+ * to its last complete fragment. Falls back to the sink writer if the
+ * fragmented writer cannot start (e.g. no sequence header).
  */
 
 // Opaque handle for streaming muxer
@@ -0,0 +1,929 @@
+/*
+ * mp4_reader.c - Sample index and payload reader for MP4 files
+ *
+ * USED BY: clip_edit.c
+ *
+ * Open walks the top-level boxes by header only, reads moov (and each
+ * moof) into memory and expands the sample tables into one IndexEntry per
+ * sample. The entries become the clip's MuxerSample arrays once every
+ * fragment is in, so classic and fragmented files end up identical.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Goto-cleanup in MP4Reader_Open (file handle, box buffers, tables)
+ * - ByteCursor latches reads past the end; checked once per box
+ * - Malformed or unsupported files are logged and refused, never guessed
+ */
+
+#include "mp4_reader.h"
+#include "logger.h"
+#include "mem_utils.h"
+#include <limits.h>
+#include <string.h>
+
+/* Alias for logging */
+#define ReaderLog Logger_Log
+
+#define MAX_TRACKS          (1 + MAX_AUDIO_TRACKS)
+#define MAX_BOX_BYTES       (256u * 1024 * 1024)    /* moov / moof sanity limit */
+#define READ_CHUNK_BYTES    (64u * 1024 * 1024)     /* Largest single ReadFile */
+
+#define TRUN_DATA_OFFSET    0x000001
+#define TRUN_FIRST_FLAGS    0x000004
+#define TRUN_DURATION       0x000100
+#define TRUN_SIZE           0x000200
+#define TRUN_FLAGS          0x000400
+#define TRUN_CTS_OFFSET     0x000800
+
+#define TFHD_BASE_OFFSET    0x000001
+#define TFHD_DESCRIPTION    0x000002
+#define TFHD_DURATION       0x000008
+#define TFHD_SIZE           0x000010
+#define TFHD_FLAGS          0x000020
+
+#define SAMPLE_IS_NON_SYNC  0x00010000
+
+/* ============================================================================
+ * BYTE CURSOR
+ * ============================================================================
+ * Big-endian reads over an in-memory box. Reading past the end returns
+ * zeros and sets bad.
+ */
+
+typedef struct {
+    const BYTE* data;
+    size_t size;
+    size_t pos;
+    BOOL bad;
+} ByteCursor;
+
+static void Cursor_Init(ByteCursor* c, const BYTE* data, size_t size) {
+    c->data = data;
+    c->size = size;
+    c->pos = 0;
+    c->bad = FALSE;
+}
+
+static BOOL Has(ByteCursor* c, size_t n) {
+    if (c->bad || c->size - c->pos < n) {
+        c->bad = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static UINT32 R8(ByteCursor* c) {
+    if (!Has(c, 1)) return 0;
+    return c->data[c->pos++];
+}
+
+static UINT32 R16(ByteCursor* c) {
+    if (!Has(c, 2)) return 0;
+    const BYTE* p = c->data + c->pos;
+    c->pos += 2;
+    return ((UINT32)p[0] << 8) | p[1];
+}
+
+static UINT32 R32(ByteCursor* c) {
+    if (!Has(c, 4)) return 0;
+    const BYTE* p = c->data + c->pos;
+    c->pos += 4;
+    return ((UINT32)p[0] << 24) | ((UINT32)p[1] << 16) | ((UINT32)p[2] << 8) | p[3];
+}
+
+static UINT64 R64(ByteCursor* c) {
+    UINT64 hi = R32(c);
+    return (hi << 32) | R32(c);
+}
+
+static void Skip(ByteCursor* c, size_t n) {
+    if (Has(c, n)) c->pos += n;
+}
+
+/* Next child box: its type and a cursor over its body */
+static BOOL NextBox(ByteCursor* c, char type[5], ByteCursor* body) {
+    if (c->bad || c->size - c->pos < 8) return FALSE;
+    size_t start = c->pos;
+    UINT64 size = R32(c);
+    memcpy(type, c->data + c->pos, 4);
+    type[4] = '\0';
+    c->pos += 4;
+    if (size == 1) size = R64(c);
+    else if (size == 0) size = c->size - start;
+
+    size_t header = c->pos - start;
+    if (c->bad || size < header || size > c->size - start) {
+        c->bad = TRUE;
+        return FALSE;
+    }
+    Cursor_Init(body, c->data + c->pos, (size_t)size - header);
+    c->pos = start + (size_t)size;
+    return TRUE;
+}
+
+/* First child of the given type */
+static BOOL FindBox(const ByteCursor* parent, const char* type, ByteCursor* body) {
+    ByteCursor c = *parent;
+    char t[5];
+    ByteCursor b;
+    while (NextBox(&c, t, &b)) {
+        if (memcmp(t, type, 4) == 0) {
+            *body = b;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* Full box version; flags through *flags when wanted */
+static int FullBoxHeader(ByteCursor* c, UINT32* flags) {
+    UINT32 v = R32(c);
+    if (flags) *flags = v & 0xFFFFFF;
+    return (int)(v >> 24);
+}
+
+/* ============================================================================
+ * FILE ACCESS
+ * ============================================================================
+ */
+
+static BOOL ReadAt(HANDLE file, UINT64 offset, void* dst, size_t size) {
+    BYTE* p = (BYTE*)dst;
+    while (size > 0) {
+        DWORD n = size > READ_CHUNK_BYTES ? READ_CHUNK_BYTES : (DWORD)size;
+        OVERLAPPED ov;
+        ZeroMemory(&ov, sizeof(ov));
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD done = 0;
+        if (!ReadFile(file, p, n, &done, &ov) || done != n) {
+            ReaderLog("MP4Reader: read of %lu bytes at %llu failed (%lu read, error %lu)\n",
+                      n, offset, done, GetLastError());
+            return FALSE;
+        }
+        p += n;
+        offset += n;
+        size -= n;
+    }
+    return TRUE;
+}
+
+/* Whole box body into a new buffer */
+static BYTE* ReadBox(HANDLE file, UINT64 offset, UINT64 size) {
+    if (size > MAX_BOX_BYTES) {
+        ReaderLog("MP4Reader: %llu byte box at %llu is too large\n", size, offset);
+        return NULL;
+    }
+    BYTE* data = (BYTE*)malloc(size ? (size_t)size : 1);
+    if (!data) return NULL;
+    if (!ReadAt(file, offset, data, (size_t)size)) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+/* ============================================================================
+ * TRACK INDEX
+ * ============================================================================
+ */
+
+typedef struct {
+    UINT64 dts;                 /* Media timescale ticks */
+    UINT32 duration;
+    DWORD size;
+    UINT64 offset;
+    BOOL sync;
+} IndexEntry;
+
+typedef struct {
+    UINT32 trackId;
+    BOOL isVideo;
+    BOOL isAudio;
+    UINT32 timescale;
+    LONGLONG editDelay;         /* 100ns: empty edit minus skipped media */
+
+    IndexEntry* entries;
+    int count;
+    int capacity;
+    UINT64 nextDts;             /* End of the last entry (fragments continue here) */
+
+    /* trex defaults */
+    UINT32 defaultDuration;
+    UINT32 defaultSize;
+    UINT32 defaultFlags;
+
+    /* Sample entry */
+    int width;
+    int height;
+    VideoCodec codec;
+    BYTE* seqHeader;
+    DWORD seqHeaderSize;
+    int sampleRate;
+    int channels;
+    int bitrate;
+    BYTE* audioConfig;
+    int audioConfigSize;
+} ReaderTrack;
+
+static IndexEntry* AddEntry(ReaderTrack* t) {
+    if (t->count == t->capacity) {
+        int capacity = t->capacity ? t->capacity * 2 : 1024;
+        IndexEntry* grown = (IndexEntry*)realloc(t->entries, (size_t)capacity * sizeof(IndexEntry));
+        if (!grown) {
+            ReaderLog("MP4Reader: failed to grow the index of track %u (%d)\n", t->trackId, capacity);
+            return NULL;
+        }
+        t->entries = grown;
+        t->capacity = capacity;
+    }
+    return &t->entries[t->count++];
+}
+
+/* hvcC arrays -> Annex-B VPS/SPS/PPS, the form NVENC hands the muxer */
+static BOOL ParseHvcC(ReaderTrack* t, ByteCursor hvcc) {
+    Skip(&hvcc, 22);
+    UINT32 arrays = R8(&hvcc);
+    size_t total = 0;
+    ByteCursor scan = hvcc;
+    for (UINT32 a = 0; a < arrays; a++) {
+        R8(&scan);
+        UINT32 n = R16(&scan);
+        for (UINT32 i = 0; i < n; i++) {
+            UINT32 len = R16(&scan);
+            Skip(&scan, len);
+            total += 4 + len;
+        }
+    }
+    if (scan.bad || total == 0) return FALSE;
+
+    t->seqHeader = (BYTE*)malloc(total);
+    if (!t->seqHeader) return FALSE;
+    for (UINT32 a = 0; a < arrays; a++) {
+        R8(&hvcc);
+        UINT32 n = R16(&hvcc);
+        for (UINT32 i = 0; i < n; i++) {
+            UINT32 len = R16(&hvcc);
+            BYTE* dst = t->seqHeader + t->seqHeaderSize;
+            dst[0] = 0; dst[1] = 0; dst[2] = 0; dst[3] = 1;
+            memcpy(dst + 4, hvcc.data + hvcc.pos, len);
+            Skip(&hvcc, len);
+            t->seqHeaderSize += 4 + len;
+        }
+    }
+    return TRUE;
+}
+
+/* av1C configOBUs (the sequence header OBU) is already what NVENC hands the muxer */
+static BOOL ParseAv1C(ReaderTrack* t, ByteCursor av1c) {
+    Skip(&av1c, 4);
+    if (av1c.bad || av1c.pos >= av1c.size) return FALSE;
+    t->seqHeaderSize = (DWORD)(av1c.size - av1c.pos);
+    t->seqHeader = (BYTE*)malloc(t->seqHeaderSize);
+    if (!t->seqHeader) return FALSE;
+    memcpy(t->seqHeader, av1c.data + av1c.pos, t->seqHeaderSize);
+    return TRUE;
+}
+
+/* MPEG-4 descriptor header: tag and the 1-4 byte length */
+static UINT32 Descriptor(ByteCursor* c, UINT32* tag) {
+    *tag = R8(c);
+    UINT32 len = 0;
+    for (int i = 0; i < 4; i++) {
+        UINT32 b = R8(c);
+        len = (len << 7) | (b & 0x7F);
+        if (!(b & 0x80)) break;
+    }
+    return len;
+}
+
+/* esds -> AudioSpecificConfig and average bitrate */
+static BOOL ParseEsds(ReaderTrack* t, ByteCursor esds) {
+    UINT32 tag;
+    FullBoxHeader(&esds, NULL);
+    Descriptor(&esds, &tag);
+    if (tag != 0x03) return FALSE;
+    R16(&esds);                                     /* ES_ID */
+    UINT32 esFlags = R8(&esds);
+    if (esFlags & 0x80) R16(&esds);                 /* dependsOn_ES_ID */
+    if (esFlags & 0x40) Skip(&esds, R8(&esds));     /* URL */
+    if (esFlags & 0x20) R16(&esds);                 /* OCR_ES_Id */
+
+    Descriptor(&esds, &tag);
+    if (tag != 0x04) return FALSE;
+    UINT32 objectType = R8(&esds);
+    Skip(&esds, 1 + 3 + 4);                         /* streamType, bufferSizeDB, maxBitrate */
+    t->bitrate = (int)R32(&esds);
+    if (objectType != 0x40) {
+        ReaderLog("MP4Reader: audio object type 0x%02X is not AAC\n", objectType);
+        return FALSE;
+    }
+
+    UINT32 len = Descriptor(&esds, &tag);
+    if (tag != 0x05 || len == 0 || !Has(&esds, len)) return FALSE;
+    t->audioConfig = (BYTE*)malloc(len);
+    if (!t->audioConfig) return FALSE;
+    memcpy(t->audioConfig, esds.data + esds.pos, len);
+    t->audioConfigSize = (int)len;
+    return TRUE;
+}
+
+static BOOL ParseStsd(ReaderTrack* t, ByteCursor stsd) {
+    FullBoxHeader(&stsd, NULL);
+    if (R32(&stsd) < 1) return FALSE;
+
+    char type[5];
+    ByteCursor entry;
+    if (!NextBox(&stsd, type, &entry)) return FALSE;
+
+    if (t->isVideo) {
+        if (strcmp(type, "av01") == 0) {
+            t->codec = CODEC_AV1;
+        } else if (strcmp(type, "hvc1") != 0 && strcmp(type, "hev1") != 0) {
+            ReaderLog("MP4Reader: video codec '%s' is not HEVC or AV1\n", type);
+            return FALSE;
+        }
+        Skip(&entry, 24);
+        t->width = (int)R16(&entry);
+        t->height = (int)R16(&entry);
+        Skip(&entry, 50);                           /* Rest of VisualSampleEntry */
+        ByteCursor config;
+        if (t->codec == CODEC_AV1) {
+            if (entry.bad || !FindBox(&entry, "av1C", &config) || !ParseAv1C(t, config)) {
+                ReaderLog("MP4Reader: missing or malformed av1C\n");
+                return FALSE;
+            }
+        } else if (entry.bad || !FindBox(&entry, "hvcC", &config) || !ParseHvcC(t, config)) {
+            ReaderLog("MP4Reader: missing or malformed hvcC\n");
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    if (strcmp(type, "mp4a") != 0) {
+        ReaderLog("MP4Reader: audio codec '%s' is not AAC\n", type);
+        return FALSE;
+    }
+    Skip(&entry, 16);
+    t->channels = (int)R16(&entry);
+    Skip(&entry, 6);
+    t->sampleRate = (int)(R32(&entry) >> 16);
+    ByteCursor esds;
+    if (entry.bad || !FindBox(&entry, "esds", &esds) || !ParseEsds(t, esds)) {
+        ReaderLog("MP4Reader: missing or malformed esds\n");
+        return FALSE;
+    }
+    if (t->sampleRate <= 0) t->sampleRate = (int)t->timescale;
+    return TRUE;
+}
+
+/* Expand stts/stss/stsz/stsc/stco into entries */
+static BOOL ParseStbl(ReaderTrack* t, ByteCursor stbl) {
+    ByteCursor stsd, stts, stsz, stsc, stco, stss, ctts;
+    BOOL co64 = FALSE;
+    if (!FindBox(&stbl, "stsd", &stsd) || !ParseStsd(t, stsd)) return FALSE;
+    if (!FindBox(&stbl, "stts", &stts) || !FindBox(&stbl, "stsz", &stsz) ||
+        !FindBox(&stbl, "stsc", &stsc)) {
+        ReaderLog("MP4Reader: track %u lacks sample tables\n", t->trackId);
+        return FALSE;
+    }
+    if (!FindBox(&stbl, "stco", &stco)) {
+        if (!FindBox(&stbl, "co64", &stco)) return FALSE;
+        co64 = TRUE;
+    }
+    BOOL hasStss = FindBox(&stbl, "stss", &stss);
+
+    if (FindBox(&stbl, "ctts", &ctts)) {
+        FullBoxHeader(&ctts, NULL);
+        UINT32 n = R32(&ctts);
+        for (UINT32 i = 0; i < n && !ctts.bad; i++) {
+            R32(&ctts);
+            if (R32(&ctts) != 0) {
+                ReaderLog("MP4Reader: track %u has composition offsets (B-frames)\n", t->trackId);
+                return FALSE;
+            }
+        }
+    }
+
+    FullBoxHeader(&stsz, NULL);
+    UINT32 uniformSize = R32(&stsz);
+    UINT32 count = R32(&stsz);
+    if (stsz.bad || count > (UINT32)INT_MAX / 2) return FALSE;
+    for (UINT32 i = 0; i < count; i++) {
+        if (!AddEntry(t)) return FALSE;
+    }
+    for (int i = 0; i < t->count; i++) {
+        IndexEntry* e = &t->entries[i];
+        ZeroMemory(e, sizeof(*e));
+        e->size = uniformSize ? uniformSize : R32(&stsz);
+        e->sync = !hasStss;
+    }
+
+    /* Durations and decode times */
+    FullBoxHeader(&stts, NULL);
+    UINT32 runs = R32(&stts);
+    int s = 0;
+    UINT64 dts = 0;
+    for (UINT32 r = 0; r < runs && !stts.bad; r++) {
+        UINT32 n = R32(&stts);
+        UINT32 delta = R32(&stts);
+        for (UINT32 k = 0; k < n && s < t->count; k++, s++) {
+            t->entries[s].dts = dts;
+            t->entries[s].duration = delta;
+            dts += delta;
+        }
+    }
+    for (; s < t->count; s++) t->entries[s].dts = dts;
+    t->nextDts = dts;
+
+    if (hasStss) {
+        FullBoxHeader(&stss, NULL);
+        UINT32 n = R32(&stss);
+        for (UINT32 i = 0; i < n && !stss.bad; i++) {
+            UINT32 number = R32(&stss);
+            if (number >= 1 && number <= (UINT32)t->count) t->entries[number - 1].sync = TRUE;
+        }
+    }
+
+    /* Offsets: walk the chunks, each holding stsc's samples_per_chunk */
+    FullBoxHeader(&stco, NULL);
+    UINT32 chunks = R32(&stco);
+    FullBoxHeader(&stsc, NULL);
+    UINT32 stscCount = R32(&stsc);
+    UINT32 nextFirst = stscCount > 0 ? R32(&stsc) : 1;
+    UINT32 perChunk = 0;
+    UINT32 stscRead = 0;
+    s = 0;
+    for (UINT32 chunk = 1; chunk <= chunks && s < t->count; chunk++) {
+        while (stscRead < stscCount && chunk >= nextFirst) {
+            perChunk = R32(&stsc);
+            R32(&stsc);                             /* sample_description_index */
+            stscRead++;
+            nextFirst = stscRead < stscCount ? R32(&stsc) : 0xFFFFFFFF;
+        }
+        UINT64 offset = co64 ? R64(&stco) : R32(&stco);
+        for (UINT32 k = 0; k < perChunk && s < t->count; k++, s++) {
+            t->entries[s].offset = offset;
+            offset += t->entries[s].size;
+        }
+    }
+
+    if (stts.bad || stsz.bad || stsc.bad || stco.bad || s < t->count) {
+        ReaderLog("MP4Reader: track %u sample tables are inconsistent (%d of %d placed)\n",
+                  t->trackId, s, t->count);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* elst: an initial empty edit delays the track; a media_time skips into it */
+static void ParseElst(ReaderTrack* t, ByteCursor elst, UINT32 movieTimescale) {
+    int version = FullBoxHeader(&elst, NULL);
+    UINT32 n = R32(&elst);
+    LONGLONG delay = 0;
+    for (UINT32 i = 0; i < n && !elst.bad; i++) {
+        UINT64 segment = version ? R64(&elst) : R32(&elst);
+        LONGLONG mediaTime = version ? (LONGLONG)R64(&elst) : (LONGLONG)(INT32)R32(&elst);
+        R32(&elst);                                 /* media_rate */
+        if (mediaTime == -1) {
+            if (movieTimescale > 0) delay += (LONGLONG)(segment * (UINT64)MF_UNITS_PER_SECOND / movieTimescale);
+            continue;
+        }
+        if (t->timescale > 0) delay -= mediaTime * MF_UNITS_PER_SECOND / t->timescale;
+        break;
+    }
+    if (!elst.bad) t->editDelay = delay;
+}
+
+static BOOL ParseTrak(ReaderTrack* t, ByteCursor trak, UINT32 movieTimescale) {
+    ByteCursor tkhd, mdia, mdhd, hdlr, minf, stbl, edts, elst;
+    if (!FindBox(&trak, "tkhd", &tkhd) || !FindBox(&trak, "mdia", &mdia)) return FALSE;
+    int version = FullBoxHeader(&tkhd, NULL);
+    Skip(&tkhd, version ? 16 : 8);
+    t->trackId = R32(&tkhd);
+
+    if (!FindBox(&mdia, "mdhd", &mdhd) || !FindBox(&mdia, "hdlr", &hdlr)) return FALSE;
+    version = FullBoxHeader(&mdhd, NULL);
+    Skip(&mdhd, version ? 16 : 8);
+    t->timescale = R32(&mdhd);
+    FullBoxHeader(&hdlr, NULL);
+    R32(&hdlr);
+    UINT32 handler = R32(&hdlr);
+    t->isVideo = (handler == 0x76696465);           /* 'vide' */
+    t->isAudio = (handler == 0x736F756E);           /* 'soun' */
+    if (!t->isVideo && !t->isAudio) return TRUE;    /* Ignored (text, metadata, ...) */
+    if (t->timescale == 0 || mdhd.bad) return FALSE;
+
+    if (FindBox(&trak, "edts", &edts) && FindBox(&edts, "elst", &elst)) {
+        ParseElst(t, elst, movieTimescale);
+    }
+
+    if (!FindBox(&mdia, "minf", &minf) || !FindBox(&minf, "stbl", &stbl)) return FALSE;
+    return ParseStbl(t, stbl);
+}
+
+static ReaderTrack* TrackById(ReaderTrack* tracks, int count, UINT32 id) {
+    for (int i = 0; i < count; i++) {
+        if (tracks[i].trackId == id) return &tracks[i];
+    }
+    return NULL;
+}
+
+/* One moof: append each traf's trun samples to its track */
+static BOOL ParseMoof(ReaderTrack* tracks, int trackCount, ByteCursor moof, UINT64 moofOffset) {
+    char type[5];
+    ByteCursor traf;
+    ByteCursor c = moof;
+    while (NextBox(&c, type, &traf)) {
+        if (strcmp(type, "traf") != 0) continue;
+
+        ByteCursor tfhd, box;
+        if (!FindBox(&traf, "tfhd", &tfhd)) return FALSE;
+        UINT32 flags;
+        FullBoxHeader(&tfhd, &flags);
+        ReaderTrack* t = TrackById(tracks, trackCount, R32(&tfhd));
+        if (!t || (!t->isVideo && !t->isAudio)) continue;
+
+        UINT64 base = moofOffset;
+        UINT32 duration = t->defaultDuration;
+        UINT32 size = t->defaultSize;
+        UINT32 sampleFlags = t->defaultFlags;
+        if (flags & TFHD_BASE_OFFSET) base = R64(&tfhd);
+        if (flags & TFHD_DESCRIPTION) R32(&tfhd);
+        if (flags & TFHD_DURATION) duration = R32(&tfhd);
+        if (flags & TFHD_SIZE) size = R32(&tfhd);
+        if (flags & TFHD_FLAGS) sampleFlags = R32(&tfhd);
+        if (tfhd.bad) return FALSE;
+
+        if (FindBox(&traf, "tfdt", &box)) {
+            int version = FullBoxHeader(&box, NULL);
+            t->nextDts = version ? R64(&box) : R32(&box);
+        }
+
+        UINT64 dataOffset = base;
+        ByteCursor runs = traf;
+        ByteCursor trun;
+        while (NextBox(&runs, type, &trun)) {
+            if (strcmp(type, "trun") != 0) continue;
+            UINT32 runFlags;
+            FullBoxHeader(&trun, &runFlags);
+            UINT32 n = R32(&trun);
+            if (runFlags & TRUN_DATA_OFFSET) dataOffset = base + (INT64)(INT32)R32(&trun);
+            UINT32 firstFlags = (runFlags & TRUN_FIRST_FLAGS) ? R32(&trun) : sampleFlags;
+            for (UINT32 i = 0; i < n && !trun.bad; i++) {
+                IndexEntry* e = AddEntry(t);
+                if (!e) return FALSE;
+                e->duration = (runFlags & TRUN_DURATION) ? R32(&trun) : duration;
+                e->size = (runFlags & TRUN_SIZE) ? R32(&trun) : size;
+                UINT32 f = (runFlags & TRUN_FLAGS) ? R32(&trun) : (i == 0 ? firstFlags : sampleFlags);
+                if ((runFlags & TRUN_CTS_OFFSET) && R32(&trun) != 0) {
+                    ReaderLog("MP4Reader: track %u has composition offsets (B-frames)\n", t->trackId);
+                    return FALSE;
+                }
+                e->sync = t->isAudio || !(f & SAMPLE_IS_NON_SYNC);
+                e->dts = t->nextDts;
+                e->offset = dataOffset;
+                t->nextDts += e->duration;
+                dataOffset += e->size;
+            }
+            if (trun.bad) return FALSE;
+        }
+    }
+    return !c.bad;
+}
+
+static void ParseTrex(ReaderTrack* tracks, int trackCount, ByteCursor mvex) {
+    char type[5];
+    ByteCursor trex;
+    while (NextBox(&mvex, type, &trex)) {
+        if (strcmp(type, "trex") != 0) continue;
+        FullBoxHeader(&trex, NULL);
+        ReaderTrack* t = TrackById(tracks, trackCount, R32(&trex));
+        R32(&trex);                                 /* default_sample_description_index */
+        UINT32 duration = R32(&trex);
+        UINT32 size = R32(&trex);
+        UINT32 flags = R32(&trex);
+        if (t && !trex.bad) {
+            t->defaultDuration = duration;
+            t->defaultSize = size;
+            t->defaultFlags = flags;
+        }
+    }
+}
+
+/* Ticks -> 100ns, rounded */
+static LONGLONG TicksTo100ns(UINT64 ticks, UINT32 timescale) {
+    return (LONGLONG)((ticks * MF_UNITS_PER_SECOND + timescale / 2) / timescale);
+}
+
+/* Move a track's index into the clip's sample arrays */
+static BOOL ExportVideo(MP4Clip* clip, ReaderTrack* t) {
+    clip->videoSamples = (MuxerSample*)calloc((size_t)t->count, sizeof(MuxerSample));
+    clip->videoOffsets = (UINT64*)malloc((size_t)t->count * sizeof(UINT64));
+    if (!clip->videoSamples || !clip->videoOffsets) return FALSE;
+    for (int i = 0; i < t->count; i++) {
+        const IndexEntry* e = &t->entries[i];
+        MuxerSample* s = &clip->videoSamples[i];
+        s->size = e->size;
+        s->timestamp = t->editDelay + TicksTo100ns(e->dts, t->timescale);
+        s->duration = TicksTo100ns(e->duration, t->timescale);
+        s->isKeyframe = e->sync;
+        clip->videoOffsets[i] = e->offset;
+    }
+    clip->videoCount = t->count;
+
+    clip->video.width = t->width;
+    clip->video.height = t->height;
+    clip->video.seqHeader = t->seqHeader;
+    clip->video.seqHeaderSize = t->seqHeaderSize;
+    clip->video.codec = t->codec;
+    t->seqHeader = NULL;
+
+    /* Nominal rate from the first second of frames */
+    if (t->count > 1) {
+        LONGLONG span = clip->videoSamples[t->count - 1].timestamp - clip->videoSamples[0].timestamp;
+        if (span > 0) {
+            clip->video.fps = (int)(((LONGLONG)(t->count - 1) * MF_UNITS_PER_SECOND + span / 2) / span);
+        }
+    }
+    return TRUE;
+}
+
+static BOOL ExportAudio(MP4Clip* clip, ReaderTrack* t) {
+    int a = clip->audioTrackCount++;               /* Counted first so Close frees it */
+    clip->audioSamples[a] = (MuxerAudioSample*)calloc((size_t)t->count, sizeof(MuxerAudioSample));
+    clip->audioOffsets[a] = (UINT64*)malloc((size_t)t->count * sizeof(UINT64));
+    if (!clip->audioSamples[a] || !clip->audioOffsets[a]) return FALSE;
+    for (int i = 0; i < t->count; i++) {
+        const IndexEntry* e = &t->entries[i];
+        MuxerAudioSample* s = &clip->audioSamples[a][i];
+        s->size = e->size;
+        s->timestamp = t->editDelay + TicksTo100ns(e->dts, t->timescale);
+        s->duration = TicksTo100ns(e->duration, t->timescale);
+        clip->audioOffsets[a][i] = e->offset;
+    }
+    clip->audioCounts[a] = t->count;
+
+    MuxerAudioConfig* config = &clip->audioConfigs[a];
+    config->sampleRate = t->sampleRate;
+    config->channels = t->channels;
+    config->bitrate = t->bitrate > 0 ? t->bitrate : AAC_BITRATE;
+    config->configData = t->audioConfig;
+    config->configSize = t->audioConfigSize;
+    t->audioConfig = NULL;
+    return TRUE;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: MP4Reader_Open
+ * Resources: 4 - file handle, moov buffer, per-track index tables,
+ *            fragment offset list
+ * Pattern: goto-cleanup; on success only the file handle and the clip's
+ *          own arrays remain (released by MP4Reader_Close)
+ * Init: ZeroMemory ensures NULL initialization
+ */
+BOOL MP4Reader_Open(const char* path, MP4Clip* clip) {
+    LWSR_ASSERT(path != NULL);
+    LWSR_ASSERT(clip != NULL);
+
+    if (!path || !clip) return FALSE;
+    ZeroMemory(clip, sizeof(*clip));
+    clip->file = INVALID_HANDLE_VALUE;
+    strncpy(clip->path, path, MAX_PATH - 1);
+
+    BOOL result = FALSE;
+    ReaderTrack tracks[MAX_TRACKS];
+    int trackCount = 0;
+    BYTE* moovData = NULL;
+    UINT64* moofs = NULL;        /* Offset, size pairs */
+    int moofCount = 0;
+    int moofCapacity = 0;
+    ZeroMemory(tracks, sizeof(tracks));
+
+    WCHAR wPath[MAX_PATH];
+    if (MultiByteToWideChar(CP_UTF8, 0, path, -1, wPath, MAX_PATH) == 0) {
+        ReaderLog("MP4Reader: MultiByteToWideChar failed (path too long or invalid UTF-8)\n");
+        return FALSE;
+    }
+    clip->file = CreateFileW(wPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (clip->file == INVALID_HANDLE_VALUE) {
+        ReaderLog("MP4Reader: cannot open %s (error %lu)\n", path, GetLastError());
+        return FALSE;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(clip->file, &fileSize)) goto cleanup;
+
+    /* Top level by headers only: moov is read, moofs are noted for later */
+    UINT64 moovOffset = 0, moovSize = 0;
+    UINT64 offset = 0;
+    UINT64 end = (UINT64)fileSize.QuadPart;
+    while (offset + 8 <= end) {
+        BYTE header[16];
+        if (!ReadAt(clip->file, offset, header, 8)) goto cleanup;
+        UINT64 size = ((UINT32)header[0] << 24) | ((UINT32)header[1] << 16) |
+                      ((UINT32)header[2] << 8) | header[3];
+        UINT32 headerSize = 8;
+        if (size == 1) {
+            if (offset + 16 > end || !ReadAt(clip->file, offset + 8, header + 8, 8)) break;
+            size = 0;
+            for (int i = 8; i < 16; i++) size = (size << 8) | header[i];
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - offset;
+        }
+        if (size < headerSize || size > end - offset) break;  /* Truncated tail (e.g. crash) */
+
+        if (memcmp(header + 4, "moov", 4) == 0) {
+            moovOffset = offset + headerSize;
+            moovSize = size - headerSize;
+        } else if (memcmp(header + 4, "moof", 4) == 0) {
+            if (moofCount == moofCapacity) {
+                int capacity = moofCapacity ? moofCapacity * 2 : 256;
+                UINT64* grown = (UINT64*)realloc(moofs, (size_t)capacity * 2 * sizeof(UINT64));
+                if (!grown) goto cleanup;
+                moofs = grown;
+                moofCapacity = capacity;
+            }
+            moofs[moofCount * 2] = offset;
+            moofs[moofCount * 2 + 1] = size;
+            moofCount++;
+        }
+        offset += size;
+    }
+    if (moovSize == 0) {
+        ReaderLog("MP4Reader: %s has no moov\n", path);
+        goto cleanup;
+    }
+
+    moovData = ReadBox(clip->file, moovOffset, moovSize);
+    if (!moovData) goto cleanup;
+    ByteCursor moov, box;
+    Cursor_Init(&moov, moovData, (size_t)moovSize);
+
+    UINT32 movieTimescale = 0;
+    if (FindBox(&moov, "mvhd", &box)) {
+        int version = FullBoxHeader(&box, NULL);
+        Skip(&box, version ? 16 : 8);
+        movieTimescale = R32(&box);
+    }
+
+    {
+        ByteCursor c = moov;
+        char type[5];
+        while (NextBox(&c, type, &box)) {
+            if (strcmp(type, "trak") != 0 || trackCount == MAX_TRACKS) continue;
+            if (!ParseTrak(&tracks[trackCount], box, movieTimescale)) {
+                ReaderLog("MP4Reader: %s: track %d unusable\n", path, trackCount + 1);
+                trackCount++;
+                goto cleanup;
+            }
+            trackCount++;
+        }
+    }
+    if (FindBox(&moov, "mvex", &box)) ParseTrex(tracks, trackCount, box);
+
+    for (int m = 0; m < moofCount; m++) {
+        BYTE* data = ReadBox(clip->file, moofs[m * 2] + 8, moofs[m * 2 + 1] - 8);
+        if (!data) goto cleanup;
+        ByteCursor moof;
+        Cursor_Init(&moof, data, (size_t)(moofs[m * 2 + 1] - 8));
+        BOOL ok = ParseMoof(tracks, trackCount, moof, moofs[m * 2]);
+        free(data);
+        if (!ok) {
+            ReaderLog("MP4Reader: %s: fragment %d at %llu malformed\n", path, m + 1, moofs[m * 2]);
+            goto cleanup;
+        }
+    }
+
+    for (int i = 0; i < trackCount; i++) {
+        ReaderTrack* t = &tracks[i];
+        if (t->count == 0) continue;
+        /* A crash can leave the last fragment's data short */
+        while (t->count > 0 && t->entries[t->count - 1].offset + t->entries[t->count - 1].size > end) {
+            t->count--;
+        }
+        if (t->isVideo && !clip->videoSamples) {
+            if (!ExportVideo(clip, t)) goto cleanup;
+        } else if (t->isAudio && clip->audioTrackCount < MAX_AUDIO_TRACKS) {
+            if (!ExportAudio(clip, t)) goto cleanup;
+        }
+    }
+    if (clip->videoCount == 0) {
+        ReaderLog("MP4Reader: %s has no video samples\n", path);
+        goto cleanup;
+    }
+
+    result = TRUE;
+    ReaderLog("MP4Reader: %s: %d frames (%dx%d), %d audio tracks, %d fragments\n", path,
+              clip->videoCount, clip->video.width, clip->video.height, clip->audioTrackCount, moofCount);
+
+cleanup:
+    for (int i = 0; i < trackCount; i++) {
+        SAFE_FREE(tracks[i].entries);
+        SAFE_FREE(tracks[i].seqHeader);
+        SAFE_FREE(tracks[i].audioConfig);
+    }
+    SAFE_FREE(moofs);
+    SAFE_FREE(moovData);
+    if (!result) MP4Reader_Close(clip);
+    return result;
+}
+
+/* 4-byte NAL lengths -> start codes, in place */
+static BOOL LengthsToStartCodes(BYTE* data, DWORD size) {
+    DWORD pos = 0;
+    while (size - pos >= 4) {
+        DWORD len = ((DWORD)data[pos] << 24) | ((DWORD)data[pos + 1] << 16) |
+                    ((DWORD)data[pos + 2] << 8) | data[pos + 3];
+        if (len > size - pos - 4) return FALSE;
+        data[pos] = 0;
+        data[pos + 1] = 0;
+        data[pos + 2] = 0;
+        data[pos + 3] = 1;
+        pos += 4 + len;
+    }
+    return pos == size;
+}
+
+BOOL MP4Reader_Load(MP4Clip* clip, const MP4ClipRange* range) {
+    LWSR_ASSERT(clip != NULL);
+    LWSR_ASSERT(range != NULL);
+
+    if (!clip || !range || clip->file == INVALID_HANDLE_VALUE) return FALSE;
+    if (range->videoFirst < 0 || range->videoCount < 0 ||
+        range->videoFirst + range->videoCount > clip->videoCount) return FALSE;
+    for (int a = 0; a < clip->audioTrackCount; a++) {
+        if (range->audioFirst[a] < 0 || range->audioCount[a] < 0 ||
+            range->audioFirst[a] + range->audioCount[a] > clip->audioCounts[a]) return FALSE;
+    }
+
+    /* Drop the previous span's pointers (only its range: streamed writes
+     * load many small ranges of a long clip) */
+    SAFE_FREE(clip->payload);
+    const MP4ClipRange* old = &clip->loaded;
+    for (int i = old->videoFirst; i < old->videoFirst + old->videoCount; i++) clip->videoSamples[i].data = NULL;
+    for (int a = 0; a < clip->audioTrackCount; a++) {
+        for (int i = old->audioFirst[a]; i < old->audioFirst[a] + old->audioCount[a]; i++) {
+            clip->audioSamples[a][i].data = NULL;
+        }
+    }
+    ZeroMemory(&clip->loaded, sizeof(clip->loaded));
+
+    /* Interleaved chunks: one span covers every selected sample */
+    UINT64 lo = ~0ULL, hi = 0;
+    for (int i = range->videoFirst; i < range->videoFirst + range->videoCount; i++) {
+        if (clip->videoOffsets[i] < lo) lo = clip->videoOffsets[i];
+        if (clip->videoOffsets[i] + clip->videoSamples[i].size > hi) hi = clip->videoOffsets[i] + clip->videoSamples[i].size;
+    }
+    for (int a = 0; a < clip->audioTrackCount; a++) {
+        for (int i = range->audioFirst[a]; i < range->audioFirst[a] + range->audioCount[a]; i++) {
+            UINT64 o = clip->audioOffsets[a][i];
+            if (o < lo) lo = o;
+            if (o + clip->audioSamples[a][i].size > hi) hi = o + clip->audioSamples[a][i].size;
+        }
+    }
+    if (hi <= lo) return TRUE;                      /* Nothing selected */
+
+    clip->payload = (BYTE*)malloc((size_t)(hi - lo));
+    if (!clip->payload) {
+        ReaderLog("MP4Reader: failed to allocate %llu MB for %s\n", (hi - lo) / (1024 * 1024), clip->path);
+        return FALSE;
+    }
+    if (!ReadAt(clip->file, lo, clip->payload, (size_t)(hi - lo))) return FALSE;
+    clip->loaded = *range;
+
+    for (int i = range->videoFirst; i < range->videoFirst + range->videoCount; i++) {
+        MuxerSample* s = &clip->videoSamples[i];
+        s->data = clip->payload + (clip->videoOffsets[i] - lo);
+        if (clip->video.codec == CODEC_AV1) continue;  /* OBUs go back out as is */
+        if (!LengthsToStartCodes(s->data, s->size)) {
+            ReaderLog("MP4Reader: %s: frame %d is not length-prefixed HEVC\n", clip->path, i);
+            return FALSE;
+        }
+    }
+    for (int a = 0; a < clip->audioTrackCount; a++) {
+        for (int i = range->audioFirst[a]; i < range->audioFirst[a] + range->audioCount[a]; i++) {
+            clip->audioSamples[a][i].data = clip->payload + (clip->audioOffsets[a][i] - lo);
+        }
+    }
+    return TRUE;
+}
+
+void MP4Reader_Close(MP4Clip* clip) {
+    if (!clip) return;
+
+    if (clip->file != INVALID_HANDLE_VALUE) CloseHandle(clip->file);
+    clip->file = INVALID_HANDLE_VALUE;
+    SAFE_FREE(clip->payload);
+    SAFE_FREE(clip->videoSamples);
+    SAFE_FREE(clip->videoOffsets);
+    SAFE_FREE(clip->video.seqHeader);
+    for (int a = 0; a < clip->audioTrackCount; a++) {
+        SAFE_FREE(clip->audioSamples[a]);
+        SAFE_FREE(clip->audioOffsets[a]);
+        SAFE_FREE(clip->audioConfigs[a].configData);
+    }
+    clip->videoCount = 0;
+    clip->audioTrackCount = 0;
+}
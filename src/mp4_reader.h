@@ -0,0 +1,71 @@
+/*
+ * mp4_reader.h - Sample index and payload reader for MP4 files
+ *
+ * USED BY: clip_edit.c (trim / concatenate)
+ *
+ * Reads an HEVC (or AV1) + AAC MP4 back into the muxer's data model: one
+ * MuxerSample per frame and one MuxerAudioTrack per audio track, with a
+ * MuxerConfig (VPS/SPS/PPS rebuilt from hvcC, or the av1C sequence header
+ * OBU, and the codec) that MP4Writer_WriteFile accepts as is. Both layouts this app writes are understood: classic
+ * sample tables (replay saves, Media Foundation files) and fragmented
+ * moof/trun files (recordings).
+ *
+ * Opening parses the index only: every sample gets its timestamp (100ns,
+ * edit list applied), duration, size and sync flag, with data = NULL.
+ * MP4Reader_Load then reads the payload of a chosen range with one read of
+ * the byte span it covers; clip_edit.c loads one writer chunk at a time,
+ * so a long clip never has to fit in memory. Loaded video samples are
+ * Annex-B (the 4-byte length prefixes are rewritten as start codes in
+ * place), like NVENC output; AV1 samples are left as stored.
+ *
+ * Streams with composition offsets (B-frames) are refused; the writer
+ * cannot reproduce them.
+ *
+ * Not thread-safe: one thread per MP4Clip.
+ */
+
+#ifndef MP4_READER_H
+#define MP4_READER_H
+
+#include <windows.h>
+#include "mp4_muxer.h"
+#include "constants.h"
+
+// Samples to load: [first, first + count) of each track
+typedef struct {
+    int videoFirst;
+    int videoCount;
+    int audioFirst[MAX_AUDIO_TRACKS];
+    int audioCount[MAX_AUDIO_TRACKS];
+} MP4ClipRange;
+
+typedef struct {
+    MuxerConfig video;                          // seqHeader owned by the clip
+    MuxerSample* videoSamples;
+    UINT64* videoOffsets;                       // File offset of each sample
+    int videoCount;
+
+    MuxerAudioSample* audioSamples[MAX_AUDIO_TRACKS];
+    UINT64* audioOffsets[MAX_AUDIO_TRACKS];
+    MuxerAudioConfig audioConfigs[MAX_AUDIO_TRACKS];  // configData owned by the clip
+    int audioCounts[MAX_AUDIO_TRACKS];
+    int audioTrackCount;                        // Track 0 = mix, as written
+
+    BYTE* payload;                              // Last MP4Reader_Load span
+    MP4ClipRange loaded;                        // Samples whose data points into it
+    HANDLE file;
+    char path[MAX_PATH];
+} MP4Clip;
+
+// Open path (UTF-8) and index it. On failure the clip needs no Close.
+BOOL MP4Reader_Open(const char* path, MP4Clip* clip);
+
+// Read the payload of range; data pointers of those samples become valid
+// until the next Load or Close. Samples outside the range keep data = NULL.
+// An empty range just frees the previous span.
+BOOL MP4Reader_Load(MP4Clip* clip, const MP4ClipRange* range);
+
+// Free everything and close the file
+void MP4Reader_Close(MP4Clip* clip);
+
+#endif // MP4_READER_H
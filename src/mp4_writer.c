@@ -0,0 +1,1849 @@
+/*
+ * mp4_writer.c - Native ISO-BMFF writer for replay saves
+ *
+ * USED BY: replay_buffer.c (batch saves), mp4_muxer.c (fragmented streaming)
+ *
+ * Batch saves take three steps, all straight from the caller's sample arrays:
+ *   1. Plan: per-track sample sizes (measured in slices on the thread pool,
+ *      see parallel.c) and durations, then the chunk order (a k-way merge
+ *      of the tracks by time) and every chunk's file offset.
+ *   2. Build ftyp, then moov and the mdat header in memory (BoxBuf). moov
+ *      goes first (faststart), so it is rebuilt until its size, and with it
+ *      every chunk offset, is stable.
+ *   3. Stream ftyp, moov and the mdat payload (chunk by chunk) to disk
+ *      through SaveIO, preallocated to the exact file size.
+ * A streamed write (MP4Writer_WriteFileStreamed) runs the same steps over
+ * samples whose data is not in memory: the caller's fetch callback loads
+ * an MP4_FETCH_WINDOW_MB window per track for step 1 and each chunk for
+ * step 3, so the payload is read twice but never held whole.
+ *
+ * Fragmented streaming (MP4FragmentWriter) reuses the same boxes: moov with
+ * empty sample tables plus mvex up front, then one moof/mdat per GOP, each
+ * written with one WriteFile as the next keyframe arrives.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Goto-cleanup in WriteSampleFile (tables, buffers, file handle) and
+ *   MP4Writer_CreateFragmented
+ * - BoxBuf and SaveIO latch their first failure; checked once
+ * - A failed file is deleted (SaveIO_Close with keep = FALSE)
+ */
+
+#include "mp4_writer.h"
+#include "save_io.h"
+#include "parallel.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include <limits.h>
+#include <string.h>
+
+/* Alias for logging */
+#define WriterLog Logger_Log
+
+#define MOVIE_TIMESCALE     1000
+#define MDAT_HEADER_BYTES   16      /* size = 1 + 64-bit largesize */
+
+/* HEVC NAL unit types kept out of samples (parameter sets live in hvcC) */
+#define HEVC_NAL_VPS        32
+#define HEVC_NAL_SPS        33
+#define HEVC_NAL_PPS        34
+#define HEVC_NAL_AUD        35
+
+#define MAX_PARAM_SETS      8       /* Per type, in hvcC */
+
+/* AV1 OBU types the writer looks at (AV1 spec 6.2.2) */
+#define AV1_OBU_SEQUENCE_HEADER     1
+#define AV1_OBU_TEMPORAL_DELIMITER  2
+#define AV1_OBU_PADDING             15
+
+/* ============================================================================
+ * BOX BUFFER
+ * ============================================================================
+ * Growable big-endian byte buffer. A box is opened with a placeholder size
+ * that EndBox patches once its contents are in.
+ */
+
+typedef struct {
+    BYTE* data;
+    size_t size;
+    size_t capacity;
+    BOOL failed;                /* Allocation failed; later puts are dropped */
+} BoxBuf;
+
+static void Put(BoxBuf* b, const void* src, size_t n) {
+    if (b->failed || n == 0) return;
+    if (b->size + n > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 4096;
+        while (capacity < b->size + n) capacity *= 2;
+        BYTE* grown = (BYTE*)realloc(b->data, capacity);
+        if (!grown) {
+            b->failed = TRUE;
+            return;
+        }
+        b->data = grown;
+        b->capacity = capacity;
+    }
+    memcpy(b->data + b->size, src, n);
+    b->size += n;
+}
+
+static void Put8(BoxBuf* b, UINT32 v) {
+    BYTE x = (BYTE)v;
+    Put(b, &x, 1);
+}
+
+static void Put16(BoxBuf* b, UINT32 v) {
+    BYTE x[2];
+    x[0] = (BYTE)(v >> 8);
+    x[1] = (BYTE)v;
+    Put(b, x, 2);
+}
+
+static void Put24(BoxBuf* b, UINT32 v) {
+    Put8(b, v >> 16);
+    Put16(b, v & 0xFFFF);
+}
+
+static void Put32(BoxBuf* b, UINT32 v) {
+    BYTE x[4];
+    x[0] = (BYTE)(v >> 24);
+    x[1] = (BYTE)(v >> 16);
+    x[2] = (BYTE)(v >> 8);
+    x[3] = (BYTE)v;
+    Put(b, x, 4);
+}
+
+static void Put64(BoxBuf* b, UINT64 v) {
+    Put32(b, (UINT32)(v >> 32));
+    Put32(b, (UINT32)v);
+}
+
+static void PutZeros(BoxBuf* b, size_t n) {
+    static const BYTE zeros[32];
+    while (n > 0) {
+        size_t k = n < sizeof(zeros) ? n : sizeof(zeros);
+        Put(b, zeros, k);
+        n -= k;
+    }
+}
+
+static void PutType(BoxBuf* b, const char* fourcc) {
+    Put(b, fourcc, 4);
+}
+
+static void Patch32(BoxBuf* b, size_t at, UINT32 v) {
+    if (b->failed) return;
+    b->data[at] = (BYTE)(v >> 24);
+    b->data[at + 1] = (BYTE)(v >> 16);
+    b->data[at + 2] = (BYTE)(v >> 8);
+    b->data[at + 3] = (BYTE)v;
+}
+
+static size_t BeginBox(BoxBuf* b, const char* type) {
+    size_t at = b->size;
+    Put32(b, 0);
+    PutType(b, type);
+    return at;
+}
+
+static size_t BeginFullBox(BoxBuf* b, const char* type, int version, UINT32 flags) {
+    size_t at = BeginBox(b, type);
+    Put32(b, ((UINT32)version << 24) | (flags & 0xFFFFFF));
+    return at;
+}
+
+static void EndBox(BoxBuf* b, size_t at) {
+    Patch32(b, at, (UINT32)(b->size - at));
+}
+
+/* Version 1 boxes carry 64-bit times; version 0 suffices below 2^32 ticks */
+static int TimeVersion(UINT64 v) {
+    return v > 0xFFFFFFFFULL ? 1 : 0;
+}
+
+static void PutTime(BoxBuf* b, int version, UINT64 v) {
+    if (version) Put64(b, v);
+    else Put32(b, (UINT32)v);
+}
+
+/* ============================================================================
+ * AV1 OBUS
+ * ============================================================================
+ * NVENC emits low-overhead OBUs (obu_has_size_field = 1), which is already
+ * the AV1-in-ISOBMFF sample format except that samples may not carry
+ * temporal delimiters. Sequence header OBUs stay in key frames.
+ */
+
+typedef struct {
+    const BYTE* p;
+    const BYTE* end;
+} ObuCursor;
+
+/* leb128() at p: *v and the bytes it took, or 0 if malformed/truncated */
+static int ReadLeb128(const BYTE* p, const BYTE* end, UINT64* v) {
+    *v = 0;
+    for (int i = 0; i < 8 && p + i < end; i++) {
+        *v |= (UINT64)(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) return i + 1;
+    }
+    return 0;
+}
+
+/* Next whole OBU, header included. One without a size field runs to the end. */
+static BOOL NextObu(ObuCursor* c, const BYTE** obu, DWORD* len, int* type) {
+    size_t avail = (size_t)(c->end - c->p);
+    if (avail == 0) return FALSE;
+    BYTE header = c->p[0];
+    size_t headerBytes = (header & 0x04) ? 2 : 1;   /* obu_extension_flag */
+    size_t total = avail;
+    if (header & 0x02) {                            /* obu_has_size_field */
+        UINT64 payload = 0;
+        int n = headerBytes < avail ? ReadLeb128(c->p + headerBytes, c->end, &payload) : 0;
+        if (n == 0 || payload > avail - headerBytes - n) {
+            c->p = c->end;
+            return FALSE;
+        }
+        total = headerBytes + n + (size_t)payload;
+    } else if (avail < headerBytes) {
+        c->p = c->end;
+        return FALSE;
+    }
+    *obu = c->p;
+    *len = (DWORD)total;
+    *type = (header >> 3) & 0x0F;
+    c->p += total;
+    return TRUE;
+}
+
+static BOOL KeepObu(int type) {
+    return type != AV1_OBU_TEMPORAL_DELIMITER && type != AV1_OBU_PADDING;
+}
+
+static void ObuCursor_Init(ObuCursor* c, const BYTE* data, DWORD size) {
+    c->p = data;
+    c->end = data + size;
+}
+
+/* Bytes an AV1 sample takes in mdat once its temporal delimiters are gone */
+static DWORD Av1SampleBytes(const MuxerSample* s) {
+    DWORD total = 0;
+    ObuCursor c;
+    const BYTE* obu;
+    DWORD len;
+    int type;
+    ObuCursor_Init(&c, s->data, s->size);
+    while (NextObu(&c, &obu, &len, &type)) {
+        if (KeepObu(type)) total += len;
+    }
+    return total;
+}
+
+/* ============================================================================
+ * ANNEX-B NAL UNITS
+ * ============================================================================
+ */
+
+typedef struct {
+    const BYTE* p;
+    const BYTE* end;
+} NalCursor;
+
+/* First 00 00 01 at or after p, or end */
+static const BYTE* FindStartCode(const BYTE* p, const BYTE* end) {
+    for (; p + 3 <= end; p++) {
+        /* p[2] > 1 rules out a start code at p, p+1 and p+2 */
+        if (p[2] > 1) { p += 2; continue; }
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1) return p;
+    }
+    return end;
+}
+
+static void NalCursor_Init(NalCursor* c, const BYTE* data, DWORD size) {
+    c->p = data;
+    c->end = data + size;
+}
+
+/* Next NAL unit without its start code (and trailing zero bytes) */
+static BOOL NextNal(NalCursor* c, const BYTE** nal, DWORD* len) {
+    const BYTE* sc = FindStartCode(c->p, c->end);
+    if (sc == c->end) return FALSE;
+    const BYTE* start = sc + 3;
+    const BYTE* next = FindStartCode(start, c->end);
+    const BYTE* stop = next;
+    while (stop > start && stop[-1] == 0) stop--;
+    c->p = next;
+    *nal = start;
+    *len = (DWORD)(stop - start);
+    return TRUE;
+}
+
+static int NalType(const BYTE* nal) {
+    return (nal[0] >> 1) & 0x3F;
+}
+
+static BOOL IsAnnexB(const BYTE* data, DWORD size) {
+    if (!data || size < 4) return FALSE;
+    return data[0] == 0 && data[1] == 0 && (data[2] == 1 || (data[2] == 0 && data[3] == 1));
+}
+
+/* Slice and SEI NAL units stay in the sample; parameter sets and AUDs go */
+static BOOL KeepNal(const BYTE* nal, DWORD len) {
+    if (len < 2) return FALSE;
+    int type = NalType(nal);
+    return type < HEVC_NAL_VPS || type > HEVC_NAL_AUD;
+}
+
+/* Bytes the sample takes in mdat once rewritten as length-prefixed NALs */
+static DWORD VideoSampleBytes(const MuxerSample* s, VideoCodec codec) {
+    if (!s->data || s->size == 0) return 0;
+    if (codec == CODEC_AV1) return Av1SampleBytes(s);
+    if (!IsAnnexB(s->data, s->size)) return s->size;  /* Already length-prefixed */
+
+    DWORD total = 0;
+    NalCursor c;
+    const BYTE* nal;
+    DWORD len;
+    NalCursor_Init(&c, s->data, s->size);
+    while (NextNal(&c, &nal, &len)) {
+        if (KeepNal(nal, len)) total += 4 + len;
+    }
+    return total;
+}
+
+static DWORD AudioSampleBytes(const MuxerAudioSample* s) {
+    return s->data ? s->size : 0;
+}
+
+/* ============================================================================
+ * HEVC DECODER CONFIGURATION (hvcC)
+ * ============================================================================
+ */
+
+typedef struct {
+    const BYTE* data;
+    size_t bits;
+    size_t pos;
+} BitReader;
+
+static UINT32 ReadBits(BitReader* br, int n) {
+    UINT32 v = 0;
+    while (n-- > 0) {
+        UINT32 bit = 0;
+        if (br->pos < br->bits) bit = (br->data[br->pos >> 3] >> (7 - (br->pos & 7))) & 1;
+        br->pos++;
+        v = (v << 1) | bit;
+    }
+    return v;
+}
+
+static UINT32 ReadUE(BitReader* br) {
+    int zeros = 0;
+    while (ReadBits(br, 1) == 0) {
+        if (++zeros >= 32 || br->pos > br->bits) return 0;
+    }
+    return ((1u << zeros) - 1) + ReadBits(br, zeros);
+}
+
+typedef struct {
+    BYTE generalPtl[12];        /* profile_space..level_idc, as laid out in hvcC */
+    UINT32 chromaFormat;
+    UINT32 bitDepthLumaMinus8;
+    UINT32 bitDepthChromaMinus8;
+    UINT32 numTemporalLayers;
+    UINT32 temporalIdNested;
+} HevcSpsInfo;
+
+/* The few SPS fields hvcC repeats (ITU-T H.265 7.3.2.2) */
+static BOOL ParseSps(const BYTE* nal, DWORD len, HevcSpsInfo* info) {
+    BYTE rbsp[512];
+    size_t n = 0;
+    int zeros = 0;
+
+    /* Skip the 2-byte NAL header; drop emulation prevention bytes */
+    for (DWORD i = 2; i < len && n < sizeof(rbsp); i++) {
+        if (zeros >= 2 && nal[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = nal[i] == 0 ? zeros + 1 : 0;
+        rbsp[n++] = nal[i];
+    }
+    if (n < 13) return FALSE;
+
+    BitReader br;
+    br.data = rbsp;
+    br.bits = n * 8;
+    br.pos = 0;
+
+    ReadBits(&br, 4);                               /* sps_video_parameter_set_id */
+    UINT32 maxSubLayersMinus1 = ReadBits(&br, 3);
+    info->temporalIdNested = ReadBits(&br, 1);
+    info->numTemporalLayers = maxSubLayersMinus1 + 1;
+
+    /* general_profile_space .. general_level_idc: 96 bits, byte aligned */
+    memcpy(info->generalPtl, rbsp + 1, sizeof(info->generalPtl));
+    br.pos = 13 * 8;
+
+    UINT32 profilePresent[8], levelPresent[8];
+    for (UINT32 i = 0; i < maxSubLayersMinus1; i++) {
+        profilePresent[i] = ReadBits(&br, 1);
+        levelPresent[i] = ReadBits(&br, 1);
+    }
+    if (maxSubLayersMinus1 > 0) {
+        for (UINT32 i = maxSubLayersMinus1; i < 8; i++) ReadBits(&br, 2);
+    }
+    for (UINT32 i = 0; i < maxSubLayersMinus1; i++) {
+        if (profilePresent[i]) br.pos += 88;
+        if (levelPresent[i]) br.pos += 8;
+    }
+
+    ReadUE(&br);                                    /* sps_seq_parameter_set_id */
+    info->chromaFormat = ReadUE(&br);
+    if (info->chromaFormat == 3) ReadBits(&br, 1);  /* separate_colour_plane_flag */
+    ReadUE(&br);                                    /* pic_width_in_luma_samples */
+    ReadUE(&br);                                    /* pic_height_in_luma_samples */
+    if (ReadBits(&br, 1)) {                         /* conformance_window_flag */
+        for (int i = 0; i < 4; i++) ReadUE(&br);
+    }
+    info->bitDepthLumaMinus8 = ReadUE(&br);
+    info->bitDepthChromaMinus8 = ReadUE(&br);
+
+    return br.pos <= br.bits && info->chromaFormat <= 3 &&
+           info->bitDepthLumaMinus8 <= 7 && info->bitDepthChromaMinus8 <= 7;
+}
+
+/* hvcC box from an Annex-B VPS/SPS/PPS sequence header */
+static BOOL PutHvcC(BoxBuf* b, const BYTE* seqHeader, DWORD seqHeaderSize) {
+    const BYTE* sets[3][MAX_PARAM_SETS];
+    DWORD setLens[3][MAX_PARAM_SETS];
+    int setCounts[3] = {0};
+
+    NalCursor c;
+    const BYTE* nal;
+    DWORD len;
+    NalCursor_Init(&c, seqHeader, seqHeaderSize);
+    while (NextNal(&c, &nal, &len)) {
+        if (len < 2) continue;
+        int type = NalType(nal);
+        if (type < HEVC_NAL_VPS || type > HEVC_NAL_PPS) continue;
+        int t = type - HEVC_NAL_VPS;
+        if (setCounts[t] >= MAX_PARAM_SETS || len > 0xFFFF) continue;
+        sets[t][setCounts[t]] = nal;
+        setLens[t][setCounts[t]] = len;
+        setCounts[t]++;
+    }
+    if (setCounts[0] == 0 || setCounts[1] == 0 || setCounts[2] == 0) {
+        WriterLog("MP4Writer: sequence header lacks VPS/SPS/PPS (%d/%d/%d)\n",
+                  setCounts[0], setCounts[1], setCounts[2]);
+        return FALSE;
+    }
+
+    HevcSpsInfo sps;
+    if (!ParseSps(sets[1][0], setLens[1][0], &sps)) {
+        WriterLog("MP4Writer: SPS could not be parsed (%u bytes)\n", setLens[1][0]);
+        return FALSE;
+    }
+
+    size_t box = BeginBox(b, "hvcC");
+    Put8(b, 1);                                     /* configurationVersion */
+    Put(b, sps.generalPtl, sizeof(sps.generalPtl));
+    Put16(b, 0xF000);                               /* min_spatial_segmentation_idc = 0 */
+    Put8(b, 0xFC);                                  /* parallelismType = unknown */
+    Put8(b, 0xFC | sps.chromaFormat);
+    Put8(b, 0xF8 | sps.bitDepthLumaMinus8);
+    Put8(b, 0xF8 | sps.bitDepthChromaMinus8);
+    Put16(b, 0);                                    /* avgFrameRate unspecified */
+    /* constantFrameRate 0, numTemporalLayers, temporalIdNested, 4-byte lengths */
+    Put8(b, ((sps.numTemporalLayers & 7) << 3) | (sps.temporalIdNested << 2) | 3);
+    Put8(b, 3);                                     /* numOfArrays */
+    for (int t = 0; t < 3; t++) {
+        Put8(b, 0x80 | (HEVC_NAL_VPS + t));         /* array_completeness = 1 */
+        Put16(b, setCounts[t]);
+        for (int i = 0; i < setCounts[t]; i++) {
+            Put16(b, setLens[t][i]);
+            Put(b, sets[t][i], setLens[t][i]);
+        }
+    }
+    EndBox(b, box);
+    return TRUE;
+}
+
+/* ============================================================================
+ * AV1 DECODER CONFIGURATION (av1C)
+ * ============================================================================
+ */
+
+typedef struct {
+    UINT32 profile;
+    UINT32 level;               /* seq_level_idx of operating point 0 */
+    UINT32 tier;
+    UINT32 highBitdepth;
+    UINT32 twelveBit;
+    UINT32 monochrome;
+    UINT32 subsamplingX;
+    UINT32 subsamplingY;
+    UINT32 samplePosition;
+} Av1SeqInfo;
+
+/* The sequence_header_obu() fields av1C repeats (AV1 spec 5.5); most of
+   what lies between them only has to be stepped over */
+static BOOL ParseAv1SequenceHeader(const BYTE* payload, DWORD len, Av1SeqInfo* info) {
+    BitReader br;
+    br.data = payload;
+    br.bits = (size_t)len * 8;
+    br.pos = 0;
+    ZeroMemory(info, sizeof(*info));
+
+    info->profile = ReadBits(&br, 3);
+    ReadBits(&br, 1);                               /* still_picture */
+    UINT32 reduced = ReadBits(&br, 1);              /* reduced_still_picture_header */
+    if (reduced) {
+        info->level = ReadBits(&br, 5);
+    } else {
+        UINT32 decoderModel = 0, bufferDelayBits = 0;
+        if (ReadBits(&br, 1)) {                     /* timing_info_present_flag */
+            br.pos += 64;                           /* num_units_in_display_tick, time_scale */
+            if (ReadBits(&br, 1)) ReadUE(&br);      /* num_ticks_per_picture_minus_1, uvlc() */
+            decoderModel = ReadBits(&br, 1);
+            if (decoderModel) {
+                bufferDelayBits = ReadBits(&br, 5) + 1;
+                br.pos += 32 + 5 + 5;
+            }
+        }
+        UINT32 initialDisplayDelay = ReadBits(&br, 1);
+        UINT32 operatingPoints = ReadBits(&br, 5) + 1;
+        for (UINT32 i = 0; i < operatingPoints; i++) {
+            ReadBits(&br, 12);                      /* operating_point_idc */
+            UINT32 level = ReadBits(&br, 5);
+            UINT32 tier = level > 7 ? ReadBits(&br, 1) : 0;
+            if (i == 0) {
+                info->level = level;
+                info->tier = tier;
+            }
+            if (decoderModel && ReadBits(&br, 1)) br.pos += 2 * bufferDelayBits + 1;
+            if (initialDisplayDelay && ReadBits(&br, 1)) br.pos += 4;
+        }
+    }
+
+    UINT32 widthBits = ReadBits(&br, 4) + 1;
+    UINT32 heightBits = ReadBits(&br, 4) + 1;
+    br.pos += widthBits + heightBits;               /* max_frame_width/height_minus_1 */
+    if (!reduced && ReadBits(&br, 1)) br.pos += 7;  /* frame_id_numbers_present_flag */
+    br.pos += 3;                                    /* 128x128, filter_intra, intra_edge */
+    if (!reduced) {
+        br.pos += 4;                                /* interintra, masked, warped, dual_filter */
+        UINT32 orderHint = ReadBits(&br, 1);
+        if (orderHint) br.pos += 2;                 /* jnt_comp, ref_frame_mvs */
+        UINT32 screenContent = ReadBits(&br, 1) ? 2 : ReadBits(&br, 1);
+        if (screenContent > 0 && !ReadBits(&br, 1)) br.pos += 1;  /* seq_force_integer_mv */
+        if (orderHint) br.pos += 3;                 /* order_hint_bits_minus_1 */
+    }
+    br.pos += 3;                                    /* superres, cdef, restoration */
+
+    /* color_config() */
+    info->highBitdepth = ReadBits(&br, 1);
+    if (info->profile == 2 && info->highBitdepth) info->twelveBit = ReadBits(&br, 1);
+    if (info->profile != 1) info->monochrome = ReadBits(&br, 1);
+    UINT32 primaries = 2, transfer = 2, matrix = 2; /* Unspecified */
+    if (ReadBits(&br, 1)) {                         /* color_description_present_flag */
+        primaries = ReadBits(&br, 8);
+        transfer = ReadBits(&br, 8);
+        matrix = ReadBits(&br, 8);
+    }
+    if (info->monochrome) {
+        info->subsamplingX = info->subsamplingY = 1;
+    } else if (primaries == 1 && transfer == 13 && matrix == 0) {
+        /* sRGB: 4:4:4, no color_range bit */
+    } else {
+        br.pos += 1;                                /* color_range */
+        if (info->profile == 0) {
+            info->subsamplingX = info->subsamplingY = 1;
+        } else if (info->profile == 2) {
+            info->subsamplingX = info->twelveBit ? ReadBits(&br, 1) : 1;
+            info->subsamplingY = info->twelveBit && info->subsamplingX ? ReadBits(&br, 1) : 0;
+        }
+        if (info->subsamplingX && info->subsamplingY) info->samplePosition = ReadBits(&br, 2);
+    }
+
+    return br.pos <= br.bits && info->profile <= 2;
+}
+
+/* av1C box from the encoder's sequence header OBU (configOBUs carries it) */
+static BOOL PutAv1C(BoxBuf* b, const BYTE* seqHeader, DWORD seqHeaderSize) {
+    ObuCursor c;
+    const BYTE* obu = NULL;
+    DWORD len = 0;
+    int type = -1;
+    ObuCursor_Init(&c, seqHeader, seqHeaderSize);
+    while (NextObu(&c, &obu, &len, &type) && type != AV1_OBU_SEQUENCE_HEADER) {}
+    if (type != AV1_OBU_SEQUENCE_HEADER) {
+        WriterLog("MP4Writer: sequence header has no AV1 sequence header OBU\n");
+        return FALSE;
+    }
+
+    /* Payload behind the OBU header and its size field */
+    DWORD headerBytes = (obu[0] & 0x04) ? 2 : 1;
+    DWORD payloadOffset = headerBytes;
+    if (obu[0] & 0x02) {
+        UINT64 ignored;
+        payloadOffset += (DWORD)ReadLeb128(obu + headerBytes, obu + len, &ignored);
+    }
+    Av1SeqInfo seq;
+    if (payloadOffset >= len || !ParseAv1SequenceHeader(obu + payloadOffset, len - payloadOffset, &seq)) {
+        WriterLog("MP4Writer: AV1 sequence header could not be parsed (%u bytes)\n", len);
+        return FALSE;
+    }
+
+    size_t box = BeginBox(b, "av1C");
+    Put8(b, 0x81);                                  /* marker = 1, version = 1 */
+    Put8(b, (seq.profile << 5) | seq.level);
+    Put8(b, (seq.tier << 7) | (seq.highBitdepth << 6) | (seq.twelveBit << 5) |
+            (seq.monochrome << 4) | (seq.subsamplingX << 3) | (seq.subsamplingY << 2) |
+            seq.samplePosition);
+    Put8(b, 0);                                     /* initial_presentation_delay absent */
+    Put(b, obu, len);
+    EndBox(b, box);
+    return TRUE;
+}
+
+/* ============================================================================
+ * TRACK PLANNING
+ * ============================================================================
+ * All times below are either 100ns (MuxerSample units) or ticks of the
+ * track's media timescale; names say which.
+ */
+
+typedef struct {
+    BOOL isVideo;
+    int source;                 /* Fetch track: 0 = video, 1 + audioTracks index */
+    VideoCodec codec;           /* Video track only */
+    const MuxerSample* video;
+    const MuxerAudioSample* audio;
+    const MuxerAudioConfig* audioConfig;
+    int count;
+    UINT32 timescale;
+    UINT32 trackId;
+
+    DWORD* sizes;               /* Bytes each sample takes in mdat */
+    UINT32* durations;          /* Media timescale ticks */
+    LONGLONG startTs;           /* First sample's timestamp (100ns) */
+    UINT64 mediaDuration;       /* Sum of durations (ticks) */
+    UINT64 totalBytes;
+    DWORD maxSampleSize;
+} WriterTrack;
+
+/* A run of one track's samples stored contiguously in mdat */
+typedef struct {
+    int track;
+    int firstSample;
+    int sampleCount;
+    UINT64 offset;              /* File offset */
+} WriterChunk;
+
+static LONGLONG SampleTime(const WriterTrack* t, int i) {
+    return t->isVideo ? t->video[i].timestamp : t->audio[i].timestamp;
+}
+
+static LONGLONG SampleDuration(const WriterTrack* t, int i) {
+    return t->isVideo ? t->video[i].duration : t->audio[i].duration;
+}
+
+/* 100ns -> timescale ticks, rounded */
+static LONGLONG ToTicks(LONGLONG v, UINT32 timescale) {
+    return (v * (LONGLONG)timescale + MF_UNITS_PER_SECOND / 2) / MF_UNITS_PER_SECOND;
+}
+
+static UINT64 RescaleTicks(UINT64 ticks, UINT32 from, UINT32 to) {
+    return (ticks * to + from / 2) / from;
+}
+
+static BOOL AllocTrackTables(WriterTrack* t) {
+    t->sizes = (DWORD*)malloc((size_t)t->count * sizeof(DWORD));
+    t->durations = (UINT32*)malloc((size_t)t->count * sizeof(UINT32));
+    if (!t->sizes || !t->durations) {
+        WriterLog("MP4Writer: failed to allocate tables for %d samples\n", t->count);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Sample sizes for every track, MP4_PLAN_SLICE_SAMPLES per work item. For
+ * video this is the start-code scan of every frame, the only pass over the
+ * payload before it is written, so it is the part worth spreading. */
+typedef struct {
+    WriterTrack* tracks;
+    int firstItem[1 + MAX_AUDIO_TRACKS + 1];   /* Item index each track starts at */
+} SizeJob;
+
+static void MeasureSamples(WriterTrack* track, int first, int end) {
+    for (int i = first; i < end; i++) {
+        track->sizes[i] = track->isVideo ? VideoSampleBytes(&track->video[i], track->codec)
+                                         : AudioSampleBytes(&track->audio[i]);
+    }
+}
+
+static void MeasureSlice(void* context, int index) {
+    SizeJob* job = (SizeJob*)context;
+    int t = 0;
+    while (index >= job->firstItem[t + 1]) t++;
+
+    WriterTrack* track = &job->tracks[t];
+    int first = (index - job->firstItem[t]) * MP4_PLAN_SLICE_SAMPLES;
+    MeasureSamples(track, first, min(first + MP4_PLAN_SLICE_SAMPLES, track->count));
+}
+
+static void MeasureTracks(WriterTrack* tracks, int trackCount) {
+    SizeJob job;
+    job.tracks = tracks;
+    job.firstItem[0] = 0;
+    for (int t = 0; t < trackCount; t++) {
+        job.firstItem[t + 1] = job.firstItem[t] +
+                               (tracks[t].count + MP4_PLAN_SLICE_SAMPLES - 1) / MP4_PLAN_SLICE_SAMPLES;
+    }
+    Parallel_For(job.firstItem[trackCount], MeasureSlice, &job);
+}
+
+/* Streamed: the same scan over one fetched window of a track at a time */
+typedef struct {
+    WriterTrack* track;
+    int first;
+    int end;
+} WindowJob;
+
+static void MeasureWindowSlice(void* context, int index) {
+    WindowJob* job = (WindowJob*)context;
+    int first = job->first + index * MP4_PLAN_SLICE_SAMPLES;
+    MeasureSamples(job->track, first, min(first + MP4_PLAN_SLICE_SAMPLES, job->end));
+}
+
+static DWORD StoredBytes(const WriterTrack* t, int i) {
+    return t->isVideo ? t->video[i].size : t->audio[i].size;
+}
+
+static BOOL MeasureTracksStreamed(WriterTrack* tracks, int trackCount,
+                                  MP4WriterFetch fetch, void* context) {
+    const UINT64 budget = (UINT64)MP4_FETCH_WINDOW_MB * 1024 * 1024;
+    for (int t = 0; t < trackCount; t++) {
+        WindowJob job;
+        job.track = &tracks[t];
+        for (job.first = 0; job.first < tracks[t].count; job.first = job.end) {
+            UINT64 bytes = StoredBytes(&tracks[t], job.first);
+            job.end = job.first + 1;
+            while (job.end < tracks[t].count && bytes + StoredBytes(&tracks[t], job.end) <= budget) {
+                bytes += StoredBytes(&tracks[t], job.end);
+                job.end++;
+            }
+            if (!fetch(context, tracks[t].source, job.first, job.end - job.first)) {
+                WriterLog("MP4Writer: fetching samples %d-%d of track %d failed\n",
+                          job.first, job.end - 1, tracks[t].source);
+                return FALSE;
+            }
+            Parallel_For((job.end - job.first + MP4_PLAN_SLICE_SAMPLES - 1) / MP4_PLAN_SLICE_SAMPLES,
+                         MeasureWindowSlice, &job);
+        }
+    }
+    return TRUE;
+}
+
+/* Totals and durations from the measured sizes. Durations come from
+ * timestamp deltas, so rounding never accumulates and gaps in the input
+ * stay gaps in the file. */
+static void PlanTrack(WriterTrack* t) {
+    t->startTs = SampleTime(t, 0);
+    LONGLONG dtsTicks = 0;
+    for (int i = 0; i < t->count; i++) {
+        DWORD size = t->sizes[i];
+        t->totalBytes += size;
+        if (size > t->maxSampleSize) t->maxSampleSize = size;
+
+        LONGLONG endTicks;
+        if (i + 1 < t->count) {
+            endTicks = ToTicks(SampleTime(t, i + 1) - t->startTs, t->timescale);
+        } else {
+            endTicks = dtsTicks + ToTicks(SampleDuration(t, i), t->timescale);
+            if (endTicks == dtsTicks && i > 0) endTicks += t->durations[i - 1];
+        }
+        LONGLONG ticks = endTicks - dtsTicks;
+        if (ticks < 0) ticks = 0;
+        if (ticks > UINT_MAX) ticks = UINT_MAX;
+        t->durations[i] = (UINT32)ticks;
+        t->mediaDuration += (UINT64)ticks;
+        dtsTicks += ticks;
+    }
+}
+
+/* Interleave: each track is cut into runs of MP4_INTERLEAVE_MS from its
+ * next pending sample, and the runs of all tracks are merged by start time
+ * (k-way merge over a min-heap of track heads; ties go to the lower track,
+ * so video leads). */
+typedef struct {
+    LONGLONG time;              /* Next pending sample (100ns) */
+    int track;
+} MergeHead;
+
+static BOOL HeadBefore(const MergeHead* a, const MergeHead* b) {
+    return a->time < b->time || (a->time == b->time && a->track < b->track);
+}
+
+static void SiftDown(MergeHead* heap, int n, int i) {
+    for (;;) {
+        int m = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < n && HeadBefore(&heap[l], &heap[m])) m = l;
+        if (r < n && HeadBefore(&heap[r], &heap[m])) m = r;
+        if (m == i) return;
+        MergeHead tmp = heap[i];
+        heap[i] = heap[m];
+        heap[m] = tmp;
+        i = m;
+    }
+}
+
+static BOOL PlanChunks(WriterTrack* tracks, int trackCount, UINT64 payloadOffset,
+                       WriterChunk** outChunks, int* outCount) {
+    const LONGLONG window = (LONGLONG)MP4_INTERLEAVE_MS * (MF_UNITS_PER_SECOND / 1000);
+    int cursor[1 + MAX_AUDIO_TRACKS] = {0};
+    MergeHead heap[1 + MAX_AUDIO_TRACKS];
+    int heapSize = 0;
+    int capacity = 256;
+    int count = 0;
+    UINT64 offset = payloadOffset;
+
+    WriterChunk* chunks = (WriterChunk*)malloc((size_t)capacity * sizeof(WriterChunk));
+    if (!chunks) goto fail;
+
+    for (int t = 0; t < trackCount; t++) {
+        if (tracks[t].count <= 0) continue;
+        heap[heapSize].time = SampleTime(&tracks[t], 0);
+        heap[heapSize].track = t;
+        heapSize++;
+    }
+    for (int i = heapSize / 2 - 1; i >= 0; i--) SiftDown(heap, heapSize, i);
+
+    while (heapSize > 0) {
+        int t = heap[0].track;
+        int first = cursor[t];
+        LONGLONG runEnd = heap[0].time + window;
+        UINT64 chunkOffset = offset;
+        do {
+            offset += tracks[t].sizes[cursor[t]];
+            cursor[t]++;
+        } while (cursor[t] < tracks[t].count && SampleTime(&tracks[t], cursor[t]) < runEnd);
+
+        if (count == capacity) {
+            WriterChunk* grown = (WriterChunk*)realloc(chunks, (size_t)capacity * 2 * sizeof(WriterChunk));
+            if (!grown) goto fail;
+            chunks = grown;
+            capacity *= 2;
+        }
+        chunks[count].track = t;
+        chunks[count].firstSample = first;
+        chunks[count].sampleCount = cursor[t] - first;
+        chunks[count].offset = chunkOffset;
+        count++;
+
+        if (cursor[t] < tracks[t].count) {
+            heap[0].time = SampleTime(&tracks[t], cursor[t]);
+        } else {
+            heap[0] = heap[--heapSize];
+        }
+        SiftDown(heap, heapSize, 0);
+    }
+
+    *outChunks = chunks;
+    *outCount = count;
+    return TRUE;
+
+fail:
+    WriterLog("MP4Writer: failed to allocate the chunk table (%d chunks)\n", capacity);
+    SAFE_FREE(chunks);
+    return FALSE;
+}
+
+/* ============================================================================
+ * MOVIE BOXES
+ * ============================================================================
+ */
+
+static void PutFtyp(BoxBuf* b, VideoCodec codec) {
+    size_t box = BeginBox(b, "ftyp");
+    PutType(b, "isom");
+    Put32(b, 0x200);
+    PutType(b, "isom");
+    PutType(b, "iso2");
+    PutType(b, "mp41");
+    if (codec == CODEC_AV1) PutType(b, "av01");
+    EndBox(b, box);
+}
+
+static void PutMatrix(BoxBuf* b) {
+    Put32(b, 0x00010000); Put32(b, 0); Put32(b, 0);
+    Put32(b, 0); Put32(b, 0x00010000); Put32(b, 0);
+    Put32(b, 0); Put32(b, 0); Put32(b, 0x40000000);
+}
+
+static void PutMvhd(BoxBuf* b, UINT64 duration, UINT32 nextTrackId) {
+    int version = TimeVersion(duration);
+    size_t box = BeginFullBox(b, "mvhd", version, 0);
+    PutTime(b, version, 0);                         /* creation_time */
+    PutTime(b, version, 0);                         /* modification_time */
+    Put32(b, MOVIE_TIMESCALE);
+    PutTime(b, version, duration);
+    Put32(b, 0x00010000);                           /* rate 1.0 */
+    Put16(b, 0x0100);                               /* volume 1.0 */
+    PutZeros(b, 10);
+    PutMatrix(b);
+    PutZeros(b, 24);                                /* pre_defined */
+    Put32(b, nextTrackId);
+    EndBox(b, box);
+}
+
+static void PutTkhd(BoxBuf* b, const WriterTrack* t, UINT64 duration, const MuxerConfig* videoConfig) {
+    int version = TimeVersion(duration);
+    size_t box = BeginFullBox(b, "tkhd", version, 0x000003);  /* enabled, in movie */
+    PutTime(b, version, 0);
+    PutTime(b, version, 0);
+    Put32(b, t->trackId);
+    Put32(b, 0);
+    PutTime(b, version, duration);
+    PutZeros(b, 8);
+    Put16(b, 0);                                    /* layer */
+    Put16(b, t->isVideo ? 0 : 1);                   /* alternate_group */
+    Put16(b, t->isVideo ? 0 : 0x0100);              /* volume */
+    Put16(b, 0);
+    PutMatrix(b);
+    Put32(b, t->isVideo ? (UINT32)videoConfig->width << 16 : 0);
+    Put32(b, t->isVideo ? (UINT32)videoConfig->height << 16 : 0);
+    EndBox(b, box);
+}
+
+/* Edit list delaying a track that starts after the movie does */
+static void PutEdts(BoxBuf* b, UINT64 emptyDuration, UINT64 mediaDuration) {
+    int version = TimeVersion(emptyDuration) | TimeVersion(mediaDuration);
+    size_t edts = BeginBox(b, "edts");
+    size_t elst = BeginFullBox(b, "elst", version, 0);
+    Put32(b, 2);
+    PutTime(b, version, emptyDuration);
+    PutTime(b, version, version ? ~0ULL : 0xFFFFFFFFULL);  /* media_time -1: empty edit */
+    Put32(b, 0x00010000);                           /* media_rate 1.0 */
+    PutTime(b, version, mediaDuration);
+    PutTime(b, version, 0);
+    Put32(b, 0x00010000);
+    EndBox(b, elst);
+    EndBox(b, edts);
+}
+
+static void PutMdhd(BoxBuf* b, const WriterTrack* t) {
+    int version = TimeVersion(t->mediaDuration);
+    size_t box = BeginFullBox(b, "mdhd", version, 0);
+    PutTime(b, version, 0);
+    PutTime(b, version, 0);
+    Put32(b, t->timescale);
+    PutTime(b, version, t->mediaDuration);
+    Put16(b, 0x55C4);                               /* language "und" */
+    Put16(b, 0);
+    EndBox(b, box);
+}
+
+static void PutHdlr(BoxBuf* b, BOOL isVideo) {
+    const char* name = isVideo ? "VideoHandler" : "SoundHandler";
+    size_t box = BeginFullBox(b, "hdlr", 0, 0);
+    Put32(b, 0);
+    PutType(b, isVideo ? "vide" : "soun");
+    PutZeros(b, 12);
+    Put(b, name, strlen(name) + 1);
+    EndBox(b, box);
+}
+
+static void PutDinf(BoxBuf* b) {
+    size_t dinf = BeginBox(b, "dinf");
+    size_t dref = BeginFullBox(b, "dref", 0, 0);
+    Put32(b, 1);
+    EndBox(b, BeginFullBox(b, "url ", 0, 1));       /* Media is in this file */
+    EndBox(b, dref);
+    EndBox(b, dinf);
+}
+
+static BOOL PutVideoSampleEntry(BoxBuf* b, const MuxerConfig* config) {
+    size_t box = BeginBox(b, config->codec == CODEC_AV1 ? "av01" : "hvc1");
+    PutZeros(b, 6);
+    Put16(b, 1);                                    /* data_reference_index */
+    PutZeros(b, 16);                                /* pre_defined, reserved */
+    Put16(b, (UINT32)config->width);
+    Put16(b, (UINT32)config->height);
+    Put32(b, 0x00480000);                           /* 72 dpi */
+    Put32(b, 0x00480000);
+    Put32(b, 0);
+    Put16(b, 1);                                    /* frame_count */
+    PutZeros(b, 32);                                /* compressorname */
+    Put16(b, 0x0018);                               /* depth */
+    Put16(b, 0xFFFF);                               /* pre_defined = -1 */
+    if (config->codec == CODEC_AV1) {
+        if (!PutAv1C(b, config->seqHeader, config->seqHeaderSize)) return FALSE;
+    } else {
+        if (!PutHvcC(b, config->seqHeader, config->seqHeaderSize)) return FALSE;
+    }
+    EndBox(b, box);
+    return TRUE;
+}
+
+/* MPEG-4 descriptor header, 4-byte length form */
+static void PutDescriptor(BoxBuf* b, int tag, UINT32 len) {
+    Put8(b, (UINT32)tag);
+    Put8(b, 0x80 | ((len >> 21) & 0x7F));
+    Put8(b, 0x80 | ((len >> 14) & 0x7F));
+    Put8(b, 0x80 | ((len >> 7) & 0x7F));
+    Put8(b, len & 0x7F);
+}
+
+static void PutAudioSampleEntry(BoxBuf* b, const WriterTrack* t) {
+    const MuxerAudioConfig* config = t->audioConfig;
+    UINT32 dsiLen = (UINT32)config->configSize;
+    UINT32 dcdLen = 13 + 5 + dsiLen;
+    UINT32 esLen = 3 + 5 + dcdLen + 5 + 1;
+    UINT32 avgBitrate = t->mediaDuration > 0
+        ? (UINT32)(t->totalBytes * 8 * t->timescale / t->mediaDuration)
+        : (UINT32)config->bitrate;
+
+    size_t box = BeginBox(b, "mp4a");
+    PutZeros(b, 6);
+    Put16(b, 1);                                    /* data_reference_index */
+    PutZeros(b, 8);
+    Put16(b, (UINT32)config->channels);
+    Put16(b, 16);                                   /* samplesize */
+    Put16(b, 0);
+    Put16(b, 0);
+    Put32(b, (UINT32)config->sampleRate << 16);
+
+    size_t esds = BeginFullBox(b, "esds", 0, 0);
+    PutDescriptor(b, 0x03, esLen);                  /* ES_Descriptor */
+    Put16(b, t->trackId);
+    Put8(b, 0);
+    PutDescriptor(b, 0x04, dcdLen);                 /* DecoderConfigDescriptor */
+    Put8(b, 0x40);                                  /* MPEG-4 Audio */
+    Put8(b, 0x15);                                  /* AudioStream, reserved bit */
+    Put24(b, t->maxSampleSize);                     /* bufferSizeDB */
+    Put32(b, (UINT32)config->bitrate > avgBitrate ? (UINT32)config->bitrate : avgBitrate);
+    Put32(b, avgBitrate);
+    PutDescriptor(b, 0x05, dsiLen);                 /* AudioSpecificConfig */
+    Put(b, config->configData, dsiLen);
+    PutDescriptor(b, 0x06, 1);                      /* SLConfigDescriptor */
+    Put8(b, 0x02);
+    EndBox(b, esds);
+    EndBox(b, box);
+}
+
+static BOOL PutStbl(BoxBuf* b, const WriterTrack* t, int trackIndex,
+                    const WriterChunk* chunks, int chunkCount, const MuxerConfig* videoConfig) {
+    size_t stbl = BeginBox(b, "stbl");
+
+    size_t stsd = BeginFullBox(b, "stsd", 0, 0);
+    Put32(b, 1);
+    if (t->isVideo) {
+        if (!PutVideoSampleEntry(b, videoConfig)) return FALSE;
+    } else {
+        PutAudioSampleEntry(b, t);
+    }
+    EndBox(b, stsd);
+
+    /* Decoding time to sample, run-length */
+    size_t stts = BeginFullBox(b, "stts", 0, 0);
+    size_t runsAt = b->size;
+    UINT32 runs = 0;
+    Put32(b, 0);
+    for (int i = 0; i < t->count; ) {
+        int j = i + 1;
+        while (j < t->count && t->durations[j] == t->durations[i]) j++;
+        Put32(b, (UINT32)(j - i));
+        Put32(b, t->durations[i]);
+        runs++;
+        i = j;
+    }
+    Patch32(b, runsAt, runs);
+    EndBox(b, stts);
+
+    /* Sync samples (omitted when every sample is one, e.g. audio) */
+    if (t->isVideo) {
+        int keyframes = 0;
+        for (int i = 0; i < t->count; i++) if (t->video[i].isKeyframe) keyframes++;
+        if (keyframes < t->count) {
+            size_t stss = BeginFullBox(b, "stss", 0, 0);
+            Put32(b, (UINT32)keyframes);
+            for (int i = 0; i < t->count; i++) {
+                if (t->video[i].isKeyframe) Put32(b, (UINT32)i + 1);
+            }
+            EndBox(b, stss);
+        }
+    }
+
+    /* Sample to chunk, run-length over this track's chunks */
+    size_t stsc = BeginFullBox(b, "stsc", 0, 0);
+    runsAt = b->size;
+    runs = 0;
+    Put32(b, 0);
+    {
+        UINT32 chunkNumber = 0;
+        int lastCount = -1;
+        BOOL needCo64 = FALSE;
+        for (int c = 0; c < chunkCount; c++) {
+            if (chunks[c].track != trackIndex) continue;
+            chunkNumber++;
+            if (chunks[c].sampleCount != lastCount) {
+                Put32(b, chunkNumber);
+                Put32(b, (UINT32)chunks[c].sampleCount);
+                Put32(b, 1);                        /* sample_description_index */
+                lastCount = chunks[c].sampleCount;
+                runs++;
+            }
+            if (chunks[c].offset > 0xFFFFFFFFULL) needCo64 = TRUE;
+        }
+        Patch32(b, runsAt, runs);
+        EndBox(b, stsc);
+
+        size_t stsz = BeginFullBox(b, "stsz", 0, 0);
+        Put32(b, 0);                                /* sizes vary */
+        Put32(b, (UINT32)t->count);
+        for (int i = 0; i < t->count; i++) Put32(b, t->sizes[i]);
+        EndBox(b, stsz);
+
+        size_t stco = BeginFullBox(b, needCo64 ? "co64" : "stco", 0, 0);
+        Put32(b, chunkNumber);
+        for (int c = 0; c < chunkCount; c++) {
+            if (chunks[c].track != trackIndex) continue;
+            if (needCo64) Put64(b, chunks[c].offset);
+            else Put32(b, (UINT32)chunks[c].offset);
+        }
+        EndBox(b, stco);
+    }
+
+    EndBox(b, stbl);
+    return TRUE;
+}
+
+/* Fragment defaults: audio samples are all sync samples, video ones are not
+ * unless their trun entry says so */
+#define SAMPLE_FLAGS_SYNC       0x02000000  /* sample_depends_on = 2 */
+#define SAMPLE_FLAGS_NON_SYNC   0x01010000  /* depends_on = 1, is_non_sync */
+
+static void PutMvex(BoxBuf* b, const WriterTrack* tracks, int trackCount) {
+    size_t mvex = BeginBox(b, "mvex");
+    for (int t = 0; t < trackCount; t++) {
+        size_t trex = BeginFullBox(b, "trex", 0, 0);
+        Put32(b, tracks[t].trackId);
+        Put32(b, 1);                                /* default_sample_description_index */
+        Put32(b, 0);                                /* default_sample_duration */
+        Put32(b, 0);                                /* default_sample_size */
+        Put32(b, tracks[t].isVideo ? SAMPLE_FLAGS_NON_SYNC : SAMPLE_FLAGS_SYNC);
+        EndBox(b, trex);
+    }
+    EndBox(b, mvex);
+}
+
+/* Cover art and thumbnails (see mp4_writer.h). Nothing when there are none. */
+static void PutUdta(BoxBuf* b, const MuxerConfig* videoConfig) {
+    const MuxerImage* poster = videoConfig->poster;
+    BOOL havePoster = poster && poster->data && poster->size > 0;
+    BOOL haveThumbs = videoConfig->thumbnails && videoConfig->thumbnailCount > 0;
+    if (!havePoster && !haveThumbs) return;
+
+    size_t udta = BeginBox(b, "udta");
+    if (havePoster) {
+        size_t meta = BeginFullBox(b, "meta", 0, 0);
+        size_t hdlr = BeginFullBox(b, "hdlr", 0, 0);
+        Put32(b, 0);
+        PutType(b, "mdir");
+        PutType(b, "appl");
+        PutZeros(b, 8);
+        Put8(b, 0);                                 /* empty name */
+        EndBox(b, hdlr);
+        size_t ilst = BeginBox(b, "ilst");
+        size_t covr = BeginBox(b, "covr");
+        size_t data = BeginBox(b, "data");
+        Put32(b, 13);                               /* well-known type: JPEG */
+        Put32(b, 0);                                /* locale */
+        Put(b, poster->data, poster->size);
+        EndBox(b, data);
+        EndBox(b, covr);
+        EndBox(b, ilst);
+        EndBox(b, meta);
+    }
+    if (haveThumbs) {
+        size_t lwth = BeginFullBox(b, "lwth", 0, 0);
+        Put32(b, (UINT32)videoConfig->thumbnailCount);
+        for (int i = 0; i < videoConfig->thumbnailCount; i++) {
+            const MuxerImage* thumb = &videoConfig->thumbnails[i];
+            Put32(b, (UINT32)ToTicks(thumb->timestamp, MOVIE_TIMESCALE));
+            Put32(b, thumb->size);
+            Put(b, thumb->data, thumb->size);
+        }
+        EndBox(b, lwth);
+    }
+    EndBox(b, udta);
+}
+
+/* fragmented: samples live in moof/mdat pairs; the tracks here have none
+ * and mvex announces the fragments */
+static BOOL PutMoov(BoxBuf* b, const WriterTrack* tracks, int trackCount,
+                    const WriterChunk* chunks, int chunkCount, const MuxerConfig* videoConfig,
+                    BOOL fragmented) {
+    /* Movie time 0 is the earliest first sample of any track */
+    LONGLONG movieStart = LLONG_MAX;
+    for (int t = 0; t < trackCount; t++) {
+        if (tracks[t].startTs < movieStart) movieStart = tracks[t].startTs;
+    }
+
+    UINT64 emptyDurations[1 + MAX_AUDIO_TRACKS];
+    UINT64 trackDurations[1 + MAX_AUDIO_TRACKS];
+    UINT64 movieDuration = 0;
+    for (int t = 0; t < trackCount; t++) {
+        emptyDurations[t] = (UINT64)ToTicks(tracks[t].startTs - movieStart, MOVIE_TIMESCALE);
+        trackDurations[t] = RescaleTicks(tracks[t].mediaDuration, tracks[t].timescale, MOVIE_TIMESCALE);
+        if (emptyDurations[t] + trackDurations[t] > movieDuration) {
+            movieDuration = emptyDurations[t] + trackDurations[t];
+        }
+    }
+
+    size_t moov = BeginBox(b, "moov");
+    PutMvhd(b, movieDuration, (UINT32)trackCount + 1);
+
+    for (int t = 0; t < trackCount; t++) {
+        const WriterTrack* track = &tracks[t];
+        size_t trak = BeginBox(b, "trak");
+        PutTkhd(b, track, emptyDurations[t] + trackDurations[t], videoConfig);
+        if (emptyDurations[t] > 0) PutEdts(b, emptyDurations[t], trackDurations[t]);
+
+        size_t mdia = BeginBox(b, "mdia");
+        PutMdhd(b, track);
+        PutHdlr(b, track->isVideo);
+
+        size_t minf = BeginBox(b, "minf");
+        if (track->isVideo) {
+            size_t vmhd = BeginFullBox(b, "vmhd", 0, 1);
+            PutZeros(b, 8);                         /* graphicsmode, opcolor */
+            EndBox(b, vmhd);
+        } else {
+            size_t smhd = BeginFullBox(b, "smhd", 0, 0);
+            PutZeros(b, 4);                         /* balance, reserved */
+            EndBox(b, smhd);
+        }
+        PutDinf(b);
+        if (!PutStbl(b, track, t, chunks, chunkCount, videoConfig)) return FALSE;
+        EndBox(b, minf);
+        EndBox(b, mdia);
+        EndBox(b, trak);
+    }
+
+    if (fragmented) PutMvex(b, tracks, trackCount);
+    else PutUdta(b, videoConfig);
+    EndBox(b, moov);
+    return TRUE;
+}
+
+/* Length-prefixed NAL units (AV1: OBUs) of one frame. Mirrors VideoSampleBytes. */
+static void WriteVideoSample(SaveIO* io, const MuxerSample* s, VideoCodec codec) {
+    if (!s->data || s->size == 0) return;
+    if (codec == CODEC_AV1) {
+        ObuCursor c;
+        const BYTE* obu;
+        DWORD len;
+        int type;
+        ObuCursor_Init(&c, s->data, s->size);
+        while (NextObu(&c, &obu, &len, &type)) {
+            if (KeepObu(type)) SaveIO_Write(io, obu, len);
+        }
+        return;
+    }
+    if (!IsAnnexB(s->data, s->size)) {
+        SaveIO_Write(io, s->data, s->size);
+        return;
+    }
+
+    NalCursor c;
+    const BYTE* nal;
+    DWORD len;
+    NalCursor_Init(&c, s->data, s->size);
+    while (NextNal(&c, &nal, &len)) {
+        if (!KeepNal(nal, len)) continue;
+        BYTE prefix[4];
+        prefix[0] = (BYTE)(len >> 24);
+        prefix[1] = (BYTE)(len >> 16);
+        prefix[2] = (BYTE)(len >> 8);
+        prefix[3] = (BYTE)len;
+        SaveIO_Write(io, prefix, sizeof(prefix));
+        SaveIO_Write(io, nal, len);
+    }
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: WriteSampleFile
+ * Resources: 5 - per-track tables, chunk table, header and moov buffers,
+ *            output file (SaveIO)
+ * Pattern: goto-cleanup; the file is deleted unless everything was written
+ * Init: ZeroMemory ensures NULL initialization
+ */
+static BOOL WriteSampleFile(
+    const char* outputPath,
+    const MuxerSample* videoSamples,
+    int videoSampleCount,
+    const MuxerConfig* videoConfig,
+    const MuxerAudioTrack* audioTracks,
+    int audioTrackCount,
+    MP4WriterFetch fetch,
+    void* context)
+{
+    LWSR_ASSERT(outputPath != NULL);
+    LWSR_ASSERT(videoSamples != NULL);
+    LWSR_ASSERT(videoSampleCount > 0);
+    LWSR_ASSERT(videoConfig != NULL);
+
+    if (!outputPath || !videoSamples || videoSampleCount <= 0 || !videoConfig) return FALSE;
+    if (!videoConfig->seqHeader || videoConfig->seqHeaderSize == 0) {
+        WriterLog("MP4Writer: no sequence header, cannot build hvcC / av1C\n");
+        return FALSE;
+    }
+    if (!audioTracks) audioTrackCount = 0;
+    if (audioTrackCount > MAX_AUDIO_TRACKS) audioTrackCount = MAX_AUDIO_TRACKS;
+
+    BOOL result = FALSE;
+    WriterTrack tracks[1 + MAX_AUDIO_TRACKS];
+    int trackCount = 0;
+    WriterChunk* chunks = NULL;
+    int chunkCount = 0;
+    BoxBuf head;
+    BoxBuf moov;
+    SaveIO io;
+    BOOL ioOpen = FALSE;
+    WCHAR wPath[MAX_PATH];
+    DWORD startTick = GetTickCount();
+
+    ZeroMemory(tracks, sizeof(tracks));
+    ZeroMemory(&head, sizeof(head));
+    ZeroMemory(&moov, sizeof(moov));
+
+    if (MultiByteToWideChar(CP_UTF8, 0, outputPath, -1, wPath, MAX_PATH) == 0) {
+        WriterLog("MP4Writer: MultiByteToWideChar failed (path too long or invalid UTF-8)\n");
+        return FALSE;
+    }
+
+    tracks[0].isVideo = TRUE;
+    tracks[0].codec = videoConfig->codec;
+    tracks[0].video = videoSamples;
+    tracks[0].count = videoSampleCount;
+    tracks[0].timescale = MP4_VIDEO_TIMESCALE;
+    tracks[0].trackId = 1;
+    trackCount = 1;
+    for (int t = 0; t < audioTrackCount; t++) {
+        const MuxerAudioTrack* src = &audioTracks[t];
+        if (!src->samples || src->sampleCount <= 0) continue;
+        if (!src->config.configData || src->config.configSize <= 0 || src->config.sampleRate <= 0) continue;
+
+        WriterTrack* dst = &tracks[trackCount];
+        dst->source = t + 1;
+        dst->audio = src->samples;
+        dst->count = src->sampleCount;
+        dst->audioConfig = &src->config;
+        dst->timescale = (UINT32)src->config.sampleRate;
+        dst->trackId = (UINT32)trackCount + 1;
+        trackCount++;
+    }
+
+    for (int t = 0; t < trackCount; t++) {
+        if (!AllocTrackTables(&tracks[t])) goto cleanup;
+    }
+    if (!fetch) {
+        MeasureTracks(tracks, trackCount);
+    } else if (!MeasureTracksStreamed(tracks, trackCount, fetch, context)) {
+        goto cleanup;
+    }
+
+    UINT64 payloadBytes = 0;
+    for (int t = 0; t < trackCount; t++) {
+        PlanTrack(&tracks[t]);
+        payloadBytes += tracks[t].totalBytes;
+    }
+
+    PutFtyp(&head, videoConfig->codec);
+    if (head.failed) {
+        WriterLog("MP4Writer: failed to allocate the file header\n");
+        goto cleanup;
+    }
+
+    /* Faststart: moov precedes mdat, so chunk offsets depend on moov's own
+     * size. Rebuild it until that settles; only stco -> co64 can change it,
+     * so the second pass normally confirms the first. */
+    if (!PlanChunks(tracks, trackCount, 0, &chunks, &chunkCount)) goto cleanup;
+    {
+        UINT64 payloadOffset = 0;
+        size_t moovSize = 0;
+        BOOL settled = FALSE;
+        for (int pass = 0; pass < 4 && !settled; pass++) {
+            UINT64 offset = head.size + moovSize + MDAT_HEADER_BYTES;
+            for (int c = 0; c < chunkCount; c++) chunks[c].offset += offset - payloadOffset;
+            payloadOffset = offset;
+
+            moov.size = 0;
+            if (!PutMoov(&moov, tracks, trackCount, chunks, chunkCount, videoConfig, FALSE)) goto cleanup;
+            if (moov.failed) {
+                WriterLog("MP4Writer: failed to allocate moov\n");
+                goto cleanup;
+            }
+            settled = (moov.size == moovSize);
+            moovSize = moov.size;
+        }
+        if (!settled) {
+            WriterLog("MP4Writer: moov size did not settle (%zu bytes)\n", moovSize);
+            goto cleanup;
+        }
+    }
+    Put32(&moov, 1);
+    PutType(&moov, "mdat");
+    Put64(&moov, MDAT_HEADER_BYTES + payloadBytes);
+    if (moov.failed) {
+        WriterLog("MP4Writer: failed to allocate moov\n");
+        goto cleanup;
+    }
+
+    UINT64 fileBytes = head.size + moov.size + payloadBytes;
+    if (!SaveIO_Open(&io, wPath, fileBytes)) {
+        WriterLog("MP4Writer: cannot create %s\n", outputPath);
+        goto cleanup;
+    }
+    ioOpen = TRUE;
+
+    SaveIO_Write(&io, head.data, head.size);
+    SaveIO_Write(&io, moov.data, moov.size);        /* moov + mdat header */
+    for (int c = 0; c < chunkCount && !io.failed; c++) {
+        const WriterTrack* t = &tracks[chunks[c].track];
+        int end = chunks[c].firstSample + chunks[c].sampleCount;
+        if (fetch && !fetch(context, t->source, chunks[c].firstSample, chunks[c].sampleCount)) {
+            WriterLog("MP4Writer: fetching chunk %d of %d failed\n", c, chunkCount);
+            goto cleanup;
+        }
+        for (int i = chunks[c].firstSample; i < end; i++) {
+            if (t->isVideo) {
+                WriteVideoSample(&io, &t->video[i], t->codec);
+            } else if (t->sizes[i] > 0) {
+                SaveIO_Write(&io, t->audio[i].data, t->sizes[i]);
+            }
+        }
+    }
+    if (io.failed) goto cleanup;
+
+    if (io.written != fileBytes) {
+        WriterLog("MP4Writer: wrote %llu bytes, planned %llu\n", io.written, fileBytes);
+        goto cleanup;
+    }
+
+    ioOpen = FALSE;
+    if (!SaveIO_Close(&io, TRUE)) goto cleanup;
+
+    result = TRUE;
+    WriterLog("MP4Writer: %s: %d frames + %d audio tracks, %llu MB in %u ms (%d chunks, %s, %s)\n",
+              outputPath, videoSampleCount, trackCount - 1, fileBytes / (1024 * 1024),
+              GetTickCount() - startTick, chunkCount, io.unbuffered ? "unbuffered" : "buffered",
+              io.overlapped ? "overlapped" : "sequential");
+
+cleanup:
+    if (ioOpen) SaveIO_Close(&io, FALSE);
+    SAFE_FREE(moov.data);
+    SAFE_FREE(head.data);
+    SAFE_FREE(chunks);
+    for (int t = 0; t < trackCount; t++) {
+        SAFE_FREE(tracks[t].sizes);
+        SAFE_FREE(tracks[t].durations);
+    }
+    return result;
+}
+
+BOOL MP4Writer_WriteFile(
+    const char* outputPath,
+    const MuxerSample* videoSamples,
+    int videoSampleCount,
+    const MuxerConfig* videoConfig,
+    const MuxerAudioTrack* audioTracks,
+    int audioTrackCount)
+{
+    return WriteSampleFile(outputPath, videoSamples, videoSampleCount, videoConfig,
+                           audioTracks, audioTrackCount, NULL, NULL);
+}
+
+BOOL MP4Writer_WriteFileStreamed(
+    const char* outputPath,
+    const MuxerSample* videoSamples,
+    int videoSampleCount,
+    const MuxerConfig* videoConfig,
+    const MuxerAudioTrack* audioTracks,
+    int audioTrackCount,
+    MP4WriterFetch fetch,
+    void* context)
+{
+    LWSR_ASSERT(fetch != NULL);
+    if (!fetch) return FALSE;
+    return WriteSampleFile(outputPath, videoSamples, videoSampleCount, videoConfig,
+                           audioTracks, audioTrackCount, fetch, context);
+}
+
+/* ============================================================================
+ * FRAGMENTED STREAMING
+ * ============================================================================
+ * Samples of the open fragment are kept as (time, size, flags) plus their
+ * mdat bytes; a video keyframe closes the fragment. Memory is one GOP's
+ * worth, whatever the recording length.
+ */
+
+typedef struct {
+    LONGLONG timestamp;         /* 100ns */
+    LONGLONG duration;          /* 100ns, used for the last sample only */
+    DWORD size;
+    BOOL isKeyframe;
+} FragmentSample;
+
+typedef struct {
+    WriterTrack track;          /* Sample entry fields; count stays 0 */
+    FragmentSample* samples;
+    int count;
+    int capacity;
+    BoxBuf payload;             /* This fragment's mdat bytes */
+    UINT64 totalSamples;
+} FragmentTrack;
+
+struct MP4FragmentWriter {
+    HANDLE file;
+    FragmentTrack tracks[2];    /* Video, then optional audio */
+    int trackCount;
+    BoxBuf moof;
+    BOOL started;               /* First keyframe written; origin valid */
+    LONGLONG originTs;          /* Its timestamp = media time 0 */
+    UINT32 sequence;            /* mfhd sequence_number of the last fragment */
+    UINT64 fileBytes;
+    BOOL failed;                /* First write error latched */
+    char path[MAX_PATH];
+};
+
+/* Length-prefixed NAL units (AV1: OBUs) of one frame into b. Mirrors VideoSampleBytes. */
+static void PutVideoSample(BoxBuf* b, const MuxerSample* s, VideoCodec codec) {
+    if (codec == CODEC_AV1) {
+        ObuCursor c;
+        const BYTE* obu;
+        DWORD len;
+        int type;
+        ObuCursor_Init(&c, s->data, s->size);
+        while (NextObu(&c, &obu, &len, &type)) {
+            if (KeepObu(type)) Put(b, obu, len);
+        }
+        return;
+    }
+    if (!IsAnnexB(s->data, s->size)) {
+        Put(b, s->data, s->size);
+        return;
+    }
+
+    NalCursor c;
+    const BYTE* nal;
+    DWORD len;
+    NalCursor_Init(&c, s->data, s->size);
+    while (NextNal(&c, &nal, &len)) {
+        if (!KeepNal(nal, len)) continue;
+        Put32(b, len);
+        Put(b, nal, len);
+    }
+}
+
+static BOOL WriteAll(MP4FragmentWriter* w, const void* data, size_t size) {
+    if (w->failed || size == 0) return !w->failed;
+    DWORD done = 0;
+    if (!WriteFile(w->file, data, (DWORD)size, &done, NULL) || done != size) {
+        WriterLog("MP4Writer: fragment write failed at %llu (error %lu)\n", w->fileBytes, GetLastError());
+        w->failed = TRUE;
+        return FALSE;
+    }
+    w->fileBytes += size;
+    return TRUE;
+}
+
+static FragmentSample* AddFragmentSample(MP4FragmentWriter* w, FragmentTrack* ft) {
+    if (ft->count == ft->capacity) {
+        int capacity = ft->capacity ? ft->capacity * 2 : 64;
+        FragmentSample* grown = (FragmentSample*)realloc(ft->samples, (size_t)capacity * sizeof(FragmentSample));
+        if (!grown) {
+            WriterLog("MP4Writer: failed to grow the fragment sample list (%d)\n", capacity);
+            w->failed = TRUE;
+            return NULL;
+        }
+        ft->samples = grown;
+        ft->capacity = capacity;
+    }
+    return &ft->samples[ft->count++];
+}
+
+/* Media ticks since the origin; never negative */
+static LONGLONG FragmentTicks(const MP4FragmentWriter* w, const FragmentTrack* ft, LONGLONG ts) {
+    LONGLONG ticks = ToTicks(ts - w->originTs, ft->track.timescale);
+    return ticks > 0 ? ticks : 0;
+}
+
+/* One traf. Durations come from timestamp deltas like PlanTrack; the last
+ * sample ends at endTs when the caller knows it (the next keyframe;
+ * LLONG_MIN if not), otherwise after its own duration. Returns where trun's data_offset goes. */
+static size_t PutTraf(MP4FragmentWriter* w, const FragmentTrack* ft, LONGLONG endTs) {
+    BoxBuf* b = &w->moof;
+    const WriterTrack* t = &ft->track;
+    BOOL isVideo = t->isVideo;
+
+    size_t traf = BeginBox(b, "traf");
+    size_t tfhd = BeginFullBox(b, "tfhd", 0, 0x020000);  /* default-base-is-moof */
+    Put32(b, t->trackId);
+    EndBox(b, tfhd);
+
+    LONGLONG baseTicks = FragmentTicks(w, ft, ft->samples[0].timestamp);
+    size_t tfdt = BeginFullBox(b, "tfdt", 1, 0);
+    Put64(b, (UINT64)baseTicks);
+    EndBox(b, tfdt);
+
+    /* data-offset, sample-duration, sample-size (+ sample-flags for video) */
+    size_t trun = BeginFullBox(b, "trun", 0, isVideo ? 0x000701 : 0x000301);
+    Put32(b, (UINT32)ft->count);
+    size_t dataOffsetAt = b->size;
+    Put32(b, 0);
+
+    LONGLONG dtsTicks = baseTicks;
+    UINT32 lastTicks = 0;
+    for (int i = 0; i < ft->count; i++) {
+        const FragmentSample* s = &ft->samples[i];
+        LONGLONG endTicks;
+        if (i + 1 < ft->count) {
+            endTicks = FragmentTicks(w, ft, ft->samples[i + 1].timestamp);
+        } else if (endTs > s->timestamp) {
+            endTicks = FragmentTicks(w, ft, endTs);
+        } else {
+            endTicks = dtsTicks + ToTicks(s->duration, t->timescale);
+            if (endTicks == dtsTicks) endTicks += lastTicks;
+        }
+        LONGLONG ticks = endTicks - dtsTicks;
+        if (ticks < 0) ticks = 0;
+        if (ticks > UINT_MAX) ticks = UINT_MAX;
+        dtsTicks += ticks;
+        lastTicks = (UINT32)ticks;
+
+        Put32(b, (UINT32)ticks);
+        Put32(b, s->size);
+        if (isVideo) Put32(b, s->isKeyframe ? SAMPLE_FLAGS_SYNC : SAMPLE_FLAGS_NON_SYNC);
+    }
+    EndBox(b, trun);
+    EndBox(b, traf);
+    return dataOffsetAt;
+}
+
+/* Write the open fragment (moof + mdat) and start an empty one. endTs is
+ * the keyframe that closes it (LLONG_MIN at close). */
+static BOOL FlushFragment(MP4FragmentWriter* w, LONGLONG endTs) {
+    size_t dataOffsetAt[2] = {0};
+    UINT64 payloadBytes = 0;
+    BOOL any = FALSE;
+
+    for (int t = 0; t < w->trackCount; t++) {
+        if (w->tracks[t].count > 0) any = TRUE;
+    }
+    if (!any || w->failed) return !w->failed;
+
+    w->moof.size = 0;
+    size_t moof = BeginBox(&w->moof, "moof");
+    size_t mfhd = BeginFullBox(&w->moof, "mfhd", 0, 0);
+    Put32(&w->moof, ++w->sequence);
+    EndBox(&w->moof, mfhd);
+    for (int t = 0; t < w->trackCount; t++) {
+        /* Audio runs past the keyframe: its last sample keeps its duration */
+        LONGLONG trackEnd = w->tracks[t].track.isVideo ? endTs : LLONG_MIN;
+        if (w->tracks[t].count > 0) dataOffsetAt[t] = PutTraf(w, &w->tracks[t], trackEnd);
+    }
+    EndBox(&w->moof, moof);
+
+    /* Each trun's data starts after moof, the mdat header and the earlier tracks */
+    for (int t = 0; t < w->trackCount; t++) {
+        if (w->tracks[t].count == 0) continue;
+        Patch32(&w->moof, dataOffsetAt[t], (UINT32)(w->moof.size + 8 + payloadBytes));
+        payloadBytes += w->tracks[t].payload.size;
+    }
+    Put32(&w->moof, (UINT32)(8 + payloadBytes));
+    PutType(&w->moof, "mdat");
+
+    BOOL bufferFailed = w->moof.failed;
+    for (int t = 0; t < w->trackCount; t++) {
+        if (w->tracks[t].payload.failed) bufferFailed = TRUE;
+    }
+    if (bufferFailed || payloadBytes > 0xFFFFFFF0ULL) {
+        WriterLog("MP4Writer: fragment %u could not be built (%llu payload bytes)\n",
+                  w->sequence, payloadBytes);
+        w->failed = TRUE;
+        return FALSE;
+    }
+
+    WriteAll(w, w->moof.data, w->moof.size);
+    for (int t = 0; t < w->trackCount; t++) {
+        FragmentTrack* ft = &w->tracks[t];
+        WriteAll(w, ft->payload.data, ft->payload.size);
+        ft->totalSamples += (UINT64)ft->count;
+        ft->count = 0;
+        ft->payload.size = 0;
+    }
+    return !w->failed;
+}
+
+static void FreeFragmentWriter(MP4FragmentWriter* w) {
+    if (w->file != INVALID_HANDLE_VALUE) CloseHandle(w->file);
+    for (int t = 0; t < w->trackCount; t++) {
+        SAFE_FREE(w->tracks[t].samples);
+        SAFE_FREE(w->tracks[t].payload.data);
+    }
+    SAFE_FREE(w->moof.data);
+    free(w);
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: MP4Writer_CreateFragmented
+ * Resources: 3 - writer (calloc), header buffer, output file
+ * Pattern: goto-cleanup; a failed create deletes the file
+ * Init: calloc ensures NULL initialization
+ */
+MP4FragmentWriter* MP4Writer_CreateFragmented(
+    const char* outputPath,
+    const MuxerConfig* videoConfig,
+    const MuxerAudioConfig* audioConfig)
+{
+    LWSR_ASSERT(outputPath != NULL);
+    LWSR_ASSERT(videoConfig != NULL);
+
+    if (!outputPath || !videoConfig) return NULL;
+    if (!videoConfig->seqHeader || videoConfig->seqHeaderSize == 0) {
+        WriterLog("MP4Writer: no sequence header, cannot build hvcC / av1C\n");
+        return NULL;
+    }
+
+    WCHAR wPath[MAX_PATH];
+    if (MultiByteToWideChar(CP_UTF8, 0, outputPath, -1, wPath, MAX_PATH) == 0) {
+        WriterLog("MP4Writer: MultiByteToWideChar failed (path too long or invalid UTF-8)\n");
+        return NULL;
+    }
+
+    MP4FragmentWriter* w = (MP4FragmentWriter*)calloc(1, sizeof(MP4FragmentWriter));
+    if (!w) return NULL;
+    w->file = INVALID_HANDLE_VALUE;
+    strncpy(w->path, outputPath, MAX_PATH - 1);
+
+    BoxBuf head;
+    ZeroMemory(&head, sizeof(head));
+    WriterTrack entries[2];
+    ZeroMemory(entries, sizeof(entries));
+
+    WriterTrack* video = &w->tracks[0].track;
+    video->isVideo = TRUE;
+    video->codec = videoConfig->codec;
+    video->timescale = MP4_VIDEO_TIMESCALE;
+    video->trackId = 1;
+    w->trackCount = 1;
+    if (audioConfig && audioConfig->configData && audioConfig->configSize > 0 && audioConfig->sampleRate > 0) {
+        WriterTrack* audio = &w->tracks[1].track;
+        audio->timescale = (UINT32)audioConfig->sampleRate;
+        audio->trackId = 2;
+        w->trackCount = 2;
+    }
+    for (int t = 0; t < w->trackCount; t++) entries[t] = w->tracks[t].track;
+    entries[1].audioConfig = audioConfig;       /* Only read while moov is built */
+
+    /* Readers (a player previewing the recording) may open it meanwhile */
+    w->file = CreateFileW(wPath, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (w->file == INVALID_HANDLE_VALUE) {
+        WriterLog("MP4Writer: cannot create %s (error %lu)\n", outputPath, GetLastError());
+        goto cleanup;
+    }
+
+    PutFtyp(&head, videoConfig->codec);
+    if (!PutMoov(&head, entries, w->trackCount, NULL, 0, videoConfig, TRUE)) goto cleanup;
+    if (head.failed) {
+        WriterLog("MP4Writer: failed to allocate moov\n");
+        goto cleanup;
+    }
+    if (!WriteAll(w, head.data, head.size)) goto cleanup;
+
+    SAFE_FREE(head.data);
+    WriterLog("MP4Writer: fragmented %s (%dx%d @ %d fps%s)\n", outputPath,
+              videoConfig->width, videoConfig->height, videoConfig->fps,
+              w->trackCount > 1 ? ", audio" : "");
+    return w;
+
+cleanup:
+    SAFE_FREE(head.data);
+    {
+        BOOL created = (w->file != INVALID_HANDLE_VALUE);
+        FreeFragmentWriter(w);
+        if (created) DeleteFileW(wPath);
+    }
+    return NULL;
+}
+
+BOOL MP4Writer_HasFragmentAudio(const MP4FragmentWriter* w) {
+    return w && w->trackCount > 1;
+}
+
+BOOL MP4Writer_WriteFragmentVideo(MP4FragmentWriter* w, const MuxerSample* sample) {
+    if (!w || !sample || !sample->data || sample->size == 0 || w->failed) return FALSE;
+
+    /* Media time starts at the first keyframe: earlier frames are undecodable */
+    if (!w->started) {
+        if (!sample->isKeyframe) return FALSE;
+        w->started = TRUE;
+        w->originTs = sample->timestamp;
+    } else if (sample->isKeyframe && w->tracks[0].count > 0) {
+        if (!FlushFragment(w, sample->timestamp)) return FALSE;
+    }
+
+    FragmentTrack* ft = &w->tracks[0];
+    size_t before = ft->payload.size;
+    FragmentSample* s = AddFragmentSample(w, ft);
+    if (!s) return FALSE;
+    PutVideoSample(&ft->payload, sample, ft->track.codec);
+    s->timestamp = sample->timestamp;
+    s->duration = sample->duration;
+    s->size = (DWORD)(ft->payload.size - before);
+    s->isKeyframe = sample->isKeyframe;
+    return !ft->payload.failed;
+}
+
+BOOL MP4Writer_WriteFragmentAudio(MP4FragmentWriter* w, const MuxerAudioSample* sample) {
+    if (!w || w->trackCount < 2 || !sample || !sample->data || sample->size == 0 || w->failed) return FALSE;
+    if (!w->started || sample->timestamp < w->originTs) return FALSE;  /* Before media time 0 */
+
+    FragmentTrack* ft = &w->tracks[1];
+    FragmentSample* s = AddFragmentSample(w, ft);
+    if (!s) return FALSE;
+    Put(&ft->payload, sample->data, sample->size);
+    s->timestamp = sample->timestamp;
+    s->duration = sample->duration;
+    s->size = sample->size;
+    s->isKeyframe = TRUE;
+    return !ft->payload.failed;
+}
+
+BOOL MP4Writer_CloseFragmented(MP4FragmentWriter* w) {
+    if (!w) return FALSE;
+
+    FlushFragment(w, LLONG_MIN);
+    BOOL ok = !w->failed && w->started;
+    WriterLog("MP4Writer: closed %s: %u fragments, %llu frames, %llu audio samples, %llu MB%s\n",
+              w->path, w->sequence, w->tracks[0].totalSamples,
+              w->trackCount > 1 ? w->tracks[1].totalSamples : 0ULL,
+              w->fileBytes / (1024 * 1024), ok ? "" : " (FAILED)");
+    FreeFragmentWriter(w);
+    return ok;
+}
+
+void MP4Writer_AbortFragmented(MP4FragmentWriter* w) {
+    if (!w) return;
+
+    /* The open fragment is dropped; the file still plays up to the last one */
+    WriterLog("MP4Writer: aborting %s after %u fragments\n", w->path, w->sequence);
+    FreeFragmentWriter(w);
+}
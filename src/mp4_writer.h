@@ -0,0 +1,108 @@
+/*
+ * mp4_writer.h - Native ISO-BMFF writer for replay saves
+ *
+ * USED BY: replay_buffer.c (batch saves), clip_edit.c (streamed batch
+ *          writes), mp4_muxer.c (fragmented streaming)
+ *
+ * Writes an HEVC or AV1 track and any number of AAC tracks straight from
+ * MuxerSample arrays, without Media Foundation. The whole sample list is
+ * known before the first byte goes out, so every sample table
+ * (stts/stss/stsc/stsz/stco) is computed up front and the file is written
+ * in one sequential pass in faststart order: ftyp, moov, mdat, so web
+ * players can start before the whole file has arrived and no remux pass is
+ * needed. Payloads are copied once, into save_io.c's overlapped unbuffered
+ * write buffers.
+ *
+ * Annex-B input (start codes, as NVENC emits it) is rewritten as 4-byte
+ * length-prefixed NAL units. In-band VPS/SPS/PPS and access unit
+ * delimiters are dropped; the parameter sets go in hvcC, from seqHeader.
+ * AV1 (MuxerConfig.codec) goes in an av01 sample entry whose av1C carries
+ * the sequence header OBU; samples keep NVENC's low-overhead OBUs minus
+ * temporal delimiters.
+ * Audio tracks go in alternate group 1, so players pick one (track 0, the
+ * mix) instead of playing them all.
+ * A MuxerConfig poster goes in moov/udta/meta/ilst/covr (iTunes-style cover
+ * art, which Explorer and most players show as the clip's thumbnail);
+ * thumbnails go next to it in moov/udta/lwth, a full box (version 0) with
+ * an entry count and then per entry a 32-bit time in ms from the first
+ * frame, a 32-bit size and that many bytes of JPEG. Readers that don't know
+ * lwth skip it.
+ *
+ * The fragmented writer is the streaming counterpart: ftyp and a moov with
+ * empty sample tables (plus mvex) go out at create, then one moof/mdat
+ * fragment per GOP as each keyframe closes the previous GOP. Closing only
+ * writes the last fragment, and a file cut short by a crash is playable up
+ * to its last complete fragment.
+ *
+ * Needs neither COM nor MFStartup. No shared state: safe on any thread. A
+ * fragment writer is not thread-safe (StreamingMuxer serializes calls).
+ */
+
+#ifndef MP4_WRITER_H
+#define MP4_WRITER_H
+
+#include <windows.h>
+#include "mp4_muxer.h"
+
+// Write video plus audioTrackCount AAC tracks (0 = video only) to
+// outputPath. Tracks without samples or AudioSpecificConfig are skipped.
+// Requires videoConfig->seqHeader. Returns FALSE, with the partial file
+// deleted, on any failure so the caller can fall back to MP4Muxer.
+BOOL MP4Writer_WriteFile(
+    const char* outputPath,
+    const MuxerSample* videoSamples,
+    int videoSampleCount,
+    const MuxerConfig* videoConfig,
+    const MuxerAudioTrack* audioTracks,
+    int audioTrackCount
+);
+
+// Make the data of samples [first, first + count) of one track valid until
+// the next call. track: 0 = video, 1 + n = audioTracks[n]. FALSE aborts
+// the write.
+typedef BOOL (*MP4WriterFetch)(void* context, int track, int first, int count);
+
+// MP4Writer_WriteFile for samples that start with data = NULL (sizes
+// set): the writer fetches what it reads, at most MP4_FETCH_WINDOW_MB of
+// stored payload or one chunk at a time, and reads everything twice
+// (sizes, then the write). For clip edits of any length.
+BOOL MP4Writer_WriteFileStreamed(
+    const char* outputPath,
+    const MuxerSample* videoSamples,
+    int videoSampleCount,
+    const MuxerConfig* videoConfig,
+    const MuxerAudioTrack* audioTracks,
+    int audioTrackCount,
+    MP4WriterFetch fetch,
+    void* context
+);
+
+typedef struct MP4FragmentWriter MP4FragmentWriter;
+
+// Create outputPath and write its header. audioConfig may be NULL (video
+// only). Requires videoConfig->seqHeader. Returns NULL on failure.
+MP4FragmentWriter* MP4Writer_CreateFragmented(
+    const char* outputPath,
+    const MuxerConfig* videoConfig,
+    const MuxerAudioConfig* audioConfig
+);
+
+// TRUE if the writer has an audio track
+BOOL MP4Writer_HasFragmentAudio(const MP4FragmentWriter* writer);
+
+// Append a frame. Frames before the first keyframe are rejected; every
+// later keyframe first writes out the fragment it closes.
+BOOL MP4Writer_WriteFragmentVideo(MP4FragmentWriter* writer, const MuxerSample* sample);
+
+// Append an AAC frame to the open fragment. Audio timed before the first
+// keyframe is rejected.
+BOOL MP4Writer_WriteFragmentAudio(MP4FragmentWriter* writer, const MuxerAudioSample* sample);
+
+// Write the last fragment and close. Returns TRUE if every write succeeded
+// and at least one frame was written. The handle is invalid afterwards.
+BOOL MP4Writer_CloseFragmented(MP4FragmentWriter* writer);
+
+// Close without writing the open fragment
+void MP4Writer_AbortFragmented(MP4FragmentWriter* writer);
+
+#endif // MP4_WRITER_H
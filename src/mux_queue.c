@@ -0,0 +1,235 @@
+/*
+ * mux_queue.c - Bounded SPSC frame queue with a StreamingMuxer writer thread
+ *
+ * USED BY: recording.c
+ *
+ * head and tail are free-running counters (index = counter & mask). Only
+ * the producer advances tail and only the writer advances head; each
+ * publishes with an interlocked exchange after touching the slot, which is
+ * the barrier the other side needs. The producer signals an auto-reset
+ * event per push; the writer drains everything visible on each wake.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Create uses goto-cleanup; a failed create leaves nothing running
+ * - Drops and write failures are counted, logged once per burst, never fatal
+ */
+
+#include "mux_queue.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+
+// Alias for logging
+#define QueueLog Logger_Log
+
+struct MuxQueue {
+    StreamingMuxer* muxer;
+    MuxerSample* slots;         // Each slot owns its data while queued
+    ULONG mask;                 // capacity - 1
+    volatile LONG head;         // Next slot to write (writer)
+    volatile LONG tail;         // Next slot to fill (producer)
+
+    HANDLE thread;
+    HANDLE wakeEvent;           // Auto-reset, set per push and by Close
+    volatile LONG stopping;
+
+    // Producer-only
+    BOOL waitingForIdr;         // Dropping until the next keyframe
+
+    // Counters (MuxQueueStats)
+    volatile LONG queued;
+    volatile LONG written;
+    volatile LONG writeFailures;
+    volatile LONG droppedFull;
+    volatile LONG droppedUntilIdr;
+    volatile LONG peakDepth;
+    volatile LONG maxWriteMs;
+};
+
+static ULONG Depth(MuxQueue* q) {
+    return (ULONG)InterlockedCompareExchange(&q->tail, 0, 0) -
+           (ULONG)InterlockedCompareExchange(&q->head, 0, 0);
+}
+
+// Write every frame visible to the writer. Writer thread.
+static void Drain(MuxQueue* q) {
+    ULONG head = (ULONG)q->head;
+    ULONG tail = (ULONG)InterlockedCompareExchange(&q->tail, 0, 0);
+    while (head != tail) {
+        MuxerSample* slot = &q->slots[head & q->mask];
+
+        ULONGLONG start = GetTickCount64();
+        if (StreamingMuxer_WriteVideo(q->muxer, slot)) {
+            InterlockedIncrement(&q->written);
+        } else if (InterlockedIncrement(&q->writeFailures) == 1) {
+            QueueLog("MuxQueue: muxer write failed (size=%u, ts=%lld)\n", slot->size, slot->timestamp);
+        }
+        LONG elapsed = (LONG)(GetTickCount64() - start);
+        if (elapsed > q->maxWriteMs) InterlockedExchange(&q->maxWriteMs, elapsed);
+
+        SAFE_FREE(slot->data);
+        head++;
+        InterlockedExchange(&q->head, (LONG)head);
+        if (head == tail) tail = (ULONG)InterlockedCompareExchange(&q->tail, 0, 0);
+    }
+}
+
+static DWORD WINAPI WriterProc(LPVOID param) {
+    MuxQueue* q = (MuxQueue*)param;
+
+    // The sink writer is a COM object (same rules as the replay save worker)
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hrCom) && hrCom != RPC_E_CHANGED_MODE) {
+        QueueLog("MuxQueue: CoInitializeEx failed (0x%08X)\n", hrCom);
+    }
+    BOOL coInitialized = (hrCom == S_OK || hrCom == S_FALSE);
+
+    for (;;) {
+        WaitForSingleObject(q->wakeEvent, INFINITE);
+        // Read before draining: everything pushed before Close gets written
+        BOOL stop = InterlockedCompareExchange(&q->stopping, 0, 0) != 0;
+        Drain(q);
+        if (stop) break;
+    }
+
+    if (coInitialized) CoUninitialize();
+    return 0;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: MuxQueue_Create
+ * Resources: 4 - queue (calloc), slot ring (calloc), wake event, writer thread
+ * Pattern: goto-cleanup in reverse acquisition order
+ * Init: calloc ensures NULL initialization
+ */
+MuxQueue* MuxQueue_Create(StreamingMuxer* muxer, int capacity) {
+    LWSR_ASSERT(muxer != NULL);
+
+    if (!muxer || capacity <= 0) return NULL;
+
+    ULONG slots = 1;
+    while (slots < (ULONG)capacity) slots <<= 1;
+
+    MuxQueue* q = (MuxQueue*)calloc(1, sizeof(MuxQueue));
+    if (!q) return NULL;
+    q->muxer = muxer;
+    q->mask = slots - 1;
+
+    q->slots = (MuxerSample*)calloc(slots, sizeof(MuxerSample));
+    if (!q->slots) {
+        QueueLog("MuxQueue_Create: failed to allocate %lu slots\n", slots);
+        goto cleanup;
+    }
+
+    q->wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!q->wakeEvent) {
+        QueueLog("MuxQueue_Create: CreateEvent failed (%lu)\n", GetLastError());
+        goto cleanup;
+    }
+
+    q->thread = CreateThread(NULL, 0, WriterProc, q, 0, NULL);
+    if (!q->thread) {
+        QueueLog("MuxQueue_Create: CreateThread failed (%lu)\n", GetLastError());
+        goto cleanup;
+    }
+
+    QueueLog("MuxQueue_Create: %lu frame slots\n", slots);
+    return q;
+
+cleanup:
+    SAFE_CLOSE_HANDLE(q->wakeEvent);
+    SAFE_FREE(q->slots);
+    free(q);
+    return NULL;
+}
+
+BOOL MuxQueue_Push(MuxQueue* q, const MuxerSample* sample, BOOL adopt) {
+    LWSR_ASSERT(q != NULL);
+    LWSR_ASSERT(sample != NULL);
+
+    if (!q || !sample || !sample->data || sample->size == 0) return FALSE;
+
+    // After a drop the next frames reference what was lost: resume at an IDR
+    if (q->waitingForIdr && !sample->isKeyframe) {
+        InterlockedIncrement(&q->droppedUntilIdr);
+        goto drop;
+    }
+
+    ULONG tail = (ULONG)q->tail;
+    ULONG depth = tail - (ULONG)InterlockedCompareExchange(&q->head, 0, 0);
+    if (depth > q->mask) {
+        if (!q->waitingForIdr) {
+            QueueLog("MuxQueue: full (%lu frames, slowest write %ld ms), dropping to the next IDR\n",
+                     depth, InterlockedCompareExchange(&q->maxWriteMs, 0, 0));
+        }
+        q->waitingForIdr = TRUE;
+        InterlockedIncrement(&q->droppedFull);
+        goto drop;
+    }
+    if (q->waitingForIdr) {
+        QueueLog("MuxQueue: resumed at IDR (%ld dropped so far)\n",
+                 q->droppedFull + q->droppedUntilIdr);
+        q->waitingForIdr = FALSE;
+    }
+
+    MuxerSample* slot = &q->slots[tail & q->mask];
+    *slot = *sample;
+    if (!adopt) {
+        slot->data = (BYTE*)malloc(sample->size);
+        if (!slot->data) {
+            q->waitingForIdr = TRUE;
+            InterlockedIncrement(&q->droppedFull);
+            return FALSE;
+        }
+        memcpy(slot->data, sample->data, sample->size);
+    }
+
+    InterlockedExchange(&q->tail, (LONG)(tail + 1));
+    InterlockedIncrement(&q->queued);
+    if ((LONG)(depth + 1) > q->peakDepth) InterlockedExchange(&q->peakDepth, (LONG)(depth + 1));
+    SetEvent(q->wakeEvent);
+    return TRUE;
+
+drop:
+    if (adopt) free(sample->data);
+    return FALSE;
+}
+
+void MuxQueue_GetStats(MuxQueue* q, MuxQueueStats* stats) {
+    LWSR_ASSERT(stats != NULL);
+
+    ZeroMemory(stats, sizeof(*stats));
+    if (!q) return;
+    stats->queued = InterlockedCompareExchange(&q->queued, 0, 0);
+    stats->written = InterlockedCompareExchange(&q->written, 0, 0);
+    stats->writeFailures = InterlockedCompareExchange(&q->writeFailures, 0, 0);
+    stats->droppedFull = InterlockedCompareExchange(&q->droppedFull, 0, 0);
+    stats->droppedUntilIdr = InterlockedCompareExchange(&q->droppedUntilIdr, 0, 0);
+    stats->peakDepth = InterlockedCompareExchange(&q->peakDepth, 0, 0);
+    stats->capacity = (LONG)q->mask + 1;
+    stats->maxWriteMs = (DWORD)InterlockedCompareExchange(&q->maxWriteMs, 0, 0);
+}
+
+BOOL MuxQueue_Close(MuxQueue* q) {
+    if (!q) return FALSE;
+
+    ULONG pending = Depth(q);
+    InterlockedExchange(&q->stopping, 1);
+    SetEvent(q->wakeEvent);
+    // No timeout: the writer owns the muxer until it returns
+    WaitForSingleObject(q->thread, INFINITE);
+    SAFE_CLOSE_HANDLE(q->thread);
+
+    MuxQueueStats stats;
+    MuxQueue_GetStats(q, &stats);
+    QueueLog("MuxQueue_Close: %ld queued, %ld written, %ld write failures, "
+             "%ld dropped full + %ld until IDR, peak %ld/%ld, slowest write %lu ms (%lu drained at close)\n",
+             stats.queued, stats.written, stats.writeFailures, stats.droppedFull,
+             stats.droppedUntilIdr, stats.peakDepth, stats.capacity, stats.maxWriteMs, pending);
+
+    SAFE_CLOSE_HANDLE(q->wakeEvent);
+    SAFE_FREE(q->slots);
+    free(q);
+    return stats.written == stats.queued;
+}
@@ -0,0 +1,54 @@
+/*
+ * mux_queue.h - Bounded SPSC frame queue with a StreamingMuxer writer thread
+ *
+ * USED BY: recording.c
+ *
+ * Sits between an encoder callback and a StreamingMuxer so the callback
+ * never waits on the disk. The producer (one thread: the NVENC output
+ * thread, or the replay buffer's stream tap) pushes into a lock-free
+ * single-producer/single-consumer ring; a writer thread drains it into the
+ * muxer. Push never blocks. When the ring is full the frame is dropped and
+ * so is everything after it up to the next IDR, so the file stays
+ * decodable; both kinds of drop are counted.
+ *
+ * The queue does not own the muxer: close the queue (drain + join), then
+ * the muxer.
+ */
+
+#ifndef MUX_QUEUE_H
+#define MUX_QUEUE_H
+
+#include <windows.h>
+#include "mp4_muxer.h"
+
+typedef struct MuxQueue MuxQueue;
+
+// Back-pressure counters (snapshot; each field is read atomically)
+typedef struct {
+    LONG queued;                // Frames accepted by Push
+    LONG written;               // Frames the muxer accepted
+    LONG writeFailures;         // StreamingMuxer_WriteVideo returned FALSE
+    LONG droppedFull;           // Ring full at Push
+    LONG droppedUntilIdr;       // Discarded after a drop, waiting for an IDR
+    LONG peakDepth;             // Most frames queued at once
+    LONG capacity;
+    DWORD maxWriteMs;           // Slowest single muxer write
+} MuxQueueStats;
+
+// Start a writer thread for muxer with room for capacity frames (rounded
+// up to a power of two). Returns NULL on failure.
+MuxQueue* MuxQueue_Create(StreamingMuxer* muxer, int capacity);
+
+// Queue one frame (producer thread only). adopt = TRUE hands sample->data
+// (malloc'd) to the queue, which frees it even if the frame is dropped;
+// FALSE copies it. Returns FALSE if the frame was dropped.
+BOOL MuxQueue_Push(MuxQueue* queue, const MuxerSample* sample, BOOL adopt);
+
+void MuxQueue_GetStats(MuxQueue* queue, MuxQueueStats* stats);
+
+// Write everything queued, stop the writer and free the queue. Call after
+// the producer has stopped. Returns TRUE if every accepted frame was
+// written. The handle is invalid afterwards.
+BOOL MuxQueue_Close(MuxQueue* queue);
+
+#endif // MUX_QUEUE_H
@@ -1,17 +1,26 @@
 /*
- * nvenc_encoder.c - NVENC Hardware Encoder (CUDA Path)
+ * nvenc_encoder.c - NVENC Hardware Encoder (D3D11 zero-copy, CUDA fallback)
  * 
  * SHARED BY: replay_buffer.c, recording.c
  * 
- * HEVC hardware encoding via NVIDIA NVENC API.
- * Based on OBS nvenc-cuda.c and cuda-helpers.c patterns.
+ * HEVC (or AV1, on GPUs that have it) hardware encoding via NVIDIA NVENC API.
+ * Based on OBS nvenc-cuda.c / nvenc-d3d11.c and cuda-helpers.c patterns.
  * 
- * Flow:
+ * Primary flow (D3D11 device type, zero-copy):
+ * 1. Open NVENC session on the caller's ID3D11Device
+ * 2. On first sight of an NV12 texture, register it with NVENC
+ *    (NV_ENC_INPUT_RESOURCE_TYPE_DIRECTX) and cache the registration
+ * 3. For each frame: map registered texture → NVENC encode → unmap.
+ *    The frame never leaves VRAM (no staging copy, no PCIe round trip).
+ * 
+ * Fallback flow (CUDA device type), used when no D3D11 device is supplied
+ * or the driver refuses a DirectX session:
  * 1. Load nvcuda.dll, get function pointers
  * 2. Create CUDA context (cuCtxCreate)
  * 3. Create CUDA arrays for input surfaces (cuArray3DCreate)
  * 4. Open NVENC session with CUDA device type
- * 5. For each frame: CPU buffer → CUDA array (cuMemcpy2D) → NVENC encode
+ * 5. For each frame: D3D11 staging readback → CPU buffer →
+ *    CUDA array (cuMemcpy2D) → NVENC encode
  */
 
 #include "nvenc_encoder.h"
@@ -19,6 +28,8 @@
 #include "constants.h"
 #include "leak_tracker.h"
 #include "mem_utils.h"
+#include "pipeline_stats.h"
+#include "metrics.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -127,7 +138,41 @@ typedef struct {
 // Constants
 // ============================================================================
 
-#define NUM_BUFFERS 4
+#define NUM_BUFFERS NVENC_ASYNC_DEPTH
+
+// Upper bound on distinct D3D11 textures registered in zero-copy mode.
+// GPUConverter hands us the same NV12 ring textures every frame, plus the
+// async slot textures, so the cache only ever holds a handful of entries;
+// registration is a one-time cost.
+#define MAX_REGISTERED_TEXTURES (GPU_TEXTURE_RING_MAX + NUM_BUFFERS)
+
+// Async mode: how long SubmitFrame/SubmitTexture waits for the retrieval
+// thread to free an output slot, and how long the retrieval thread waits on a
+// slot's completion event. Both are far above a healthy per-frame encode time
+// (~1-3 ms); hitting either means the encoder or driver has stalled.
+#define ASYNC_SLOT_WAIT_MS        500
+#define ASYNC_COMPLETION_WAIT_MS  2000
+
+// ============================================================================
+// Input Path
+// ============================================================================
+
+typedef enum {
+    NVENC_INPUT_CUDA = 0,   // CPU NV12 → cuMemcpy2D → CUDA array (fallback)
+    NVENC_INPUT_D3D11       // D3D11 NV12 texture registered directly (zero-copy)
+} NvencInputPath;
+
+typedef struct {
+    ID3D11Texture2D* tex;           // AddRef'd: keeps the address from being recycled
+    NV_ENC_REGISTERED_PTR res;      // NVENC registration for tex
+} D3D11Registration;
+
+// One in-flight frame in async mode, indexed by output-buffer slot
+typedef struct {
+    NV_ENC_INPUT_PTR mappedInput;   // Unmapped by the owning thread when the slot is reused
+    ID3D11Texture2D* texture;       // D3D11 texture behind mappedInput (non-owning)
+    LONGLONG timestamp;             // Caller PTS, echoed into EncodedFrame
+} PendingFrame;
 
 // ============================================================================
 // Encoder State
@@ -135,11 +180,16 @@ typedef struct {
 
 struct NVENCEncoder {
     // NVENC
-    HMODULE nvencLib;
     NV_ENCODE_API_FUNCTION_LIST fn;
     void* encoder;
+    NvencInputPath inputPath;
+    
+    // D3D11 (zero-copy path)
+    ID3D11Device* d3dDevice;
+    D3D11Registration registrations[MAX_REGISTERED_TEXTURES];
+    int registrationCount;
     
-    // CUDA
+    // CUDA (fallback path)
     CUcontext cu_ctx;
     
     // Surfaces (like OBS enc->surfaces)
@@ -150,17 +200,48 @@ struct NVENCEncoder {
     // Output bitstream buffers
     NV_ENC_OUTPUT_PTR outputBuffers[NUM_BUFFERS];
     
+    // Async mode: completion event per output slot, drained in submission
+    // order by a retrieval thread that delivers frames to the callback.
+    // hSlotFree counts slots the owning thread may submit into; hSlotQueued
+    // counts slots the retrieval thread has yet to drain.
+    BOOL asyncMode;
+    HANDLE completionEvents[NUM_BUFFERS];
+    PendingFrame pending[NUM_BUFFERS];
+    HANDLE hSlotFree;
+    HANDLE hSlotQueued;
+    HANDLE hRetrieveStop;
+    HANDLE hRetrieveThread;
+    int next_retrieve;              // Retrieval thread only
+    
+    // Async D3D11 path: encoder-owned copies of the caller's texture, one per
+    // slot, so the caller may overwrite its texture as soon as Submit returns.
+    // Skipped when the caller's texture ring is deep enough (inputRingDepth).
+    ID3D11DeviceContext* d3dCtx;
+    ID3D11Texture2D* slotTextures[NUM_BUFFERS];
+    int inputRingDepth;
+    
+    // TRUE = EncodedFrame.data points into the locked bitstream for the
+    // duration of the callback instead of a malloc'd copy
+    BOOL borrowedOutput;
+    
+    // Last successfully submitted input, for SubmitRepeat: the caller's
+    // texture on the D3D11 path (kept alive by its registration), or the slot
+    // whose CUDA surface holds the frame on the CUDA path (-1 = none yet).
+    ID3D11Texture2D* lastTexture;
+    int lastSurface;
+    
     // Dimensions
     int width;
     int height;
     int fps;
-    int qp;
+    int qp;                         // HEVC scale; AV1 sessions run at qp * AV1_QP_SCALE
+    VideoCodec codec;               // Requested codec until configure_encoder settles it
     uint64_t frameDuration;
     
     // Frame counter
     uint64_t frameNumber;
     
-    // Cached staging texture for SubmitTexture (avoid per-frame GPU alloc)
+    // Cached staging texture for SubmitTexture on the CUDA path (avoid per-frame GPU alloc)
     ID3D11Texture2D* stagingTexture;
     ID3D11DeviceContext* stagingCtx;
     
@@ -168,12 +249,6 @@ struct NVENCEncoder {
     EncodedFrameCallback frameCallback;
     void* callbackUserData;
     
-    // Frame stats
-    UINT64 totalBytesEncoded;
-    UINT32 lastFrameSize;
-    UINT32 minFrameSize;
-    UINT32 maxFrameSize;
-    
     BOOL initialized;
 };
 
@@ -250,6 +325,39 @@ static BOOL ensure_cuda(void) {
     return g_cudaInitOk;
 }
 
+// ============================================================================
+// NVENC API Loading
+// ============================================================================
+
+typedef NVENCSTATUS (NVENCAPI *PFN_CREATE)(NV_ENCODE_API_FUNCTION_LIST*);
+
+// Loaded once and kept for the process lifetime (like nvcuda.dll), so
+// NVENCEncoder_Prewarm at startup takes the DLL load off the encoder's
+// critical path and replay restarts skip it.
+static INIT_ONCE g_nvencInitOnce = INIT_ONCE_STATIC_INIT;
+static PFN_CREATE g_nvencCreateInstance = NULL;
+
+static BOOL CALLBACK init_nvenc_once(PINIT_ONCE once, PVOID param, PVOID* ctx) {
+    (void)once; (void)param; (void)ctx;
+    HMODULE lib = LoadLibraryA("nvEncodeAPI64.dll");
+    if (!lib) lib = LoadLibraryA("nvEncodeAPI.dll");
+    if (!lib) {
+        NvLog("NVENC: Failed to load nvEncodeAPI64.dll\n");
+        return TRUE;
+    }
+    g_nvencCreateInstance = (PFN_CREATE)GetProcAddress(lib, "NvEncodeAPICreateInstance");
+    if (!g_nvencCreateInstance) {
+        NvLog("NVENC: NvEncodeAPICreateInstance not found\n");
+        FreeLibrary(lib);
+    }
+    return TRUE;
+}
+
+static PFN_CREATE ensure_nvenc_api(void) {
+    InitOnceExecuteOnce(&g_nvencInitOnce, init_nvenc_once, NULL, NULL);
+    return g_nvencCreateInstance;
+}
+
 // ============================================================================
 // CUDA Error Checking (from OBS)
 // ============================================================================
@@ -381,102 +489,181 @@ static void cuda_free_surfaces(NVENCEncoder* enc) {
 }
 
 // ============================================================================
-// Public API
+// D3D11 Texture Registration (zero-copy path)
 // ============================================================================
 
-NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height, int fps, QualityPreset quality) {
-    (void)d3dDevice;  // Not used in CUDA path
-    if (width <= 0 || height <= 0 || fps <= 0) {
-        NvLog("NVENC: Invalid parameters\n");
-        return NULL;
+// Look up (or create) the NVENC registration for an NV12 texture.
+// Returns NULL if the texture is unusable or the cache is full.
+static NV_ENC_REGISTERED_PTR d3d11_get_registration(NVENCEncoder* enc, ID3D11Texture2D* tex) {
+    for (int i = 0; i < enc->registrationCount; i++) {
+        if (enc->registrations[i].tex == tex) {
+            return enc->registrations[i].res;
+        }
     }
-    
-    NvLog("NVENC: Creating encoder (%dx%d @ %d fps, quality=%d)...\n", width, height, fps, quality);
-    
-    // Init CUDA (thread-safe one-shot bootstrap)
-    if (!ensure_cuda()) {
-        NvLog("NVENC: CUDA init failed\n");
+
+    if (enc->registrationCount >= MAX_REGISTERED_TEXTURES) {
+        NvLog("NVENC: D3D11 registration cache full (%d textures)\n", MAX_REGISTERED_TEXTURES);
         return NULL;
     }
-    
-    NVENCEncoder* enc = (NVENCEncoder*)calloc(1, sizeof(NVENCEncoder));
-    if (!enc) return NULL;
-    
-    enc->width = width;
-    enc->height = height;
-    enc->fps = fps;
-    enc->frameDuration = MF_UNITS_PER_SECOND / fps;
-    enc->buf_count = NUM_BUFFERS;
-    
-    // Create CUDA context
-    if (!cuda_ctx_init(enc)) {
-        free(enc);
+
+    D3D11_TEXTURE2D_DESC desc;
+    tex->lpVtbl->GetDesc(tex, &desc);
+    if (desc.Format != DXGI_FORMAT_NV12 ||
+        (int)desc.Width < enc->width || (int)desc.Height < enc->height) {
+        NvLog("NVENC: Texture not registrable (format=%d, %ux%u, need NV12 >= %dx%d)\n",
+              desc.Format, desc.Width, desc.Height, enc->width, enc->height);
         return NULL;
     }
-    
-    // Load NVENC
-    enc->nvencLib = LoadLibraryA("nvEncodeAPI64.dll");
-    if (!enc->nvencLib) enc->nvencLib = LoadLibraryA("nvEncodeAPI.dll");
-    if (!enc->nvencLib) {
-        NvLog("NVENC: Failed to load nvEncodeAPI64.dll\n");
-        cuda_ctx_free(enc);
-        free(enc);
+
+    NV_ENC_REGISTER_RESOURCE reg = {0};
+    reg.version = NV_ENC_REGISTER_RESOURCE_VER;
+    reg.resourceType = NV_ENC_INPUT_RESOURCE_TYPE_DIRECTX;
+    reg.resourceToRegister = (void*)tex;
+    reg.width = enc->width;
+    reg.height = enc->height;
+    reg.pitch = 0;  // Must be 0 for DirectX resources
+    reg.subResourceIndex = 0;
+    reg.bufferFormat = NV_ENC_BUFFER_FORMAT_NV12;
+
+    NVENCSTATUS st = enc->fn.nvEncRegisterResource(enc->encoder, &reg);
+    if (st != NV_ENC_SUCCESS) {
+        NvLog("NVENC: nvEncRegisterResource (D3D11) failed (%d)\n", st);
         return NULL;
     }
-    
-    typedef NVENCSTATUS (NVENCAPI *PFN_CREATE)(NV_ENCODE_API_FUNCTION_LIST*);
-    PFN_CREATE createInstance = (PFN_CREATE)GetProcAddress(enc->nvencLib, "NvEncodeAPICreateInstance");
-    if (!createInstance) {
-        NvLog("NVENC: NvEncodeAPICreateInstance not found\n");
-        goto fail;
-    }
-    
-    enc->fn.version = NV_ENCODE_API_FUNCTION_LIST_VER;
-    if (createInstance(&enc->fn) != NV_ENC_SUCCESS) {
-        NvLog("NVENC: CreateInstance failed\n");
-        goto fail;
+
+    tex->lpVtbl->AddRef(tex);
+    enc->registrations[enc->registrationCount].tex = tex;
+    enc->registrations[enc->registrationCount].res = reg.registeredResource;
+    enc->registrationCount++;
+
+    NvLog("NVENC: Registered D3D11 texture %p (%d cached)\n", (void*)tex, enc->registrationCount);
+    return reg.registeredResource;
+}
+
+static void d3d11_unregister_all(NVENCEncoder* enc) {
+    for (int i = 0; i < enc->registrationCount; i++) {
+        if (enc->registrations[i].res) {
+            enc->fn.nvEncUnregisterResource(enc->encoder, enc->registrations[i].res);
+            enc->registrations[i].res = NULL;
+        }
+        SAFE_RELEASE(enc->registrations[i].tex);
     }
-    
-    // Open session with CUDA device type (like OBS)
+    enc->registrationCount = 0;
+}
+
+// ============================================================================
+// Session Setup
+// ============================================================================
+
+static BOOL open_session(NVENCEncoder* enc, NV_ENC_DEVICE_TYPE deviceType, void* device) {
     NV_ENC_OPEN_ENCODE_SESSION_EX_PARAMS sessionParams = {0};
     sessionParams.version = NV_ENC_OPEN_ENCODE_SESSION_EX_PARAMS_VER;
-    sessionParams.deviceType = NV_ENC_DEVICE_TYPE_CUDA;
-    sessionParams.device = enc->cu_ctx;
+    sessionParams.deviceType = deviceType;
+    sessionParams.device = device;
     sessionParams.apiVersion = NVENCAPI_VERSION;
-    
+
     NVENCSTATUS st = enc->fn.nvEncOpenEncodeSessionEx(&sessionParams, &enc->encoder);
     if (st != NV_ENC_SUCCESS) {
-        NvLog("NVENC: OpenEncodeSessionEx failed (%d)\n", st);
-        goto fail;
+        NvLog("NVENC: OpenEncodeSessionEx (%s) failed (%d)\n",
+              deviceType == NV_ENC_DEVICE_TYPE_DIRECTX ? "D3D11" : "CUDA", st);
+        enc->encoder = NULL;
+        return FALSE;
+    }
+
+    NvLog("NVENC: Session opened (%s device type)\n",
+          deviceType == NV_ENC_DEVICE_TYPE_DIRECTX ? "D3D11" : "CUDA");
+    return TRUE;
+}
+
+static const GUID* codec_guid(const NVENCEncoder* enc) {
+    return enc->codec == CODEC_AV1 ? &NV_ENC_CODEC_AV1_GUID : &NV_ENC_CODEC_HEVC_GUID;
+}
+
+// TRUE if the open session lists guid among its encode GUIDs
+static BOOL session_supports_codec(NVENCEncoder* enc, const GUID* guid) {
+    uint32_t count = 0;
+    NVENCSTATUS st = enc->fn.nvEncGetEncodeGUIDCount(enc->encoder, &count);
+    if (st != NV_ENC_SUCCESS || count == 0) {
+        NvLog("NVENC: GetEncodeGUIDCount failed (%d)\n", st);
+        return FALSE;
     }
     
-    NvLog("NVENC: Session opened (CUDA device type)\n");
+    GUID guids[16];
+    if (count > ARRAYSIZE(guids)) count = ARRAYSIZE(guids);
+    uint32_t listed = 0;
+    st = enc->fn.nvEncGetEncodeGUIDs(enc->encoder, guids, count, &listed);
+    if (st != NV_ENC_SUCCESS) {
+        NvLog("NVENC: GetEncodeGUIDs failed (%d)\n", st);
+        return FALSE;
+    }
+    for (uint32_t i = 0; i < listed; i++) {
+        if (memcmp(&guids[i], guid, sizeof(GUID)) == 0) return TRUE;
+    }
+    return FALSE;
+}
+
+// TRUE if the open session can run with enableEncodeAsync = 1
+static BOOL query_async_support(NVENCEncoder* enc) {
+    NV_ENC_CAPS_PARAM capsParam = {0};
+    capsParam.version = NV_ENC_CAPS_PARAM_VER;
+    capsParam.capsToQuery = NV_ENC_CAPS_ASYNC_ENCODE_SUPPORT;
+    
+    int supported = 0;
+    NVENCSTATUS st = enc->fn.nvEncGetEncodeCaps(enc->encoder, *codec_guid(enc),
+                                                &capsParam, &supported);
+    if (st != NV_ENC_SUCCESS) {
+        NvLog("NVENC: GetEncodeCaps(ASYNC_ENCODE_SUPPORT) failed (%d)\n", st);
+        return FALSE;
+    }
+    return supported != 0;
+}
+
+// Apply preset + CQP config and initialize the open session.
+// AV1 is used only if the GPU lists it (RTX 40 and newer), else HEVC; the
+// decision is recorded in enc->codec. Async mode is used only if requested
+// and supported by the driver; the decision is recorded in enc->asyncMode.
+static BOOL configure_encoder(NVENCEncoder* enc, QualityPreset quality, BOOL asyncRequested) {
+    if (enc->codec == CODEC_AV1 && !session_supports_codec(enc, &NV_ENC_CODEC_AV1_GUID)) {
+        NvLog("NVENC: AV1 encode not supported on this GPU, falling back to HEVC\n");
+        enc->codec = CODEC_HEVC;
+    }
+    
+    enc->asyncMode = asyncRequested && query_async_support(enc);
+    if (asyncRequested && !enc->asyncMode) {
+        NvLog("NVENC: Async encode not supported, using sync mode\n");
+    }
     
     // Get preset config
     NV_ENC_PRESET_CONFIG presetConfig = {0};
     presetConfig.version = NV_ENC_PRESET_CONFIG_VER;
     presetConfig.presetCfg.version = NV_ENC_CONFIG_VER;
-    
-    st = enc->fn.nvEncGetEncodePresetConfigEx(enc->encoder,
-        NV_ENC_CODEC_HEVC_GUID,
+
+    NVENCSTATUS st = enc->fn.nvEncGetEncodePresetConfigEx(enc->encoder,
+        *codec_guid(enc),
         NV_ENC_PRESET_P1_GUID,
         NV_ENC_TUNING_INFO_ULTRA_LOW_LATENCY,
         &presetConfig);
     if (st != NV_ENC_SUCCESS) {
         NvLog("NVENC: GetEncodePresetConfigEx failed (%d)\n", st);
-        goto fail;
+        return FALSE;
     }
-    
+
     // Configure encoder
     NV_ENC_CONFIG config = presetConfig.presetCfg;
-    config.gopLength = GOP_LENGTH_FRAMES_AT(fps);
+    config.gopLength = GOP_LENGTH_FRAMES_AT(enc->fps);
     config.frameIntervalP = 1;  // No B-frames
-    
+    if (enc->codec == CODEC_AV1) {
+        NV_ENC_CONFIG_AV1* av1 = &config.encodeCodecConfig.av1Config;
+        av1->idrPeriod = config.gopLength;
+        av1->repeatSeqHdr = 1;          // Sequence header OBU on every key frame
+        av1->outputAnnexBFormat = 0;    // Low-overhead OBUs, the MP4 sample format
+    }
+
     // Disable expensive features
     config.rcParams.enableAQ = 0;
     config.rcParams.enableTemporalAQ = 0;
     config.rcParams.enableLookahead = 0;
-    
+
     // Constant QP
     config.rcParams.rateControlMode = NV_ENC_PARAMS_RC_CONSTQP;
     switch (quality) {
@@ -486,46 +673,148 @@ NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height
         case QUALITY_LOSSLESS: enc->qp = QP_LOSSLESS; break;
         default:               enc->qp = QP_MEDIUM;   break;
     }
-    config.rcParams.constQP.qpInterP = enc->qp;
-    config.rcParams.constQP.qpInterB = enc->qp;
-    config.rcParams.constQP.qpIntra = enc->qp > 4 ? enc->qp - 4 : 0;
-    
+    int qpScale = enc->codec == CODEC_AV1 ? AV1_QP_SCALE : 1;
+    config.rcParams.constQP.qpInterP = enc->qp * qpScale;
+    config.rcParams.constQP.qpInterB = enc->qp * qpScale;
+    config.rcParams.constQP.qpIntra = (enc->qp > 4 ? enc->qp - 4 : 0) * qpScale;
+
     // Initialize encoder
     NV_ENC_INITIALIZE_PARAMS initParams = {0};
     initParams.version = NV_ENC_INITIALIZE_PARAMS_VER;
-    initParams.encodeGUID = NV_ENC_CODEC_HEVC_GUID;
+    initParams.encodeGUID = *codec_guid(enc);
     initParams.presetGUID = NV_ENC_PRESET_P1_GUID;
-    initParams.encodeWidth = width;
-    initParams.encodeHeight = height;
-    initParams.darWidth = width;
-    initParams.darHeight = height;
-    initParams.frameRateNum = fps;
+    initParams.encodeWidth = enc->width;
+    initParams.encodeHeight = enc->height;
+    initParams.darWidth = enc->width;
+    initParams.darHeight = enc->height;
+    initParams.frameRateNum = enc->fps;
     initParams.frameRateDen = 1;
-    initParams.enableEncodeAsync = 0;  // Sync mode (like OBS soft encoder)
+    initParams.enableEncodeAsync = enc->asyncMode ? 1 : 0;
     initParams.enablePTD = 1;
     initParams.encodeConfig = &config;
     initParams.tuningInfo = NV_ENC_TUNING_INFO_ULTRA_LOW_LATENCY;
-    
+
     st = enc->fn.nvEncInitializeEncoder(enc->encoder, &initParams);
     if (st != NV_ENC_SUCCESS) {
         NvLog("NVENC: InitializeEncoder failed (%d)\n", st);
-        goto fail;
+        return FALSE;
     }
-    
-    NvLog("NVENC: Encoder initialized (HEVC CQP QP=%d)\n", enc->qp);
-    
+
+    NvLog("NVENC: Encoder initialized (%s CQP QP=%d)\n",
+          enc->codec == CODEC_AV1 ? "AV1" : "HEVC", enc->qp * qpScale);
+    return TRUE;
+}
+
+// Bring up the D3D11 zero-copy session. On failure the session is torn down
+// so the caller can retry on the CUDA path with a clean encoder handle.
+static BOOL init_d3d11_path(NVENCEncoder* enc, ID3D11Device* d3dDevice,
+                            QualityPreset quality, BOOL asyncMode) {
+    if (!open_session(enc, NV_ENC_DEVICE_TYPE_DIRECTX, d3dDevice)) {
+        return FALSE;
+    }
+    if (!configure_encoder(enc, quality, asyncMode)) {
+        enc->fn.nvEncDestroyEncoder(enc->encoder);
+        enc->encoder = NULL;
+        return FALSE;
+    }
+
+    d3dDevice->lpVtbl->AddRef(d3dDevice);
+    enc->d3dDevice = d3dDevice;
+    d3dDevice->lpVtbl->GetImmediateContext(d3dDevice, &enc->d3dCtx);
+    enc->inputPath = NVENC_INPUT_D3D11;
+    return TRUE;
+}
+
+static BOOL init_cuda_path(NVENCEncoder* enc, QualityPreset quality, BOOL asyncMode) {
+    // Init CUDA (thread-safe one-shot bootstrap)
+    if (!ensure_cuda()) {
+        NvLog("NVENC: CUDA init failed\n");
+        return FALSE;
+    }
+
+    // Create CUDA context
+    if (!cuda_ctx_init(enc)) {
+        return FALSE;
+    }
+
+    if (!open_session(enc, NV_ENC_DEVICE_TYPE_CUDA, enc->cu_ctx)) {
+        return FALSE;
+    }
+    if (!configure_encoder(enc, quality, asyncMode)) {
+        return FALSE;
+    }
+
+    enc->inputPath = NVENC_INPUT_CUDA;
+
     // Create CUDA surfaces
     if (!cuda_init_surfaces(enc)) {
         NvLog("NVENC: Failed to create CUDA surfaces\n");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Async retrieval (defined below, next to the encode path it drains)
+static BOOL init_async(NVENCEncoder* enc);
+static void shutdown_async(NVENCEncoder* enc);
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height, int fps,
+                                  QualityPreset quality, VideoCodec codec, BOOL asyncMode) {
+    if (width <= 0 || height <= 0 || fps <= 0) {
+        NvLog("NVENC: Invalid parameters\n");
+        return NULL;
+    }
+    
+    NvLog("NVENC: Creating encoder (%dx%d @ %d fps, quality=%d, codec=%s, async=%d)...\n",
+          width, height, fps, quality, codec == CODEC_AV1 ? "av1" : "hevc", asyncMode);
+    
+    NVENCEncoder* enc = (NVENCEncoder*)calloc(1, sizeof(NVENCEncoder));
+    if (!enc) return NULL;
+    
+    enc->width = width;
+    enc->height = height;
+    enc->fps = fps;
+    enc->codec = codec;
+    enc->frameDuration = MF_UNITS_PER_SECOND / fps;
+    enc->buf_count = NUM_BUFFERS;
+    enc->lastSurface = -1;
+    
+    // Load NVENC (once per process; NVENCEncoder_Prewarm may already have)
+    PFN_CREATE createInstance = ensure_nvenc_api();
+    if (!createInstance) {
+        free(enc);
+        return NULL;
+    }
+    
+    enc->fn.version = NV_ENCODE_API_FUNCTION_LIST_VER;
+    if (createInstance(&enc->fn) != NV_ENC_SUCCESS) {
+        NvLog("NVENC: CreateInstance failed\n");
         goto fail;
     }
     
+    // Prefer a session on the capture device so GPUConverter's NV12 output
+    // can be registered and encoded in place. The CUDA path (staging
+    // readback + host upload) remains as a fallback for drivers / devices
+    // that refuse a DirectX session.
+    if (!d3dDevice || !init_d3d11_path(enc, d3dDevice, quality, asyncMode)) {
+        if (d3dDevice) {
+            NvLog("NVENC: D3D11 zero-copy path unavailable, falling back to CUDA\n");
+        }
+        if (!init_cuda_path(enc, quality, asyncMode)) {
+            goto fail;
+        }
+    }
+    
     // Create bitstream buffers
     for (int i = 0; i < enc->buf_count; i++) {
         NV_ENC_CREATE_BITSTREAM_BUFFER createBuf = {0};
         createBuf.version = NV_ENC_CREATE_BITSTREAM_BUFFER_VER;
         
-        st = enc->fn.nvEncCreateBitstreamBuffer(enc->encoder, &createBuf);
+        NVENCSTATUS st = enc->fn.nvEncCreateBitstreamBuffer(enc->encoder, &createBuf);
         if (st != NV_ENC_SUCCESS) {
             NvLog("NVENC: CreateBitstreamBuffer[%d] failed (%d)\n", i, st);
             goto fail;
@@ -533,8 +822,15 @@ NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height
         enc->outputBuffers[i] = createBuf.bitstreamBuffer;
     }
     
+    if (enc->asyncMode && !init_async(enc)) {
+        NvLog("NVENC: Async retrieval setup failed\n");
+        goto fail;
+    }
+    
     enc->initialized = TRUE;
-    NvLog("NVENC: Ready (%d buffers, sync mode)\n", enc->buf_count);
+    NvLog("NVENC: Ready (%d buffers, %s mode, %s input)\n", enc->buf_count,
+          enc->asyncMode ? "async" : "sync",
+          enc->inputPath == NVENC_INPUT_D3D11 ? "D3D11 zero-copy" : "CUDA");
     return enc;
     
 fail:
@@ -542,6 +838,10 @@ fail:
     return NULL;
 }
 
+BOOL NVENCEncoder_Prewarm(void) {
+    return ensure_nvenc_api() != NULL;
+}
+
 void NVENCEncoder_SetCallback(NVENCEncoder* enc, EncodedFrameCallback callback, void* userData) {
     if (!enc) return;
     enc->frameCallback = callback;
@@ -594,37 +894,39 @@ static BOOL copy_frame(NVENCEncoder* enc, BYTE* data[2], int linesize[2], CudaSu
     return TRUE;
 }
 
-int NVENCEncoder_SubmitFrame(NVENCEncoder* enc, BYTE* data[2], int linesize[2], LONGLONG timestamp) {
-    if (!enc || !enc->initialized || !data[0] || !data[1]) return 0;
-    
-    int idx = enc->next_bitstream;
-    CudaSurface* surf = &enc->surfaces[idx];
-    NV_ENC_OUTPUT_PTR bs = enc->outputBuffers[idx];
+// Device-to-device copy of a whole NV12 surface (both planes share one
+// CUDA array, so a single 2D copy covers Y and UV)
+static BOOL copy_surface(NVENCEncoder* enc, const CudaSurface* src, CudaSurface* dst) {
+    CUDA_MEMCPY2D m = {0};
+    m.srcMemoryType = CU_MEMORYTYPE_ARRAY;
+    m.srcArray = src->tex;
+    m.dstMemoryType = CU_MEMORYTYPE_ARRAY;
+    m.dstArray = dst->tex;
+    m.WidthInBytes = enc->width;
+    m.Height = enc->height + enc->height / 2;  // NV12
     
-    // Copy frame to CUDA surface
-    if (!copy_frame(enc, data, linesize, surf)) {
-        NvLog("NVENC: copy_frame failed\n");
-        return 0;
+    CUresult res = cu->cuCtxPushCurrent(enc->cu_ctx);
+    if (res != CUDA_SUCCESS) {
+        NvLog("NVENC: cuCtxPushCurrent failed (%d)\n", res);
+        return FALSE;
     }
-    
-    // Map input resource
-    NV_ENC_MAP_INPUT_RESOURCE map = {0};
-    map.version = NV_ENC_MAP_INPUT_RESOURCE_VER;
-    map.registeredResource = surf->res;
-    map.mappedBufferFmt = NV_ENC_BUFFER_FORMAT_NV12;
-    
-    NVENCSTATUS st = enc->fn.nvEncMapInputResource(enc->encoder, &map);
-    if (st != NV_ENC_SUCCESS) {
-        NvLog("NVENC: MapInputResource failed (%d)\n", st);
-        return 0;
+    res = cu->cuMemcpy2D(&m);
+    cu->cuCtxPopCurrent(NULL);
+    if (res != CUDA_SUCCESS) {
+        NvLog("NVENC: cuMemcpy2D surface copy failed (%d)\n", res);
+        return FALSE;
     }
-    surf->mapped_res = map.mappedResource;
-    
-    // Encode
+    return TRUE;
+}
+
+// Issue nvEncEncodePicture for a mapped input into output slot idx.
+// In async mode the slot's completion event is attached.
+static NVENCSTATUS encode_picture(NVENCEncoder* enc, NV_ENC_INPUT_PTR input, int idx, LONGLONG timestamp) {
     NV_ENC_PIC_PARAMS picParams = {0};
     picParams.version = NV_ENC_PIC_PARAMS_VER;
-    picParams.inputBuffer = map.mappedResource;
-    picParams.outputBitstream = bs;
+    picParams.inputBuffer = input;
+    picParams.outputBitstream = enc->outputBuffers[idx];
+    picParams.completionEvent = enc->asyncMode ? enc->completionEvents[idx] : NULL;
     picParams.bufferFmt = NV_ENC_BUFFER_FORMAT_NV12;
     picParams.inputWidth = enc->width;
     picParams.inputHeight = enc->height;
@@ -637,72 +939,305 @@ int NVENCEncoder_SubmitFrame(NVENCEncoder* enc, BYTE* data[2], int linesize[2],
         picParams.encodePicFlags = NV_ENC_PIC_FLAG_FORCEIDR;
     }
     
-    st = enc->fn.nvEncEncodePicture(enc->encoder, &picParams);
-    if (st != NV_ENC_SUCCESS && st != NV_ENC_ERR_NEED_MORE_INPUT) {
-        NvLog("NVENC: EncodePicture failed (%d)\n", st);
-        enc->fn.nvEncUnmapInputResource(enc->encoder, surf->mapped_res);
-        surf->mapped_res = NULL;
-        return 0;
-    }
-    if (st == NV_ENC_ERR_NEED_MORE_INPUT) {
-        // With frameIntervalP=1 (no B-frames) + sync mode this should not
-        // occur. Guard against falling through to LockBitstream on a buffer
-        // with no produced data.
-        enc->fn.nvEncUnmapInputResource(enc->encoder, surf->mapped_res);
-        surf->mapped_res = NULL;
-        enc->next_bitstream = (enc->next_bitstream + 1) % enc->buf_count;
-        enc->frameNumber++;
-        return 1;
-    }
+    return enc->fn.nvEncEncodePicture(enc->encoder, &picParams);
+}
+
+// Lock output slot idx, copy the bitstream out and deliver it via the frame
+// callback. Sync mode: called on the owning thread right after encode.
+// Async mode: called on the retrieval thread once the slot's event fires.
+// Returns: 1 = success, 0 = failure
+static int retrieve_bitstream(NVENCEncoder* enc, int idx, LONGLONG timestamp) {
+    NV_ENC_OUTPUT_PTR bs = enc->outputBuffers[idx];
     
-    // Lock bitstream (sync mode - blocks until encode done)
+    // Lock bitstream (blocks until encode done; already done in async mode)
     NV_ENC_LOCK_BITSTREAM lock = {0};
     lock.version = NV_ENC_LOCK_BITSTREAM_VER;
     lock.outputBitstream = bs;
     
-    st = enc->fn.nvEncLockBitstream(enc->encoder, &lock);
+    LARGE_INTEGER lockStart, lockEnd;
+    QueryPerformanceCounter(&lockStart);
+    NVENCSTATUS st = enc->fn.nvEncLockBitstream(enc->encoder, &lock);
     if (st != NV_ENC_SUCCESS) {
         NvLog("NVENC: LockBitstream failed (%d)\n", st);
-        enc->fn.nvEncUnmapInputResource(enc->encoder, surf->mapped_res);
-        surf->mapped_res = NULL;
         return 0;
     }
     
-    // Copy encoded data and deliver via callback
+    // Copy encoded data (or lend the locked bitstream) and deliver via callback
     if (enc->frameCallback && lock.bitstreamSizeInBytes > 0) {
         EncodedFrame frame = {0};
-        frame.data = (BYTE*)malloc(lock.bitstreamSizeInBytes);
+        if (enc->borrowedOutput) {
+            frame.data = (BYTE*)lock.bitstreamBufferPtr;
+        } else {
+            frame.data = (BYTE*)malloc(lock.bitstreamSizeInBytes);
+            if (frame.data) {
+                LEAK_TRACK_NVENC_FRAME_ALLOC();
+                LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_NVENC_BITSTREAM, lock.bitstreamSizeInBytes);
+                memcpy(frame.data, lock.bitstreamBufferPtr, lock.bitstreamSizeInBytes);
+            }
+        }
         if (frame.data) {
-            LEAK_TRACK_NVENC_FRAME_ALLOC();
-            memcpy(frame.data, lock.bitstreamBufferPtr, lock.bitstreamSizeInBytes);
             frame.size = lock.bitstreamSizeInBytes;
             frame.timestamp = timestamp;
             frame.duration = enc->frameDuration;
             frame.isKeyframe = (lock.pictureType == NV_ENC_PIC_TYPE_IDR);
             
             // Stats
-            enc->lastFrameSize = lock.bitstreamSizeInBytes;
-            enc->totalBytesEncoded += lock.bitstreamSizeInBytes;
-            if (enc->minFrameSize == 0 || lock.bitstreamSizeInBytes < enc->minFrameSize)
-                enc->minFrameSize = lock.bitstreamSizeInBytes;
-            if (lock.bitstreamSizeInBytes > enc->maxFrameSize)
-                enc->maxFrameSize = lock.bitstreamSizeInBytes;
+            Metrics_SetGauge(METRIC_GAUGE_NVENC_LAST_FRAME_BYTES, lock.bitstreamSizeInBytes);
+            Metrics_Observe(METRIC_HIST_NVENC_FRAME_BYTES, lock.bitstreamSizeInBytes);
             
             enc->frameCallback(&frame, enc->callbackUserData);
         }
     }
     
-    // Unlock and unmap
     enc->fn.nvEncUnlockBitstream(enc->encoder, bs);
-    enc->fn.nvEncUnmapInputResource(enc->encoder, surf->mapped_res);
-    surf->mapped_res = NULL;
+    QueryPerformanceCounter(&lockEnd);
+    PipelineStats_Record(PIPELINE_STAGE_BITSTREAM_LOCK, lockStart, lockEnd);
+    return 1;
+}
+
+// Unmap whatever input output slot idx last carried (async mode).
+// Owning thread only, so Map/Unmap never race each other.
+static void release_slot_input(NVENCEncoder* enc, int idx) {
+    PendingFrame* p = &enc->pending[idx];
+    if (p->mappedInput) {
+        enc->fn.nvEncUnmapInputResource(enc->encoder, p->mappedInput);
+        p->mappedInput = NULL;
+    }
+    p->texture = NULL;
+}
+
+// Owning thread: claim the next output slot before writing its input
+// surface. Async mode waits for the retrieval thread to free it; sync mode
+// always has the slot available.
+static BOOL acquire_slot(NVENCEncoder* enc) {
+    if (!enc->asyncMode) return TRUE;
+    
+    if (WaitForSingleObject(enc->hSlotFree, ASYNC_SLOT_WAIT_MS) != WAIT_OBJECT_0) {
+        NvLog("NVENC: No free output slot after %d ms (encoder stalled?)\n", ASYNC_SLOT_WAIT_MS);
+        return FALSE;
+    }
+    release_slot_input(enc, enc->next_bitstream);
+    return TRUE;
+}
+
+// Give back a slot claimed by acquire_slot that was never queued.
+static void abandon_slot(NVENCEncoder* enc) {
+    if (enc->asyncMode) {
+        ReleaseSemaphore(enc->hSlotFree, 1, NULL);
+    }
+}
+
+// Encode a mapped input into the current output slot.
+// Sync mode retrieves and unmaps before returning. Async mode hands the slot
+// to the retrieval thread and leaves the input mapped until the slot is
+// reused (NVENC reads it until the completion event fires).
+// Returns: 1 = success, 0 = failure
+static int encode_and_dispatch(NVENCEncoder* enc, NV_ENC_INPUT_PTR input,
+                               ID3D11Texture2D* texture, LONGLONG timestamp) {
+    int idx = enc->next_bitstream;
+    
+    NVENCSTATUS st = encode_picture(enc, input, idx, timestamp);
+    if (st != NV_ENC_SUCCESS && st != NV_ENC_ERR_NEED_MORE_INPUT) {
+        NvLog("NVENC: EncodePicture failed (%d)\n", st);
+        enc->fn.nvEncUnmapInputResource(enc->encoder, input);
+        abandon_slot(enc);
+        return 0;
+    }
+    if (st == NV_ENC_ERR_NEED_MORE_INPUT) {
+        // With frameIntervalP=1 (no B-frames) this should not occur. Guard
+        // against locking a buffer with no produced data. Async mode keeps
+        // the slot so the retrieval order stays in step with submission.
+        enc->fn.nvEncUnmapInputResource(enc->encoder, input);
+        if (enc->asyncMode) {
+            abandon_slot(enc);
+        } else {
+            enc->next_bitstream = (enc->next_bitstream + 1) % enc->buf_count;
+        }
+        enc->frameNumber++;
+        return 1;
+    }
+    
+    if (enc->asyncMode) {
+        enc->pending[idx].mappedInput = input;
+        enc->pending[idx].texture = texture;
+        enc->pending[idx].timestamp = timestamp;
+        enc->next_bitstream = (enc->next_bitstream + 1) % enc->buf_count;
+        enc->frameNumber++;
+        ReleaseSemaphore(enc->hSlotQueued, 1, NULL);
+        return 1;
+    }
+    
+    int result = retrieve_bitstream(enc, idx, timestamp);
+    enc->fn.nvEncUnmapInputResource(enc->encoder, input);
+    if (!result) return 0;
     
     enc->next_bitstream = (enc->next_bitstream + 1) % enc->buf_count;
     enc->frameNumber++;
-    
     return 1;
 }
 
+static int submit_cuda_surface(NVENCEncoder* enc, LONGLONG timestamp);
+
+int NVENCEncoder_SubmitFrame(NVENCEncoder* enc, BYTE* data[2], int linesize[2], LONGLONG timestamp) {
+    if (!enc || !enc->initialized || !data[0] || !data[1]) return 0;
+    
+    // CPU input needs the CUDA upload surfaces, which only exist on the
+    // fallback path. Zero-copy sessions take textures via SubmitTexture.
+    if (enc->inputPath != NVENC_INPUT_CUDA) {
+        NvLog("NVENC: SubmitFrame unsupported on D3D11 input path\n");
+        return 0;
+    }
+    
+    if (!acquire_slot(enc)) return 0;
+    
+    CudaSurface* surf = &enc->surfaces[enc->next_bitstream];
+    
+    // Copy frame to CUDA surface
+    if (!copy_frame(enc, data, linesize, surf)) {
+        NvLog("NVENC: copy_frame failed\n");
+        abandon_slot(enc);
+        return 0;
+    }
+    
+    return submit_cuda_surface(enc, timestamp);
+}
+
+// Map the current slot's (already filled) CUDA surface and encode it.
+// Slot must have been claimed with acquire_slot.
+static int submit_cuda_surface(NVENCEncoder* enc, LONGLONG timestamp) {
+    int idx = enc->next_bitstream;
+    CudaSurface* surf = &enc->surfaces[idx];
+    
+    // Map input resource
+    NV_ENC_MAP_INPUT_RESOURCE map = {0};
+    map.version = NV_ENC_MAP_INPUT_RESOURCE_VER;
+    map.registeredResource = surf->res;
+    map.mappedBufferFmt = NV_ENC_BUFFER_FORMAT_NV12;
+    
+    NVENCSTATUS st = enc->fn.nvEncMapInputResource(enc->encoder, &map);
+    if (st != NV_ENC_SUCCESS) {
+        NvLog("NVENC: MapInputResource failed (%d)\n", st);
+        abandon_slot(enc);
+        return 0;
+    }
+    
+    int result = encode_and_dispatch(enc, map.mappedResource, NULL, timestamp);
+    if (result == 1) enc->lastSurface = idx;
+    return result;
+}
+
+// ============================================================================
+// Async Retrieval
+// ============================================================================
+
+// Drains output slots in submission order. One wake per queued slot: wait
+// for its completion event, lock/copy/unlock, deliver, then free the slot.
+static DWORD WINAPI RetrievalThreadProc(LPVOID param) {
+    NVENCEncoder* enc = (NVENCEncoder*)param;
+    HANDLE waits[2] = { enc->hRetrieveStop, enc->hSlotQueued };
+    
+    while (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+        int idx = enc->next_retrieve;
+        
+        DWORD wr = WaitForSingleObject(enc->completionEvents[idx], ASYNC_COMPLETION_WAIT_MS);
+        if (wr == WAIT_OBJECT_0) {
+            // CUDA sessions need the context current on the calling thread
+            BOOL pushed = enc->inputPath == NVENC_INPUT_CUDA &&
+                          cu->cuCtxPushCurrent(enc->cu_ctx) == CUDA_SUCCESS;
+            retrieve_bitstream(enc, idx, enc->pending[idx].timestamp);
+            if (pushed) cu->cuCtxPopCurrent(NULL);
+        } else {
+            NvLog("NVENC: Slot %d completion wait failed (%lu), dropping frame\n", idx, wr);
+        }
+        
+        enc->next_retrieve = (idx + 1) % enc->buf_count;
+        ReleaseSemaphore(enc->hSlotFree, 1, NULL);
+    }
+    return 0;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: init_async
+ * Resources: 4 + 2*NUM_BUFFERS - completion events, slot textures, 2 semaphores, stop event, thread
+ * Pattern: partial state left on enc; NVENCEncoder_Destroy (via Create's fail path) releases it
+ * Init: calloc'd encoder struct (all NULL)
+ */
+static BOOL init_async(NVENCEncoder* enc) {
+    for (int i = 0; i < enc->buf_count; i++) {
+        enc->completionEvents[i] = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (!enc->completionEvents[i]) return FALSE;
+        
+        NV_ENC_EVENT_PARAMS ev = {0};
+        ev.version = NV_ENC_EVENT_PARAMS_VER;
+        ev.completionEvent = enc->completionEvents[i];
+        NVENCSTATUS st = enc->fn.nvEncRegisterAsyncEvent(enc->encoder, &ev);
+        if (st != NV_ENC_SUCCESS) {
+            NvLog("NVENC: RegisterAsyncEvent[%d] failed (%d)\n", i, st);
+            SAFE_CLOSE_HANDLE(enc->completionEvents[i]);  // NULL = not registered
+            return FALSE;
+        }
+    }
+    
+    // D3D11 path: per-slot NV12 copies so NVENC never reads a texture the
+    // caller is already rendering the next frame into
+    if (enc->inputPath == NVENC_INPUT_D3D11) {
+        D3D11_TEXTURE2D_DESC desc = {0};
+        desc.Width = enc->width;
+        desc.Height = enc->height;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = DXGI_FORMAT_NV12;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = D3D11_BIND_RENDER_TARGET;
+        
+        for (int i = 0; i < enc->buf_count; i++) {
+            HRESULT hr = enc->d3dDevice->lpVtbl->CreateTexture2D(enc->d3dDevice, &desc, NULL,
+                                                                 &enc->slotTextures[i]);
+            if (FAILED(hr)) {
+                NvLog("NVENC: CreateTexture2D(slot %d) failed (0x%08X)\n", i, hr);
+                return FALSE;
+            }
+            if (!d3d11_get_registration(enc, enc->slotTextures[i])) return FALSE;
+        }
+    }
+    
+    enc->hSlotFree = CreateSemaphore(NULL, enc->buf_count, enc->buf_count, NULL);
+    enc->hSlotQueued = CreateSemaphore(NULL, 0, enc->buf_count, NULL);
+    enc->hRetrieveStop = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!enc->hSlotFree || !enc->hSlotQueued || !enc->hRetrieveStop) return FALSE;
+    
+    enc->hRetrieveThread = CreateThread(NULL, 0, RetrievalThreadProc, enc, 0, NULL);
+    if (!enc->hRetrieveThread) {
+        NvLog("NVENC: CreateThread(retrieval) failed (error=%lu)\n", GetLastError());
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Deliver everything still in flight, stop the retrieval thread and unmap
+// the inputs the slots were holding. Safe on a partially initialized encoder.
+static void shutdown_async(NVENCEncoder* enc) {
+    if (enc->hRetrieveThread) {
+        // Every slot free == every queued frame has reached the callback
+        for (int i = 0; i < enc->buf_count; i++) {
+            if (WaitForSingleObject(enc->hSlotFree, ASYNC_COMPLETION_WAIT_MS) != WAIT_OBJECT_0) {
+                NvLog("NVENC: Async drain timed out (%d/%d slots free)\n", i, enc->buf_count);
+                break;
+            }
+        }
+        SetEvent(enc->hRetrieveStop);
+        if (WaitForSingleObject(enc->hRetrieveThread, ASYNC_COMPLETION_WAIT_MS) == WAIT_TIMEOUT) {
+            NvLog("NVENC: Retrieval thread did not exit\n");
+        }
+        SAFE_CLOSE_HANDLE(enc->hRetrieveThread);
+    }
+    
+    for (int i = 0; i < enc->buf_count; i++) {
+        release_slot_input(enc, i);
+    }
+}
+
 BOOL NVENCEncoder_GetSequenceHeader(NVENCEncoder* enc, BYTE* buffer, DWORD bufferSize, DWORD* outSize) {
     if (!enc || !enc->initialized || !buffer || !outSize) return FALSE;
     
@@ -725,20 +1260,31 @@ BOOL NVENCEncoder_GetSequenceHeader(NVENCEncoder* enc, BYTE* buffer, DWORD buffe
     return TRUE;
 }
 
+void NVENCEncoder_SetInputRingDepth(NVENCEncoder* enc, int depth) {
+    if (!enc) return;
+    enc->inputRingDepth = depth;
+    if (enc->asyncMode && enc->inputPath == NVENC_INPUT_D3D11) {
+        NvLog("NVENC: Input ring depth %d -> %s\n", depth,
+              depth > enc->buf_count ? "encoding caller textures in place" : "copying into slot textures");
+    }
+}
+
+void NVENCEncoder_SetBorrowedOutput(NVENCEncoder* enc, BOOL borrowed) {
+    if (!enc) return;
+    enc->borrowedOutput = borrowed;
+    NvLog("NVENC: Output frames %s\n", borrowed ? "lent from the locked bitstream" : "copied to heap blocks");
+}
+
+BOOL NVENCEncoder_IsZeroCopy(NVENCEncoder* enc) {
+    return enc && enc->inputPath == NVENC_INPUT_D3D11;
+}
+
 int NVENCEncoder_GetQP(NVENCEncoder* enc) {
     return enc ? enc->qp : -1;
 }
 
-void NVENCEncoder_GetFrameSizeStats(NVENCEncoder* enc, UINT32* lastSize, UINT32* minSize, UINT32* maxSize, UINT32* avgSize) {
-    if (!enc) return;
-    if (lastSize) *lastSize = enc->lastFrameSize;
-    if (minSize) *minSize = enc->minFrameSize;
-    if (maxSize) *maxSize = enc->maxFrameSize;
-    if (avgSize && enc->frameNumber > 0) {
-        *avgSize = (UINT32)(enc->totalBytesEncoded / enc->frameNumber);
-    } else if (avgSize) {
-        *avgSize = 0;
-    }
+VideoCodec NVENCEncoder_GetCodec(NVENCEncoder* enc) {
+    return enc ? enc->codec : CODEC_HEVC;
 }
 
 void NVENCEncoder_Destroy(NVENCEncoder* enc) {
@@ -747,11 +1293,28 @@ void NVENCEncoder_Destroy(NVENCEncoder* enc) {
     NvLog("NVENC: Destroying encoder (%llu frames)\n", enc->frameNumber);
     
     if (enc->encoder) {
+        // Async: deliver in-flight frames before the callback target goes away
+        shutdown_async(enc);
+        
         // Send EOS
         NV_ENC_PIC_PARAMS picParams = {0};
         picParams.version = NV_ENC_PIC_PARAMS_VER;
         picParams.encodePicFlags = NV_ENC_PIC_FLAG_EOS;
-        enc->fn.nvEncEncodePicture(enc->encoder, &picParams);
+        picParams.completionEvent = enc->asyncMode ? enc->completionEvents[0] : NULL;
+        if (enc->fn.nvEncEncodePicture(enc->encoder, &picParams) == NV_ENC_SUCCESS &&
+            picParams.completionEvent) {
+            WaitForSingleObject(picParams.completionEvent, ASYNC_SLOT_WAIT_MS);
+        }
+        
+        // Unregister completion events
+        for (int i = 0; i < enc->buf_count; i++) {
+            if (enc->completionEvents[i]) {
+                NV_ENC_EVENT_PARAMS ev = {0};
+                ev.version = NV_ENC_EVENT_PARAMS_VER;
+                ev.completionEvent = enc->completionEvents[i];
+                enc->fn.nvEncUnregisterAsyncEvent(enc->encoder, &ev);
+            }
+        }
         
         // Destroy bitstream buffers
         for (int i = 0; i < enc->buf_count; i++) {
@@ -760,7 +1323,8 @@ void NVENCEncoder_Destroy(NVENCEncoder* enc) {
             }
         }
         
-        // Destroy surfaces
+        // Destroy surfaces / registrations
+        d3d11_unregister_all(enc);
         cuda_free_surfaces(enc);
         
         // Destroy encoder
@@ -770,24 +1334,83 @@ void NVENCEncoder_Destroy(NVENCEncoder* enc) {
     // Free CUDA context
     cuda_ctx_free(enc);
     
+    // Async handles
+    for (int i = 0; i < enc->buf_count; i++) {
+        SAFE_CLOSE_HANDLE(enc->completionEvents[i]);
+        SAFE_RELEASE(enc->slotTextures[i]);
+    }
+    SAFE_CLOSE_HANDLE(enc->hSlotFree);
+    SAFE_CLOSE_HANDLE(enc->hSlotQueued);
+    SAFE_CLOSE_HANDLE(enc->hRetrieveStop);
+    
     // Release cached staging texture
     SAFE_RELEASE(enc->stagingTexture);
     SAFE_RELEASE(enc->stagingCtx);
-    
-    if (enc->nvencLib) {
-        FreeLibrary(enc->nvencLib);
-    }
+    SAFE_RELEASE(enc->d3dCtx);
+    SAFE_RELEASE(enc->d3dDevice);
     
     free(enc);
 }
 
 // ============================================================================
-// D3D11 Texture Interface (reads back to CPU, then encodes via CUDA)
+// D3D11 Texture Interface
 // ============================================================================
 
+// TRUE if an in-flight async slot still has this texture mapped (e.g. CFR
+// gap fill re-submitting the previous frame)
+static BOOL texture_in_flight(NVENCEncoder* enc, ID3D11Texture2D* tex) {
+    for (int i = 0; i < enc->buf_count; i++) {
+        if (enc->pending[i].mappedInput && enc->pending[i].texture == tex) return TRUE;
+    }
+    return FALSE;
+}
+
+// Zero-copy: encode the caller's NV12 texture in place. In async mode the
+// texture is first copied (GPU-side) into the slot's own texture unless the
+// caller's ring guarantees it won't be rewritten while NVENC reads it.
+static int submit_texture_d3d11(NVENCEncoder* enc, ID3D11Texture2D* nv12Texture, LONGLONG timestamp) {
+    if (!acquire_slot(enc)) return 0;
+    
+    ID3D11Texture2D* input = nv12Texture;
+    BOOL inPlace = enc->inputRingDepth > enc->buf_count && !texture_in_flight(enc, nv12Texture);
+    if (enc->asyncMode && !inPlace) {
+        D3D11_BOX box = { 0, 0, 0, (UINT)enc->width, (UINT)enc->height, 1 };
+        input = enc->slotTextures[enc->next_bitstream];
+        enc->d3dCtx->lpVtbl->CopySubresourceRegion(enc->d3dCtx, (ID3D11Resource*)input, 0, 0, 0, 0,
+                                                   (ID3D11Resource*)nv12Texture, 0, &box);
+    }
+    
+    NV_ENC_REGISTERED_PTR res = d3d11_get_registration(enc, input);
+    if (!res) {
+        abandon_slot(enc);
+        return 0;
+    }
+    
+    NV_ENC_MAP_INPUT_RESOURCE map = {0};
+    map.version = NV_ENC_MAP_INPUT_RESOURCE_VER;
+    map.registeredResource = res;
+    map.mappedBufferFmt = NV_ENC_BUFFER_FORMAT_NV12;
+    
+    NVENCSTATUS st = enc->fn.nvEncMapInputResource(enc->encoder, &map);
+    if (st != NV_ENC_SUCCESS) {
+        NvLog("NVENC: MapInputResource (D3D11) failed (%d)\n", st);
+        abandon_slot(enc);
+        return 0;
+    }
+    
+    int result = encode_and_dispatch(enc, map.mappedResource, input, timestamp);
+    if (result == 1) enc->lastTexture = nv12Texture;
+    return result;
+}
+
 int NVENCEncoder_SubmitTexture(NVENCEncoder* enc, ID3D11Texture2D* nv12Texture, LONGLONG timestamp) {
-    if (!enc || !nv12Texture) return 0;
+    if (!enc || !enc->initialized || !nv12Texture) return 0;
     
+    if (enc->inputPath == NVENC_INPUT_D3D11) {
+        return submit_texture_d3d11(enc, nv12Texture, timestamp);
+    }
+    
+    // CUDA fallback: read back to CPU, then upload via cuMemcpy2D.
     // Create staging texture on first use (cached to avoid per-frame GPU alloc)
     if (!enc->stagingTexture) {
         ID3D11Device* device = NULL;
@@ -838,4 +1461,28 @@ int NVENCEncoder_SubmitTexture(NVENCEncoder* enc, ID3D11Texture2D* nv12Texture,
     return result;
 }
 
+int NVENCEncoder_SubmitRepeat(NVENCEncoder* enc, LONGLONG timestamp) {
+    if (!enc || !enc->initialized) return 0;
+    
+    // D3D11: the last texture is still registered; re-encoding it costs one
+    // encode (plus a GPU-side slot copy only if it is still in flight)
+    if (enc->inputPath == NVENC_INPUT_D3D11) {
+        if (!enc->lastTexture) return 0;
+        return submit_texture_d3d11(enc, enc->lastTexture, timestamp);
+    }
+    
+    // CUDA: the previous slot's surface still holds the frame; copy it
+    // device-to-device instead of a staging readback + host upload
+    if (enc->lastSurface < 0) return 0;
+    if (!acquire_slot(enc)) return 0;
+    
+    int idx = enc->next_bitstream;
+    if (idx != enc->lastSurface &&
+        !copy_surface(enc, &enc->surfaces[enc->lastSurface], &enc->surfaces[idx])) {
+        abandon_slot(enc);
+        return 0;
+    }
+    return submit_cuda_surface(enc, timestamp);
+}
+
 
@@ -1,19 +1,36 @@
 /*
- * nvenc_encoder.h - NVENC Hardware Encoder (CUDA Path)
+ * nvenc_encoder.h - NVENC Hardware Encoder (D3D11 zero-copy, CUDA fallback)
  *
  * SHARED BY: replay_buffer.c, recording.c
  *
- * HEVC hardware encoding via NVIDIA NVENC API.
+ * HEVC hardware encoding via NVIDIA NVENC API, or AV1 when requested and the
+ * GPU has an AV1 encoder (HEVC otherwise; see NVENCEncoder_GetCodec).
+ *
+ * Input paths:
+ *   - D3D11 (preferred): session opened on the caller's device; NV12
+ *     textures passed to SubmitTexture are registered once and encoded in
+ *     place. No staging readback, no host upload.
+ *   - CUDA (fallback): used when no device is given or the driver refuses a
+ *     DirectX session. SubmitTexture reads back to CPU and uploads via CUDA.
  *
  * Thread-safety contract:
  *   - NVENCEncoder is NOT thread-safe. All operations on a given encoder
  *     instance (SubmitFrame, SubmitTexture, GetSequenceHeader, GetQP,
- *     GetFrameSizeStats, Destroy) MUST be called from a single owning
- *     thread. The underlying CUDA context is thread-affine; calling from
+ *     Destroy) MUST be called from a single owning thread. The
+ *     underlying CUDA context is thread-affine; calling from
  *     a different thread will push the context onto the wrong thread and
- *     corrupt encoder state.
- *   - NVENCEncoder_Create may be called concurrently from multiple
- *     threads; module-level CUDA bootstrap is guarded internally.
+ *     corrupt encoder state. On the D3D11 path NVENC issues work on the
+ *     device's immediate context, so the owning thread must also be the
+ *     thread driving that context.
+ *   - NVENCEncoder_Create and NVENCEncoder_Prewarm may be called
+ *     concurrently from multiple threads; module-level CUDA and NVENC API
+ *     loading is guarded internally.
+ *   - Sync mode: EncodedFrameCallback runs on the owning thread, inside
+ *     SubmitFrame / SubmitTexture.
+ *   - Async mode: EncodedFrameCallback runs on the encoder's internal
+ *     retrieval thread, in submission order. Submit blocks only when all
+ *     output slots are in flight. Destroy delivers every in-flight frame
+ *     before returning, so the callback target must outlive Destroy.
  */
 
 #ifndef NVENC_ENCODER_H
@@ -36,28 +53,67 @@ typedef struct NVENCEncoder NVENCEncoder;
 // Callback for receiving completed frames
 typedef void (*EncodedFrameCallback)(EncodedFrame* frame, void* userData);
 
-// Create encoder (D3D11 device ignored - uses CUDA internally)
-NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height, int fps, QualityPreset quality);
+// Create encoder. When d3dDevice is non-NULL the zero-copy D3D11 path is tried
+// first (device is AddRef'd for the encoder's lifetime); otherwise, or if that
+// fails, the CUDA path is used.
+// codec CODEC_AV1 falls back to HEVC (logged) if the GPU cannot encode AV1.
+// asyncMode requests NVENC async encoding with a retrieval thread; silently
+// falls back to sync mode if the driver does not support it.
+NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height, int fps,
+                                  QualityPreset quality, VideoCodec codec, BOOL asyncMode);
+
+// Load nvEncodeAPI64.dll and resolve its entry point ahead of the first
+// NVENCEncoder_Create. Optional; any thread. FALSE if NVENC is unavailable.
+BOOL NVENCEncoder_Prewarm(void);
 
 // Set callback for completed frames
 void NVENCEncoder_SetCallback(NVENCEncoder* enc, EncodedFrameCallback callback, void* userData);
 
-// Submit NV12 frame for encoding (CPU buffers)
+// Submit NV12 frame for encoding (CPU buffers, CUDA path only)
 // data[0] = Y plane, data[1] = UV plane
 // linesize[0] = Y stride, linesize[1] = UV stride
 // Returns: 1 = success, 0 = failure
 int NVENCEncoder_SubmitFrame(NVENCEncoder* enc, BYTE* data[2], int linesize[2], LONGLONG timestamp);
 
-// Submit D3D11 texture for encoding (reads back to CPU internally)
+// Submit D3D11 NV12 texture for encoding.
+// D3D11 path: texture must live on the encoder's device and be at least
+// width x height; it is registered on first use and AddRef'd until Destroy.
+// CUDA path: reads back to CPU internally.
 // Returns: 1 = success, 0 = failure
 int NVENCEncoder_SubmitTexture(NVENCEncoder* enc, ID3D11Texture2D* nv12Texture, LONGLONG timestamp);
 
-// Get sequence header (VPS/SPS/PPS for HEVC)
+// Encode the last successfully submitted frame again at a new timestamp
+// without touching the caller's input (CFR gap fill, static content).
+// D3D11 path: re-encodes the last texture. CUDA path: device-to-device copy
+// of the previous slot's surface, no readback or host upload. Identical input
+// encodes as an all-skip P-frame; IDR cadence is preserved.
+// Returns: 1 = success, 0 = failure or nothing submitted yet
+int NVENCEncoder_SubmitRepeat(NVENCEncoder* enc, LONGLONG timestamp);
+
+// Get sequence header (Annex-B VPS/SPS/PPS for HEVC, the sequence header OBU for AV1)
 BOOL NVENCEncoder_GetSequenceHeader(NVENCEncoder* enc, BYTE* buffer, DWORD bufferSize, DWORD* outSize);
 
+// Declare that textures passed to SubmitTexture come from a ring of `depth`
+// textures used round-robin, i.e. a texture is rewritten only after depth-1
+// other textures have been submitted. When depth exceeds NVENC_ASYNC_DEPTH
+// the async D3D11 path encodes those textures in place instead of copying
+// each one into an encoder-owned slot texture. Default 0 (always copy).
+void NVENCEncoder_SetInputRingDepth(NVENCEncoder* enc, int depth);
+
+// Borrowed output: EncodedFrame.data points straight into NVENC's locked
+// bitstream buffer and is valid only until the callback returns; the
+// callback copies what it needs and must not free it. Default FALSE: each
+// frame is a malloc'd copy owned by the callback. Set before the first
+// submit (the async retrieval thread reads it without a lock).
+void NVENCEncoder_SetBorrowedOutput(NVENCEncoder* enc, BOOL borrowed);
+
+// TRUE if the encoder is on the D3D11 zero-copy input path
+BOOL NVENCEncoder_IsZeroCopy(NVENCEncoder* enc);
+
 // Stats
 int NVENCEncoder_GetQP(NVENCEncoder* enc);
-void NVENCEncoder_GetFrameSizeStats(NVENCEncoder* enc, UINT32* lastSize, UINT32* minSize, UINT32* maxSize, UINT32* avgSize);
+// Codec the session actually encodes (after any AV1 -> HEVC fallback)
+VideoCodec NVENCEncoder_GetCodec(NVENCEncoder* enc);
 
 // Cleanup
 void NVENCEncoder_Destroy(NVENCEncoder* enc);
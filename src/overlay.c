@@ -41,6 +41,9 @@
 #include "markers.h"
 #include "debug_console.h"
 #include "kill_feed_sampler.h"
+#include "clip_edit.h"
+#include "clip_index.h"
+#include "preview_tap.h"
 
 
 #pragma comment(lib, "comctl32.lib")
@@ -76,10 +79,12 @@ extern HWND g_controlWnd;
 #define ID_TIMER_HOVER     2004  // Timer to update hover state on icon buttons
 #define ID_TIMER_REPLAY_CHECK 2005  // Timer to check replay buffer health
 #define ID_TIMER_AUTOCLIP_DELAY 2006  // Delay before auto-clip save
+#define ID_TIMER_PREVIEW   2007  // Live replay preview repaint
 
 // System tray menu IDs (WM_TRAYICON is defined in tray_icon.h)
 #define ID_TRAY_SHOW       6001
 #define ID_TRAY_EXIT       6002
+#define ID_TRAY_CONTINUOUS 6003
 
 // Selection states
 typedef enum {
@@ -135,6 +140,7 @@ typedef struct OverlayWindowState {
     HWND settingsWnd;
     HWND crosshairWnd;
     HWND recordingPanel;            /* Inline timer + stop in control bar */
+    HWND previewWnd;                /* Live replay preview while settings are open */
 } OverlayWindowState;
 
 /*
@@ -143,6 +149,7 @@ typedef struct OverlayWindowState {
 typedef struct InteractionState {
     HWND lastHoveredIconBtn;
     HWND lastHoveredCaptureBtn;
+    BOOL hoverTimerActive;          /* ID_TIMER_HOVER runs only while the cursor is over the panel */
 } InteractionState;
 
 /* Static instances of consolidated state */
@@ -168,6 +175,7 @@ static void Overlay_SetRecordingState(BOOL isRecording);
 static LRESULT CALLBACK OverlayWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 static LRESULT CALLBACK CrosshairWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+static LRESULT CALLBACK ReplayPreviewWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 /* Helper functions */
 static HandlePosition HitTestHandle(POINT pt);
@@ -179,6 +187,7 @@ static void ActionToolbar_OnMinimize(void);
 static void ActionToolbar_OnRecord(void);
 static void ActionToolbar_OnClose(void);
 static void ActionToolbar_OnSettings(void);
+static void ActionToolbar_OnTrim(void);
 
 /**
  * Check for audio encoder errors after ReplayBuffer_Start and notify user.
@@ -199,6 +208,12 @@ static void DrawSelectionBorder(HDC hdc, RECT* rect) {
     DeleteObject(whitePen);
 }
 
+/* Retained overlay surface: kept while the overlay is shown so a selection
+ * drag only repaints and uploads the area the selection covered before and
+ * covers now. Released when the overlay is hidden (it is screen-sized). */
+static LayeredBitmap g_overlaySurface = {0};
+static RECT g_overlayMarked = {0};  /* Window-coord bounds of the last selection drawing */
+
 // Update layered window with dark overlay and clear selection hole
 static void UpdateOverlayBitmap(void) {
     if (!g_overlayWnd) return;
@@ -208,85 +223,105 @@ static void UpdateOverlayBitmap(void) {
     int width = wndRect.right - wndRect.left;
     int height = wndRect.bottom - wndRect.top;
     
-    // Create layered bitmap
-    LayeredBitmap lb = {0};
-    if (!LayeredBitmap_Create(&lb, width, height)) return;
-    
-    // Fill entire overlay with semi-transparent dark (BGRA 0,0,0,alpha)
-    // Use 32-bit fill — single pass instead of per-byte writes
-    DWORD overlayPixel = 100u << 24;  // alpha=100, RGB=0
-    DWORD* pixels32 = (DWORD*)lb.pixels;
-    size_t pixelCount = (size_t)width * (size_t)height;
-    for (size_t i = 0; i < pixelCount; i++) {
-        pixels32[i] = overlayPixel;
-    }
+    LayeredBitmap* lb = &g_overlaySurface;
+    BOOL fresh = !lb->hBitmap || lb->width != width || lb->height != height;
+    if (!LayeredBitmap_Ensure(lb, width, height)) return;
     
     // If we have a selection (drawing or complete), punch a clear hole
     BOOL hasSelection = !IsRectEmpty(&g_selection.selectedRect) && 
                         (g_selection.state == SEL_DRAWING || g_selection.state == SEL_COMPLETE || 
                          g_selection.state == SEL_MOVING || g_selection.state == SEL_RESIZING);
     
+    // Convert screen coords to window coords
+    int selLeft = g_selection.selectedRect.left - wndRect.left;
+    int selTop = g_selection.selectedRect.top - wndRect.top;
+    int selRight = g_selection.selectedRect.right - wndRect.left;
+    int selBottom = g_selection.selectedRect.bottom - wndRect.top;
+    int hs = HANDLE_SIZE / 2;
+
+    // Clamp to window bounds
+    if (selLeft < 0) selLeft = 0;
+    if (selTop < 0) selTop = 0;
+    if (selRight > width) selRight = width;
+    if (selBottom > height) selBottom = height;
+    
+    // Repaint what the old selection drawing covered plus what the new one
+    // will (border and handles reach hs past the selection edge)
+    RECT bounds = { 0, 0, width, height };
+    RECT marked = {0};
+    if (hasSelection) {
+        RECT reach = { selLeft - hs - 1, selTop - hs - 1, selRight + hs + 1, selBottom + hs + 1 };
+        IntersectRect(&marked, &reach, &bounds);
+    }
+    RECT paint;
+    if (fresh) {
+        paint = bounds;
+    } else {
+        UnionRect(&paint, &g_overlayMarked, &marked);
+    }
+    g_overlayMarked = marked;
+    if (IsRectEmpty(&paint)) return;
+    
+    // Fill with semi-transparent dark (BGRA 0,0,0,alpha), 32-bit per pixel
+    DWORD overlayPixel = 100u << 24;  // alpha=100, RGB=0
+    for (int y = paint.top; y < paint.bottom; y++) {
+        DWORD* row = (DWORD*)lb->pixels + (size_t)y * width;
+        for (int x = paint.left; x < paint.right; x++) {
+            row[x] = overlayPixel;
+        }
+    }
+    
     if (hasSelection) {
-        // Convert screen coords to window coords
-        int selLeft = g_selection.selectedRect.left - wndRect.left;
-        int selTop = g_selection.selectedRect.top - wndRect.top;
-        int selRight = g_selection.selectedRect.right - wndRect.left;
-        int selBottom = g_selection.selectedRect.bottom - wndRect.top;
-        
-        // Clamp to window bounds
-        if (selLeft < 0) selLeft = 0;
-        if (selTop < 0) selTop = 0;
-        if (selRight > width) selRight = width;
-        if (selBottom > height) selBottom = height;
-        
         // Clear the selection area (fully transparent)
-        for (int y = selTop; y < selBottom; y++) {
-            for (int x = selLeft; x < selRight; x++) {
-                BYTE* pixel = lb.pixels + (y * width + x) * 4;
-                pixel[0] = 0;
-                pixel[1] = 0;
-                pixel[2] = 0;
-                pixel[3] = 0; // Fully transparent
+        RECT sel = { selLeft, selTop, selRight, selBottom };
+        RECT hole;
+        if (IntersectRect(&hole, &sel, &paint)) {
+            for (int y = hole.top; y < hole.bottom; y++) {
+                DWORD* row = (DWORD*)lb->pixels + (size_t)y * width;
+                ZeroMemory(row + hole.left, (size_t)(hole.right - hole.left) * sizeof(DWORD));
             }
         }
         
+        // Keep GDI inside the repainted area
+        IntersectClipRect(lb->memDC, paint.left, paint.top, paint.right, paint.bottom);
+        
         // Draw white dotted border around selection
-        RECT borderRect = { selLeft, selTop, selRight, selBottom };
-        DrawSelectionBorder(lb.memDC, &borderRect);
+        DrawSelectionBorder(lb->memDC, &sel);
         
         // Draw resize handles when selection is complete
         if (g_selection.state == SEL_COMPLETE || g_selection.state == SEL_MOVING || g_selection.state == SEL_RESIZING) {
             HBRUSH whiteBrush = CreateSolidBrush(RGB(255, 255, 255));
-            HBRUSH oldBrush = (HBRUSH)SelectObject(lb.memDC, whiteBrush);
+            HBRUSH oldBrush = (HBRUSH)SelectObject(lb->memDC, whiteBrush);
             HPEN whitePen = CreatePen(PS_SOLID, 1, RGB(200, 200, 200));
-            HPEN oldPen = (HPEN)SelectObject(lb.memDC, whitePen);
+            HPEN oldPen = (HPEN)SelectObject(lb->memDC, whitePen);
             
             int cx = (selLeft + selRight) / 2;
             int cy = (selTop + selBottom) / 2;
-            int hs = HANDLE_SIZE / 2;
             
             // Corner handles
-            Ellipse(lb.memDC, selLeft - hs, selTop - hs, selLeft + hs, selTop + hs);           // TL
-            Ellipse(lb.memDC, selRight - hs, selTop - hs, selRight + hs, selTop + hs);         // TR
-            Ellipse(lb.memDC, selLeft - hs, selBottom - hs, selLeft + hs, selBottom + hs);     // BL
-            Ellipse(lb.memDC, selRight - hs, selBottom - hs, selRight + hs, selBottom + hs);   // BR
+            Ellipse(lb->memDC, selLeft - hs, selTop - hs, selLeft + hs, selTop + hs);           // TL
+            Ellipse(lb->memDC, selRight - hs, selTop - hs, selRight + hs, selTop + hs);         // TR
+            Ellipse(lb->memDC, selLeft - hs, selBottom - hs, selLeft + hs, selBottom + hs);     // BL
+            Ellipse(lb->memDC, selRight - hs, selBottom - hs, selRight + hs, selBottom + hs);   // BR
             
             // Edge handles
-            Ellipse(lb.memDC, cx - hs, selTop - hs, cx + hs, selTop + hs);                     // T
-            Ellipse(lb.memDC, cx - hs, selBottom - hs, cx + hs, selBottom + hs);               // B
-            Ellipse(lb.memDC, selLeft - hs, cy - hs, selLeft + hs, cy + hs);                   // L
-            Ellipse(lb.memDC, selRight - hs, cy - hs, selRight + hs, cy + hs);                 // R
+            Ellipse(lb->memDC, cx - hs, selTop - hs, cx + hs, selTop + hs);                     // T
+            Ellipse(lb->memDC, cx - hs, selBottom - hs, cx + hs, selBottom + hs);               // B
+            Ellipse(lb->memDC, selLeft - hs, cy - hs, selLeft + hs, cy + hs);                   // L
+            Ellipse(lb->memDC, selRight - hs, cy - hs, selRight + hs, cy + hs);                 // R
             
-            SelectObject(lb.memDC, oldBrush);
-            SelectObject(lb.memDC, oldPen);
+            SelectObject(lb->memDC, oldBrush);
+            SelectObject(lb->memDC, oldPen);
             DeleteObject(whiteBrush);
             DeleteObject(whitePen);
         }
+        
+        SelectClipRgn(lb->memDC, NULL);
     }
     
-    // Apply to layered window and cleanup
-    LayeredBitmap_Apply(&lb, g_overlayWnd, wndRect.left, wndRect.top);
-    LayeredBitmap_Destroy(&lb);
+    // Hand the window just the changed area
+    LayeredBitmap_Invalidate(lb, &paint);
+    LayeredBitmap_Present(lb, g_overlayWnd, wndRect.left, wndRect.top);
 }
 
 // Hit test for resize handles - returns which handle is under the point
@@ -442,23 +477,26 @@ static void ActionToolbar_OnSettings(void) {
     g_windows.settingsWnd = SettingsDialog_ShowAt(g_windows.hInstance, x, y);
 }
 
+static void ActionToolbar_OnTrim(void) {
+    // Hide toolbar and selection, then edit saved clips from the control panel
+    ActionToolbar_Hide();
+    ShowWindow(g_overlayWnd, SW_HIDE);
+    g_selection.state = SEL_NONE;
+    SetRectEmpty(&g_selection.selectedRect);
+    InterlockedExchange(&g_isSelecting, FALSE);
+
+    ShowWindow(g_controlWnd, SW_SHOW);
+    ClipEdit_ShowDialog(g_controlWnd, g_config.savePath);
+}
+
 // Timer text for display
 static char g_timerText[64] = "00:00";
 
-// Replay save context for sidecar writing
-static ULONGLONG g_replaySaveRequestMs = 0;
-static char g_replaySavePath[MAX_PATH] = {0};
-
-// Auto-clip save context
+// Auto-clip save context. Saved paths and spans come back in each save's
+// ReplaySaveResult, so several saves may be queued at once.
 static ULONGLONG g_autoClipSaveRequestMs = 0;
-static char g_autoClipSavePath[MAX_PATH] = {0};
 static char g_autoClipGameName[64] = {0};  // Foreground process at kill time
 
-// Debounce flag: gates both F5 (HOTKEY_REPLAY_SAVE) and auto-clip save paths
-// against concurrent ReplayBuffer_SaveAsync calls that deadlock the BUFFER thread.
-// Set before SaveAsync, cleared on WM_REPLAY_SAVE_COMPLETE / WM_AUTOCLIP_SAVE_COMPLETE.
-static volatile LONG g_replaySaveInFlight = 0;
-
 /*
  * Get the foreground window's process name (without .exe extension).
  * Writes to outBuf. Returns TRUE if a name was found.
@@ -519,6 +557,43 @@ static void BuildGameSavePath(char* outPath, int outSize, const char* prefix,
     }
 }
 
+// Start a continuous save of the replay buffer, or end the running one.
+// WM_REPLAY_SAVE_COMPLETE arrives once the file is finalized.
+static void ToggleContinuousSave(HWND hwnd) {
+    if (ReplayBuffer_IsContinuousSaving(&g_replayBuffer)) {
+        ReplayBuffer_EndContinuousSave(&g_replayBuffer);
+        Logger_Log("Continuous save: stop requested\n");
+        Border_Flash();
+        return;
+    }
+    if (!g_replayBuffer.isBuffering || !g_replayBuffer.bufferReady) {
+        Logger_Log("Continuous save: buffer not ready, ignoring\n");
+        MessageBeep(MB_ICONWARNING);
+        return;
+    }
+    
+    char gameName[64];
+    GetForegroundGameName(gameName, sizeof(gameName));
+    char filename[MAX_PATH];
+    BuildGameSavePath(filename, sizeof(filename), "Continuous", gameName);
+    
+    if (ReplayBuffer_BeginContinuousSave(&g_replayBuffer, filename, hwnd, WM_REPLAY_SAVE_COMPLETE)) {
+        Logger_Log("Continuous save started: %s\n", filename);
+        Border_FlashColor(255, 60, 60);
+    } else {
+        Logger_Log("Continuous save failed to start\n");
+        MessageBeep(MB_ICONWARNING);
+    }
+}
+
+
+// Repaint the three capture-mode buttons. No erase: WM_DRAWITEM fills the
+// whole item itself.
+static void InvalidateModeButtons(HWND hwnd) {
+    InvalidateRect(GetDlgItem(hwnd, ID_MODE_AREA), NULL, FALSE);
+    InvalidateRect(GetDlgItem(hwnd, ID_MODE_WINDOW), NULL, FALSE);
+    InvalidateRect(GetDlgItem(hwnd, ID_MODE_MONITOR), NULL, FALSE);
+}
 
 // Update timer display text
 static void UpdateTimerDisplay(void) {
@@ -539,15 +614,18 @@ static void UpdateTimerDisplay(void) {
     }
     
     /* Append marker count if any */
+    char text[sizeof(g_timerText)];
     int markerCount = Markers_GetCount(&g_recording.markers);
     if (markerCount > 0) {
-        snprintf(g_timerText, sizeof(g_timerText), "%s  M:%d", timeBuf, markerCount);
+        snprintf(text, sizeof(text), "%s  M:%d", timeBuf, markerCount);
     } else {
-        strncpy(g_timerText, timeBuf, sizeof(g_timerText) - 1);
-        g_timerText[sizeof(g_timerText) - 1] = '\0';
+        strncpy(text, timeBuf, sizeof(text) - 1);
+        text[sizeof(text) - 1] = '\0';
     }
+    if (strcmp(text, g_timerText) == 0) return;
+    memcpy(g_timerText, text, sizeof(g_timerText));
     
-    // Trigger repaint of recording panel
+    // Trigger repaint of recording panel (skipped by Windows while the panel is hidden)
     InvalidateRect(g_windows.recordingPanel, NULL, FALSE);
 }
 
@@ -599,10 +677,21 @@ BOOL Overlay_Create(HINSTANCE hInstance) {
     wcCross.lpszClassName = "LWSRCrosshair";
     RegisterClassExA(&wcCross);
     
+    // Register live replay preview class
+    WNDCLASSEXA wcPreview = {0};
+    wcPreview.cbSize = sizeof(wcPreview);
+    wcPreview.lpfnWndProc = ReplayPreviewWndProc;
+    wcPreview.hInstance = hInstance;
+    wcPreview.hCursor = LoadCursor(NULL, IDC_SIZEALL);
+    wcPreview.hbrBackground = NULL;
+    wcPreview.lpszClassName = "LWSRReplayPreview";
+    RegisterClassExA(&wcPreview);
+    
     // Initialize new action toolbar module
     ActionToolbar_Init(hInstance);
     ActionToolbar_SetCallbacks(ActionToolbar_OnMinimize, ActionToolbar_OnRecord, 
                                ActionToolbar_OnClose, ActionToolbar_OnSettings);
+    ActionToolbar_SetTrimCallback(ActionToolbar_OnTrim);
     
     // Initialize border module
     Border_Init(hInstance);
@@ -710,6 +799,7 @@ void Overlay_Destroy(void) {
         DestroyWindow(g_windows.settingsWnd);
         g_windows.settingsWnd = NULL;
     }
+    HideReplayPreview();
     
     // Shutdown action toolbar module
     ActionToolbar_Shutdown();
@@ -731,6 +821,7 @@ void Overlay_Destroy(void) {
         DestroyWindow(g_overlayWnd);
         g_overlayWnd = NULL;
     }
+    LayeredBitmap_Destroy(&g_overlaySurface);
 }
 
 static void Overlay_SetMode(CaptureMode mode) {
@@ -754,8 +845,6 @@ static void Overlay_SetMode(CaptureMode mode) {
         // Hide overlay
         ShowWindow(g_overlayWnd, SW_HIDE);
     }
-    
-    InvalidateRect(g_overlayWnd, NULL, TRUE);
 }
 
 /*
@@ -767,14 +856,17 @@ static void Overlay_StartRecording(void) {
     if (Recording_IsActive(&g_recording)) return;
     if (IsRectEmpty(&g_selection.selectedRect)) return;
     
+    // Replay buffer running: record its encoded stream (it owns g_capture)
+    BOOL shared = g_replayBuffer.isBuffering;
+    
     // Set capture region
-    if (!Capture_SetRegion(&g_capture, g_selection.selectedRect)) {
+    if (!shared && !Capture_SetRegion(&g_capture, g_selection.selectedRect)) {
         MessageBoxA(NULL, "Failed to set capture region", "Error", MB_OK | MB_ICONERROR);
         return;
     }
     
     // Validate dimensions
-    if (g_capture.captureWidth < 16 || g_capture.captureHeight < 16) {
+    if (!shared && (g_capture.captureWidth < 16 || g_capture.captureHeight < 16)) {
         MessageBoxA(NULL, "Capture area too small", "Error", MB_OK | MB_ICONERROR);
         return;
     }
@@ -787,8 +879,20 @@ static void Overlay_StartRecording(void) {
     // Clear markers for new recording session
     Markers_Init(&g_recording.markers);
     
+    if (shared) {
+        if (!Recording_StartShared(&g_recording, &g_selection.selectedRect, &g_config, outputPath)) {
+            MessageBoxW(NULL,
+                L"Cannot start recording while the replay buffer is running\n"
+                L"with a different region, output resolution, frame rate or quality.\n\n"
+                L"Select the replay buffer's capture area, or disable the replay\n"
+                L"buffer in Settings > Video before starting a manual recording.",
+                L"Recording Unavailable",
+                MB_OK | MB_ICONINFORMATION);
+            return;
+        }
+    }
     // Start recording via recording.c
-    if (!Recording_Start(&g_recording, &g_capture, &g_config, outputPath)) {
+    else if (!Recording_Start(&g_recording, &g_capture, &g_config, outputPath)) {
         char errMsg[512];
         snprintf(errMsg, sizeof(errMsg), 
             "Failed to start recording.\nPath: %s\nSize: %dx%d",
@@ -840,11 +944,15 @@ static void Overlay_StopRecording(void) {
     Recording_Stop(&g_recording);
     
     // Write marker sidecar file if any markers were placed
+    ULONGLONG endMs = GetTickCount64();
     if (Markers_GetCount(&g_recording.markers) > 0) {
-        ULONGLONG endMs = GetTickCount64();
         Markers_WriteSidecar(&g_recording.markers, g_recording.outputPath,
                              g_recording.startTime, endMs);
     }
+    if (g_config.saveIndex) {
+        ClipIndex_WriteSidecar(g_recording.outputPath, &g_recording.markers,
+                               g_recording.startTime, endMs);
+    }
     
     // --- UI updates (overlay-specific) ---
     
@@ -975,6 +1083,15 @@ static LRESULT CALLBACK OverlayWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
             }
             return 0;
         
+        case WM_SHOWWINDOW:
+            // Every hide path lands here; drop the screen-sized surface so
+            // a hidden overlay holds no memory. The next show repaints it.
+            if (!wParam) {
+                LayeredBitmap_Destroy(&g_overlaySurface);
+                SetRectEmpty(&g_overlayMarked);
+            }
+            break;
+        
         case WM_SETCURSOR: {
             // Cursor depends on state and what's under the mouse
             POINT pt;
@@ -1507,8 +1624,7 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
             // No mode selected by default
             g_currentMode = MODE_NONE;
             
-            // Start hover timer for icon button updates
-            SetTimer(hwnd, ID_TIMER_HOVER, 50, NULL);
+            // Hover timer starts from WM_SETCURSOR when the cursor enters
             
             // Start replay buffer health check timer (every 2 seconds)
             SetTimer(hwnd, ID_TIMER_REPLAY_CHECK, 2000, NULL);
@@ -1529,9 +1645,7 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                         Overlay_SetMode(MODE_AREA);
                     }
                     // Invalidate all mode buttons
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_AREA), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_WINDOW), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_MONITOR), NULL, TRUE);
+                    InvalidateModeButtons(hwnd);
                     break;
                 case ID_MODE_WINDOW:
                     /* If settings open, toggle Audio tab; else switch capture mode */
@@ -1545,9 +1659,7 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     } else {
                         Overlay_SetMode(MODE_WINDOW);
                     }
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_AREA), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_WINDOW), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_MONITOR), NULL, TRUE);
+                    InvalidateModeButtons(hwnd);
                     break;
                 case ID_MODE_MONITOR:
                     /* If settings open, toggle Video tab; else switch capture mode */
@@ -1561,9 +1673,7 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     } else {
                         Overlay_SetMode(MODE_MONITOR);
                     }
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_AREA), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_WINDOW), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_MONITOR), NULL, TRUE);
+                    InvalidateModeButtons(hwnd);
                     break;
                 case ID_BTN_SETTINGS:
                     // Toggle settings window
@@ -1582,10 +1692,8 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     }
                     
                     // Refresh all buttons to show new labels/state
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_AREA), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_WINDOW), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_MODE_MONITOR), NULL, TRUE);
-                    InvalidateRect(GetDlgItem(hwnd, ID_BTN_SETTINGS), NULL, TRUE);
+                    InvalidateModeButtons(hwnd);
+                    InvalidateRect(GetDlgItem(hwnd, ID_BTN_SETTINGS), NULL, FALSE);
                     break;
                 case ID_BTN_RECORD:
                     /* Don't allow starting recording while settings are open */
@@ -1596,16 +1704,8 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     if (InterlockedCompareExchange(&g_isRecording, 0, 0)) {
                         Overlay_StopRecording();
                     } else {
-                        /* Check if replay buffer is running - can't record simultaneously */
-                        if (g_replayBuffer.isBuffering) {
-                            MessageBoxW(hwnd,
-                                L"Cannot start recording while replay buffer is running.\n\n"
-                                L"Please disable the replay buffer in Settings > Video\n"
-                                L"before starting a manual recording.",
-                                L"Recording Unavailable",
-                                MB_OK | MB_ICONINFORMATION);
-                            break;
-                        }
+                        /* With the replay buffer running, Overlay_StartRecording
+                         * records its stream (Recording_StartShared) */
                         // If no selection, use full primary monitor
                         if (IsRectEmpty(&g_selection.selectedRect)) {
                             HMONITOR hMon = MonitorFromPoint((POINT){0,0}, MONITOR_DEFAULTTOPRIMARY);
@@ -1616,7 +1716,7 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                         Overlay_StartRecording();
                     }
                     // Redraw button to show state change
-                    InvalidateRect(GetDlgItem(hwnd, ID_BTN_RECORD), NULL, TRUE);
+                    InvalidateRect(GetDlgItem(hwnd, ID_BTN_RECORD), NULL, FALSE);
                     break;
                 case ID_BTN_CLOSE: {
                     // Hide window immediately to avoid visual artifacts
@@ -1729,8 +1829,25 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     }
                     g_interaction.lastHoveredCaptureBtn = currentHoveredCapture;
                 }
+                
+                // Cursor left the panel and highlights are cleared: stop polling
+                RECT panelRect;
+                GetWindowRect(hwnd, &panelRect);
+                if (!PtInRect(&panelRect, pt) && !currentHovered && !currentHoveredCapture) {
+                    KillTimer(hwnd, ID_TIMER_HOVER);
+                    g_interaction.hoverTimerActive = FALSE;
+                }
             }
             return 0;
+        
+        case WM_SETCURSOR:
+            // Sent for the panel and (via DefWindowProc) its buttons whenever
+            // the cursor moves over them; hover polling runs only from here
+            // until the cursor leaves again
+            if (!g_interaction.hoverTimerActive) {
+                g_interaction.hoverTimerActive = SetTimer(hwnd, ID_TIMER_HOVER, 50, NULL) != 0;
+            }
+            break;
             
         case WM_PAINT: {
             PAINTSTRUCT ps;
@@ -1812,16 +1929,17 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                 borderColor = RGB(80, 80, 80);
             }
             
-            // For icon buttons with hover, draw rounded rect; otherwise flat fill
+            // Bar background under the whole item first: invalidations skip
+            // the erase (no flicker), and the anti-aliased corners below must
+            // blend over the bar rather than over the previous state
+            if (!g_ctlBgBrush) g_ctlBgBrush = CreateSolidBrush(RGB(32, 32, 32));
+            FillRect(dis->hDC, &dis->rcItem, g_ctlBgBrush);
+            
+            // For icon buttons with hover, draw rounded rect; otherwise flat bar
             if (isIconButton) {
                 if (showHoverBg) {
                     // Draw rounded hover background
                     DrawRoundedRectAA(dis->hDC, &dis->rcItem, 4, bgColor, borderColor);
-                } else {
-                    // Flat fill to match bar background
-                    HBRUSH bgBrush = CreateSolidBrush(bgColor);
-                    FillRect(dis->hDC, &dis->rcItem, bgBrush);
-                    DeleteObject(bgBrush);
                 }
             } else {
                 // Draw anti-aliased rounded button background
@@ -1834,11 +1952,11 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                 return TRUE;
             }
             
-            // Record button - grayed out when replay buffer is running
+            // Record button (stays enabled with the replay buffer running:
+            // recording then shares its stream)
             if (ctlId == ID_BTN_RECORD) {
                 BOOL isRecording = InterlockedCompareExchange(&g_isRecording, 0, 0) != 0;
-                BOOL isDisabled = g_replayBuffer.isBuffering && !isRecording;
-                DrawRecordButton(dis, isRecording, isDisabled);
+                DrawRecordButton(dis, isRecording, FALSE);
                 return TRUE;
             }
             
@@ -1896,6 +2014,26 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     Logger_Log("Marker hotkey: nothing active, ignoring\n");
                 }
                 
+                /* [Markers] ClipSeconds: also save the window around the new
+                 * replay marker (the save finishes ClipSeconds from now) */
+                if (added && !Recording_IsActive(&g_recording) && g_config.markerClipSec > 0 &&
+                    g_replayBuffer.bufferReady) {
+                    char gameName[64];
+                    GetForegroundGameName(gameName, sizeof(gameName));
+                    char filename[MAX_PATH];
+                    BuildGameSavePath(filename, sizeof(filename), "Marker", gameName);
+                    
+                    BOOL started = ReplayBuffer_SaveMarkerAsync(&g_replayBuffer, filename, -1,
+                                                                g_config.markerClipSec,
+                                                                g_config.markerClipSec,
+                                                                hwnd, WM_REPLAY_SAVE_COMPLETE);
+                    Logger_Log("Marker hotkey: %s -%ds/+%ds clip %s
+",
+                               started ? "started" : "failed to start",
+                               g_config.markerClipSec, g_config.markerClipSec, filename);
+                    if (!started) MessageBeep(MB_ICONWARNING);
+                }
+                
                 if (added) {
                     Border_Flash();
                     /* Repaint recording panel to update marker count */
@@ -1905,6 +2043,10 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                 }
                 return 0;
             }
+            if (wParam == HOTKEY_CONTINUOUS_SAVE) {
+                ToggleContinuousSave(hwnd);
+                return 0;
+            }
             if (wParam == HOTKEY_REPLAY_SAVE) {
                 Logger_Log("HOTKEY_REPLAY_SAVE matched, isBuffering=%d, bufferReady=%d\n", 
                            g_replayBuffer.isBuffering, g_replayBuffer.bufferReady);
@@ -1919,13 +2061,6 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     MessageBeep(MB_ICONWARNING);
                     return 0;
                 }
-                // Debounce: ignore F5 while a save is already in flight (manual or auto-clip).
-                if (InterlockedCompareExchange(&g_replaySaveInFlight, 1, 0) != 0) {
-                    Logger_Log("F5 ignored: replay save already in flight (source=F5)\n");
-                    MessageBeep(MB_ICONWARNING);
-                    return 0;
-                }
-                
                 // Generate filename with game subfolder
                 char gameName[64];
                 GetForegroundGameName(gameName, sizeof(gameName));
@@ -1935,12 +2070,8 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                 Logger_Log("Generated filename: %s\n", filename);
                 Logger_Log("Calling ReplayBuffer_SaveAsync...\n");
                 
-                // Capture save context for sidecar writing
-                g_replaySaveRequestMs = GetTickCount64();
-                strncpy(g_replaySavePath, filename, MAX_PATH - 1);
-                g_replaySavePath[MAX_PATH - 1] = '\0';
-                
-                // Request async save - will post WM_REPLAY_SAVE_COMPLETE when done
+                // Request async save - will post WM_REPLAY_SAVE_COMPLETE when done.
+                // Fails only when REPLAY_SAVE_QUEUE_DEPTH saves are outstanding.
                 BOOL started = ReplayBuffer_SaveAsync(&g_replayBuffer, filename,
                                                       hwnd, WM_REPLAY_SAVE_COMPLETE);
                 
@@ -1949,7 +2080,6 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                     // Could show a "saving..." indicator here
                 } else {
                     Logger_Log("Failed to start async save (source=F5)\n");
-                    InterlockedExchange(&g_replaySaveInFlight, 0);
                     MessageBeep(MB_ICONWARNING);
                 }
             }
@@ -1957,19 +2087,22 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
         }
         
         case WM_REPLAY_SAVE_COMPLETE: {
-            // Async save completed - wParam contains success status
+            // Async save completed - wParam contains success status,
+            // lParam the heap-allocated ReplaySaveResult (we free it)
             BOOL success = (BOOL)wParam;
+            ReplaySaveResult* result = (ReplaySaveResult*)lParam;
             Logger_Log("WM_REPLAY_SAVE_COMPLETE received: success=%d\n", success);
-            InterlockedExchange(&g_replaySaveInFlight, 0);
             
             if (success) {
-                // Write marker sidecar file for replay if any markers exist
-                if (Markers_GetCount(&g_replayBuffer.markers) > 0 && g_replaySavePath[0]) {
-                    ULONGLONG bufferDurationMs = (ULONGLONG)g_config.replayDuration * 1000;
-                    ULONGLONG startMs = (g_replaySaveRequestMs > bufferDurationMs) 
-                                        ? (g_replaySaveRequestMs - bufferDurationMs) : 0;
-                    Markers_WriteSidecar(&g_replayBuffer.markers, g_replaySavePath,
-                                        startMs, g_replaySaveRequestMs);
+                // Write marker sidecar file for replay if any markers exist,
+                // over the span the buffer thread actually wrote
+                if (Markers_GetCount(&g_replayBuffer.markers) > 0 && result) {
+                    Markers_WriteSidecar(&g_replayBuffer.markers, result->path,
+                                        result->startMs, result->endMs);
+                }
+                if (g_config.saveIndex && result) {
+                    ClipIndex_WriteSidecar(result->path, &g_replayBuffer.markers,
+                                           result->startMs, result->endMs);
                 }
                 
                 // Play Windows system notification sound via registry alias
@@ -1982,9 +2115,15 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
             } else {
                 PlaySound(TEXT("SystemHand"), NULL, SND_ALIAS | SND_ASYNC);
             }
+            free(result);
             return 0;
         }
         
+        case WM_CLIP_EDIT_COMPLETE:
+            // Toolbar trim / join finished on clip_edit.c's worker
+            ClipEdit_OnComplete(hwnd, lParam);
+            return 0;
+        
         case WM_AUTOCLIP_SAVE: {
             Logger_Log("WM_AUTOCLIP_SAVE received\n");
             DebugConsole_Print("KILL DETECTED -> save triggered\n");
@@ -2022,22 +2161,18 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                 Logger_Log("Auto-clip: buffer not ready at save time, ignoring\n");
                 return 0;
             }
-            // Debounce: skip auto-clip if a save (manual or auto-clip) is already in flight.
-            if (InterlockedCompareExchange(&g_replaySaveInFlight, 1, 0) != 0) {
-                Logger_Log("Auto-clip skipped: replay save already in flight (source=auto-clip)\n");
-                DebugConsole_Print("AUTO-CLIP SKIPPED: save already in flight\n");
-                return 0;
-            }
-            
             char filename[MAX_PATH];
             BuildGameSavePath(filename, sizeof(filename), "AutoClip", g_autoClipGameName);
             
             g_autoClipSaveRequestMs = GetTickCount64();
-            strncpy(g_autoClipSavePath, filename, MAX_PATH - 1);
-            g_autoClipSavePath[MAX_PATH - 1] = '\0';
             
-            BOOL started = ReplayBuffer_SaveAsync(&g_replayBuffer, filename,
-                                                  hwnd, WM_AUTOCLIP_SAVE_COMPLETE);
+            /* ClipSeconds > 0: only the last N seconds, which still covers the
+             * kill when N exceeds the save delay */
+            BOOL started = (g_config.autoClipClipSec > 0)
+                ? ReplayBuffer_SaveRangeAsync(&g_replayBuffer, filename, g_config.autoClipClipSec, 0,
+                                              hwnd, WM_AUTOCLIP_SAVE_COMPLETE)
+                : ReplayBuffer_SaveAsync(&g_replayBuffer, filename,
+                                         hwnd, WM_AUTOCLIP_SAVE_COMPLETE);
             if (started) {
                 Logger_Log("Auto-clip save started (source=auto-clip): %s\n", filename);
                 DebugConsole_Print("SAVING: %s\n", filename);
@@ -2046,29 +2181,30 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                 // Green border flash for auto-clip
                 Border_FlashColor(0, 255, 100);
             } else {
-                Logger_Log("Auto-clip save failed to start (source=auto-clip)\n");
-                InterlockedExchange(&g_replaySaveInFlight, 0);
+                Logger_Log("Auto-clip save failed to start (source=auto-clip, queue full?)\n");
+                DebugConsole_Print("AUTO-CLIP SKIPPED: save queue full\n");
             }
             return 0;
         }
         
         case WM_AUTOCLIP_SAVE_COMPLETE: {
             BOOL success = (BOOL)wParam;
+            ReplaySaveResult* result = (ReplaySaveResult*)lParam;  /* We free it */
             Logger_Log("WM_AUTOCLIP_SAVE_COMPLETE: success=%d\n", success);
-            InterlockedExchange(&g_replaySaveInFlight, 0);
             DebugConsole_Print("SAVE %s\n", success ? "COMPLETE - clip saved!" : "FAILED");
             if (success) {
                 /* Write companion .txt and .bmp next to the clip (debug mode only) */
-                if (DebugConsole_IsOpen()) {
+                if (DebugConsole_IsOpen() && result) {
                     KillFeedSampler* kfs = (KillFeedSampler*)g_replayBuffer.killFeedSampler;
                     if (kfs) {
-                        KillFeedSampler_WriteTriggerContext(kfs, g_autoClipSavePath, TRUE);
+                        KillFeedSampler_WriteTriggerContext(kfs, result->path, TRUE);
                     }
                 }
                 PlaySound(TEXT("SystemNotification"), NULL, SND_ALIAS | SND_ASYNC);
             } else {
                 PlaySound(TEXT("SystemHand"), NULL, SND_ALIAS | SND_ASYNC);
             }
+            free(result);
             return 0;
         }
         
@@ -2083,6 +2219,12 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                 
                 HMENU hMenu = CreatePopupMenu();
                 AppendMenuA(hMenu, MF_STRING, ID_TRAY_SHOW, "Show");
+                if (g_replayBuffer.isBuffering) {
+                    BOOL rolling = ReplayBuffer_IsContinuousSaving(&g_replayBuffer);
+                    AppendMenuA(hMenu, MF_STRING | (rolling ? MF_CHECKED : 0) |
+                                       (rolling || g_replayBuffer.bufferReady ? 0 : MF_GRAYED),
+                                ID_TRAY_CONTINUOUS, "Keep rolling (continuous save)");
+                }
                 AppendMenuA(hMenu, MF_SEPARATOR, 0, NULL);
                 AppendMenuA(hMenu, MF_STRING, ID_TRAY_EXIT, "Exit");
                 
@@ -2093,6 +2235,8 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
                 
                 if (cmd == ID_TRAY_SHOW) {
                     TrayIcon_Restore(g_controlWnd);
+                } else if (cmd == ID_TRAY_CONTINUOUS) {
+                    ToggleContinuousSave(hwnd);
                 } else if (cmd == ID_TRAY_EXIT) {
                     TrayIcon_Remove();
                     PostQuitMessage(0);
@@ -2155,6 +2299,145 @@ static RECT CalculateAspectRect(RECT monBounds, int aspectW, int aspectH) {
     return result;
 }
 
+/* ============================================================================
+ * LIVE REPLAY PREVIEW
+ * ============================================================================
+ * Small topmost window in the corner of the settings window's monitor that
+ * shows what the replay buffer is encoding, from the GPU converter's preview
+ * tap (one frame per GOP, already downscaled and read back). The timer only
+ * copies the newest tap frame when it has changed, so the capture thread
+ * never sees the UI.
+ */
+#define PREVIEW_WINDOW_WIDTH    PREVIEW_TAP_SIZE
+#define PREVIEW_WINDOW_HEIGHT   (PREVIEW_TAP_SIZE * 9 / 16)
+#define PREVIEW_WINDOW_MARGIN   16
+
+static BYTE* g_previewPixels = NULL;    /* PREVIEW_TAP_MAX_BYTES while the window exists */
+static int g_previewWidth = 0;          /* 0 = no frame yet */
+static int g_previewHeight = 0;
+static LONG g_previewSequence = 0;
+
+static LRESULT CALLBACK ReplayPreviewWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+        case WM_TIMER:
+            if (wParam == ID_TIMER_PREVIEW && g_previewPixels &&
+                PreviewTap_CopyLatest(g_previewPixels, &g_previewWidth, &g_previewHeight,
+                                      &g_previewSequence)) {
+                InvalidateRect(hwnd, NULL, FALSE);
+            }
+            return 0;
+            
+        case WM_NCHITTEST:
+            return HTCAPTION;   // Drag anywhere
+            
+        case WM_ERASEBKGND:
+            return 1;
+            
+        case WM_PAINT: {
+            PAINTSTRUCT ps;
+            HDC hdc = BeginPaint(hwnd, &ps);
+            RECT rect;
+            GetClientRect(hwnd, &rect);
+            
+            HBRUSH bgBrush = CreateSolidBrush(RGB(30, 30, 30));
+            FillRect(hdc, &rect, bgBrush);
+            DeleteObject(bgBrush);
+            
+            if (g_previewPixels && g_previewWidth > 0 && g_previewHeight > 0) {
+                // Letterbox the frame into the window
+                int clientW = rect.right - rect.left;
+                int clientH = rect.bottom - rect.top;
+                int drawW = clientW;
+                int drawH = (int)((LONGLONG)clientW * g_previewHeight / g_previewWidth);
+                if (drawH > clientH) {
+                    drawH = clientH;
+                    drawW = (int)((LONGLONG)clientH * g_previewWidth / g_previewHeight);
+                }
+                
+                BITMAPINFO bmi = {0};
+                bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+                bmi.bmiHeader.biWidth = g_previewWidth;
+                bmi.bmiHeader.biHeight = -g_previewHeight;  // Top-down
+                bmi.bmiHeader.biPlanes = 1;
+                bmi.bmiHeader.biBitCount = 32;
+                bmi.bmiHeader.biCompression = BI_RGB;
+                
+                SetStretchBltMode(hdc, HALFTONE);
+                SetBrushOrgEx(hdc, 0, 0, NULL);
+                StretchDIBits(hdc, (clientW - drawW) / 2, (clientH - drawH) / 2, drawW, drawH,
+                              0, 0, g_previewWidth, g_previewHeight,
+                              g_previewPixels, &bmi, DIB_RGB_COLORS, SRCCOPY);
+            } else {
+                SetBkMode(hdc, TRANSPARENT);
+                SetTextColor(hdc, RGB(160, 160, 160));
+                DrawTextA(hdc, "Waiting for replay buffer...", -1, &rect,
+                          DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+            }
+            
+            EndPaint(hwnd, &ps);
+            return 0;
+        }
+    }
+    
+    return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// Show the live preview while the replay buffer runs (no-op if already shown)
+static void ShowReplayLivePreview(void) {
+    if (!g_config.replayEnabled || !ReplayBuffer_IsActive(&g_replayBuffer)) {
+        HideReplayPreview();
+        return;
+    }
+    if (g_windows.previewWnd) return;
+    
+    g_previewPixels = (BYTE*)malloc(PREVIEW_TAP_MAX_BYTES);
+    if (!g_previewPixels) return;
+    g_previewWidth = 0;
+    g_previewHeight = 0;
+    g_previewSequence = 0;
+    
+    // Bottom-right of the work area the settings window is on
+    HMONITOR hMon = g_windows.settingsWnd
+        ? MonitorFromWindow(g_windows.settingsWnd, MONITOR_DEFAULTTOPRIMARY)
+        : MonitorFromPoint((POINT){0, 0}, MONITOR_DEFAULTTOPRIMARY);
+    MONITORINFO mi = { sizeof(mi) };
+    GetMonitorInfo(hMon, &mi);
+    RECT frame = { 0, 0, PREVIEW_WINDOW_WIDTH, PREVIEW_WINDOW_HEIGHT };
+    AdjustWindowRectEx(&frame, WS_POPUP | WS_BORDER, FALSE, WS_EX_TOPMOST | WS_EX_TOOLWINDOW);
+    int winW = frame.right - frame.left;
+    int winH = frame.bottom - frame.top;
+    
+    g_windows.previewWnd = CreateWindowExA(
+        WS_EX_TOPMOST | WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE,
+        "LWSRReplayPreview", "Replay preview",
+        WS_POPUP | WS_BORDER,
+        mi.rcWork.right - winW - PREVIEW_WINDOW_MARGIN,
+        mi.rcWork.bottom - winH - PREVIEW_WINDOW_MARGIN,
+        winW, winH,
+        NULL, NULL, g_windows.hInstance, NULL);
+    if (!g_windows.previewWnd) {
+        Logger_Log("Replay preview window creation failed (GetLastError=%lu)\n", GetLastError());
+        free(g_previewPixels);
+        g_previewPixels = NULL;
+        return;
+    }
+    
+    SetTimer(g_windows.previewWnd, ID_TIMER_PREVIEW, PREVIEW_WINDOW_REFRESH_MS, NULL);
+    ShowWindow(g_windows.previewWnd, SW_SHOWNOACTIVATE);
+}
+
+void HideReplayPreview(void) {
+    if (g_windows.previewWnd) {
+        KillTimer(g_windows.previewWnd, ID_TIMER_PREVIEW);
+        DestroyWindow(g_windows.previewWnd);
+        g_windows.previewWnd = NULL;
+    }
+    free(g_previewPixels);
+    g_previewPixels = NULL;
+    g_previewWidth = 0;
+    g_previewHeight = 0;
+}
+
 // Update preview border based on current replay capture source
 void UpdateReplayPreview(void) {
     // Hide any existing overlay first
@@ -2222,12 +2505,15 @@ void UpdateReplayPreview(void) {
             break;
         }
         case MODE_WINDOW:
-            // No preview for window mode - user selects window separately
+            // No border for window mode - user selects window separately
             break;
         default:
             break;
     }
     
+    // What the running replay buffer actually encodes, whatever the source
+    ShowReplayLivePreview();
+    
     // Ensure settings window and control panel stay on top of the preview overlays
     if (g_windows.settingsWnd) {
         SetWindowPos(g_windows.settingsWnd, HWND_TOPMOST, 0, 0, 0, 0, 
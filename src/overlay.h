@@ -18,9 +18,13 @@ void Overlay_Destroy(void);
 // Used by settings dialog for replay preview
 void GetAspectRatioDimensions(int aspectIndex, int* ratioW, int* ratioH);
 
-// Update the replay capture source preview overlay
+// Update the replay capture source preview overlay, plus the live preview
+// window of what the running replay buffer encodes (preview_tap.c)
 void UpdateReplayPreview(void);
 
+// Close the live preview window (settings closed)
+void HideReplayPreview(void);
+
 // Save the current area selector position to config
 void SaveAreaSelectorPosition(void);
 
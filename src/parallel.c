@@ -0,0 +1,92 @@
+/*
+ * parallel.c - Fork-join helper on the process thread pool
+ *
+ * One TP_WORK per Parallel_For, submitted once per helper thread wanted.
+ * Each callback (and the caller) pulls indices from job.next until they
+ * run out; WaitForThreadpoolWorkCallbacks is the join. Once the caller
+ * finds the list empty every item has been claimed, so callbacks the pool
+ * has not started yet are cancelled instead of waited for.
+ *
+ * ERROR HANDLING PATTERN:
+ * - No failure path: if the work object cannot be created, items run inline
+ */
+
+#include "parallel.h"
+#include "logger.h"
+#include "constants.h"
+
+// Alias for logging
+#define ParallelLog Logger_Log
+
+typedef struct {
+    ParallelBody body;
+    void* context;
+    LONG count;
+    volatile LONG next;
+} ParallelJob;
+
+static void RunItems(ParallelJob* job) {
+    for (;;) {
+        LONG i = InterlockedIncrement(&job->next) - 1;
+        if (i >= job->count) return;
+        job->body(job->context, (int)i);
+    }
+}
+
+static VOID CALLBACK WorkCallback(PTP_CALLBACK_INSTANCE instance, PVOID param, PTP_WORK work) {
+    (void)instance;
+    (void)work;
+    RunItems((ParallelJob*)param);
+}
+
+int Parallel_WorkerCount(void) {
+    static volatile LONG cached = 0;
+    LONG n = InterlockedCompareExchange(&cached, 0, 0);
+    if (n == 0) {
+        DWORD_PTR processMask = 0, systemMask = 0;
+        if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+            for (; processMask; processMask &= processMask - 1) n++;
+        }
+        if (n <= 0) {
+            SYSTEM_INFO si;
+            GetSystemInfo(&si);
+            n = (LONG)si.dwNumberOfProcessors;
+        }
+        if (n <= 0) n = 1;
+        InterlockedExchange(&cached, n);
+    }
+    return (int)n;
+}
+
+void Parallel_For(int count, ParallelBody body, void* context) {
+    Parallel_ForLimited(count, 0, body, context);
+}
+
+void Parallel_ForLimited(int count, int maxThreads, ParallelBody body, void* context) {
+    LWSR_ASSERT(body != NULL);
+
+    if (!body || count <= 0) return;
+
+    ParallelJob job;
+    job.body = body;
+    job.context = context;
+    job.count = count;
+    job.next = 0;
+
+    int threads = min(count, Parallel_WorkerCount());
+    if (maxThreads > 0) threads = min(threads, maxThreads);
+    int helpers = threads - 1;
+    PTP_WORK work = NULL;
+    if (helpers > 0) {
+        work = CreateThreadpoolWork(WorkCallback, &job, NULL);
+        if (!work) ParallelLog("Parallel_ForLimited: CreateThreadpoolWork failed (%lu), running inline\n", GetLastError());
+    }
+    for (int i = 0; work && i < helpers; i++) SubmitThreadpoolWork(work);
+
+    RunItems(&job);
+
+    if (work) {
+        WaitForThreadpoolWorkCallbacks(work, TRUE);
+        CloseThreadpoolWork(work);
+    }
+}
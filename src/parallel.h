@@ -0,0 +1,34 @@
+/*
+ * parallel.h - Fork-join helper on the process thread pool
+ *
+ * USED BY: replay_buffer.c (save preparation), mp4_writer.c (track planning),
+ *          kill_feed_sampler.c (template x scale scans)
+ *
+ * For short CPU-bound fan-outs on a thread that would otherwise do them
+ * one after another: per-track audio copies, per-slice NAL scans. Items
+ * are handed out from a shared counter, so uneven items balance on their
+ * own; the calling thread runs items too and returns when all are done.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <windows.h>
+
+typedef void (*ParallelBody)(void* context, int index);
+
+// Run body(context, i) for every i in [0, count), on up to one thread per
+// logical processor (the caller included). Returns when all have returned.
+// Bodies must not wait on each other. Runs inline if the pool is
+// unavailable or count is 1.
+void Parallel_For(int count, ParallelBody body, void* context);
+
+// Parallel_For on at most maxThreads threads (the caller included), for
+// fan-outs that should leave cores to the game. maxThreads <= 0 means no
+// limit beyond Parallel_WorkerCount.
+void Parallel_ForLimited(int count, int maxThreads, ParallelBody body, void* context);
+
+// Logical processors available to the process (at least 1)
+int Parallel_WorkerCount(void);
+
+#endif // PARALLEL_H
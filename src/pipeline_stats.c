@@ -0,0 +1,177 @@
+/*
+ * pipeline_stats.c - Lock-free per-stage latency histograms
+ *
+ * Each stage owns LATENCY_HISTOGRAM_BUCKETS counters plus a running sum and
+ * max, all updated with Interlocked* so recording never blocks the capture
+ * or retrieval thread. Dump takes an unsynchronised snapshot: a sample
+ * landing mid-dump may be counted in one field and not another, which is
+ * harmless for diagnostics.
+ *
+ * Percentiles are reported as bucket upper bounds ("p99<4.10ms"), i.e. the
+ * resolution is a factor of two. That is enough to tell a 1 ms stage from
+ * a 16 ms one.
+ */
+
+#include "pipeline_stats.h"
+#include "constants.h"
+#include "logger.h"
+#include "debug_console.h"
+#include <stdio.h>
+
+typedef struct {
+    volatile LONG buckets[LATENCY_HISTOGRAM_BUCKETS];
+    volatile LONG64 totalUs;
+    volatile LONG maxUs;
+} LatencyHistogram;
+
+static LatencyHistogram g_stageHistograms[PIPELINE_STAGE_COUNT];
+static LONGLONG g_qpcFreq = 0;  // Cached; QPC frequency is fixed at boot
+
+static const char* const g_stageNames[PIPELINE_STAGE_COUNT] = {
+    "capture", "convert", "submit", "bs_lock", "buf_add"
+};
+
+static int BucketForUs(LONGLONG us) {
+    LONGLONG bound = LATENCY_HISTOGRAM_MIN_US;
+    int i = 0;
+    while (i < LATENCY_HISTOGRAM_BUCKETS - 1 && us >= bound) {
+        bound <<= 1;
+        i++;
+    }
+    return i;
+}
+
+// Upper bound of bucket i in milliseconds (last bucket is open-ended)
+static double BucketBoundMs(int i) {
+    return (double)((LONGLONG)LATENCY_HISTOGRAM_MIN_US << i) / 1000.0;
+}
+
+void PipelineStats_Reset(void) {
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    g_qpcFreq = freq.QuadPart;
+
+    for (int s = 0; s < PIPELINE_STAGE_COUNT; s++) {
+        LatencyHistogram* h = &g_stageHistograms[s];
+        for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+            InterlockedExchange(&h->buckets[i], 0);
+        }
+        InterlockedExchange64(&h->totalUs, 0);
+        InterlockedExchange(&h->maxUs, 0);
+    }
+}
+
+void PipelineStats_Record(PipelineStage stage, LARGE_INTEGER start, LARGE_INTEGER end) {
+    if (stage < 0 || stage >= PIPELINE_STAGE_COUNT || g_qpcFreq <= 0) return;
+
+    LONGLONG ticks = end.QuadPart - start.QuadPart;
+    if (ticks < 0) ticks = 0;
+    // Split to avoid ticks * 1e6 overflowing on a stalled stage
+    LONGLONG us = (ticks / g_qpcFreq) * 1000000 + (ticks % g_qpcFreq) * 1000000 / g_qpcFreq;
+
+    LatencyHistogram* h = &g_stageHistograms[stage];
+    InterlockedIncrement(&h->buckets[BucketForUs(us)]);
+    InterlockedAdd64(&h->totalUs, us);
+
+    LONG sample = (us > MAXLONG) ? MAXLONG : (LONG)us;
+    LONG prev = h->maxUs;
+    while (sample > prev) {
+        LONG seen = InterlockedCompareExchange(&h->maxUs, sample, prev);
+        if (seen == prev) break;
+        prev = seen;
+    }
+}
+
+// Upper bound (ms) of the bucket holding the pct-th percentile sample
+static double PercentileMs(const LONG* counts, LONG total, double pct, double maxMs) {
+    LONG target = (LONG)(pct * (double)total);
+    if (target < 1) target = 1;
+    LONG cumulative = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS - 1; i++) {
+        cumulative += counts[i];
+        if (cumulative >= target) {
+            double bound = BucketBoundMs(i);
+            return bound < maxMs ? bound : maxMs;
+        }
+    }
+    return maxMs;
+}
+
+// Snapshot one histogram's buckets; returns the sample count
+static LONG SnapshotBuckets(const LatencyHistogram* h, LONG* counts) {
+    LONG total = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        counts[i] = h->buckets[i];
+        total += counts[i];
+    }
+    return total;
+}
+
+static void SummariseStage(const LatencyHistogram* h, const LONG* counts, LONG total,
+                           PipelineStageStats* stats) {
+    stats->count = total;
+    stats->meanMs = (double)h->totalUs / (double)total / 1000.0;
+    stats->maxMs = (double)h->maxUs / 1000.0;
+    stats->p50Ms = PercentileMs(counts, total, 0.50, stats->maxMs);
+    stats->p90Ms = PercentileMs(counts, total, 0.90, stats->maxMs);
+    stats->p99Ms = PercentileMs(counts, total, 0.99, stats->maxMs);
+}
+
+BOOL PipelineStats_GetStage(PipelineStage stage, PipelineStageStats* stats) {
+    if (!stats) return FALSE;
+    ZeroMemory(stats, sizeof(*stats));
+    if (stage < 0 || stage >= PIPELINE_STAGE_COUNT) return FALSE;
+
+    LONG counts[LATENCY_HISTOGRAM_BUCKETS];
+    LONG total = SnapshotBuckets(&g_stageHistograms[stage], counts);
+    if (total == 0) return FALSE;
+    SummariseStage(&g_stageHistograms[stage], counts, total, stats);
+    return TRUE;
+}
+
+const char* PipelineStats_StageName(PipelineStage stage) {
+    if (stage < 0 || stage >= PIPELINE_STAGE_COUNT) return "?";
+    return g_stageNames[stage];
+}
+
+void PipelineStats_Dump(const char* reason, BOOL toLog) {
+    BOOL toConsole = DebugConsole_IsOpen();
+    if (!toLog && !toConsole) return;
+
+    if (toLog) Logger_Log("Pipeline latency (%s):\n", reason ? reason : "");
+    if (toConsole) DebugConsole_Print("PIPELINE LATENCY (%s):\n", reason ? reason : "");
+
+    for (int s = 0; s < PIPELINE_STAGE_COUNT; s++) {
+        LatencyHistogram* h = &g_stageHistograms[s];
+        LONG counts[LATENCY_HISTOGRAM_BUCKETS];
+        LONG total = SnapshotBuckets(h, counts);
+        if (total == 0) continue;
+
+        PipelineStageStats st;
+        SummariseStage(h, counts, total, &st);
+
+        // Non-empty buckets as "<bound:count", open-ended one as ">=bound:count"
+        char bucketText[384];
+        int len = 0;
+        bucketText[0] = '\0';
+        for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS && len < (int)sizeof(bucketText); i++) {
+            if (counts[i] == 0) continue;
+            int n = (i < LATENCY_HISTOGRAM_BUCKETS - 1)
+                ? _snprintf_s(bucketText + len, sizeof(bucketText) - len, _TRUNCATE,
+                              " <%.2f:%ld", BucketBoundMs(i), counts[i])
+                : _snprintf_s(bucketText + len, sizeof(bucketText) - len, _TRUNCATE,
+                              " >=%.2f:%ld", BucketBoundMs(i - 1), counts[i]);
+            if (n < 0) break;
+            len += n;
+        }
+
+        if (toLog) {
+            Logger_Log("  %-8s n=%ld avg=%.2fms p50<%.2f p90<%.2f p99<%.2f max=%.2fms |%s\n",
+                       g_stageNames[s], total, st.meanMs, st.p50Ms, st.p90Ms, st.p99Ms, st.maxMs, bucketText);
+        }
+        if (toConsole) {
+            DebugConsole_Print("  %-8s n=%ld avg=%.2fms p50<%.2f p90<%.2f p99<%.2f max=%.2fms |%s\n",
+                               g_stageNames[s], total, st.meanMs, st.p50Ms, st.p90Ms, st.p99Ms, st.maxMs, bucketText);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * pipeline_stats.h - Per-stage pipeline latency histograms
+ *
+ * SHARED BY: replay_buffer.c, recording.c, nvenc_encoder.c, soak_bench.c
+ *
+ * Fixed-bucket histograms (see LATENCY_HISTOGRAM_* in constants.h) for each
+ * stage a captured frame passes through. Recording is lock-free: one
+ * InterlockedIncrement per sample plus a CAS for the running max, so it is
+ * safe from the capture thread and the NVENC retrieval thread at once.
+ *
+ * Only one capture loop runs at a time (replay and recording are mutually
+ * exclusive), so a single process-wide set of histograms is enough. The
+ * owning loop calls PipelineStats_Reset when it starts.
+ */
+
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <windows.h>
+
+typedef enum {
+    PIPELINE_STAGE_CAPTURE = 0,     // Capture_GetFrameTexture
+    PIPELINE_STAGE_CONVERT,         // GPUConverter_Convert
+    PIPELINE_STAGE_SUBMIT,          // NVENCEncoder_SubmitTexture / SubmitRepeat
+    PIPELINE_STAGE_BITSTREAM_LOCK,  // nvEncLockBitstream through unlock
+    PIPELINE_STAGE_BUFFER_ADD,      // FrameBuffer_Add (replay only)
+    PIPELINE_STAGE_COUNT
+} PipelineStage;
+
+// One stage's histogram, summarised. Percentiles are bucket upper bounds
+// capped at the max, as in PipelineStats_Dump.
+typedef struct {
+    LONG count;
+    double meanMs;
+    double p50Ms, p90Ms, p99Ms;
+    double maxMs;
+} PipelineStageStats;
+
+// Clear every histogram. Call from the owning loop before it starts.
+void PipelineStats_Reset(void);
+
+// Record one sample of `stage` spanning two QueryPerformanceCounter readings.
+// Lock-free; callable from any thread.
+void PipelineStats_Record(PipelineStage stage, LARGE_INTEGER start, LARGE_INTEGER end);
+
+// Print count, mean, p50/p90/p99/max and the bucket counts of every stage
+// that has samples. toLog = TRUE also writes to the log file; the debug
+// console gets it whenever it is open.
+void PipelineStats_Dump(const char* reason, BOOL toLog);
+
+// Summarise one stage. Returns FALSE (stats zeroed) if it has no samples.
+BOOL PipelineStats_GetStage(PipelineStage stage, PipelineStageStats* stats);
+
+// Short stage name as used in the dump ("capture", "bs_lock", ...)
+const char* PipelineStats_StageName(PipelineStage stage);
+
+#endif // PIPELINE_STATS_H
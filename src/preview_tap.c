@@ -0,0 +1,413 @@
+/*
+ * preview_tap.c - Live preview and clip thumbnails from the replay pipeline
+ *
+ * USES: gpu_converter.c (via replay_buffer.c), WIC (JPEG encoding)
+ *
+ * One process-wide tap: the replay pipeline is the only producer, and it
+ * runs once at a time. Start/Stop bracket a pipeline run on the buffer
+ * thread; the lock guards the buffers against the UI and the save worker.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Goto-cleanup in EncodeJpeg (stream, encoder, frame, pixel copy)
+ * - A thumbnail that fails to encode is left out; the clip is saved anyway
+ */
+
+#include "preview_tap.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include <wincodec.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Alias for logging */
+#define TapLog Logger_Log
+
+/* WIC GUIDs, local so the build needs no windowscodecs.lib */
+static const GUID CLSID_WICImagingFactory_Local =
+    { 0xcacaf262, 0x9370, 0x4615, { 0xa1, 0x3b, 0x9f, 0x55, 0x39, 0xda, 0x4c, 0x0a } };
+static const GUID IID_IWICImagingFactory_Local =
+    { 0xec5ec8a9, 0xc395, 0x4314, { 0x9c, 0x77, 0x54, 0xd7, 0xa9, 0x35, 0xff, 0x70 } };
+static const GUID GUID_ContainerFormatJpeg_Local =
+    { 0x19e4a5aa, 0x5662, 0x4fc5, { 0xa0, 0xc0, 0x17, 0x58, 0x02, 0x8e, 0x10, 0x57 } };
+static const GUID GUID_WICPixelFormat24bppBGR_Local =
+    { 0x6fddc324, 0x4e03, 0x4bfe, { 0xb1, 0x85, 0x3d, 0x77, 0x76, 0x8d, 0xc9, 0x0c } };
+
+static struct {
+    SRWLOCK lock;
+    BOOL running;
+    LONGLONG gopDuration;
+
+    /* Newest preview, PREVIEW_TAP_MAX_BYTES */
+    BYTE* latest;
+    int width;
+    int height;
+    LONGLONG latestTs;
+    LONG sequence;              /* Publish count; 0 = nothing yet */
+
+    /* Thumbnail ring, oldest at (head - count) */
+    BYTE* thumbs;
+    LONGLONG* thumbTimes;
+    int thumbWidth;
+    int thumbHeight;
+    size_t thumbBytes;
+    int capacity;
+    int head;
+    int count;
+    int stride;                 /* Keep every stride-th preview */
+    int strideCountdown;
+} g_tap = { SRWLOCK_INIT };
+
+BOOL PreviewTap_Start(int width, int height, LONGLONG gopDuration, int bufferSeconds) {
+    LWSR_ASSERT(width > 0 && width <= PREVIEW_TAP_SIZE);
+    LWSR_ASSERT(height > 0 && height <= PREVIEW_TAP_SIZE);
+
+    PreviewTap_Stop();
+    if (width <= 0 || height <= 0 || width > PREVIEW_TAP_SIZE || height > PREVIEW_TAP_SIZE) return FALSE;
+    if (gopDuration <= 0) gopDuration = MF_UNITS_PER_SECOND / 2;
+
+    /* Enough slots for one thumbnail per GOP of the buffer, or every
+     * stride-th GOP when that would overflow the ring */
+    LONGLONG gops = (LONGLONG)bufferSeconds * MF_UNITS_PER_SECOND / gopDuration + 1;
+    int stride = (int)((gops + PREVIEW_THUMB_RING - 1) / PREVIEW_THUMB_RING);
+    if (stride < 1) stride = 1;
+    LONGLONG slots = gops / stride + 2;
+    int capacity = slots < PREVIEW_THUMB_RING ? (int)slots : PREVIEW_THUMB_RING;
+
+    int thumbWidth = width / 2 > 0 ? width / 2 : 1;
+    int thumbHeight = height / 2 > 0 ? height / 2 : 1;
+    size_t thumbBytes = (size_t)thumbWidth * thumbHeight * 4;
+
+    BYTE* latest = (BYTE*)malloc(PREVIEW_TAP_MAX_BYTES);
+    BYTE* thumbs = (BYTE*)malloc(thumbBytes * capacity);
+    LONGLONG* thumbTimes = (LONGLONG*)calloc((size_t)capacity, sizeof(LONGLONG));
+    if (!latest || !thumbs || !thumbTimes) {
+        TapLog("PreviewTap: allocation failed (%d thumbnails)\n", capacity);
+        SAFE_FREE(latest);
+        SAFE_FREE(thumbs);
+        SAFE_FREE(thumbTimes);
+        return FALSE;
+    }
+
+    AcquireSRWLockExclusive(&g_tap.lock);
+    g_tap.latest = latest;
+    g_tap.width = width;
+    g_tap.height = height;
+    g_tap.latestTs = 0;
+    g_tap.sequence = 0;
+    g_tap.thumbs = thumbs;
+    g_tap.thumbTimes = thumbTimes;
+    g_tap.thumbWidth = thumbWidth;
+    g_tap.thumbHeight = thumbHeight;
+    g_tap.thumbBytes = thumbBytes;
+    g_tap.capacity = capacity;
+    g_tap.head = 0;
+    g_tap.count = 0;
+    g_tap.stride = stride;
+    g_tap.strideCountdown = 0;
+    g_tap.gopDuration = gopDuration;
+    g_tap.running = TRUE;
+    ReleaseSRWLockExclusive(&g_tap.lock);
+
+    TapLog("PreviewTap: %dx%d preview, %d x %dx%d thumbnails (every %d GOPs)\n",
+           width, height, capacity, thumbWidth, thumbHeight, stride);
+    return TRUE;
+}
+
+void PreviewTap_Stop(void) {
+    AcquireSRWLockExclusive(&g_tap.lock);
+    g_tap.running = FALSE;
+    SAFE_FREE(g_tap.latest);
+    SAFE_FREE(g_tap.thumbs);
+    SAFE_FREE(g_tap.thumbTimes);
+    g_tap.count = 0;
+    g_tap.capacity = 0;
+    ReleaseSRWLockExclusive(&g_tap.lock);
+}
+
+/* 2x2 box filter; src has at least 2 * dstHeight rows of 2 * dstWidth pixels */
+static void Downscale2x(const BYTE* src, int srcPitch, BYTE* dst, int dstWidth, int dstHeight) {
+    for (int y = 0; y < dstHeight; y++) {
+        const BYTE* r0 = src + (size_t)(2 * y) * srcPitch;
+        const BYTE* r1 = r0 + srcPitch;
+        BYTE* d = dst + (size_t)y * dstWidth * 4;
+        for (int x = 0; x < dstWidth; x++) {
+            const BYTE* a = r0 + 8 * x;
+            const BYTE* b = r1 + 8 * x;
+            for (int c = 0; c < 4; c++) {
+                d[4 * x + c] = (BYTE)((a[c] + a[4 + c] + b[c] + b[4 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+void PreviewTap_Publish(const BYTE* bgra, int rowPitch, int width, int height,
+                        LONGLONG timestamp, void* userData) {
+    (void)userData;
+
+    /* A reader holds the lock: drop this frame rather than wait */
+    if (!TryAcquireSRWLockExclusive(&g_tap.lock)) return;
+
+    if (g_tap.running && width == g_tap.width && height == g_tap.height) {
+        size_t rowBytes = (size_t)width * 4;
+        for (int y = 0; y < height; y++) {
+            memcpy(g_tap.latest + y * rowBytes, bgra + (size_t)y * rowPitch, rowBytes);
+        }
+        g_tap.latestTs = timestamp;
+        g_tap.sequence++;
+
+        if (g_tap.strideCountdown > 0) {
+            g_tap.strideCountdown--;
+        } else {
+            Downscale2x(bgra, rowPitch, g_tap.thumbs + (size_t)g_tap.head * g_tap.thumbBytes,
+                        g_tap.thumbWidth, g_tap.thumbHeight);
+            g_tap.thumbTimes[g_tap.head] = timestamp;
+            g_tap.head = (g_tap.head + 1) % g_tap.capacity;
+            if (g_tap.count < g_tap.capacity) g_tap.count++;
+            g_tap.strideCountdown = g_tap.stride - 1;
+        }
+    }
+
+    ReleaseSRWLockExclusive(&g_tap.lock);
+}
+
+BOOL PreviewTap_CopyLatest(BYTE* dst, int* width, int* height, LONG* sequence) {
+    LWSR_ASSERT(dst != NULL && width != NULL && height != NULL && sequence != NULL);
+
+    BOOL copied = FALSE;
+    AcquireSRWLockShared(&g_tap.lock);
+    if (g_tap.running && g_tap.sequence != 0 && g_tap.sequence != *sequence) {
+        memcpy(dst, g_tap.latest, (size_t)g_tap.width * g_tap.height * 4);
+        *width = g_tap.width;
+        *height = g_tap.height;
+        *sequence = g_tap.sequence;
+        copied = TRUE;
+    }
+    ReleaseSRWLockShared(&g_tap.lock);
+    return copied;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: EncodeJpeg
+ * Resources: 5 - BGR copy, HGLOBAL stream, encoder, frame, property bag
+ * Pattern: goto-cleanup; out->data is set only on success
+ */
+static BOOL EncodeJpeg(IWICImagingFactory* factory, const BYTE* bgra, int width, int height,
+                       MuxerImage* out) {
+    BOOL ok = FALSE;
+    BYTE* bgr = NULL;
+    IStream* stream = NULL;
+    IWICBitmapEncoder* encoder = NULL;
+    IWICBitmapFrameEncode* frame = NULL;
+    IPropertyBag2* props = NULL;
+    HGLOBAL memory = NULL;
+    PROPBAG2 option = {0};
+    VARIANT quality;
+    WICPixelFormatGUID format = GUID_WICPixelFormat24bppBGR_Local;
+    LARGE_INTEGER zero = {0};
+    ULARGE_INTEGER end;
+    const void* jpeg;
+    HRESULT hr;
+
+    /* The JPEG encoder takes 24bpp BGR only */
+    UINT stride = ((UINT)width * 3 + 3) & ~3u;
+    bgr = (BYTE*)malloc((size_t)stride * height);
+    if (!bgr) goto cleanup;
+    for (int y = 0; y < height; y++) {
+        const BYTE* s = bgra + (size_t)y * width * 4;
+        BYTE* d = bgr + (size_t)y * stride;
+        for (int x = 0; x < width; x++) {
+            d[3 * x] = s[4 * x];
+            d[3 * x + 1] = s[4 * x + 1];
+            d[3 * x + 2] = s[4 * x + 2];
+        }
+    }
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    if (FAILED(hr)) goto cleanup;
+    hr = factory->lpVtbl->CreateEncoder(factory, &GUID_ContainerFormatJpeg_Local, NULL, &encoder);
+    if (FAILED(hr)) goto cleanup;
+    hr = encoder->lpVtbl->Initialize(encoder, stream, WICBitmapEncoderNoCache);
+    if (FAILED(hr)) goto cleanup;
+    hr = encoder->lpVtbl->CreateNewFrame(encoder, &frame, &props);
+    if (FAILED(hr)) goto cleanup;
+
+    option.pstrName = (LPOLESTR)L"ImageQuality";
+    VariantInit(&quality);
+    quality.vt = VT_R4;
+    quality.fltVal = PREVIEW_JPEG_QUALITY;
+    props->lpVtbl->Write(props, 1, &option, &quality);  /* Default quality if refused */
+
+    hr = frame->lpVtbl->Initialize(frame, props);
+    if (FAILED(hr)) goto cleanup;
+    hr = frame->lpVtbl->SetSize(frame, (UINT)width, (UINT)height);
+    if (FAILED(hr)) goto cleanup;
+    hr = frame->lpVtbl->SetPixelFormat(frame, &format);
+    if (FAILED(hr) || !IsEqualGUID(&format, &GUID_WICPixelFormat24bppBGR_Local)) goto cleanup;
+    hr = frame->lpVtbl->WritePixels(frame, (UINT)height, stride, stride * (UINT)height, bgr);
+    if (FAILED(hr)) goto cleanup;
+    hr = frame->lpVtbl->Commit(frame);
+    if (FAILED(hr)) goto cleanup;
+    hr = encoder->lpVtbl->Commit(encoder);
+    if (FAILED(hr)) goto cleanup;
+
+    hr = stream->lpVtbl->Seek(stream, zero, STREAM_SEEK_CUR, &end);
+    if (FAILED(hr) || end.QuadPart == 0 || end.QuadPart > MAXDWORD) goto cleanup;
+    hr = GetHGlobalFromStream(stream, &memory);
+    if (FAILED(hr)) goto cleanup;
+
+    jpeg = GlobalLock(memory);
+    if (!jpeg) goto cleanup;
+    out->data = (BYTE*)malloc((size_t)end.QuadPart);
+    if (out->data) {
+        memcpy(out->data, jpeg, (size_t)end.QuadPart);
+        out->size = (DWORD)end.QuadPart;
+        ok = TRUE;
+    }
+    GlobalUnlock(memory);
+
+cleanup:
+    SAFE_RELEASE(props);
+    SAFE_RELEASE(frame);
+    SAFE_RELEASE(encoder);
+    SAFE_RELEASE(stream);
+    SAFE_FREE(bgr);
+    return ok;
+}
+
+/* Newest thumbnail at or before ts, else the oldest before limit (and not
+ * before ts); ring position or -1. Caller holds the lock. */
+static int FindThumbnail(LONGLONG ts, LONGLONG limit) {
+    int oldest = (g_tap.head - g_tap.count + g_tap.capacity) % g_tap.capacity;
+    for (int i = g_tap.count - 1; i >= 0; i--) {
+        int pos = (oldest + i) % g_tap.capacity;
+        if (g_tap.thumbTimes[pos] <= ts) return pos;
+    }
+    if (g_tap.count > 0 && g_tap.thumbTimes[oldest] < limit) return oldest;
+    return -1;
+}
+
+BOOL PreviewTap_BuildArtwork(const MuxerSample* videoSamples, int videoCount, LONGLONG originTs,
+                             PreviewArtwork* artwork) {
+    LWSR_ASSERT(artwork != NULL);
+
+    ZeroMemory(artwork, sizeof(*artwork));
+    if (!videoSamples || videoCount <= 0) return FALSE;
+
+    /* Thumbnails carry capture-time stamps; the samples are rebased */
+    LONGLONG firstTs = originTs + videoSamples[0].timestamp;
+    LONGLONG lastTs = originTs + videoSamples[videoCount - 1].timestamp;
+    ULONGLONG startMs = GetTickCount64();
+
+    int keyframes = 0;
+    for (int i = 0; i < videoCount; i++) {
+        if (videoSamples[i].isKeyframe) keyframes++;
+    }
+
+    /* Pick and copy under the lock, encode after releasing it */
+    BYTE* thumbPixels = NULL;
+    LONGLONG* thumbTimes = NULL;
+    int picked = 0;
+    BYTE* posterPixels = NULL;
+    int posterWidth = 0, posterHeight = 0;
+    int thumbWidth = 0, thumbHeight = 0;
+
+    AcquireSRWLockShared(&g_tap.lock);
+    if (g_tap.running && g_tap.count > 0) {
+        thumbWidth = g_tap.thumbWidth;
+        thumbHeight = g_tap.thumbHeight;
+        int maxPicks = keyframes < g_tap.count ? keyframes : g_tap.count;
+        thumbPixels = maxPicks > 0 ? (BYTE*)malloc(g_tap.thumbBytes * maxPicks) : NULL;
+        thumbTimes = maxPicks > 0 ? (LONGLONG*)malloc(sizeof(LONGLONG) * maxPicks) : NULL;
+        if (thumbPixels && thumbTimes) {
+            int lastPos = -1;
+            for (int i = 0; i < videoCount && picked < maxPicks; i++) {
+                if (!videoSamples[i].isKeyframe) continue;
+                int next = i + 1;
+                while (next < videoCount && !videoSamples[next].isKeyframe) next++;
+                LONGLONG gopStart = originTs + videoSamples[i].timestamp;
+                LONGLONG gopEnd = next < videoCount ? originTs + videoSamples[next].timestamp : lastTs + 1;
+                int pos = FindThumbnail(gopStart, gopEnd);
+                if (pos < 0 || pos == lastPos) continue;
+                memcpy(thumbPixels + g_tap.thumbBytes * picked,
+                       g_tap.thumbs + g_tap.thumbBytes * pos, g_tap.thumbBytes);
+                thumbTimes[picked] = gopStart - firstTs;
+                picked++;
+                lastPos = pos;
+            }
+        }
+
+        /* Poster: the newest full-size preview if the clip reaches it */
+        size_t posterBytes;
+        const BYTE* posterSource = NULL;
+        if (g_tap.latestTs >= firstTs && g_tap.latestTs <= lastTs + g_tap.gopDuration) {
+            posterSource = g_tap.latest;
+            posterWidth = g_tap.width;
+            posterHeight = g_tap.height;
+        } else {
+            int pos = FindThumbnail(firstTs + (lastTs - firstTs) / 2, lastTs + 1);
+            if (pos >= 0) {
+                posterSource = g_tap.thumbs + g_tap.thumbBytes * pos;
+                posterWidth = thumbWidth;
+                posterHeight = thumbHeight;
+            }
+        }
+        posterBytes = (size_t)posterWidth * posterHeight * 4;
+        if (posterSource) {
+            posterPixels = (BYTE*)malloc(posterBytes);
+            if (posterPixels) memcpy(posterPixels, posterSource, posterBytes);
+        }
+    }
+    ReleaseSRWLockShared(&g_tap.lock);
+
+    if (picked > 0 || posterPixels) {
+        IWICImagingFactory* factory = NULL;
+        HRESULT hr = CoCreateInstance(&CLSID_WICImagingFactory_Local, NULL, CLSCTX_INPROC_SERVER,
+                                      &IID_IWICImagingFactory_Local, (void**)&factory);
+        if (FAILED(hr)) {
+            TapLog("PreviewTap: WIC unavailable (0x%08X) - clip saved without thumbnails\n", hr);
+        } else {
+            if (posterPixels && EncodeJpeg(factory, posterPixels, posterWidth, posterHeight,
+                                           &artwork->poster)) {
+                artwork->poster.timestamp = 0;
+            }
+            artwork->thumbnails = picked > 0 ? (MuxerImage*)calloc((size_t)picked, sizeof(MuxerImage)) : NULL;
+            if (artwork->thumbnails) {
+                for (int i = 0; i < picked; i++) {
+                    MuxerImage* thumb = &artwork->thumbnails[artwork->thumbnailCount];
+                    if (EncodeJpeg(factory, thumbPixels + (size_t)thumbWidth * thumbHeight * 4 * i,
+                                   thumbWidth, thumbHeight, thumb)) {
+                        thumb->timestamp = thumbTimes[i] > 0 ? thumbTimes[i] : 0;
+                        artwork->thumbnailCount++;
+                    }
+                }
+            }
+            factory->lpVtbl->Release(factory);
+        }
+    }
+
+    SAFE_FREE(thumbPixels);
+    SAFE_FREE(thumbTimes);
+    SAFE_FREE(posterPixels);
+
+    BOOL any = artwork->poster.data || artwork->thumbnailCount > 0;
+    if (any) {
+        TapLog("  Artwork: poster %s, %d thumbnails (%llums)\n",
+               artwork->poster.data ? "yes" : "no", artwork->thumbnailCount,
+               GetTickCount64() - startMs);
+    } else {
+        PreviewTap_FreeArtwork(artwork);
+    }
+    return any;
+}
+
+void PreviewTap_FreeArtwork(PreviewArtwork* artwork) {
+    if (!artwork) return;
+    SAFE_FREE(artwork->poster.data);
+    for (int i = 0; i < artwork->thumbnailCount; i++) {
+        SAFE_FREE(artwork->thumbnails[i].data);
+    }
+    SAFE_FREE(artwork->thumbnails);
+    ZeroMemory(artwork, sizeof(*artwork));
+}
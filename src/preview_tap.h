@@ -0,0 +1,59 @@
+/*
+ * preview_tap.h - Live preview and clip thumbnails from the replay pipeline
+ *
+ * USED BY: replay_buffer.c (producer, batch saves), overlay.c (preview window)
+ *
+ * The buffer thread publishes every frame GPUConverter_PollPreview delivers
+ * (one per GOP, already downscaled on the GPU). The newest is kept whole for
+ * the live preview; a half-size copy goes into a ring of thumbnails stamped
+ * with their frame time. A save then picks one thumbnail per GOP of its clip
+ * plus a poster frame and JPEG-encodes them (WIC) for the native MP4 writer.
+ *
+ * Publishing is a copy and a 2x box filter under a lock that is only ever
+ * tried: if the UI or a save is reading, the frame is dropped (the next one
+ * is a GOP away), so the buffer thread never waits.
+ */
+
+#ifndef PREVIEW_TAP_H
+#define PREVIEW_TAP_H
+
+#include <windows.h>
+#include "mp4_muxer.h"
+
+// Poster and per-GOP thumbnails for one clip (PreviewTap_BuildArtwork)
+typedef struct {
+    MuxerImage poster;          // data NULL = none
+    MuxerImage* thumbnails;
+    int thumbnailCount;
+} PreviewArtwork;
+
+// Size the buffers for width x height previews (long edge at most
+// PREVIEW_TAP_SIZE) arriving every gopDuration (100 ns) from a pipeline
+// buffering bufferSeconds. Drops whatever the previous pipeline left.
+// Buffer thread, before the first Publish.
+BOOL PreviewTap_Start(int width, int height, LONGLONG gopDuration, int bufferSeconds);
+
+// Free everything. Buffer thread, after the save worker has stopped.
+void PreviewTap_Stop(void);
+
+// GPUConverterPreviewFn: publish one preview frame. Buffer thread.
+void PreviewTap_Publish(const BYTE* bgra, int rowPitch, int width, int height,
+                        LONGLONG timestamp, void* userData);
+
+// Copy the newest preview (top-down BGRA, width * 4 per row) into dst,
+// which holds PREVIEW_TAP_MAX_BYTES, if it is newer than *sequence; updates
+// *sequence. FALSE if there is nothing new or the tap is stopped. Any thread.
+BOOL PreviewTap_CopyLatest(BYTE* dst, int* width, int* height, LONG* sequence);
+
+// Poster and one thumbnail per GOP for videoSamples (the clip being saved;
+// keyframes mark the GOPs), timed from its first sample. The samples are
+// relative to originTs (the snapshot's originTimestamp). The poster is the
+// newest preview if the clip reaches it, else the thumbnail nearest the
+// clip's middle. Needs COM on the calling thread. FALSE, with artwork empty,
+// if the tap holds nothing for the clip. Save worker.
+BOOL PreviewTap_BuildArtwork(const MuxerSample* videoSamples, int videoCount, LONGLONG originTs,
+                             PreviewArtwork* artwork);
+
+void PreviewTap_FreeArtwork(PreviewArtwork* artwork);
+
+#endif // PREVIEW_TAP_H
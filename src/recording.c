@@ -1,24 +1,29 @@
 /*
  * recording.c - Direct-to-disk NVENC recording (thread, start/stop, state machine)
  *
- * USES: nvenc_encoder.c, gpu_converter.c, mp4_muxer.c (streaming)
+ * USES: nvenc_encoder.c, gpu_converter.c, mux_queue.c, mp4_muxer.c (streaming)
  *
  * Direct-to-disk recording using NVENC hardware encoding.
  * Writes frames to MP4 as they arrive (no buffering like replay).
- * Pipeline: DXGI capture → GPU color convert → NVENC → StreamingMuxer
+ * Pipeline: DXGI capture → GPU color convert → NVENC → MuxQueue → StreamingMuxer
+ * The encoder callback only queues; MuxQueue's writer thread does the
+ * muxer writes, so a slow disk never stalls capture or encode.
  *
  * Symmetric architecture with replay_buffer.c - both use same encoding modules.
+ * Shared mode (Recording_StartShared): no thread of its own; frames arrive
+ * through the replay buffer's stream tap and go into the same queue.
  */
 
 #include <windows.h>
-#include <mmsystem.h>  // For timeBeginPeriod/timeEndPeriod
 #include "recording.h"
 #include "replay_buffer.h"
+#include "frame_scheduler.h"
+#include "pipeline_stats.h"
+#include "trace.h"
 #include "mem_utils.h"
+#include "leak_tracker.h"
 #include "logger.h"
 
-#pragma comment(lib, "winmm.lib")
-
 /* Alias for logging */
 #define RecLog Logger_Log
 
@@ -28,14 +33,20 @@ extern ReplayBufferState g_replayBuffer;
 
 /* Context passed to NVENC callback */
 typedef struct {
-    StreamingMuxer* muxer;
-    volatile LONG* framesEncoded;
+    MuxQueue* queue;
+    volatile LONG* framesEncoded;   // Frames queued for the muxer
     LONGLONG frameDuration;  // 100-ns units
+    
+    // Shared mode only (touched by the tap callback alone after attach)
+    volatile LONG* framesCaptured;
+    BOOL waitingForKeyframe; // Drop frames until the stream's next IDR
+    LONGLONG baseTimestamp;  // Replay PTS of that IDR; file starts at 0
 } RecordingEncoderContext;
 
 /* Forward declarations */
 static DWORD WINAPI RecordingThread(LPVOID param);
 static void EncoderCallback(EncodedFrame* frame, void* userData);
+static void SharedStreamCallback(EncodedFrame* frame, void* userData);
 
 /*
  * Module-level singleton: encoder context for the in-flight recording.
@@ -50,6 +61,25 @@ static void EncoderCallback(EncodedFrame* frame, void* userData);
  */
 static RecordingEncoderContext g_encoderCtx = {0};
 
+/* Stop the queue's writer (drains it), then finalize or abort the muxer.
+ * Returns the muxer's finalize result. */
+static BOOL CloseOutput(RecordingState* state, BOOL finalize) {
+    BOOL muxOk = FALSE;
+    if (state->muxQueue) {
+        MuxQueue_Close(state->muxQueue);
+        state->muxQueue = NULL;
+    }
+    if (state->muxer) {
+        if (finalize) {
+            muxOk = StreamingMuxer_Close(state->muxer);
+        } else {
+            StreamingMuxer_Abort(state->muxer);
+        }
+        state->muxer = NULL;
+    }
+    return muxOk;
+}
+
 void Recording_Init(RecordingState* state) {
     if (!state) return;
     ZeroMemory(state, sizeof(RecordingState));
@@ -73,8 +103,9 @@ BOOL Recording_Start(RecordingState* state, CaptureState* capture,
         return FALSE;
     }
 
-    /* Critical rule: never start recording while replay buffer is running
-     * (shared NVENC singleton causes deadlock). */
+    /* Critical rule: never start a second pipeline while replay buffer is
+     * running (shared NVENC singleton causes deadlock); use
+     * Recording_StartShared to record its stream instead. */
     if (ReplayBuffer_IsActive(&g_replayBuffer)) {
         RecLog("Recording_Start: Replay buffer is active - refusing to start (deadlock guard)\n");
         return FALSE;
@@ -122,7 +153,8 @@ BOOL Recording_Start(RecordingState* state, CaptureState* capture,
            state->width, state->height, state->fps);
 
     // Initialize GPU color converter (BGRA → NV12)
-    if (!GPUConverter_Init(&state->gpuConverter, capture->device, state->width, state->height)) {
+    if (!GPUConverter_Init(&state->gpuConverter, capture->device, state->width, state->height,
+                           NV12_TEXTURE_RING_DEPTH)) {
         RecLog("Recording_Start: GPUConverter_Init failed\n");
         goto cleanup;
     }
@@ -131,20 +163,24 @@ BOOL Recording_Start(RecordingState* state, CaptureState* capture,
 
     // Initialize NVENC encoder
     state->encoder = NVENCEncoder_Create(capture->device, state->width, state->height,
-                                          state->fps, config->quality);
+                                          state->fps, config->quality, config->codec,
+                                          config->asyncEncode);
     if (!state->encoder) {
         RecLog("Recording_Start: NVENCEncoder_Create failed - NVIDIA GPU required\n");
         goto cleanup;
     }
-    RecLog("Recording_Start: NVENC HEVC encoder initialized\n");
+    RecLog("Recording_Start: NVENC %s encoder initialized (%s input)\n",
+           NVENCEncoder_GetCodec(state->encoder) == CODEC_AV1 ? "AV1" : "HEVC",
+           NVENCEncoder_IsZeroCopy(state->encoder) ? "D3D11 zero-copy" : "CUDA readback");
+    NVENCEncoder_SetInputRingDepth(state->encoder, state->gpuConverter.slotCount);
 
-    // Get sequence header (VPS/SPS/PPS for HEVC)
+    // Get sequence header (VPS/SPS/PPS for HEVC, sequence header OBU for AV1)
     if (!NVENCEncoder_GetSequenceHeader(state->encoder, state->seqHeader,
                                          sizeof(state->seqHeader), &state->seqHeaderSize)) {
         RecLog("Recording_Start: WARNING - Failed to get sequence header\n");
         state->seqHeaderSize = 0;
     } else {
-        RecLog("Recording_Start: HEVC sequence header extracted (%u bytes)\n", state->seqHeaderSize);
+        RecLog("Recording_Start: Sequence header extracted (%u bytes)\n", state->seqHeaderSize);
     }
 
     // Configure muxer (video only for now)
@@ -154,7 +190,9 @@ BOOL Recording_Start(RecordingState* state, CaptureState* capture,
         .fps = state->fps,
         .quality = config->quality,
         .seqHeader = state->seqHeader,
-        .seqHeaderSize = state->seqHeaderSize
+        .seqHeaderSize = state->seqHeaderSize,
+        .codec = NVENCEncoder_GetCodec(state->encoder),
+        .fragmented = config->fragmentedRecording
     };
 
     // Create streaming muxer (video only)
@@ -163,11 +201,16 @@ BOOL Recording_Start(RecordingState* state, CaptureState* capture,
         RecLog("Recording_Start: StreamingMuxer_Create failed\n");
         goto cleanup;
     }
+    state->muxQueue = MuxQueue_Create(state->muxer, state->fps * RECORDING_MUX_QUEUE_SECONDS);
+    if (!state->muxQueue) {
+        RecLog("Recording_Start: MuxQueue_Create failed\n");
+        goto cleanup;
+    }
     RecLog("Recording_Start: Streaming muxer ready\n");
 
     // Set up encoder callback context
     LONGLONG frameDuration = MF_UNITS_PER_SECOND / state->fps;
-    g_encoderCtx.muxer = state->muxer;
+    g_encoderCtx.queue = state->muxQueue;
     g_encoderCtx.framesEncoded = &state->framesEncoded;
     g_encoderCtx.frameDuration = frameDuration;
 
@@ -191,8 +234,6 @@ BOOL Recording_Start(RecordingState* state, CaptureState* capture,
     state->thread = CreateThread(NULL, 0, RecordingThread, state, 0, NULL);
     if (!state->thread) {
         RecLog("Recording_Start: CreateThread failed (error=%lu)\n", GetLastError());
-        StreamingMuxer_Abort(state->muxer);
-        state->muxer = NULL;
         goto cleanup;
     }
 
@@ -203,10 +244,7 @@ BOOL Recording_Start(RecordingState* state, CaptureState* capture,
     return TRUE;
 
 cleanup:
-    if (state->muxer) {
-        StreamingMuxer_Abort(state->muxer);
-        state->muxer = NULL;
-    }
+    CloseOutput(state, FALSE);
     if (state->encoder) {
         NVENCEncoder_Destroy(state->encoder);
         state->encoder = NULL;
@@ -218,6 +256,108 @@ cleanup:
     return success;
 }
 
+BOOL Recording_StartShared(RecordingState* state, const RECT* region,
+                           const AppConfig* config, const char* outputPath) {
+    if (!state || !region || !config || !outputPath) {
+        RecLog("Recording_StartShared: NULL argument\n");
+        return FALSE;
+    }
+
+    LONG currentState = InterlockedCompareExchange(&state->state, 0, 0);
+    if (currentState != RECORDING_STATE_IDLE) {
+        RecLog("Recording_StartShared: Already recording or in transition (state=%d)\n", currentState);
+        return FALSE;
+    }
+
+    ReplayStreamInfo info;
+    if (!ReplayBuffer_GetStreamInfo(&info)) {
+        RecLog("Recording_StartShared: Replay pipeline not running\n");
+        return FALSE;
+    }
+
+    /* Same region, size, fps and quality Recording_Start would have used
+     * (the capture even-rounds width/height the same way). */
+    int wantWidth = (region->right - region->left) & ~1;
+    int wantHeight = (region->bottom - region->top) & ~1;
+    int wantFps = config->replayFPS;
+    if (wantFps > MAX_FPS) wantFps = MAX_FPS;
+    if (wantFps < 1) wantFps = info.fps;  // <= 0 = "monitor rate", which replay resolved
+    if (region->left != info.captureRect.left || region->top != info.captureRect.top ||
+        wantWidth != info.width || wantHeight != info.height ||
+        wantFps != info.fps || config->quality != info.quality) {
+        RecLog("Recording_StartShared: Replay stream %dx%d@%d q=%d at (%ld,%ld) does not match "
+               "request %dx%d@%d q=%d at (%ld,%ld)\n",
+               info.width, info.height, info.fps, info.quality,
+               info.captureRect.left, info.captureRect.top,
+               wantWidth, wantHeight, wantFps, config->quality, region->left, region->top);
+        return FALSE;
+    }
+
+    InterlockedExchange(&state->state, RECORDING_STATE_STARTING);
+
+    state->sharedStream = TRUE;
+    state->capture = NULL;
+    state->width = info.width;
+    state->height = info.height;
+    state->fps = info.fps;
+    strncpy(state->outputPath, outputPath, MAX_PATH - 1);
+    state->outputPath[MAX_PATH - 1] = '\0';
+    state->seqHeaderSize = info.seqHeaderSize;
+    memcpy(state->seqHeader, info.seqHeader, info.seqHeaderSize);
+
+    MuxerConfig muxConfig = {
+        .width = state->width,
+        .height = state->height,
+        .fps = state->fps,
+        .quality = config->quality,
+        .seqHeader = state->seqHeader,
+        .seqHeaderSize = state->seqHeaderSize,
+        .codec = info.codec,
+        .fragmented = config->fragmentedRecording
+    };
+    state->muxer = StreamingMuxer_Create(outputPath, &muxConfig);
+    if (!state->muxer) {
+        RecLog("Recording_StartShared: StreamingMuxer_Create failed\n");
+        goto cleanup;
+    }
+    state->muxQueue = MuxQueue_Create(state->muxer, state->fps * RECORDING_MUX_QUEUE_SECONDS);
+    if (!state->muxQueue) {
+        RecLog("Recording_StartShared: MuxQueue_Create failed\n");
+        goto cleanup;
+    }
+
+    InterlockedExchange(&state->framesCaptured, 0);
+    InterlockedExchange(&state->framesEncoded, 0);
+    InterlockedExchange(&state->stopRequested, FALSE);
+
+    g_encoderCtx.queue = state->muxQueue;
+    g_encoderCtx.framesEncoded = &state->framesEncoded;
+    g_encoderCtx.framesCaptured = &state->framesCaptured;
+    g_encoderCtx.frameDuration = MF_UNITS_PER_SECOND / state->fps;
+    g_encoderCtx.waitingForKeyframe = TRUE;
+    g_encoderCtx.baseTimestamp = 0;
+
+    state->startTime = GetTickCount64();
+
+    // Attach publishes g_encoderCtx to the output thread (SRW lock = barrier)
+    if (!ReplayBuffer_AttachStreamTap(info.streamId, SharedStreamCallback, &g_encoderCtx)) {
+        RecLog("Recording_StartShared: Replay stream changed or already tapped\n");
+        goto cleanup;
+    }
+
+    InterlockedExchange(&state->state, RECORDING_STATE_ACTIVE);
+    RecLog("Recording_StartShared: Recording replay stream %ld (%dx%d @ %d fps) to %s\n",
+           info.streamId, state->width, state->height, state->fps, outputPath);
+    return TRUE;
+
+cleanup:
+    CloseOutput(state, FALSE);
+    ZeroMemory(&g_encoderCtx, sizeof(g_encoderCtx));
+    state->sharedStream = FALSE;
+    InterlockedExchange(&state->state, RECORDING_STATE_ERROR);
+    return FALSE;
+}
+
 void Recording_Stop(RecordingState* state) {
     if (!state) return;
 
@@ -234,6 +374,11 @@ void Recording_Stop(RecordingState* state) {
     InterlockedExchange(&state->stopRequested, TRUE);
     if (state->hStopEvent) SetEvent(state->hStopEvent);
 
+    // Shared mode: once detached no tap callback can touch the queue
+    if (state->sharedStream) {
+        ReplayBuffer_DetachStreamTap(SharedStreamCallback);
+    }
+
     // Wait for thread
     if (state->thread) {
         DWORD waitResult = WaitForSingleObject(state->thread, 10000);
@@ -243,8 +388,9 @@ void Recording_Stop(RecordingState* state) {
         SAFE_CLOSE_HANDLE(state->thread);
     }
 
-    // Destroy NVENC encoder (sync mode + frameIntervalP=1 has no queued
-    // frames to drain; Destroy sends EOS internally).
+    // Destroy NVENC encoder. In async mode this drains in-flight frames
+    // into EncoderCallback, so it must run before the queue is closed.
+    // Destroy sends EOS internally.
     if (state->encoder) {
         NVENCEncoder_Destroy(state->encoder);
         state->encoder = NULL;
@@ -253,10 +399,15 @@ void Recording_Stop(RecordingState* state) {
     // Shutdown GPU converter
     GPUConverter_Shutdown(&state->gpuConverter);
 
-    // Close muxer (finalizes MP4)
+    // Encoder drained: every bitstream lock has been recorded (the replay
+    // buffer owns the histograms while a shared recording runs)
+    if (!state->sharedStream) {
+        PipelineStats_Dump("recording stop", TRUE);
+    }
+
+    // Drain the queue, then close the muxer (finalizes MP4)
     if (state->muxer) {
-        BOOL muxOk = StreamingMuxer_Close(state->muxer);
-        state->muxer = NULL;
+        BOOL muxOk = CloseOutput(state, TRUE);
         RecLog("Recording_Stop: Muxer finalized %s\n", muxOk ? "OK" : "FAILED");
     }
 
@@ -265,6 +416,7 @@ void Recording_Stop(RecordingState* state) {
 
     // Clear capture reference
     state->capture = NULL;
+    state->sharedStream = FALSE;
 
     // Transition to IDLE
     InterlockedExchange(&state->state, RECORDING_STATE_IDLE);
@@ -299,11 +451,11 @@ void Recording_Shutdown(RecordingState* state) {
 
 /*
  * Encoder callback - called from NVENC output thread when frame is ready
- * Writes encoded frame directly to streaming muxer
+ * Hands the encoded frame to the mux queue (never blocks on the disk)
  */
 static void EncoderCallback(EncodedFrame* frame, void* userData) {
     RecordingEncoderContext* ctx = (RecordingEncoderContext*)userData;
-    if (!frame || !frame->data || !ctx || !ctx->muxer) return;
+    if (!frame || !frame->data || !ctx || !ctx->queue) return;
 
     MuxerSample sample = {
         .data = frame->data,
@@ -313,7 +465,41 @@ static void EncoderCallback(EncodedFrame* frame, void* userData) {
         .isKeyframe = frame->isKeyframe
     };
 
-    if (StreamingMuxer_WriteVideo(ctx->muxer, &sample)) {
+    // The callback owns frame->data (allocated in the NVENC output path) and
+    // passes it on: the queue frees it after writing, or at once if dropped
+    if (MuxQueue_Push(ctx->queue, &sample, TRUE)) {
+        InterlockedIncrement(ctx->framesEncoded);
+    }
+    frame->data = NULL;
+    LEAK_TRACK_NVENC_FRAME_FREE();
+    LEAK_TRACK_BYTES_FREE(LEAK_SITE_NVENC_BITSTREAM, sample.size);
+}
+
+/*
+ * Stream tap callback - called from the replay buffer's NVENC output thread.
+ * frame->data belongs to the replay buffer: the queue copies it, and it is
+ * not freed here. PTS are rebased so the file starts at the first keyframe.
+ */
+static void SharedStreamCallback(EncodedFrame* frame, void* userData) {
+    RecordingEncoderContext* ctx = (RecordingEncoderContext*)userData;
+    if (!frame || !frame->data || !ctx || !ctx->queue) return;
+
+    if (ctx->waitingForKeyframe) {
+        if (!frame->isKeyframe) return;
+        ctx->waitingForKeyframe = FALSE;
+        ctx->baseTimestamp = frame->timestamp;
+    }
+    InterlockedIncrement(ctx->framesCaptured);
+
+    MuxerSample sample = {
+        .data = frame->data,
+        .size = frame->size,
+        .timestamp = frame->timestamp - ctx->baseTimestamp,
+        .duration = ctx->frameDuration,
+        .isKeyframe = frame->isKeyframe
+    };
+
+    if (MuxQueue_Push(ctx->queue, &sample, FALSE)) {
         InterlockedIncrement(ctx->framesEncoded);
     }
 }
@@ -329,15 +515,19 @@ static void EncoderCallback(EncodedFrame* frame, void* userData) {
 static DWORD WINAPI RecordingThread(LPVOID param) {
     RecordingState* state = (RecordingState*)param;
 
-    // Request high-resolution timer (1ms instead of 15.6ms)
-    timeBeginPeriod(1);
-
     LARGE_INTEGER freq, start, now;
     QueryPerformanceFrequency(&freq);
     QueryPerformanceCounter(&start);
 
     int fps = state->fps;
     if (fps < 1) fps = 60;  // Guard against division by zero
+
+    // Frame pacing on a high-resolution waitable timer
+    FrameScheduler scheduler;
+    if (!FrameScheduler_Init(&scheduler, fps)) {
+        RecLog("RecordingThread: no frame timer, pacing with millisecond waits\n");
+    }
+    PipelineStats_Reset();
     double frameIntervalMs = 1000.0 / fps;
     /* Synthetic CFR PTS step in 100-ns units. Computed once to avoid
      * repeated multiply/divide and the integer overflow window the
@@ -345,6 +535,7 @@ static DWORD WINAPI RecordingThread(LPVOID param) {
     LONGLONG frameInterval = (LONGLONG)MF_UNITS_PER_SECOND / fps;
 
     UINT64 frameCount = 0;
+    BOOL haveLastFrame = FALSE;  // Gates SubmitRepeat for static frames
 
     RecLog("RecordingThread: Started (fps=%d, interval=%.2fms)\n", fps, frameIntervalMs);
 
@@ -359,18 +550,44 @@ static DWORD WINAPI RecordingThread(LPVOID param) {
             LONGLONG timestamp = (LONGLONG)frameCount * frameInterval;
 
             // Capture frame as GPU texture (stays on GPU)
+            LARGE_INTEGER t1, t2, t3, t4;
+            TraceActivity trace;
+            TRACE_STAGE_START(&trace, TRACE_STAGE_CAPTURE, (LONGLONG)frameCount, timestamp);
+            QueryPerformanceCounter(&t1);
             ID3D11Texture2D* bgraTexture = Capture_GetFrameTexture(state->capture, NULL);
+            QueryPerformanceCounter(&t2);
+            TRACE_STAGE_STOP(&trace, (LONGLONG)frameCount, timestamp);
 
             if (bgraTexture) {
-                // Convert BGRA to NV12 on GPU
-                ID3D11Texture2D* nv12Texture = GPUConverter_Convert(&state->gpuConverter, bgraTexture);
+                // Convert BGRA to NV12 on GPU, unless nothing inside the capture
+                // region changed: then repeat the last submitted frame instead
+                BOOL staticFrame = haveLastFrame &&
+                                   !Capture_GetLastChange(state->capture)->changed;
+                ID3D11Texture2D* nv12Texture = NULL;
+                if (!staticFrame) {
+                    TRACE_STAGE_START(&trace, TRACE_STAGE_CONVERT, (LONGLONG)frameCount, timestamp);
+                    nv12Texture = GPUConverter_Convert(&state->gpuConverter, bgraTexture);
+                    TRACE_STAGE_STOP(&trace, (LONGLONG)frameCount, timestamp);
+                }
+                QueryPerformanceCounter(&t3);
 
-                if (nv12Texture) {
+                if (nv12Texture || staticFrame) {
                     // Submit to NVENC (async - callback will write to muxer)
-                    int result = NVENCEncoder_SubmitTexture(state->encoder, nv12Texture, timestamp);
+                    TRACE_STAGE_START(&trace, TRACE_STAGE_ENCODE_SUBMIT, (LONGLONG)frameCount, timestamp);
+                    int result = staticFrame
+                        ? NVENCEncoder_SubmitRepeat(state->encoder, timestamp)
+                        : NVENCEncoder_SubmitTexture(state->encoder, nv12Texture, timestamp);
+                    TRACE_STAGE_STOP(&trace, (LONGLONG)frameCount, timestamp);
+                    QueryPerformanceCounter(&t4);
 
                     if (result == 1) {
-                        InterlockedIncrement(&state->framesCaptured);
+                        haveLastFrame = TRUE;
+                        LONG capturedNow = InterlockedIncrement(&state->framesCaptured);
+                        PipelineStats_Record(PIPELINE_STAGE_CAPTURE, t1, t2);
+                        if (!staticFrame) PipelineStats_Record(PIPELINE_STAGE_CONVERT, t2, t3);
+                        PipelineStats_Record(PIPELINE_STAGE_SUBMIT, t3, t4);
+                        // Live latency view, every ~5s of frames (console only)
+                        if (capturedNow % (fps * 5) == 0) PipelineStats_Dump("recording", FALSE);
                     } else if (result == -1) {
                         // Device lost - exit
                         RecLog("RecordingThread: NVENC device lost, exiting\n");
@@ -394,19 +611,17 @@ static DWORD WINAPI RecordingThread(LPVOID param) {
             }
         } else {
             // Wait until next frame OR stop signal, whichever comes first
-            double sleepMs = targetMs - elapsedMs;
-            DWORD waitMs = (sleepMs > 1.0) ? (DWORD)(sleepMs) : 1;
-            if (state->hStopEvent) {
-                if (WaitForSingleObject(state->hStopEvent, waitMs) == WAIT_OBJECT_0) {
-                    break;
-                }
-            } else {
-                Sleep(waitMs);
+            DWORD signaled = 0;
+            FrameWaitResult frameWait = FrameScheduler_WaitUntil(
+                &scheduler, FrameScheduler_FrameTime(&scheduler, start, frameCount),
+                &state->hStopEvent, state->hStopEvent ? 1 : 0, INFINITE, &signaled);
+            if (frameWait == FRAME_WAIT_SIGNALED) {
+                break;
             }
         }
     }
 
-    timeEndPeriod(1);
+    FrameScheduler_Shutdown(&scheduler);
 
     LONG captured = InterlockedCompareExchange(&state->framesCaptured, 0, 0);
     RecLog("RecordingThread: Exiting after %d frames\n", captured);
@@ -1,11 +1,14 @@
 /*
  * recording.h - Direct-to-disk NVENC recording (thread, start/stop, state machine)
  *
- * USES: nvenc_encoder, gpu_converter, mp4_muxer (streaming)
+ * USES: nvenc_encoder, gpu_converter, mux_queue, mp4_muxer (streaming)
  *
  * Direct-to-disk recording; writes frames as they arrive.
  * Symmetric with replay_buffer.h - both use same encoding modules.
  * Audio recording is handled by replay_buffer only (by design).
+ *
+ * While the replay buffer runs, Recording_StartShared records its encoded
+ * stream instead (no second capture, converter or NVENC session).
  */
 
 #ifndef RECORDING_H
@@ -17,6 +20,7 @@
 #include "nvenc_encoder.h"
 #include "gpu_converter.h"
 #include "mp4_muxer.h"
+#include "mux_queue.h"
 #include "markers.h"
 #include "constants.h"
 
@@ -38,11 +42,13 @@ typedef struct {
     HANDLE hStopEvent;              // Auto-reset event; signals capture thread to exit
     volatile LONG stopRequested;    // Legacy flag; retained for IsActive-style probes
     
-    // Video pipeline (owned)
+    // Video pipeline (owned; encoder/converter unused when sharedStream)
+    BOOL sharedStream;              // TRUE = muxing the replay buffer's stream tap
     NVENCEncoder* encoder;          // NVENC hardware encoder
     GPUConverter gpuConverter;      // BGRA→NV12 GPU conversion
     StreamingMuxer* muxer;          // MP4 streaming writer
-    BYTE seqHeader[MAX_SEQ_HEADER_SIZE];  // HEVC VPS/SPS/PPS
+    MuxQueue* muxQueue;             // Encoder callback -> writer thread -> muxer
+    BYTE seqHeader[MAX_SEQ_HEADER_SIZE];  // HEVC VPS/SPS/PPS or AV1 sequence OBU
     DWORD seqHeaderSize;
     
     // Capture reference (borrowed from caller)
@@ -75,6 +81,14 @@ void Recording_Init(RecordingState* state);
 BOOL Recording_Start(RecordingState* state, CaptureState* capture, 
                      const AppConfig* config, const char* outputPath);
 
+// Start recording from the running replay buffer's encoded stream.
+// region: screen rect the user wants recorded
+// Succeeds only if the replay pipeline captures that region and its encode
+// size, fps and quality equal what Recording_Start would use; the file then
+// starts at the stream's next keyframe. Returns FALSE otherwise.
+BOOL Recording_StartShared(RecordingState* state, const RECT* region,
+                           const AppConfig* config, const char* outputPath);
+
 // Stop recording (blocks until thread exits and file is finalized)
 void Recording_Stop(RecordingState* state);
 
@@ -1,10 +1,13 @@
 /*
  * replay_buffer.c - Orchestrates capture→encode→buffer→save pipeline (replay mode)
  *
- * USES: nvenc_encoder.c, gpu_converter.c, frame_buffer.c, mp4_muxer.c (batch)
+ * USES: nvenc_encoder.c, gpu_converter.c, frame_buffer.c, mp4_writer.c and
+ *       mp4_muxer.c (batch)
  *
  * Continuously captures to RAM-based circular buffer of encoded HEVC frames.
  * On save: muxes buffered frames to MP4 (no re-encoding needed).
+ * Continuous save: muxes the buffer, then keeps appending new frames to the
+ * same file until ended (a live recording from the same encoder).
  * Pipeline: DXGI capture → GPU color convert → NVENC → FrameBuffer ring
  *
  * ERROR HANDLING PATTERN:
@@ -30,17 +33,23 @@
 #include "audio_capture.h"
 #include "audio_device.h"
 #include "aac_encoder.h"
+#include "audio_ring.h"
 #include "mp4_muxer.h"
+#include "mp4_writer.h"
 #include "gpu_converter.h"
+#include "preview_tap.h"
 #include "constants.h"
 #include "kill_feed_sampler.h"
 #include "leak_tracker.h"
 #include "mem_utils.h"
-#include <mmsystem.h>  /* For timeBeginPeriod/timeEndPeriod */
+#include "frame_scheduler.h"
+#include "pipeline_stats.h"
+#include "metrics.h"
+#include "trace.h"
+#include "startup.h"
+#include "parallel.h"
 #include <stdio.h>     /* For snprintf */
 
-#pragma comment(lib, "winmm.lib")
-
 /* ============================================================================
  * INTERNAL STATE STRUCTURES
  * ============================================================================
@@ -56,10 +65,23 @@
 typedef struct ReplayVideoState {
     NVENCEncoder* encoder;              /* NVENC hardware encoder instance */
     FrameBuffer frameBuffer;            /* Circular buffer of encoded frames */
-    BYTE seqHeader[MAX_SEQ_HEADER_SIZE];/* HEVC VPS/SPS/PPS for muxing */
+    BYTE seqHeader[MAX_SEQ_HEADER_SIZE];/* HEVC VPS/SPS/PPS or AV1 sequence OBU */
     DWORD seqHeaderSize;                /* Size of sequence header */
+    VideoCodec codec;                   /* What the encoder settled on */
 } ReplayVideoState;
 
+/*
+ * SilenceGate - [Advanced] SilenceGate state of one live-encoded source track
+ * Owned by: Audio encode thread (DrainAudioCapture)
+ */
+typedef struct {
+    int silentBytes;                    /* Silence fed to the encoder since the last sound */
+    BOOL gated;                         /* Encoder suspended, storing the shared silent frame */
+    int pendingBytes;                   /* Gated silence short of a whole AAC frame */
+    LONGLONG gatedFrames;               /* Frames stored as the shared frame (stats) */
+    LONGLONG gateCount;                 /* Times the gate closed (stats) */
+} SilenceGate;
+
 /*
  * ReplayAudioState - Audio encoding pipeline state
  * Owned by: Buffer thread, callbacks protected by lock
@@ -68,29 +90,38 @@ typedef struct ReplayVideoState {
 typedef struct ReplayAudioState {
     AudioCaptureContext* capture;       /* WASAPI capture context */
     AACEncoder* encoder;                /* AAC MFT encoder (mixed track) */
-    MuxerAudioSample* samples;          /* Circular buffer of AAC samples (mixed) */
-    int sampleCount;                    /* Current sample count */
-    int sampleCapacity;                 /* Allocated capacity */
+    AudioRing samples;                  /* Ring of AAC samples (mixed), sized at pipeline init */
     BYTE* configData;                   /* AAC AudioSpecificConfig */
     int configSize;                     /* Size of configData */
     LONGLONG maxDuration;               /* Max buffer duration (100-ns units) */
+    volatile LONG64 storedBytes;        /* AAC bytes held by all tracks, plus deferred
+                                         * PCM rings (memory budget) */
+    volatile LONG64 evictBeforeTs;      /* Budget mode: also evict samples older than this
+                                         * (oldest buffered video IDR); 0 = off */
     CRITICAL_SECTION lock;              /* Protects samples array */
     BOOL lockInitialized;               /* Track CS initialization */
     int audioEvictLogCounter;           /* Log throttle (resets on buffer restart) */
-    int reallocFailCount;               /* Realloc failure log cap (resets on buffer restart) */
     
     /* Per-source AAC encoders and sample buffers (for multi-track output) */
     int perSourceCount;                              /* Number of active per-source encoders */
     AACEncoder* perSourceEncoders[MAX_AUDIO_SOURCES]; /* Per-source AAC encoders */
-    MuxerAudioSample* perSourceSamples[MAX_AUDIO_SOURCES]; /* Per-source sample arrays */
-    int perSourceSampleCount[MAX_AUDIO_SOURCES];
-    int perSourceSampleCapacity[MAX_AUDIO_SOURCES];
+    AudioRing perSourceSamples[MAX_AUDIO_SOURCES];   /* Per-source sample rings */
     BYTE* perSourceConfigData[MAX_AUDIO_SOURCES];
     int perSourceConfigSize[MAX_AUDIO_SOURCES];
     CRITICAL_SECTION perSourceLocks[MAX_AUDIO_SOURCES];
     BOOL perSourceLocksInit[MAX_AUDIO_SOURCES];
     int perSourceEvictLogCounter[MAX_AUDIO_SOURCES];
-    int perSourceReallocFail[MAX_AUDIO_SOURCES];
+    
+    /* DeferredSourceAudio: per-source PCM instead of encoders; data NULL when
+     * the track is live-encoded. Guarded by perSourceLocks. */
+    PcmRing perSourcePcm[MAX_AUDIO_SOURCES];
+    
+    SilenceGate perSourceGate[MAX_AUDIO_SOURCES];
+    
+    /* Encode thread: sole reader of capture, runs the encoder callbacks.
+     * NULL thread = drained inline by the buffer thread. */
+    HANDLE encodeThread;
+    HANDLE encodeStopEvent;             /* Manual reset */
 } ReplayAudioState;
 
 /*
@@ -109,11 +140,43 @@ typedef struct ReplayInternalState {
  */
 static ReplayInternalState g_internal = {0};
 
+/*
+ * Encoded stream tap (see replay_buffer.h). The SRW lock is taken shared on
+ * the NVENC output thread for each frame and exclusive by attach/detach and
+ * pipeline start/stop, so detaching waits out an in-flight callback.
+ */
+typedef struct {
+    SRWLOCK lock;
+    BOOL streamValid;               /* info describes a running pipeline */
+    ReplayStreamInfo info;
+    EncodedFrameCallback callback;  /* NULL = no tap attached */
+    void* userData;
+} ReplayStreamTap;
+
+static ReplayStreamTap g_streamTap = { SRWLOCK_INIT };
+
+/*
+ * Clip window of one save, resolved on the buffer thread to absolute buffer
+ * PTS (100ns since captureStartTime). A window reaching past the newest
+ * frame is held until the buffer catches up or deadlineMs passes.
+ */
+typedef struct {
+    BOOL ranged;                    /* FALSE = whole buffer */
+    LONGLONG startTs;
+    LONGLONG endTs;
+    ULONGLONG deadlineMs;           /* GetTickCount64 value to stop waiting at */
+    LONGLONG savedStartTs;          /* Span actually written (PrepareSaveJob) */
+    LONGLONG savedEndTs;
+} ReplaySaveWindow;
+static volatile LONG g_nextStreamId = 0;
+
 /* ---- External References ---- */
 extern CaptureState g_capture;      /* From main.c - DXGI capture */
 extern AppConfig g_config;          /* From main.c - Application config */
 
 static DWORD WINAPI BufferThreadProc(LPVOID param);
+static void PostSaveResult(const ReplaySaveRequest* request, BOOL ok,
+                           ULONGLONG startMs, ULONGLONG endMs);
 
 /* Alias for logging */
 #define ReplayLog Logger_Log
@@ -131,109 +194,93 @@ static PerSourceCallbackCtx g_perSourceCbCtx[MAX_AUDIO_SOURCES] = {0};
 static void DrainCallback(EncodedFrame* frame, void* userData) {
     FrameBuffer* buffer = (FrameBuffer*)userData;
     if (frame && frame->data && buffer) {
-        FrameBuffer_Add(buffer, frame);
+        /* Fan out to a shared recording before the buffer takes ownership */
+        AcquireSRWLockShared(&g_streamTap.lock);
+        if (g_streamTap.callback) {
+            g_streamTap.callback(frame, g_streamTap.userData);
+        }
+        ReleaseSRWLockShared(&g_streamTap.lock);
+        
+        LARGE_INTEGER addStart, addEnd;
+        TraceActivity trace;
+        LONGLONG size = frame->size, timestamp = frame->timestamp;
+        TRACE_STAGE_START(&trace, TRACE_STAGE_BUFFER_ADD, size, timestamp);
+        QueryPerformanceCounter(&addStart);
+        if (!FrameBuffer_Add(buffer, frame) && !FrameBuffer_UsesArena(buffer)) {
+            /* Heap mode only takes ownership on success */
+            SAFE_FREE(frame->data);
+            LEAK_TRACK_NVENC_FRAME_FREE();
+            LEAK_TRACK_BYTES_FREE(LEAK_SITE_NVENC_BITSTREAM, size);
+        }
+        QueryPerformanceCounter(&addEnd);
+        TRACE_STAGE_STOP(&trace, size, timestamp);
+        PipelineStats_Record(PIPELINE_STAGE_BUFFER_ADD, addStart, addEnd);
     }
 }
 
-/* Audio callback - stores encoded AAC samples */
-/* Called from audio mixer thread - protected by audio.lock */
-static void AudioEncoderCallback(const AACSample* sample, void* userData) {
-    ReplayAudioState* audio = (ReplayAudioState*)userData;
-    if (!sample || !sample->data || sample->size <= 0 || !audio) return;
-    
-    EnterCriticalSection(&audio->lock);
+/*
+ * Store one encoded AAC frame in a track's ring. Time-based eviction first:
+ * samples older than max duration go, or in budget mode those older than
+ * the video still buffered. The ring itself evicts further if it is full.
+ * track is the per-source index, -1 for the mixed track (logging only).
+ * A sample with data NULL is a silence-gate frame: the ring's shared
+ * silent frame. Caller holds the track's lock.
+ */
+static void StoreAudioSample(ReplayAudioState* audio, AudioRing* ring, const AACSample* sample,
+                             int* evictLogCounter, int track) {
+    size_t bytesBefore = ring->usedBytes;
     
-    /* Time-based eviction: remove samples older than max duration */
-    if (audio->sampleCount > 0 && audio->maxDuration > 0) {
+    if (ring->count > 0 && audio->maxDuration > 0) {
         int evicted = 0;
-        while (audio->sampleCount > 0) {
-            LONGLONG oldest = audio->samples[0].timestamp;
+        LONGLONG evictBefore = audio->evictBeforeTs;
+        while (ring->count > 0) {
+            LONGLONG oldest = AudioRing_At(ring, 0)->timestamp;
             LONGLONG span = sample->timestamp - oldest;
             
-            if (span <= audio->maxDuration) {
+            if (span <= audio->maxDuration && oldest >= evictBefore) {
                 break;  /* Within duration limit */
             }
-            
-            /* Evict oldest sample */
-            if (audio->samples[0].data) {
-                LEAK_TRACK_AAC_SAMPLE_FREE();
-                SAFE_FREE(audio->samples[0].data);
-            }
-            memmove(audio->samples, audio->samples + 1, 
-                    (audio->sampleCount - 1) * sizeof(MuxerAudioSample));
-            audio->sampleCount--;
+            AudioRing_PopOldest(ring);
             evicted++;
         }
         
         /* Log eviction periodically */
-        audio->audioEvictLogCounter++;
-        if (evicted > 0 && (audio->audioEvictLogCounter % AUDIO_EVICT_LOG_INTERVAL) == 0) {
+        (*evictLogCounter)++;
+        if (evicted > 0 && (*evictLogCounter % AUDIO_EVICT_LOG_INTERVAL) == 0) {
             double spanSec = 0;
-            if (audio->sampleCount > 0) {
-                spanSec = (sample->timestamp - audio->samples[0].timestamp) / (double)MF_UNITS_PER_SECOND;
-            }
-            ReplayLog("Audio eviction: removed %d samples, count=%d, span=%.2fs\n",
-                      evicted, audio->sampleCount, spanSec);
-        }
-    }
-    
-    /* Grow array if needed (capacity-based) */
-    if (audio->sampleCount >= audio->sampleCapacity) {
-        int newCapacity = audio->sampleCapacity == 0 ? INITIAL_AUDIO_CAPACITY : audio->sampleCapacity * AUDIO_CAPACITY_GROWTH_FACTOR;
-        if (newCapacity > MAX_AUDIO_SAMPLES) newCapacity = MAX_AUDIO_SAMPLES;
-        
-        if (audio->sampleCount >= newCapacity) {
-            /* Still full after time eviction - emergency capacity eviction */
-            int toKeep = (int)(newCapacity * EMERGENCY_KEEP_FRACTION);
-            int toRemove = audio->sampleCount - toKeep;
-            
-            for (int i = 0; i < toRemove && i < audio->sampleCount; i++) {
-                if (audio->samples[i].data) {
-                    LEAK_TRACK_AAC_SAMPLE_FREE();
-                    SAFE_FREE(audio->samples[i].data);
-                }
+            if (ring->count > 0) {
+                spanSec = (sample->timestamp - AudioRing_At(ring, 0)->timestamp) / (double)MF_UNITS_PER_SECOND;
             }
-            
-            memmove(audio->samples, audio->samples + toRemove, 
-                    toKeep * sizeof(MuxerAudioSample));
-            audio->sampleCount = toKeep;
-        } else {
-            MuxerAudioSample* newArr = realloc(audio->samples, 
-                                                newCapacity * sizeof(MuxerAudioSample));
-            if (newArr) {
-                /* Zero-initialize new capacity */
-                if (audio->sampleCapacity < newCapacity) {
-                    memset(newArr + audio->sampleCapacity, 0, 
-                           (newCapacity - audio->sampleCapacity) * sizeof(MuxerAudioSample));
-                }
-                audio->samples = newArr;
-                audio->sampleCapacity = newCapacity;
+            if (track < 0) {
+                ReplayLog("Audio eviction: removed %d samples, count=%d, span=%.2fs (%d early)\n",
+                          evicted, ring->count, spanSec, ring->spaceEvictions);
             } else {
-                if (++audio->reallocFailCount <= MAX_REALLOC_FAIL_LOGS) {
-                    ReplayLog("WARNING: Audio buffer realloc failed (count=%d, capacity=%d)\n", 
-                              audio->sampleCount, newCapacity);
-                }
+                ReplayLog("Audio track %d eviction: removed %d, count=%d, span=%.2fs (%d early)\n",
+                          track, evicted, ring->count, spanSec, ring->spaceEvictions);
             }
         }
     }
     
-    if (audio->sampleCount < audio->sampleCapacity) {
-        MuxerAudioSample* dst = &audio->samples[audio->sampleCount];
-        dst->data = (BYTE*)malloc(sample->size);
-        if (dst->data) {
-            LEAK_TRACK_AAC_SAMPLE_ALLOC();
-            memcpy(dst->data, sample->data, sample->size);
-            dst->size = sample->size;
-            dst->timestamp = sample->timestamp;
-            dst->duration = sample->duration;
-            audio->sampleCount++;
-        }
+    if (sample->data) {
+        AudioRing_Push(ring, sample->data, (DWORD)sample->size, sample->timestamp, sample->duration);
+    } else {
+        AudioRing_PushSilent(ring, sample->timestamp, sample->duration);
     }
+    InterlockedAdd64(&audio->storedBytes, (LONG64)ring->usedBytes - (LONG64)bytesBefore);
+}
+
+/* Audio callback - stores encoded AAC samples */
+/* Called from audio mixer thread - protected by audio.lock */
+static void AudioEncoderCallback(const AACSample* sample, void* userData) {
+    ReplayAudioState* audio = (ReplayAudioState*)userData;
+    if (!sample || !sample->data || sample->size <= 0 || !audio) return;
     
+    EnterCriticalSection(&audio->lock);
+    StoreAudioSample(audio, &audio->samples, sample, &audio->audioEvictLogCounter, -1);
     LeaveCriticalSection(&audio->lock);
 }
 
-/* Per-source AAC encoder callback - same logic as AudioEncoderCallback but for individual tracks */
+/* Per-source AAC encoder callback - same storage as AudioEncoderCallback, one ring per track */
 static void PerSourceEncoderCallback(const AACSample* sample, void* userData) {
     PerSourceCallbackCtx* cbCtx = (PerSourceCallbackCtx*)userData;
     if (!cbCtx || !sample || !sample->data || sample->size <= 0) return;
@@ -243,75 +290,8 @@ static void PerSourceEncoderCallback(const AACSample* sample, void* userData) {
     if (idx < 0 || idx >= MAX_AUDIO_SOURCES || !audio->perSourceLocksInit[idx]) return;
     
     EnterCriticalSection(&audio->perSourceLocks[idx]);
-    
-    /* Time-based eviction */
-    if (audio->perSourceSampleCount[idx] > 0 && audio->maxDuration > 0) {
-        int evicted = 0;
-        while (audio->perSourceSampleCount[idx] > 0) {
-            LONGLONG oldest = audio->perSourceSamples[idx][0].timestamp;
-            LONGLONG span = sample->timestamp - oldest;
-            if (span <= audio->maxDuration) break;
-            
-            if (audio->perSourceSamples[idx][0].data) SAFE_FREE(audio->perSourceSamples[idx][0].data);
-            memmove(audio->perSourceSamples[idx], audio->perSourceSamples[idx] + 1,
-                    (audio->perSourceSampleCount[idx] - 1) * sizeof(MuxerAudioSample));
-            audio->perSourceSampleCount[idx]--;
-            evicted++;
-        }
-        
-        audio->perSourceEvictLogCounter[idx]++;
-        if (evicted > 0 && (audio->perSourceEvictLogCounter[idx] % AUDIO_EVICT_LOG_INTERVAL) == 0) {
-            double spanSec = 0;
-            if (audio->perSourceSampleCount[idx] > 0) {
-                spanSec = (sample->timestamp - audio->perSourceSamples[idx][0].timestamp) / (double)MF_UNITS_PER_SECOND;
-            }
-            ReplayLog("Audio track %d eviction: removed %d, count=%d, span=%.2fs\n",
-                      idx, evicted, audio->perSourceSampleCount[idx], spanSec);
-        }
-    }
-    
-    /* Grow array if needed */
-    if (audio->perSourceSampleCount[idx] >= audio->perSourceSampleCapacity[idx]) {
-        int newCap = audio->perSourceSampleCapacity[idx] == 0 ? INITIAL_AUDIO_CAPACITY
-                     : audio->perSourceSampleCapacity[idx] * AUDIO_CAPACITY_GROWTH_FACTOR;
-        if (newCap > MAX_AUDIO_SAMPLES) newCap = MAX_AUDIO_SAMPLES;
-        
-        if (audio->perSourceSampleCount[idx] >= newCap) {
-            /* Emergency eviction */
-            int toKeep = (int)(newCap * EMERGENCY_KEEP_FRACTION);
-            int toRemove = audio->perSourceSampleCount[idx] - toKeep;
-            for (int i = 0; i < toRemove; i++) {
-                if (audio->perSourceSamples[idx][i].data) SAFE_FREE(audio->perSourceSamples[idx][i].data);
-            }
-            memmove(audio->perSourceSamples[idx], audio->perSourceSamples[idx] + toRemove,
-                    toKeep * sizeof(MuxerAudioSample));
-            audio->perSourceSampleCount[idx] = toKeep;
-        } else {
-            MuxerAudioSample* newArr = realloc(audio->perSourceSamples[idx],
-                                                newCap * sizeof(MuxerAudioSample));
-            if (newArr) {
-                if (audio->perSourceSampleCapacity[idx] < newCap) {
-                    memset(newArr + audio->perSourceSampleCapacity[idx], 0,
-                           (newCap - audio->perSourceSampleCapacity[idx]) * sizeof(MuxerAudioSample));
-                }
-                audio->perSourceSamples[idx] = newArr;
-                audio->perSourceSampleCapacity[idx] = newCap;
-            }
-        }
-    }
-    
-    if (audio->perSourceSampleCount[idx] < audio->perSourceSampleCapacity[idx]) {
-        MuxerAudioSample* dst = &audio->perSourceSamples[idx][audio->perSourceSampleCount[idx]];
-        dst->data = (BYTE*)malloc(sample->size);
-        if (dst->data) {
-            memcpy(dst->data, sample->data, sample->size);
-            dst->size = sample->size;
-            dst->timestamp = sample->timestamp;
-            dst->duration = sample->duration;
-            audio->perSourceSampleCount[idx]++;
-        }
-    }
-    
+    StoreAudioSample(audio, &audio->perSourceSamples[idx], sample,
+                     &audio->perSourceEvictLogCounter[idx], idx);
     LeaveCriticalSection(&audio->perSourceLocks[idx]);
 }
 
@@ -321,7 +301,7 @@ static void PerSourceEncoderCallback(const AACSample* sample, void* userData) {
 
 /*
  * MULTI-RESOURCE FUNCTION: ReplayBuffer_Init
- * Resources: 4 event handles + 1 critical section
+ * Resources: 5 event handles + 1 critical section
  * Pattern: goto-cleanup with SAFE_CLOSE_HANDLE
  * Init: ZeroMemory ensures NULL initialization
  */
@@ -357,6 +337,11 @@ BOOL ReplayBuffer_Init(ReplayBufferState* state) {
     state->hStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);  /* Manual reset */
     if (!state->hStopEvent) goto cleanup;
     
+    state->hContinuousWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);  /* Auto reset */
+    if (!state->hContinuousWakeEvent) goto cleanup;
+    
+    InitializeSRWLock(&state->saveQueueLock);
+    
     /* Initialize audio critical section */
     state->state = REPLAY_STATE_UNINITIALIZED;
     InitializeCriticalSection(&g_internal.audio.lock);
@@ -369,6 +354,7 @@ cleanup:
     SAFE_CLOSE_HANDLE(state->hSaveRequestEvent);
     SAFE_CLOSE_HANDLE(state->hSaveCompleteEvent);
     SAFE_CLOSE_HANDLE(state->hStopEvent);
+    SAFE_CLOSE_HANDLE(state->hContinuousWakeEvent);
     return FALSE;
 }
 
@@ -381,19 +367,13 @@ void ReplayBuffer_Shutdown(ReplayBufferState* state) {
     SAFE_CLOSE_HANDLE(state->hSaveRequestEvent);
     SAFE_CLOSE_HANDLE(state->hSaveCompleteEvent);
     SAFE_CLOSE_HANDLE(state->hStopEvent);
+    SAFE_CLOSE_HANDLE(state->hContinuousWakeEvent);
     
     /* Clean up audio samples - must be done BEFORE deleting critical section */
     ReplayAudioState* audio = &g_internal.audio;
     if (audio->lockInitialized) {
         EnterCriticalSection(&audio->lock);
-        if (audio->samples) {
-            for (int i = 0; i < audio->sampleCount; i++) {
-                if (audio->samples[i].data) SAFE_FREE(audio->samples[i].data);
-            }
-            SAFE_FREE(audio->samples);
-        }
-        audio->sampleCount = 0;
-        audio->sampleCapacity = 0;
+        AudioRing_Free(&audio->samples);
         audio->maxDuration = 0;
         LeaveCriticalSection(&audio->lock);
         
@@ -443,7 +423,13 @@ BOOL ReplayBuffer_Start(ReplayBufferState* state, const AppConfig* config) {
     InterlockedExchange(&state->audioError, AAC_OK);  // Reset audio error
     InterlockedExchange(&state->saveSuccess, FALSE);
     InterlockedExchange(&state->savePending, 0);
-    state->savePath[0] = '\0';
+    InterlockedExchange(&state->continuousState, REPLAY_CONTINUOUS_IDLE);
+    InterlockedExchange(&state->liveBufferedMs, 0);
+    InterlockedExchange(&state->liveMemoryMB, 0);
+    AcquireSRWLockExclusive(&state->saveQueueLock);
+    state->saveQueueHead = 0;
+    InterlockedExchange(&state->saveQueueCount, 0);
+    ReleaseSRWLockExclusive(&state->saveQueueLock);
     Markers_Init(&state->markers);
     
     /* Reset events */
@@ -457,14 +443,11 @@ BOOL ReplayBuffer_Start(ReplayBufferState* state, const AppConfig* config) {
     /* Reset audio buffer using new struct */
     ReplayAudioState* audio = &g_internal.audio;
     EnterCriticalSection(&audio->lock);
-    for (int i = 0; i < audio->sampleCount; i++) {
-        if (audio->samples[i].data) {
-            SAFE_FREE(audio->samples[i].data);
-        }
-    }
-    audio->sampleCount = 0;
+    AudioRing_Reset(&audio->samples);
     audio->maxDuration = 0;
     LeaveCriticalSection(&audio->lock);
+    InterlockedExchange64(&audio->storedBytes, 0);
+    InterlockedExchange64(&audio->evictBeforeTs, 0);
     
     state->bufferThread = CreateThread(NULL, 0, BufferThreadProc, state, 0, NULL);
     state->isBuffering = (state->bufferThread != NULL);
@@ -517,6 +500,8 @@ void ReplayBuffer_Stop(ReplayBufferState* state) {
         SAFE_CLOSE_HANDLE(state->bufferThread);
     }
     state->isBuffering = FALSE;
+    InterlockedExchange(&state->liveBufferedMs, 0);
+    InterlockedExchange(&state->liveMemoryMB, 0);
 }
 
 BOOL ReplayBuffer_IsActive(const ReplayBufferState* state) {
@@ -527,8 +512,50 @@ BOOL ReplayBuffer_IsActive(const ReplayBufferState* state) {
             s == REPLAY_STATE_STOPPING);
 }
 
-BOOL ReplayBuffer_SaveAsync(ReplayBufferState* state, const char* outputPath,
-                            HWND notifyWindow, UINT notifyMessage) {
+BOOL ReplayBuffer_GetStreamInfo(ReplayStreamInfo* info) {
+    if (!info) return FALSE;
+    
+    AcquireSRWLockShared(&g_streamTap.lock);
+    BOOL valid = g_streamTap.streamValid;
+    if (valid) *info = g_streamTap.info;
+    ReleaseSRWLockShared(&g_streamTap.lock);
+    return valid;
+}
+
+BOOL ReplayBuffer_AttachStreamTap(LONG streamId, EncodedFrameCallback callback, void* userData) {
+    if (!callback) return FALSE;
+    
+    BOOL attached = FALSE;
+    AcquireSRWLockExclusive(&g_streamTap.lock);
+    if (g_streamTap.streamValid && g_streamTap.info.streamId == streamId &&
+        !g_streamTap.callback) {
+        g_streamTap.callback = callback;
+        g_streamTap.userData = userData;
+        attached = TRUE;
+    }
+    ReleaseSRWLockExclusive(&g_streamTap.lock);
+    
+    if (attached) ReplayLog("Stream tap attached (stream %ld)\n", streamId);
+    return attached;
+}
+
+void ReplayBuffer_DetachStreamTap(EncodedFrameCallback callback) {
+    BOOL detached = FALSE;
+    AcquireSRWLockExclusive(&g_streamTap.lock);
+    if (callback && g_streamTap.callback == callback) {
+        g_streamTap.callback = NULL;
+        g_streamTap.userData = NULL;
+        detached = TRUE;
+    }
+    ReleaseSRWLockExclusive(&g_streamTap.lock);
+    
+    if (detached) ReplayLog("Stream tap detached\n");
+}
+
+/* Shared by the SaveAsync variants. secondsBack < 0 = whole buffer. */
+static BOOL RequestSave(ReplayBufferState* state, const char* outputPath,
+                        int secondsBack, int secondsAfter, LARGE_INTEGER anchorQpc,
+                        HWND notifyWindow, UINT notifyMessage) {
     // Preconditions
     LWSR_ASSERT(state != NULL);
     LWSR_ASSERT(outputPath != NULL);
@@ -554,30 +581,169 @@ BOOL ReplayBuffer_SaveAsync(ReplayBufferState* state, const char* outputPath,
         return FALSE;
     }
     
-    /* CAS guard: reject if a save is already pending/in-flight. This closes
-     * the producer/consumer race on savePath / notifyWindow / notifyMessage.
-     * The buffer thread clears savePending after PostMessage completes. */
-    if (InterlockedCompareExchange(&state->savePending, 1, 0) != 0) {
-        ReplayLog("SaveAsync rejected: prior save still pending\n");
+    /* Bounded queue: every outstanding save may hold a FrameBuffer pin.
+     * The slot is released after that save's notification is posted. */
+    LONG pending = InterlockedIncrement(&state->savePending);
+    if (pending > REPLAY_SAVE_QUEUE_DEPTH) {
+        InterlockedDecrement(&state->savePending);
+        ReplayLog("SaveAsync rejected: %d saves already queued\n", REPLAY_SAVE_QUEUE_DEPTH);
         return FALSE;
     }
     
     // Set up save parameters and notification target
-    strncpy(state->savePath, outputPath, MAX_PATH - 1);
-    state->savePath[MAX_PATH - 1] = '\0';
-    InterlockedExchange(&state->saveSuccess, FALSE);
-    state->notifyWindow = notifyWindow;
-    state->notifyMessage = notifyMessage;
+    ReplaySaveRequest request;
+    ZeroMemory(&request, sizeof(request));
+    strncpy(request.path, outputPath, MAX_PATH - 1);
+    request.secondsBack = secondsBack;
+    request.secondsAfter = secondsAfter;
+    request.anchorQpc = anchorQpc;
+    request.notifyWindow = notifyWindow;
+    request.notifyMessage = notifyMessage;
+    
+    /* Never full: queued requests <= savePending <= REPLAY_SAVE_QUEUE_DEPTH */
+    AcquireSRWLockExclusive(&state->saveQueueLock);
+    int slot = (state->saveQueueHead + state->saveQueueCount) % REPLAY_SAVE_QUEUE_DEPTH;
+    state->saveQueue[slot] = request;
+    InterlockedIncrement(&state->saveQueueCount);
+    ReleaseSRWLockExclusive(&state->saveQueueLock);
     
     // Signal save request - buffer thread will handle it and post notification when done
     SetEvent(state->hSaveRequestEvent);
     
-    ReplayLog("SaveAsync: Save requested, will notify hwnd=%p msg=%u\n", 
-              (void*)notifyWindow, notifyMessage);
+    if (secondsBack < 0) {
+        ReplayLog("SaveAsync: Save requested (%ld outstanding), will notify hwnd=%p msg=%u\n", 
+                  pending, (void*)notifyWindow, notifyMessage);
+    } else {
+        ReplayLog("SaveAsync: Save requested (-%ds/+%ds, %ld outstanding), will notify hwnd=%p msg=%u\n", 
+                  secondsBack, secondsAfter, pending, (void*)notifyWindow, notifyMessage);
+    }
+    return TRUE;
+}
+
+BOOL ReplayBuffer_SaveAsync(ReplayBufferState* state, const char* outputPath,
+                            HWND notifyWindow, UINT notifyMessage) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return RequestSave(state, outputPath, -1, 0, now, notifyWindow, notifyMessage);
+}
+
+BOOL ReplayBuffer_SaveRangeAsync(ReplayBufferState* state, const char* outputPath,
+                                 int secondsBack, int secondsAfter,
+                                 HWND notifyWindow, UINT notifyMessage) {
+    if (secondsBack < 0 || secondsAfter < 0 || secondsAfter > REPLAY_RANGE_SAVE_MAX_AFTER_SEC ||
+        secondsBack + secondsAfter <= 0) {
+        ReplayLog("SaveRangeAsync rejected: invalid window -%ds/+%ds\n", secondsBack, secondsAfter);
+        return FALSE;
+    }
+    
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return RequestSave(state, outputPath, secondsBack, secondsAfter, now,
+                       notifyWindow, notifyMessage);
+}
+
+BOOL ReplayBuffer_SaveMarkerAsync(ReplayBufferState* state, const char* outputPath,
+                                  int markerIndex, int secondsBefore, int secondsAfter,
+                                  HWND notifyWindow, UINT notifyMessage) {
+    LWSR_ASSERT(state != NULL);
+    
+    if (!state) return FALSE;
+    
+    int markerCount = Markers_GetCount(&state->markers);
+    if (markerIndex < 0) markerIndex = markerCount - 1;
+    if (markerIndex < 0 || markerIndex >= markerCount) {
+        ReplayLog("SaveMarkerAsync rejected: marker %d of %d\n", markerIndex, markerCount);
+        return FALSE;
+    }
+    if (secondsBefore < 0 || secondsAfter < 0 || secondsAfter > REPLAY_RANGE_SAVE_MAX_AFTER_SEC ||
+        secondsBefore + secondsAfter <= 0) {
+        ReplayLog("SaveMarkerAsync rejected: invalid window -%ds/+%ds\n", secondsBefore, secondsAfter);
+        return FALSE;
+    }
+    
+    /* Markers are GetTickCount64 ms; move the anchor onto the QPC timeline
+     * the buffer's PTS are measured on. */
+    LARGE_INTEGER now, freq;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&freq);
+    ULONGLONG nowMs = GetTickCount64();
+    ULONGLONG markerMs = state->markers.markers[markerIndex].timestampMs;
+    ULONGLONG agoMs = (nowMs > markerMs) ? (nowMs - markerMs) : 0;
+    LARGE_INTEGER anchor;
+    anchor.QuadPart = now.QuadPart - (LONGLONG)(agoMs / 1000) * freq.QuadPart
+                                   - (LONGLONG)(agoMs % 1000) * freq.QuadPart / 1000;
+    
+    return RequestSave(state, outputPath, secondsBefore, secondsAfter, anchor,
+                       notifyWindow, notifyMessage);
+}
+
+BOOL ReplayBuffer_BeginContinuousSave(ReplayBufferState* state, const char* outputPath,
+                                      HWND notifyWindow, UINT notifyMessage) {
+    LWSR_ASSERT(state != NULL);
+    LWSR_ASSERT(outputPath != NULL);
+    
+    if (!state || !outputPath || !state->isBuffering) {
+        ReplayLog("BeginContinuousSave rejected: not buffering\n");
+        return FALSE;
+    }
+    if (InterlockedCompareExchange(&state->state, 0, 0) != REPLAY_STATE_CAPTURING ||
+        InterlockedCompareExchange(&state->framesCaptured, 0, 0) < MIN_FRAMES_FOR_SAVE) {
+        ReplayLog("BeginContinuousSave rejected: buffer not ready\n");
+        return FALSE;
+    }
+    
+    /* Claim first so a concurrent Begin cannot interleave its request */
+    if (InterlockedCompareExchange(&state->continuousState, REPLAY_CONTINUOUS_CLAIMED,
+                                   REPLAY_CONTINUOUS_IDLE) != REPLAY_CONTINUOUS_IDLE) {
+        ReplayLog("BeginContinuousSave rejected: one is already running\n");
+        return FALSE;
+    }
+    
+    ZeroMemory(&state->continuousRequest, sizeof(state->continuousRequest));
+    strncpy(state->continuousRequest.path, outputPath, MAX_PATH - 1);
+    state->continuousRequest.secondsBack = -1;
+    QueryPerformanceCounter(&state->continuousRequest.anchorQpc);
+    state->continuousRequest.notifyWindow = notifyWindow;
+    state->continuousRequest.notifyMessage = notifyMessage;
+    InterlockedExchange(&state->continuousState, REPLAY_CONTINUOUS_REQUESTED);
+    
+    SetEvent(state->hSaveRequestEvent);
+    ReplayLog("BeginContinuousSave: %s, will notify hwnd=%p msg=%u\n",
+              outputPath, (void*)notifyWindow, notifyMessage);
     return TRUE;
 }
 
-int ReplayBuffer_EstimateRAMUsage(int durationSec, int w, int h, int fps, QualityPreset quality) {
+void ReplayBuffer_EndContinuousSave(ReplayBufferState* state) {
+    if (!state) return;
+    
+    for (;;) {
+        LONG prev = InterlockedCompareExchange(&state->continuousState, REPLAY_CONTINUOUS_STOPPING,
+                                               REPLAY_CONTINUOUS_ACTIVE);
+        if (prev == REPLAY_CONTINUOUS_ACTIVE) {
+            SetEvent(state->hContinuousWakeEvent);
+            ReplayLog("EndContinuousSave: finalizing %s\n", state->continuousRequest.path);
+            return;
+        }
+        if (prev != REPLAY_CONTINUOUS_REQUESTED) return;   /* Idle, claimed or already stopping */
+        
+        /* Not picked up yet: cancel, unless the buffer thread just did */
+        if (InterlockedCompareExchange(&state->continuousState, REPLAY_CONTINUOUS_IDLE,
+                                       REPLAY_CONTINUOUS_REQUESTED) == REPLAY_CONTINUOUS_REQUESTED) {
+            ReplayLog("EndContinuousSave: cancelled before it started\n");
+            PostSaveResult(&state->continuousRequest, FALSE, 0, 0);
+            return;
+        }
+    }
+}
+
+BOOL ReplayBuffer_IsContinuousSaving(const ReplayBufferState* state) {
+    if (!state) return FALSE;
+    return InterlockedCompareExchange((volatile LONG*)&state->continuousState, 0, 0) !=
+           REPLAY_CONTINUOUS_IDLE;
+}
+
+int ReplayBuffer_EstimateRAMUsage(int durationSec, int w, int h, int fps, QualityPreset quality,
+                                  VideoCodec codec) {
     /* Preconditions */
     LWSR_ASSERT(durationSec > 0);
     LWSR_ASSERT(w > 0);
@@ -603,6 +769,7 @@ int ReplayBuffer_EstimateRAMUsage(int durationSec, int w, int h, int fps, Qualit
     if (fpsScale > 4.0f) fpsScale = 4.0f;  // Support up to 240fps
     
     float mbps = baseMbps * resScale * fpsScale;
+    if (codec == CODEC_AV1) mbps *= AV1_BITRATE_SCALE;
     float totalMB = (mbps * durationSec) / 8.0f;
     
     return (int)totalMB;
@@ -668,42 +835,59 @@ static void ApplyAspectRatioAdjustment(RECT* rect, int* width, int* height) {
  * @param capture      Capture state with D3D11 device
  * @param video        Video state to initialize
  * @param gpuConverter GPU converter to initialize
- * @param width        Frame width
- * @param height       Frame height
+ * @param width        Encoded frame width (after optional GPU downscale)
+ * @param height       Encoded frame height (after optional GPU downscale)
  * @param fps          Target frame rate
  * @return TRUE if pipeline initialized successfully
  */
 static BOOL InitVideoPipeline(CaptureState* capture, ReplayVideoState* video, 
                                GPUConverter* gpuConverter, int width, int height, int fps) {
-    /* Initialize GPU color converter (BGRA → NV12 on GPU) */
-    if (!GPUConverter_Init(gpuConverter, capture->device, width, height)) {
+    /* Initialize GPU color converter (BGRA → NV12 on GPU, scaling from the
+     * capture size to the encode size in the same blit when they differ) */
+    if (!GPUConverter_InitScaled(gpuConverter, capture->device,
+                                 capture->captureWidth, capture->captureHeight,
+                                 width, height, NV12_TEXTURE_RING_DEPTH)) {
         ReplayLog("GPUConverter_Init failed - GPU color conversion required!\n");
         return FALSE;
     }
-    ReplayLog("GPU color converter initialized (D3D11 Video Processor)\n");
+    ReplayLog("GPU color converter initialized (D3D11 Video Processor, %d-slot ring)\n",
+              gpuConverter->slotCount);
     
-    /* Initialize NVENC HEVC encoder with D3D11 device (native API) */
+    /* Initialize NVENC encoder with D3D11 device (native API) */
     ReplayLog("Creating NVENCEncoder (%dx%d @ %d fps, quality=%d)...\n", 
               width, height, fps, g_config.quality);
-    video->encoder = NVENCEncoder_Create(capture->device, width, height, fps, g_config.quality);
+    video->encoder = NVENCEncoder_Create(capture->device, width, height, fps,
+                                          g_config.quality, g_config.codec, g_config.asyncEncode);
     if (!video->encoder) {
         ReplayLog("NVENCEncoder_Create failed - NVIDIA GPU with NVENC required!\n");
         GPUConverter_Shutdown(gpuConverter);
         return FALSE;
     }
-    ReplayLog("NVENC HEVC hardware encoder initialized (native API)\n");
+    video->codec = NVENCEncoder_GetCodec(video->encoder);
+    ReplayLog("NVENC %s hardware encoder initialized (%s input)\n",
+              video->codec == CODEC_AV1 ? "AV1" : "HEVC",
+              NVENCEncoder_IsZeroCopy(video->encoder) ? "D3D11 zero-copy" : "CUDA readback");
+    NVENCEncoder_SetInputRingDepth(video->encoder, gpuConverter->slotCount);
     
-    /* Extract HEVC sequence header (VPS/SPS/PPS) for MP4 muxing */
+    /* Extract the sequence header (HEVC VPS/SPS/PPS, AV1 OBU) for MP4 muxing */
     if (NVENCEncoder_GetSequenceHeader(video->encoder, video->seqHeader, 
                                         sizeof(video->seqHeader), &video->seqHeaderSize)) {
-        ReplayLog("HEVC sequence header extracted (%u bytes)\n", video->seqHeaderSize);
+        ReplayLog("Sequence header extracted (%u bytes)\n", video->seqHeaderSize);
     } else {
-        ReplayLog("WARNING: Failed to get HEVC sequence header - muxing may fail!\n");
+        ReplayLog("WARNING: Failed to get sequence header - muxing may fail!\n");
         video->seqHeaderSize = 0;
     }
     
+    /* Spill tier: only the hot newest seconds stay in RAM, the rest of the
+     * duration lives in a memory-mapped file under SpillPath. If the file
+     * can't be set up the whole duration goes back to RAM. */
+    int ramSeconds = g_config.replayDuration;
+    BOOL spilling = g_config.replaySpillPath[0] != '\0' &&
+                    g_config.replayDuration > g_config.replaySpillHotSeconds;
+    if (spilling) ramSeconds = g_config.replaySpillHotSeconds;
+    
     /* Initialize frame buffer */
-    if (!FrameBuffer_Init(&video->frameBuffer, g_config.replayDuration, fps, 
+    if (!FrameBuffer_Init(&video->frameBuffer, ramSeconds, fps, 
                           width, height, g_config.quality)) {
         ReplayLog("FrameBuffer_Init failed\n");
         NVENCEncoder_Destroy(video->encoder);
@@ -712,31 +896,237 @@ static BOOL InitVideoPipeline(CaptureState* capture, ReplayVideoState* video,
         return FALSE;
     }
     
+    if (spilling) {
+        int spillSeconds = g_config.replayDuration - ramSeconds;
+        int spillEstimateMB = ReplayBuffer_EstimateRAMUsage(spillSeconds, width, height,
+                                                            fps, g_config.quality, video->codec);
+        size_t spillMB = (size_t)((float)spillEstimateMB * FRAME_ARENA_HEADROOM);
+        if (spillMB < FRAME_ARENA_MIN_MB) spillMB = FRAME_ARENA_MIN_MB;
+        if (FrameBuffer_EnableSpill(&video->frameBuffer, g_config.replaySpillPath,
+                                    spillSeconds, spillMB * 1024 * 1024)) {
+            ReplayLog("Replay spill tier: %ds in RAM + %ds on disk (%zu MB)\n",
+                      ramSeconds, spillSeconds, spillMB);
+        } else {
+            FrameBuffer_Shutdown(&video->frameBuffer);
+            ramSeconds = g_config.replayDuration;
+            if (!FrameBuffer_Init(&video->frameBuffer, ramSeconds, fps,
+                                  width, height, g_config.quality)) {
+                ReplayLog("FrameBuffer_Init failed\n");
+                NVENCEncoder_Destroy(video->encoder);
+                video->encoder = NULL;
+                GPUConverter_Shutdown(gpuConverter);
+                return FALSE;
+            }
+        }
+    }
+    
+    /* Arena storage: NVENC lends its locked bitstream and FrameBuffer_Add
+     * copies it straight into the arena, so steady state allocates nothing.
+     * Falls back to per-frame heap blocks if the arena can't be allocated. */
+    if (g_config.frameArena) {
+        int estimateMB = ReplayBuffer_EstimateRAMUsage(ramSeconds, width, height,
+                                                       fps, g_config.quality, video->codec);
+        size_t arenaMB = (size_t)((float)estimateMB * FRAME_ARENA_HEADROOM);
+        if (arenaMB < FRAME_ARENA_MIN_MB) arenaMB = FRAME_ARENA_MIN_MB;
+        /* With a budget, reserve exactly it: commit follows the fill, and the
+           budget is a hard cap either way. Large pages are committed and
+           locked whole, so they are only tried for a budget-sized arena,
+           never for the 2x headroom estimate. */
+        BOOL largePages = FALSE;
+        if (g_config.replayMemoryBudgetMB > 0) {
+            arenaMB = (size_t)g_config.replayMemoryBudgetMB;
+            largePages = g_config.largePages;
+        }
+        if (FrameBuffer_EnableArena(&video->frameBuffer, arenaMB * 1024 * 1024,
+                                    largePages)) {
+            NVENCEncoder_SetBorrowedOutput(video->encoder, TRUE);
+        }
+    }
+    
+    /* Memory budget: frames + audio tracks (charged each budget tick) */
+    if (g_config.replayMemoryBudgetMB > 0) {
+        FrameBuffer_SetByteBudget(&video->frameBuffer,
+                                  (size_t)g_config.replayMemoryBudgetMB * 1024 * 1024);
+    }
+    
     /* Set encoder callback for async mode */
     NVENCEncoder_SetCallback(video->encoder, DrainCallback, &video->frameBuffer);
     
     /* Pass sequence header to frame buffer */
     if (video->seqHeaderSize > 0) {
-        FrameBuffer_SetSequenceHeader(&video->frameBuffer, video->seqHeader, video->seqHeaderSize);
+        FrameBuffer_SetSequenceHeader(&video->frameBuffer, video->codec,
+                                      video->seqHeader, video->seqHeaderSize);
     }
     
     ReplayLog("Frame buffer initialized (max %ds)\n", g_config.replayDuration);
     return TRUE;
 }
 
+/* ============================================================================
+ * AUDIO ENCODE THREAD
+ * ============================================================================
+ * Mixed and per-source PCM is pulled from the capture rings and fed to the
+ * AAC encoders here instead of between video frames: an MFT stall no
+ * longer delays the next frame, and each wake drains everything buffered
+ * rather than one chunk per video iteration. Woken by the mix thread's
+ * outputReady event after every mixed chunk.
+ */
+
+/*
+ * Feed one read of a live-encoded source track through its silence gate.
+ * Sound is encoded as always. AUDIO_SILENCE_HANGOVER_FRAMES of silence are
+ * still encoded, then the encoder is suspended, its last (silent) frame
+ * becomes the ring's shared silent frame, and every further frame of
+ * silence is stored as that frame on the encoder's timeline. Sound reopens
+ * the gate; the partial frame of silence the encoder dropped is fed back
+ * first, so no sample moves.
+ */
+static void FeedSourceTrack(ReplayAudioState* audio, int si, const BYTE* pcm, int bytes,
+                            BOOL silent, LONGLONG ts) {
+    static const BYTE SILENCE[AAC_SAMPLES_PER_FRAME * AUDIO_BLOCK_ALIGN] = { 0 };
+    const int frameBytes = (int)sizeof(SILENCE);
+    AACEncoder* encoder = audio->perSourceEncoders[si];
+    SilenceGate* gate = &audio->perSourceGate[si];
+    
+    if (!g_config.silenceGate) {
+        AACEncoder_Feed(encoder, pcm, bytes, ts);
+        return;
+    }
+    
+    if (gate->gated) {
+        if (silent) {
+            gate->pendingBytes += bytes;
+            EnterCriticalSection(&audio->perSourceLocks[si]);
+            for (; gate->pendingBytes >= frameBytes; gate->pendingBytes -= frameBytes) {
+                AACSample frame;
+                AACEncoder_SkipFrame(encoder, &frame);
+                StoreAudioSample(audio, &audio->perSourceSamples[si], &frame,
+                                 &audio->perSourceEvictLogCounter[si], si);
+                gate->gatedFrames++;
+            }
+            LeaveCriticalSection(&audio->perSourceLocks[si]);
+            return;
+        }
+        gate->gated = FALSE;
+        if (gate->pendingBytes > 0) AACEncoder_Feed(encoder, SILENCE, gate->pendingBytes, ts);
+        gate->pendingBytes = 0;
+    }
+    
+    AACEncoder_Feed(encoder, pcm, bytes, ts);
+    gate->silentBytes = silent ? gate->silentBytes + bytes : 0;
+    if (gate->silentBytes < AUDIO_SILENCE_HANGOVER_FRAMES * frameBytes) return;
+    
+    gate->silentBytes = 0;
+    int dropped = 0;
+    if (!AACEncoder_Suspend(encoder, &dropped)) return;
+    
+    EnterCriticalSection(&audio->perSourceLocks[si]);
+    AudioRing* ring = &audio->perSourceSamples[si];
+    BOOL cached = FALSE;
+    if (ring->count > 0) {
+        const MuxerAudioSample* newest = AudioRing_At(ring, ring->count - 1);
+        cached = AudioRing_SetSilentFrame(ring, newest->data, newest->size);
+    }
+    LeaveCriticalSection(&audio->perSourceLocks[si]);
+    
+    if (!cached) {
+        /* Nothing to share: stay live, give the encoder its silence back */
+        if (dropped > 0) AACEncoder_Feed(encoder, SILENCE, dropped, ts);
+        return;
+    }
+    gate->gated = TRUE;
+    gate->pendingBytes = dropped;
+    gate->gateCount++;
+}
+
+/* Read everything buffered into the encoders. Caller is the capture's only reader. */
+static void DrainAudioCapture(ReplayAudioState* audio) {
+    BYTE pcm[8192];
+    LONGLONG ts = 0;
+    int bytes;
+    BOOL silent = FALSE;
+    
+    /* Mixed audio (track 0) */
+    do {
+        bytes = AudioCapture_Read(audio->capture, pcm, sizeof(pcm), &ts);
+        if (bytes > 0) AACEncoder_Feed(audio->encoder, pcm, bytes, ts);
+    } while (bytes == (int)sizeof(pcm));
+    
+    /* Per-source audio (tracks 1..N): encoded, or kept as PCM until a save */
+    for (int si = 0; si < audio->perSourceCount; si++) {
+        PcmRing* deferred = audio->perSourcePcm[si].data ? &audio->perSourcePcm[si] : NULL;
+        if (!deferred && !audio->perSourceEncoders[si]) continue;
+        do {
+            bytes = AudioCapture_ReadSource(audio->capture, si, pcm, sizeof(pcm), &ts, &silent);
+            if (bytes <= 0) break;
+            if (deferred) {
+                EnterCriticalSection(&audio->perSourceLocks[si]);
+                PcmRing_Write(deferred, pcm, bytes, ts);
+                LeaveCriticalSection(&audio->perSourceLocks[si]);
+            } else {
+                FeedSourceTrack(audio, si, pcm, bytes, silent, ts);
+            }
+        } while (bytes == (int)sizeof(pcm));
+    }
+}
+
+static DWORD WINAPI AudioEncodeThreadProc(LPVOID param) {
+    ReplayAudioState* audio = (ReplayAudioState*)param;
+    
+    /* The AAC MFTs are called from here */
+    HRESULT coHr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    BOOL coOwned = SUCCEEDED(coHr);
+    
+    HANDLE waits[2] = { audio->encodeStopEvent, audio->capture->outputReady };
+    for (;;) {
+        Logger_Heartbeat(THREAD_AUDIO_ENC);
+        /* Timeout only bounds the heartbeat; output normally signals */
+        DWORD wr = WaitForMultipleObjects(2, waits, FALSE, REPLAY_AUDIO_ENCODE_WAIT_MS);
+        if (wr == WAIT_OBJECT_0) break;
+        DrainAudioCapture(audio);
+    }
+    
+    Logger_ResetHeartbeat(THREAD_AUDIO_ENC);
+    if (coOwned) CoUninitialize();
+    return 0;
+}
+
+/* Start the encode thread. On failure the buffer thread drains inline. */
+static void AudioEncodeThread_Start(ReplayAudioState* audio) {
+    audio->encodeStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!audio->encodeStopEvent) {
+        ReplayLog("AudioEncode: CreateEvent failed (%lu), encoding inline\n", GetLastError());
+        return;
+    }
+    audio->encodeThread = CreateThread(NULL, 0, AudioEncodeThreadProc, audio, 0, NULL);
+    if (!audio->encodeThread) {
+        ReplayLog("AudioEncode: CreateThread failed (%lu), encoding inline\n", GetLastError());
+        SAFE_CLOSE_HANDLE(audio->encodeStopEvent);
+    }
+}
+
+static void AudioEncodeThread_Stop(ReplayAudioState* audio) {
+    if (audio->encodeThread) {
+        SetEvent(audio->encodeStopEvent);
+        WaitForSingleObject(audio->encodeThread, INFINITE);
+        SAFE_CLOSE_HANDLE(audio->encodeThread);
+    }
+    SAFE_CLOSE_HANDLE(audio->encodeStopEvent);
+}
+
 /**
- * Initialize audio capture pipeline (WASAPI + AAC encoder).
- * Creates audio capture and encoder if audio sources are configured.
+ * Build the audio capture pipeline (WASAPI + AAC encoders) without starting
+ * it. Creates audio capture and encoders if audio sources are configured.
+ * Runs on AudioPrepThreadProc alongside InitVideoPipeline; StartAudioPipeline
+ * starts capture once the shared t0 exists.
  * 
  * @param state Replay buffer state with audio configuration
  * @param audio Audio state to initialize
- * @param t0    Shared QPC anchor — audio and video PTS must use the same wall-clock
- *              origin or every save will be misaligned at the front edge.
  * @param outAudioError [out] Receives AAC encoder error code if encoder fails (may be NULL)
- * @return TRUE if audio is active and ready
+ * @return TRUE if audio is built and ready to start
  */
-static BOOL InitAudioPipeline(ReplayBufferState* state, ReplayAudioState* audio,
-                              LARGE_INTEGER t0, AACEncoderError* outAudioError) {
+static BOOL PrepareAudioPipeline(ReplayBufferState* state, ReplayAudioState* audio,
+                                 AACEncoderError* outAudioError) {
     if (outAudioError) *outAudioError = AAC_OK;
     
     if (!state->audioEnabled) return FALSE;
@@ -763,6 +1153,8 @@ static BOOL InitAudioPipeline(ReplayBufferState* state, ReplayAudioState* audio,
         ReplayLog("AudioCapture_Create failed\n");
         return FALSE;
     }
+    audio->capture->eventDriven = g_config.eventAudio;
+    audio->capture->driftCorrection = g_config.audioDriftCorrection;
     
     AACEncoderError aacErr = AAC_OK;
     audio->encoder = AACEncoder_CreateEx(&aacErr);
@@ -774,31 +1166,50 @@ static BOOL InitAudioPipeline(ReplayBufferState* state, ReplayAudioState* audio,
         return FALSE;
     }
     
+    /* Size the mixed ring for the replay duration before the encoder can deliver */
+    EnterCriticalSection(&audio->lock);
+    AudioRing_Free(&audio->samples);
+    if (!AudioRing_Init(&audio->samples, g_config.replayDuration)) {
+        ReplayLog("Mixed audio ring allocation failed - track will be missing\n");
+    }
+    LeaveCriticalSection(&audio->lock);
+    
     AACEncoder_SetCallback(audio->encoder, AudioEncoderCallback, audio);
     
     /* Set audio max duration to match video buffer (in 100-ns units) */
     audio->maxDuration = (LONGLONG)g_config.replayDuration * 10000000LL;
-    ReplayLog("Audio eviction enabled: max duration = %ds\n", g_config.replayDuration);
+    ReplayLog("Audio eviction enabled: max duration = %ds, %d samples / %zu KB per track\n",
+              g_config.replayDuration, audio->samples.capacity, audio->samples.arenaSize / 1024);
     
     /* Get AAC config for muxer */
     AACEncoder_GetConfig(audio->encoder, &audio->configData, &audio->configSize);
     
-    if (!AudioCapture_StartAt(audio->capture, t0)) {
-        ReplayLog("AudioCapture_StartAt failed\n");
-        AACEncoder_Destroy(audio->encoder);
-        AudioCapture_Destroy(audio->capture);
-        audio->encoder = NULL;
-        audio->capture = NULL;
-        return FALSE;
-    }
-    
-    /* Create per-source AAC encoders for multi-track output */
+    /* Create per-source AAC encoders (or deferred PCM rings) for multi-track output */
     audio->perSourceCount = AudioCapture_GetSourceCount(audio->capture);
-    ReplayLog("Creating %d per-source AAC encoders for multi-track...\n", audio->perSourceCount);
+    ReplayLog("Creating %d per-source %s for multi-track...\n", audio->perSourceCount,
+              g_config.deferredSourceAudio ? "PCM rings (deferred encode)" : "AAC encoders");
     for (int i = 0; i < audio->perSourceCount; i++) {
         InitializeCriticalSection(&audio->perSourceLocks[i]);
         audio->perSourceLocksInit[i] = TRUE;
         
+        if (g_config.deferredSourceAudio) {
+            /* Encoded at save time with the mixed track's settings, so its
+             * AudioSpecificConfig describes these tracks too */
+            if (PcmRing_Init(&audio->perSourcePcm[i], g_config.replayDuration)) {
+                InterlockedAdd64(&audio->storedBytes, (LONG64)audio->perSourcePcm[i].capacity);
+                audio->perSourceConfigData[i] = audio->configData;
+                audio->perSourceConfigSize[i] = audio->configSize;
+                ReplayLog("  Per-source PCM ring %d: %zu KB\n", i, audio->perSourcePcm[i].capacity / 1024);
+            } else {
+                ReplayLog("  Per-source PCM ring %d allocation failed - track will be missing\n", i);
+            }
+            continue;
+        }
+        
+        if (!AudioRing_Init(&audio->perSourceSamples[i], g_config.replayDuration)) {
+            ReplayLog("  Per-source ring %d allocation failed - track will be missing\n", i);
+        }
+        
         AACEncoderError psErr = AAC_OK;
         audio->perSourceEncoders[i] = AACEncoder_CreateEx(&psErr);
         if (audio->perSourceEncoders[i]) {
@@ -811,8 +1222,6 @@ static BOOL InitAudioPipeline(ReplayBufferState* state, ReplayAudioState* audio,
             ReplayLog("  Per-source encoder %d failed (error=%d) - track will be missing\n", i, (int)psErr);
         }
     }
-    
-    ReplayLog("Audio capture started successfully\n");
     return TRUE;
 }
 
@@ -822,6 +1231,9 @@ static BOOL InitAudioPipeline(ReplayBufferState* state, ReplayAudioState* audio,
  * @param audio Audio state to shut down
  */
 static void ShutdownAudioPipeline(ReplayAudioState* audio) {
+    /* Before the capture and encoders it uses go away */
+    AudioEncodeThread_Stop(audio);
+    
     if (audio->capture) {
         AudioCapture_Stop(audio->capture);
         AudioCapture_Destroy(audio->capture);
@@ -834,19 +1246,24 @@ static void ShutdownAudioPipeline(ReplayAudioState* audio) {
     
     /* Destroy per-source encoders and free their sample buffers */
     for (int i = 0; i < audio->perSourceCount; i++) {
+        if (audio->perSourceGate[i].gateCount > 0) {
+            ReplayLog("Audio track %d silence gate: closed %lld times, %lld frames shared\n",
+                      i, audio->perSourceGate[i].gateCount, audio->perSourceGate[i].gatedFrames);
+        }
+        ZeroMemory(&audio->perSourceGate[i], sizeof(audio->perSourceGate[i]));
         if (audio->perSourceEncoders[i]) {
             AACEncoder_Destroy(audio->perSourceEncoders[i]);
             audio->perSourceEncoders[i] = NULL;
         }
         if (audio->perSourceLocksInit[i]) {
             EnterCriticalSection(&audio->perSourceLocks[i]);
-            for (int j = 0; j < audio->perSourceSampleCount[i]; j++) {
-                if (audio->perSourceSamples[i][j].data) SAFE_FREE(audio->perSourceSamples[i][j].data);
-            }
-            SAFE_FREE(audio->perSourceSamples[i]);
-            audio->perSourceSampleCount[i] = 0;
-            audio->perSourceSampleCapacity[i] = 0;
+            InterlockedAdd64(&audio->storedBytes, -(LONG64)audio->perSourceSamples[i].usedBytes);
+            InterlockedAdd64(&audio->storedBytes, -(LONG64)audio->perSourcePcm[i].capacity);
+            AudioRing_Free(&audio->perSourceSamples[i]);
+            PcmRing_Free(&audio->perSourcePcm[i]);
             LeaveCriticalSection(&audio->perSourceLocks[i]);
+            audio->perSourceConfigData[i] = NULL;
+            audio->perSourceConfigSize[i] = 0;
             DeleteCriticalSection(&audio->perSourceLocks[i]);
             audio->perSourceLocksInit[i] = FALSE;
         }
@@ -856,6 +1273,77 @@ static void ShutdownAudioPipeline(ReplayAudioState* audio) {
     ReplayLog("Audio capture stopped\n");
 }
 
+/**
+ * Start a prepared audio pipeline. On failure the pipeline is torn down.
+ * 
+ * @param audio Audio state built by PrepareAudioPipeline
+ * @param t0    Shared QPC anchor — audio and video PTS must use the same wall-clock
+ *              origin or every save will be misaligned at the front edge.
+ * @return TRUE if audio is active
+ */
+static BOOL StartAudioPipeline(ReplayAudioState* audio, LARGE_INTEGER t0) {
+    if (!AudioCapture_StartAt(audio->capture, t0)) {
+        ReplayLog("AudioCapture_StartAt failed\n");
+        ShutdownAudioPipeline(audio);
+        return FALSE;
+    }
+    
+    AudioEncodeThread_Start(audio);
+    
+    ReplayLog("Audio capture started successfully\n");
+    return TRUE;
+}
+
+/* PrepareAudioPipeline on its own thread, so WASAPI enumeration and AAC
+ * MFT creation overlap GPU converter and NVENC session setup */
+typedef struct {
+    ReplayBufferState* state;
+    ReplayAudioState* audio;
+    AACEncoderError error;
+    BOOL prepared;
+    ULONGLONG elapsedMs;
+} AudioPrepJob;
+
+static DWORD WINAPI AudioPrepThreadProc(LPVOID param) {
+    AudioPrepJob* job = (AudioPrepJob*)param;
+    ULONGLONG startMs = GetTickCount64();
+    
+    /* Same apartment as the buffer thread, which keeps the MTA alive
+     * after this thread uninitializes */
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    job->prepared = PrepareAudioPipeline(job->state, job->audio, &job->error);
+    if (hrCom == S_OK || hrCom == S_FALSE) CoUninitialize();
+    
+    job->elapsedMs = GetTickCount64() - startMs;
+    return 0;
+}
+
+/**
+ * Turn on the converter's preview tap: one downscaled BGRA frame per GOP
+ * (long edge PREVIEW_TAP_SIZE) for the overlay preview and clip thumbnails.
+ * Non-fatal; without it the pipeline runs as before.
+ */
+static void StartPreviewTap(GPUConverter* gpuConverter, int width, int height, int fps) {
+    int previewWidth = width, previewHeight = height;
+    if (width >= height && width > PREVIEW_TAP_SIZE) {
+        previewWidth = PREVIEW_TAP_SIZE;
+        previewHeight = (int)((LONGLONG)height * PREVIEW_TAP_SIZE / width);
+    } else if (height > width && height > PREVIEW_TAP_SIZE) {
+        previewHeight = PREVIEW_TAP_SIZE;
+        previewWidth = (int)((LONGLONG)width * PREVIEW_TAP_SIZE / height);
+    }
+    previewWidth &= ~1;
+    previewHeight &= ~1;
+    if (previewWidth < 2 || previewHeight < 2) return;
+    
+    int gopFrames = GOP_LENGTH_FRAMES_AT(fps) > 0 ? GOP_LENGTH_FRAMES_AT(fps) : 1;
+    LONGLONG gopDuration = (LONGLONG)gopFrames * MF_UNITS_PER_SECOND / fps;
+    if (!GPUConverter_EnablePreview(gpuConverter, previewWidth, previewHeight, gopFrames)) return;
+    if (!PreviewTap_Start(previewWidth, previewHeight, gopDuration, g_config.replayDuration)) {
+        ReplayLog("Preview tap buffers unavailable - no live preview or clip thumbnails\n");
+    }
+}
+
 /**
  * Shutdown video pipeline and release resources.
  * 
@@ -863,12 +1351,14 @@ static void ShutdownAudioPipeline(ReplayAudioState* audio) {
  * @param gpuConverter GPU converter to shut down
  */
 static void ShutdownVideoPipeline(ReplayVideoState* video, GPUConverter* gpuConverter) {
+    PreviewTap_Stop();
     GPUConverter_Shutdown(gpuConverter);
 
     if (video->encoder) {
-        /* Sync NVENC path with frameIntervalP=1 produces output on every
-         * SubmitFrame call; nothing is queued to drain here. Destroy sends
-         * the EOS marker internally. */
+        /* Sync mode produces output on every Submit call. Async mode may
+         * have up to NUM_BUFFERS frames in flight; Destroy drains them into
+         * DrainCallback, so the FrameBuffer is shut down only afterwards.
+         * Destroy sends the EOS marker internally. */
         NVENCEncoder_Destroy(video->encoder);
         video->encoder = NULL;
     }
@@ -876,70 +1366,100 @@ static void ShutdownVideoPipeline(ReplayVideoState* video, GPUConverter* gpuConv
 }
 
 /**
- * Deep copy audio samples for muxing.
- * Creates independent copies of audio data that can be freed after muxing.
+ * Deep copy the samples of one track that overlap [fromTs, toTs).
+ * Samples are in PTS order, so the window is found by binary search and
+ * only in-window samples are touched. Creates independent copies of audio
+ * data that can be freed after muxing.
  * 
- * @param audio      Audio state to copy from (locked externally)
- * @param outCopy    Output array pointer
+ * @param src        Source ring (caller holds the track's lock)
+ * @param fromTs     Window start (absolute PTS, 100ns)
+ * @param toTs       Window end (exclusive)
+ * @param outCopy    Output array pointer (NULL if nothing copied)
  * @param outCount   Output sample count
  * @return TRUE if copy succeeded (may be 0 samples if none available)
  */
-static BOOL CopyAudioSamplesForMuxing(ReplayAudioState* audio, MuxerAudioSample** outCopy, int* outCount) {
+static BOOL CopyAudioWindow(const AudioRing* src, LONGLONG fromTs, LONGLONG toTs,
+                            MuxerAudioSample** outCopy, int* outCount) {
     *outCopy = NULL;
     *outCount = 0;
     
-    if (audio->sampleCount <= 0 || !audio->samples || 
-        !audio->configData || audio->configSize <= 0) {
-        return TRUE;  /* No audio - not an error */
+    /* First sample ending after fromTs */
+    int lo = 0, hi = src->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        const MuxerAudioSample* s = AudioRing_At(src, mid);
+        if (s->timestamp + s->duration <= fromTs) lo = mid + 1; else hi = mid;
     }
+    int first = lo;
     
-    int audioCount = audio->sampleCount;
-    
-    /* Overflow check */
-    size_t allocSize = (size_t)audioCount * sizeof(MuxerAudioSample);
-    if (allocSize / sizeof(MuxerAudioSample) != (size_t)audioCount) {
-        ReplayLog("WARNING: Audio allocation overflow, skipping audio\n");
-        return TRUE;
+    /* First sample starting at or after toTs */
+    hi = src->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (AudioRing_At(src, mid)->timestamp < toTs) lo = mid + 1; else hi = mid;
     }
+    int windowCount = lo - first;
+    if (windowCount <= 0) return TRUE;
     
-    MuxerAudioSample* audioCopy = (MuxerAudioSample*)malloc(allocSize);
-    if (!audioCopy) return TRUE;
-    
-    /* Zero-initialize to ensure safe cleanup on partial allocation failure */
-    memset(audioCopy, 0, allocSize);
+    MuxerAudioSample* copy = (MuxerAudioSample*)calloc((size_t)windowCount, sizeof(MuxerAudioSample));
+    if (!copy) return TRUE;  /* Continue without audio */
 
     /* PTS preserved as absolute (100ns since shared t0). AlignAudioToVideoWindow
      * later rebases against the video origin so audio and video share a front edge. */
-    int copiedCount = 0;
+    int copied = 0;
 
-    for (int i = 0; i < audioCount; i++) {
+    for (int i = first; i < first + windowCount; i++) {
+        const MuxerAudioSample* s = AudioRing_At(src, i);
         /* Defensive: skip zero-size or null entries (callback should already reject them) */
-        if (audio->samples[i].size <= 0 || !audio->samples[i].data) {
+        if (s->size <= 0 || !s->data) {
             continue;
         }
-        audioCopy[i].data = (BYTE*)malloc(audio->samples[i].size);
-        if (audioCopy[i].data) {
-            memcpy(audioCopy[i].data, audio->samples[i].data, audio->samples[i].size);
-            audioCopy[i].size = audio->samples[i].size;
-            audioCopy[i].timestamp = audio->samples[i].timestamp;
-            audioCopy[i].duration = audio->samples[i].duration;
-            copiedCount++;
-        } else {
+        copy[copied].data = (BYTE*)malloc(s->size);
+        if (!copy[copied].data) {
             /* malloc failed - free all previous copies and abort */
-            ReplayLog("WARNING: Audio copy malloc failed at sample %d/%d\n", i, audioCount);
-            for (int j = 0; j < i; j++) {
-                if (audioCopy[j].data) free(audioCopy[j].data);
+            ReplayLog("WARNING: Audio copy malloc failed at sample %d/%d\n", i - first, windowCount);
+            for (int j = 0; j < copied; j++) {
+                LEAK_TRACK_BYTES_FREE(LEAK_SITE_SAVE_AUDIO, copy[j].size);
+                free(copy[j].data);
             }
-            free(audioCopy);
+            free(copy);
             return TRUE;  /* Continue without audio */
         }
+        memcpy(copy[copied].data, s->data, s->size);
+        LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_SAVE_AUDIO, s->size);
+        copy[copied].size = s->size;
+        copy[copied].timestamp = s->timestamp;
+        copy[copied].duration = s->duration;
+        copied++;
     }
     
-    *outCopy = audioCopy;
-    *outCount = copiedCount;
+    *outCopy = copy;
+    *outCount = copied;
     return TRUE;
 }
 
+/**
+ * Deep copy the mixed-track samples overlapping [fromTs, toTs) for muxing.
+ * 
+ * @param audio      Audio state to copy from (locked externally)
+ * @param fromTs     Window start (absolute PTS, 100ns)
+ * @param toTs       Window end (exclusive)
+ * @param outCopy    Output array pointer
+ * @param outCount   Output sample count
+ * @return TRUE if copy succeeded (may be 0 samples if none available)
+ */
+static BOOL CopyAudioSamplesForMuxing(ReplayAudioState* audio, LONGLONG fromTs, LONGLONG toTs,
+                                      MuxerAudioSample** outCopy, int* outCount) {
+    *outCopy = NULL;
+    *outCount = 0;
+    
+    if (audio->samples.count <= 0 || !audio->configData || audio->configSize <= 0) {
+        return TRUE;  /* No audio - not an error */
+    }
+    
+    return CopyAudioWindow(&audio->samples, fromTs, toTs, outCopy, outCount);
+}
+
 /**
  * Free audio sample copies created by CopyAudioSamplesForMuxing.
  * 
@@ -949,7 +1469,10 @@ static BOOL CopyAudioSamplesForMuxing(ReplayAudioState* audio, MuxerAudioSample*
 static void FreeAudioSampleCopies(MuxerAudioSample* samples, int count) {
     if (!samples) return;
     for (int i = 0; i < count; i++) {
-        if (samples[i].data) free(samples[i].data);
+        if (samples[i].data) {
+            LEAK_TRACK_BYTES_FREE(LEAK_SITE_SAVE_AUDIO, samples[i].size);
+            free(samples[i].data);
+        }
     }
     free(samples);
 }
@@ -959,7 +1482,7 @@ static void FreeAudioSampleCopies(MuxerAudioSample* samples, int count) {
  *
  * Audio samples arrive carrying absolute PTS (100ns since the shared QPC t0
  * established at capture start). Video has been rebased to start at 0 inside
- * FrameBuffer_GetFramesForMuxing after skipping leading non-keyframes; the
+ * FrameBuffer_PinSnapshot after skipping leading non-keyframes; the
  * caller passes videoOriginTs (the absolute PTS of the first kept video
  * frame) so we can re-express audio in the same 0-based timebase and discard
  * any samples that fall outside the video window.
@@ -988,14 +1511,20 @@ static void AlignAudioToVideoWindow(MuxerAudioSample* audio, int* audioCount,
 
         if (relEnd <= 0) {
             /* Fully before video starts \u2014 free and drop. */
-            if (audio[i].data) free(audio[i].data);
+            if (audio[i].data) {
+                LEAK_TRACK_BYTES_FREE(LEAK_SITE_SAVE_AUDIO, audio[i].size);
+                free(audio[i].data);
+            }
             audio[i].data = NULL;
             droppedLeading++;
             continue;
         }
         if (relTs >= videoDuration) {
             /* Fully after video ends. */
-            if (audio[i].data) free(audio[i].data);
+            if (audio[i].data) {
+                LEAK_TRACK_BYTES_FREE(LEAK_SITE_SAVE_AUDIO, audio[i].size);
+                free(audio[i].data);
+            }
             audio[i].data = NULL;
             droppedTrailing++;
             continue;
@@ -1019,9 +1548,11 @@ static void AlignAudioToVideoWindow(MuxerAudioSample* audio, int* audioCount,
 }
 
 /**
- * Copy per-source audio samples for muxing (same pattern as CopyAudioSamplesForMuxing).
+ * Copy per-source audio samples overlapping [fromTs, toTs) for muxing
+ * (same pattern as CopyAudioSamplesForMuxing).
  */
 static BOOL CopyPerSourceSamplesForMuxing(ReplayAudioState* audio, int srcIdx,
+                                           LONGLONG fromTs, LONGLONG toTs,
                                            MuxerAudioSample** outCopy, int* outCount) {
     *outCopy = NULL;
     *outCount = 0;
@@ -1031,167 +1562,875 @@ static BOOL CopyPerSourceSamplesForMuxing(ReplayAudioState* audio, int srcIdx,
     
     EnterCriticalSection(&audio->perSourceLocks[srcIdx]);
     
-    int count = audio->perSourceSampleCount[srcIdx];
-    if (count <= 0 || !audio->perSourceSamples[srcIdx]) {
-        LeaveCriticalSection(&audio->perSourceLocks[srcIdx]);
-        return TRUE;
+    BOOL ok = TRUE;
+    if (audio->perSourceSamples[srcIdx].count > 0) {
+        ok = CopyAudioWindow(&audio->perSourceSamples[srcIdx], fromTs, toTs, outCopy, outCount);
     }
     
-    MuxerAudioSample* copy = (MuxerAudioSample*)malloc((size_t)count * sizeof(MuxerAudioSample));
-    if (!copy) {
-        LeaveCriticalSection(&audio->perSourceLocks[srcIdx]);
+    LeaveCriticalSection(&audio->perSourceLocks[srcIdx]);
+    return ok;
+}
+
+/**
+ * Copy a deferred per-source track's PCM overlapping [fromTs, toTs); it is
+ * encoded on the save worker (EncodeDeferredTracks).
+ */
+static BOOL CopyPerSourcePcmForMuxing(ReplayAudioState* audio, int srcIdx,
+                                      LONGLONG fromTs, LONGLONG toTs,
+                                      BYTE** outPcm, int* outSize, LONGLONG* outStartTs) {
+    *outPcm = NULL;
+    *outSize = 0;
+    *outStartTs = 0;
+    
+    if (srcIdx < 0 || srcIdx >= audio->perSourceCount) return TRUE;
+    if (!audio->perSourceLocksInit[srcIdx]) return TRUE;
+    
+    EnterCriticalSection(&audio->perSourceLocks[srcIdx]);
+    BOOL ok = PcmRing_CopyWindow(&audio->perSourcePcm[srcIdx], fromTs, toTs,
+                                 outPcm, outSize, outStartTs);
+    LeaveCriticalSection(&audio->perSourceLocks[srcIdx]);
+    return ok;
+}
+
+/**
+ * Resolve a save request's window to buffer PTS.
+ * Called on the buffer thread when it picks the request up.
+ * 
+ * @param request           Queued save request
+ * @param captureStartTime  QPC value buffer PTS are measured from
+ * @param perfFreq          QPC frequency
+ * @param window            [out] Resolved window
+ */
+static void ResolveSaveWindow(const ReplaySaveRequest* request, LARGE_INTEGER captureStartTime,
+                              LARGE_INTEGER perfFreq, ReplaySaveWindow* window) {
+    ZeroMemory(window, sizeof(*window));
+    if (request->secondsBack < 0) return;
+    
+    LONGLONG anchorTs = Util_QpcDeltaToHns(request->anchorQpc, captureStartTime, perfFreq);
+    window->ranged = TRUE;
+    window->startTs = anchorTs - (LONGLONG)request->secondsBack * MF_UNITS_PER_SECOND;
+    window->endTs = anchorTs + (LONGLONG)request->secondsAfter * MF_UNITS_PER_SECOND;
+    window->deadlineMs = GetTickCount64() + (ULONGLONG)request->secondsAfter * 1000 +
+                         REPLAY_RANGE_SAVE_GRACE_MS;
+}
+
+/* TRUE once every frame of the window is buffered (or waiting timed out) */
+static BOOL SaveWindowReady(FrameBuffer* buf, const ReplaySaveWindow* window) {
+    if (!window->ranged) return TRUE;
+    
+    LONGLONG newestTs = 0;
+    if (FrameBuffer_GetTimeBounds(buf, NULL, &newestTs) && newestTs >= window->endTs) {
         return TRUE;
     }
-    memset(copy, 0, (size_t)count * sizeof(MuxerAudioSample));
+    return GetTickCount64() >= window->deadlineMs;
+}
 
-    /* PTS preserved as absolute (100ns since shared t0); AlignAudioToVideoWindow rebases later. */
-    int copied = 0;
+/* Convert an absolute buffer PTS to the GetTickCount64 timeline (markers) */
+static ULONGLONG PtsToTickMs(LONGLONG pts, LARGE_INTEGER captureStartTime, LARGE_INTEGER perfFreq) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    LONGLONG nowPts = Util_QpcDeltaToHns(now, captureStartTime, perfFreq);
+    return (ULONGLONG)((LONGLONG)GetTickCount64() - (nowPts - pts) / 10000);
+}
 
-    for (int i = 0; i < count; i++) {
-        MuxerAudioSample* src = &audio->perSourceSamples[srcIdx][i];
-        if (src->size <= 0 || !src->data) {
-            continue;
-        }
-        copy[i].data = (BYTE*)malloc(src->size);
-        if (copy[i].data) {
-            memcpy(copy[i].data, src->data, src->size);
-            copy[i].size = src->size;
-            copy[i].timestamp = src->timestamp;
-            copy[i].duration = src->duration;
-            copied++;
-        } else {
-            for (int j = 0; j < i; j++) { if (copy[j].data) free(copy[j].data); }
-            free(copy);
-            LeaveCriticalSection(&audio->perSourceLocks[srcIdx]);
-            return TRUE;
-        }
+/*
+ * ReplaySaveJob - One save on its way to disk
+ * Created by the buffer thread when it picks up a request, filled in (video
+ * pin + audio copies) once the window is buffered, then muxed by the save
+ * worker. Owns the snapshot and copies. The sequence header and AAC config
+ * blobs it points at stay valid because the worker is stopped before the
+ * audio and video pipelines shut down.
+ */
+typedef struct {
+    ReplaySaveRequest request;
+    ReplaySaveWindow window;
+    FrameBufferSnapshot snapshot;
+    BOOL pinned;
+    MuxerConfig videoConfig;
+    MuxerAudioSample* audioCopies[1 + MAX_AUDIO_SOURCES];  /* Track 0 = mixed */
+    MuxerAudioTrack audioTracks[1 + MAX_AUDIO_SOURCES];
+    BYTE* pcmCopies[1 + MAX_AUDIO_SOURCES];        /* Deferred tracks, until encoded */
+    int pcmSizes[1 + MAX_AUDIO_SOURCES];
+    LONGLONG pcmStartTs[1 + MAX_AUDIO_SOURCES];
+    int audioTrackCount;                /* 0 = video-only */
+    ULONGLONG startMs;                  /* GetTickCount64 span of the clip */
+    ULONGLONG endMs;
+} ReplaySaveJob;
+
+/*
+ * Save worker: muxes queued jobs one at a time so the capture loop never
+ * waits on the disk. Started and stopped by BufferThreadProc; stopping
+ * writes every queued job first, because jobs pin FrameBuffer frames.
+ */
+static struct {
+    HANDLE thread;
+    HANDLE hJobSemaphore;               /* One count per queued job, +1 to stop */
+    SRWLOCK lock;                       /* Protects jobs/head/count/stopping */
+    ReplaySaveJob* jobs[REPLAY_SAVE_QUEUE_DEPTH];
+    int head;
+    int count;
+    BOOL stopping;
+    ReplayBufferState* state;
+    FrameBuffer* frameBuffer;
+} g_saveWorker = { NULL, NULL, SRWLOCK_INIT };
+
+/* Post a save's notifyMessage (if it asked for one). Any thread. */
+static void PostSaveResult(const ReplaySaveRequest* request, BOOL ok,
+                           ULONGLONG startMs, ULONGLONG endMs) {
+    if (!request->notifyWindow || !request->notifyMessage) return;
+    
+    ReplaySaveResult* result = (ReplaySaveResult*)calloc(1, sizeof(ReplaySaveResult));
+    if (result) {
+        strncpy(result->path, request->path, MAX_PATH - 1);
+        result->startMs = startMs;
+        result->endMs = endMs;
     }
-    
-    LeaveCriticalSection(&audio->perSourceLocks[srcIdx]);
-    
-    *outCopy = copy;
-    *outCount = copied;
-    return TRUE;
+    if (!PostMessage(request->notifyWindow, request->notifyMessage, (WPARAM)ok, (LPARAM)result)) {
+        SAFE_FREE(result);
+    }
+    ReplayLog("Posted save completion to hwnd=%p msg=%u success=%d\n",
+              (void*)request->notifyWindow, request->notifyMessage, ok);
 }
 
 /**
- * Handle save request - muxes buffered video and audio to file.
- * Called when save event is signaled during capture loop.
- * 
- * @param state      Replay buffer state with output path
- * @param video      Video state with sample buffer
- * @param audio      Audio state with samples
- * @return TRUE if save succeeded
+ * Report a finished (or failed) save: signal the completion event, post the
+ * request's notification, then release its queue slot. Any thread.
  */
-static BOOL HandleSaveRequest(ReplayBufferState* state, ReplayVideoState* video, 
-                               ReplayAudioState* audio) {
-    BOOL ok = FALSE;
-    MuxerAudioSample* audioCopy = NULL;
-    int audioCount = 0;
+static void NotifySaveDone(ReplayBufferState* state, const ReplaySaveRequest* request, BOOL ok,
+                           ULONGLONG startMs, ULONGLONG endMs) {
+    InterlockedExchange(&state->saveSuccess, ok);
     
-    /* Copy mixed audio samples while holding lock */
-    EnterCriticalSection(&audio->lock);
-    CopyAudioSamplesForMuxing(audio, &audioCopy, &audioCount);
-    LeaveCriticalSection(&audio->lock);
+    /* Signal completion event (for sync API) */
+    SetEvent(state->hSaveCompleteEvent);
     
-    /* Copy per-source audio samples */
-    MuxerAudioSample* perSourceCopies[MAX_AUDIO_SOURCES] = {0};
-    int perSourceCounts[MAX_AUDIO_SOURCES] = {0};
-    for (int i = 0; i < audio->perSourceCount; i++) {
-        CopyPerSourceSamplesForMuxing(audio, i, &perSourceCopies[i], &perSourceCounts[i]);
+    PostSaveResult(request, ok, startMs, endMs);
+    
+    /* Release the slot only once the notification is out, so a full queue
+     * never outruns its own completions. */
+    InterlockedDecrement(&state->savePending);
+}
+
+/* Unpin, free the copies and the job, and notify. Any thread. */
+static void FinishSaveJob(ReplaySaveJob* job, FrameBuffer* frameBuffer,
+                          ReplayBufferState* state, BOOL ok) {
+    if (job->pinned) FrameBuffer_ReleaseSnapshot(frameBuffer, &job->snapshot);
+    for (int i = 0; i < job->audioTrackCount; i++) {
+        FreeAudioSampleCopies(job->audioCopies[i], job->audioTracks[i].sampleCount);
+        if (job->pcmCopies[i]) LEAK_TRACK_BYTES_FREE(LEAK_SITE_SAVE_PCM, job->pcmSizes[i]);
+        SAFE_FREE(job->pcmCopies[i]);
+    }
+    
+    ReplayLog("SAVE %s: %s\n", ok ? "OK" : "FAILED", job->request.path);
+    NotifySaveDone(state, &job->request, ok, job->startMs, job->endMs);
+    free(job);
+}
+
+/* Copy and alignment of every audio track of one save, run in parallel:
+ * each track has its own lock and output slot, so tracks never contend. */
+typedef struct {
+    ReplayAudioState* audio;
+    LONGLONG fromTs;
+    LONGLONG toTs;
+    LONGLONG videoOriginTs;
+    LONGLONG videoDuration;
+    MuxerAudioSample** copies;      /* job->audioCopies, track 0 = mixed */
+    int counts[1 + MAX_AUDIO_SOURCES];
+    ReplaySaveJob* job;             /* Deferred tracks copy PCM into it */
+} AudioPrepJob;
+
+static void PrepareAudioTrack(void* context, int track) {
+    AudioPrepJob* prep = (AudioPrepJob*)context;
+    ReplayAudioState* audio = prep->audio;
+    
+    if (track == 0) {
+        EnterCriticalSection(&audio->lock);
+        CopyAudioSamplesForMuxing(audio, prep->fromTs, prep->toTs, &prep->copies[0], &prep->counts[0]);
+        LeaveCriticalSection(&audio->lock);
+    } else if (audio->perSourcePcm[track - 1].data) {
+        /* Encoded and aligned on the save worker */
+        CopyPerSourcePcmForMuxing(audio, track - 1, prep->fromTs, prep->toTs,
+                                  &prep->job->pcmCopies[track], &prep->job->pcmSizes[track],
+                                  &prep->job->pcmStartTs[track]);
+        return;
+    } else {
+        CopyPerSourceSamplesForMuxing(audio, track - 1, prep->fromTs, prep->toTs,
+                                      &prep->copies[track], &prep->counts[track]);
     }
     
-    /* Get video samples \u2014 videoOriginTs is the absolute (shared-t0) PTS of the
-     * first kept video frame. Audio is aligned against this so all tracks
-     * start at exactly the same wall-clock instant. */
-    MuxerSample* videoSamples = NULL;
-    int videoCount = 0;
-    LONGLONG videoOriginTs = 0;
+    /* Align the track to the shared video window. */
+    if (prep->copies[track] && prep->counts[track] > 0 && prep->videoDuration > 0) {
+        char label[32];
+        if (track == 0) snprintf(label, sizeof(label), "Mixed audio");
+        else snprintf(label, sizeof(label), "Source %d audio", track - 1);
+        AlignAudioToVideoWindow(prep->copies[track], &prep->counts[track],
+                                prep->videoOriginTs, prep->videoDuration, label);
+    }
+}
 
-    if (!FrameBuffer_GetFramesForMuxing(&video->frameBuffer, &videoSamples, &videoCount, &videoOriginTs)) {
-        ReplayLog("  FrameBuffer_GetFramesForMuxing failed\n");
-        FreeAudioSampleCopies(audioCopy, audioCount);
-        for (int i = 0; i < audio->perSourceCount; i++) FreeAudioSampleCopies(perSourceCopies[i], perSourceCounts[i]);
+/**
+ * Pin the job's video and copy the audio it needs. Buffer thread only.
+ * 
+ * Video is pinned first so the audio copies can be limited to the pinned
+ * video span; a partial save copies only the audio it writes. The audio
+ * tracks are copied and aligned in parallel (Parallel_For, one item per
+ * track). Both steps are bounded by clip length and do no I/O. Deferred
+ * per-source tracks copy PCM only; WriteSaveJob encodes them.
+ * 
+ * @return TRUE if the job is ready for WriteSaveJob
+ */
+static BOOL PrepareSaveJob(ReplaySaveJob* job, ReplayVideoState* video, ReplayAudioState* audio,
+                           LARGE_INTEGER captureStartTime, LARGE_INTEGER perfFreq) {
+    ReplaySaveWindow* window = &job->window;
+    
+    /* Pin video samples (no copy). videoOriginTs is the absolute (shared-t0)
+     * PTS of the first kept video frame. Audio is aligned against this so all
+     * tracks start at exactly the same wall-clock instant. */
+    job->pinned = window->ranged
+        ? FrameBuffer_GetRange(&video->frameBuffer, window->startTs, window->endTs, &job->snapshot)
+        : FrameBuffer_PinSnapshot(&video->frameBuffer, &job->snapshot);
+    if (!job->pinned) {
+        ReplayLog("  FrameBuffer_%s failed\n", window->ranged ? "GetRange" : "PinSnapshot");
         return FALSE;
     }
+    const MuxerSample* videoSamples = job->snapshot.samples;
+    int videoCount = job->snapshot.count;
+    LONGLONG videoOriginTs = job->snapshot.originTimestamp;
+    
+    LONGLONG videoDuration = 0;
+    if (videoSamples && videoCount > 0) {
+        videoDuration = videoSamples[videoCount - 1].timestamp + videoSamples[videoCount - 1].duration;
+    }
+    window->savedStartTs = videoOriginTs;
+    window->savedEndTs = videoOriginTs + videoDuration;
+    job->startMs = PtsToTickMs(window->savedStartTs, captureStartTime, perfFreq);
+    job->endMs = PtsToTickMs(window->savedEndTs, captureStartTime, perfFreq);
     
     /* Build video config */
-    MuxerConfig videoConfig;
-    videoConfig.width = video->frameBuffer.width;
-    videoConfig.height = video->frameBuffer.height;
-    videoConfig.fps = video->frameBuffer.fps;
-    videoConfig.quality = video->frameBuffer.quality;
+    job->videoConfig.width = video->frameBuffer.width;
+    job->videoConfig.height = video->frameBuffer.height;
+    job->videoConfig.fps = video->frameBuffer.fps;
+    job->videoConfig.quality = video->frameBuffer.quality;
     /* seqHeader/seqHeaderSize are write-once (set during StartCapture before any save
      * can fire); lock-free read here is safe. See FrameBuffer_SetSequenceHeader. */
-    videoConfig.seqHeader = video->frameBuffer.seqHeaderSize > 0 ? video->frameBuffer.seqHeader : NULL;
-    videoConfig.seqHeaderSize = video->frameBuffer.seqHeaderSize;
+    job->videoConfig.seqHeader = video->frameBuffer.seqHeaderSize > 0 ? video->frameBuffer.seqHeader : NULL;
+    job->videoConfig.seqHeaderSize = video->frameBuffer.seqHeaderSize;
+    job->videoConfig.codec = video->frameBuffer.codec;
+    
+    /* Copy the audio in the video span and align it, all tracks at once */
+    AudioPrepJob prep;
+    ZeroMemory(&prep, sizeof(prep));
+    prep.audio = audio;
+    prep.fromTs = window->savedStartTs;
+    prep.toTs = window->savedEndTs;
+    prep.videoOriginTs = videoOriginTs;
+    prep.videoDuration = videoDuration;
+    prep.copies = job->audioCopies;
+    prep.job = job;
+    Parallel_For(1 + audio->perSourceCount, PrepareAudioTrack, &prep);
+    int audioCount = prep.counts[0];
+    const int* perSourceCounts = &prep.counts[1];
+    
+    /* Build multi-track audio array: track 0 = mixed, tracks 1..N = per-source.
+     * Tracks are kept (for freeing) even when video-only muxing is chosen. */
+    job->audioTrackCount = 1 + audio->perSourceCount;
     
-    /* Align each audio track to the shared video window. */
-    LONGLONG videoDuration = 0;
-    if (videoSamples && videoCount > 0) {
-        videoDuration = videoSamples[videoCount - 1].timestamp + videoSamples[videoCount - 1].duration;
+    /* Track 0: mixed */
+    job->audioTracks[0].samples = job->audioCopies[0];
+    job->audioTracks[0].sampleCount = audioCount;
+    job->audioTracks[0].config.sampleRate = AAC_SAMPLE_RATE;
+    job->audioTracks[0].config.channels = AAC_CHANNELS;
+    job->audioTracks[0].config.bitrate = AAC_BITRATE;
+    job->audioTracks[0].config.configData = audio->configData;
+    job->audioTracks[0].config.configSize = audio->configSize;
+    
+    /* Tracks 1..N: per-source */
+    for (int i = 0; i < audio->perSourceCount; i++) {
+        job->audioTracks[1 + i].samples = job->audioCopies[1 + i];
+        job->audioTracks[1 + i].sampleCount = perSourceCounts[i];
+        job->audioTracks[1 + i].config.sampleRate = AAC_SAMPLE_RATE;
+        job->audioTracks[1 + i].config.channels = AAC_CHANNELS;
+        job->audioTracks[1 + i].config.bitrate = AAC_BITRATE;
+        job->audioTracks[1 + i].config.configData = audio->perSourceConfigData[i];
+        job->audioTracks[1 + i].config.configSize = audio->perSourceConfigSize[i];
     }
+    
+    return TRUE;
+}
+
+/*
+ * Deferred per-source tracks (DeferredSourceAudio): the PCM copied at
+ * prepare time is encoded here, off the buffer thread, with one temporary
+ * encoder per track and all tracks at once (Parallel_For). The frames come
+ * out on the same grid and timestamps a live encoder would have produced.
+ */
+typedef struct {
+    MuxerAudioSample* samples;
+    int count;
+    int capacity;
+} DeferredTrackOutput;
 
-    if (audioCopy && audioCount > 0 && videoDuration > 0) {
-        AlignAudioToVideoWindow(audioCopy, &audioCount, videoOriginTs, videoDuration, "Mixed audio");
+static void CollectDeferredSample(const AACSample* sample, void* userData) {
+    DeferredTrackOutput* out = (DeferredTrackOutput*)userData;
+    
+    if (out->count >= out->capacity) {
+        int grown = out->capacity * 2 + 16;
+        MuxerAudioSample* resized = (MuxerAudioSample*)realloc(out->samples, (size_t)grown * sizeof(MuxerAudioSample));
+        if (!resized) return;
+        out->samples = resized;
+        out->capacity = grown;
     }
-    for (int i = 0; i < audio->perSourceCount; i++) {
-        if (perSourceCopies[i] && perSourceCounts[i] > 0 && videoDuration > 0) {
-            char label[32];
-            snprintf(label, sizeof(label), "Source %d audio", i);
-            AlignAudioToVideoWindow(perSourceCopies[i], &perSourceCounts[i], videoOriginTs, videoDuration, label);
-        }
+    
+    BYTE* data = (BYTE*)malloc((size_t)sample->size);
+    if (!data) return;
+    memcpy(data, sample->data, (size_t)sample->size);
+    LEAK_TRACK_BYTES_ALLOC(LEAK_SITE_SAVE_AUDIO, sample->size);
+    
+    MuxerAudioSample* dst = &out->samples[out->count++];
+    dst->data = data;
+    dst->size = (DWORD)sample->size;
+    dst->timestamp = sample->timestamp;
+    dst->duration = sample->duration;
+}
+
+static void EncodeDeferredTrack(void* context, int track) {
+    ReplaySaveJob* job = (ReplaySaveJob*)context;
+    if (!job->pcmCopies[track]) return;
+    
+    /* Pool threads: the MFT needs COM here */
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    BOOL coInitialized = (hrCom == S_OK || hrCom == S_FALSE);
+    
+    DeferredTrackOutput out = {0};
+    out.capacity = job->pcmSizes[track] / (AAC_SAMPLES_PER_FRAME * AUDIO_BLOCK_ALIGN) + 2;
+    out.samples = (MuxerAudioSample*)calloc((size_t)out.capacity, sizeof(MuxerAudioSample));
+    
+    AACEncoderError err = AAC_OK;
+    AACEncoder* encoder = out.samples ? AACEncoder_CreateEx(&err) : NULL;
+    if (encoder) {
+        AACEncoder_SetCallback(encoder, CollectDeferredSample, &out);
+        AACEncoder_Feed(encoder, job->pcmCopies[track], job->pcmSizes[track], job->pcmStartTs[track]);
+        AACEncoder_Drain(encoder);
+        AACEncoder_Destroy(encoder);
+    } else {
+        ReplayLog("  Source %d deferred encode failed (error=%d) - track will be empty\n", track - 1, (int)err);
     }
     
-    /* Build multi-track audio array: track 0 = mixed, tracks 1..N = per-source */
-    int totalTracks = 1 + audio->perSourceCount; /* mixed + per-source */
-    MuxerAudioTrack audioTracks[1 + MAX_AUDIO_SOURCES] = {0};
+    if (coInitialized) CoUninitialize();
+    LEAK_TRACK_BYTES_FREE(LEAK_SITE_SAVE_PCM, job->pcmSizes[track]);
+    SAFE_FREE(job->pcmCopies[track]);
     
-    /* Track 0: mixed */
-    audioTracks[0].samples = audioCopy;
-    audioTracks[0].sampleCount = audioCount;
-    audioTracks[0].config.sampleRate = AAC_SAMPLE_RATE;
-    audioTracks[0].config.channels = AAC_CHANNELS;
-    audioTracks[0].config.bitrate = AAC_BITRATE;
-    audioTracks[0].config.configData = audio->configData;
-    audioTracks[0].config.configSize = audio->configSize;
+    char label[32];
+    snprintf(label, sizeof(label), "Source %d audio", track - 1);
+    AlignAudioToVideoWindow(out.samples, &out.count, job->window.savedStartTs,
+                            job->window.savedEndTs - job->window.savedStartTs, label);
     
-    /* Tracks 1..N: per-source */
-    for (int i = 0; i < audio->perSourceCount; i++) {
-        audioTracks[1 + i].samples = perSourceCopies[i];
-        audioTracks[1 + i].sampleCount = perSourceCounts[i];
-        audioTracks[1 + i].config.sampleRate = AAC_SAMPLE_RATE;
-        audioTracks[1 + i].config.channels = AAC_CHANNELS;
-        audioTracks[1 + i].config.bitrate = AAC_BITRATE;
-        audioTracks[1 + i].config.configData = audio->perSourceConfigData[i];
-        audioTracks[1 + i].config.configSize = audio->perSourceConfigSize[i];
-    }
-    
-    /* Mux to file */
-    if (audioCopy && audioCount > 0) {
-        ReplayLog("  Starting save (%d audio tracks, %d mixed samples)...\n", totalTracks, audioCount);
-        ok = MP4Muxer_WriteFileWithMultiAudio(state->savePath,
-                                               videoSamples, videoCount, &videoConfig,
-                                               audioTracks, totalTracks);
+    job->audioCopies[track] = out.samples;
+    job->audioTracks[track].samples = out.samples;
+    job->audioTracks[track].sampleCount = out.count;
+}
+
+static void EncodeDeferredTracks(ReplaySaveJob* job) {
+    int deferred = 0;
+    for (int i = 1; i < job->audioTrackCount; i++) {
+        if (job->pcmCopies[i]) deferred++;
+    }
+    if (deferred == 0) return;
+    
+    ULONGLONG startMs = GetTickCount64();
+    Parallel_For(job->audioTrackCount, EncodeDeferredTrack, job);
+    ReplayLog("  Encoded %d deferred source track(s) in %llums\n", deferred, GetTickCount64() - startMs);
+}
+
+/* Mux a prepared job to its file */
+static BOOL MuxSaveJob(ReplaySaveJob* job) {
+    EncodeDeferredTracks(job);
+    
+    const MuxerSample* videoSamples = job->snapshot.samples;
+    int videoCount = job->snapshot.count;
+    int mixedCount = job->audioTracks[0].sampleCount;
+    
+    BOOL withAudio = job->audioCopies[0] && mixedCount > 0;
+    
+    if (g_config.nativeMuxer) {
+        /* Poster and per-GOP thumbnails from the preview tap (native writer only) */
+        MuxerConfig videoConfig = job->videoConfig;
+        PreviewArtwork artwork = {0};
+        if (g_config.clipThumbnails &&
+            PreviewTap_BuildArtwork(videoSamples, videoCount, job->snapshot.originTimestamp, &artwork)) {
+            videoConfig.poster = artwork.poster.data ? &artwork.poster : NULL;
+            videoConfig.thumbnails = artwork.thumbnails;
+            videoConfig.thumbnailCount = artwork.thumbnailCount;
+        }
+        ReplayLog("  Starting save (native writer, %d audio tracks)...\n",
+                  withAudio ? job->audioTrackCount : 0);
+        BOOL written = MP4Writer_WriteFile(job->request.path, videoSamples, videoCount, &videoConfig,
+                                           withAudio ? job->audioTracks : NULL,
+                                           withAudio ? job->audioTrackCount : 0);
+        PreviewTap_FreeArtwork(&artwork);
+        if (written) return TRUE;
+        ReplayLog("  Native writer failed, retrying with Media Foundation\n");
+    }
+    
+    BOOL ok;
+    if (withAudio) {
+        ReplayLog("  Starting save (%d audio tracks, %d mixed samples)...\n", job->audioTrackCount, mixedCount);
+        ok = MP4Muxer_WriteFileWithMultiAudio(job->request.path,
+                                               videoSamples, videoCount, &job->videoConfig,
+                                               job->audioTracks, job->audioTrackCount);
     } else {
         ReplayLog("  Starting save (video-only path)...\n");
-        ok = MP4Muxer_WriteFile(state->savePath, videoSamples, videoCount, &videoConfig);
+        ok = MP4Muxer_WriteFile(job->request.path, videoSamples, videoCount, &job->videoConfig);
+    }
+    return ok;
+}
+
+/* Write a prepared job. Save worker (or buffer thread fallback). */
+static BOOL WriteSaveJob(ReplaySaveJob* job) {
+    int videoCount = job->snapshot.count;
+    LONGLONG lastTimestamp = videoCount > 0 ? job->snapshot.samples[videoCount - 1].timestamp : 0;
+    TraceActivity trace;
+    TRACE_STAGE_START(&trace, TRACE_STAGE_SAVE_WRITE, videoCount, lastTimestamp);
+    BOOL ok = MuxSaveJob(job);
+    TRACE_STAGE_STOP(&trace, videoCount, lastTimestamp);
+    return ok;
+}
+
+static DWORD WINAPI SaveWorkerProc(LPVOID param) {
+    (void)param;
+    
+    /* Media Foundation sink writer needs COM on this thread (same rules as
+     * BufferThreadProc: only uninitialize a reference we took). */
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hrCom) && hrCom != RPC_E_CHANGED_MODE) {
+        ReplayLog("SaveWorker: CoInitializeEx failed (0x%08X)\n", hrCom);
+    }
+    BOOL coInitialized = (hrCom == S_OK || hrCom == S_FALSE);
+    
+    for (;;) {
+        WaitForSingleObject(g_saveWorker.hJobSemaphore, INFINITE);
+        
+        ReplaySaveJob* job = NULL;
+        AcquireSRWLockExclusive(&g_saveWorker.lock);
+        if (g_saveWorker.count > 0) {
+            job = g_saveWorker.jobs[g_saveWorker.head];
+            g_saveWorker.head = (g_saveWorker.head + 1) % REPLAY_SAVE_QUEUE_DEPTH;
+            g_saveWorker.count--;
+        }
+        BOOL stopping = g_saveWorker.stopping;
+        ReleaseSRWLockExclusive(&g_saveWorker.lock);
+        
+        if (!job) {
+            if (stopping) break;
+            continue;
+        }
+        
+        BOOL ok = WriteSaveJob(job);
+        FinishSaveJob(job, g_saveWorker.frameBuffer, g_saveWorker.state, ok);
+    }
+    
+    if (coInitialized) CoUninitialize();
+    return 0;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: SaveWorker_Start
+ * Resources: 2 - job semaphore, worker thread
+ * Pattern: semaphore closed if the thread cannot be created
+ *
+ * On failure the worker stays stopped and SaveWorker_Submit writes jobs
+ * inline on the buffer thread (the pre-worker behaviour).
+ */
+static BOOL SaveWorker_Start(ReplayBufferState* state, FrameBuffer* frameBuffer) {
+    g_saveWorker.head = 0;
+    g_saveWorker.count = 0;
+    g_saveWorker.stopping = FALSE;
+    g_saveWorker.state = state;
+    g_saveWorker.frameBuffer = frameBuffer;
+    
+    g_saveWorker.hJobSemaphore = CreateSemaphore(NULL, 0, REPLAY_SAVE_QUEUE_DEPTH + 1, NULL);
+    if (!g_saveWorker.hJobSemaphore) {
+        ReplayLog("SaveWorker: CreateSemaphore failed (%lu), saving inline\n", GetLastError());
+        return FALSE;
+    }
+    
+    g_saveWorker.thread = CreateThread(NULL, 0, SaveWorkerProc, NULL, 0, NULL);
+    if (!g_saveWorker.thread) {
+        ReplayLog("SaveWorker: CreateThread failed (%lu), saving inline\n", GetLastError());
+        SAFE_CLOSE_HANDLE(g_saveWorker.hJobSemaphore);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Hand a prepared job to the worker (takes ownership). Buffer thread only. */
+static void SaveWorker_Submit(ReplaySaveJob* job) {
+    if (!g_saveWorker.thread) {
+        BOOL ok = WriteSaveJob(job);
+        FinishSaveJob(job, g_saveWorker.frameBuffer, g_saveWorker.state, ok);
+        return;
+    }
+    
+    /* Never full: jobs <= savePending <= REPLAY_SAVE_QUEUE_DEPTH */
+    AcquireSRWLockExclusive(&g_saveWorker.lock);
+    LWSR_ASSERT(g_saveWorker.count < REPLAY_SAVE_QUEUE_DEPTH);
+    g_saveWorker.jobs[(g_saveWorker.head + g_saveWorker.count) % REPLAY_SAVE_QUEUE_DEPTH] = job;
+    g_saveWorker.count++;
+    ReleaseSRWLockExclusive(&g_saveWorker.lock);
+    
+    ReleaseSemaphore(g_saveWorker.hJobSemaphore, 1, NULL);
+}
+
+/* Write every queued job, then stop the worker. Buffer thread only. */
+static void SaveWorker_Stop(void) {
+    if (g_saveWorker.thread) {
+        AcquireSRWLockExclusive(&g_saveWorker.lock);
+        g_saveWorker.stopping = TRUE;
+        ReleaseSRWLockExclusive(&g_saveWorker.lock);
+        ReleaseSemaphore(g_saveWorker.hJobSemaphore, 1, NULL);
+        
+        /* No timeout: queued jobs pin frames the FrameBuffer frees next */
+        WaitForSingleObject(g_saveWorker.thread, INFINITE);
+        SAFE_CLOSE_HANDLE(g_saveWorker.thread);
+    }
+    SAFE_CLOSE_HANDLE(g_saveWorker.hJobSemaphore);
+}
+
+/*
+ * Continuous save writer: muxes the whole buffer, then every PASS pins the
+ * frames added since the previous one (FrameBuffer_PinFrom), copies the
+ * mixed audio up to their end and appends both, interleaved, to one
+ * StreamingMuxer. New frames wait in the FrameBuffer between passes, so the
+ * encoder callbacks are untouched. Started by the buffer thread; the
+ * FrameBuffer, audio rings and AAC config outlive it (ContinuousSave_Stop
+ * runs before the pipelines shut down).
+ */
+static struct {
+    HANDLE thread;
+    ReplayBufferState* state;
+    FrameBuffer* frameBuffer;
+    ReplayAudioState* audio;            /* NULL = video-only */
+    ReplaySaveRequest request;
+    LARGE_INTEGER captureStartTime;
+    LARGE_INTEGER perfFreq;
+} g_continuous;
+
+/* Writer progress (all PTS absolute, 100ns since the shared t0) */
+typedef struct {
+    BOOL started;
+    UINT64 nextSeq;                     /* First frame not yet written */
+    LONGLONG originTs;                  /* PTS of the file's first IDR = file time 0 */
+    LONGLONG audioFromTs;               /* End of the last audio sample written */
+    LONGLONG videoEndTs;                /* End of the last frame pinned */
+    BOOL needKeyframe;                  /* Frames were lost: skip to the next IDR */
+    int videoWritten;
+    int audioWritten;
+    int lostFrames;
+    int skippedFrames;
+    int writeFailures;
+} ContinuousCursor;
+
+/* One pass: append everything buffered since the last one. Writer thread. */
+static void ContinuousAppend(StreamingMuxer* muxer, ContinuousCursor* cursor) {
+    FrameBuffer* frameBuffer = g_continuous.frameBuffer;
+    FrameBufferSnapshot snap;
+    int lost = 0;
+    BOOL pinned = cursor->started
+        ? FrameBuffer_PinFrom(frameBuffer, cursor->nextSeq, &snap, &lost)
+        : FrameBuffer_PinSnapshot(frameBuffer, &snap);
+    if (lost > 0) {
+        cursor->lostFrames += lost;
+        cursor->needKeyframe = TRUE;
+        ReplayLog("Continuous save: %d frames evicted before they were written, "
+                  "resuming at the next IDR\n", lost);
+    }
+    if (!pinned) {
+        if (cursor->started) cursor->nextSeq = snap.nextSeq;
+        return;
+    }
+    if (snap.count == 0) {
+        cursor->nextSeq = snap.nextSeq;
+        FrameBuffer_ReleaseSnapshot(frameBuffer, &snap);
+        return;
+    }
+    
+    if (!cursor->started) {
+        cursor->started = TRUE;
+        cursor->originTs = snap.originTimestamp;
+        cursor->audioFromTs = snap.originTimestamp;
+    }
+    
+    /* Snapshot PTS are relative to its own origin; file PTS to the first one */
+    LONGLONG videoOffset = snap.originTimestamp - cursor->originTs;
+    const MuxerSample* lastFrame = &snap.samples[snap.count - 1];
+    LONGLONG videoEndTs = snap.originTimestamp + lastFrame->timestamp + lastFrame->duration;
+    
+    MuxerAudioSample* audioCopy = NULL;
+    int audioCount = 0;
+    if (g_continuous.audio) {
+        EnterCriticalSection(&g_continuous.audio->lock);
+        CopyAudioSamplesForMuxing(g_continuous.audio, cursor->audioFromTs, videoEndTs,
+                                  &audioCopy, &audioCount);
+        LeaveCriticalSection(&g_continuous.audio->lock);
     }
     
-    /* Free video samples */
-    for (int i = 0; i < videoCount; i++) {
-        if (videoSamples[i].data) free(videoSamples[i].data);
+    /* Interleave by file PTS. Audio straddling the file's front edge is
+     * clamped to 0, as AlignAudioToVideoWindow does for clips. */
+    int v = 0, a = 0;
+    while (v < snap.count || a < audioCount) {
+        LONGLONG videoTs = v < snap.count ? snap.samples[v].timestamp + videoOffset : MAXLONGLONG;
+        LONGLONG audioTs = MAXLONGLONG;
+        if (a < audioCount) {
+            audioTs = audioCopy[a].timestamp - cursor->originTs;
+            if (audioTs < 0) audioTs = 0;
+        }
+        
+        if (videoTs <= audioTs) {
+            MuxerSample sample = snap.samples[v++];
+            if (cursor->needKeyframe && !sample.isKeyframe) {
+                cursor->skippedFrames++;
+                continue;
+            }
+            cursor->needKeyframe = FALSE;
+            sample.timestamp = videoTs;
+            if (StreamingMuxer_WriteVideo(muxer, &sample)) cursor->videoWritten++;
+            else cursor->writeFailures++;
+        } else {
+            MuxerAudioSample sample = audioCopy[a++];
+            sample.timestamp = audioTs;
+            if (StreamingMuxer_WriteAudio(muxer, &sample)) cursor->audioWritten++;
+            else cursor->writeFailures++;
+        }
     }
-    free(videoSamples);
     
-    /* Free audio copies */
+    if (audioCount > 0) {
+        cursor->audioFromTs = audioCopy[audioCount - 1].timestamp + audioCopy[audioCount - 1].duration;
+    }
     FreeAudioSampleCopies(audioCopy, audioCount);
-    for (int i = 0; i < audio->perSourceCount; i++) {
-        FreeAudioSampleCopies(perSourceCopies[i], perSourceCounts[i]);
+    cursor->videoEndTs = videoEndTs;
+    cursor->nextSeq = snap.nextSeq;
+    FrameBuffer_ReleaseSnapshot(frameBuffer, &snap);
+}
+
+static DWORD WINAPI ContinuousSaveProc(LPVOID param) {
+    (void)param;
+    ReplayBufferState* state = g_continuous.state;
+    FrameBuffer* frameBuffer = g_continuous.frameBuffer;
+    ReplayAudioState* audio = g_continuous.audio;
+    
+    /* Same COM rules as SaveWorkerProc */
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    if (FAILED(hrCom) && hrCom != RPC_E_CHANGED_MODE) {
+        ReplayLog("ContinuousSave: CoInitializeEx failed (0x%08X)\n", hrCom);
     }
+    BOOL coInitialized = (hrCom == S_OK || hrCom == S_FALSE);
     
-    ReplayLog("SAVE %s\n", ok ? "OK" : "FAILED");
-    return ok;
+    MuxerConfig videoConfig;
+    ZeroMemory(&videoConfig, sizeof(videoConfig));
+    videoConfig.width = frameBuffer->width;
+    videoConfig.height = frameBuffer->height;
+    videoConfig.fps = frameBuffer->fps;
+    videoConfig.quality = frameBuffer->quality;
+    videoConfig.seqHeader = frameBuffer->seqHeaderSize > 0 ? frameBuffer->seqHeader : NULL;
+    videoConfig.seqHeaderSize = frameBuffer->seqHeaderSize;
+    videoConfig.codec = frameBuffer->codec;
+    videoConfig.fragmented = g_config.fragmentedRecording;
+    
+    StreamingMuxer* muxer = NULL;
+    if (audio) {
+        MuxerAudioConfig audioConfig;
+        audioConfig.sampleRate = AAC_SAMPLE_RATE;
+        audioConfig.channels = AAC_CHANNELS;
+        audioConfig.bitrate = AAC_BITRATE;
+        audioConfig.configData = audio->configData;
+        audioConfig.configSize = audio->configSize;
+        muxer = StreamingMuxer_CreateWithAudio(g_continuous.request.path, &videoConfig, &audioConfig);
+    } else {
+        muxer = StreamingMuxer_Create(g_continuous.request.path, &videoConfig);
+    }
+    
+    ContinuousCursor cursor;
+    ZeroMemory(&cursor, sizeof(cursor));
+    BOOL ok = FALSE;
+    if (muxer) {
+        /* Read the state before each pass so the last one, after End, picks
+         * up every frame buffered by then */
+        for (;;) {
+            BOOL stopping = InterlockedCompareExchange(&state->continuousState, 0, 0) !=
+                            REPLAY_CONTINUOUS_ACTIVE;
+            ContinuousAppend(muxer, &cursor);
+            if (stopping) break;
+            WaitForSingleObject(state->hContinuousWakeEvent, REPLAY_CONTINUOUS_POLL_MS);
+        }
+        ok = StreamingMuxer_Close(muxer) && cursor.videoWritten > 0;
+    } else {
+        ReplayLog("ContinuousSave: StreamingMuxer creation failed for %s\n", g_continuous.request.path);
+    }
+    
+    ReplayLog("CONTINUOUS SAVE %s: %s (%d frames, %d audio samples, %d lost, %d skipped, "
+              "%d write failures)\n", ok ? "OK" : "FAILED", g_continuous.request.path,
+              cursor.videoWritten, cursor.audioWritten, cursor.lostFrames, cursor.skippedFrames,
+              cursor.writeFailures);
+    ULONGLONG startMs = 0, endMs = 0;
+    if (ok) {
+        startMs = PtsToTickMs(cursor.originTs, g_continuous.captureStartTime, g_continuous.perfFreq);
+        endMs = PtsToTickMs(cursor.videoEndTs, g_continuous.captureStartTime, g_continuous.perfFreq);
+    }
+    PostSaveResult(&g_continuous.request, ok, startMs, endMs);
+    
+    if (coInitialized) CoUninitialize();
+    /* Last: a new Begin may claim the state from here on */
+    InterlockedExchange(&state->continuousState, REPLAY_CONTINUOUS_IDLE);
+    return 0;
+}
+
+/* Pick up a requested continuous save and start its writer. Buffer thread only. */
+static void ContinuousSave_Start(ReplayBufferState* state, ReplayVideoState* video,
+                                 ReplayAudioState* audio, BOOL audioActive,
+                                 LARGE_INTEGER captureStartTime, LARGE_INTEGER perfFreq) {
+    /* A previous writer has set IDLE and is returning */
+    if (g_continuous.thread) {
+        WaitForSingleObject(g_continuous.thread, INFINITE);
+        SAFE_CLOSE_HANDLE(g_continuous.thread);
+    }
+    
+    if (InterlockedCompareExchange(&state->continuousState, REPLAY_CONTINUOUS_ACTIVE,
+                                   REPLAY_CONTINUOUS_REQUESTED) != REPLAY_CONTINUOUS_REQUESTED) {
+        return;  /* Cancelled by EndContinuousSave */
+    }
+    
+    g_continuous.state = state;
+    g_continuous.frameBuffer = &video->frameBuffer;
+    g_continuous.audio = (audioActive && audio->configData && audio->configSize > 0) ? audio : NULL;
+    g_continuous.request = state->continuousRequest;
+    g_continuous.captureStartTime = captureStartTime;
+    g_continuous.perfFreq = perfFreq;
+    
+    g_continuous.thread = CreateThread(NULL, 0, ContinuousSaveProc, NULL, 0, NULL);
+    if (!g_continuous.thread) {
+        ReplayLog("ContinuousSave: CreateThread failed (%lu)\n", GetLastError());
+        PostSaveResult(&g_continuous.request, FALSE, 0, 0);
+        InterlockedExchange(&state->continuousState, REPLAY_CONTINUOUS_IDLE);
+        return;
+    }
+    ReplayLog("ContinuousSave: started %s (%s)\n", g_continuous.request.path,
+              g_continuous.audio ? "video + mixed audio" : "video only");
+}
+
+/* Finalize a running continuous save, or fail one not yet started.
+ * Buffer thread only, before the pipelines shut down. */
+static void ContinuousSave_Stop(ReplayBufferState* state) {
+    if (InterlockedCompareExchange(&state->continuousState, REPLAY_CONTINUOUS_IDLE,
+                                   REPLAY_CONTINUOUS_REQUESTED) == REPLAY_CONTINUOUS_REQUESTED) {
+        PostSaveResult(&state->continuousRequest, FALSE, 0, 0);
+    }
+    InterlockedCompareExchange(&state->continuousState, REPLAY_CONTINUOUS_STOPPING,
+                               REPLAY_CONTINUOUS_ACTIVE);
+    if (g_continuous.thread) {
+        SetEvent(state->hContinuousWakeEvent);
+        /* No timeout: the writer holds a pin on frames the FrameBuffer frees next */
+        WaitForSingleObject(g_continuous.thread, INFINITE);
+        SAFE_CLOSE_HANDLE(g_continuous.thread);
+    }
+}
+
+/**
+ * Move queued save requests onto the buffer thread's waiting list,
+ * resolving each window against the capture clock.
+ */
+static void TakeSaveRequests(ReplayBufferState* state, LARGE_INTEGER captureStartTime,
+                             LARGE_INTEGER perfFreq, ReplaySaveJob** waiting, int* waitingCount) {
+    AcquireSRWLockExclusive(&state->saveQueueLock);
+    while (state->saveQueueCount > 0) {
+        ReplaySaveRequest request = state->saveQueue[state->saveQueueHead];
+        state->saveQueueHead = (state->saveQueueHead + 1) % REPLAY_SAVE_QUEUE_DEPTH;
+        InterlockedDecrement(&state->saveQueueCount);
+        
+        ReplaySaveJob* job = (ReplaySaveJob*)calloc(1, sizeof(ReplaySaveJob));
+        if (!job) {
+            ReplayLog("Save request dropped: job allocation failed (%s)\n", request.path);
+            NotifySaveDone(state, &request, FALSE, 0, 0);
+            continue;
+        }
+        job->request = request;
+        ResolveSaveWindow(&job->request, captureStartTime, perfFreq, &job->window);
+        /* waiting entries <= savePending <= REPLAY_SAVE_QUEUE_DEPTH */
+        waiting[(*waitingCount)++] = job;
+    }
+    ReleaseSRWLockExclusive(&state->saveQueueLock);
+}
+
+/**
+ * Charge the audio tracks against the frame buffer's memory budget, let
+ * audio follow the video span the budget leaves, and publish the live
+ * figures shown in settings. Buffer thread, every REPLAY_MEMORY_ACCOUNTING_MS.
+ */
+static void UpdateMemoryAccounting(ReplayBufferState* state, ReplayVideoState* video,
+                                   ReplayAudioState* audio) {
+    LONG64 audioBytes = audio->storedBytes;
+    if (audioBytes < 0) audioBytes = 0;
+    
+    if (g_config.replayMemoryBudgetMB > 0) {
+        FrameBuffer_SetExternalBytes(&video->frameBuffer, (size_t)audioBytes);
+        /* Audio older than the first buffered IDR can never be saved */
+        LONGLONG oldestKeyTs = 0;
+        if (FrameBuffer_GetTimeBounds(&video->frameBuffer, &oldestKeyTs, NULL)) {
+            InterlockedExchange64(&audio->evictBeforeTs, oldestKeyTs);
+        }
+    }
+    
+    double seconds = FrameBuffer_GetDuration(&video->frameBuffer);
+    size_t bytes = FrameBuffer_GetMemoryUsage(&video->frameBuffer) + (size_t)audioBytes;
+    InterlockedExchange(&state->liveBufferedMs, (LONG)(seconds * 1000.0));
+    InterlockedExchange(&state->liveMemoryMB, (LONG)(bytes / (1024 * 1024)));
+}
+
+/**
+ * Pin and copy a job whose window is ready and pass it to the save worker.
+ * Buffer thread only; does no file I/O, so capture resumes immediately.
+ */
+static void StartSaveJob(ReplayBufferState* state, ReplayVideoState* video,
+                         ReplayAudioState* audio, ReplaySaveJob* job,
+                         LARGE_INTEGER captureStartTime, LARGE_INTEGER perfFreq,
+                         int frameCount, int fps) {
+    double duration = FrameBuffer_GetDuration(&video->frameBuffer);
+    int count = FrameBuffer_GetCount(&video->frameBuffer);
+    
+    /* Calculate actual capture stats for diagnostics */
+    LARGE_INTEGER nowTime = {0};
+    QueryPerformanceCounter(&nowTime);
+    double realElapsedSec = (double)(nowTime.QuadPart - captureStartTime.QuadPart) / perfFreq.QuadPart;
+    double actualFPS = (realElapsedSec > 0) ? frameCount / realElapsedSec : 0;
+    
+    /* Snapshot audio->samples.count under its lock — diagnostic-only read,
+     * but still racy without the lock since audio thread mutates it. */
+    int audioSampleSnapshot = 0;
+    EnterCriticalSection(&audio->lock);
+    audioSampleSnapshot = audio->samples.count;
+    LeaveCriticalSection(&audio->lock);
+    
+    ReplayLog("SAVE REQUEST: %d video samples (%.2fs), %d audio samples, after %.2fs real time\n", 
+              count, duration, audioSampleSnapshot, realElapsedSec);
+    if (job->window.ranged) {
+        ReplayLog("  Window: %.2fs..%.2fs\n",
+                  job->window.startTs / (double)MF_UNITS_PER_SECOND,
+                  job->window.endTs / (double)MF_UNITS_PER_SECOND);
+    }
+    ReplayLog("  Actual capture rate: %.2f fps (target: %d fps)\n", actualFPS, fps);
+    ReplayLog("  Output path: %s\n", job->request.path);
+    
+    PipelineStats_Dump("replay save", TRUE);
+    Metrics_Dump("replay save", TRUE);
+    
+    TraceActivity trace;
+    TRACE_STAGE_START(&trace, TRACE_STAGE_SAVE_PREPARE, count, job->window.endTs);
+    BOOL prepared = PrepareSaveJob(job, video, audio, captureStartTime, perfFreq);
+    TRACE_STAGE_STOP(&trace, job->snapshot.count, job->window.savedEndTs);
+    
+    if (prepared) {
+        SaveWorker_Submit(job);
+    } else {
+        FinishSaveJob(job, &video->frameBuffer, state, FALSE);
+    }
 }
 
 /* ============================================================================
@@ -1225,6 +2464,7 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
      * before creating this thread, so we don't need to touch it here */
     
     ReplayLog("BufferThread started (ShadowPlay RAM mode)\n");
+    ULONGLONG runStartMs = GetTickCount64();
     
     ReplayLog("Config: replayEnabled=%d, duration=%d, captureSource=%d, monitorIndex=%d\n",
               g_config.replayEnabled, g_config.replayDuration, 
@@ -1282,40 +2522,79 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
     ReplayLog("Final capture params: %dx%d @ %d FPS, duration=%ds, quality=%d\n", 
               width, height, fps, g_config.replayDuration, g_config.quality);
     
+    /* Optional output resolution: the encoder, frame buffer and saved clips
+     * all use the scaled size; only capture and conversion input see the
+     * native size. */
+    int captureWidth = width, captureHeight = height;
+    Util_ScaleToHeight(captureWidth, captureHeight, g_config.replayOutputHeight, &width, &height);
+    if (width != captureWidth || height != captureHeight) {
+        ReplayLog("Output resolution: %dx%d -> %dx%d (GPU downscale)\n",
+                  captureWidth, captureHeight, width, height);
+    }
+    
+    /* Build the audio pipeline while the video one comes up; neither
+     * depends on the other until both must share t0 below */
+    ReplayAudioState* audio = &g_internal.audio;
+    AudioPrepJob audioPrep = { state, audio, AAC_OK, FALSE, 0 };
+    HANDLE hAudioPrep = CreateThread(NULL, 0, AudioPrepThreadProc, &audioPrep, 0, NULL);
+    if (!hAudioPrep) AudioPrepThreadProc(&audioPrep);
+    
     /* Initialize video encoding pipeline */
     GPUConverter gpuConverter = {0};
     ReplayVideoState* video = &g_internal.video;
     
-    if (!InitVideoPipeline(capture, video, &gpuConverter, width, height, fps)) {
+    ULONGLONG videoInitStartMs = GetTickCount64();
+    BOOL videoReady = InitVideoPipeline(capture, video, &gpuConverter, width, height, fps);
+    ULONGLONG videoInitMs = GetTickCount64() - videoInitStartMs;
+    
+    if (hAudioPrep) {
+        WaitForSingleObject(hAudioPrep, INFINITE);
+        CloseHandle(hAudioPrep);
+    }
+    if (!videoReady) {
+        if (audioPrep.prepared) ShutdownAudioPipeline(audio);
         InterlockedExchange(&state->state, REPLAY_STATE_ERROR);
         if (coInitialized) CoUninitialize();
         return 1;
     }
+    ReplayLog("Pipeline init: video %llu ms, audio %llu ms (%s)\n",
+              videoInitMs, audioPrep.elapsedMs, hAudioPrep ? "concurrent" : "serial");
+    StartPreviewTap(&gpuConverter, width, height, fps);
+    
+    /* Publish the stream so a manual recording can tap it */
+    AcquireSRWLockExclusive(&g_streamTap.lock);
+    g_streamTap.info.streamId = InterlockedIncrement(&g_nextStreamId);
+    g_streamTap.info.captureRect = capture->captureRect;
+    g_streamTap.info.width = width;
+    g_streamTap.info.height = height;
+    g_streamTap.info.fps = fps;
+    g_streamTap.info.quality = g_config.quality;
+    g_streamTap.info.codec = video->codec;
+    g_streamTap.info.seqHeaderSize = video->seqHeaderSize;
+    memcpy(g_streamTap.info.seqHeader, video->seqHeader, video->seqHeaderSize);
+    g_streamTap.streamValid = TRUE;
+    ReleaseSRWLockExclusive(&g_streamTap.lock);
     
     /* Shared wall-clock anchor: audio and video MUST share this QPC value or
      * every save will be misaligned at the front edge (audio appears early /
      * video appears delayed). See AlignAudioToVideoWindow. Captured here \u2014
-     * before audio init \u2014 so AudioCapture_StartAt receives the same t0 the
+     * before audio starts \u2014 so AudioCapture_StartAt receives the same t0 the
      * capture loop will use for video PTS. */
     LARGE_INTEGER perfFreq, lastFrameTime, captureStartTime;
     QueryPerformanceFrequency(&perfFreq);
     QueryPerformanceCounter(&captureStartTime);
     lastFrameTime = captureStartTime;
 
-    /* Initialize audio capture if enabled */
-    ReplayAudioState* audio = &g_internal.audio;
-    AACEncoderError audioErr = AAC_OK;
-    BOOL audioActive = InitAudioPipeline(state, audio, captureStartTime, &audioErr);
+    /* Start audio capture if it was prepared */
+    AACEncoderError audioErr = audioPrep.error;
+    BOOL audioActive = audioPrep.prepared && StartAudioPipeline(audio, captureStartTime);
     
     /* Kill feed sampler lifecycle — bound to whichever GameProfile matches
      * the current foreground window. Created/destroyed inside the capture
-     * loop based on GetForegroundWindow polling (cheap; only does real
-     * lookup work when HWND actually changes). */
+     * loop when the profile published by the UI thread's foreground hook
+     * changes (GameProfile_GetForegroundProfile is one atomic read). */
     KillFeedSampler* kfSampler = NULL;
     GameProfile* currentProfile = NULL;
-    HWND lastForegroundHwnd = NULL;
-    ULONGLONG lastForegroundPollMs = 0;
-    BOOL lastAutoClipEnabled = FALSE;
     state->killFeedSampler = NULL;
     
     /* Store audio error for caller to check */
@@ -1330,29 +2609,40 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
               frameIntervalMs, fps,
               timingMode == FRAME_TIMING_VFR ? "vfr" : "cfr");
 
-    // Request high-resolution timer (1ms precision)
-    timeBeginPeriod(1);
+    // Frame pacing: high-resolution waitable timer (no global timer period)
+    FrameScheduler scheduler;
+    if (!FrameScheduler_Init(&scheduler, fps)) {
+        ReplayLog("No frame timer, pacing with millisecond waits\n");
+    }
+    const LONGLONG frameIntervalTicks = (LONGLONG)(frameIntervalMs * perfFreq.QuadPart / 1000.0);
+    PipelineStats_Reset();
+    Metrics_ResetHistogram(METRIC_HIST_NVENC_FRAME_BYTES);
     
     int frameCount = 0;
     int lastLogFrame = 0;
+    ULONGLONG lastAccountingTick = 0;
 
     /* CFR mode tracks wall-clock "slots" of size 1/fps. Each emitted frame
      * lands on a slot; gaps from slow capture are padded with duplicates of
      * the most recent frame so output is true CFR. lastSubmittedSlot = -1
      * means no frame submitted yet; haveLastFrame gates dup injection until
-     * we have valid prior NV12 content in the GPUConverter output texture. */
+     * the encoder has a prior frame for NVENCEncoder_SubmitRepeat. */
     LONGLONG lastSubmittedSlot = -1;
     BOOL haveLastFrame = FALSE;
     int dupFramesEmitted = 0;
+    /* Frames whose capture region had no dirty/move rects; encoded from the
+     * previous NV12 output without a convert pass. */
+    int staticFramesEmitted = 0;
     /* Cap dups per iteration so a long stall (e.g. 5s freeze) doesn't try to
      * inject hundreds of frames in one loop pass and stall the buffer thread. */
     const int MAX_DUP_FRAMES_PER_ITER = 6;
 
-    // Diagnostic counters (reset each run)
+    // Diagnostic counters (reset each run). Failures are counted in the
+    // metrics registry; the bases turn its process totals into per-run counts.
     int attemptCount = 0;
-    int captureNullCount = 0;
-    int convertNullCount = 0;
-    int encodeFailCount = 0;  // Diagnostic counter only (no threshold logic)
+    LONGLONG captureNullBase = Metrics_GetCounter(METRIC_REPLAY_CAPTURE_NULL);
+    LONGLONG convertNullBase = Metrics_GetCounter(METRIC_REPLAY_CONVERT_NULL);
+    LONGLONG encodeFailBase = Metrics_GetCounter(METRIC_REPLAY_ENCODE_FAIL);
     double totalCaptureMs = 0, totalConvertMs = 0, totalSubmitMs = 0;
     int timingCount = 0;
 
@@ -1374,6 +2664,12 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
     // Build wait handle array for event-driven loop
     HANDLE waitHandles[2] = { state->hStopEvent, state->hSaveRequestEvent };
     
+    // Saves picked up but waiting for their window to be buffered (partial
+    // saves); muxing itself runs on the save worker
+    ReplaySaveJob* waitingSaves[REPLAY_SAVE_QUEUE_DEPTH] = {0};
+    int waitingSaveCount = 0;
+    SaveWorker_Start(state, &video->frameBuffer);
+    
     while (InterlockedCompareExchange(&state->state, 0, 0) == REPLAY_STATE_CAPTURING) {
         // Heartbeat every iteration (non-blocking)
         Logger_Heartbeat(THREAD_BUFFER);
@@ -1402,8 +2698,16 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
             }
         }
 
-        // Check for stop/save events with 1ms timeout (allows frame timing)
-        DWORD waitResult = WaitForMultipleObjects(2, waitHandles, FALSE, 1);
+        /* Sleep until the next frame is due, waking early for stop/save.
+         * Audio is encoded on its own thread; only if that thread could not
+         * start does this loop wake every REPLAY_AUDIO_DRAIN_INTERVAL_MS to
+         * drain PCM inline. */
+        BOOL drainAudioInline = audioActive && audio->capture && audio->encoder && !audio->encodeThread;
+        DWORD signaled = 0;
+        FrameWaitResult frameWait = FrameScheduler_WaitUntil(
+            &scheduler, lastFrameTime.QuadPart + frameIntervalTicks, waitHandles, 2,
+            drainAudioInline ? REPLAY_AUDIO_DRAIN_INTERVAL_MS : INFINITE, &signaled);
+        DWORD waitResult = (frameWait == FRAME_WAIT_SIGNALED) ? WAIT_OBJECT_0 + signaled : WAIT_TIMEOUT;
         
         if (waitResult == WAIT_OBJECT_0) {
             // Stop event signaled
@@ -1411,78 +2715,39 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
             break;
         }
         
-        if (waitResult == WAIT_OBJECT_0 + 1) {
-            /* Save request event signaled */
-            double duration = FrameBuffer_GetDuration(&video->frameBuffer);
-            int count = FrameBuffer_GetCount(&video->frameBuffer);
-            
-            /* Calculate actual capture stats for diagnostics */
-            LARGE_INTEGER nowTime = {0};
-            QueryPerformanceCounter(&nowTime);
-            double realElapsedSec = (double)(nowTime.QuadPart - captureStartTime.QuadPart) / perfFreq.QuadPart;
-            double actualFPS = (realElapsedSec > 0) ? frameCount / realElapsedSec : 0;
-            
-            /* Snapshot audio->sampleCount under its lock — diagnostic-only read,
-             * but still racy without the lock since audio thread mutates it. */
-            int audioSampleSnapshot = 0;
-            EnterCriticalSection(&audio->lock);
-            audioSampleSnapshot = audio->sampleCount;
-            LeaveCriticalSection(&audio->lock);
-            
-            ReplayLog("SAVE REQUEST: %d video samples (%.2fs), %d audio samples, after %.2fs real time\n", 
-                      count, duration, audioSampleSnapshot, realElapsedSec);
-            ReplayLog("  Actual capture rate: %.2f fps (target: %d fps)\n", actualFPS, fps);
-            ReplayLog("  Output path: %s\n", state->savePath);
-            
-            /* Use helper function for save operation */
-            BOOL saveOk = HandleSaveRequest(state, video, audio);
-            InterlockedExchange(&state->saveSuccess, saveOk);
-            
-            /* Snapshot notification target before signaling/clearing so a fast
-             * second SaveAsync cannot race the read against its own write.
-             * SaveAsync gates new requests on savePending until we clear it below. */
-            HWND notifyWnd = state->notifyWindow;
-            UINT notifyMsg = state->notifyMessage;
-            state->notifyWindow = NULL;
-            state->notifyMessage = 0;
-            
-            /* Signal completion event (for sync API) */
-            SetEvent(state->hSaveCompleteEvent);
-            
-            /* Post async notification if window was specified */
-            if (notifyWnd && notifyMsg) {
-                PostMessage(notifyWnd, notifyMsg, (WPARAM)saveOk, 0);
-                ReplayLog("Posted save completion to hwnd=%p msg=%u success=%d\n",
-                          (void*)notifyWnd, notifyMsg, saveOk);
-            }
-            
-            /* Release the SaveAsync gate now that savePath/notify slots are
-             * free to reuse and the completion notification has been posted. */
-            InterlockedExchange(&state->savePending, 0);
-            
-            continue;  /* Skip frame capture this iteration */
+        /* Checked every iteration, not only on the event: a request can
+         * land while an inner wait (duplication reinit) consumed it. */
+        if (waitResult == WAIT_OBJECT_0 + 1 || InterlockedCompareExchange(&state->saveQueueCount, 0, 0) > 0) {
+            TakeSaveRequests(state, captureStartTime, perfFreq, waitingSaves, &waitingSaveCount);
+        }
+        if (InterlockedCompareExchange(&state->continuousState, 0, 0) == REPLAY_CONTINUOUS_REQUESTED) {
+            ContinuousSave_Start(state, video, audio, audioActive, captureStartTime, perfFreq);
         }
         
-        /* === AUDIO CAPTURE === */
-        if (audioActive && audio->capture && audio->encoder) {
-            /* Read and encode mixed audio (track 0) */
-            BYTE audioPcmBuf[8192];
-            LONGLONG audioTs = 0;
-            int audioBytes = AudioCapture_Read(audio->capture, audioPcmBuf, sizeof(audioPcmBuf), &audioTs);
-            if (audioBytes > 0) {
-                AACEncoder_Feed(audio->encoder, audioPcmBuf, audioBytes, audioTs);
-            }
-            
-            /* Read and encode per-source audio (tracks 1..N) */
-            for (int si = 0; si < audio->perSourceCount; si++) {
-                if (!audio->perSourceEncoders[si]) continue;
-                BYTE srcPcmBuf[8192];
-                LONGLONG srcTs = 0;
-                int srcBytes = AudioCapture_ReadSource(audio->capture, si, srcPcmBuf, sizeof(srcPcmBuf), &srcTs);
-                if (srcBytes > 0) {
-                    AACEncoder_Feed(audio->perSourceEncoders[si], srcPcmBuf, srcBytes, srcTs);
-                }
+        /* Start every save whose window is buffered. Pinning and copying the
+         * clip's audio is all that happens here; capture carries on. */
+        for (int i = 0; i < waitingSaveCount; ) {
+            if (!SaveWindowReady(&video->frameBuffer, &waitingSaves[i]->window)) {
+                i++;
+                continue;
             }
+            StartSaveJob(state, video, audio, waitingSaves[i],
+                         captureStartTime, perfFreq, frameCount, fps);
+            memmove(&waitingSaves[i], &waitingSaves[i + 1],
+                    (size_t)(waitingSaveCount - i - 1) * sizeof(waitingSaves[0]));
+            waitingSaveCount--;
+        }
+        
+        /* === AUDIO CAPTURE (fallback only; see AudioEncodeThreadProc) === */
+        if (drainAudioInline) {
+            DrainAudioCapture(audio);
+        }
+        
+        /* === MEMORY ACCOUNTING === */
+        ULONGLONG accountingTick = GetTickCount64();
+        if (accountingTick - lastAccountingTick >= REPLAY_MEMORY_ACCOUNTING_MS) {
+            lastAccountingTick = accountingTick;
+            UpdateMemoryAccounting(state, video, audio);
         }
         
         /* === FRAME CAPTURE (GPU PATH) === */
@@ -1521,28 +2786,31 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                 ? (UINT64)((double)currentSlot * frameIntervalMs * 10000.0)
                 : (UINT64)elapsedHns;
 
-            /* CFR gap fill: re-submit the previous frame's NV12 data (still
-             * present in GPUConverter outputTexture from the prior iteration
-             * since we haven't called Convert yet) for every missing slot. */
+            /* CFR gap fill: re-encode the previously submitted frame for
+             * every missing slot. SubmitRepeat reuses the encoder's own copy
+             * of the last input, so catching up after a stall costs one
+             * near-empty P-frame per slot, with no convert or readback. */
             if (timingMode == FRAME_TIMING_CFR && haveLastFrame && video->encoder &&
-                gpuConverter.outputTexture && currentSlot > lastSubmittedSlot + 1) {
+                currentSlot > lastSubmittedSlot + 1) {
                 LONGLONG gapStart = lastSubmittedSlot + 1;
                 LONGLONG gapEnd = currentSlot - 1;
                 int dupsThisIter = 0;
                 for (LONGLONG s = gapStart; s <= gapEnd && dupsThisIter < MAX_DUP_FRAMES_PER_ITER; s++) {
                     UINT64 dupTs = (UINT64)((double)s * frameIntervalMs * 10000.0);
-                    int dupResult = NVENCEncoder_SubmitTexture(video->encoder,
-                                                               gpuConverter.outputTexture,
-                                                               dupTs);
+                    int dupResult = NVENCEncoder_SubmitRepeat(video->encoder, dupTs);
                     if (dupResult != 1) break;  /* stop on failure; new frame attempt follows */
                     frameCount++;
                     dupFramesEmitted++;
                     dupsThisIter++;
+                    Metrics_Increment(METRIC_REPLAY_FRAMES_ENCODED);
+                    Metrics_Increment(METRIC_REPLAY_FRAMES_DUPLICATED);
                     lastSubmittedSlot = s;
                     LONG newCount = InterlockedIncrement(&state->framesCaptured);
                     if (newCount == MIN_FRAMES_FOR_SAVE) {
                         SetEvent(state->hReadyEvent);
-                        ReplayLog("Minimum frames captured (%d), ready for saves\n", MIN_FRAMES_FOR_SAVE);
+                        ReplayLog("Minimum frames captured (%d), ready for saves %llu ms after start\n",
+                                  MIN_FRAMES_FOR_SAVE, GetTickCount64() - runStartMs);
+                        Startup_LogReady("Replay buffer");
                     }
                 }
             }
@@ -1553,79 +2821,105 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                 continue;
             }
 
-            // GPU path: capture → color convert → NVENC (all on GPU)
+            // GPU path: capture → color convert → NVENC (all on GPU when the
+            // encoder is on its D3D11 zero-copy input path)
             
             // Pipeline timing for diagnostics
             LARGE_INTEGER t1, t2, t3, t4;
             
             if (gpuConverter.initialized && video->encoder) {
+                TraceActivity trace;
+                LONGLONG traceTs = (LONGLONG)newFrameTimestamp;
+                TRACE_STAGE_START(&trace, TRACE_STAGE_CAPTURE, attemptCount, traceTs);
                 QueryPerformanceCounter(&t1);
                 ID3D11Texture2D* bgraTexture = Capture_GetFrameTexture(capture, NULL);
                 QueryPerformanceCounter(&t2);
+                TRACE_STAGE_STOP(&trace, attemptCount, traceTs);
                 
                 if (bgraTexture) {
-                    /* Auto-clip: poll foreground at ~2Hz and swap the sampler
-                     * when the active game changes. The sampler doesn't even
-                     * exist when the foreground exe isn't in our catalog. */
+                    /* Static content (no dirty/move rects inside the capture
+                     * region): the last submitted frame is still exact, so
+                     * skip conversion and kill-feed sampling and repeat it.
+                     * NVENC turns an identical input into a near-empty P-frame. */
+                    BOOL staticFrame = haveLastFrame &&
+                                       !Capture_GetLastChange(capture)->changed;
+                    
+                    /* Auto-clip: swap the sampler when the foreground game
+                     * changes. The sampler doesn't even exist when the
+                     * foreground exe isn't in our catalog. */
                     if (g_config.autoClipEnabled) {
-                        ULONGLONG nowMs = GetTickCount64();
-                        BOOL justEnabled = !lastAutoClipEnabled;
-                        lastAutoClipEnabled = TRUE;
-                        if (justEnabled || nowMs - lastForegroundPollMs >= 500) {
-                            lastForegroundPollMs = nowMs;
-                            BOOL fgChanged = GameProfile_ForegroundChanged(&lastForegroundHwnd);
-                            if (fgChanged || justEnabled) {
-                                GameProfile* matched = GameProfile_GetForegroundMatch();
-                                if (matched != currentProfile) {
-                                    if (kfSampler) {
-                                        KillFeedSampler_Shutdown(kfSampler);
-                                        kfSampler = NULL;
-                                        state->killFeedSampler = NULL;
-                                        ReplayLog("Auto-clip sampler shut down (game lost focus)\n");
-                                    }
-                                    currentProfile = matched;
-                                    if (matched && matched->userEnabled) {
-                                        kfSampler = KillFeedSampler_Init(matched, capture,
-                                                                         state->autoClipWnd);
-                                        if (kfSampler) {
-                                            state->killFeedSampler = kfSampler;
-                                            ReplayLog("Auto-clip sampler initialized for '%s'\n",
-                                                      matched->id);
-                                        }
-                                    }
+                        GameProfile* matched = GameProfile_GetForegroundProfile();
+                        if (matched != currentProfile) {
+                            if (kfSampler) {
+                                KillFeedSampler_Shutdown(kfSampler);
+                                kfSampler = NULL;
+                                state->killFeedSampler = NULL;
+                                ReplayLog("Auto-clip sampler shut down (game lost focus)\n");
+                            }
+                            currentProfile = matched;
+                            if (matched && matched->userEnabled) {
+                                kfSampler = KillFeedSampler_Init(matched, capture,
+                                                                 state->autoClipWnd);
+                                if (kfSampler) {
+                                    state->killFeedSampler = kfSampler;
+                                    ReplayLog("Auto-clip sampler initialized for '%s'\n",
+                                              matched->id);
                                 }
                             }
                         }
                     } else {
-                        lastAutoClipEnabled = FALSE;
+                        /* Forget the profile too, so re-enabling re-resolves */
                         if (kfSampler) {
                             KillFeedSampler_Shutdown(kfSampler);
                             kfSampler = NULL;
                             state->killFeedSampler = NULL;
-                            currentProfile = NULL;
                         }
+                        currentProfile = NULL;
                     }
 
                     /* Feed kill feed sampler (handles scan interval internally) */
-                    if (kfSampler) {
+                    if (kfSampler && !staticFrame) {
                         KillFeedSampler_FeedFrame(kfSampler, capture, bgraTexture);
                     }
                     
-                    ID3D11Texture2D* nv12Texture = GPUConverter_Convert(&gpuConverter, bgraTexture);
+                    ID3D11Texture2D* nv12Texture = NULL;
+                    if (!staticFrame) {
+                        TRACE_STAGE_START(&trace, TRACE_STAGE_CONVERT, attemptCount, traceTs);
+                        nv12Texture = GPUConverter_Convert(&gpuConverter, bgraTexture);
+                        TRACE_STAGE_STOP(&trace, attemptCount, traceTs);
+                        /* Preview tap: a small extra Blt once per GOP, read
+                         * back frames later without waiting */
+                        if (nv12Texture) {
+                            GPUConverter_TapPreview(&gpuConverter, bgraTexture, (LONGLONG)newFrameTimestamp);
+                        }
+                    }
+                    GPUConverter_PollPreview(&gpuConverter, PreviewTap_Publish, NULL);
                     QueryPerformanceCounter(&t3);
                     
-                    if (nv12Texture) {
+                    if (nv12Texture || staticFrame) {
                         /* Async API: Submit frame (fast, non-blocking)
                          * Output thread will call DrainCallback when frame completes
                          * Returns: 1=success, 0=transient failure, -1=device lost */
-                        int submitResult = NVENCEncoder_SubmitTexture(video->encoder, nv12Texture, newFrameTimestamp);
+                        TRACE_STAGE_START(&trace, TRACE_STAGE_ENCODE_SUBMIT, attemptCount, traceTs);
+                        int submitResult = staticFrame
+                            ? NVENCEncoder_SubmitRepeat(video->encoder, (LONGLONG)newFrameTimestamp)
+                            : NVENCEncoder_SubmitTexture(video->encoder, nv12Texture, newFrameTimestamp);
+                        TRACE_STAGE_STOP(&trace, attemptCount, traceTs);
+                        if (staticFrame && submitResult == 1) {
+                            staticFramesEmitted++;
+                            Metrics_Increment(METRIC_REPLAY_FRAMES_STATIC);
+                        }
                         QueryPerformanceCounter(&t4);
                         
                         if (submitResult == 1) {
                             frameCount++;  // Count submissions (frames delivered via callback)
-                            encodeFailCount = 0;  // Reset consecutive failure counter
                             haveLastFrame = TRUE;
+                            Metrics_Increment(METRIC_REPLAY_FRAMES_ENCODED);
                             if (timingMode == FRAME_TIMING_CFR) {
+                                /* Slots the dup cap left unfilled are gone for good */
+                                if (lastSubmittedSlot >= 0 && currentSlot > lastSubmittedSlot + 1) {
+                                    Metrics_Add(METRIC_REPLAY_FRAMES_SKIPPED, currentSlot - lastSubmittedSlot - 1);
+                                }
                                 lastSubmittedSlot = currentSlot;
                             }
                             
@@ -1635,7 +2929,9 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                             // Signal ready event once we have enough frames
                             if (newCount == MIN_FRAMES_FOR_SAVE) {
                                 SetEvent(state->hReadyEvent);
-                                ReplayLog("Minimum frames captured (%d), ready for saves\n", MIN_FRAMES_FOR_SAVE);
+                                ReplayLog("Minimum frames captured (%d), ready for saves %llu ms after start\n",
+                                          MIN_FRAMES_FOR_SAVE, GetTickCount64() - runStartMs);
+                                Startup_LogReady("Replay buffer");
                             }
                             
                             // Accumulate timing stats (submit should be <1ms in async mode)
@@ -1643,20 +2939,23 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                             totalConvertMs += (double)(t3.QuadPart - t2.QuadPart) * 1000.0 / perfFreq.QuadPart;
                             totalSubmitMs += (double)(t4.QuadPart - t3.QuadPart) * 1000.0 / perfFreq.QuadPart;
                             timingCount++;
+                            PipelineStats_Record(PIPELINE_STAGE_CAPTURE, t1, t2);
+                            if (!staticFrame) PipelineStats_Record(PIPELINE_STAGE_CONVERT, t2, t3);
+                            PipelineStats_Record(PIPELINE_STAGE_SUBMIT, t3, t4);
                         } else if (submitResult == -1) {
                             // Device lost - exit cleanly, HealthMonitor will detect and recover
                             ReplayLog("NVENC DEVICE LOST - exiting for HealthMonitor recovery\n");
                             break;
                         } else {
                             // submitResult == 0: Transient failure (frame dropped)
-                            encodeFailCount++;  // Track for diagnostics
+                            Metrics_Increment(METRIC_REPLAY_ENCODE_FAIL);  // Diagnostics only
                             // Don't try to self-recover - HealthMonitor will detect if we get stuck
                         }
                     } else {
-                        convertNullCount++;
+                        Metrics_Increment(METRIC_REPLAY_CONVERT_NULL);
                     }
                 } else {
-                    captureNullCount++;
+                    Metrics_Increment(METRIC_REPLAY_CAPTURE_NULL);
                     
                     // Check if access was lost (monitor sleep, resolution change, etc.)
                     if (capture->accessLost) {
@@ -1669,17 +2968,13 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                             break;  // Exit capture loop
                         }
                         if (stabilizeWait == WAIT_OBJECT_0 + 1) {
-                            // Save requested during reinit - can't save with stale data
-                            ReplayLog("Save requested during reinit - rejecting (access lost)\n");
-                            InterlockedExchange(&state->saveSuccess, FALSE);
-                            SetEvent(state->hSaveCompleteEvent);
-                            /* Release SaveAsync gate so caller can retry once reinit completes */
-                            InterlockedExchange(&state->savePending, 0);
+                            // Stays queued; picked up once the loop resumes
+                            ReplayLog("Save requested during reinit - deferred until capture resumes\n");
                         }
                         
                         if (Capture_ReinitDuplication(capture)) {
                             ReplayLog("Duplication reinitialized successfully\n");
-                            captureNullCount = 0;  // Reset counter after reinit
+                            captureNullBase = Metrics_GetCounter(METRIC_REPLAY_CAPTURE_NULL);  // Reset after reinit
                         } else {
                             ReplayLog("WARNING: Failed to reinit duplication, will retry...\n");
                             // Longer wait before retry, but still check events
@@ -1689,6 +2984,10 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                 }
             }
             
+            int captureNullCount = (int)(Metrics_GetCounter(METRIC_REPLAY_CAPTURE_NULL) - captureNullBase);
+            int convertNullCount = (int)(Metrics_GetCounter(METRIC_REPLAY_CONVERT_NULL) - convertNullBase);
+            int encodeFailCount = (int)(Metrics_GetCounter(METRIC_REPLAY_ENCODE_FAIL) - encodeFailBase);
+            
             // Early failure detection - if first 60 attempts all fail, log warning
             if (attemptCount == 60 && frameCount == 0) {
                 ReplayLog("WARNING: First 60 capture attempts all failed! Check capture source.\n");
@@ -1720,22 +3019,29 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                 
                 int currentQP = NVENCEncoder_GetQP(video->encoder);
                 
-                /* Get frame size stats to detect quality drift */
-                UINT32 lastFrameSize = 0, minFrameSize = 0, maxFrameSize = 0, avgFrameSize = 0;
-                NVENCEncoder_GetFrameSizeStats(video->encoder, &lastFrameSize, &minFrameSize, &maxFrameSize, &avgFrameSize);
+                /* Frame size stats (this run) to detect quality drift */
+                MetricsHistogramStats frameSizes;
+                Metrics_GetHistogram(METRIC_HIST_NVENC_FRAME_BYTES, &frameSizes);
                 
                 double duration = FrameBuffer_GetDuration(&video->frameBuffer);
                 int bufCount = FrameBuffer_GetCount(&video->frameBuffer);
                 size_t memMB = FrameBuffer_GetMemoryUsage(&video->frameBuffer) / (1024 * 1024);
                 size_t memKB = FrameBuffer_GetMemoryUsage(&video->frameBuffer) / 1024;
-                int avgKBPerFrame = bufCount > 0 ? (int)(memKB / bufCount) : 0;
-                ReplayLog("Status: %d/%d frames in %.1fs (encode=%.1f fps, attempt=%.1f fps, target=%d fps, dups=%d), buffer=%.1fs (%d samples, %zu MB, %d KB/frame, QP=%d)\n",
-                          frameCount, attemptCount, logElapsedSec, actualFPS, attemptFPS, fps, dupFramesEmitted, duration, bufCount, memMB, avgKBPerFrame, currentQP);
+                size_t spillKB = FrameBuffer_GetSpillUsage(&video->frameBuffer) / 1024;
+                int avgKBPerFrame = bufCount > 0 ? (int)((memKB + spillKB) / bufCount) : 0;
+                ReplayLog("Status: %d/%d frames in %.1fs (encode=%.1f fps, attempt=%.1f fps, target=%d fps, dups=%d, static=%d), buffer=%.1fs (%d samples, %zu MB, %d KB/frame, QP=%d)\n",
+                          frameCount, attemptCount, logElapsedSec, actualFPS, attemptFPS, fps, dupFramesEmitted, staticFramesEmitted, duration, bufCount, memMB, avgKBPerFrame, currentQP);
                 
                 /* Log leak tracker status if enabled (rate-limited internally) */
                 LeakTracker_LogStatus();
-                ReplayLog("  Frame sizes: last=%u, min=%u, max=%u, avg=%u bytes\n",
-                          lastFrameSize, minFrameSize, maxFrameSize, avgFrameSize);
+                ReplayLog("  Frame sizes: last=%lld, min=%lld, max=%lld, avg=%lld, p90<=%lld bytes\n",
+                          Metrics_GetGauge(METRIC_GAUGE_NVENC_LAST_FRAME_BYTES),
+                          frameSizes.min, frameSizes.max,
+                          frameSizes.count > 0 ? frameSizes.sum / frameSizes.count : 0,
+                          frameSizes.p90);
+                if (spillKB > 0) {
+                    ReplayLog("  Spill tier: %zu MB on disk\n", spillKB / 1024);
+                }
                 
                 /* Log failure breakdown if any */
                 if (captureNullCount + convertNullCount + encodeFailCount > 0) {
@@ -1743,17 +3049,35 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                               captureNullCount, convertNullCount, encodeFailCount);
                 }
                 
+                /* Live latency view (console only; log gets it on each save) */
+                PipelineStats_Dump("replay", FALSE);
+                Metrics_Dump("replay", FALSE);
+                Metrics_LogSnapshotIfDue();
+                
                 lastLogFrame = frameCount;
             }
         }
-        /* No Sleep() needed - WaitForMultipleObjects provides timing */
+        /* No Sleep() needed - FrameScheduler_WaitUntil provides timing */
+    }
+    
+    /* Answer every outstanding save before the pipelines go away: partial
+     * saves still waiting for their tail get what is buffered, then the
+     * worker writes its whole queue (jobs pin frames and point at the AAC
+     * configs freed below). */
+    TakeSaveRequests(state, captureStartTime, perfFreq, waitingSaves, &waitingSaveCount);
+    for (int i = 0; i < waitingSaveCount; i++) {
+        StartSaveJob(state, video, audio, waitingSaves[i],
+                     captureStartTime, perfFreq, frameCount, fps);
     }
+    waitingSaveCount = 0;
+    SaveWorker_Stop();
+    ContinuousSave_Stop(state);
     
     /* Cleanup */
     ReplayLog("Shutting down (state=%d)...\n", InterlockedCompareExchange(&state->state, 0, 0));
     
-    /* Restore timer resolution */
-    timeEndPeriod(1);
+    /* Release the frame timer */
+    FrameScheduler_Shutdown(&scheduler);
     
     /* Shutdown pipelines using helper functions */
     KillFeedSampler_Shutdown(kfSampler);
@@ -1761,8 +3085,22 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
     if (audioActive) {
         ShutdownAudioPipeline(audio);
     }
+    
+    /* No new taps; an attached one still gets the frames Destroy drains */
+    AcquireSRWLockExclusive(&g_streamTap.lock);
+    g_streamTap.streamValid = FALSE;
+    ReleaseSRWLockExclusive(&g_streamTap.lock);
+    
     ShutdownVideoPipeline(video, &gpuConverter);
     
+    AcquireSRWLockExclusive(&g_streamTap.lock);
+    if (g_streamTap.callback) {
+        ReplayLog("Stream tap dropped: replay pipeline stopped\n");
+    }
+    g_streamTap.callback = NULL;
+    g_streamTap.userData = NULL;
+    ReleaseSRWLockExclusive(&g_streamTap.lock);
+    
     if (coInitialized) CoUninitialize();
     ReplayLog("BufferThread exit\n");
     return 0;
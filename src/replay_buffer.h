@@ -12,9 +12,10 @@
 
 #include <windows.h>
 #include "config.h"
-#include "constants.h"    // For MAX_AUDIO_SAMPLES
+#include "constants.h"    // For REPLAY_SAVE_QUEUE_DEPTH
 #include "markers.h"
 #include "aac_encoder.h"  // For AACEncoderError
+#include "nvenc_encoder.h" // For EncodedFrameCallback
 
 // Minimum frames required before save is allowed (1 second worth)
 #define MIN_FRAMES_FOR_SAVE 30
@@ -28,6 +29,32 @@ typedef enum {
     REPLAY_STATE_ERROR          // Fatal error occurred
 } ReplayStateEnum;
 
+// Continuous save lifecycle (ReplayBufferState.continuousState)
+typedef enum {
+    REPLAY_CONTINUOUS_IDLE,
+    REPLAY_CONTINUOUS_CLAIMED,      // Begin is filling in continuousRequest
+    REPLAY_CONTINUOUS_REQUESTED,    // Waiting for the buffer thread
+    REPLAY_CONTINUOUS_ACTIVE,       // Writer appending the live stream
+    REPLAY_CONTINUOUS_STOPPING      // Writer flushing and finalizing
+} ReplayContinuousState;
+
+// One queued save (see ReplayBuffer_SaveAsync and variants)
+typedef struct {
+    char path[MAX_PATH];
+    int secondsBack;            // Clip window around anchorQpc; < 0 = whole buffer
+    int secondsAfter;
+    LARGE_INTEGER anchorQpc;
+    HWND notifyWindow;          // Window to receive notifyMessage (NULL = none)
+    UINT notifyMessage;         // Custom message ID (WM_USER + N)
+} ReplaySaveRequest;
+
+// lParam of a save's notifyMessage (heap-allocated; receiver frees, may be NULL)
+typedef struct {
+    char path[MAX_PATH];
+    ULONGLONG startMs;          // GetTickCount64 span written (success only). Starts
+    ULONGLONG endMs;            // at the clip's first IDR, so usually a little early.
+} ReplaySaveResult;
+
 typedef struct {
     BOOL enabled;
     int durationSeconds;
@@ -43,14 +70,23 @@ typedef struct {
     
     // Event-based synchronization (proper cross-thread coordination)
     HANDLE hReadyEvent;         // Signaled when capture loop is running and has frames
-    HANDLE hSaveRequestEvent;   // Signaled by UI to request save
-    HANDLE hSaveCompleteEvent;  // Signaled by buffer thread when save done
+    HANDLE hSaveRequestEvent;   // Signaled by UI when it queues a save
+    HANDLE hSaveCompleteEvent;  // Signaled when a save has been written
     HANDLE hStopEvent;          // Signaled to request shutdown
+    HANDLE hContinuousWakeEvent; // Signaled to wake the continuous-save writer
     
-    // Save parameters (protected by hSaveRequestEvent sequencing)
-    char savePath[MAX_PATH];
+    // Save requests not yet picked up by the buffer thread (FIFO ring)
+    SRWLOCK saveQueueLock;
+    ReplaySaveRequest saveQueue[REPLAY_SAVE_QUEUE_DEPTH];
+    int saveQueueHead;
+    volatile LONG saveQueueCount;
     volatile LONG saveSuccess;  // Result of last save (BOOL stored as LONG for Interlocked ops)
-    volatile LONG savePending;  // CAS guard: 1 while a save is queued/in-flight, 0 otherwise
+    volatile LONG savePending;  // Saves requested and not yet written (<= REPLAY_SAVE_QUEUE_DEPTH)
+    
+    // Continuous save (see ReplayBuffer_BeginContinuousSave). The request is
+    // written only in the CLAIMED state and read only once REQUESTED.
+    ReplaySaveRequest continuousRequest;
+    volatile LONG continuousState;  // ReplayContinuousState
 
     // Legacy compatibility
     BOOL isBuffering;
@@ -66,13 +102,14 @@ typedef struct {
     int audioVolume3;
     volatile LONG audioError;  // AACEncoderError if audio init failed
     
+    // Live accounting, published by the buffer thread every
+    // REPLAY_MEMORY_ACCOUNTING_MS (0 while stopped)
+    volatile LONG liveBufferedMs;   // Seconds of history held (both tiers), in ms
+    volatile LONG liveMemoryMB;     // RAM held by frames + audio tracks
+    
     // Markers
     MarkerList markers;
     
-    // Async save completion notification
-    HWND notifyWindow;          // Window to receive WM_REPLAY_SAVE_COMPLETE
-    UINT notifyMessage;         // Custom message ID (WM_USER + N)
-    
     // Auto-clip: window to receive kill detector messages (WM_AUTOCLIP_*)
     HWND autoClipWnd;
     
@@ -87,15 +124,93 @@ void ReplayBuffer_Stop(ReplayBufferState* state);
 
 /* Returns TRUE while the buffer thread holds NVENC / capture resources
  * (STARTING, CAPTURING, or STOPPING). Used by Recording_Start to enforce
- * the "never start recording while replay buffer is running" rule and
- * avoid the documented deadlock on shared NVENC state. Thread-safe. */
+ * the "never start a second capture/encode pipeline while the replay buffer
+ * is running" rule; Recording_StartShared taps this one instead. Thread-safe. */
 BOOL ReplayBuffer_IsActive(const ReplayBufferState* state);
 
+/* ============================================================================
+ * ENCODED STREAM TAP
+ * ============================================================================
+ * Lets one extra consumer (a manual recording) receive every encoded frame
+ * the replay pipeline produces, so it needs no capture, converter or NVENC
+ * session of its own. The tap callback runs on the NVENC output thread just
+ * before the frame is added to the replay FrameBuffer; frame->data stays
+ * owned by the replay buffer and must be copied, not kept.
+ */
+typedef struct {
+    LONG streamId;              // Changes on every pipeline (re)start
+    RECT captureRect;           // Screen region being captured
+    int width;                  // Encoded size (after OutputHeight scaling)
+    int height;
+    int fps;
+    QualityPreset quality;
+    VideoCodec codec;
+    BYTE seqHeader[MAX_SEQ_HEADER_SIZE];  // HEVC VPS/SPS/PPS or AV1 sequence OBU
+    DWORD seqHeaderSize;
+} ReplayStreamInfo;
+
+/* Describe the stream currently being encoded.
+ * Returns FALSE if the pipeline is not running. Thread-safe. */
+BOOL ReplayBuffer_GetStreamInfo(ReplayStreamInfo* info);
+
+/* Attach the tap. Fails if another tap is attached or the stream is no
+ * longer streamId (pipeline restarted since GetStreamInfo). The tap is
+ * dropped automatically when the pipeline stops. Thread-safe. */
+BOOL ReplayBuffer_AttachStreamTap(LONG streamId, EncodedFrameCallback callback, void* userData);
+
+/* Detach the tap. On return the callback is not running and will not be
+ * called again. No-op if `callback` is not the attached tap. Thread-safe. */
+void ReplayBuffer_DetachStreamTap(EncodedFrameCallback callback);
+
 // Asynchronous save (returns immediately, posts notifyMessage when done)
-// wParam = success (BOOL), lParam = 0
-// Returns FALSE if save cannot be started (not ready, already saving)
+// wParam = success (BOOL), lParam = ReplaySaveResult* (receiver frees)
+// Up to REPLAY_SAVE_QUEUE_DEPTH saves may be outstanding. The buffer thread
+// only pins each clip (in the order their windows are buffered); a worker
+// thread writes them one at a time while capture continues.
+// Returns FALSE if save cannot be started (not ready, queue full)
 BOOL ReplayBuffer_SaveAsync(ReplayBufferState* state, const char* outputPath,
                             HWND notifyWindow, UINT notifyMessage);
 
-int ReplayBuffer_EstimateRAMUsage(int durationSeconds, int width, int height, int fps, QualityPreset quality);
+// Save only [anchor - secondsBack, anchor + secondsAfter] where anchor is the
+// moment of the call. The clip starts at the nearest IDR at or before the
+// window start, and video plus every audio track are trimmed to it, so save
+// time and I/O scale with clip length rather than buffer length. With
+// secondsAfter > 0 the buffer thread keeps capturing and writes the clip once
+// those frames exist (at most REPLAY_RANGE_SAVE_MAX_AFTER_SEC).
+// Notification and failure rules as ReplayBuffer_SaveAsync.
+BOOL ReplayBuffer_SaveRangeAsync(ReplayBufferState* state, const char* outputPath,
+                                 int secondsBack, int secondsAfter,
+                                 HWND notifyWindow, UINT notifyMessage);
+
+// ReplayBuffer_SaveRangeAsync centred on state->markers entry markerIndex
+// (-1 = most recent marker). Fails if there is no such marker.
+BOOL ReplayBuffer_SaveMarkerAsync(ReplayBufferState* state, const char* outputPath,
+                                  int markerIndex, int secondsBefore, int secondsAfter,
+                                  HWND notifyWindow, UINT notifyMessage);
+
+// Write the whole buffer to outputPath, then keep appending every new
+// encoded frame and mixed-track AAC sample from the running pipeline until
+// ReplayBuffer_EndContinuousSave (or the pipeline stops). One file, no
+// second encode, no gap between the buffered and live parts. The writer
+// thread pulls new frames from the FrameBuffer every
+// REPLAY_CONTINUOUS_POLL_MS, so nothing is lost unless it falls a whole
+// buffer behind (logged; the file then resumes at the next IDR). Only the
+// mixed audio track is written. notifyMessage is posted once the file is
+// finalized, as for ReplayBuffer_SaveAsync. Fails if one is already running.
+BOOL ReplayBuffer_BeginContinuousSave(ReplayBufferState* state, const char* outputPath,
+                                      HWND notifyWindow, UINT notifyMessage);
+
+// Stop appending: the writer flushes what is buffered up to now, finalizes
+// the file and posts the notification. Returns immediately. No-op if no
+// continuous save is running.
+void ReplayBuffer_EndContinuousSave(ReplayBufferState* state);
+
+// TRUE from a successful Begin until the file is finalized. Thread-safe.
+BOOL ReplayBuffer_IsContinuousSaving(const ReplayBufferState* state);
+
+// width/height are the encoded size, i.e. after Util_ScaleToHeight with
+// g_config.replayOutputHeight, not the capture size; codec is the encoder's
+// (NVENCEncoder_GetCodec), AV1 estimates AV1_BITRATE_SCALE of HEVC
+int ReplayBuffer_EstimateRAMUsage(int durationSeconds, int width, int height, int fps, QualityPreset quality,
+                                  VideoCodec codec);
 #endif
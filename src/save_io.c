@@ -0,0 +1,225 @@
+/*
+ * save_io.c - Overlapped, unbuffered sequential file output for saves
+ *
+ * USED BY: mp4_writer.c (replay saves)
+ *
+ * Buffers are filled in ring order. Filling buffer i+1 starts only after
+ * its previous write (SAVE_IO_BUFFERS writes ago) has completed, so the
+ * caller blocks only when the drive is a full ring behind. That holds only
+ * when Open could move the valid data length (io->overlapped); otherwise
+ * each WriteFile extends it and returns once written, and the ring is
+ * just a sequence of large unbuffered writes.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for simple validation/precondition checks
+ * - Open uses goto-cleanup; a failed open leaves nothing to close
+ * - Win32 failures logged with GetLastError and latched in io->failed
+ * - Close always releases everything; a failed file is deleted
+ */
+
+#include "save_io.h"
+#include "logger.h"
+#include "mem_utils.h"
+
+// Alias for logging
+#define SaveIOLog Logger_Log
+
+#define BUFFER_BYTES ((size_t)SAVE_IO_BUFFER_MB * 1024 * 1024)
+
+static void FreeBuffers(SaveIO* io) {
+    for (int i = 0; i < SAVE_IO_BUFFERS; i++) {
+        SaveIOBuffer* buf = &io->buffers[i];
+        if (buf->data) VirtualFree(buf->data, 0, MEM_RELEASE);
+        buf->data = NULL;
+        SAFE_CLOSE_HANDLE(buf->ov.hEvent);
+    }
+}
+
+// Enable SeManageVolumePrivilege in the process token, needed for
+// SetFileValidData. Held by elevated administrators only. Checked once per
+// process.
+static BOOL EnableManageVolumePrivilege(void) {
+    static LONG s_state = 0;    // 0 = not tried, 1 = enabled, -1 = unavailable
+    if (s_state != 0) return s_state > 0;
+
+    BOOL enabled = FALSE;
+    HANDLE token = NULL;
+    if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+        TOKEN_PRIVILEGES tp;
+        ZeroMemory(&tp, sizeof(tp));
+        tp.PrivilegeCount = 1;
+        tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if (LookupPrivilegeValueA(NULL, SE_MANAGE_VOLUME_NAME, &tp.Privileges[0].Luid) &&
+            AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL)) {
+            // Succeeds with ERROR_NOT_ALL_ASSIGNED when the account lacks it
+            enabled = (GetLastError() == ERROR_SUCCESS);
+        }
+        CloseHandle(token);
+    }
+    InterlockedExchange(&s_state, enabled ? 1 : -1);
+    return enabled;
+}
+
+// Wait out the buffer's write, if one is in flight
+static void WaitBuffer(SaveIO* io, SaveIOBuffer* buf) {
+    if (!buf->pending) return;
+    buf->pending = FALSE;
+
+    DWORD done = 0;
+    if (!GetOverlappedResult(io->file, &buf->ov, &done, TRUE) || done != buf->length) {
+        SaveIOLog("SaveIO: write of %lu bytes failed (%lu done, error %lu)\n",
+                  buf->length, done, GetLastError());
+        io->failed = TRUE;
+    }
+}
+
+// Start writing length bytes of the current buffer at io->offset
+static void SubmitCurrent(SaveIO* io, DWORD length) {
+    SaveIOBuffer* buf = &io->buffers[io->current];
+    HANDLE event = buf->ov.hEvent;
+    ZeroMemory(&buf->ov, sizeof(buf->ov));
+    buf->ov.hEvent = event;
+    buf->ov.Offset = (DWORD)io->offset;
+    buf->ov.OffsetHigh = (DWORD)(io->offset >> 32);
+    buf->length = length;
+
+    if (!WriteFile(io->file, buf->data, length, NULL, &buf->ov) && GetLastError() != ERROR_IO_PENDING) {
+        SaveIOLog("SaveIO: WriteFile at %llu failed (error %lu)\n", io->offset, GetLastError());
+        io->failed = TRUE;
+        return;
+    }
+    // Completed synchronously or queued: either way the event is signaled
+    buf->pending = TRUE;
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: SaveIO_Open
+ * Resources: 2 per buffer (VirtualAlloc block, event) + file handle
+ * Pattern: goto-cleanup in reverse acquisition order
+ * Init: ZeroMemory ensures NULL initialization
+ */
+BOOL SaveIO_Open(SaveIO* io, const WCHAR* path, UINT64 expectedBytes) {
+    LWSR_ASSERT(io != NULL);
+    LWSR_ASSERT(path != NULL);
+
+    if (!io) return FALSE;
+    ZeroMemory(io, sizeof(*io));
+    io->file = INVALID_HANDLE_VALUE;
+    if (!path || !path[0] || wcslen(path) >= MAX_PATH) return FALSE;
+    wcscpy_s(io->path, MAX_PATH, path);
+
+    for (int i = 0; i < SAVE_IO_BUFFERS; i++) {
+        SaveIOBuffer* buf = &io->buffers[i];
+        // VirtualAlloc blocks are page aligned, which satisfies any sector size
+        buf->data = (BYTE*)VirtualAlloc(NULL, BUFFER_BYTES, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        buf->ov.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+        if (!buf->data || !buf->ov.hEvent) {
+            SaveIOLog("SaveIO: failed to allocate %d MB buffer %d (error %lu)\n",
+                      SAVE_IO_BUFFER_MB, i, GetLastError());
+            goto cleanup;
+        }
+    }
+
+    io->file = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING, NULL);
+    io->unbuffered = (io->file != INVALID_HANDLE_VALUE);
+    if (!io->unbuffered) {
+        SaveIOLog("SaveIO: unbuffered open failed (error %lu), using the file cache\n", GetLastError());
+        io->file = CreateFileW(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    }
+    if (io->file == INVALID_HANDLE_VALUE) {
+        SaveIOLog("SaveIO: CreateFile failed (error %lu)\n", GetLastError());
+        goto cleanup;
+    }
+
+    // NTFS completes a write that extends end of file or valid data length
+    // synchronously, even on an overlapped handle, so a file that grows
+    // write by write never has two writes in flight. Move both to the padded
+    // expected size up front; Close trims end of file to the bytes written.
+    // Reserving clusters alone (FileAllocationInfo) moves neither.
+    if (expectedBytes > 0) {
+        UINT64 reserve = (expectedBytes + SAVE_IO_ALIGNMENT - 1) & ~((UINT64)SAVE_IO_ALIGNMENT - 1);
+        FILE_END_OF_FILE_INFO eof;
+        eof.EndOfFile.QuadPart = (LONGLONG)reserve;
+        if (!SetFileInformationByHandle(io->file, FileEndOfFileInfo, &eof, sizeof(eof))) {
+            SaveIOLog("SaveIO: extending to %llu MB failed (error %lu), writes will not overlap\n",
+                      reserve / (1024 * 1024), GetLastError());
+        } else if (EnableManageVolumePrivilege() && SetFileValidData(io->file, (LONGLONG)reserve)) {
+            // The range is not zeroed, but every byte kept is written before
+            // Close, which trims the rest or deletes the file
+            io->overlapped = TRUE;
+        } else {
+            SaveIOLog("SaveIO: valid data length not moved (error %lu), writes will not overlap\n",
+                      GetLastError());
+        }
+    }
+    return TRUE;
+
+cleanup:
+    if (io->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(io->file);
+        DeleteFileW(path);
+    }
+    io->file = INVALID_HANDLE_VALUE;
+    FreeBuffers(io);
+    return FALSE;
+}
+
+BOOL SaveIO_Write(SaveIO* io, const void* data, size_t size) {
+    LWSR_ASSERT(io != NULL);
+
+    const BYTE* src = (const BYTE*)data;
+    while (size > 0 && !io->failed) {
+        size_t room = BUFFER_BYTES - io->used;
+        size_t n = size < room ? size : room;
+        memcpy(io->buffers[io->current].data + io->used, src, n);
+        io->used += n;
+        io->written += n;
+        src += n;
+        size -= n;
+
+        if (io->used == BUFFER_BYTES) {
+            SubmitCurrent(io, (DWORD)BUFFER_BYTES);
+            io->offset += BUFFER_BYTES;
+            io->current = (io->current + 1) % SAVE_IO_BUFFERS;
+            io->used = 0;
+            WaitBuffer(io, &io->buffers[io->current]);
+        }
+    }
+    return !io->failed;
+}
+
+BOOL SaveIO_Close(SaveIO* io, BOOL keep) {
+    LWSR_ASSERT(io != NULL);
+
+    if (!io || io->file == INVALID_HANDLE_VALUE) return FALSE;
+
+    // Unbuffered writes must be whole sectors: pad the tail, trim after
+    if (keep && !io->failed && io->used > 0) {
+        size_t length = io->used;
+        if (io->unbuffered) {
+            length = (length + SAVE_IO_ALIGNMENT - 1) & ~((size_t)SAVE_IO_ALIGNMENT - 1);
+            ZeroMemory(io->buffers[io->current].data + io->used, length - io->used);
+        }
+        SubmitCurrent(io, (DWORD)length);
+    }
+    for (int i = 0; i < SAVE_IO_BUFFERS; i++) WaitBuffer(io, &io->buffers[i]);
+
+    // Also drops any preallocation beyond the data
+    if (keep && !io->failed) {
+        FILE_END_OF_FILE_INFO eof;
+        eof.EndOfFile.QuadPart = (LONGLONG)io->written;
+        if (!SetFileInformationByHandle(io->file, FileEndOfFileInfo, &eof, sizeof(eof))) {
+            SaveIOLog("SaveIO: setting end of file failed (error %lu)\n", GetLastError());
+            io->failed = TRUE;
+        }
+    }
+
+    BOOL ok = keep && !io->failed;
+    CloseHandle(io->file);
+    io->file = INVALID_HANDLE_VALUE;
+    if (!ok) DeleteFileW(io->path);
+    FreeBuffers(io);
+    return ok;
+}
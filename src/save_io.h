@@ -0,0 +1,66 @@
+/*
+ * save_io.h - Overlapped, unbuffered sequential file output for saves
+ *
+ * USED BY: mp4_writer.c (replay saves)
+ *
+ * A write-once sequential file: bytes are copied into a small ring of
+ * SAVE_IO_BUFFER_MB page-aligned buffers, and each buffer that fills is
+ * written with one overlapped WriteFile while the caller fills the next, so
+ * up to SAVE_IO_BUFFERS writes are in flight. The file is opened
+ * FILE_FLAG_NO_BUFFERING: clip data goes straight to the drive instead of
+ * evicting gigabytes of useful file cache. The last buffer is padded to
+ * SAVE_IO_ALIGNMENT and the end of file trimmed back on close.
+ *
+ * Writes only overlap if end of file and valid data length are already
+ * past them (NTFS completes extending writes synchronously), so Open moves
+ * both to the expected size. Moving valid data length (SetFileValidData)
+ * needs SeManageVolumePrivilege, i.e. an elevated process; without it the
+ * writes run one at a time, still unbuffered and in large requests.
+ *
+ * If the volume refuses unbuffered handles the file is reopened buffered
+ * (still overlapped); callers see no difference.
+ *
+ * Not thread-safe: one writer per SaveIO.
+ */
+
+#ifndef SAVE_IO_H
+#define SAVE_IO_H
+
+#include <windows.h>
+#include "constants.h"
+
+typedef struct {
+    BYTE* data;                 // SAVE_IO_BUFFER_MB, page aligned
+    OVERLAPPED ov;              // ov.hEvent created once per buffer
+    DWORD length;               // Bytes in flight
+    BOOL pending;
+} SaveIOBuffer;
+
+typedef struct {
+    HANDLE file;
+    BOOL unbuffered;            // Opened FILE_FLAG_NO_BUFFERING
+    BOOL overlapped;            // Valid data length preset: writes really overlap
+    SaveIOBuffer buffers[SAVE_IO_BUFFERS];
+    int current;                // Buffer being filled
+    size_t used;                // Bytes in buffers[current]
+    UINT64 offset;              // File offset of buffers[current]
+    UINT64 written;             // Bytes accepted by SaveIO_Write
+    BOOL failed;                // First error latched; later writes are dropped
+    WCHAR path[MAX_PATH];
+} SaveIO;
+
+// Create (truncate) path and its buffers. expectedBytes > 0 extends the file
+// to that size (rounded up to SAVE_IO_ALIGNMENT) up front, and its valid data
+// length too when the privilege is held. Returns FALSE (nothing to close) on
+// failure.
+BOOL SaveIO_Open(SaveIO* io, const WCHAR* path, UINT64 expectedBytes);
+
+// Append size bytes. Returns FALSE once any write has failed.
+BOOL SaveIO_Write(SaveIO* io, const void* data, size_t size);
+
+// Write the tail, wait for every write, set the exact file length and
+// close. keep = FALSE (or any earlier failure) deletes the file. Returns
+// TRUE if the file was completely written and kept.
+BOOL SaveIO_Close(SaveIO* io, BOOL keep);
+
+#endif // SAVE_IO_H
@@ -18,6 +18,7 @@
 #include "audio_device.h"
 #include "aac_encoder.h"
 #include "replay_buffer.h"
+#include "util.h"
 #include "logger.h"
 #include "constants.h"
 #include "mem_utils.h"
@@ -70,6 +71,10 @@ static BOOL s_waitingForMarkerHotkey = FALSE;
 /* Tab state */
 static SettingsTab s_currentTab = SETTINGS_TAB_GENERAL;
 
+/* Refresh of the live replay RAM figures (memory budget mode) */
+#define SETTINGS_LIVE_TIMER_ID   1
+#define SETTINGS_LIVE_TIMER_MS   REPLAY_MEMORY_ACCOUNTING_MS
+
 /* Log child-control creation failures without aborting the dialog. Downstream
  * use (SendMessage, AddToSection, ShowSection) already tolerates NULL HWNDs,
  * so a failed control just leaves a visible gap and a diagnostic line.
@@ -299,6 +304,9 @@ static void UpdateReplayRAMEstimate(HWND hwnd) {
         }
     }
     
+    /* Encoded size, not capture size, drives bitrate ([ReplayBuffer] OutputHeight) */
+    Util_ScaleToHeight(width, height, g_config.replayOutputHeight, &width, &height);
+    
     /* Calculate estimate: ~0.1 bits per pixel for compressed NVENC H.264/H.265
      * This gives roughly 50-60 Mbps for 1080p60, which matches typical recordings */
     double bitsPerPixel = 0.1;
@@ -307,21 +315,39 @@ static void UpdateReplayRAMEstimate(HWND hwnd) {
     double totalBits = bitsPerSecond * duration;
     double totalMB = totalBits / 8.0 / 1024.0 / 1024.0;
     
+    double mbps = bitsPerSecond / 1000000.0;
     char ramText[128];
-    if (totalMB >= 1024.0) {
-        snprintf(ramText, sizeof(ramText), "~%.1f GB RAM", totalMB / 1024.0);
+    char calcText[256];
+    
+    if (g_config.replayMemoryBudgetMB > 0) {
+        /* [ReplayBuffer] MemoryBudgetMB is a hard cap: show it, and the history
+         * that fits under it (live from the buffer thread while buffering) */
+        int budgetMB = g_config.replayMemoryBudgetMB;
+        snprintf(ramText, sizeof(ramText), "%d MB budget", budgetMB);
+        LONG liveMs = g_replayBuffer.isBuffering ? g_replayBuffer.liveBufferedMs : 0;
+        if (liveMs > 0) {
+            snprintf(calcText, sizeof(calcText), "Live: %lds of history in %ld MB",
+                     liveMs / 1000, g_replayBuffer.liveMemoryMB);
+        } else {
+            double fitSec = (double)budgetMB * 1024.0 * 1024.0 * 8.0 / bitsPerSecond;
+            if (fitSec > duration) fitSec = duration;
+            snprintf(calcText, sizeof(calcText), "~%.0fs of %ds fits (~%.0f Mbps)",
+                     fitSec, duration, mbps);
+        }
     } else {
-        snprintf(ramText, sizeof(ramText), "~%.0f MB RAM", totalMB);
+        if (totalMB >= 1024.0) {
+            snprintf(ramText, sizeof(ramText), "~%.1f GB RAM", totalMB / 1024.0);
+        } else {
+            snprintf(ramText, sizeof(ramText), "~%.0f MB RAM", totalMB);
+        }
+        
+        /* Detailed calculation - show bitrate estimate */
+        snprintf(calcText, sizeof(calcText), 
+                 "%dx%d @ %d fps (~%.0f Mbps)", 
+                 width, height, fps, mbps);
     }
     
     SetWindowTextA(GetDlgItem(hwnd, ID_STATIC_REPLAY_RAM), ramText);
-    
-    /* Update detailed calculation - show bitrate estimate */
-    double mbps = bitsPerSecond / 1000000.0;
-    char calcText[256];
-    snprintf(calcText, sizeof(calcText), 
-             "%dx%d @ %d fps (~%.0f Mbps)", 
-             width, height, fps, mbps);
     SetWindowTextA(GetDlgItem(hwnd, ID_STATIC_REPLAY_CALC), calcText);
 }
 
@@ -1286,6 +1312,7 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
              * SwitchToTab assigns s_currentTab itself; no separate assignment needed. */
             SwitchToTab(SETTINGS_TAB_GENERAL);
             UpdateReplayRAMEstimate(hwnd);
+            SetTimer(hwnd, SETTINGS_LIVE_TIMER_ID, SETTINGS_LIVE_TIMER_MS, NULL);
             
             /* Show replay preview if enabled */
             if (g_config.replayEnabled) {
@@ -1498,6 +1525,7 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
                         char exePath[MAX_PATH];
                         char debugFolder[MAX_PATH];
                         char logFilename[MAX_PATH];
+                        const char* logExt = g_config.debugLogBinary ? "lwlog" : "txt";
                         GetModuleFileNameA(NULL, exePath, MAX_PATH);
                         char* lastSlash = strrchr(exePath, '\\');
                         if (lastSlash) {
@@ -1506,9 +1534,10 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
                             CreateDirectoryA(debugFolder, NULL);
                             SYSTEMTIME st;
                             GetLocalTime(&st);
-                            snprintf(logFilename, sizeof(logFilename), "%s\\lwsr_log_%04d%02d%02d_%02d%02d%02d.txt",
-                                    debugFolder, (int)st.wYear, (int)st.wMonth, (int)st.wDay, (int)st.wHour, (int)st.wMinute, (int)st.wSecond);
-                            if (!Logger_Init(logFilename, "w")) {
+                            snprintf(logFilename, sizeof(logFilename), "%s\\lwsr_log_%04d%02d%02d_%02d%02d%02d.%s",
+                                    debugFolder, (int)st.wYear, (int)st.wMonth, (int)st.wDay, (int)st.wHour, (int)st.wMinute, (int)st.wSecond, logExt);
+                            if (!Logger_InitEx(logFilename, "w",
+                                               g_config.debugLogBinary ? LOG_FORMAT_BINARY : LOG_FORMAT_TEXT)) {
                                 MessageBoxA(hwnd,
                                     "Failed to create debug log file. Check write permissions for the Debug folder.",
                                     "Debug Logging", MB_OK | MB_ICONWARNING);
@@ -1733,9 +1762,15 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
             break;
             
         case WM_TIMER:
+            /* Live seconds-of-history under a memory budget */
+            if (wParam == SETTINGS_LIVE_TIMER_ID && s_currentTab == SETTINGS_TAB_VIDEO &&
+                g_config.replayMemoryBudgetMB > 0 && g_replayBuffer.isBuffering) {
+                UpdateReplayRAMEstimate(hwnd);
+            }
             break;
 
         case WM_CLOSE: {
+            KillTimer(hwnd, SETTINGS_LIVE_TIMER_ID);
             /* Apply replay duration change once, on close, to avoid the race
              * where rapid in-place Stop/Start hangs and leaks the encoder.
              * Runs on a worker thread so the UI close stays responsive. */
@@ -1748,6 +1783,7 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
             s_replayDurationAtOpen = -1;
             SaveAreaSelectorPosition();
             AreaSelector_Hide();
+            HideReplayPreview();
             
             /* Save time limit */
             int hours = (int)SendMessage(GetDlgItem(hwnd, ID_CMB_HOURS), CB_GETCURSEL, 0, 0);
@@ -1776,13 +1812,14 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
             s_settingsWnd = NULL;
             if (s_externalHandleRef) *s_externalHandleRef = NULL;
             
-            /* Refresh mode buttons and settings button in control panel.
+            /* Refresh mode buttons and settings button in control panel (no
+             * erase: their WM_DRAWITEM fills the whole item).
              * IDs imported from overlay.h. */
             if (g_controlWnd) {
-                InvalidateRect(GetDlgItem(g_controlWnd, ID_MODE_AREA), NULL, TRUE);
-                InvalidateRect(GetDlgItem(g_controlWnd, ID_MODE_WINDOW), NULL, TRUE);
-                InvalidateRect(GetDlgItem(g_controlWnd, ID_MODE_MONITOR), NULL, TRUE);
-                InvalidateRect(GetDlgItem(g_controlWnd, ID_BTN_SETTINGS), NULL, TRUE);
+                InvalidateRect(GetDlgItem(g_controlWnd, ID_MODE_AREA), NULL, FALSE);
+                InvalidateRect(GetDlgItem(g_controlWnd, ID_MODE_WINDOW), NULL, FALSE);
+                InvalidateRect(GetDlgItem(g_controlWnd, ID_MODE_MONITOR), NULL, FALSE);
+                InvalidateRect(GetDlgItem(g_controlWnd, ID_BTN_SETTINGS), NULL, FALSE);
             }
             return 0;
         }
@@ -1903,7 +1940,7 @@ void SettingsDialog_SwitchTab(SettingsTab tab) {
  * per-game UI in CreateGeneralSection can reference them. */
 static const char* REGION_OVERLAY_CLASS = "LWSRRegionOverlay";
 /* Repaint the region overlay 5x/sec so the dynamic match rect tracks the
- * sampler (which scans every SCAN_INTERVAL_MS ≈ 2s). Cheap — just redraws a
+ * sampler (which scans every 125 ms-2 s while the region changes). Cheap — just redraws a
  * full-screen layered bitmap with two rects + a label. */
 #define REGION_OVERLAY_TIMER_ID  1
 #define REGION_OVERLAY_TIMER_MS  200
@@ -0,0 +1,681 @@
+/*
+ * soak_bench.c - Headless end-to-end soak benchmark
+ *
+ * USES: replay_buffer (the pipeline under test), capture (synthetic
+ *       source), audio_capture (tone sources), pipeline_stats, metrics
+ *
+ * The benchmark drives g_replayBuffer the way main.c does, from the main
+ * thread: start, wait until ready, warm up, take baselines, then once a
+ * second sample process CPU time, working set and encoder utilisation
+ * while queueing full-buffer saves on the requested cadence. Save
+ * completions arrive on a message-only window, exactly as the UI gets
+ * them. Frame counts and failures are differences of the metrics registry
+ * counters against the baselines; stage latencies come from
+ * pipeline_stats, reset when measuring starts (a sample racing the reset
+ * may survive it, which is noise at this scale).
+ *
+ * Encoder utilisation comes from NVML (nvml.dll, installed with the
+ * driver), loaded at run time like the NVENC runtime. NVML has no adapter
+ * LUID to match against DXGI, so the highest utilisation across NVIDIA
+ * devices is taken; only one is encoding during a run. Without NVML the
+ * report says so instead of guessing.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Early return for option parsing
+ * - Goto-cleanup in SoakBench_Run (capture, replay buffer, window, NVML)
+ * - The report is written whenever the pipeline got going; its "ok" field
+ *   and the exit code say whether the run was clean
+ */
+
+#include "soak_bench.h"
+#include "main.h"
+#include "replay_buffer.h"
+#include "capture.h"
+#include "audio_capture.h"
+#include "audio_device.h"
+#include "pipeline_stats.h"
+#include "metrics.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include "bench_common.h"
+#include <shellapi.h>
+#include <psapi.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#pragma comment(lib, "psapi.lib")
+
+/* Alias for logging */
+#define BenchLog Logger_Log
+
+#define BENCH_DEFAULT_SECONDS       300
+#define BENCH_DEFAULT_WARMUP        5
+#define BENCH_DEFAULT_SAVE_EVERY    60
+#define BENCH_READY_TIMEOUT_MS      30000   /* Pipeline start to MIN_FRAMES_FOR_SAVE */
+#define BENCH_SAMPLE_MS             1000    /* CPU / memory / NVML sampling period */
+#define BENCH_DRAIN_TIMEOUT_MS      60000   /* Outstanding saves after the run */
+#define BENCH_MAX_SAVES             1024
+#define BENCH_TONE_SOURCE1          "tone:440"
+#define BENCH_TONE_SOURCE2          "tone:1000"
+
+#define WM_BENCH_SAVE_DONE          (WM_USER + 1)   /* Private to the notify window */
+#define BENCH_WINDOW_CLASS          L"LWSRBenchNotify"
+
+/* ============================================================================
+ * COMMAND LINE
+ * ============================================================================
+ */
+
+/* One line to the console that started us, if any (GUI subsystem: no stdout) */
+static void Report(const char* fmt, ...) {
+    if (!AttachConsole(ATTACH_PARENT_PROCESS) && GetLastError() != ERROR_ACCESS_DENIED) return;
+    HANDLE out = CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+    if (out == INVALID_HANDLE_VALUE) return;
+
+    char line[1024];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n > 0) {
+        DWORD written;
+        WriteConsoleA(out, line, (DWORD)strlen(line), &written, NULL);
+    }
+    CloseHandle(out);
+}
+
+static BOOL ParseInt(const WCHAR* text, int minValue, int maxValue, int* value) {
+    WCHAR* end = NULL;
+    long v = wcstol(text, &end, 10);
+    if (end == text || *end != L'\0' || v < minValue || v > maxValue) return FALSE;
+    *value = (int)v;
+    return TRUE;
+}
+
+static BOOL ParseSize(const WCHAR* text, int* width, int* height) {
+    int w = 0, h = 0;
+    if (swscanf(text, L"%dx%d", &w, &h) != 2) return FALSE;
+    if (w < 64 || h < 64 || w > 8192 || h > 8192) return FALSE;
+    *width = w;
+    *height = h;
+    return TRUE;
+}
+
+static void DefaultReportPath(WCHAR* path) {
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    swprintf(path, MAX_PATH, L"lwsr_bench_%04d%02d%02d_%02d%02d%02d.json",
+             (int)st.wYear, (int)st.wMonth, (int)st.wDay,
+             (int)st.wHour, (int)st.wMinute, (int)st.wSecond);
+}
+
+BOOL SoakBench_ParseCommandLine(SoakBenchOptions* options) {
+    LWSR_ASSERT(options != NULL);
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) return FALSE;
+    if (argc < 2 || wcscmp(argv[1], L"--bench") != 0) {
+        LocalFree(argv);
+        return FALSE;
+    }
+
+    ZeroMemory(options, sizeof(*options));
+    options->seconds = BENCH_DEFAULT_SECONDS;
+    options->warmupSeconds = BENCH_DEFAULT_WARMUP;
+    options->saveEverySeconds = BENCH_DEFAULT_SAVE_EVERY;
+    DefaultReportPath(options->reportPath);
+
+    BOOL ok = TRUE;
+    for (int i = 2; i < argc && ok; i++) {
+        const WCHAR* a = argv[i];
+        const WCHAR* next = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (wcscmp(a, L"--pattern") == 0)          options->pattern = TRUE;
+        else if (wcscmp(a, L"--tone") == 0)        options->tone = TRUE;
+        else if (wcscmp(a, L"--no-audio") == 0)    options->noAudio = TRUE;
+        else if (wcscmp(a, L"--keep-clips") == 0)  options->keepClips = TRUE;
+        else if (!next)                            ok = FALSE;
+        else if (wcscmp(a, L"--seconds") == 0)     { ok = ParseInt(next, 1, 7 * 24 * 3600, &options->seconds); i++; }
+        else if (wcscmp(a, L"--warmup") == 0)      { ok = ParseInt(next, 0, 600, &options->warmupSeconds); i++; }
+        else if (wcscmp(a, L"--fps") == 0)         { ok = ParseInt(next, MIN_FPS, MAX_FPS, &options->fps); i++; }
+        else if (wcscmp(a, L"--buffer") == 0)      { ok = ParseInt(next, 1, 3600, &options->bufferSeconds); i++; }
+        else if (wcscmp(a, L"--save-every") == 0)  { ok = ParseInt(next, 0, 3600, &options->saveEverySeconds); i++; }
+        else if (wcscmp(a, L"--size") == 0)        { ok = ParseSize(next, &options->width, &options->height); i++; }
+        else if (wcscmp(a, L"--out") == 0)         { ok = wcslen(next) < MAX_PATH; if (ok) wcscpy_s(options->reportPath, MAX_PATH, next); i++; }
+        else ok = FALSE;
+    }
+    if (ok && options->pattern && options->width == 0) {
+        options->width = 1920;
+        options->height = 1080;
+    }
+    if (ok && options->tone && options->noAudio) ok = FALSE;
+
+    if (!ok) {
+        Report("usage: lwsr.exe --bench [--seconds N] [--warmup N] [--fps N] [--size WxH]\n"
+               "                        [--buffer N] [--save-every N] [--pattern] [--tone | --no-audio]\n"
+               "                        [--keep-clips] [--out report.json]\n");
+    }
+    options->valid = ok;
+    LocalFree(argv);
+    return TRUE;
+}
+
+/* ============================================================================
+ * NVML (encoder utilisation)
+ * ============================================================================
+ * Only the handful of entry points needed, declared here so the NVML SDK
+ * is not a build dependency. Return codes: 0 = NVML_SUCCESS.
+ */
+
+typedef struct NvmlDevice* NvmlDeviceHandle;
+typedef int (*PFN_nvmlInit)(void);
+typedef int (*PFN_nvmlShutdown)(void);
+typedef int (*PFN_nvmlDeviceGetCount)(unsigned int* count);
+typedef int (*PFN_nvmlDeviceGetHandleByIndex)(unsigned int index, NvmlDeviceHandle* device);
+typedef int (*PFN_nvmlDeviceGetEncoderUtilization)(NvmlDeviceHandle device, unsigned int* utilization,
+                                                   unsigned int* samplingPeriodUs);
+
+#define BENCH_NVML_MAX_DEVICES 8
+
+typedef struct {
+    HMODULE lib;
+    PFN_nvmlShutdown shutdown;
+    PFN_nvmlDeviceGetEncoderUtilization getEncoderUtilization;
+    NvmlDeviceHandle devices[BENCH_NVML_MAX_DEVICES];
+    unsigned int deviceCount;
+} BenchNvml;
+
+static BOOL Nvml_Open(BenchNvml* nvml) {
+    ZeroMemory(nvml, sizeof(*nvml));
+    nvml->lib = LoadLibraryExW(L"nvml.dll", NULL, LOAD_LIBRARY_SEARCH_SYSTEM32);
+    if (!nvml->lib) return FALSE;
+
+    PFN_nvmlInit init = (PFN_nvmlInit)GetProcAddress(nvml->lib, "nvmlInit_v2");
+    PFN_nvmlDeviceGetCount getCount = (PFN_nvmlDeviceGetCount)GetProcAddress(nvml->lib, "nvmlDeviceGetCount_v2");
+    PFN_nvmlDeviceGetHandleByIndex getHandle =
+        (PFN_nvmlDeviceGetHandleByIndex)GetProcAddress(nvml->lib, "nvmlDeviceGetHandleByIndex_v2");
+    nvml->shutdown = (PFN_nvmlShutdown)GetProcAddress(nvml->lib, "nvmlShutdown");
+    nvml->getEncoderUtilization =
+        (PFN_nvmlDeviceGetEncoderUtilization)GetProcAddress(nvml->lib, "nvmlDeviceGetEncoderUtilization");
+    if (!init || !getCount || !getHandle || !nvml->shutdown || !nvml->getEncoderUtilization || init() != 0) {
+        FreeLibrary(nvml->lib);
+        ZeroMemory(nvml, sizeof(*nvml));
+        return FALSE;
+    }
+
+    unsigned int count = 0;
+    if (getCount(&count) == 0) {
+        for (unsigned int i = 0; i < count && nvml->deviceCount < BENCH_NVML_MAX_DEVICES; i++) {
+            if (getHandle(i, &nvml->devices[nvml->deviceCount]) == 0) nvml->deviceCount++;
+        }
+    }
+    if (nvml->deviceCount == 0) {
+        nvml->shutdown();
+        FreeLibrary(nvml->lib);
+        ZeroMemory(nvml, sizeof(*nvml));
+        return FALSE;
+    }
+    BenchLog("SoakBench: NVML loaded, %u device(s)\n", nvml->deviceCount);
+    return TRUE;
+}
+
+/* Highest encoder utilisation (percent) across devices, -1 if unavailable */
+static int Nvml_EncoderUtilization(const BenchNvml* nvml) {
+    int best = -1;
+    for (unsigned int i = 0; i < nvml->deviceCount; i++) {
+        unsigned int util = 0, periodUs = 0;
+        if (nvml->getEncoderUtilization(nvml->devices[i], &util, &periodUs) == 0 && (int)util > best) {
+            best = (int)util;
+        }
+    }
+    return best;
+}
+
+static void Nvml_Close(BenchNvml* nvml) {
+    if (!nvml->lib) return;
+    nvml->shutdown();
+    FreeLibrary(nvml->lib);
+    ZeroMemory(nvml, sizeof(*nvml));
+}
+
+/* ============================================================================
+ * RUN
+ * ============================================================================
+ */
+
+typedef struct {
+    LARGE_INTEGER issuedQpc;
+    double latencyMs;           // Request to notification
+    LONGLONG bytes;             // Size of the written clip
+    BOOL done;
+    BOOL success;
+    char path[MAX_PATH];
+} BenchSave;
+
+typedef struct {
+    const SoakBenchOptions* options;
+    LARGE_INTEGER perfFreq;
+    HWND notify;                // Receives WM_BENCH_SAVE_DONE
+
+    BenchSave saves[BENCH_MAX_SAVES];
+    int saveCount;              // Issued
+    int savesDone;              // Notified, in issue order
+    int savesRejected;          // SaveAsync refused (queue full / not ready)
+
+    // Once-a-second samples over the measured window
+    double cpuSum, cpuMax;      // Percent of all logical processors
+    int cpuSamples;
+    double encodeUtilSum;
+    int encodeUtilMax;
+    int encodeUtilSamples;
+    ULONGLONG lastCpuTime;      // Process kernel + user, 100ns
+    LARGE_INTEGER lastCpuQpc;
+} BenchRun;
+
+static BenchRun* g_benchRun = NULL;     // For the notify window (main thread only)
+
+static double QpcMs(LARGE_INTEGER from, LARGE_INTEGER to, LARGE_INTEGER freq) {
+    return (double)(to.QuadPart - from.QuadPart) * 1000.0 / (double)freq.QuadPart;
+}
+
+static ULONGLONG ProcessCpuTime(void) {
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+    return k.QuadPart + u.QuadPart;
+}
+
+static LRESULT CALLBACK BenchWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    if (msg == WM_BENCH_SAVE_DONE) {
+        ReplaySaveResult* result = (ReplaySaveResult*)lParam;
+        BenchRun* run = g_benchRun;
+        // The save worker writes clips one at a time in request order
+        if (run && run->savesDone < run->saveCount) {
+            BenchSave* save = &run->saves[run->savesDone++];
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            save->latencyMs = QpcMs(save->issuedQpc, now, run->perfFreq);
+            save->success = (BOOL)wParam;
+            save->done = TRUE;
+
+            WIN32_FILE_ATTRIBUTE_DATA attrs;
+            if (GetFileAttributesExA(save->path, GetFileExInfoStandard, &attrs)) {
+                save->bytes = ((LONGLONG)attrs.nFileSizeHigh << 32) | attrs.nFileSizeLow;
+            }
+            if (!run->options->keepClips) DeleteFileA(save->path);
+            BenchLog("SoakBench: save %d %s in %.0f ms (%lld bytes)\n", run->savesDone,
+                     save->success ? "done" : "FAILED", save->latencyMs, save->bytes);
+        }
+        free(result);
+        return 0;
+    }
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+static HWND CreateNotifyWindow(void) {
+    WNDCLASSEXW wc = {0};
+    wc.cbSize = sizeof(wc);
+    wc.lpfnWndProc = BenchWndProc;
+    wc.hInstance = GetModuleHandleW(NULL);
+    wc.lpszClassName = BENCH_WINDOW_CLASS;
+    RegisterClassExW(&wc);  // Already registered is fine
+    return CreateWindowExW(0, BENCH_WINDOW_CLASS, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, wc.hInstance, NULL);
+}
+
+/* Dispatch messages until `until` fires or timeoutMs passes.
+ * Returns TRUE if the handle was signalled (NULL handle: always FALSE). */
+static BOOL PumpFor(HANDLE until, DWORD timeoutMs) {
+    ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    for (;;) {
+        MSG msg;
+        while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&msg);
+            DispatchMessageW(&msg);
+        }
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline) return FALSE;
+        DWORD wait = (DWORD)(deadline - now);
+        DWORD r = until ? MsgWaitForMultipleObjects(1, &until, FALSE, wait, QS_ALLINPUT)
+                        : MsgWaitForMultipleObjects(0, NULL, FALSE, wait, QS_ALLINPUT);
+        if (until && r == WAIT_OBJECT_0) return TRUE;
+    }
+}
+
+static void SampleProcess(BenchRun* run, const BenchNvml* nvml) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    ULONGLONG cpu = ProcessCpuTime();
+    double wallMs = QpcMs(run->lastCpuQpc, now, run->perfFreq);
+    if (wallMs > 0.0) {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        double pct = (double)(cpu - run->lastCpuTime) / 10000.0 / wallMs * 100.0 /
+                     (double)max(1, (int)si.dwNumberOfProcessors);
+        run->cpuSum += pct;
+        if (pct > run->cpuMax) run->cpuMax = pct;
+        run->cpuSamples++;
+    }
+    run->lastCpuTime = cpu;
+    run->lastCpuQpc = now;
+
+    int util = Nvml_EncoderUtilization(nvml);
+    if (util >= 0) {
+        run->encodeUtilSum += util;
+        if (util > run->encodeUtilMax) run->encodeUtilMax = util;
+        run->encodeUtilSamples++;
+    }
+}
+
+static void IssueSave(BenchRun* run) {
+    if (run->saveCount >= BENCH_MAX_SAVES) return;
+    BenchSave* save = &run->saves[run->saveCount];
+    char tempDir[MAX_PATH];
+    DWORD n = GetTempPathA(MAX_PATH, tempDir);
+    if (n == 0 || n >= MAX_PATH) return;
+    snprintf(save->path, MAX_PATH, "%slwsr_bench_%lu_%03d.mp4",
+             tempDir, GetCurrentProcessId(), run->saveCount + 1);
+
+    QueryPerformanceCounter(&save->issuedQpc);
+    if (ReplayBuffer_SaveAsync(&g_replayBuffer, save->path, run->notify, WM_BENCH_SAVE_DONE)) {
+        run->saveCount++;
+    } else {
+        run->savesRejected++;
+        BenchLog("SoakBench: save request refused (queue full or not ready)\n");
+    }
+}
+
+typedef struct {
+    LONGLONG encoded, staticFrames, duplicated, skipped;
+    LONGLONG captureNull, convertNull, encodeFail;
+} BenchCounters;
+
+static void ReadCounters(BenchCounters* c) {
+    c->encoded = Metrics_GetCounter(METRIC_REPLAY_FRAMES_ENCODED);
+    c->staticFrames = Metrics_GetCounter(METRIC_REPLAY_FRAMES_STATIC);
+    c->duplicated = Metrics_GetCounter(METRIC_REPLAY_FRAMES_DUPLICATED);
+    c->skipped = Metrics_GetCounter(METRIC_REPLAY_FRAMES_SKIPPED);
+    c->captureNull = Metrics_GetCounter(METRIC_REPLAY_CAPTURE_NULL);
+    c->convertNull = Metrics_GetCounter(METRIC_REPLAY_CONVERT_NULL);
+    c->encodeFail = Metrics_GetCounter(METRIC_REPLAY_ENCODE_FAIL);
+}
+
+static BOOL WriteReport(const BenchRun* run, const ReplayStreamInfo* stream, BOOL pipelineOk,
+                        double elapsedSec, const BenchCounters* d, const BenchNvml* nvml, BOOL ok) {
+    const SoakBenchOptions* o = run->options;
+    FILE* f = _wfopen(o->reportPath, L"w");
+    if (!f) {
+        BenchLog("SoakBench: cannot write report %ls\n", o->reportPath);
+        return FALSE;
+    }
+
+    LONGLONG expected = (LONGLONG)(elapsedSec * stream->fps + 0.5);
+    LONGLONG dropped = d->captureNull + d->convertNull + d->encodeFail + d->skipped;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"ok\": %s,\n", ok ? "true" : "false");
+    fprintf(f, "  \"pipeline_ok\": %s,\n", pipelineOk ? "true" : "false");
+    fprintf(f, "  \"config\": {\"source\": \"%s\", \"audio\": \"%s\", \"width\": %d, \"height\": %d, "
+               "\"fps\": %d, \"codec\": \"%s\", \"quality\": %d, \"timing\": \"%s\", "
+               "\"buffer_seconds\": %d, \"seconds\": %d, \"warmup_seconds\": %d, \"save_every_seconds\": %d},\n",
+            o->pattern ? "pattern" : "desktop",
+            o->noAudio || !g_config.audioEnabled ? "none" : (o->tone ? "tone" : "configured"),
+            stream->width, stream->height, stream->fps,
+            stream->codec == CODEC_AV1 ? "av1" : "hevc", (int)stream->quality,
+            g_config.frameTimingMode == FRAME_TIMING_VFR ? "vfr" : "cfr",
+            g_config.replayDuration, o->seconds, o->warmupSeconds, o->saveEverySeconds);
+
+    fprintf(f, "  \"elapsed_seconds\": %.3f,\n", elapsedSec);
+    fprintf(f, "  \"frames\": {\"expected\": %lld, \"encoded\": %lld, \"achieved_fps\": %.3f, "
+               "\"static\": %lld, \"duplicated\": %lld, \"skipped\": %lld, \"dropped\": %lld, "
+               "\"capture_failed\": %lld, \"convert_failed\": %lld, \"encode_failed\": %lld},\n",
+            expected, d->encoded, elapsedSec > 0.0 ? (double)d->encoded / elapsedSec : 0.0,
+            d->staticFrames, d->duplicated, d->skipped, dropped,
+            d->captureNull, d->convertNull, d->encodeFail);
+
+    fprintf(f, "  \"stages_ms\": {");
+    BOOL first = TRUE;
+    for (int s = 0; s < PIPELINE_STAGE_COUNT; s++) {
+        PipelineStageStats st;
+        if (!PipelineStats_GetStage((PipelineStage)s, &st)) continue;
+        fprintf(f, "%s\n    \"%s\": {\"count\": %ld, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+                   "\"p99\": %.3f, \"max\": %.3f}",
+                first ? "" : ",", PipelineStats_StageName((PipelineStage)s),
+                st.count, st.meanMs, st.p50Ms, st.p90Ms, st.p99Ms, st.maxMs);
+        first = FALSE;
+    }
+    fprintf(f, "%s},\n", first ? "" : "\n  ");
+
+    MetricsHistogramStats frameBytes;
+    Metrics_GetHistogram(METRIC_HIST_NVENC_FRAME_BYTES, &frameBytes);
+    double avgFrameBytes = frameBytes.count > 0 ? (double)frameBytes.sum / (double)frameBytes.count : 0.0;
+    fprintf(f, "  \"bitrate_mbps\": %.3f,\n", avgFrameBytes * 8.0 * stream->fps / 1e6);
+
+    double latencies[BENCH_MAX_SAVES];
+    int latencyCount = 0, saveFailures = 0;
+    LONGLONG saveBytes = 0;
+    for (int i = 0; i < run->savesDone; i++) {
+        if (!run->saves[i].success) {
+            saveFailures++;
+            continue;
+        }
+        latencies[latencyCount++] = run->saves[i].latencyMs;
+        saveBytes += run->saves[i].bytes;
+    }
+    qsort(latencies, (size_t)latencyCount, sizeof(latencies[0]), Bench_CompareDouble);
+    double latencySum = 0.0;
+    for (int i = 0; i < latencyCount; i++) latencySum += latencies[i];
+    fprintf(f, "  \"saves\": {\"issued\": %d, \"completed\": %d, \"failed\": %d, \"refused\": %d, "
+               "\"unfinished\": %d, \"avg_bytes\": %lld, \"latency_ms\": {\"mean\": %.1f, \"p50\": %.1f, "
+               "\"p90\": %.1f, \"max\": %.1f}},\n",
+            run->saveCount, latencyCount, saveFailures, run->savesRejected,
+            run->saveCount - run->savesDone, latencyCount > 0 ? saveBytes / latencyCount : 0,
+            latencyCount > 0 ? latencySum / latencyCount : 0.0,
+            Bench_Percentile(latencies, latencyCount, 0.50), Bench_Percentile(latencies, latencyCount, 0.90),
+            latencyCount > 0 ? latencies[latencyCount - 1] : 0.0);
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    fprintf(f, "  \"cpu_percent\": {\"mean\": %.2f, \"max\": %.2f, \"logical_processors\": %lu},\n",
+            run->cpuSamples > 0 ? run->cpuSum / run->cpuSamples : 0.0, run->cpuMax,
+            si.dwNumberOfProcessors);
+
+    if (run->encodeUtilSamples > 0) {
+        fprintf(f, "  \"gpu_encode_percent\": {\"source\": \"nvml\", \"mean\": %.1f, \"max\": %d},\n",
+                run->encodeUtilSum / run->encodeUtilSamples, run->encodeUtilMax);
+    } else {
+        fprintf(f, "  \"gpu_encode_percent\": {\"source\": \"%s\", \"mean\": null, \"max\": null},\n",
+                nvml->lib ? "nvml" : "unavailable");
+    }
+
+    PROCESS_MEMORY_COUNTERS pmc = {0};
+    pmc.cb = sizeof(pmc);
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    fprintf(f, "  \"memory_mb\": {\"peak_working_set\": %.1f, \"peak_commit\": %.1f, \"buffer\": %ld}\n",
+            (double)pmc.PeakWorkingSetSize / (1024.0 * 1024.0),
+            (double)pmc.PeakPagefileUsage / (1024.0 * 1024.0),
+            InterlockedCompareExchange(&g_replayBuffer.liveMemoryMB, 0, 0));
+    fprintf(f, "}\n");
+
+    BOOL written = (ferror(f) == 0);
+    fclose(f);
+
+    Report("lwsr: bench %s: %lld/%lld frames (%.2f fps of %d), %lld dropped, %lld duplicated, "
+           "%d/%d saves, cpu %.1f%%, peak ws %.0f MB\nlwsr: report %ls\n",
+           ok ? "ok" : "FAILED", d->encoded, expected,
+           elapsedSec > 0.0 ? (double)d->encoded / elapsedSec : 0.0, stream->fps,
+           dropped, d->duplicated, latencyCount, run->saveCount,
+           run->cpuSamples > 0 ? run->cpuSum / run->cpuSamples : 0.0,
+           (double)pmc.PeakWorkingSetSize / (1024.0 * 1024.0), o->reportPath);
+    return written;
+}
+
+/* Point g_config at what the benchmark asked for (never saved) */
+static void ApplyOptions(const SoakBenchOptions* o) {
+    g_config.replayEnabled = TRUE;
+    g_config.autoClipEnabled = FALSE;
+    g_config.replayAspectRatio = 0;
+    if (o->fps > 0) g_config.replayFPS = o->fps;
+    if (o->bufferSeconds > 0) g_config.replayDuration = o->bufferSeconds;
+    // The pattern is generated at --size; the desktop is scaled to its height
+    if (o->height > 0) g_config.replayOutputHeight = o->pattern ? 0 : o->height;
+    if (o->noAudio) {
+        g_config.audioEnabled = FALSE;
+    } else if (o->tone) {
+        g_config.audioEnabled = TRUE;
+        strcpy_s(g_config.audioSource1, sizeof(g_config.audioSource1), BENCH_TONE_SOURCE1);
+        strcpy_s(g_config.audioSource2, sizeof(g_config.audioSource2), BENCH_TONE_SOURCE2);
+        g_config.audioSource3[0] = '\0';
+    }
+}
+
+/*
+ * MULTI-RESOURCE FUNCTION: SoakBench_Run
+ * Resources: 5 - run (calloc), capture, replay buffer (+ audio), notify window, NVML
+ * Pattern: goto-cleanup with init flags
+ */
+BOOL SoakBench_Run(const SoakBenchOptions* options) {
+    LWSR_ASSERT(options != NULL && options->valid);
+
+    BenchRun* run = NULL;
+    BenchNvml nvml = {0};
+    HWND notify = NULL;
+    BOOL captureInited = FALSE;
+    BOOL replayInited = FALSE;
+    BOOL pipelineOk = FALSE;
+    BOOL ok = FALSE;
+
+    run = (BenchRun*)calloc(1, sizeof(BenchRun));
+    if (!run) goto cleanup;
+    run->options = options;
+    QueryPerformanceFrequency(&run->perfFreq);
+    g_benchRun = run;
+
+    ApplyOptions(options);
+    BenchLog("SoakBench: %ds (+%ds warmup), %s source, save every %ds\n",
+             options->seconds, options->warmupSeconds,
+             options->pattern ? "pattern" : "desktop", options->saveEverySeconds);
+
+    if (!Capture_Init(&g_capture)) {
+        Report("lwsr: bench: capture init failed\n");
+        goto cleanup;
+    }
+    captureInited = TRUE;
+    if (options->pattern && !Capture_SetSyntheticSource(&g_capture, options->width, options->height)) {
+        Report("lwsr: bench: synthetic source failed\n");
+        goto cleanup;
+    }
+
+    notify = CreateNotifyWindow();
+    if (!notify) {
+        Report("lwsr: bench: notify window failed (%lu)\n", GetLastError());
+        goto cleanup;
+    }
+    run->notify = notify;
+    if (!Nvml_Open(&nvml)) BenchLog("SoakBench: NVML unavailable, no encoder utilisation\n");
+
+    ReplayBuffer_Init(&g_replayBuffer);
+    replayInited = TRUE;
+    if (!ReplayBuffer_Start(&g_replayBuffer, &g_config) ||
+        !PumpFor(g_replayBuffer.hReadyEvent, BENCH_READY_TIMEOUT_MS)) {
+        Report("lwsr: bench: replay pipeline did not become ready\n");
+        goto cleanup;
+    }
+    if (g_config.audioEnabled && InterlockedCompareExchange(&g_replayBuffer.audioError, 0, 0) != AAC_OK) {
+        BenchLog("SoakBench: audio pipeline failed, continuing video only\n");
+    }
+
+    ReplayStreamInfo stream;
+    if (!ReplayBuffer_GetStreamInfo(&stream)) goto cleanup;
+
+    PumpFor(NULL, (DWORD)options->warmupSeconds * 1000);
+
+    // Baselines: everything reported is the measured window only
+    BenchCounters before, after, delta;
+    ReadCounters(&before);
+    PipelineStats_Reset();
+    Metrics_ResetHistogram(METRIC_HIST_NVENC_FRAME_BYTES);
+    LARGE_INTEGER startQpc, nowQpc;
+    QueryPerformanceCounter(&startQpc);
+    run->lastCpuQpc = startQpc;
+    run->lastCpuTime = ProcessCpuTime();
+
+    pipelineOk = TRUE;
+    ULONGLONG startMs = GetTickCount64();
+    ULONGLONG endMs = startMs + (ULONGLONG)options->seconds * 1000;
+    ULONGLONG nextSampleMs = startMs + BENCH_SAMPLE_MS;
+    ULONGLONG nextSaveMs = options->saveEverySeconds > 0
+        ? startMs + (ULONGLONG)options->saveEverySeconds * 1000 : ULLONG_MAX;
+
+    for (;;) {
+        ULONGLONG now = GetTickCount64();
+        if (now >= endMs) break;
+        if (InterlockedCompareExchange(&g_replayBuffer.state, 0, 0) != REPLAY_STATE_CAPTURING) {
+            BenchLog("SoakBench: pipeline left the capturing state after %llu ms\n", now - startMs);
+            pipelineOk = FALSE;
+            break;
+        }
+        if (now >= nextSampleMs) {
+            SampleProcess(run, &nvml);
+            nextSampleMs += BENCH_SAMPLE_MS;
+        }
+        if (now >= nextSaveMs) {
+            IssueSave(run);
+            nextSaveMs += (ULONGLONG)options->saveEverySeconds * 1000;
+        }
+        ULONGLONG next = min(endMs, min(nextSampleMs, nextSaveMs));
+        PumpFor(NULL, (DWORD)(next > now ? next - now : 0));
+    }
+
+    QueryPerformanceCounter(&nowQpc);
+    ReadCounters(&after);
+    delta.encoded = after.encoded - before.encoded;
+    delta.staticFrames = after.staticFrames - before.staticFrames;
+    delta.duplicated = after.duplicated - before.duplicated;
+    delta.skipped = after.skipped - before.skipped;
+    delta.captureNull = after.captureNull - before.captureNull;
+    delta.convertNull = after.convertNull - before.convertNull;
+    delta.encodeFail = after.encodeFail - before.encodeFail;
+    double elapsedSec = QpcMs(startQpc, nowQpc, run->perfFreq) / 1000.0;
+
+    // Let outstanding saves finish (they are part of the measurement)
+    ULONGLONG drainEnd = GetTickCount64() + BENCH_DRAIN_TIMEOUT_MS;
+    while (run->savesDone < run->saveCount && GetTickCount64() < drainEnd) {
+        PumpFor(NULL, 100);
+    }
+
+    int failedSaves = 0;
+    for (int i = 0; i < run->savesDone; i++) {
+        if (!run->saves[i].success) failedSaves++;
+    }
+    ok = pipelineOk && failedSaves == 0 && run->savesDone == run->saveCount && run->savesRejected == 0;
+    if (!WriteReport(run, &stream, pipelineOk, elapsedSec, &delta, &nvml, ok)) ok = FALSE;
+
+cleanup:
+    if (replayInited) {
+        ReplayBuffer_Shutdown(&g_replayBuffer);
+        AudioCapture_Shutdown();
+        AudioDevice_Shutdown();
+    }
+    // Notifications posted while stopping still own their results
+    if (notify) {
+        MSG msg;
+        while (PeekMessageW(&msg, notify, WM_BENCH_SAVE_DONE, WM_BENCH_SAVE_DONE, PM_REMOVE)) {
+            ReplaySaveResult* result = (ReplaySaveResult*)msg.lParam;
+            if (result && !options->keepClips) DeleteFileA(result->path);
+            free(result);
+        }
+        DestroyWindow(notify);
+    }
+    Nvml_Close(&nvml);
+    if (captureInited) Capture_Shutdown(&g_capture);
+    g_benchRun = NULL;
+    SAFE_FREE(run);
+    return ok;
+}
@@ -0,0 +1,57 @@
+/*
+ * soak_bench.h - Headless end-to-end soak benchmark (lwsr.exe --bench)
+ *
+ * USED BY: main.c (command line)
+ *
+ * Runs the real replay pipeline (capture, GPU convert, NVENC, FrameBuffer,
+ * audio, periodic saves) for a fixed time with no UI, then writes a JSON
+ * report: achieved fps, dropped / duplicated / skipped frames, per-stage
+ * latency percentiles, save latency, CPU%, GPU encoder utilisation and
+ * peak working set. For qualifying drivers and hardware the same way
+ * every time.
+ *
+ * Command line (runs headless, then exits; summary on the parent console):
+ *   lwsr.exe --bench [--seconds N] [--warmup N] [--fps N] [--size WxH]
+ *                    [--buffer N] [--save-every N] [--pattern] [--tone]
+ *                    [--no-audio] [--keep-clips] [--out report.json]
+ *
+ *   --pattern     synthetic GPU test pattern of --size instead of the desktop
+ *   --size WxH    pattern size; with the desktop, H is the encode height
+ *   --tone        two synthetic tone sources instead of the configured audio
+ *   --save-every  seconds between full-buffer saves (0 = none)
+ *
+ * Unset options come from lwsr_config.ini, which the benchmark never writes.
+ */
+
+#ifndef SOAK_BENCH_H
+#define SOAK_BENCH_H
+
+#include <windows.h>
+
+typedef struct {
+    BOOL valid;                 // FALSE: usage error (already reported)
+    int seconds;                // Measured run length
+    int warmupSeconds;          // Run before measuring (not in the report)
+    int fps;                    // 0 = config
+    int width, height;          // 0 = config / native
+    int bufferSeconds;          // Replay duration; 0 = config
+    int saveEverySeconds;       // 0 = no saves
+    BOOL pattern;               // Synthetic video source
+    BOOL tone;                  // Synthetic audio sources
+    BOOL noAudio;
+    BOOL keepClips;             // Leave saved clips in %TEMP%
+    WCHAR reportPath[MAX_PATH];
+} SoakBenchOptions;
+
+// TRUE if the process command line asks for --bench; options filled in
+// (options->valid FALSE after a usage error, which has been printed).
+BOOL SoakBench_ParseCommandLine(SoakBenchOptions* options);
+
+// Run the benchmark and write the report. Needs COM, Media Foundation,
+// g_config loaded and the logger up; brings up and tears down capture,
+// the replay buffer and audio itself. Overrides g_config in memory, so the
+// caller must not save it afterwards. Returns TRUE if the pipeline ran for
+// the whole time and every save succeeded.
+BOOL SoakBench_Run(const SoakBenchOptions* options);
+
+#endif // SOAK_BENCH_H
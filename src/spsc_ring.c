@@ -0,0 +1,106 @@
+/*
+ * spsc_ring.c - Lock-free single-producer / single-consumer byte ring
+ *
+ * Ordering: Write copies the payload, then publishes writeCount with
+ * WriteRelease64; Read loads it with ReadAcquire64 before touching the
+ * bytes, then returns the space by publishing readCount the same way. The
+ * only cross-thread loads happen when the cached copy says the ring looks
+ * full (producer) or empty (consumer).
+ *
+ * ERROR HANDLING PATTERN:
+ * - Init returns FALSE on allocation failure
+ * - Write/Read never fail: they move as many bytes as fit / exist
+ */
+
+#include "spsc_ring.h"
+#include "mem_utils.h"
+
+BOOL SpscRing_Init(SpscRing* ring, int minCapacity) {
+    if (!ring || minCapacity <= 0 || minCapacity > (1 << 30)) return FALSE;
+    memset(ring, 0, sizeof(*ring));
+
+    int capacity = 1;
+    while (capacity < minCapacity) capacity <<= 1;
+
+    ring->data = (BYTE*)malloc(capacity);
+    if (!ring->data) return FALSE;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    return TRUE;
+}
+
+void SpscRing_Free(SpscRing* ring) {
+    if (!ring) return;
+    SAFE_FREE(ring->data);
+    ring->capacity = 0;
+    ring->mask = 0;
+}
+
+// Two memcpys at most: up to the end of the buffer, then from the start
+static void CopyIn(SpscRing* ring, LONG64 at, const BYTE* src, int size) {
+    int pos = (int)(at & ring->mask);
+    int toEnd = ring->capacity - pos;
+    if (size <= toEnd) {
+        memcpy(ring->data + pos, src, size);
+    } else {
+        memcpy(ring->data + pos, src, toEnd);
+        memcpy(ring->data, src + toEnd, size - toEnd);
+    }
+}
+
+static void CopyOut(const SpscRing* ring, LONG64 at, BYTE* dst, int size) {
+    int pos = (int)(at & ring->mask);
+    int toEnd = ring->capacity - pos;
+    if (size <= toEnd) {
+        memcpy(dst, ring->data + pos, size);
+    } else {
+        memcpy(dst, ring->data + pos, toEnd);
+        memcpy(dst + toEnd, ring->data, size - toEnd);
+    }
+}
+
+int SpscRing_Write(SpscRing* ring, const void* data, int size) {
+    if (!ring || !ring->data || !data || size <= 0) return 0;
+
+    LONG64 w = ring->writeCount;        // Own index: no ordering needed
+    int space = ring->capacity - (int)(w - ring->cachedRead);
+    if (space < size) {
+        ring->cachedRead = ReadAcquire64(&ring->readCount);
+        space = ring->capacity - (int)(w - ring->cachedRead);
+    }
+    if (size > space) size = space;
+    if (size <= 0) return 0;
+
+    CopyIn(ring, w, (const BYTE*)data, size);
+    WriteRelease64(&ring->writeCount, w + size);
+    return size;
+}
+
+int SpscRing_Available(SpscRing* ring) {
+    if (!ring || !ring->data) return 0;
+    ring->cachedWrite = ReadAcquire64(&ring->writeCount);
+    return (int)(ring->cachedWrite - ring->readCount);
+}
+
+int SpscRing_Read(SpscRing* ring, void* dst, int maxBytes) {
+    if (!ring || !ring->data || !dst || maxBytes <= 0) return 0;
+
+    LONG64 r = ring->readCount;         // Own index: no ordering needed
+    int available = (int)(ring->cachedWrite - r);
+    if (available < maxBytes) {
+        ring->cachedWrite = ReadAcquire64(&ring->writeCount);
+        available = (int)(ring->cachedWrite - r);
+    }
+    if (available > maxBytes) available = maxBytes;
+    if (available <= 0) return 0;
+
+    CopyOut(ring, r, (BYTE*)dst, available);
+    WriteRelease64(&ring->readCount, r + available);
+    return available;
+}
+
+void SpscRing_Clear(SpscRing* ring) {
+    if (!ring || !ring->data) return;
+    ring->cachedWrite = ReadAcquire64(&ring->writeCount);
+    WriteRelease64(&ring->readCount, ring->cachedWrite);
+}
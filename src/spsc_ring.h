@@ -0,0 +1,63 @@
+/*
+ * spsc_ring.h - Lock-free single-producer / single-consumer byte ring
+ *
+ * USED BY: audio_capture.c (source capture -> mix, mix -> buffer thread)
+ *
+ * Each ring has exactly one writer thread and one reader thread. The
+ * producer owns writeCount and the consumer owns readCount: free-running
+ * 64-bit byte counts, published with release stores and read with acquire
+ * loads, so the bytes a count covers are visible before the count is.
+ * Capacity is a power of two (positions are count & mask) and each index
+ * sits on its own cache line next to the owner's cached copy of the other
+ * index, so the two threads only share a line when one actually has to
+ * look at the other's progress.
+ *
+ * When the ring is full the producer drops what does not fit: the oldest
+ * bytes belong to the consumer and the producer may not move readCount.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <windows.h>
+#include "constants.h"
+
+typedef struct {
+    BYTE* data;
+    int capacity;                       // Power of two
+    int mask;
+    BYTE pad0[CACHE_LINE_SIZE];
+
+    // Producer line
+    volatile LONG64 writeCount;
+    LONG64 cachedRead;                  // Producer's last view of readCount
+    BYTE pad1[CACHE_LINE_SIZE];
+
+    // Consumer line
+    volatile LONG64 readCount;
+    LONG64 cachedWrite;                 // Consumer's last view of writeCount
+    BYTE pad2[CACHE_LINE_SIZE];
+} SpscRing;
+
+// Allocate at least minCapacity bytes (rounded up to a power of two).
+// Returns FALSE (ring left empty) on failure.
+BOOL SpscRing_Init(SpscRing* ring, int minCapacity);
+
+// Release the buffer. Safe on a zeroed or failed ring; no thread may be
+// using it.
+void SpscRing_Free(SpscRing* ring);
+
+// Producer: append up to size bytes, returns bytes written (less than size
+// when the ring is full; the rest is dropped).
+int SpscRing_Write(SpscRing* ring, const void* data, int size);
+
+// Consumer: bytes ready to read
+int SpscRing_Available(SpscRing* ring);
+
+// Consumer: copy out up to maxBytes, returns bytes read
+int SpscRing_Read(SpscRing* ring, void* dst, int maxBytes);
+
+// Consumer: discard everything written so far
+void SpscRing_Clear(SpscRing* ring);
+
+#endif // SPSC_RING_H
@@ -0,0 +1,168 @@
+/*
+ * startup.c - Dependency-ordered, concurrent startup steps
+ *
+ * Each step keeps a count of unfinished dependencies. When a step finishes
+ * it decrements its dependents' counts and hands any that reach zero to the
+ * thread pool (TrySubmitThreadpoolCallback) or, for onCaller steps, to the
+ * waiting caller. Bookkeeping is under one SRW lock; step bodies run
+ * outside it. Skipping a failed step's dependents recurses down the array,
+ * which terminates because deps only point backwards.
+ */
+
+#include "startup.h"
+#include "constants.h"
+#include "logger.h"
+
+typedef struct StartupRun StartupRun;
+
+typedef struct {
+    StartupRun* run;
+    int index;
+} StepWork;
+
+struct StartupRun {
+    StartupStep* steps;
+    int count;
+    int waiting[STARTUP_MAX_STEPS];     // Unfinished deps per step
+    DWORD callerReady;                  // Steps queued for the calling thread
+    int finished;
+    SRWLOCK lock;
+    CONDITION_VARIABLE changed;
+    StepWork work[STARTUP_MAX_STEPS];   // Pool callback contexts
+};
+
+static volatile LONG g_readyLogged = 0;
+
+static const char* const g_stateNames[] = {
+    "pending", "running", "ok", "FAILED", "skipped"
+};
+
+ULONGLONG Startup_MsSinceLaunch(void) {
+    FILETIME created, exited, kernel, user, now;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0;
+    GetSystemTimePreciseAsFileTime(&now);
+
+    ULARGE_INTEGER c, n;
+    c.LowPart = created.dwLowDateTime;
+    c.HighPart = created.dwHighDateTime;
+    n.LowPart = now.dwLowDateTime;
+    n.HighPart = now.dwHighDateTime;
+    return (n.QuadPart > c.QuadPart) ? (n.QuadPart - c.QuadPart) / 10000 : 0;
+}
+
+static void CALLBACK StepCallback(PTP_CALLBACK_INSTANCE instance, void* param);
+
+// Lock held. A step whose deps have all succeeded goes to the pool, or to
+// the caller when it is onCaller or the pool refuses it.
+static void Schedule(StartupRun* run, int i) {
+    if (!run->steps[i].onCaller &&
+        TrySubmitThreadpoolCallback(StepCallback, &run->work[i], NULL)) {
+        return;
+    }
+    run->callerReady |= 1u << i;
+}
+
+// Lock held. Record a finished (or skipped) step and release or skip
+// everything that depends on it.
+static void Finish(StartupRun* run, int i, StartupStepState result) {
+    InterlockedExchange(&run->steps[i].state, result);
+    run->finished++;
+
+    for (int j = i + 1; j < run->count; j++) {
+        StartupStep* dependent = &run->steps[j];
+        if (!(dependent->deps & (1u << i))) continue;
+        if (dependent->state != STARTUP_STEP_PENDING) continue;  // Already skipped
+        if (result != STARTUP_STEP_OK) {
+            Finish(run, j, STARTUP_STEP_SKIPPED);
+        } else if (--run->waiting[j] == 0) {
+            Schedule(run, j);
+        }
+    }
+    WakeAllConditionVariable(&run->changed);
+}
+
+static void RunStep(StartupRun* run, int i) {
+    StartupStep* step = &run->steps[i];
+    step->startMs = Startup_MsSinceLaunch();
+    InterlockedExchange(&step->state, STARTUP_STEP_RUNNING);
+
+    BOOL ok = step->run(step->context);
+    step->endMs = Startup_MsSinceLaunch();
+
+    AcquireSRWLockExclusive(&run->lock);
+    Finish(run, i, ok ? STARTUP_STEP_OK : STARTUP_STEP_FAILED);
+    ReleaseSRWLockExclusive(&run->lock);
+}
+
+static void CALLBACK StepCallback(PTP_CALLBACK_INSTANCE instance, void* param) {
+    (void)instance;
+    StepWork* work = (StepWork*)param;
+    RunStep(work->run, work->index);
+}
+
+BOOL Startup_Run(StartupStep* steps, int count) {
+    LWSR_ASSERT(steps != NULL);
+    LWSR_ASSERT(count > 0 && count <= STARTUP_MAX_STEPS);
+    if (!steps || count <= 0 || count > STARTUP_MAX_STEPS) return FALSE;
+
+    // On the stack: every pool callback has finished with it (its last
+    // touch is the lock release in RunStep) before finished reaches count
+    StartupRun run;
+    ZeroMemory(&run, sizeof(run));
+    run.steps = steps;
+    run.count = count;
+    InitializeSRWLock(&run.lock);
+    InitializeConditionVariable(&run.changed);
+
+    ULONGLONG beginMs = Startup_MsSinceLaunch();
+
+    AcquireSRWLockExclusive(&run.lock);
+    for (int i = 0; i < count; i++) {
+        LWSR_ASSERT_MSG((steps[i].deps >> i) == 0, "startup step depends on a later step");
+        steps[i].deps &= (1u << i) - 1;
+        steps[i].state = STARTUP_STEP_PENDING;
+        steps[i].startMs = steps[i].endMs = 0;
+        run.work[i].run = &run;
+        run.work[i].index = i;
+        for (DWORD d = steps[i].deps; d; d &= d - 1) run.waiting[i]++;
+    }
+    for (int i = 0; i < count; i++) {
+        if (run.waiting[i] == 0) Schedule(&run, i);
+    }
+
+    while (run.finished < count) {
+        if (run.callerReady) {
+            int i = 0;
+            while (!(run.callerReady & (1u << i))) i++;
+            run.callerReady &= ~(1u << i);
+            ReleaseSRWLockExclusive(&run.lock);
+            RunStep(&run, i);
+            AcquireSRWLockExclusive(&run.lock);
+        } else {
+            SleepConditionVariableSRW(&run.changed, &run.lock, INFINITE, 0);
+        }
+    }
+    ReleaseSRWLockExclusive(&run.lock);
+
+    BOOL allOk = TRUE;
+    for (int i = 0; i < count; i++) {
+        const StartupStep* step = &steps[i];
+        if (step->state != STARTUP_STEP_OK) allOk = FALSE;
+        if (step->startMs) {
+            Logger_Log("Startup: %-16s %-7s %5llu..%5llu ms (%llu ms)%s\n",
+                       step->name, g_stateNames[step->state], step->startMs, step->endMs,
+                       step->endMs - step->startMs, step->onCaller ? " [ui thread]" : "");
+        } else {
+            Logger_Log("Startup: %-16s %s\n", step->name, g_stateNames[step->state]);
+        }
+    }
+    ULONGLONG endMs = Startup_MsSinceLaunch();
+    Logger_Log("Startup: %d steps in %llu ms, done %llu ms after launch\n",
+               count, endMs - beginMs, endMs);
+    return allOk;
+}
+
+void Startup_LogReady(const char* what) {
+    if (InterlockedCompareExchange(&g_readyLogged, 1, 0) != 0) return;
+    Logger_Log("Startup: %s ready %llu ms after launch\n", what, Startup_MsSinceLaunch());
+}
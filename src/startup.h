@@ -0,0 +1,56 @@
+/*
+ * startup.h - Dependency-ordered, concurrent startup steps
+ *
+ * USED BY: main.c (process startup), replay_buffer.c (time-to-ready)
+ *
+ * Startup is a small fixed graph: each step names the steps it needs and
+ * runs as soon as all of them have succeeded. Steps without an ordering
+ * between them run at the same time on the process thread pool; steps that
+ * create windows (or otherwise need the UI thread) are marked onCaller and
+ * run on the thread that called Startup_Run, in array order. If a step
+ * fails, everything that depends on it is skipped, so the caller can report
+ * the first failure and clean up only what ran.
+ */
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <windows.h>
+
+#define STARTUP_MAX_STEPS 32        // deps is a bit mask over the step array
+
+typedef BOOL (*StartupStepFn)(void* context);
+
+typedef enum {
+    STARTUP_STEP_PENDING = 0,
+    STARTUP_STEP_RUNNING,
+    STARTUP_STEP_OK,
+    STARTUP_STEP_FAILED,
+    STARTUP_STEP_SKIPPED            // A dependency failed or was skipped
+} StartupStepState;
+
+typedef struct {
+    const char* name;
+    StartupStepFn run;
+    void* context;
+    DWORD deps;                     // Bit i = runs after steps[i] succeeded
+    BOOL onCaller;                  // Run on the Startup_Run thread, not the pool
+
+    // Filled in by Startup_Run
+    volatile LONG state;            // StartupStepState
+    ULONGLONG startMs, endMs;       // Startup_MsSinceLaunch at start / end
+} StartupStep;
+
+// Run every step, honouring deps, and return when all have finished or
+// been skipped. Logs one line per step with its timing. Returns TRUE if
+// every step succeeded. Steps must only reference earlier steps in deps.
+BOOL Startup_Run(StartupStep* steps, int count);
+
+// Milliseconds since the process was created (not since WinMain)
+ULONGLONG Startup_MsSinceLaunch(void);
+
+// Log "<what> ready N ms after launch" the first time it is called in
+// the process (the launch-to-ready time); later calls do nothing. Any thread.
+void Startup_LogReady(const char* what);
+
+#endif // STARTUP_H
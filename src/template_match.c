@@ -0,0 +1,753 @@
+/*
+ * template_match.c - Grayscale NCC template matching
+ *
+ * For a window W at (x,y) and a template T with n pixels:
+ *     ncc = sum((W - mean W) * (T - mean T)) / (|W - mean W| * |T - mean T|)
+ * T is stored centred (T' = T - mean T, sum T' = 0), so the numerator is
+ * just sum(W * T'). |W - mean W|^2 = (n * sumSq - sum^2) / n comes from
+ * the integral images in exact 64-bit integers, four lookups each.
+ *
+ * The numerator is the only term that still scales with template area.
+ * Direct evaluation costs positions * n multiply-adds; the FFT path costs
+ * one forward transform of the template and one inverse transform of the
+ * product with the image spectrum (the image transform is shared by every
+ * template of a scan). TemplateMatch_Search takes whichever is cheaper by
+ * TEMPLATE_MATCH_FFT_COST. Both paths produce the same scores up to float
+ * rounding, so the choice never changes which threshold a match passes
+ * by more than ~1e-5.
+ *
+ * Direct kernels: the template is also kept as int16 T'q = round(T' * 2^Q)
+ * (TEMPLATE_MATCH_Q_BITS). Pixels are zero-extended to words and pmaddwd
+ * multiplies 8 (SSE2) or 16 (AVX2) of them per instruction into dword
+ * lanes; the scalar kernel computes the same products, so the integer
+ * sums match exactly. pmaddubsw (u8 x s8) would halve the widening work,
+ * but its pair sums saturate at 32767 and 255 * 127 * 2 does not fit, so
+ * it cannot carry a full-range pixel against an 8-bit template.
+ * Rounding leaves sum(T'q) slightly off zero; that bias (window sum times
+ * sum(T'q) / n) is removed with the integral image, O(1) per position.
+ * Lanes are flushed to 64 bits every rowsPerFlush rows so large templates
+ * cannot overflow them.
+ *
+ * Coarse-to-fine (TemplateMatch_SearchPyramid): image and template are
+ * also kept at half resolution (2x2 box average). The half-size search
+ * costs 1/16 of the full one; its best TEMPLATE_MATCH_TOP_K separated
+ * peaks are then re-scored at full resolution over a small neighbourhood
+ * (TEMPLATE_MATCH_REFINE_RADIUS, which covers the +/-1 pixel a box
+ * downsample can shift a peak by). Banners are large, high-contrast
+ * shapes, so their true peak survives halving; templates too small to
+ * halve (TEMPLATE_MATCH_COARSE_MIN_DIM) are searched at full size.
+ *
+ * A window whose |W - mean W| is at most 1 is flat and scores 0, as the
+ * old per-window code did.
+ *
+ * ERROR HANDLING PATTERN:
+ * - Setup returns FALSE on allocation failure
+ * - A failed FFT allocation falls back to the direct path
+ */
+
+#include "template_match.h"
+#include "logger.h"
+#include "constants.h"
+#include "mem_utils.h"
+#include "util.h"
+#include <immintrin.h>
+#include <math.h>
+#include <string.h>
+
+#define TM_PI 3.14159265358979323846
+
+/* sum(window * T'q) for one window; img points at its top-left pixel */
+typedef INT64 (*CrossKernelFn)(const BYTE* img, int imgStride, const MatchTemplate* t);
+
+/* -1 until the first TemplateMatch_GetKernel resolves it */
+static volatile LONG g_kernel = -1;
+
+/* ─── Helpers ─── */
+
+static int NextPow2(int v, int* log2Out)
+{
+    int p = 1, l = 0;
+    while (p < v) { p <<= 1; l++; }
+    if (log2Out) *log2Out = l;
+    return p;
+}
+
+/* Grow a float buffer to hold cap complex entries (2 floats each) */
+static BOOL GrowComplex(float** buf, size_t* cap, size_t need)
+{
+    if (*cap >= need) return TRUE;
+    float* p = (float*)_aligned_malloc(need * 2 * sizeof(float), 32);
+    if (!p) return FALSE;
+    if (*buf) _aligned_free(*buf);
+    *buf = p;
+    *cap = need;
+    return TRUE;
+}
+
+/* sqrt(sum(W - mean W)^2) for the window at (x,y), from the integral images.
+ * outSum (optional) receives sum(W). */
+static float WindowNorm(const MatchImage* img, int x, int y, int tw, int th, UINT64 n,
+                        UINT64* outSum)
+{
+    int stride = img->w + 1;
+    size_t a = (size_t)y * stride + x;
+    size_t b = a + tw;
+    size_t c = a + (size_t)th * stride;
+    size_t d = c + tw;
+    UINT64 s = (UINT64)img->sum[d] - img->sum[b] - img->sum[c] + img->sum[a];
+    UINT64 q = img->sqSum[d] - img->sqSum[b] - img->sqSum[c] + img->sqSum[a];
+    UINT64 varN = n * q - s * s;    /* n * sum(W - mean)^2, exact */
+    if (outSum) *outSum = s;
+    return sqrtf((float)((double)varN / (double)n));
+}
+
+static float Score(float cross, float imgNorm, float tmplNorm)
+{
+    return (imgNorm > 1.0f) ? (cross / (imgNorm * tmplNorm)) : 0.0f;
+}
+
+/* ─── FFT ─── */
+
+/* In-place radix-2 transform of n interleaved complex values */
+static void Fft1D(float* data, int n, BOOL inverse)
+{
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            float tr = data[2 * i], ti = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = tr;
+            data[2 * j + 1] = ti;
+        }
+    }
+
+    for (int len = 2; len <= n; len <<= 1) {
+        int half = len >> 1;
+        double ang = (inverse ? 2.0 : -2.0) * TM_PI / len;
+        double stepR = cos(ang), stepI = sin(ang);
+        double wr = 1.0, wi = 0.0;
+        for (int k = 0; k < half; k++) {
+            float fr = (float)wr, fi = (float)wi;
+            for (int i = k; i < n; i += len) {
+                float* u = data + 2 * i;
+                float* v = data + 2 * (i + half);
+                float vr = v[0] * fr - v[1] * fi;
+                float vi = v[0] * fi + v[1] * fr;
+                v[0] = u[0] - vr;
+                v[1] = u[1] - vi;
+                u[0] += vr;
+                u[1] += vi;
+            }
+            double t = wr * stepR - wi * stepI;
+            wi = wr * stepI + wi * stepR;
+            wr = t;
+        }
+    }
+}
+
+/* 2D transform of a fftW x fftH grid. Only rows [0, rowsIn) may be non-zero
+ * on a forward pass; only rows [0, rowsOut) are needed after an inverse
+ * pass. col is fftH complex entries of scratch. */
+static void Fft2D(float* grid, int fftW, int fftH, int rowsIn, int rowsOut,
+                  float* col, BOOL inverse)
+{
+    if (!inverse) {
+        for (int y = 0; y < rowsIn; y++) Fft1D(grid + (size_t)y * fftW * 2, fftW, FALSE);
+    }
+
+    for (int x = 0; x < fftW; x++) {
+        for (int y = 0; y < fftH; y++) {
+            col[2 * y] = grid[((size_t)y * fftW + x) * 2];
+            col[2 * y + 1] = grid[((size_t)y * fftW + x) * 2 + 1];
+        }
+        Fft1D(col, fftH, inverse);
+        for (int y = 0; y < fftH; y++) {
+            grid[((size_t)y * fftW + x) * 2] = col[2 * y];
+            grid[((size_t)y * fftW + x) * 2 + 1] = col[2 * y + 1];
+        }
+    }
+
+    if (inverse) {
+        for (int y = 0; y < rowsOut; y++) Fft1D(grid + (size_t)y * fftW * 2, fftW, TRUE);
+    }
+}
+
+/* ─── Image ─── */
+
+BOOL MatchImage_Set(MatchImage* img, const BYTE* gray, int w, int h)
+{
+    if (!img || !gray || w <= 0 || h <= 0) return FALSE;
+
+    size_t need = (size_t)(w + 1) * (h + 1);
+    if (img->integralCap < need) {
+        SAFE_FREE(img->sum);
+        SAFE_FREE(img->sqSum);
+        img->integralCap = 0;
+        img->sum = (UINT32*)malloc(need * sizeof(UINT32));
+        img->sqSum = (UINT64*)malloc(need * sizeof(UINT64));
+        if (!img->sum || !img->sqSum) {
+            SAFE_FREE(img->sum);
+            SAFE_FREE(img->sqSum);
+            return FALSE;
+        }
+        img->integralCap = need;
+    }
+
+    img->gray = gray;
+    img->w = w;
+    img->h = h;
+    img->spectrumValid = FALSE;
+
+    int stride = w + 1;
+    memset(img->sum, 0, (size_t)stride * sizeof(UINT32));
+    memset(img->sqSum, 0, (size_t)stride * sizeof(UINT64));
+    for (int y = 0; y < h; y++) {
+        const BYTE* row = gray + (size_t)y * w;
+        UINT32* sRow = img->sum + (size_t)(y + 1) * stride;
+        UINT64* qRow = img->sqSum + (size_t)(y + 1) * stride;
+        const UINT32* sPrev = sRow - stride;
+        const UINT64* qPrev = qRow - stride;
+        UINT32 rs = 0;
+        UINT64 rq = 0;
+        sRow[0] = 0;
+        qRow[0] = 0;
+        for (int x = 0; x < w; x++) {
+            rs += row[x];
+            rq += (UINT32)row[x] * row[x];
+            sRow[x + 1] = sPrev[x + 1] + rs;
+            qRow[x + 1] = qPrev[x + 1] + rq;
+        }
+    }
+    return TRUE;
+}
+
+BOOL MatchImage_PrepareSpectrum(MatchImage* img)
+{
+    if (!img || !img->gray) return FALSE;
+    if (img->spectrumValid) return TRUE;
+
+    int fftW = NextPow2(img->w, NULL);
+    int fftH = NextPow2(img->h, NULL);
+    size_t n = (size_t)fftW * fftH;
+    /* Grid plus one column of scratch */
+    if (!GrowComplex(&img->spectrum, &img->spectrumCap, n + fftH)) return FALSE;
+    img->fftW = fftW;
+    img->fftH = fftH;
+
+    float* grid = img->spectrum;
+    memset(grid, 0, n * 2 * sizeof(float));
+    for (int y = 0; y < img->h; y++) {
+        const BYTE* row = img->gray + (size_t)y * img->w;
+        float* dst = grid + (size_t)y * fftW * 2;
+        for (int x = 0; x < img->w; x++) dst[2 * x] = row[x];
+    }
+    Fft2D(grid, fftW, fftH, img->h, 0, grid + n * 2, FALSE);
+    img->spectrumValid = TRUE;
+    return TRUE;
+}
+
+void MatchImage_Free(MatchImage* img)
+{
+    if (!img) return;
+    SAFE_FREE(img->sum);
+    SAFE_FREE(img->sqSum);
+    if (img->spectrum) _aligned_free(img->spectrum);
+    memset(img, 0, sizeof(*img));
+}
+
+/* ─── Template ─── */
+
+BOOL MatchTemplate_Init(MatchTemplate* t, const BYTE* gray, int w, int h)
+{
+    if (!t || !gray || w <= 0 || h <= 0) return FALSE;
+    memset(t, 0, sizeof(*t));
+
+    int n = w * h;
+    t->centered = (float*)malloc((size_t)n * sizeof(float));
+    t->quant = (short*)malloc((size_t)n * sizeof(short));
+    if (!t->centered || !t->quant) {
+        SAFE_FREE(t->centered);
+        SAFE_FREE(t->quant);
+        return FALSE;
+    }
+
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += gray[i];
+    double mean = sum / n;
+    double sq = 0.0;
+    int maxAbsQ = 1;
+    for (int i = 0; i < n; i++) {
+        double d = gray[i] - mean;
+        t->centered[i] = (float)d;
+        sq += d * d;
+        /* |d| <= 255, so |q| <= 255 << TEMPLATE_MATCH_Q_BITS fits a short */
+        int q = (int)floor(d * (1 << TEMPLATE_MATCH_Q_BITS) + 0.5);
+        t->quant[i] = (short)q;
+        t->quantSum += q;
+        if (q < 0) q = -q;
+        if (q > maxAbsQ) maxAbsQ = q;
+    }
+
+    /* One SSE2 lane takes two products per 8 pixels of a row (AVX2: per
+     * 16, so half as much); keep a lane's running sum under 2^31 */
+    INT64 perRow = (INT64)((w + 7) / 8) * 2 * 255 * maxAbsQ;
+    INT64 rows = 0x7FFFFFFFLL / perRow;
+    t->rowsPerFlush = rows < 1 ? 1 : (rows > h ? h : (int)rows);
+
+    t->w = w;
+    t->h = h;
+    t->mean = (float)mean;
+    t->norm = (float)sqrt(sq);
+    return TRUE;
+}
+
+void MatchTemplate_Free(MatchTemplate* t)
+{
+    if (!t) return;
+    SAFE_FREE(t->centered);
+    SAFE_FREE(t->quant);
+    memset(t, 0, sizeof(*t));
+}
+
+void MatchScratch_Free(MatchScratch* scratch)
+{
+    if (!scratch) return;
+    if (scratch->buf) _aligned_free(scratch->buf);
+    scratch->buf = NULL;
+    scratch->cap = 0;
+}
+
+/* ─── Direct kernels ─── */
+
+static INT64 CrossScalar(const BYTE* img, int imgStride, const MatchTemplate* t)
+{
+    INT64 total = 0;
+    for (int ty = 0; ty < t->h; ty++) {
+        const BYTE* row = img + (size_t)ty * imgStride;
+        const short* trow = t->quant + (size_t)ty * t->w;
+        int acc = 0;    /* One row fits: w <= 2048, |q| <= 255 << Q_BITS */
+        for (int tx = 0; tx < t->w; tx++) acc += row[tx] * trow[tx];
+        total += acc;
+    }
+    return total;
+}
+
+static INT64 CrossSse2(const BYTE* img, int imgStride, const MatchTemplate* t)
+{
+    int tw = t->w;
+    int n8 = tw & ~7;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    INT64 total = 0;
+    int rows = 0;
+
+    for (int ty = 0; ty < t->h; ty++) {
+        const BYTE* row = img + (size_t)ty * imgStride;
+        const short* trow = t->quant + (size_t)ty * tw;
+        int tx = 0;
+        for (; tx < n8; tx += 8) {
+            __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(row + tx)), zero);
+            __m128i q = _mm_loadu_si128((const __m128i*)(trow + tx));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(p, q));
+        }
+        int tail = 0;
+        for (; tx < tw; tx++) tail += row[tx] * trow[tx];
+        total += tail;
+
+        if (++rows == t->rowsPerFlush) {
+            int lanes[4];
+            _mm_storeu_si128((__m128i*)lanes, acc);
+            total += (INT64)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            acc = zero;
+            rows = 0;
+        }
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    return total + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+static INT64 CrossAvx2(const BYTE* img, int imgStride, const MatchTemplate* t)
+{
+    int tw = t->w;
+    int n16 = tw & ~15;
+    __m256i acc = _mm256_setzero_si256();
+    INT64 total = 0;
+    int rows = 0;
+
+    for (int ty = 0; ty < t->h; ty++) {
+        const BYTE* row = img + (size_t)ty * imgStride;
+        const short* trow = t->quant + (size_t)ty * tw;
+        int tx = 0;
+        for (; tx < n16; tx += 16) {
+            __m256i p = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(row + tx)));
+            __m256i q = _mm256_loadu_si256((const __m256i*)(trow + tx));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(p, q));
+        }
+        int tail = 0;
+        for (; tx < tw; tx++) tail += row[tx] * trow[tx];
+        total += tail;
+
+        if (++rows == t->rowsPerFlush) {
+            int lanes[8];
+            _mm256_storeu_si256((__m256i*)lanes, acc);
+            for (int i = 0; i < 8; i++) total += lanes[i];
+            acc = _mm256_setzero_si256();
+            rows = 0;
+        }
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, acc);
+    for (int i = 0; i < 8; i++) total += lanes[i];
+    _mm256_zeroupper();
+    return total;
+}
+
+static CrossKernelFn ActiveKernel(void)
+{
+    switch (TemplateMatch_GetKernel()) {
+        case TEMPLATE_MATCH_AVX2: return CrossAvx2;
+        case TEMPLATE_MATCH_SSE2: return CrossSse2;
+        default:                  return CrossScalar;
+    }
+}
+
+/* Template pixels one kernel step covers, for the path cost estimate */
+static int KernelWidth(void)
+{
+    switch (TemplateMatch_GetKernel()) {
+        case TEMPLATE_MATCH_AVX2: return 16;
+        case TEMPLATE_MATCH_SSE2: return 8;
+        default:                  return 1;
+    }
+}
+
+/* ─── Candidates ─── */
+
+/* Best-k positions, at least minSep apart (Chebyshev) so one peak cannot
+ * take every slot. k = 1, minSep = 0 is a plain best-match. */
+typedef struct {
+    MatchResult items[TEMPLATE_MATCH_TOP_K];
+    int count;
+    int k;
+    int minSep;
+    int worst;              /* Index of the lowest score once count == k */
+} Candidates;
+
+static void Candidates_Init(Candidates* c, int k, int minSep)
+{
+    c->count = 0;
+    c->k = k;
+    c->minSep = minSep;
+    c->worst = 0;
+}
+
+static void Candidates_FindWorst(Candidates* c)
+{
+    c->worst = 0;
+    for (int i = 1; i < c->count; i++)
+        if (c->items[i].score < c->items[c->worst].score) c->worst = i;
+}
+
+static void Candidates_Push(Candidates* c, float score, int x, int y)
+{
+    if (c->count == c->k && score <= c->items[c->worst].score) return;
+
+    /* A better score near an existing candidate replaces it */
+    for (int i = 0; i < c->count; i++) {
+        int dx = c->items[i].x - x, dy = c->items[i].y - y;
+        if (dx < 0) dx = -dx;
+        if (dy < 0) dy = -dy;
+        if (dx < c->minSep && dy < c->minSep) {
+            if (score > c->items[i].score) {
+                c->items[i].score = score;
+                c->items[i].x = x;
+                c->items[i].y = y;
+                if (c->count == c->k) Candidates_FindWorst(c);
+            }
+            return;
+        }
+    }
+
+    int slot = (c->count < c->k) ? c->count++ : c->worst;
+    c->items[slot].score = score;
+    c->items[slot].x = x;
+    c->items[slot].y = y;
+    if (c->count == c->k) Candidates_FindWorst(c);
+}
+
+static void Candidates_Best(const Candidates* c, MatchResult* out)
+{
+    out->score = -1.0f;
+    out->x = 0;
+    out->y = 0;
+    for (int i = 0; i < c->count; i++)
+        if (c->items[i].score > out->score) *out = c->items[i];
+}
+
+/* ─── Search ─── */
+
+/* NCC of the window at (x,y), direct path */
+static float ScoreDirect(const MatchImage* img, const MatchTemplate* t, CrossKernelFn cross,
+                         int x, int y)
+{
+    UINT64 n = (UINT64)t->w * t->h;
+    UINT64 winSum;
+    float imgNorm = WindowNorm(img, x, y, t->w, t->h, n, &winSum);
+    if (imgNorm <= 1.0f) return 0.0f;
+    INT64 raw = cross(img->gray + (size_t)y * img->w + x, img->w, t);
+    double bias = (double)winSum * (double)t->quantSum / (double)n;
+    float cc = (float)(((double)raw - bias) / (double)(1 << TEMPLATE_MATCH_Q_BITS));
+    return Score(cc, imgNorm, t->norm);
+}
+
+static void SearchDirect(const MatchImage* img, const MatchTemplate* t, Candidates* out)
+{
+    CrossKernelFn cross = ActiveKernel();
+    for (int y = 0; y <= img->h - t->h; y++) {
+        for (int x = 0; x <= img->w - t->w; x++)
+            Candidates_Push(out, ScoreDirect(img, t, cross, x, y), x, y);
+    }
+}
+
+static BOOL SearchFft(MatchImage* img, const MatchTemplate* t, MatchScratch* scratch,
+                      Candidates* out)
+{
+    if (!MatchImage_PrepareSpectrum(img)) return FALSE;
+
+    int fftW = img->fftW, fftH = img->fftH;
+    size_t n = (size_t)fftW * fftH;
+    if (!GrowComplex(&scratch->buf, &scratch->cap, n + fftH)) return FALSE;
+
+    /* Template spectrum, zero-padded to the image's FFT size */
+    float* grid = scratch->buf;
+    memset(grid, 0, n * 2 * sizeof(float));
+    for (int y = 0; y < t->h; y++) {
+        const float* src = t->centered + (size_t)y * t->w;
+        float* dst = grid + (size_t)y * fftW * 2;
+        for (int x = 0; x < t->w; x++) dst[2 * x] = src[x];
+    }
+    float* col = grid + n * 2;
+    Fft2D(grid, fftW, fftH, t->h, 0, col, FALSE);
+
+    /* Correlation: image spectrum times conjugate template spectrum */
+    const float* is = img->spectrum;
+    for (size_t i = 0; i < n; i++) {
+        float ar = is[2 * i], ai = is[2 * i + 1];
+        float br = grid[2 * i], bi = grid[2 * i + 1];
+        grid[2 * i] = ar * br + ai * bi;
+        grid[2 * i + 1] = ai * br - ar * bi;
+    }
+
+    int lastY = img->h - t->h;
+    int lastX = img->w - t->w;
+    Fft2D(grid, fftW, fftH, 0, lastY + 1, col, TRUE);
+
+    float invN = 1.0f / (float)n;
+    UINT64 tn = (UINT64)t->w * t->h;
+    for (int y = 0; y <= lastY; y++) {
+        const float* row = grid + (size_t)y * fftW * 2;
+        for (int x = 0; x <= lastX; x++) {
+            float imgNorm = WindowNorm(img, x, y, t->w, t->h, tn, NULL);
+            Candidates_Push(out, Score(row[2 * x] * invN, imgNorm, t->norm), x, y);
+        }
+    }
+    return TRUE;
+}
+
+/* Exhaustive search of one level, direct or FFT by estimated cost */
+static void SearchLevel(MatchImage* img, const MatchTemplate* t, MatchScratch* scratch,
+                        Candidates* out)
+{
+    if (!img->gray || !t->centered || !t->quant) return;
+    if (t->w > img->w || t->h > img->h) return;
+    if (t->norm < 1.0f) return;
+
+    /* Direct: one multiply-add per template pixel per position.
+     * FFT: two 2D transforms (template forward, product inverse). */
+    int log2W, log2H;
+    int fftW = NextPow2(img->w, &log2W);
+    int fftH = NextPow2(img->h, &log2H);
+    double positions = (double)(img->w - t->w + 1) * (img->h - t->h + 1);
+    double directCost = positions * t->w * t->h / KernelWidth();
+    double fftCost = TEMPLATE_MATCH_FFT_COST * 2.0 * (double)fftW * fftH * (log2W + log2H);
+
+    if (scratch && directCost > fftCost) {
+        Candidates saved = *out;
+        if (SearchFft(img, t, scratch, out)) return;
+        *out = saved;
+    }
+    SearchDirect(img, t, out);
+}
+
+void TemplateMatch_Search(MatchImage* img, const MatchTemplate* tmpl,
+                          MatchScratch* scratch, MatchResult* out)
+{
+    if (!out) return;
+    Candidates best;
+    Candidates_Init(&best, 1, 0);
+    if (img && tmpl) SearchLevel(img, tmpl, scratch, &best);
+    Candidates_Best(&best, out);
+}
+
+/* ─── Pyramid ─── */
+
+/* 2x2 box average, rounded; odd last row/column dropped */
+static void Downsample2x(const BYTE* src, int w, int h, BYTE* dst)
+{
+    int hw = w / 2, hh = h / 2;
+    for (int y = 0; y < hh; y++) {
+        const BYTE* r0 = src + (size_t)(2 * y) * w;
+        const BYTE* r1 = r0 + w;
+        BYTE* d = dst + (size_t)y * hw;
+        for (int x = 0; x < hw; x++)
+            d[x] = (BYTE)((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2);
+    }
+}
+
+BOOL MatchImagePyramid_Set(MatchImagePyramid* pyr, const BYTE* gray, int w, int h)
+{
+    if (!pyr) return FALSE;
+    pyr->hasCoarse = FALSE;
+    if (!MatchImage_Set(&pyr->fine, gray, w, h)) return FALSE;
+
+    int hw = w / 2, hh = h / 2;
+    if (hw < TEMPLATE_MATCH_COARSE_MIN_DIM || hh < TEMPLATE_MATCH_COARSE_MIN_DIM) return TRUE;
+
+    size_t need = (size_t)hw * hh;
+    if (pyr->halfCap < need) {
+        SAFE_FREE(pyr->half);
+        pyr->halfCap = 0;
+        pyr->half = (BYTE*)malloc(need);
+        if (!pyr->half) return TRUE;    /* Fine level alone still searches */
+        pyr->halfCap = need;
+    }
+    Downsample2x(gray, w, h, pyr->half);
+    pyr->hasCoarse = MatchImage_Set(&pyr->coarse, pyr->half, hw, hh);
+    return TRUE;
+}
+
+BOOL MatchImagePyramid_PrepareSpectrum(MatchImagePyramid* pyr)
+{
+    if (!pyr) return FALSE;
+    BOOL ok = MatchImage_PrepareSpectrum(&pyr->fine);
+    if (pyr->hasCoarse) ok = MatchImage_PrepareSpectrum(&pyr->coarse) && ok;
+    return ok;
+}
+
+void MatchImagePyramid_Free(MatchImagePyramid* pyr)
+{
+    if (!pyr) return;
+    MatchImage_Free(&pyr->fine);
+    MatchImage_Free(&pyr->coarse);
+    SAFE_FREE(pyr->half);
+    pyr->halfCap = 0;
+    pyr->hasCoarse = FALSE;
+}
+
+BOOL MatchTemplatePyramid_Init(MatchTemplatePyramid* pyr, const BYTE* gray, int w, int h)
+{
+    if (!pyr) return FALSE;
+    memset(pyr, 0, sizeof(*pyr));
+    if (!MatchTemplate_Init(&pyr->fine, gray, w, h)) return FALSE;
+
+    int hw = w / 2, hh = h / 2;
+    if (hw < TEMPLATE_MATCH_COARSE_MIN_DIM || hh < TEMPLATE_MATCH_COARSE_MIN_DIM) return TRUE;
+
+    BYTE* half = (BYTE*)malloc((size_t)hw * hh);
+    if (!half) return TRUE;
+    Downsample2x(gray, w, h, half);
+    pyr->hasCoarse = MatchTemplate_Init(&pyr->coarse, half, hw, hh) && pyr->coarse.norm >= 1.0f;
+    free(half);
+    return TRUE;
+}
+
+void MatchTemplatePyramid_Free(MatchTemplatePyramid* pyr)
+{
+    if (!pyr) return;
+    MatchTemplate_Free(&pyr->fine);
+    MatchTemplate_Free(&pyr->coarse);
+    pyr->hasCoarse = FALSE;
+}
+
+void TemplateMatch_SearchPyramid(MatchImagePyramid* img, const MatchTemplatePyramid* tmpl,
+                                 MatchScratch* scratch, MatchResult* out)
+{
+    if (!out) return;
+    out->score = -1.0f;
+    out->x = 0;
+    out->y = 0;
+    if (!img || !tmpl) return;
+
+    if (!img->hasCoarse || !tmpl->hasCoarse ||
+        tmpl->coarse.w > img->coarse.w || tmpl->coarse.h > img->coarse.h) {
+        TemplateMatch_Search(&img->fine, &tmpl->fine, scratch, out);
+        return;
+    }
+
+    /* Coarse: best TOP_K peaks at half resolution, half a template apart */
+    const MatchTemplate* ct = &tmpl->coarse;
+    Candidates coarse;
+    Candidates_Init(&coarse, TEMPLATE_MATCH_TOP_K, (ct->w < ct->h ? ct->w : ct->h) / 2 + 1);
+    SearchLevel(&img->coarse, ct, scratch, &coarse);
+
+    /* Fine: every position within REFINE_RADIUS of each peak, scaled up */
+    const MatchImage* fi = &img->fine;
+    const MatchTemplate* ft = &tmpl->fine;
+    if (ft->w > fi->w || ft->h > fi->h || ft->norm < 1.0f) return;
+    CrossKernelFn cross = ActiveKernel();
+    Candidates best;
+    Candidates_Init(&best, 1, 0);
+    for (int i = 0; i < coarse.count; i++) {
+        int cx = coarse.items[i].x * 2, cy = coarse.items[i].y * 2;
+        int x0 = max(cx - TEMPLATE_MATCH_REFINE_RADIUS, 0);
+        int y0 = max(cy - TEMPLATE_MATCH_REFINE_RADIUS, 0);
+        int x1 = min(cx + TEMPLATE_MATCH_REFINE_RADIUS + 1, fi->w - ft->w);
+        int y1 = min(cy + TEMPLATE_MATCH_REFINE_RADIUS + 1, fi->h - ft->h);
+        for (int y = y0; y <= y1; y++)
+            for (int x = x0; x <= x1; x++)
+                Candidates_Push(&best, ScoreDirect(fi, ft, cross, x, y), x, y);
+    }
+    Candidates_Best(&best, out);
+}
+
+/* ─── Dispatch ─── */
+
+static TemplateMatchKernel BestKernel(void)
+{
+    return Util_CpuHasAvx2() ? TEMPLATE_MATCH_AVX2 : TEMPLATE_MATCH_SSE2;   /* SSE2 is baseline on x64 */
+}
+
+TemplateMatchKernel TemplateMatch_GetKernel(void)
+{
+    LONG kernel = g_kernel;
+    if (kernel < 0) {
+        kernel = (LONG)BestKernel();
+        if (InterlockedCompareExchange(&g_kernel, kernel, -1) == -1) {
+            Logger_Log("TemplateMatch: %s kernel\n", TemplateMatch_KernelName((TemplateMatchKernel)kernel));
+        }
+        kernel = g_kernel;
+    }
+    return (TemplateMatchKernel)kernel;
+}
+
+TemplateMatchKernel TemplateMatch_SetKernel(TemplateMatchKernel kernel)
+{
+    if (kernel == TEMPLATE_MATCH_AVX2 && !Util_CpuHasAvx2()) kernel = BestKernel();
+    if (kernel < TEMPLATE_MATCH_SCALAR || kernel > TEMPLATE_MATCH_AVX2) kernel = BestKernel();
+    InterlockedExchange(&g_kernel, (LONG)kernel);
+    return kernel;
+}
+
+const char* TemplateMatch_KernelName(TemplateMatchKernel kernel)
+{
+    switch (kernel) {
+        case TEMPLATE_MATCH_SCALAR: return "scalar";
+        case TEMPLATE_MATCH_SSE2:   return "SSE2";
+        case TEMPLATE_MATCH_AVX2:   return "AVX2";
+        default:                    return "unknown";
+    }
+}
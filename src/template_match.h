@@ -0,0 +1,145 @@
+/*
+ * template_match.h - Grayscale NCC template matching
+ *
+ * USED BY: kill_feed_sampler.c (detection-region scans)
+ *
+ * The image side of NCC (window mean and variance) comes from sum and
+ * sum-of-squares integral images built once per scan, so it is O(1) per
+ * position whatever the template size. Templates are stored zero-mean,
+ * which makes the remaining cross term a plain correlation sum(I * T').
+ * That term is computed directly for small searches and through an FFT
+ * of the image (shared by every template of the scan) for large ones.
+ * The direct path multiplies pixels against an int16 copy of the template
+ * in scalar, SSE2 or AVX2 kernels (pmaddwd); all three give the same
+ * integer sums, and the best the CPU supports is picked on first use.
+ *
+ * TemplateMatch_SearchPyramid adds a coarse-to-fine search over half
+ * resolution copies of both, refining only the best peaks at full size.
+ *
+ * Threading: a MatchImage is written by MatchImage_Set and
+ * MatchImage_PrepareSpectrum and only read by searches, so once both
+ * have run it can be searched from several threads, each with its own
+ * MatchScratch. Templates are read-only after MatchTemplate_Init.
+ */
+
+#ifndef TEMPLATE_MATCH_H
+#define TEMPLATE_MATCH_H
+
+#include <windows.h>
+
+/* A scan's grayscale image plus its integral images. Buffers are kept
+ * across MatchImage_Set calls and only grow. */
+typedef struct {
+    const BYTE* gray;       /* Caller-owned, must outlive searches */
+    int w, h;
+    UINT32* sum;            /* (w+1) x (h+1), row 0 / column 0 are zero */
+    UINT64* sqSum;
+    size_t integralCap;     /* Entries allocated in sum / sqSum */
+
+    /* Forward FFT of the zero-padded image (interleaved re/im), built by
+     * MatchImage_PrepareSpectrum for the FFT path */
+    float* spectrum;
+    int fftW, fftH;
+    size_t spectrumCap;     /* Complex entries allocated */
+    BOOL spectrumValid;
+} MatchImage;
+
+/* A template, zero-mean, ready to search with */
+typedef struct {
+    float* centered;        /* w x h, pixel - mean (FFT path) */
+    short* quant;           /* w x h, centered in Q(TEMPLATE_MATCH_Q_BITS) (direct path) */
+    int quantSum;           /* sum of quant: rounding leaves it slightly off 0 */
+    int rowsPerFlush;       /* Rows a 32-bit SIMD lane can sum without overflow */
+    int w, h;
+    float mean;
+    float norm;             /* sqrt(sum of centered^2) */
+} MatchTemplate;
+
+typedef enum {
+    TEMPLATE_MATCH_SCALAR = 0,
+    TEMPLATE_MATCH_SSE2,
+    TEMPLATE_MATCH_AVX2
+} TemplateMatchKernel;
+
+/* Per-thread working memory for the FFT path */
+typedef struct {
+    float* buf;
+    size_t cap;             /* Complex entries allocated */
+} MatchScratch;
+
+typedef struct {
+    float score;            /* Best NCC, -1 if the template does not fit */
+    int x, y;               /* Top-left of the best window */
+} MatchResult;
+
+/* Bind gray (w x h, tightly packed) and rebuild the integral images.
+ * Invalidates the spectrum. Returns FALSE on allocation failure. */
+BOOL MatchImage_Set(MatchImage* img, const BYTE* gray, int w, int h);
+
+/* Build the image spectrum if the FFT path may be used and it is not
+ * already valid. Searches call it on demand; callers that share one image
+ * across threads call it once before fanning out. */
+BOOL MatchImage_PrepareSpectrum(MatchImage* img);
+
+void MatchImage_Free(MatchImage* img);
+
+/* Build a zero-mean template from gray (w x h, tightly packed) */
+BOOL MatchTemplate_Init(MatchTemplate* t, const BYTE* gray, int w, int h);
+
+void MatchTemplate_Free(MatchTemplate* t);
+
+void MatchScratch_Free(MatchScratch* scratch);
+
+/* Best NCC position of tmpl in img. Picks the direct or FFT path by
+ * estimated cost. scratch may be NULL only if the FFT path is never
+ * wanted (it then falls back to direct). */
+void TemplateMatch_Search(MatchImage* img, const MatchTemplate* tmpl,
+                          MatchScratch* scratch, MatchResult* out);
+
+/* Kernel the direct path uses */
+TemplateMatchKernel TemplateMatch_GetKernel(void);
+
+/* Force a kernel (benchmarks, output checks). One the CPU lacks is replaced
+ * by the best it has; returns the kernel now in use. */
+TemplateMatchKernel TemplateMatch_SetKernel(TemplateMatchKernel kernel);
+
+const char* TemplateMatch_KernelName(TemplateMatchKernel kernel);
+
+/* ─── Coarse-to-fine ─── */
+
+/* A scan image at full and half resolution */
+typedef struct {
+    MatchImage fine;
+    MatchImage coarse;      /* Valid when hasCoarse */
+    BYTE* half;             /* Backing pixels of coarse */
+    size_t halfCap;
+    BOOL hasCoarse;
+} MatchImagePyramid;
+
+/* A template at full and half resolution, built once at load */
+typedef struct {
+    MatchTemplate fine;
+    MatchTemplate coarse;   /* Valid when hasCoarse */
+    BOOL hasCoarse;
+} MatchTemplatePyramid;
+
+/* MatchImage_Set on both levels. gray must outlive searches. FALSE only if
+ * the fine level fails; a missing coarse level means exhaustive search. */
+BOOL MatchImagePyramid_Set(MatchImagePyramid* pyr, const BYTE* gray, int w, int h);
+
+/* MatchImage_PrepareSpectrum on both levels */
+BOOL MatchImagePyramid_PrepareSpectrum(MatchImagePyramid* pyr);
+
+void MatchImagePyramid_Free(MatchImagePyramid* pyr);
+
+BOOL MatchTemplatePyramid_Init(MatchTemplatePyramid* pyr, const BYTE* gray, int w, int h);
+
+void MatchTemplatePyramid_Free(MatchTemplatePyramid* pyr);
+
+/* Best NCC position of tmpl in img: half-resolution search, then full
+ * resolution around its best peaks. Falls back to TemplateMatch_Search on
+ * the fine level when either side has no coarse level. */
+void TemplateMatch_SearchPyramid(MatchImagePyramid* img, const MatchTemplatePyramid* tmpl,
+                                 MatchScratch* scratch, MatchResult* out);
+
+#endif /* TEMPLATE_MATCH_H */
@@ -0,0 +1,81 @@
+/*
+ * trace.c - ETW TraceLogging provider for pipeline stages
+ *
+ * TraceLogging event names must be string literals, so each stage has its
+ * own pair of write statements behind a switch. The enable callback runs
+ * after TraceLogging has updated the provider's level and keywords for
+ * every attached session, so re-reading TraceLoggingProviderEnabled there
+ * keeps g_traceEnabled right when several sessions come and go.
+ */
+
+#include "trace.h"
+#include <winmeta.h>
+#include <evntprov.h>
+#include <TraceLoggingProvider.h>
+
+// {3dd0f4e4-bd04-5e8a-17d5-612264ce2b7c} = name hash of "LWSR.Pipeline"
+TRACELOGGING_DEFINE_PROVIDER(
+    g_traceProvider,
+    "LWSR.Pipeline",
+    (0x3dd0f4e4, 0xbd04, 0x5e8a, 0x17, 0xd5, 0x61, 0x22, 0x64, 0xce, 0x2b, 0x7c));
+
+volatile LONG g_traceEnabled = 0;
+static BOOL g_traceRegistered = FALSE;
+
+static void NTAPI TraceEnableCallback(LPCGUID sourceId, ULONG isEnabled, UCHAR level,
+                                      ULONGLONG matchAnyKeyword, ULONGLONG matchAllKeyword,
+                                      PEVENT_FILTER_DESCRIPTOR filterData, PVOID context) {
+    (void)sourceId; (void)isEnabled; (void)level;
+    (void)matchAnyKeyword; (void)matchAllKeyword; (void)filterData; (void)context;
+    InterlockedExchange(&g_traceEnabled,
+                        TraceLoggingProviderEnabled(g_traceProvider, WINEVENT_LEVEL_INFO, 0) ? 1 : 0);
+}
+
+void Trace_Init(void) {
+    if (g_traceRegistered) return;
+    g_traceRegistered = SUCCEEDED(TraceLoggingRegisterEx(g_traceProvider, TraceEnableCallback, NULL));
+}
+
+void Trace_Shutdown(void) {
+    if (!g_traceRegistered) return;
+    InterlockedExchange(&g_traceEnabled, 0);
+    TraceLoggingUnregister(g_traceProvider);
+    g_traceRegistered = FALSE;
+}
+
+// Opcode and level are compile-time event metadata, hence one write per opcode
+#define WRITE_EVENT(name, opcode)                                               \
+    TraceLoggingWriteActivity(g_traceProvider, name, &activity->activityId, NULL, \
+                              TraceLoggingOpcode(opcode),                        \
+                              TraceLoggingLevel(WINEVENT_LEVEL_INFO),            \
+                              TraceLoggingInt64(frame, "Frame"),                 \
+                              TraceLoggingInt64(timestamp, "Timestamp"))
+#define WRITE_STAGE(name)                                                       \
+    if (start) WRITE_EVENT(name, WINEVENT_OPCODE_START);                        \
+    else WRITE_EVENT(name, WINEVENT_OPCODE_STOP);                               \
+    break
+
+static void WriteStage(const TraceActivity* activity, BOOL start, LONGLONG frame, LONGLONG timestamp) {
+    switch (activity->stage) {
+        case TRACE_STAGE_CAPTURE:       WRITE_STAGE("Capture");
+        case TRACE_STAGE_CONVERT:       WRITE_STAGE("Convert");
+        case TRACE_STAGE_ENCODE_SUBMIT: WRITE_STAGE("EncodeSubmit");
+        case TRACE_STAGE_BUFFER_ADD:    WRITE_STAGE("BufferAdd");
+        case TRACE_STAGE_AAC_FEED:      WRITE_STAGE("AacFeed");
+        case TRACE_STAGE_KILLFEED_SCAN: WRITE_STAGE("KillFeedScan");
+        case TRACE_STAGE_SAVE_PREPARE:  WRITE_STAGE("SavePrepare");
+        case TRACE_STAGE_SAVE_WRITE:    WRITE_STAGE("SaveWrite");
+        default: break;
+    }
+}
+
+void Trace_StartStage(TraceActivity* activity, TraceStage stage, LONGLONG frame, LONGLONG timestamp) {
+    activity->stage = stage;
+    activity->active = (EventActivityIdControl(EVENT_ACTIVITY_CTRL_CREATE_ID,
+                                               &activity->activityId) == ERROR_SUCCESS);
+    if (activity->active) WriteStage(activity, TRUE, frame, timestamp);
+}
+
+void Trace_StopStage(const TraceActivity* activity, LONGLONG frame, LONGLONG timestamp) {
+    WriteStage(activity, FALSE, frame, timestamp);
+}
@@ -0,0 +1,66 @@
+/*
+ * trace.h - ETW TraceLogging events for pipeline stages
+ *
+ * SHARED BY: replay_buffer.c, recording.c, kill_feed_sampler.c, aac_encoder.c
+ *
+ * Provider "LWSR.Pipeline", {3dd0f4e4-bd04-5e8a-17d5-612264ce2b7c}. The GUID
+ * is the standard hash of the name, so tools that take "*Name" find it too.
+ * Each traced stage is a start/stop pair sharing a fresh activity id, which
+ * WPA's Generic Events view shows as one span per frame next to GPU queue
+ * packets and the game's Present events.
+ *
+ * Both events carry Frame and Timestamp (their meaning per stage is listed
+ * in TraceStage). When no session listens, TRACE_STAGE_START reads one
+ * global flag and TRACE_STAGE_STOP one local; neither makes a call.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <windows.h>
+
+typedef enum {                      // Frame / Timestamp (100 ns unless noted)
+    TRACE_STAGE_CAPTURE = 0,        // Capture_GetFrameTexture: attempt number / frame time
+    TRACE_STAGE_CONVERT,            // GPUConverter_Convert: attempt number / frame time
+    TRACE_STAGE_ENCODE_SUBMIT,      // NVENCEncoder_SubmitTexture / SubmitRepeat: same
+    TRACE_STAGE_BUFFER_ADD,         // FrameBuffer_Add: frame size in bytes / frame time
+    TRACE_STAGE_AAC_FEED,           // AACEncoder_Feed: AAC frames emitted so far / PCM time
+    TRACE_STAGE_KILLFEED_SCAN,      // Sampler worker match: region bit mask / capture time
+                                    //   (GetTickCount64 ms)
+    TRACE_STAGE_SAVE_PREPARE,       // PrepareSaveJob: samples buffered, then taken / window end
+                                    //   (0 = whole buffer), then end actually saved
+    TRACE_STAGE_SAVE_WRITE,         // WriteSaveJob (mux to disk): video samples / last sample time
+    TRACE_STAGE_COUNT
+} TraceStage;
+
+// One in-flight stage. Lives on the caller's stack between start and stop.
+typedef struct {
+    GUID activityId;
+    TraceStage stage;
+    BOOL active;                    // FALSE when tracing was off at start
+} TraceActivity;
+
+// Nonzero while at least one ETW session has the provider enabled
+extern volatile LONG g_traceEnabled;
+
+// Register / unregister the provider. Init before the pipeline threads
+// start, Shutdown after they stop. Events before Init are dropped.
+void Trace_Init(void);
+void Trace_Shutdown(void);
+
+// Out-of-line writers; use the macros below so the disabled case stays inline
+void Trace_StartStage(TraceActivity* activity, TraceStage stage, LONGLONG frame, LONGLONG timestamp);
+void Trace_StopStage(const TraceActivity* activity, LONGLONG frame, LONGLONG timestamp);
+
+#define TRACE_STAGE_START(activity, stage, frame, timestamp) do {               \
+        (activity)->active = FALSE;                                             \
+        if (g_traceEnabled) Trace_StartStage((activity), (stage), (frame), (timestamp)); \
+    } while (0)
+
+// Only writes if the matching start did, so a session that attaches
+// mid-stage never sees a stop without a start
+#define TRACE_STAGE_STOP(activity, frame, timestamp) do {                       \
+        if ((activity)->active) Trace_StopStage((activity), (frame), (timestamp)); \
+    } while (0)
+
+#endif // TRACE_H
@@ -13,10 +13,11 @@
 #include "constants.h"   // For bitrate calculation constants
 #include <time.h>        // For time(), localtime(), strftime()
 #include <stdio.h>       // For snprintf()
+#include <intrin.h>      // For __cpuid(), _xgetbv()
 
 // Calculate video bitrate based on quality preset
 // Uses ShadowPlay-style scaling: base bitrate scales with resolution and FPS
-UINT32 Util_CalculateBitrate(int width, int height, int fps, QualityPreset quality) {
+UINT32 Util_CalculateBitrate(int width, int height, int fps, QualityPreset quality, VideoCodec codec) {
     // Preconditions
     LWSR_ASSERT(width > 0);
     LWSR_ASSERT(height > 0);
@@ -48,6 +49,7 @@ UINT32 Util_CalculateBitrate(int width, int height, int fps, QualityPreset quali
     
     // Use double for intermediate calculation to avoid overflow
     double bitrateCalc = (double)baseMbps * resScale * fpsScale * 1000000.0;
+    if (codec == CODEC_AV1) bitrateCalc *= AV1_BITRATE_SCALE;
     
     // Bounds: 10 Mbps minimum, 150 Mbps maximum
     if (bitrateCalc < MIN_BITRATE_BPS) bitrateCalc = MIN_BITRATE_BPS;
@@ -115,6 +117,17 @@ RECT Util_CalculateAspectRect(RECT sourceBounds, int ratioW, int ratioH) {
     return result;
 }
 
+void Util_ScaleToHeight(int srcW, int srcH, int targetHeight, int* outW, int* outH) {
+    *outW = srcW;
+    *outH = srcH;
+    if (targetHeight <= 0 || targetHeight >= srcH || srcH <= 0) return;
+    
+    // Round width to nearest, then force both even (NV12 / HEVC requirement)
+    int w = (int)(((LONGLONG)srcW * targetHeight + srcH / 2) / srcH);
+    *outW = (w / 2) * 2;
+    *outH = (targetHeight / 2) * 2;
+}
+
 // ============================================================================
 // String Conversion Utilities
 // ============================================================================
@@ -183,3 +196,19 @@ LONGLONG Util_QpcDeltaToHns(LARGE_INTEGER end, LARGE_INTEGER start, LARGE_INTEGE
     LONGLONG remainder = delta - seconds * freq.QuadPart;
     return seconds * 10000000LL + (remainder * 10000000LL) / freq.QuadPart;
 }
+
+// ============================================================================
+// CPU Features
+// ============================================================================
+
+BOOL Util_CpuHasAvx2(void) {
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7) return FALSE;
+    __cpuid(regs, 1);
+    BOOL osxsave = (regs[2] & (1 << 27)) != 0;
+    BOOL avx = (regs[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return FALSE;
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+}
@@ -11,13 +11,18 @@
 
 // Calculate video bitrate based on quality preset
 // Uses ShadowPlay-style scaling: base bitrate scales with resolution and FPS
+// AV1 runs at AV1_BITRATE_SCALE of the HEVC figure
 // Returns bitrate in bits per second
-UINT32 Util_CalculateBitrate(int width, int height, int fps, QualityPreset quality);
+UINT32 Util_CalculateBitrate(int width, int height, int fps, QualityPreset quality, VideoCodec codec);
 
 // Calculate aspect ratio crop rectangle centered on source bounds
 // Returns the cropped RECT; ratioW/ratioH define the target aspect (e.g., 16, 9)
 RECT Util_CalculateAspectRect(RECT sourceBounds, int ratioW, int ratioH);
 
+// Scale (srcW x srcH) down to targetHeight keeping aspect, even dimensions.
+// targetHeight <= 0 or >= srcH leaves the size unchanged (never upscales).
+void Util_ScaleToHeight(int srcW, int srcH, int targetHeight, int* outW, int* outH);
+
 // Get aspect ratio dimensions from config index
 // Index: 0=Native, 1=16:9, 2=9:16, 3=1:1, 4=4:5, 5=16:10, 6=4:3, 7=21:9, 8=32:9
 void Util_GetAspectRatioDimensions(int aspectIndex, int* ratioW, int* ratioH);
@@ -51,4 +56,12 @@ int Util_Utf8ToWide(const char* utf8, WCHAR* wide, int maxLen);
 // of bug — always use this helper instead of inlining the math.
 LONGLONG Util_QpcDeltaToHns(LARGE_INTEGER end, LARGE_INTEGER start, LARGE_INTEGER freq);
 
+// ============================================================================
+// CPU Features
+// ============================================================================
+
+// TRUE if the CPU has AVX2 and the OS saves YMM state (OSXSAVE + XCR0).
+// SSE2 needs no check: it is baseline on x64.
+BOOL Util_CpuHasAvx2(void);
+
 #endif // UTIL_H
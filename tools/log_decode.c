@@ -0,0 +1,169 @@
+/*
+ * log_decode.c - Turn a binary debug log (.lwlog) back into the text log
+ *
+ * BUILD: build.bat tools  ->  bin\lwsr_logdecode.exe (console)
+ *
+ * With [Debug] BinaryLog=1 the logger stores each entry as its format
+ * string's id plus the raw arguments (see "Binary log layout" in logger.h).
+ * This reads such a file and prints the same lines the text logger would
+ * have written, formatting with the logger's own Logger_FormatRecord:
+ *
+ *   lwsr_logdecode.exe Debug\lwsr_log_20240101_120000.lwlog [out.txt]
+ *
+ * Without an output path the text goes to stdout. A truncated file (the
+ * process died mid-write) decodes up to its last whole record.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logger.h"
+
+#define MAX_FORMAT_IDS      65536   /* Ids are slots in the logger's table */
+#define LINE_SIZE           2048
+
+typedef struct {
+    const BYTE* data;
+    size_t size;
+    size_t pos;
+} Reader;
+
+static BOOL ReadBytes(Reader* r, void* out, size_t size)
+{
+    if (r->size - r->pos < size) return FALSE;
+    memcpy(out, r->data + r->pos, size);
+    r->pos += size;
+    return TRUE;
+}
+
+static BYTE* LoadFile(const char* path, size_t* outSize)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    BYTE* data = NULL;
+    if (_fseeki64(f, 0, SEEK_END) == 0) {
+        long long size = _ftelli64(f);
+        if (size >= 0 && _fseeki64(f, 0, SEEK_SET) == 0) {
+            data = (BYTE*)malloc((size_t)size + 1);
+            if (data && fread(data, 1, (size_t)size, f) == (size_t)size) {
+                *outSize = (size_t)size;
+            } else {
+                free(data);
+                data = NULL;
+            }
+        }
+    }
+    fclose(f);
+    return data;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3 || !strcmp(argv[1], "--help")) {
+        fprintf(stderr, "Usage: lwsr_logdecode.exe <log.lwlog> [out.txt]\n");
+        return 2;
+    }
+
+    size_t size = 0;
+    BYTE* data = LoadFile(argv[1], &size);
+    if (!data) {
+        fprintf(stderr, "Cannot read %s\n", argv[1]);
+        return 1;
+    }
+
+    int status = 1;
+    FILE* out = stdout;
+    char** formats = NULL;
+
+    Reader r = { data, size, 0 };
+    char magic[8];
+    UINT32 version = 0, pointerBits = 0;
+    if (!ReadBytes(&r, magic, sizeof(magic)) || memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)) != 0 ||
+        !ReadBytes(&r, &version, sizeof(version)) || !ReadBytes(&r, &pointerBits, sizeof(pointerBits))) {
+        fprintf(stderr, "%s is not a binary LWSR log\n", argv[1]);
+        goto cleanup;
+    }
+    if (version != LOG_BINARY_VERSION) {
+        fprintf(stderr, "%s: unsupported version %u (this decoder reads %d)\n",
+                argv[1], version, LOG_BINARY_VERSION);
+        goto cleanup;
+    }
+
+    formats = (char**)calloc(MAX_FORMAT_IDS, sizeof(char*));
+    if (!formats) goto cleanup;
+    if (argc == 3) {
+        out = fopen(argv[2], "w");
+        if (!out) {
+            fprintf(stderr, "Cannot write %s\n", argv[2]);
+            out = stdout;
+            goto cleanup;
+        }
+    }
+
+    size_t records = 0;
+    BOOL truncated = FALSE;
+    while (r.pos < r.size) {
+        BYTE type = r.data[r.pos++];
+        USHORT length;
+
+        if (type == LOG_RECORD_FORMAT) {
+            UINT32 id;
+            if (!ReadBytes(&r, &id, sizeof(id)) || !ReadBytes(&r, &length, sizeof(length)) ||
+                r.size - r.pos < length || id >= MAX_FORMAT_IDS) {
+                truncated = TRUE;
+                break;
+            }
+            /* Later sessions appended to the file reuse ids */
+            free(formats[id]);
+            formats[id] = (char*)malloc((size_t)length + 1);
+            if (!formats[id]) goto cleanup;
+            memcpy(formats[id], r.data + r.pos, length);
+            formats[id][length] = '\0';
+            r.pos += length;
+        } else if (type == LOG_RECORD_MESSAGE) {
+            ULONGLONG ms;
+            UINT32 id;
+            if (!ReadBytes(&r, &ms, sizeof(ms)) || !ReadBytes(&r, &id, sizeof(id)) ||
+                !ReadBytes(&r, &length, sizeof(length)) || r.size - r.pos < length) {
+                truncated = TRUE;
+                break;
+            }
+            char line[LINE_SIZE];
+            if (id < MAX_FORMAT_IDS && formats[id]) {
+                Logger_FormatRecord(formats[id], r.data + r.pos, length, line, sizeof(line));
+            } else {
+                snprintf(line, sizeof(line), "<unknown format %u>\n", id);
+            }
+            fprintf(out, "[%02llu:%02llu:%02llu.%03llu] %s",
+                    (ms / 3600000) % 24, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000, line);
+            r.pos += length;
+            records++;
+        } else if (type == LOG_RECORD_TEXT) {
+            if (!ReadBytes(&r, &length, sizeof(length)) || r.size - r.pos < length) {
+                truncated = TRUE;
+                break;
+            }
+            fwrite(r.data + r.pos, 1, length, out);
+            r.pos += length;
+            records++;
+        } else {
+            fprintf(stderr, "%s: unknown record type 0x%02X at offset %zu\n",
+                    argv[1], type, r.pos - 1);
+            goto cleanup;
+        }
+    }
+
+    if (truncated) fprintf(stderr, "%s: file ends mid-record (decoded up to it)\n", argv[1]);
+    fprintf(stderr, "%zu records, %u-bit writer\n", records, pointerBits);
+    status = 0;
+
+cleanup:
+    if (out != stdout) fclose(out);
+    if (formats) {
+        for (int i = 0; i < MAX_FORMAT_IDS; i++) free(formats[i]);
+        free(formats);
+    }
+    free(data);
+    return status;
+}